@@ -1,6 +1,7 @@
 //-- includes -----
 #include "ClientNetworkManager.h"
 #include "ClientLog.h"
+#include "CompactDataFrame.h"
 #include "PackedMessage.h"
 #include "PSMoveProtocol.pb.h"
 #include <cassert>
@@ -21,6 +22,21 @@ using asio::ip::tcp;
 using asio::ip::udp;
 using boost::uint8_t;
 
+//-- constants -----
+// Big enough for a single input data frame
+const size_t k_input_data_frame_arena_block_size = 1024;
+
+// Big enough for a single output data frame
+const size_t k_output_data_frame_arena_block_size = 8*1024;
+
+//-- definitions -----
+// A packed input data frame waiting to be sent.
+// These are recycled once sent so that queuing a data frame doesn't allocate.
+struct PackedInputDataFrame
+{
+    uint8_t buffer[HEADER_SIZE + MAX_INPUT_DATA_FRAME_MESSAGE_SIZE];
+};
+
 //-- implementation -----
 
 // -ClientNetworkManagerImpl-
@@ -53,7 +69,12 @@ public:
         , m_response_read_buffer()
         , m_packed_response(std::shared_ptr<PSMoveProtocol::Response>(new PSMoveProtocol::Response()))
 
-        , m_packed_output_data_frame(std::shared_ptr<PSMoveProtocol::DeviceOutputDataFrame>(new PSMoveProtocol::DeviceOutputDataFrame()))
+        , m_packed_output_data_frame()
+        , m_output_data_frame_arena_block(k_output_data_frame_arena_block_size)
+        , m_output_data_frame_arena(make_arena_options(m_output_data_frame_arena_block))
+
+        , m_input_data_frame_arena_block(k_input_data_frame_arena_block_size)
+        , m_input_data_frame_arena(make_arena_options(m_input_data_frame_arena_block))
     
         , m_write_bufer()
         , m_packed_request()
@@ -63,10 +84,25 @@ public:
         , m_response_listener(responseListener)
         , m_netEventListener(netEventListener)
         , m_pending_requests()
+        , m_pending_data_frames()
+        , m_free_data_frames()
     {
         memset(m_output_data_frame_buffer, 0, sizeof(m_output_data_frame_buffer));
     }
 
+    virtual ~ClientNetworkManagerImpl()
+    {
+        for (PackedInputDataFrame *packed_data_frame : m_pending_data_frames)
+        {
+            delete packed_data_frame;
+        }
+
+        for (PackedInputDataFrame *packed_data_frame : m_free_data_frames)
+        {
+            delete packed_data_frame;
+        }
+    }
+
     bool start()
     {
         tcp::resolver resolver(m_io_service);
@@ -84,12 +120,34 @@ public:
         start_tcp_write_request();
     }
 
-    void send_device_data_frame(DeviceInputDataFramePtr data_frame)
+    PSMoveProtocol::DeviceInputDataFrame *allocate_device_data_frame()
+    {
+        return google::protobuf::Arena::CreateMessage<PSMoveProtocol::DeviceInputDataFrame>(&m_input_data_frame_arena);
+    }
+
+    void send_device_data_frame(PSMoveProtocol::DeviceInputDataFrame *data_frame)
     {
         // Stamp the packet with the connection ID before it goes out
         data_frame->set_connection_id(m_tcp_connection_id);
 
-        m_pending_data_frames.push_back(data_frame);
+        // Pack the data frame right away into a recycled buffer
+        PackedInputDataFrame *packed_data_frame= allocate_packed_data_frame();
+        if (PackedMessage<PSMoveProtocol::DeviceInputDataFrame>::pack_message(
+                *data_frame, packed_data_frame->buffer, sizeof(packed_data_frame->buffer)))
+        {
+            m_pending_data_frames.push_back(packed_data_frame);
+        }
+        else
+        {
+            CLIENT_LOG_ERROR("ClientNetworkManager::send_device_data_frame")
+                << "DataFrame too big to fit in packet!";
+            m_free_data_frames.push_back(packed_data_frame);
+        }
+
+        // The data frame isn't needed once packed,
+        // so the arena keeps its initial block for the next data frame
+        m_input_data_frame_arena.Reset();
+
         start_udp_queued_data_frame_write();
     }
 
@@ -582,33 +640,24 @@ private:
             {
                 if (m_pending_data_frames.size() > 0)
                 {
-                    DeviceInputDataFramePtr dataframe = m_pending_data_frames.front();
-
-                    m_packed_input_data_frame.set_msg(dataframe);
-                    if (m_packed_input_data_frame.pack(m_input_data_frame_buffer, sizeof(m_input_data_frame_buffer)))
-                    {
-                        int msg_size = m_packed_input_data_frame.get_msg()->ByteSize();
-
-                        CLIENT_LOG_DEBUG("ClientNetworkManager::start_udp_queued_data_frame_write") << "Sending UDP DataFrame";
-                        CLIENT_LOG_DEBUG("   ") << show_hex(m_input_data_frame_buffer, HEADER_SIZE + msg_size);
-                        CLIENT_LOG_DEBUG("   ") << msg_size << " bytes";
-
-                        // The queue should prevent us from writing more than one data frame at once
-                        assert(!m_has_pending_udp_write);
-                        m_has_pending_udp_write = true;
-
-                        // Start an asynchronous operation to send the data frame
-                        // NOTE: Even if the write completes immediate, the callback will only be called from io_service::poll()
-                        m_udp_socket.async_send_to(
-                            boost::asio::buffer(m_input_data_frame_buffer, sizeof(m_input_data_frame_buffer)),
-                            m_udp_server_endpoint,
-                            boost::bind(&ClientNetworkManagerImpl::handle_udp_write_device_data_frame_complete, this, _1));
-                    }
-                    else
-                    {
-                        CLIENT_LOG_ERROR("ClientNetworkManager::start_udp_queued_data_frame_write")
-                            << "DataFrame too big to fit in packet!";
-                    }
+                    // The packed data frame stays at the front of the queue until the write completes
+                    PackedInputDataFrame *packed_data_frame = m_pending_data_frames.front();
+                    unsigned msg_size = m_packed_input_data_frame.decode_header(packed_data_frame->buffer, sizeof(packed_data_frame->buffer));
+
+                    CLIENT_LOG_DEBUG("ClientNetworkManager::start_udp_queued_data_frame_write") << "Sending UDP DataFrame";
+                    CLIENT_LOG_DEBUG("   ") << show_hex(packed_data_frame->buffer, HEADER_SIZE + msg_size);
+                    CLIENT_LOG_DEBUG("   ") << msg_size << " bytes";
+
+                    // The queue should prevent us from writing more than one data frame at once
+                    assert(!m_has_pending_udp_write);
+                    m_has_pending_udp_write = true;
+
+                    // Start an asynchronous operation to send the data frame
+                    // NOTE: Even if the write completes immediate, the callback will only be called from io_service::poll()
+                    m_udp_socket.async_send_to(
+                        boost::asio::buffer(packed_data_frame->buffer, sizeof(packed_data_frame->buffer)),
+                        m_udp_server_endpoint,
+                        boost::bind(&ClientNetworkManagerImpl::handle_udp_write_device_data_frame_complete, this, _1));
                 }
             }
         }
@@ -627,7 +676,8 @@ private:
             // no longer is there a pending write
             m_has_pending_udp_write = false;
 
-            // Remove the dataframe from the pending send queue now that it's sent
+            // Recycle the dataframe from the pending send queue now that it's sent
+            m_free_data_frames.push_back(m_pending_data_frames.front());
             m_pending_data_frames.pop_front();
         }
         else
@@ -648,11 +698,12 @@ private:
                 boost::bind(
                     &ClientNetworkManagerImpl::handle_udp_read_data_frame, 
                     this,
-                    asio::placeholders::error));
+                    asio::placeholders::error,
+                    asio::placeholders::bytes_transferred));
         }
     }
 
-    void handle_udp_read_data_frame(const boost::system::error_code& error)
+    void handle_udp_read_data_frame(const boost::system::error_code& error, std::size_t bytes_transferred)
     {
         if (m_connection_stopped)
             return;
@@ -662,7 +713,7 @@ private:
             CLIENT_LOG_DEBUG("ClientNetworkManager::handle_udp_read_data_frame") << "Received DataFrame" << std::endl;
 
             // Process the data frame now that we have received all of it
-            handle_udp_data_frame_received();
+            handle_udp_data_frame_received(bytes_transferred);
 
             // Start reading the next incoming data frame
             start_udp_read_data_frame();
@@ -682,25 +733,56 @@ private:
 
     // Called when enough data was read into m_data_frame_read_buffer for a complete data frame message. 
     // Parse the data_frame and forward it on to the response handler.
-    void handle_udp_data_frame_received()
+    void handle_udp_data_frame_received(std::size_t bytes_transferred)
     {
         // No longer is there a pending read
         m_has_pending_udp_read= false;
 
-        CLIENT_LOG_DEBUG("ClientNetworkManager::handle_udp_data_frame_received") << "Parsing DataFrame" << std::endl;
-        
+        CLIENT_LOG_DEBUG("ClientNetworkManager::handle_udp_data_frame_received") 
+            << "Parsing " << bytes_transferred << " byte datagram" << std::endl;
+
+        // The service sends all of the data frames it had queued for us back to back in one datagram
+        std::size_t frame_offset= 0;
+
+        while (frame_offset < bytes_transferred && !m_connection_stopped)
+        {
+            const uint8_t *frame_bytes= &m_output_data_frame_buffer[frame_offset];
+            const std::size_t remaining_bytes= bytes_transferred - frame_offset;
+
+            // Compact data frames have no protobuf length header
+            const CompactDataFrameHeader *compact_header= getCompactDataFrameHeader(frame_bytes, remaining_bytes);
+            const std::size_t frame_size=
+                (compact_header != nullptr)
+                ? handle_compact_data_frame_received(compact_header, remaining_bytes)
+                : handle_packed_data_frame_received(frame_bytes, remaining_bytes);
+
+            // The rest of the datagram can't be split into frames
+            if (frame_size == 0)
+                break;
+
+            frame_offset+= frame_size;
+        }
+    }
+
+    // Returns the number of bytes the data frame took up in the datagram, or 0 if it was malformed
+    std::size_t handle_packed_data_frame_received(const uint8_t *frame_bytes, std::size_t remaining_bytes)
+    {
         // TODO: Switch on data frame type to choose which m_packed_data_frame_X to use.
-        unsigned msg_len = m_packed_output_data_frame.decode_header(m_output_data_frame_buffer, sizeof(m_output_data_frame_buffer));
+        unsigned msg_len = m_packed_output_data_frame.decode_header(frame_bytes, static_cast<unsigned int>(remaining_bytes));
         unsigned total_len= HEADER_SIZE+msg_len;
-        CLIENT_LOG_DEBUG("    ") << show_hex(m_output_data_frame_buffer, total_len) << std::endl;
+        CLIENT_LOG_DEBUG("    ") << show_hex(frame_bytes, std::min<std::size_t>(total_len, remaining_bytes)) << std::endl;
         CLIENT_LOG_DEBUG("    ") << msg_len << " bytes" << std::endl;
 
-        // Parse the response buffer
-        if (m_packed_output_data_frame.unpack(m_output_data_frame_buffer, total_len))
-        {
-            const PSMoveProtocol::DeviceOutputDataFrame *data_frame = m_packed_output_data_frame.get_msg().get();
+        // Parse the data frame into a message that only lives until the listener is done with it
+        PSMoveProtocol::DeviceOutputDataFrame *data_frame = 
+            google::protobuf::Arena::CreateMessage<PSMoveProtocol::DeviceOutputDataFrame>(&m_output_data_frame_arena);
+        std::size_t frame_size= 0;
 
+        if (total_len <= remaining_bytes &&
+            data_frame->ParseFromArray(&frame_bytes[HEADER_SIZE], msg_len))
+        {
             m_data_frame_listener->handle_data_frame(data_frame);
+            frame_size= total_len;
         }
         else
         {
@@ -713,6 +795,68 @@ private:
                 m_netEventListener->handle_server_connection_socket_error(boost::asio::error::message_size);
             }
         }
+
+        // Keeps the initial block for the next data frame
+        m_output_data_frame_arena.Reset();
+
+        return frame_size;
+    }
+
+    // Returns the number of bytes the data frame took up in the datagram, or 0 if it can't be delimited
+    std::size_t handle_compact_data_frame_received(const CompactDataFrameHeader *header, std::size_t remaining_bytes)
+    {
+        CLIENT_LOG_DEBUG("ClientNetworkManager::handle_compact_data_frame_received") << "Received CompactDataFrame" << std::endl;
+        CLIENT_LOG_DEBUG("    ") << show_hex(reinterpret_cast<const uint8_t *>(header), remaining_bytes) << std::endl;
+
+        if (header->frame_size < sizeof(CompactDataFrameHeader) || header->frame_size > remaining_bytes)
+        {
+            CLIENT_LOG_ERROR("ClientNetworkManager::handle_compact_data_frame_received") 
+                << "Ignoring compact data frame of size " << header->frame_size
+                << " (" << remaining_bytes << " bytes left in the datagram)" << std::endl;
+            return 0;
+        }
+
+        if (header->version == COMPACT_DATA_FRAME_VERSION)
+        {
+            m_data_frame_listener->handle_compact_data_frame(header);
+        }
+        else
+        {
+            // Unlike a malformed protobuf data frame this is most likely a service of a different version,
+            // so skip the frame rather than dropping the connection
+            CLIENT_LOG_ERROR("ClientNetworkManager::handle_compact_data_frame_received") 
+                << "Ignoring compact data frame with version " << static_cast<int>(header->version)
+                << " (expected " << COMPACT_DATA_FRAME_VERSION << ")" << std::endl;
+        }
+
+        return header->frame_size;
+    }
+
+protected:
+    PackedInputDataFrame *allocate_packed_data_frame()
+    {
+        PackedInputDataFrame *packed_data_frame= nullptr;
+
+        if (m_free_data_frames.size() > 0)
+        {
+            packed_data_frame= m_free_data_frames.back();
+            m_free_data_frames.pop_back();
+        }
+        else
+        {
+            packed_data_frame= new PackedInputDataFrame;
+        }
+
+        return packed_data_frame;
+    }
+
+    static google::protobuf::ArenaOptions make_arena_options(std::vector<char> &initial_block)
+    {
+        google::protobuf::ArenaOptions options;
+        options.initial_block= initial_block.data();
+        options.initial_block_size= initial_block.size();
+
+        return options;
     }
 
 private:
@@ -737,11 +881,15 @@ private:
     vector<uint8_t> m_response_read_buffer;
     PackedMessage<PSMoveProtocol::Response> m_packed_response;
 
-    uint8_t m_output_data_frame_buffer[HEADER_SIZE+MAX_OUTPUT_DATA_FRAME_MESSAGE_SIZE];
+    uint8_t m_output_data_frame_buffer[MAX_OUTPUT_DATA_FRAME_DATAGRAM_SIZE];
     PackedMessage<PSMoveProtocol::DeviceOutputDataFrame> m_packed_output_data_frame;
+    std::vector<char> m_output_data_frame_arena_block;
+    google::protobuf::Arena m_output_data_frame_arena;
 
     uint8_t m_input_data_frame_buffer[HEADER_SIZE + MAX_INPUT_DATA_FRAME_MESSAGE_SIZE];
     PackedMessage<PSMoveProtocol::DeviceInputDataFrame> m_packed_input_data_frame;
+    std::vector<char> m_input_data_frame_arena_block;
+    google::protobuf::Arena m_input_data_frame_arena;
     
     vector<uint8_t> m_write_bufer;
     PackedMessage<PSMoveProtocol::Request> m_packed_request;
@@ -752,7 +900,8 @@ private:
     IClientNetworkEventListener *m_netEventListener;
 
     deque<RequestPtr> m_pending_requests;
-    deque<DeviceInputDataFramePtr> m_pending_data_frames;
+    deque<PackedInputDataFrame *> m_pending_data_frames;
+    vector<PackedInputDataFrame *> m_free_data_frames;
 };
 
 // -ClientNetworkManager-
@@ -795,7 +944,12 @@ void ClientNetworkManager::send_request(RequestPtr request)
     m_implementation_ptr->send_request(request);
 }
 
-void ClientNetworkManager::send_device_data_frame(DeviceInputDataFramePtr data_frame)
+PSMoveProtocol::DeviceInputDataFrame *ClientNetworkManager::allocate_device_data_frame()
+{
+    return m_implementation_ptr->allocate_device_data_frame();
+}
+
+void ClientNetworkManager::send_device_data_frame(PSMoveProtocol::DeviceInputDataFrame *data_frame)
 {
     m_implementation_ptr->send_device_data_frame(data_frame);
 }
@@ -25,7 +25,9 @@ public:
 
     bool startup();
     void send_request(RequestPtr request);
-    void send_device_data_frame(DeviceInputDataFramePtr data_frame);
+    /// The returned data frame is only valid until it's handed to send_device_data_frame()
+    PSMoveProtocol::DeviceInputDataFrame *allocate_device_data_frame();
+    void send_device_data_frame(PSMoveProtocol::DeviceInputDataFrame *data_frame);
     void update();
     void shutdown();
 
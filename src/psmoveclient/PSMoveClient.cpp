@@ -3,11 +3,12 @@
 #include "ClientRequestManager.h"
 #include "ClientNetworkManager.h"
 #include "ClientLog.h"
+#include "CompactDataFrame.h"
 #include "PSMoveProtocol.pb.h"
+#include "SharedDevicePoseTable.h"
 #include "SharedTrackerState.h"
 #include <boost/interprocess/shared_memory_object.hpp>
 #include <boost/interprocess/mapped_region.hpp>
-#include <boost/interprocess/sync/scoped_lock.hpp>
 #include <algorithm>
 #include <iostream>
 #include <thread>
@@ -36,10 +37,25 @@ static void applyPSNaviDataFrame(const PSMoveProtocol::DeviceOutputDataFrame_Con
 static void applyDualShock4DataFrame(const PSMoveProtocol::DeviceOutputDataFrame_ControllerDataPacket& controller_packet, PSMDualShock4 *ds4);
 static void applyVirtualControllerDataFrame(const PSMoveProtocol::DeviceOutputDataFrame_ControllerDataPacket& controller_packet, PSMVirtualController *virtual_controller);
 static void applyPSMButtonState(PSMButtonState &button, unsigned int button_bitmask, unsigned int button_bit);
+static void applyPSMoveButtonStates(const unsigned int button_bitmask, PSMPSMove *psmove);
+static void applyPSNaviButtonStates(const unsigned int button_bitmask, PSMPSNavi *psnavi);
+static void applyDualShock4ButtonStates(const unsigned int button_bitmask, PSMDualShock4 *ds4);
+static void applyVirtualControllerButtonStates(const unsigned int button_bitmask, PSMVirtualController *virtual_controller);
+static void updateDataFrameReceiveStats(long long &data_frame_last_received_time, float &data_frame_average_fps);
 static void applyTrackerDataFrame(const PSMoveProtocol::DeviceOutputDataFrame_TrackerDataPacket& tracker_packet, PSMTracker *tracker);
 static void applyHmdDataFrame(const PSMoveProtocol::DeviceOutputDataFrame_HMDDataPacket& hmd_packet, PSMHeadMountedDisplay *hmd);
 static void applyMorpheusDataFrame(const PSMoveProtocol::DeviceOutputDataFrame_HMDDataPacket& hmd_packet, PSMMorpheus *morpheus);
 static void applyVirtualHMDDataFrame(const PSMoveProtocol::DeviceOutputDataFrame_HMDDataPacket& hmd_packet, PSMVirtualHMD *virtualHMD);
+static void applyCompactControllerDataFrame(const CompactControllerDataFrame &compact_frame, PSMController *controller);
+static void applyCompactPSMoveDataFrame(const CompactControllerDataFrame &compact_frame, PSMPSMove *psmove);
+static void applyCompactPSNaviDataFrame(const CompactControllerDataFrame &compact_frame, PSMPSNavi *psnavi);
+static void applyCompactDualShock4DataFrame(const CompactControllerDataFrame &compact_frame, PSMDualShock4 *ds4);
+static void applyCompactVirtualControllerDataFrame(const CompactControllerDataFrame &compact_frame, PSMVirtualController *virtual_controller);
+static void applyCompactHmdDataFrame(const CompactHMDDataFrame &compact_frame, PSMHeadMountedDisplay *hmd);
+static void applyCompactMorpheusDataFrame(const CompactHMDDataFrame &compact_frame, PSMMorpheus *morpheus);
+static void applyCompactVirtualHMDDataFrame(const CompactHMDDataFrame &compact_frame, PSMVirtualHMD *virtualHMD);
+static void applyCompactPose(const CompactPoseData &compact_pose, PSMPosef &pose);
+static void applyCompactPhysicsData(const CompactPhysicsData &compact_physics, const uint32_t flags, PSMPhysicsData &physics_data);
 
 // -- private definitions -----
 class SharedVideoFrameReadOnlyAccessor
@@ -48,7 +64,7 @@ public:
     SharedVideoFrameReadOnlyAccessor()
         : m_shared_memory_object(nullptr)
         , m_region(nullptr)
-        , m_bgr_frame_buffer(nullptr)
+        , m_video_frame_buffer(nullptr)
         , m_frame_width(0)
         , m_frame_height(0)
         , m_frame_stride(0)
@@ -114,98 +130,183 @@ public:
             m_shared_memory_object = nullptr;
         }
 
-        if (m_bgr_frame_buffer != nullptr)
-        {
-            delete[] m_bgr_frame_buffer;
-            m_bgr_frame_buffer = nullptr;
-        }
+        m_video_frame_buffer = nullptr;
     }
 
+    // Copies the newest complete frame in the shared memory ring into the video frame buffer.
+    // The server is never blocked: if it laps the ring and rewrites the slot while the copy is made,
+    // the copy gets thrown away and the video frame buffer keeps the previous frame.
     bool readVideoFrame()
     {
         bool bNewFrame = false;
-        SharedVideoFrameHeader *sharedFrameState = getFrameHeader();
-        boost::interprocess::scoped_lock<boost::interprocess::interprocess_mutex> lock(sharedFrameState->mutex);
-
-        // Make sure the target buffer is big enough to read the video frame into
-        size_t buffer_size =
-            SharedVideoFrameHeader::computeVideoBufferSize(sharedFrameState->stride, sharedFrameState->height);
+        const SharedVideoFrameHeader *sharedFrameState = getFrameHeader();
 
         // Make sure the shared memory is the size we expect
-        size_t total_shared_mem_size =
-            SharedVideoFrameHeader::computeTotalSize(sharedFrameState->stride, sharedFrameState->height);
-        assert(m_region->get_size() >= total_shared_mem_size);
-
-        // Re-allocate the buffer if any of the video properties changed
-        if (m_frame_width != sharedFrameState->width ||
-            m_frame_height != sharedFrameState->height ||
-            m_frame_stride != sharedFrameState->stride)
-        {
-            freeVideoBuffer();
+        assert(m_region->get_size() >=
+            SharedVideoFrameHeader::computeTotalSize(sharedFrameState->stride, sharedFrameState->height));
 
-            m_frame_width = sharedFrameState->width;
-            m_frame_height = sharedFrameState->height;
-            m_frame_stride = sharedFrameState->stride;
+        const int latest_frame_index = sharedFrameState->latest_frame_index.load(std::memory_order_acquire);
 
-            allocateVideoBuffer();
-        }
-
-        // Copy over the video frame if the frame index changed
-        if (m_last_frame_index != sharedFrameState->frame_index)
+        if (latest_frame_index != 0 && latest_frame_index != m_last_frame_index)
         {
-            if (buffer_size > 0)
+            const int slot_index = SharedVideoFrameHeader::getSlotIndex(latest_frame_index);
+            const SharedVideoFrameSlot &slot = sharedFrameState->slots[slot_index];
+            const unsigned int sequence = slot.sequence.load(std::memory_order_acquire);
+
+            // If the server already lapped the ring and is rewriting the slot, try again next poll
+            if ((sequence & 1) == 0 &&
+                slot.frame_index.load(std::memory_order_relaxed) == latest_frame_index)
             {
-                std::memcpy(m_bgr_frame_buffer, sharedFrameState->getBufferMutable(), buffer_size);
+                const size_t buffer_size =
+                    SharedVideoFrameHeader::computeVideoBufferSize(sharedFrameState->stride, sharedFrameState->height);
+
+                m_video_frame_scratch.resize(buffer_size);
+                memcpy(m_video_frame_scratch.data(), sharedFrameState->getSlotBuffer(slot_index), buffer_size);
+                std::atomic_thread_fence(std::memory_order_acquire);
+
+                // Only keep the copy if the server didn't touch the slot while it was being made
+                if (slot.sequence.load(std::memory_order_relaxed) == sequence)
+                {
+                    m_frame_width = sharedFrameState->width;
+                    m_frame_height = sharedFrameState->height;
+                    m_frame_stride = sharedFrameState->stride;
+                    m_video_frame_copy.swap(m_video_frame_scratch);
+                    m_video_frame_buffer = m_video_frame_copy.data();
+                    m_last_frame_index = latest_frame_index;
+
+                    bNewFrame = true;
+                }
             }
-
-            m_last_frame_index = sharedFrameState->frame_index;
-
-            bNewFrame = true;
         }
 
         return bNewFrame;
     }
 
-    void allocateVideoBuffer()
+    inline const unsigned char *getVideoFrameBuffer() const { return m_video_frame_buffer; }
+    inline int getVideoFrameWidth() const { return m_frame_width; }
+    inline int getVideoFrameHeight() const { return m_frame_height; }
+    inline int getVideoFrameStride() const { return m_frame_stride; }
+    inline int getLastVideoFrameIndex() const { return m_last_frame_index; }
+
+protected:
+    const SharedVideoFrameHeader *getFrameHeader() const
     {
-        size_t buffer_size = SharedVideoFrameHeader::computeVideoBufferSize(m_frame_stride, m_frame_height);
+        return reinterpret_cast<const SharedVideoFrameHeader *>(m_region->get_address());
+    }
+
+private:
+    char m_shared_memory_name[256];
+    boost::interprocess::shared_memory_object *m_shared_memory_object;
+    boost::interprocess::mapped_region *m_region;
+    std::vector<unsigned char> m_video_frame_copy;
+    std::vector<unsigned char> m_video_frame_scratch; // the copy being made, swapped in once validated
+    const unsigned char *m_video_frame_buffer; // points into m_video_frame_copy once a frame was read
+    int m_frame_width, m_frame_height, m_frame_stride;
+    int m_last_frame_index;
+};
 
-        if (buffer_size > 0)
+class SharedDevicePoseTableReadOnlyAccessor
+{
+public:
+    SharedDevicePoseTableReadOnlyAccessor()
+        : m_shared_memory_object(nullptr)
+        , m_region(nullptr)
+    {}
+
+    ~SharedDevicePoseTableReadOnlyAccessor()
+    {
+        dispose();
+    }
+
+    bool initialize()
+    {
+        bool bSuccess = false;
+
+        try
         {
-            // Allocate the buffer to copy the video frame into
-            m_bgr_frame_buffer = new unsigned char[buffer_size];
+            CLIENT_LOG_INFO("SharedDevicePoseTable::initialize()") << "Opening shared memory: " << SHARED_DEVICE_POSE_TABLE_NAME;
+
+            // Only exists when the service runs on this machine
+            m_shared_memory_object =
+                new boost::interprocess::shared_memory_object(
+                boost::interprocess::open_only,
+                SHARED_DEVICE_POSE_TABLE_NAME,
+                boost::interprocess::read_only);
+
+            // The service is the only writer
+            m_region = new boost::interprocess::mapped_region(*m_shared_memory_object, boost::interprocess::read_only);
+
+            if (m_region->get_size() < sizeof(SharedDevicePoseTable) ||
+                getTable()->version != SHARED_DEVICE_POSE_TABLE_VERSION)
+            {
+                dispose();
+                CLIENT_LOG_ERROR("SharedDevicePoseTable::initialize()") << "Shared memory layout doesn't match: " << SHARED_DEVICE_POSE_TABLE_NAME;
+            }
+            else
+            {
+                bSuccess = true;
+            }
         }
+        catch (boost::interprocess::interprocess_exception &ex)
+        {
+            dispose();
+            CLIENT_LOG_WARNING("SharedDevicePoseTable::initialize()") << "Failed to open shared memory: " << SHARED_DEVICE_POSE_TABLE_NAME
+                << ", reason: " << ex.what();
+        }
+
+        return bSuccess;
     }
 
-    void freeVideoBuffer()
+    void dispose()
     {
-        // free the video frame buffer
-        if (m_bgr_frame_buffer != nullptr)
+        if (m_region != nullptr)
+        {
+            delete m_region;
+            m_region = nullptr;
+        }
+
+        if (m_shared_memory_object != nullptr)
         {
-            delete[] m_bgr_frame_buffer;
-            m_bgr_frame_buffer = 0;
+            delete m_shared_memory_object;
+            m_shared_memory_object = nullptr;
         }
     }
 
-    inline const unsigned char *getVideoFrameBuffer() const { return m_bgr_frame_buffer; }
-    inline int getVideoFrameWidth() const { return m_frame_width; }
-    inline int getVideoFrameHeight() const { return m_frame_height; }
-    inline int getVideoFrameStride() const { return m_frame_stride; }
-    inline int getLastVideoFrameIndex() const { return m_last_frame_index; }
+    inline bool getIsOpen() const
+    {
+        return m_region != nullptr;
+    }
+
+    // Returns false if the controller entry was never written or the service kept writing into it
+    bool readControllerDataFrame(PSMControllerID controller_id, CompactControllerDataFrame &out_compact_frame) const
+    {
+        return
+            getIsOpen() &&
+            SharedDevicePoseTable::readEntry(getTable()->controllers[controller_id], out_compact_frame) &&
+            out_compact_frame.header.magic == COMPACT_DATA_FRAME_MAGIC &&
+            out_compact_frame.header.frame_size == sizeof(CompactControllerDataFrame) &&
+            out_compact_frame.controller_id == controller_id;
+    }
+
+    bool readHmdDataFrame(PSMHmdID hmd_id, CompactHMDDataFrame &out_compact_frame) const
+    {
+        return
+            getIsOpen() &&
+            SharedDevicePoseTable::readEntry(getTable()->hmds[hmd_id], out_compact_frame) &&
+            out_compact_frame.header.magic == COMPACT_DATA_FRAME_MAGIC &&
+            out_compact_frame.header.frame_size == sizeof(CompactHMDDataFrame) &&
+            out_compact_frame.hmd_id == hmd_id;
+    }
 
 protected:
-    SharedVideoFrameHeader *getFrameHeader()
+    const SharedDevicePoseTable *getTable() const
     {
-        return reinterpret_cast<SharedVideoFrameHeader *>(m_region->get_address());
+        return reinterpret_cast<const SharedDevicePoseTable *>(m_region->get_address());
     }
 
 private:
-    char m_shared_memory_name[256];
     boost::interprocess::shared_memory_object *m_shared_memory_object;
     boost::interprocess::mapped_region *m_region;
-    unsigned char *m_bgr_frame_buffer;
-    int m_frame_width, m_frame_height, m_frame_stride;
-    int m_last_frame_index;
 };
 
 // -- methods -----
@@ -214,6 +315,7 @@ PSMoveClient::PSMoveClient(
     const std::string &port)
     : m_request_manager(nullptr)  // ClientPSMoveAPIImpl::handle_response_message userdata
     , m_network_manager(nullptr) // IClientNetworkEventListener
+    , m_shared_pose_table(new SharedDevicePoseTableReadOnlyAccessor())
 	, m_bIsConnected(false)
 	, m_bHasConnectionStatusChanged(false)
 	, m_bHasControllerListChanged(false)
@@ -232,12 +334,16 @@ PSMoveClient::PSMoveClient(
 			this, // INotificationListener
 			m_request_manager, // IResponseListener
 			this); // IClientNetworkEventListener
+
+    memset(m_bControllerUsesSharedPoseTable, 0, sizeof(m_bControllerUsesSharedPoseTable));
+    memset(m_bHmdUsesSharedPoseTable, 0, sizeof(m_bHmdUsesSharedPoseTable));
 }
 
 PSMoveClient::~PSMoveClient()
 {
 	delete m_network_manager;
 	delete m_request_manager;
+    delete m_shared_pose_table;
 }
 
 // -- State Queries ----
@@ -360,6 +466,17 @@ void PSMoveClient::update()
 
     // Process incoming/outgoing networking requests
     m_network_manager->update();
+
+    // Pick up the latest state of the devices read out of the shared pose table
+    for (PSMControllerID controller_id= 0; controller_id < PSMOVESERVICE_MAX_CONTROLLER_COUNT; ++controller_id)
+    {
+        poll_shared_controller_pose(controller_id);
+    }
+
+    for (PSMHmdID hmd_id= 0; hmd_id < PSMOVESERVICE_MAX_HMD_COUNT; ++hmd_id)
+    {
+        poll_shared_hmd_pose(hmd_id);
+    }
 }
 
 void PSMoveClient::process_messages()
@@ -413,7 +530,7 @@ void PSMoveClient::publish()
 
 			if (bHasUnpublishedState)
 			{
-				DeviceInputDataFramePtr data_frame(new PSMoveProtocol::DeviceInputDataFrame);
+				PSMoveProtocol::DeviceInputDataFrame *data_frame= m_network_manager->allocate_device_data_frame();
 				data_frame->set_device_category(PSMoveProtocol::DeviceInputDataFrame_DeviceCategory_CONTROLLER);
 
 				auto *controller_data_packet= data_frame->mutable_controller_data_packet();
@@ -628,6 +745,11 @@ void PSMoveClient::shutdown()
 
     // No more pending requests
     m_pending_request_map.clear();
+
+    // Stop reading device state out of shared memory
+    memset(m_bControllerUsesSharedPoseTable, 0, sizeof(m_bControllerUsesSharedPoseTable));
+    memset(m_bHmdUsesSharedPoseTable, 0, sizeof(m_bHmdUsesSharedPoseTable));
+    m_shared_pose_table->dispose();
 }
 
 // -- System Requests ----
@@ -681,6 +803,7 @@ void PSMoveClient::free_controller_listener(PSMControllerID ControllerID)
 			memset(controller, 0, sizeof(PSMController));
 			controller->ControllerID= ControllerID;
 			controller->ControllerType= PSMController_None;
+			m_bControllerUsesSharedPoseTable[ControllerID]= false;
 		}
 	}
 }
@@ -750,6 +873,24 @@ PSMRequestID PSMoveClient::start_controller_data_stream(PSMControllerID controll
 			request->mutable_request_start_psmove_data_stream()->set_disable_roi(true);
 		}
 
+		if ((flags & PSMStreamFlags_useCompactDataFrames) > 0)
+		{
+			request->mutable_request_start_psmove_data_stream()->set_use_compact_data_frames(true);
+		}
+
+		// The stream started response tells whether the service honored it (see handle_stream_started_response)
+		if ((flags & PSMStreamFlags_useSharedMemoryPoseTable) > 0)
+		{
+			if (open_shared_pose_table())
+			{
+				request->mutable_request_start_psmove_data_stream()->set_use_shared_pose_table(true);
+			}
+			else
+			{
+				CLIENT_LOG_WARNING("start_controller_data_stream") << "shared pose table unavailable, streaming data frames for ControllerID: " << controller_id << std::endl;
+			}
+		}
+
 		m_request_manager->send_request(request);
 
 		requestID= request->request_id();
@@ -770,6 +911,7 @@ PSMRequestID PSMoveClient::stop_controller_data_stream(PSMControllerID controlle
 		RequestPtr request(new PSMoveProtocol::Request());
 		request->set_type(PSMoveProtocol::Request_RequestType_STOP_CONTROLLER_DATA_STREAM);
 		request->mutable_request_stop_psmove_data_stream()->set_controller_id(controller_id);
+		m_bControllerUsesSharedPoseTable[controller_id]= false;
 
 		m_request_manager->send_request(request);
 
@@ -1110,6 +1252,7 @@ void PSMoveClient::free_hmd_listener(PSMHmdID hmd_id)
             memset(hmd, 0, sizeof(PSMHeadMountedDisplay));
             hmd->HmdID= hmd_id;
             hmd->HmdType= PSMHmd_None;
+            m_bHmdUsesSharedPoseTable[hmd_id]= false;
         }
     }
 }
@@ -1174,6 +1317,24 @@ PSMRequestID PSMoveClient::start_hmd_data_stream(
 		request->mutable_request_start_hmd_data_stream()->set_disable_roi(true);
 	}
 
+	if ((flags & PSMStreamFlags_useCompactDataFrames) > 0)
+	{
+		request->mutable_request_start_hmd_data_stream()->set_use_compact_data_frames(true);
+	}
+
+	// The stream started response tells whether the service honored it (see handle_stream_started_response)
+	if ((flags & PSMStreamFlags_useSharedMemoryPoseTable) > 0)
+	{
+		if (open_shared_pose_table())
+		{
+			request->mutable_request_start_hmd_data_stream()->set_use_shared_pose_table(true);
+		}
+		else
+		{
+			CLIENT_LOG_WARNING("start_hmd_data_stream") << "shared pose table unavailable, streaming data frames for HmdID: " << hmd_id << std::endl;
+		}
+	}
+
     m_request_manager->send_request(request);
 
     return request->request_id();
@@ -1189,6 +1350,11 @@ PSMRequestID PSMoveClient::stop_hmd_data_stream(
     request->set_type(PSMoveProtocol::Request_RequestType_STOP_HMD_DATA_STREAM);
     request->mutable_request_stop_hmd_data_stream()->set_hmd_id(hmd_id);
 
+    if (IS_VALID_HMD_INDEX(hmd_id))
+    {
+        m_bHmdUsesSharedPoseTable[hmd_id]= false;
+    }
+
     m_request_manager->send_request(request);
 
     return request->request_id();
@@ -1208,6 +1374,39 @@ PSMRequestID PSMoveClient::set_hmd_data_stream_tracker_index(PSMHmdID hmd_id, PS
     return request->request_id();
 }
     
+void PSMoveClient::poll_shared_controller_pose(PSMControllerID controller_id)
+{
+    if (IS_VALID_CONTROLLER_INDEX(controller_id) && m_bControllerUsesSharedPoseTable[controller_id])
+    {
+        CompactControllerDataFrame compact_frame;
+
+        // Stale or half written entries are skipped, the view keeps the last state it got
+        if (m_shared_pose_table->readControllerDataFrame(controller_id, compact_frame))
+        {
+            applyCompactControllerDataFrame(compact_frame, &m_controllers[controller_id]);
+        }
+    }
+}
+
+void PSMoveClient::poll_shared_hmd_pose(PSMHmdID hmd_id)
+{
+    if (IS_VALID_HMD_INDEX(hmd_id) && m_bHmdUsesSharedPoseTable[hmd_id])
+    {
+        CompactHMDDataFrame compact_frame;
+
+        // Stale or half written entries are skipped, the view keeps the last state it got
+        if (m_shared_pose_table->readHmdDataFrame(hmd_id, compact_frame))
+        {
+            applyCompactHmdDataFrame(compact_frame, &m_HMDs[hmd_id]);
+        }
+    }
+}
+
+bool PSMoveClient::open_shared_pose_table()
+{
+    return m_shared_pose_table->getIsOpen() || m_shared_pose_table->initialize();
+}
+
 PSMRequestID PSMoveClient::send_opaque_request(
     PSMRequestHandle request_handle)
 {
@@ -1275,6 +1474,60 @@ void PSMoveClient::handle_data_frame(const PSMoveProtocol::DeviceOutputDataFrame
     }
 }
 
+void PSMoveClient::handle_compact_data_frame(const CompactDataFrameHeader *header)
+{
+    // The network manager has already checked that frame_size bytes were received.
+    // Copy the frame out of the receive buffer since the packed layout isn't aligned.
+    const uint8_t *frame_bytes= reinterpret_cast<const uint8_t *>(header);
+
+    switch (header->device_category)
+    {
+    case PSMoveProtocol::DeviceOutputDataFrame::CONTROLLER:
+        if (header->frame_size == sizeof(CompactControllerDataFrame))
+        {
+            CompactControllerDataFrame compact_frame;
+            memcpy(&compact_frame, frame_bytes, sizeof(CompactControllerDataFrame));
+
+			const PSMControllerID controller_id= compact_frame.controller_id;
+
+            CLIENT_LOG_TRACE("handle_compact_data_frame") 
+                << "received compact data frame for ControllerID: " 
+                << controller_id << std::endl;
+
+			if (IS_VALID_CONTROLLER_INDEX(controller_id))
+			{
+				PSMController *controller= get_controller_view(controller_id);
+
+				applyCompactControllerDataFrame(compact_frame, controller);
+			}
+        } break;
+    case PSMoveProtocol::DeviceOutputDataFrame::HMD:
+        if (header->frame_size == sizeof(CompactHMDDataFrame))
+        {
+            CompactHMDDataFrame compact_frame;
+            memcpy(&compact_frame, frame_bytes, sizeof(CompactHMDDataFrame));
+
+			const PSMHmdID hmd_id= compact_frame.hmd_id;
+
+            CLIENT_LOG_TRACE("handle_compact_data_frame")
+                << "received compact data frame for HmdID: "
+                << hmd_id << std::endl;
+
+			if (IS_VALID_HMD_INDEX(hmd_id))
+			{
+				PSMHeadMountedDisplay *hmd= get_hmd_view(hmd_id);
+
+				applyCompactHmdDataFrame(compact_frame, hmd);
+			}
+        } break;
+    default:
+        CLIENT_LOG_WARNING("handle_compact_data_frame")
+            << "Ignoring compact data frame for device category " 
+            << static_cast<int>(header->device_category) << std::endl;
+        break;
+    }
+}
+
 static void applyControllerDataFrame(
 	const PSMoveProtocol::DeviceOutputDataFrame_ControllerDataPacket& controller_packet, 
 	PSMController *controller)
@@ -1290,22 +1543,7 @@ static void applyControllerDataFrame(
     controller->IsConnected = controller_packet.isconnected();
 
     // Compute the data frame receive window statistics if we have received enough samples
-    {
-        long long now = 
-            std::chrono::duration_cast< std::chrono::milliseconds >(
-                std::chrono::system_clock::now().time_since_epoch()).count();
-        long long diff= now - controller->DataFrameLastReceivedTime;
-
-        if (diff > 0)
-        {
-            float seconds= static_cast<float>(diff) / 1000.f;
-            float fps= 1.f / seconds;
-
-            controller->DataFrameAverageFPS= (0.9f)*controller->DataFrameAverageFPS + (0.1f)*fps;
-        }
-
-        controller->DataFrameLastReceivedTime= now;
-    }
+    updateDataFrameReceiveStats(controller->DataFrameLastReceivedTime, controller->DataFrameAverageFPS);
    
 	// Don't bother updating the rest of the controller state if it's not connected
 	if (!controller->IsConnected)
@@ -1482,16 +1720,7 @@ static void applyPSMoveDataFrame(
 		memset(&psmove->RawTrackerData, 0, sizeof(PSMRawTrackerData));
 	}
 
-	unsigned int button_bitmask = controller_packet.button_down_bitmask();
-	applyPSMButtonState(psmove->TriangleButton, button_bitmask, PSMoveProtocol::DeviceOutputDataFrame_ControllerDataPacket_ButtonType_TRIANGLE);
-	applyPSMButtonState(psmove->CircleButton, button_bitmask, PSMoveProtocol::DeviceOutputDataFrame_ControllerDataPacket_ButtonType_CIRCLE);
-	applyPSMButtonState(psmove->CrossButton, button_bitmask, PSMoveProtocol::DeviceOutputDataFrame_ControllerDataPacket_ButtonType_CROSS);
-	applyPSMButtonState(psmove->SquareButton, button_bitmask, PSMoveProtocol::DeviceOutputDataFrame_ControllerDataPacket_ButtonType_SQUARE);
-	applyPSMButtonState(psmove->SelectButton, button_bitmask, PSMoveProtocol::DeviceOutputDataFrame_ControllerDataPacket_ButtonType_SELECT);
-	applyPSMButtonState(psmove->StartButton, button_bitmask, PSMoveProtocol::DeviceOutputDataFrame_ControllerDataPacket_ButtonType_START);
-	applyPSMButtonState(psmove->PSButton, button_bitmask, PSMoveProtocol::DeviceOutputDataFrame_ControllerDataPacket_ButtonType_PS);
-	applyPSMButtonState(psmove->MoveButton, button_bitmask, PSMoveProtocol::DeviceOutputDataFrame_ControllerDataPacket_ButtonType_MOVE);
-	applyPSMButtonState(psmove->TriggerButton, button_bitmask, PSMoveProtocol::DeviceOutputDataFrame_ControllerDataPacket_ButtonType_TRIGGER);
+	applyPSMoveButtonStates(controller_packet.button_down_bitmask(), psmove);
 
 	// Trigger value in range [0,255]
 	psmove->TriggerValue = static_cast<unsigned char>(psmove_packet.trigger_value());
@@ -1506,18 +1735,7 @@ static void applyPSNaviDataFrame(
 {
     const PSMoveProtocol::DeviceOutputDataFrame_ControllerDataPacket_PSNaviState &psnavi_packet= controller_packet.psnavi_state();
 
-    unsigned int button_bitmask= controller_packet.button_down_bitmask();
-    applyPSMButtonState(psnavi->L1Button, button_bitmask, PSMoveProtocol::DeviceOutputDataFrame_ControllerDataPacket_ButtonType_L1);
-    applyPSMButtonState(psnavi->L2Button, button_bitmask, PSMoveProtocol::DeviceOutputDataFrame_ControllerDataPacket_ButtonType_L2);
-    applyPSMButtonState(psnavi->L3Button, button_bitmask, PSMoveProtocol::DeviceOutputDataFrame_ControllerDataPacket_ButtonType_L3);
-    applyPSMButtonState(psnavi->CircleButton, button_bitmask, PSMoveProtocol::DeviceOutputDataFrame_ControllerDataPacket_ButtonType_CIRCLE);
-    applyPSMButtonState(psnavi->CrossButton, button_bitmask, PSMoveProtocol::DeviceOutputDataFrame_ControllerDataPacket_ButtonType_CROSS);
-    applyPSMButtonState(psnavi->PSButton, button_bitmask, PSMoveProtocol::DeviceOutputDataFrame_ControllerDataPacket_ButtonType_PS);
-    applyPSMButtonState(psnavi->TriggerButton, button_bitmask, PSMoveProtocol::DeviceOutputDataFrame_ControllerDataPacket_ButtonType_TRIGGER);
-    applyPSMButtonState(psnavi->DPadUpButton, button_bitmask, PSMoveProtocol::DeviceOutputDataFrame_ControllerDataPacket_ButtonType_UP);
-    applyPSMButtonState(psnavi->DPadRightButton, button_bitmask, PSMoveProtocol::DeviceOutputDataFrame_ControllerDataPacket_ButtonType_RIGHT);
-    applyPSMButtonState(psnavi->DPadDownButton, button_bitmask, PSMoveProtocol::DeviceOutputDataFrame_ControllerDataPacket_ButtonType_DOWN);
-    applyPSMButtonState(psnavi->DPadLeftButton, button_bitmask, PSMoveProtocol::DeviceOutputDataFrame_ControllerDataPacket_ButtonType_LEFT);
+    applyPSNaviButtonStates(controller_packet.button_down_bitmask(), psnavi);
 
     psnavi->TriggerValue= static_cast<unsigned char>(psnavi_packet.trigger_value());
     psnavi->Stick_XAxis= static_cast<unsigned char>(psnavi_packet.stick_xaxis());
@@ -1684,30 +1902,7 @@ static void applyDualShock4DataFrame(
 		memset(&ds4->RawTrackerData, 0, sizeof(PSMRawTrackerData));
 	}
 
-	unsigned int button_bitmask = controller_packet.button_down_bitmask();
-
-	applyPSMButtonState(ds4->DPadUpButton, button_bitmask, PSMoveProtocol::DeviceOutputDataFrame_ControllerDataPacket_ButtonType_UP);
-	applyPSMButtonState(ds4->DPadDownButton, button_bitmask, PSMoveProtocol::DeviceOutputDataFrame_ControllerDataPacket_ButtonType_DOWN);
-	applyPSMButtonState(ds4->DPadLeftButton, button_bitmask, PSMoveProtocol::DeviceOutputDataFrame_ControllerDataPacket_ButtonType_LEFT);
-	applyPSMButtonState(ds4->DPadRightButton, button_bitmask, PSMoveProtocol::DeviceOutputDataFrame_ControllerDataPacket_ButtonType_RIGHT);
-
-	applyPSMButtonState(ds4->L1Button, button_bitmask, PSMoveProtocol::DeviceOutputDataFrame_ControllerDataPacket_ButtonType_L1);
-	applyPSMButtonState(ds4->L2Button, button_bitmask, PSMoveProtocol::DeviceOutputDataFrame_ControllerDataPacket_ButtonType_L2);
-	applyPSMButtonState(ds4->L3Button, button_bitmask, PSMoveProtocol::DeviceOutputDataFrame_ControllerDataPacket_ButtonType_L3);
-	applyPSMButtonState(ds4->R1Button, button_bitmask, PSMoveProtocol::DeviceOutputDataFrame_ControllerDataPacket_ButtonType_R1);
-	applyPSMButtonState(ds4->R2Button, button_bitmask, PSMoveProtocol::DeviceOutputDataFrame_ControllerDataPacket_ButtonType_R2);
-	applyPSMButtonState(ds4->R3Button, button_bitmask, PSMoveProtocol::DeviceOutputDataFrame_ControllerDataPacket_ButtonType_R3);
-
-	applyPSMButtonState(ds4->TriangleButton, button_bitmask, PSMoveProtocol::DeviceOutputDataFrame_ControllerDataPacket_ButtonType_TRIANGLE);
-	applyPSMButtonState(ds4->CircleButton, button_bitmask, PSMoveProtocol::DeviceOutputDataFrame_ControllerDataPacket_ButtonType_CIRCLE);
-	applyPSMButtonState(ds4->CrossButton, button_bitmask, PSMoveProtocol::DeviceOutputDataFrame_ControllerDataPacket_ButtonType_CROSS);
-	applyPSMButtonState(ds4->SquareButton, button_bitmask, PSMoveProtocol::DeviceOutputDataFrame_ControllerDataPacket_ButtonType_SQUARE);
-
-	applyPSMButtonState(ds4->ShareButton, button_bitmask, PSMoveProtocol::DeviceOutputDataFrame_ControllerDataPacket_ButtonType_SHARE);
-	applyPSMButtonState(ds4->OptionsButton, button_bitmask, PSMoveProtocol::DeviceOutputDataFrame_ControllerDataPacket_ButtonType_OPTIONS);
-
-	applyPSMButtonState(ds4->PSButton, button_bitmask, PSMoveProtocol::DeviceOutputDataFrame_ControllerDataPacket_ButtonType_PS);
-	applyPSMButtonState(ds4->TrackPadButton, button_bitmask, PSMoveProtocol::DeviceOutputDataFrame_ControllerDataPacket_ButtonType_TRACKPAD);
+	applyDualShock4ButtonStates(controller_packet.button_down_bitmask(), ds4);
 
     ds4->LeftAnalogX = ds4_packet.left_thumbstick_x();
     ds4->LeftAnalogY = ds4_packet.left_thumbstick_y();
@@ -1742,12 +1937,7 @@ static void applyVirtualControllerDataFrame(
     virtual_controller->numAxes = virtual_controller_packet.axisstates_size();
     virtual_controller->numButtons = virtual_controller_packet.numbuttons();
 
-    unsigned int button_bitmask = controller_packet.button_down_bitmask();
-    memset(virtual_controller->buttonStates, PSMButtonState_UP, sizeof(virtual_controller->buttonStates));
-    for (int button_index = 0; button_index < virtual_controller->numButtons; ++button_index)
-    {
-    	applyPSMButtonState(virtual_controller->buttonStates[button_index], button_bitmask, button_index);
-    }
+    applyVirtualControllerButtonStates(controller_packet.button_down_bitmask(), virtual_controller);
 
     memset(virtual_controller->axisStates, 0x7f, sizeof(virtual_controller->axisStates));
     for (int axis_index = 0; axis_index < virtual_controller->numAxes; ++axis_index)
@@ -1830,6 +2020,97 @@ static void applyVirtualControllerDataFrame(
 	}
 }
 
+static void applyPSMoveButtonStates(
+	const unsigned int button_bitmask,
+	PSMPSMove *psmove)
+{
+	applyPSMButtonState(psmove->TriangleButton, button_bitmask, PSMoveProtocol::DeviceOutputDataFrame_ControllerDataPacket_ButtonType_TRIANGLE);
+	applyPSMButtonState(psmove->CircleButton, button_bitmask, PSMoveProtocol::DeviceOutputDataFrame_ControllerDataPacket_ButtonType_CIRCLE);
+	applyPSMButtonState(psmove->CrossButton, button_bitmask, PSMoveProtocol::DeviceOutputDataFrame_ControllerDataPacket_ButtonType_CROSS);
+	applyPSMButtonState(psmove->SquareButton, button_bitmask, PSMoveProtocol::DeviceOutputDataFrame_ControllerDataPacket_ButtonType_SQUARE);
+	applyPSMButtonState(psmove->SelectButton, button_bitmask, PSMoveProtocol::DeviceOutputDataFrame_ControllerDataPacket_ButtonType_SELECT);
+	applyPSMButtonState(psmove->StartButton, button_bitmask, PSMoveProtocol::DeviceOutputDataFrame_ControllerDataPacket_ButtonType_START);
+	applyPSMButtonState(psmove->PSButton, button_bitmask, PSMoveProtocol::DeviceOutputDataFrame_ControllerDataPacket_ButtonType_PS);
+	applyPSMButtonState(psmove->MoveButton, button_bitmask, PSMoveProtocol::DeviceOutputDataFrame_ControllerDataPacket_ButtonType_MOVE);
+	applyPSMButtonState(psmove->TriggerButton, button_bitmask, PSMoveProtocol::DeviceOutputDataFrame_ControllerDataPacket_ButtonType_TRIGGER);
+}
+
+static void applyPSNaviButtonStates(
+	const unsigned int button_bitmask,
+	PSMPSNavi *psnavi)
+{
+    applyPSMButtonState(psnavi->L1Button, button_bitmask, PSMoveProtocol::DeviceOutputDataFrame_ControllerDataPacket_ButtonType_L1);
+    applyPSMButtonState(psnavi->L2Button, button_bitmask, PSMoveProtocol::DeviceOutputDataFrame_ControllerDataPacket_ButtonType_L2);
+    applyPSMButtonState(psnavi->L3Button, button_bitmask, PSMoveProtocol::DeviceOutputDataFrame_ControllerDataPacket_ButtonType_L3);
+    applyPSMButtonState(psnavi->CircleButton, button_bitmask, PSMoveProtocol::DeviceOutputDataFrame_ControllerDataPacket_ButtonType_CIRCLE);
+    applyPSMButtonState(psnavi->CrossButton, button_bitmask, PSMoveProtocol::DeviceOutputDataFrame_ControllerDataPacket_ButtonType_CROSS);
+    applyPSMButtonState(psnavi->PSButton, button_bitmask, PSMoveProtocol::DeviceOutputDataFrame_ControllerDataPacket_ButtonType_PS);
+    applyPSMButtonState(psnavi->TriggerButton, button_bitmask, PSMoveProtocol::DeviceOutputDataFrame_ControllerDataPacket_ButtonType_TRIGGER);
+    applyPSMButtonState(psnavi->DPadUpButton, button_bitmask, PSMoveProtocol::DeviceOutputDataFrame_ControllerDataPacket_ButtonType_UP);
+    applyPSMButtonState(psnavi->DPadRightButton, button_bitmask, PSMoveProtocol::DeviceOutputDataFrame_ControllerDataPacket_ButtonType_RIGHT);
+    applyPSMButtonState(psnavi->DPadDownButton, button_bitmask, PSMoveProtocol::DeviceOutputDataFrame_ControllerDataPacket_ButtonType_DOWN);
+    applyPSMButtonState(psnavi->DPadLeftButton, button_bitmask, PSMoveProtocol::DeviceOutputDataFrame_ControllerDataPacket_ButtonType_LEFT);
+}
+
+static void applyDualShock4ButtonStates(
+	const unsigned int button_bitmask,
+	PSMDualShock4 *ds4)
+{
+	applyPSMButtonState(ds4->DPadUpButton, button_bitmask, PSMoveProtocol::DeviceOutputDataFrame_ControllerDataPacket_ButtonType_UP);
+	applyPSMButtonState(ds4->DPadDownButton, button_bitmask, PSMoveProtocol::DeviceOutputDataFrame_ControllerDataPacket_ButtonType_DOWN);
+	applyPSMButtonState(ds4->DPadLeftButton, button_bitmask, PSMoveProtocol::DeviceOutputDataFrame_ControllerDataPacket_ButtonType_LEFT);
+	applyPSMButtonState(ds4->DPadRightButton, button_bitmask, PSMoveProtocol::DeviceOutputDataFrame_ControllerDataPacket_ButtonType_RIGHT);
+
+	applyPSMButtonState(ds4->L1Button, button_bitmask, PSMoveProtocol::DeviceOutputDataFrame_ControllerDataPacket_ButtonType_L1);
+	applyPSMButtonState(ds4->L2Button, button_bitmask, PSMoveProtocol::DeviceOutputDataFrame_ControllerDataPacket_ButtonType_L2);
+	applyPSMButtonState(ds4->L3Button, button_bitmask, PSMoveProtocol::DeviceOutputDataFrame_ControllerDataPacket_ButtonType_L3);
+	applyPSMButtonState(ds4->R1Button, button_bitmask, PSMoveProtocol::DeviceOutputDataFrame_ControllerDataPacket_ButtonType_R1);
+	applyPSMButtonState(ds4->R2Button, button_bitmask, PSMoveProtocol::DeviceOutputDataFrame_ControllerDataPacket_ButtonType_R2);
+	applyPSMButtonState(ds4->R3Button, button_bitmask, PSMoveProtocol::DeviceOutputDataFrame_ControllerDataPacket_ButtonType_R3);
+
+	applyPSMButtonState(ds4->TriangleButton, button_bitmask, PSMoveProtocol::DeviceOutputDataFrame_ControllerDataPacket_ButtonType_TRIANGLE);
+	applyPSMButtonState(ds4->CircleButton, button_bitmask, PSMoveProtocol::DeviceOutputDataFrame_ControllerDataPacket_ButtonType_CIRCLE);
+	applyPSMButtonState(ds4->CrossButton, button_bitmask, PSMoveProtocol::DeviceOutputDataFrame_ControllerDataPacket_ButtonType_CROSS);
+	applyPSMButtonState(ds4->SquareButton, button_bitmask, PSMoveProtocol::DeviceOutputDataFrame_ControllerDataPacket_ButtonType_SQUARE);
+
+	applyPSMButtonState(ds4->ShareButton, button_bitmask, PSMoveProtocol::DeviceOutputDataFrame_ControllerDataPacket_ButtonType_SHARE);
+	applyPSMButtonState(ds4->OptionsButton, button_bitmask, PSMoveProtocol::DeviceOutputDataFrame_ControllerDataPacket_ButtonType_OPTIONS);
+
+	applyPSMButtonState(ds4->PSButton, button_bitmask, PSMoveProtocol::DeviceOutputDataFrame_ControllerDataPacket_ButtonType_PS);
+	applyPSMButtonState(ds4->TrackPadButton, button_bitmask, PSMoveProtocol::DeviceOutputDataFrame_ControllerDataPacket_ButtonType_TRACKPAD);
+}
+
+static void applyVirtualControllerButtonStates(
+    const unsigned int button_bitmask,
+    PSMVirtualController *virtual_controller)
+{
+    memset(virtual_controller->buttonStates, PSMButtonState_UP, sizeof(virtual_controller->buttonStates));
+    for (int button_index = 0; button_index < virtual_controller->numButtons; ++button_index)
+    {
+    	applyPSMButtonState(virtual_controller->buttonStates[button_index], button_bitmask, button_index);
+    }
+}
+
+static void updateDataFrameReceiveStats(
+    long long &data_frame_last_received_time,
+    float &data_frame_average_fps)
+{
+    long long now = 
+        std::chrono::duration_cast< std::chrono::milliseconds >(
+            std::chrono::system_clock::now().time_since_epoch()).count();
+    long long diff= now - data_frame_last_received_time;
+
+    if (diff > 0)
+    {
+        float seconds= static_cast<float>(diff) / 1000.f;
+        float fps= 1.f / seconds;
+
+        data_frame_average_fps= (0.9f)*data_frame_average_fps + (0.1f)*fps;
+    }
+
+    data_frame_last_received_time= now;
+}
+
 static void applyPSMButtonState(
     PSMButtonState &button,
     unsigned int button_bitmask,
@@ -1900,22 +2181,7 @@ static void applyHmdDataFrame(
     hmd->IsConnected = hmd_packet.isconnected();
 
     // Compute the data frame receive window statistics if we have received enough samples
-    {
-        long long now = 
-            std::chrono::duration_cast< std::chrono::milliseconds >(
-                std::chrono::system_clock::now().time_since_epoch()).count();
-        long long diff= now - hmd->DataFrameLastReceivedTime;
-
-        if (diff > 0)
-        {
-            float seconds= static_cast<float>(diff) / 1000.f;
-            float fps= 1.f / seconds;
-
-            hmd->DataFrameAverageFPS= (0.9f)*hmd->DataFrameAverageFPS + (0.1f)*fps;
-        }
-
-        hmd->DataFrameLastReceivedTime= now;
-    }
+    updateDataFrameReceiveStats(hmd->DataFrameLastReceivedTime, hmd->DataFrameAverageFPS);
 
 	// Don't bother updating the rest of the hmd state if it's not connected
 	if (!hmd->IsConnected)
@@ -2136,6 +2402,257 @@ static void applyVirtualHMDDataFrame(
 	}
 }
 
+static void applyCompactControllerDataFrame(
+	const CompactControllerDataFrame &compact_frame,
+	PSMController *controller)
+{
+	// Ignore old packets
+	if (compact_frame.sequence_num <= controller->OutputSequenceNum)
+		return;
+
+    // Set the generic items
+    controller->bValid = compact_frame.controller_id != -1;
+    controller->ControllerType = static_cast<PSMControllerType>(compact_frame.controller_type);
+    controller->OutputSequenceNum = compact_frame.sequence_num;
+    controller->IsConnected = (compact_frame.flags & CompactDataFrameFlag_IsConnected) != 0;
+
+    // Compute the data frame receive window statistics if we have received enough samples
+    updateDataFrameReceiveStats(controller->DataFrameLastReceivedTime, controller->DataFrameAverageFPS);
+
+	// Don't bother updating the rest of the controller state if it's not connected
+	if (!controller->IsConnected)
+		return;
+
+    switch (controller->ControllerType) 
+	{
+        case PSMController_Move:
+			applyCompactPSMoveDataFrame(compact_frame, &controller->ControllerState.PSMoveState);
+            break;
+            
+        case PSMController_Navi:		
+			applyCompactPSNaviDataFrame(compact_frame, &controller->ControllerState.PSNaviState);
+            break;
+
+        case PSMController_DualShock4:
+			applyCompactDualShock4DataFrame(compact_frame, &controller->ControllerState.PSDS4State);            
+            break;
+
+        case PSMController_Virtual:
+			applyCompactVirtualControllerDataFrame(compact_frame, &controller->ControllerState.VirtualController);
+            break;
+        default:
+            break;
+    }
+}
+
+static void applyCompactPSMoveDataFrame(
+	const CompactControllerDataFrame &compact_frame,
+	PSMPSMove *psmove)
+{
+	const uint32_t flags= compact_frame.flags;
+
+    psmove->bHasValidHardwareCalibration = (flags & CompactDataFrameFlag_HasValidHardwareCalibration) != 0;
+    psmove->bIsTrackingEnabled = (flags & CompactDataFrameFlag_IsTrackingEnabled) != 0;
+    psmove->bIsCurrentlyTracking = (flags & CompactDataFrameFlag_IsCurrentlyTracking) != 0;
+	psmove->bIsOrientationValid = (flags & CompactDataFrameFlag_IsOrientationValid) != 0;
+	psmove->bIsPositionValid = (flags & CompactDataFrameFlag_IsPositionValid) != 0;
+
+	applyCompactPose(compact_frame.pose, psmove->Pose);
+	applyCompactPhysicsData(compact_frame.physics, flags, psmove->PhysicsData);
+
+	// Compact data frames never carry the sensor or tracker debug data
+	memset(&psmove->RawSensorData, 0, sizeof(PSMPSMoveRawSensorData));
+	memset(&psmove->CalibratedSensorData, 0, sizeof(PSMPSMoveCalibratedSensorData));
+	memset(&psmove->RawTrackerData, 0, sizeof(PSMRawTrackerData));
+
+	applyPSMoveButtonStates(compact_frame.button_down_bitmask, psmove);
+
+	// Trigger value in range [0,255]
+	psmove->TriggerValue = compact_frame.psmove_state.trigger_value;
+
+	// Battery level range [0, 5] - EE charging & EF full
+	psmove->BatteryValue = static_cast<PSMBatteryState>(compact_frame.psmove_state.battery_value);
+}
+
+static void applyCompactPSNaviDataFrame(
+	const CompactControllerDataFrame &compact_frame,
+	PSMPSNavi *psnavi)
+{
+    applyPSNaviButtonStates(compact_frame.button_down_bitmask, psnavi);
+
+    psnavi->TriggerValue= compact_frame.psnavi_state.trigger_value;
+    psnavi->Stick_XAxis= compact_frame.psnavi_state.stick_xaxis;
+    psnavi->Stick_YAxis= compact_frame.psnavi_state.stick_yaxis;
+}
+
+static void applyCompactDualShock4DataFrame(
+	const CompactControllerDataFrame &compact_frame,
+	PSMDualShock4 *ds4)
+{
+	const uint32_t flags= compact_frame.flags;
+	const CompactPSDualShock4State &ds4_state= compact_frame.psdualshock4_state;
+
+    ds4->bHasValidHardwareCalibration = (flags & CompactDataFrameFlag_HasValidHardwareCalibration) != 0;
+    ds4->bIsTrackingEnabled = (flags & CompactDataFrameFlag_IsTrackingEnabled) != 0;
+    ds4->bIsCurrentlyTracking = (flags & CompactDataFrameFlag_IsCurrentlyTracking) != 0;
+	ds4->bIsOrientationValid = (flags & CompactDataFrameFlag_IsOrientationValid) != 0;
+	ds4->bIsPositionValid = (flags & CompactDataFrameFlag_IsPositionValid) != 0;
+
+	applyCompactPose(compact_frame.pose, ds4->Pose);
+	applyCompactPhysicsData(compact_frame.physics, flags, ds4->PhysicsData);
+
+	// Compact data frames never carry the sensor or tracker debug data
+	memset(&ds4->RawSensorData, 0, sizeof(PSMDS4RawSensorData));
+	memset(&ds4->CalibratedSensorData, 0, sizeof(PSMDS4CalibratedSensorData));
+	memset(&ds4->RawTrackerData, 0, sizeof(PSMRawTrackerData));
+
+	applyDualShock4ButtonStates(compact_frame.button_down_bitmask, ds4);
+
+    ds4->LeftAnalogX = ds4_state.left_thumbstick_x;
+    ds4->LeftAnalogY = ds4_state.left_thumbstick_y;
+    ds4->RightAnalogX = ds4_state.right_thumbstick_x;
+    ds4->RightAnalogY = ds4_state.right_thumbstick_y;
+    ds4->LeftTriggerValue = ds4_state.left_trigger_value;
+    ds4->RightTriggerValue = ds4_state.right_trigger_value;
+}
+
+static void applyCompactVirtualControllerDataFrame(
+	const CompactControllerDataFrame &compact_frame,
+	PSMVirtualController *virtual_controller)
+{
+	const uint32_t flags= compact_frame.flags;
+	const CompactVirtualControllerState &virtual_controller_state= compact_frame.virtual_controller_state;
+
+    virtual_controller->bIsTrackingEnabled = (flags & CompactDataFrameFlag_IsTrackingEnabled) != 0;
+    virtual_controller->bIsCurrentlyTracking = (flags & CompactDataFrameFlag_IsCurrentlyTracking) != 0;
+	virtual_controller->bIsPositionValid = (flags & CompactDataFrameFlag_IsPositionValid) != 0;
+
+	// The service sends the identity orientation for virtual controllers
+	applyCompactPose(compact_frame.pose, virtual_controller->Pose);
+	applyCompactPhysicsData(compact_frame.physics, flags, virtual_controller->PhysicsData);
+	memset(&virtual_controller->RawTrackerData, 0, sizeof(PSMRawTrackerData));
+
+    virtual_controller->vendorID= virtual_controller_state.vendor_id;
+    virtual_controller->productID= virtual_controller_state.product_id;
+
+    virtual_controller->numAxes = std::min<int>(virtual_controller_state.num_axes, PSM_MAX_VIRTUAL_CONTROLLER_AXES);
+    virtual_controller->numButtons = virtual_controller_state.num_buttons;
+
+    applyVirtualControllerButtonStates(compact_frame.button_down_bitmask, virtual_controller);
+
+    memset(virtual_controller->axisStates, 0x7f, sizeof(virtual_controller->axisStates));
+    memcpy(virtual_controller->axisStates, virtual_controller_state.axis_states, virtual_controller->numAxes);
+}
+
+static void applyCompactHmdDataFrame(
+	const CompactHMDDataFrame &compact_frame,
+	PSMHeadMountedDisplay *hmd)
+{
+	// Ignore old packets
+	if (compact_frame.sequence_num <= hmd->OutputSequenceNum)
+		return;
+
+    // Set the generic items
+    hmd->bValid = compact_frame.hmd_id != -1;
+    hmd->HmdType = static_cast<PSMHmdType>(compact_frame.hmd_type);
+    hmd->OutputSequenceNum = compact_frame.sequence_num;
+    hmd->IsConnected = (compact_frame.flags & CompactDataFrameFlag_IsConnected) != 0;
+
+    // Compute the data frame receive window statistics if we have received enough samples
+    updateDataFrameReceiveStats(hmd->DataFrameLastReceivedTime, hmd->DataFrameAverageFPS);
+
+	// Don't bother updating the rest of the hmd state if it's not connected
+	if (!hmd->IsConnected)
+		return;
+
+    switch (hmd->HmdType) 
+	{
+        case PSMHmd_Morpheus:
+			applyCompactMorpheusDataFrame(compact_frame, &hmd->HmdState.MorpheusState);
+            break;
+        case PSMHmd_Virtual:
+			applyCompactVirtualHMDDataFrame(compact_frame, &hmd->HmdState.VirtualHMDState);
+            break;            
+        default:
+            break;
+    }
+}
+
+static void applyCompactMorpheusDataFrame(
+	const CompactHMDDataFrame &compact_frame,
+	PSMMorpheus *morpheus)
+{
+	const uint32_t flags= compact_frame.flags;
+
+	morpheus->bIsTrackingEnabled = (flags & CompactDataFrameFlag_IsTrackingEnabled) != 0;
+	morpheus->bIsCurrentlyTracking = (flags & CompactDataFrameFlag_IsCurrentlyTracking) != 0;
+	morpheus->bIsOrientationValid = (flags & CompactDataFrameFlag_IsOrientationValid) != 0;
+	morpheus->bIsPositionValid = (flags & CompactDataFrameFlag_IsPositionValid) != 0;
+
+	applyCompactPose(compact_frame.pose, morpheus->Pose);
+	applyCompactPhysicsData(compact_frame.physics, flags, morpheus->PhysicsData);
+
+	// Compact data frames never carry the sensor or tracker debug data
+	memset(&morpheus->RawSensorData, 0, sizeof(PSMMorpheusRawSensorData));
+	memset(&morpheus->CalibratedSensorData, 0, sizeof(PSMMorpheusCalibratedSensorData));
+	memset(&morpheus->RawTrackerData, 0, sizeof(PSMRawTrackerData));
+}
+
+static void applyCompactVirtualHMDDataFrame(
+	const CompactHMDDataFrame &compact_frame,
+	PSMVirtualHMD *virtualHMD)
+{
+	const uint32_t flags= compact_frame.flags;
+
+	virtualHMD->bIsTrackingEnabled = (flags & CompactDataFrameFlag_IsTrackingEnabled) != 0;
+	virtualHMD->bIsCurrentlyTracking = (flags & CompactDataFrameFlag_IsCurrentlyTracking) != 0;
+	virtualHMD->bIsPositionValid = (flags & CompactDataFrameFlag_IsPositionValid) != 0;
+
+	// The service sends the identity orientation for virtual HMDs
+	applyCompactPose(compact_frame.pose, virtualHMD->Pose);
+	applyCompactPhysicsData(compact_frame.physics, flags, virtualHMD->PhysicsData);
+	memset(&virtualHMD->RawTrackerData, 0, sizeof(PSMRawTrackerData));
+}
+
+static void applyCompactPose(
+	const CompactPoseData &compact_pose,
+	PSMPosef &pose)
+{
+	pose.Position.x= compact_pose.position_cm[0];
+	pose.Position.y= compact_pose.position_cm[1];
+	pose.Position.z= compact_pose.position_cm[2];
+
+	pose.Orientation.w= compact_pose.orientation[0];
+	pose.Orientation.x= compact_pose.orientation[1];
+	pose.Orientation.y= compact_pose.orientation[2];
+	pose.Orientation.z= compact_pose.orientation[3];
+}
+
+static void applyCompactPhysicsData(
+	const CompactPhysicsData &compact_physics,
+	const uint32_t flags,
+	PSMPhysicsData &physics_data)
+{
+	if ((flags & CompactDataFrameFlag_HasPhysicsData) != 0)
+	{
+		physics_data.LinearVelocityCmPerSec= 
+			{compact_physics.velocity_cm_per_sec[0], compact_physics.velocity_cm_per_sec[1], compact_physics.velocity_cm_per_sec[2]};
+		physics_data.LinearAccelerationCmPerSecSqr= 
+			{compact_physics.acceleration_cm_per_sec_sqr[0], compact_physics.acceleration_cm_per_sec_sqr[1], compact_physics.acceleration_cm_per_sec_sqr[2]};
+		physics_data.AngularVelocityRadPerSec= 
+			{compact_physics.angular_velocity_rad_per_sec[0], compact_physics.angular_velocity_rad_per_sec[1], compact_physics.angular_velocity_rad_per_sec[2]};
+		physics_data.AngularAccelerationRadPerSecSqr= 
+			{compact_physics.angular_acceleration_rad_per_sec_sqr[0], compact_physics.angular_acceleration_rad_per_sec_sqr[1], compact_physics.angular_acceleration_rad_per_sec_sqr[2]};
+
+		//###HipsterSloth $TODO - pass down the physics data timestamp
+		physics_data.TimeInSeconds= -1.0;
+	}
+	else
+	{
+		memset(&physics_data, 0, sizeof(PSMPhysicsData));
+	}
+}
+
 // INotificationListener
 void PSMoveClient::handle_notification(ResponsePtr notification)
 {
@@ -2204,6 +2721,8 @@ void PSMoveClient::handle_response_message(
 
     if (response_message->request_id != PSM_INVALID_REQUEST_ID)
     {
+        this_ptr->handle_stream_started_response(response_message);
+
         // If there is a callback waiting to be called for this request,
         // then go ahead and execute it now.
         if (!this_ptr->execute_callback(response_message))
@@ -2217,6 +2736,48 @@ void PSMoveClient::handle_response_message(
 
 // Message Helpers
 //-----------------
+void PSMoveClient::handle_stream_started_response(
+    const PSMResponseMessage *response_message)
+{
+    if (response_message->result_code != PSMResult_Success)
+        return;
+
+    const PSMoveProtocol::Request *request= 
+        reinterpret_cast<const PSMoveProtocol::Request *>(response_message->opaque_request_handle);
+    const PSMoveProtocol::Response *response= 
+        reinterpret_cast<const PSMoveProtocol::Response *>(response_message->opaque_response_handle);
+
+    // Only read a device out of the local shared pose table once the service confirmed 
+    // that it publishes the device there for this connection (it only does for local clients)
+    switch (response->type())
+    {
+    case PSMoveProtocol::Response_ResponseType_CONTROLLER_STREAM_STARTED:
+        {
+            const PSMControllerID controller_id= request->request_start_psmove_data_stream().controller_id();
+
+            if (IS_VALID_CONTROLLER_INDEX(controller_id))
+            {
+                m_bControllerUsesSharedPoseTable[controller_id]= 
+                    response->result_controller_stream_started().use_shared_pose_table() && 
+                    m_shared_pose_table->getIsOpen();
+            }
+        } break;
+    case PSMoveProtocol::Response_ResponseType_HMD_STREAM_STARTED:
+        {
+            const PSMHmdID hmd_id= request->request_start_hmd_data_stream().hmd_id();
+
+            if (IS_VALID_HMD_INDEX(hmd_id))
+            {
+                m_bHmdUsesSharedPoseTable[hmd_id]= 
+                    response->result_hmd_stream_started().use_shared_pose_table() && 
+                    m_shared_pose_table->getIsOpen();
+            }
+        } break;
+    default:
+        break;
+    }
+}
+
 void PSMoveClient::process_event_message(
 	const PSMEventMessage *event_message)
 {
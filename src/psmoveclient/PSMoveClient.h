@@ -75,6 +75,10 @@ public:
     PSMRequestID start_hmd_data_stream(PSMHmdID hmd_id, unsigned int flags);
     PSMRequestID stop_hmd_data_stream(PSMHmdID hmd_id);
     PSMRequestID set_hmd_data_stream_tracker_index(PSMHmdID hmd_id, PSMTrackerID tracker_id);
+
+    // Refresh a device view from the shared pose table, if its stream was started with PSMStreamFlags_useSharedMemoryPoseTable
+    void poll_shared_controller_pose(PSMControllerID controller_id);
+    void poll_shared_hmd_pose(PSMHmdID hmd_id);
     
     PSMRequestID send_opaque_request(PSMRequestHandle request_handle);
 
@@ -84,9 +88,11 @@ public:
     
 protected:
     void publish();
+    bool open_shared_pose_table();
 
     // IDataFrameListener
     virtual void handle_data_frame(const PSMoveProtocol::DeviceOutputDataFrame *data_frame) override;
+    virtual void handle_compact_data_frame(const CompactDataFrameHeader *header) override;
 
     // INotificationListener
     virtual void handle_notification(ResponsePtr notification) override;
@@ -103,6 +109,7 @@ protected:
 
     // Message Helpers
     //-----------------
+    void handle_stream_started_response(const PSMResponseMessage *response_message);
 	void process_event_message(const PSMEventMessage *event_message);
     void enqueue_event_message(PSMEventMessage::eEventType event_type, ResponsePtr event);
     bool execute_callback(const PSMResponseMessage *response_message);
@@ -115,6 +122,11 @@ private:
     //-- Session Management -----
     class ClientNetworkManager *m_network_manager;
     
+    //-- Shared Pose Table -----
+    class SharedDevicePoseTableReadOnlyAccessor *m_shared_pose_table;
+    bool m_bControllerUsesSharedPoseTable[PSMOVESERVICE_MAX_CONTROLLER_COUNT];
+    bool m_bHmdUsesSharedPoseTable[PSMOVESERVICE_MAX_HMD_COUNT];
+
     //-- Controller Views -----
 	PSMController m_controllers[PSMOVESERVICE_MAX_CONTROLLER_COUNT];
 
@@ -622,6 +622,8 @@ PSMResult PSM_GetControllerOrientation(PSMControllerID controller_id, PSMQuatf *
 
     if (g_psm_client != nullptr && IS_VALID_CONTROLLER_INDEX(controller_id))
     {
+        g_psm_client->poll_shared_controller_pose(controller_id);
+
         PSMController *controller= g_psm_client->get_controller_view(controller_id);
         
         switch (controller->ControllerType)
@@ -657,6 +659,8 @@ PSMResult PSM_GetControllerPosition(PSMControllerID controller_id, PSMVector3f *
 
     if (g_psm_client != nullptr && IS_VALID_CONTROLLER_INDEX(controller_id))
     {
+        g_psm_client->poll_shared_controller_pose(controller_id);
+
         PSMController *controller= g_psm_client->get_controller_view(controller_id);
         
         switch (controller->ControllerType)
@@ -697,6 +701,8 @@ PSMResult PSM_GetControllerPose(PSMControllerID controller_id, PSMPosef *out_pos
 
     if (g_psm_client != nullptr && IS_VALID_CONTROLLER_INDEX(controller_id))
     {
+        g_psm_client->poll_shared_controller_pose(controller_id);
+
         PSMController *controller= g_psm_client->get_controller_view(controller_id);
         
         switch (controller->ControllerType)
@@ -1365,6 +1371,8 @@ PSMResult PSM_GetHmdOrientation(PSMHmdID hmd_id, PSMQuatf *out_orientation)
 
     if (g_psm_client != nullptr && IS_VALID_HMD_INDEX(hmd_id))
     {		
+        g_psm_client->poll_shared_hmd_pose(hmd_id);
+
         PSMHeadMountedDisplay *hmd= g_psm_client->get_hmd_view(hmd_id);
         
         switch (hmd->HmdType)
@@ -1393,6 +1401,8 @@ PSMResult PSM_GetHmdPosition(PSMHmdID hmd_id, PSMVector3f *out_position)
 
     if (g_psm_client != nullptr && IS_VALID_HMD_INDEX(hmd_id))
     {
+        g_psm_client->poll_shared_hmd_pose(hmd_id);
+
         PSMHeadMountedDisplay *hmd= g_psm_client->get_hmd_view(hmd_id);
         
         switch (hmd->HmdType)
@@ -1424,6 +1434,8 @@ PSMResult PSM_GetHmdPose(PSMHmdID hmd_id, PSMPosef *out_pose)
 
     if (g_psm_client != nullptr && IS_VALID_HMD_INDEX(hmd_id))
     {
+        g_psm_client->poll_shared_hmd_pose(hmd_id);
+
         PSMHeadMountedDisplay *hmd= g_psm_client->get_hmd_view(hmd_id);
         
         switch (hmd->HmdType)
@@ -111,6 +111,8 @@ typedef enum
 	PSMStreamFlags_includeCalibratedSensorData = 0x08,	///< Add calibrated IMU sensor state
     PSMStreamFlags_includeRawTrackerData = 0x10,		///< Add raw optical tracking projection info
 	PSMStreamFlags_disableROI = 0x20,					///< Disable Region-of-Interest tracking optimization
+	PSMStreamFlags_useCompactDataFrames = 0x40,		///< Stream pose and button state in the fixed layout compact data frame (no raw sensor or raw tracker data)
+	PSMStreamFlags_useSharedMemoryPoseTable = 0x80,	///< Read pose, physics and button state from the service's shared memory pose table (local clients only, falls back to the data stream)
 } PSMControllerDataStreamFlags;
 
 /// The possible rumble channels available to the comtrollers
@@ -923,6 +925,8 @@ PSM_PUBLIC_FUNCTION(PSMResult) PSM_GetControllerList(PSMControllerList *out_cont
 		- PSMStreamFlags_includeCalibratedSensorData = add calibrated sensor data values
 		- PSMStreamFlags_includeRawTrackerData = add tracker projection info for each tacker
 		- PSMStreamFlags_disableROI = turns off RegionOfInterest optimization used to reduce CPU load when finding tracking bulb
+		- PSMStreamFlags_useCompactDataFrames = send pose and button state in a fixed layout compact data frame, ignores the raw data flags
+		- PSMStreamFlags_useSharedMemoryPoseTable = read pose and button state straight out of shared memory instead of a data stream (same machine as the service only)
 	\param timeout_ms The conection timeout period in milliseconds, usually PSM_DEFAULT_TIMEOUT
 	\return PSMResult_Success upon receiving result, PSMResult_Timeoout, or PSMResult_Error on request error.
  */
@@ -1124,6 +1128,8 @@ PSM_PUBLIC_FUNCTION(PSMResult) PSM_GetControllerListAsync(PSMRequestID *out_requ
 		- PSMStreamFlags_includeCalibratedSensorData = add calibrated sensor data values
 		- PSMStreamFlags_includeRawTrackerData = add tracker projection info for each tacker
 		- PSMStreamFlags_disableROI = turns off RegionOfInterest optimization used to reduce CPU load when finding tracking bulb
+		- PSMStreamFlags_useCompactDataFrames = send pose and button state in a fixed layout compact data frame, ignores the raw data flags
+		- PSMStreamFlags_useSharedMemoryPoseTable = read pose and button state straight out of shared memory instead of a data stream (same machine as the service only)
 	\param[out] out_request_id The id of the request sent to PSMoveService. Can be used to register callback with \ref PSM_RegisterCallback.
 	\return PSMResult_RequestSent on success or PSMResult_Error if there was no valid connection
  */
@@ -1291,7 +1297,8 @@ PSM_PUBLIC_FUNCTION(PSMResult) PSM_GetTrackingSpaceSettings(PSMTrackingSpace *ou
 PSM_PUBLIC_FUNCTION(PSMResult) PSM_OpenTrackerVideoStream(PSMTrackerID tracker_id);
 
 /** \brief Poll the next video frame from an opened tracker video stream
-	Copy the next video frame from the shared memory buffer.
+	Copies the newest frame in the shared memory frame ring into the client's video frame buffer.
+	A frame the server overwrote while it was being copied is thrown away and the previous frame is kept.
 	This should be called at least as fast as the frame rate of the video feed.
 	\return PSMResult_Success if there is data available in the shared memory buffer.
  */
@@ -1306,9 +1313,11 @@ PSM_PUBLIC_FUNCTION(PSMResult) PSM_PollTrackerVideoStream(PSMTrackerID tracker_i
 PSM_PUBLIC_FUNCTION(PSMResult) PSM_CloseTrackerVideoStream(PSMTrackerID tracker_id);
 
 /** \brief Fetch the next video frame buffer from an opened tracker video stream
-	\remark Make sure the video buffer is large enough to hold tracker dimension x 3 bytes.
+	\remark The buffer is the client's copy of the frame read by the last successful \ref PSM_PollTrackerVideoStream,
+	so the server never writes to it. It stays valid until the next call to \ref PSM_PollTrackerVideoStream
+	or \ref PSM_CloseTrackerVideoStream for the tracker.
 	\param tracker_id The tracker to poll the next video frame from
-	\param[out] out_buffer A pointer to the buffer to copy the video frame into
+	\param[out] out_buffer Set to the frame buffer, tracker dimension x 3 bytes
 	\return PSMResult_Success if there was frame data available to read
  */
 PSM_PUBLIC_FUNCTION(PSMResult) PSM_GetTrackerVideoFrameBuffer(PSMTrackerID tracker_id, const unsigned char **out_buffer); 
@@ -1501,6 +1510,8 @@ PSM_PUBLIC_FUNCTION(PSMResult) PSM_GetHmdList(PSMHmdList *out_hmd_list, int time
 		- PSMStreamFlags_includeCalibratedSensorData = add calibrated sensor data values
 		- PSMStreamFlags_includeRawTrackerData = add tracker projection info for each tacker
 		- PSMStreamFlags_disableROI = turns off RegionOfInterest optimization used to reduce CPU load when finding tracking bulb(s)
+		- PSMStreamFlags_useCompactDataFrames = send pose and button state in a fixed layout compact data frame, ignores the raw data flags
+		- PSMStreamFlags_useSharedMemoryPoseTable = read pose and button state straight out of shared memory instead of a data stream (same machine as the service only)
 	\param timeout_ms The conection timeout period in milliseconds, usually PSM_DEFAULT_TIMEOUT
 	\return PSMResult_Success upon receiving result, PSMResult_Timeoout, or PSMResult_Error on request error.
  */
@@ -1557,6 +1568,8 @@ PSM_PUBLIC_FUNCTION(PSMResult) PSM_GetHmdListAsync(PSMRequestID *out_request_id)
 		- PSMStreamFlags_includeCalibratedSensorData = add calibrated sensor data values
 		- PSMStreamFlags_includeRawTrackerData = add tracker projection info for each tacker
 		- PSMStreamFlags_disableROI = turns off RegionOfInterest optimization used to reduce CPU load when finding tracking bulb(s)
+		- PSMStreamFlags_useCompactDataFrames = send pose and button state in a fixed layout compact data frame, ignores the raw data flags
+		- PSMStreamFlags_useSharedMemoryPoseTable = read pose and button state straight out of shared memory instead of a data stream (same machine as the service only)
 	\param[out] out_request_id The id of the request sent to PSMoveService. Can be used to register callback with \ref PSM_RegisterCallback.
 	\return PSMResult_RequestSent if request successfully sent or PSMResult_Error if connection is invalid.
  */
@@ -722,6 +722,41 @@ eigen_alignment_fit_focal_cone_to_sphere(
     *out_sphere_center = Eigen::Vector3f(x, y, z);
 }
 
+// Compute the sphere center from the least squares fit of the focal cone to the contour
+static void
+eigen_alignment_sphere_from_focal_cone(
+    const Eigen::Vector3f &Bx_By_c,
+    const Eigen::Vector2f *points,
+    const int point_count,
+    const float sphere_radius,
+    const float focal_length_pts,
+    Eigen::Vector3f *out_sphere_center,
+    EigenFitEllipse *out_ellipse_projection)
+{
+    float zz = focal_length_pts * focal_length_pts;
+    float norm_norm_B = sqrt(Bx_By_c[0] * Bx_By_c[0] +
+        Bx_By_c[1] * Bx_By_c[1] +
+        zz);
+    float cos_theta = Bx_By_c[2] / norm_norm_B;
+    float k = cos_theta * cos_theta;
+    float norm_B = sphere_radius / sqrt(1 - k);
+
+    *out_sphere_center << Bx_By_c[0], Bx_By_c[1], focal_length_pts;
+    *out_sphere_center *= (norm_B / norm_norm_B);
+
+    // Optionally compute the best fit ellipse
+    if (out_ellipse_projection != nullptr)
+    {
+        eigen_alignment_project_ellipse(out_sphere_center, k,
+                                        focal_length_pts, zz,
+                                        out_ellipse_projection);
+        
+        out_ellipse_projection->error=
+            eigen_alignment_compute_ellipse_fit_error(
+                points, point_count, *out_ellipse_projection);
+    }
+}
+
 void
 eigen_alignment_fit_focal_cone_to_sphere(
     const Eigen::Vector2f *points,
@@ -748,27 +783,64 @@ eigen_alignment_fit_focal_cone_to_sphere(
     Eigen::VectorXf b(point_count);
     b.fill(-zz);
     Eigen::Vector3f Bx_By_c = A.colPivHouseholderQr().solve(b);
-    float norm_norm_B = sqrt(Bx_By_c[0] * Bx_By_c[0] +
-        Bx_By_c[1] * Bx_By_c[1] +
-        zz);
-    float cos_theta = Bx_By_c[2] / norm_norm_B;
-    float k = cos_theta * cos_theta;
-    float norm_B = sphere_radius / sqrt(1 - k);
 
-    *out_sphere_center << Bx_By_c[0], Bx_By_c[1], focal_length_pts;
-    *out_sphere_center *= (norm_B / norm_norm_B);
+    eigen_alignment_sphere_from_focal_cone(
+        Bx_By_c, points, point_count, sphere_radius, focal_length_pts,
+        out_sphere_center, out_ellipse_projection);
+}
 
-    // Optionally compute the best fit ellipse
-    if (out_ellipse_projection != nullptr)
+void
+eigen_alignment_fit_focal_cone_to_sphere_bounded(
+    const Eigen::Vector2f *points,
+    const int point_count,
+    const float sphere_radius,
+    const float focal_length_pts, // a.k.a. "f_px"
+    Eigen::Vector3f *out_sphere_center,
+    EigenFitEllipse *out_ellipse_projection)
+{
+    // Fixed capacity storage, so nothing here touches the heap
+    typedef Eigen::Matrix<float, Eigen::Dynamic, 3, 0, k_max_sphere_fit_point_count, 3> t_fit_matrix;
+    typedef Eigen::Matrix<float, Eigen::Dynamic, 1, 0, k_max_sphere_fit_point_count, 1> t_fit_vector;
+    Eigen::Vector2f sampled_points[k_max_sphere_fit_point_count];
+
+    const Eigen::Vector2f *fit_points= points;
+    int fit_point_count= point_count;
+
+    if (point_count > k_max_sphere_fit_point_count)
     {
-        eigen_alignment_project_ellipse(out_sphere_center, k,
-                                        focal_length_pts, zz,
-                                        out_ellipse_projection);
-        
-        out_ellipse_projection->error=
-            eigen_alignment_compute_ellipse_fit_error(
-                points, point_count, *out_ellipse_projection);
+        // Take every n-th point, with the stride picked so the samples go all the way around the contour.
+        // The vertices of the convex hull of a blob are spread fairly evenly around it,
+        // and walking the contour by arc length instead costs more than the fit it saves.
+        for (int sample_index = 0; sample_index < k_max_sphere_fit_point_count; ++sample_index)
+        {
+            sampled_points[sample_index]= points[(sample_index*point_count) / k_max_sphere_fit_point_count];
+        }
+
+        fit_points= sampled_points;
+        fit_point_count= k_max_sphere_fit_point_count;
     }
+
+    // Compute the sphere position whose projection on the focal plane
+    // best fits the given convex contour
+    float zz = focal_length_pts * focal_length_pts;
+
+    t_fit_matrix A(fit_point_count, 3);
+    for (int i = 0; i < fit_point_count; ++i)
+    {
+        const Eigen::Vector2f &p = fit_points[i];
+        float norm_A = sqrtf(p.x()*p.x() + p.y()*p.y() + zz);
+        A(i, 0) = p.x();
+        A(i, 1) = p.y();
+        A(i, 2) = -norm_A;
+    }
+
+    t_fit_vector b(fit_point_count);
+    b.fill(-zz);
+    Eigen::Vector3f Bx_By_c = Eigen::ColPivHouseholderQR<t_fit_matrix>(A).solve(b);
+
+    eigen_alignment_sphere_from_focal_cone(
+        Bx_By_c, fit_points, fit_point_count, sphere_radius, focal_length_pts,
+        out_sphere_center, out_ellipse_projection);
 }
 
 
@@ -1209,4 +1281,134 @@ eigen_alignment_compute_camera_fundamental_matrix(
 
 	// Compute the fundamental matrix from camera A to camera B
 	F_ab = Kb.inverse().transpose() * E * Ka.inverse();
-}
\ No newline at end of file
+}
+
+// Adds (sign= 1) or removes (sign= -1) one camera's planes from the triangulation normal equations
+static void
+eigen_alignment_accumulate_triangulation_view(
+	const Eigen::Matrix<float, 3, 4> &P,
+	const Eigen::Vector2f &image_point,
+	const double sign,
+	Eigen::Matrix4d &inout_normal_matrix)
+{
+	const Eigen::Vector4d P_row_x = P.row(0).transpose().cast<double>();
+	const Eigen::Vector4d P_row_y = P.row(1).transpose().cast<double>();
+	const Eigen::Vector4d P_row_w = P.row(2).transpose().cast<double>();
+
+	Eigen::Vector4d planes[2] = {
+		static_cast<double>(image_point.x())*P_row_w - P_row_x,
+		static_cast<double>(image_point.y())*P_row_w - P_row_y
+	};
+
+	for (int plane_index = 0; plane_index < 2; ++plane_index)
+	{
+		// Scale the plane so that its residual is the distance to the point
+		const double normal_length = planes[plane_index].head<3>().norm();
+
+		if (normal_length > k_real64_normal_epsilon)
+		{
+			const Eigen::Vector4d plane = planes[plane_index] / normal_length;
+
+			inout_normal_matrix += sign*(plane*plane.transpose());
+		}
+	}
+}
+
+static bool
+eigen_alignment_solve_triangulation(
+	const Eigen::Matrix4d &normal_matrix,
+	Eigen::Vector3f *out_point)
+{
+	// Solve for the point [x y z 1] minimizing the summed squared plane distances
+	const Eigen::LDLT<Eigen::Matrix3d> ldlt(normal_matrix.topLeftCorner<3, 3>());
+
+	if (ldlt.info() != Eigen::Success || !ldlt.isPositive())
+	{
+		return false;
+	}
+
+	const Eigen::Vector3d point = ldlt.solve(-normal_matrix.topRightCorner<3, 1>());
+
+	if (!point.allFinite())
+	{
+		return false;
+	}
+
+	*out_point = point.cast<float>();
+
+	return true;
+}
+
+int
+eigen_alignment_triangulate_point(
+	const Eigen::Matrix<float, 3, 4> *projection_matrices,
+	const Eigen::Vector2f *image_points,
+	const int view_count,
+	const float max_reprojection_error,
+	Eigen::Vector3f *out_point,
+	bool *out_view_inliers)
+{
+	assert(view_count <= k_max_triangulation_view_count);
+
+	bool view_inliers[k_max_triangulation_view_count];
+	int inlier_count = 0;
+	Eigen::Matrix4d normal_matrix = Eigen::Matrix4d::Zero();
+
+	for (int view_index = 0; view_index < view_count; ++view_index)
+	{
+		eigen_alignment_accumulate_triangulation_view(
+			projection_matrices[view_index], image_points[view_index], 1.0, normal_matrix);
+		view_inliers[view_index] = true;
+		++inlier_count;
+	}
+
+	bool bSuccess = inlier_count >= 2 && eigen_alignment_solve_triangulation(normal_matrix, out_point);
+
+	// Reject the worst camera at a time, so one bad camera can't drag the others out with it
+	while (bSuccess && inlier_count > 2)
+	{
+		const Eigen::Vector4f homogeneous_point(out_point->x(), out_point->y(), out_point->z(), 1.f);
+		int worst_view_index = -1;
+		float worst_error = max_reprojection_error;
+
+		for (int view_index = 0; view_index < view_count; ++view_index)
+		{
+			if (view_inliers[view_index])
+			{
+				const Eigen::Vector3f projected_point = projection_matrices[view_index] * homogeneous_point;
+				const float error = 
+					(fabsf(projected_point.z()) > k_real_epsilon)
+					? (projected_point.head<2>() / projected_point.z() - image_points[view_index]).norm()
+					: k_real_max;
+
+				if (error > worst_error)
+				{
+					worst_view_index = view_index;
+					worst_error = error;
+				}
+			}
+		}
+
+		if (worst_view_index == -1)
+		{
+			break;
+		}
+
+		eigen_alignment_accumulate_triangulation_view(
+			projection_matrices[worst_view_index], image_points[worst_view_index], -1.0, normal_matrix);
+		view_inliers[worst_view_index] = false;
+		--inlier_count;
+
+		bSuccess = eigen_alignment_solve_triangulation(normal_matrix, out_point);
+	}
+
+	if (out_view_inliers != nullptr)
+	{
+		for (int view_index = 0; view_index < view_count; ++view_index)
+		{
+			out_view_inliers[view_index] = view_inliers[view_index];
+		}
+	}
+
+	return bSuccess ? inlier_count : 0;
+}
@@ -125,6 +125,23 @@ eigen_alignment_fit_focal_cone_to_sphere(
     Eigen::Vector3f *out_sphere_center,
     EigenFitEllipse *out_ellipse_projection= nullptr);
 
+// Most contour points eigen_alignment_fit_focal_cone_to_sphere_bounded() fits
+const int k_max_sphere_fit_point_count= 64;
+
+// Method of Doc_ok with a bounded cost and no heap allocations:
+// contours with more than k_max_sphere_fit_point_count points (large blobs close to the camera)
+// get subsampled to points spread evenly around the contour before fitting.
+// The points are expected to be in contour order (e.g. a convex hull).
+// The ellipse fit error is measured over the subsampled points.
+void
+eigen_alignment_fit_focal_cone_to_sphere_bounded(
+    const Eigen::Vector2f *points,
+    const int point_count,
+    const float sphere_radius,
+    const float focal_length_pts, // a.k.a. "f_px"
+    Eigen::Vector3f *out_sphere_center,
+    EigenFitEllipse *out_ellipse_projection= nullptr);
+
 // Compute the weighted average of multiple quaternions
 // * All weights will be renormalized against the total weight
 // * All input weights must be >= 0
@@ -188,4 +205,22 @@ eigen_alignment_compute_camera_fundamental_matrix(
 	const Eigen::Matrix3f &Kb, // intrinsic matrix of camera B
 	Eigen::Matrix3f &F_ab); // Output Fundamental matric F_ab
 
+// Most cameras eigen_alignment_triangulate_point() accepts
+const int k_max_triangulation_view_count= 16;
+
+// Least squares (linear) triangulation of a point seen by several cameras.
+// Each camera constrains the point to the two planes through the camera center that contain 
+// the ray through its image point, and the point minimizing the squared plane distances is solved for.
+// While more than two cameras remain, the camera with the largest reprojection error gets rejected
+// if that error is above max_reprojection_error (in image units) and the point is solved for again.
+// Returns the number of cameras used by the final estimate, 0 if the point couldn't be triangulated.
+int
+eigen_alignment_triangulate_point(
+	const Eigen::Matrix<float, 3, 4> *projection_matrices, // world to image for each camera
+	const Eigen::Vector2f *image_points,
+	const int view_count,
+	const float max_reprojection_error,
+	Eigen::Vector3f *out_point,
+	bool *out_view_inliers= nullptr); // optional, view_count entries
+
 #endif // MATH_UTILITY_H
@@ -92,6 +92,31 @@ eigen_quaternion_concatenate(const Eigen::Quaternion<T> &first, const Eigen::Qua
 	return first * second;
 }
 
+// Scalar type generic versions of eigen_vector3f/3d_clockwise_rotate
+// and eigen_angular_velocity_to_quaternion(d)_derivative, for templated filters
+template <typename T>
+Eigen::Matrix<T, 3, 1>
+eigen_vector3_clockwise_rotate(const Eigen::Quaternion<T> &q, const Eigen::Matrix<T, 3, 1> &v)
+{
+	assert_eigen_quaterniond_is_normalized(q);
+
+	// Eigen rotates counterclockwise (i.e. q*v*q^-1), 
+	// while we want the inverse of that (q^-1*v*q)
+	return q.conjugate()._transformVector(v);
+}
+
+template <typename T>
+Eigen::Quaternion<T>
+eigen_angular_velocity_to_quaternion_derivative_t(
+	const Eigen::Quaternion<T> &current_orientation,
+	const Eigen::Matrix<T, 3, 1> &ang_vel)
+{
+	Eigen::Quaternion<T> omega = Eigen::Quaternion<T>(T(0), ang_vel.x(), ang_vel.y(), ang_vel.z());
+	Eigen::Quaternion<T> quaternion_derivative = Eigen::Quaternion<T>(current_orientation.coeffs() * T(0.5)) *omega;
+
+	return quaternion_derivative;
+}
+
 Eigen::Quaternionf
 eigen_quaternion_normalized_lerp(const Eigen::Quaternionf &a, const Eigen::Quaternionf &b, const float u);
 
@@ -0,0 +1,166 @@
+#ifndef COMPACT_DATA_FRAME_H
+#define COMPACT_DATA_FRAME_H
+
+//-- includes -----
+#include "SharedConstants.h"
+#include <stddef.h>
+#include <stdint.h>
+
+//-- constants -----
+// Compact data frames are a fixed layout alternative to the protobuf DeviceOutputDataFrame
+// for the pose and button state of controllers and HMDs.
+// A client asks for them with use_compact_data_frames when starting a controller or HMD data stream.
+//
+// A compact data frame has no length header like a packed protobuf message does, 
+// the frame_size in its header delimits it from the next data frame in the same UDP datagram.
+// All fields are little-endian, which is the native byte order of every platform the service runs on,
+// so a frame gets decoded with a plain struct copy.
+
+// 'P','S','M','C' in memory.
+// Packed protobuf messages start with a big-endian message length smaller than MAX_OUTPUT_DATA_FRAME_MESSAGE_SIZE,
+// so the first byte of the magic tells the two kinds of data frame apart.
+#define COMPACT_DATA_FRAME_MAGIC 0x434D5350
+
+// Bump whenever the layout of the compact data frames changes
+#define COMPACT_DATA_FRAME_VERSION 1
+
+enum eCompactDataFrameFlags
+{
+    CompactDataFrameFlag_IsConnected = 0x01,
+    CompactDataFrameFlag_HasValidHardwareCalibration = 0x02,
+    CompactDataFrameFlag_IsTrackingEnabled = 0x04,
+    CompactDataFrameFlag_IsCurrentlyTracking = 0x08,
+    CompactDataFrameFlag_IsOrientationValid = 0x10,
+    CompactDataFrameFlag_IsPositionValid = 0x20,
+    CompactDataFrameFlag_HasPhysicsData = 0x40,
+};
+
+//-- definitions -----
+#pragma pack(push, 1)
+
+struct CompactDataFrameHeader
+{
+    uint32_t magic;             // COMPACT_DATA_FRAME_MAGIC
+    uint8_t version;            // COMPACT_DATA_FRAME_VERSION
+    uint8_t device_category;    // PSMoveProtocol::DeviceOutputDataFrame::DeviceCategory
+    uint16_t frame_size;        // Size of the whole frame in bytes, header included
+};
+
+struct CompactPoseData
+{
+    float position_cm[3];       // x, y, z
+    float orientation[4];       // w, x, y, z
+};
+
+// Only filled in if include_physics_data was set on the stream (see CompactDataFrameFlag_HasPhysicsData)
+struct CompactPhysicsData
+{
+    float velocity_cm_per_sec[3];
+    float acceleration_cm_per_sec_sqr[3];
+    float angular_velocity_rad_per_sec[3];
+    float angular_acceleration_rad_per_sec_sqr[3];
+};
+
+struct CompactPSMoveState
+{
+    uint8_t trigger_value;      // [0,255]
+    uint8_t battery_value;      // [0,5], 0xEE charging, 0xEF full
+};
+
+struct CompactPSNaviState
+{
+    uint8_t trigger_value;      // [0,255]
+    uint8_t stick_xaxis;        // [0,255], subtract 0x80 to obtain signed values
+    uint8_t stick_yaxis;        // [0,255], subtract 0x80 to obtain signed values
+};
+
+struct CompactPSDualShock4State
+{
+    float left_thumbstick_x;
+    float left_thumbstick_y;
+    float right_thumbstick_x;
+    float right_thumbstick_y;
+    float left_trigger_value;   // [0,1]
+    float right_trigger_value;  // [0,1]
+};
+
+struct CompactVirtualControllerState
+{
+    int32_t vendor_id;
+    int32_t product_id;
+    uint8_t num_buttons;
+    uint8_t num_axes;
+    uint8_t axis_states[PSM_MAX_VIRTUAL_CONTROLLER_AXES]; // [0,255]
+};
+
+struct CompactControllerDataFrame
+{
+    CompactDataFrameHeader header;
+
+    int32_t controller_id;
+    int32_t controller_type;    // PSMoveProtocol::ControllerType
+    int32_t sequence_num;
+    uint32_t flags;             // eCompactDataFrameFlags
+    uint32_t button_down_bitmask; // Indexed by DeviceOutputDataFrame::ControllerDataPacket::ButtonType
+
+    CompactPoseData pose;
+    CompactPhysicsData physics;
+
+    // Picked by controller_type
+    union
+    {
+        CompactPSMoveState psmove_state;
+        CompactPSNaviState psnavi_state;
+        CompactPSDualShock4State psdualshock4_state;
+        CompactVirtualControllerState virtual_controller_state;
+    };
+};
+
+struct CompactHMDDataFrame
+{
+    CompactDataFrameHeader header;
+
+    int32_t hmd_id;
+    int32_t hmd_type;           // PSMoveProtocol::HMDType
+    int32_t sequence_num;
+    uint32_t flags;             // eCompactDataFrameFlags
+
+    CompactPoseData pose;
+    CompactPhysicsData physics;
+};
+
+#pragma pack(pop)
+
+// The layout is part of the protocol, it can't depend on the compiler
+static_assert(sizeof(CompactDataFrameHeader) == 8, "Unexpected compact data frame header layout");
+static_assert(sizeof(CompactControllerDataFrame) == 8 + 20 + 28 + 48 + 42, "Unexpected compact controller data frame layout");
+static_assert(sizeof(CompactHMDDataFrame) == 8 + 16 + 28 + 48, "Unexpected compact HMD data frame layout");
+
+/// Fills in the header of a compact data frame of the given type
+template <class t_compact_frame>
+inline void initCompactDataFrameHeader(t_compact_frame &frame, const uint8_t device_category)
+{
+    frame.header.magic= COMPACT_DATA_FRAME_MAGIC;
+    frame.header.version= COMPACT_DATA_FRAME_VERSION;
+    frame.header.device_category= device_category;
+    frame.header.frame_size= static_cast<uint16_t>(sizeof(t_compact_frame));
+}
+
+inline uint32_t getCompactDataFrameFlag(const bool bIsSet, const eCompactDataFrameFlags flag)
+{
+    return bIsSet ? static_cast<uint32_t>(flag) : 0;
+}
+
+/// Returns the header of the compact data frame at the start of the given buffer,
+/// or nullptr if the buffer starts with a packed protobuf message instead
+inline const CompactDataFrameHeader *getCompactDataFrameHeader(const uint8_t *buffer, const size_t buffer_size)
+{
+    const CompactDataFrameHeader *header= reinterpret_cast<const CompactDataFrameHeader *>(buffer);
+
+    return
+        (buffer_size >= sizeof(CompactDataFrameHeader) && header->magic == COMPACT_DATA_FRAME_MAGIC)
+        ? header
+        : nullptr;
+}
+
+#endif // COMPACT_DATA_FRAME_H
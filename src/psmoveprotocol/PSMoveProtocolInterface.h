@@ -9,6 +9,11 @@
 #define MAX_OUTPUT_DATA_FRAME_MESSAGE_SIZE 500
 #define MAX_INPUT_DATA_FRAME_MESSAGE_SIZE 64
 
+// The service packs the output data frames it has queued for a client back to back into one UDP datagram.
+// Small enough to avoid IP fragmentation on an ethernet link, 
+// big enough to always fit one packed data frame (HEADER_SIZE + MAX_OUTPUT_DATA_FRAME_MESSAGE_SIZE).
+#define MAX_OUTPUT_DATA_FRAME_DATAGRAM_SIZE 1400
+
 // See ControllerManager.h in PSMoveService
 #define PSMOVESERVICE_MAX_CONTROLLER_COUNT  5
 
@@ -27,6 +32,8 @@ namespace PSMoveProtocol
 	class Response;
 };
 
+struct CompactDataFrameHeader;
+
 typedef std::shared_ptr<PSMoveProtocol::DeviceOutputDataFrame> DeviceOutputDataFramePtr;
 typedef std::shared_ptr<PSMoveProtocol::DeviceInputDataFrame> DeviceInputDataFramePtr;
 typedef std::shared_ptr<PSMoveProtocol::Request> RequestPtr;
@@ -43,6 +50,9 @@ class IDataFrameListener
 {
 public:
     virtual void handle_data_frame(const PSMoveProtocol::DeviceOutputDataFrame *data_frame) = 0;
+
+    // The header is followed by the rest of the frame, see CompactDataFrame.h
+    virtual void handle_compact_data_frame(const CompactDataFrameHeader *header) = 0;
 };
 
 class IResponseListener
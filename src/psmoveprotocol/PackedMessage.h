@@ -112,14 +112,42 @@ public:
         if (!m_msg)
             return false;
 
-        unsigned msg_size = m_msg->ByteSize();
+        return pack_message(*m_msg, buf);
+    }
+
+    /**
+     \brief Pack the message into the given fixed sized data_buffer.
+     
+     The message must fit inside the given array.
+     \param buf Pointer to a buffer that will be filled with the message.
+     \param buf_size The size of the buffer.
+     \return false in case of an error, true if successful.
+     */
+    bool pack(boost::uint8_t *buf, int buf_size) const
+    {
+        if (!m_msg)
+            return false;
+
+        return pack_message(*m_msg, buf, buf_size);
+    }
+
+    /**
+     \brief Packs the given message into the given data_buffer.
+
+     Lets messages that aren't owned by a \ref MessagePointer (i.e. arena allocated ones) be packed.
+     The buffer is resized to exactly fit the message, which doesn't allocate if it has the capacity already.
+     \return false in case of an error, true if successful.
+     */
+    static bool pack_message(const MessageType &msg, data_buffer& buf)
+    {
+        unsigned msg_size = msg.ByteSize();
         buf.resize(HEADER_SIZE + msg_size);
 
         encode_header(buf, msg_size);
 
         if (msg_size > 0)
         {
-            return m_msg->SerializeToArray(&buf[HEADER_SIZE], msg_size);
+            return msg.SerializeToArray(&buf[HEADER_SIZE], msg_size);
         }
         else
         {
@@ -129,19 +157,11 @@ public:
     }
 
     /**
-     \brief Pack the message into the given fixed sized data_buffer.
-     
-     The message must fit inside the given array.
-     \param buf Pointer to a buffer that will be filled with the message.
-     \param buf_size The size of the buffer.
-     \return false in case of an error, true if successful.
+     \overload
      */
-    bool pack(boost::uint8_t *buf, int buf_size) const
+    static bool pack_message(const MessageType &msg, boost::uint8_t *buf, int buf_size)
     {
-        if (!m_msg)
-            return false;
-
-        int msg_size = m_msg->ByteSize();
+        int msg_size = msg.ByteSize();
         if ((int)HEADER_SIZE + msg_size < buf_size)
         {
             memset(buf, 0, buf_size);
@@ -149,7 +169,7 @@ public:
 
             if (msg_size > 0)
             {
-                return m_msg->SerializeToArray(&buf[HEADER_SIZE], msg_size);
+                return msg.SerializeToArray(&buf[HEADER_SIZE], msg_size);
             }
             else
             {
@@ -247,7 +267,7 @@ private:
      \param buf A buffer containing a protocol buffer Message without header
      \param value
      */
-    void encode_header(data_buffer& buf, unsigned value) const
+    static void encode_header(data_buffer& buf, unsigned value)
     {
         assert(buf.size() >= HEADER_SIZE);
         buf[0] = static_cast<boost::uint8_t>((value >> 24) & 0xFF);
@@ -259,7 +279,7 @@ private:
     /**
      \overload
      */
-    void encode_header(boost::uint8_t *buf, unsigned buf_size, unsigned value) const
+    static void encode_header(boost::uint8_t *buf, unsigned buf_size, unsigned value)
     {
         assert(buf_size >= HEADER_SIZE);
         buf[0] = static_cast<boost::uint8_t>((value >> 24) & 0xFF);
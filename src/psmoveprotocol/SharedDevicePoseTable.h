@@ -0,0 +1,107 @@
+#ifndef SHARED_DEVICE_POSE_TABLE_H
+#define SHARED_DEVICE_POSE_TABLE_H
+
+//-- includes -----
+#include "SharedTrackerState.h"
+#include "CompactDataFrame.h"
+#include "PSMoveProtocolInterface.h"
+#include <atomic>
+#include <assert.h>
+#include <string.h>
+
+//-- constants -----
+// Name of the shared memory region the service publishes the device pose table in.
+// Only clients running on the same machine as the service can open it.
+#define SHARED_DEVICE_POSE_TABLE_NAME "PSMoveService_DevicePoseTable"
+
+// Bump whenever the layout of SharedDevicePoseTable changes
+#define SHARED_DEVICE_POSE_TABLE_VERSION 1
+
+// Number of times a reader retries an entry the service was writing into
+#define SHARED_DEVICE_POSE_TABLE_READ_ATTEMPTS 4
+
+//-- definitions -----
+// Latest state of one device, written as a compact data frame (see CompactDataFrame.h)
+template <class t_compact_data_frame>
+struct SharedDevicePoseEntry
+{
+    // Seqlock counter: odd while the service is writing the entry, even once it holds a complete data frame.
+    // An entry that was never written holds a zeroed data frame without a COMPACT_DATA_FRAME_MAGIC.
+    std::atomic<unsigned int> sequence;
+
+    t_compact_data_frame data_frame;
+};
+
+typedef SharedDevicePoseEntry<CompactControllerDataFrame> SharedControllerPoseEntry;
+typedef SharedDevicePoseEntry<CompactHMDDataFrame> SharedHMDPoseEntry;
+
+// The latest filtered pose, physics and button state of every controller and HMD.
+// The service is the only writer and never waits on a reader,
+// readers copy an entry out and retry if the service wrote to it in the meantime.
+class SharedDevicePoseTable
+{
+public:
+    SharedDevicePoseTable()
+        : version(SHARED_DEVICE_POSE_TABLE_VERSION)
+    {
+        for (int controller_id = 0; controller_id < PSMOVESERVICE_MAX_CONTROLLER_COUNT; ++controller_id)
+        {
+            controllers[controller_id].sequence.store(0);
+            memset(&controllers[controller_id].data_frame, 0, sizeof(CompactControllerDataFrame));
+        }
+
+        for (int hmd_id = 0; hmd_id < PSMOVESERVICE_MAX_HMD_COUNT; ++hmd_id)
+        {
+            hmds[hmd_id].sequence.store(0);
+            memset(&hmds[hmd_id].data_frame, 0, sizeof(CompactHMDDataFrame));
+        }
+    }
+
+    int version;
+
+    SharedControllerPoseEntry controllers[PSMOVESERVICE_MAX_CONTROLLER_COUNT];
+    SharedHMDPoseEntry hmds[PSMOVESERVICE_MAX_HMD_COUNT];
+
+    // Called by the service with a compact data frame of the entry's type
+    template <class t_compact_data_frame>
+    static void writeEntry(SharedDevicePoseEntry<t_compact_data_frame> &entry, const unsigned char *data_frame, size_t data_frame_size)
+    {
+        assert(data_frame_size == sizeof(t_compact_data_frame));
+        const unsigned int sequence = entry.sequence.load(std::memory_order_relaxed);
+
+        // Odd sequence number marks the entry as being written
+        entry.sequence.store(sequence + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+
+        memcpy(&entry.data_frame, data_frame, sizeof(t_compact_data_frame));
+
+        // Even sequence number marks the entry as complete
+        entry.sequence.store(sequence + 2, std::memory_order_release);
+    }
+
+    // Copies out the entry, returns false if the service kept writing into it
+    template <class t_compact_data_frame>
+    static bool readEntry(const SharedDevicePoseEntry<t_compact_data_frame> &entry, t_compact_data_frame &out_data_frame)
+    {
+        for (int attempt = 0; attempt < SHARED_DEVICE_POSE_TABLE_READ_ATTEMPTS; ++attempt)
+        {
+            const unsigned int sequence = entry.sequence.load(std::memory_order_acquire);
+
+            if ((sequence & 1) == 0)
+            {
+                memcpy(&out_data_frame, &entry.data_frame, sizeof(t_compact_data_frame));
+                std::atomic_thread_fence(std::memory_order_acquire);
+
+                // Only keep the copy if the service didn't touch the entry while it was being made
+                if (entry.sequence.load(std::memory_order_relaxed) == sequence)
+                {
+                    return true;
+                }
+            }
+        }
+
+        return false;
+    }
+};
+
+#endif // SHARED_DEVICE_POSE_TABLE_H
@@ -5,37 +5,69 @@
 #define BOOST_INTERPROCESS_SHARED_DIR_PATH "shared_mem"
 #endif // WIN32
 
-#include <boost/interprocess/sync/interprocess_mutex.hpp>
+#include <atomic>
+#include <stddef.h>
 
+// Number of video frames kept in the shared memory ring.
+// A reader copying a frame out of the ring has until the server has written this many more frames (minus one).
+#define SHARED_VIDEO_FRAME_SLOT_COUNT 4
+
+// The atomics below get shared between processes, so they have to be address-free
+static_assert(ATOMIC_INT_LOCK_FREE == 2, "Shared video frame ring needs lock-free atomic ints");
+
+struct SharedVideoFrameSlot
+{
+    // Seqlock counter: odd while the server is writing into the slot, even once the frame in it is complete
+    std::atomic<unsigned int> sequence;
+
+    // Index of the frame stored in the slot (0 if the slot never held a frame)
+    std::atomic<int> frame_index;
+};
+
+// A ring of video frame slots that a single writer (the server) fills in without ever blocking.
+// Readers find the newest complete frame through latest_frame_index, copy it out
+// and check the slot's sequence again to make sure the server didn't rewrite it in the meantime.
 class SharedVideoFrameHeader
 {
 public:
     SharedVideoFrameHeader()
-        : mutex()
-        , width(0)
+        : width(0)
         , height(0)
         , stride(0)
-        , frame_index(0)
+        , latest_frame_index(0)
     {
+        for (int slot_index = 0; slot_index < SHARED_VIDEO_FRAME_SLOT_COUNT; ++slot_index)
+        {
+            slots[slot_index].sequence.store(0);
+            slots[slot_index].frame_index.store(0);
+        }
     }
-    
-    //Mutex to protect access to the shared memory
-    boost::interprocess::interprocess_mutex mutex;
 
     int width;
     int height;
     int stride;
-    int frame_index;
-    // Buffer stored past the end of the header
 
-    const unsigned char *getBuffer() const
+    // Index of the newest complete frame (0 until the first frame gets written)
+    std::atomic<int> latest_frame_index;
+
+    SharedVideoFrameSlot slots[SHARED_VIDEO_FRAME_SLOT_COUNT];
+    // Slot buffers stored past the end of the header
+
+    static int getSlotIndex(int frame_index)
+    {
+        return frame_index % SHARED_VIDEO_FRAME_SLOT_COUNT;
+    }
+
+    const unsigned char *getSlotBuffer(int slot_index) const
     {
-        return reinterpret_cast<const unsigned char *>(this) + sizeof(SharedVideoFrameHeader);
+        return
+            reinterpret_cast<const unsigned char *>(this) + sizeof(SharedVideoFrameHeader) +
+            slot_index*computeVideoBufferSize(stride, height);
     }
 
-    unsigned char *getBufferMutable()
+    unsigned char *getSlotBufferMutable(int slot_index)
     {
-        return const_cast<unsigned char *>(getBuffer());
+        return const_cast<unsigned char *>(getSlotBuffer(slot_index));
     }
 
     static size_t computeVideoBufferSize(int stride, int height)
@@ -45,8 +77,8 @@ public:
 
     static size_t computeTotalSize(int stride, int height)
     {
-        return sizeof(SharedVideoFrameHeader) + computeVideoBufferSize(stride, height);
+        return sizeof(SharedVideoFrameHeader) + SHARED_VIDEO_FRAME_SLOT_COUNT*computeVideoBufferSize(stride, height);
     }
 };
 
-#endif // SHARED_TRACKER_STATE_H
\ No newline at end of file
+#endif // SHARED_TRACKER_STATE_H
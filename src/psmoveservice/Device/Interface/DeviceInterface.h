@@ -2,6 +2,7 @@
 #define DEVICE_INTERFACE_H
 
 // -- includes -----
+#include <chrono>
 #include <string>
 #include <tuple>
 
@@ -215,6 +216,10 @@ struct CommonDeviceState
     
     eDeviceType DeviceType;
     int PollSequenceNumber;
+
+    // Time the data was read off of the device (USB/HID read), before any processing.
+    // Left at the epoch by devices that don't stamp their state.
+    std::chrono::time_point<std::chrono::high_resolution_clock> CaptureTimestamp;
     
     inline CommonDeviceState()
     {
@@ -225,6 +230,12 @@ struct CommonDeviceState
     {
         DeviceType= SUPPORTED_CONTROLLER_TYPE_COUNT; // invalid
         PollSequenceNumber= 0;
+        CaptureTimestamp= std::chrono::time_point<std::chrono::high_resolution_clock>();
+    }
+
+    inline bool hasCaptureTimestamp() const
+    {
+        return CaptureTimestamp != std::chrono::time_point<std::chrono::high_resolution_clock>();
     }
 
     static const char *getDeviceTypeString(eDeviceType device_type)
@@ -528,6 +539,12 @@ public:
         SUPPORTED_DRIVER_TYPE_COUNT,
     };
 
+    enum eVideoFrameFormat
+    {
+        BGR,        // 3 bytes per pixel
+        BayerGB,    // 1 byte per pixel, raw GBRG sensor data that still needs to be debayered
+    };
+
     // -- Getters
     // Returns the driver type being used by this camera
     virtual eDriverType getDriverType() const = 0;
@@ -541,6 +558,10 @@ public:
     // Returns a pointer to the last video frame buffer captured
     virtual const unsigned char *getVideoFrameBuffer() const = 0;
 
+    // Returns the pixel format of the buffer returned by getVideoFrameBuffer().
+    // getVideoFrameDimensions() always describes the debayered BGR frame.
+    virtual eVideoFrameFormat getVideoFrameFormat() const = 0;
+
     static const char *getDriverTypeString(eDriverType device_type)
     {
         const char *result = nullptr;
@@ -4,6 +4,8 @@
 #include "ControllerDeviceEnumerator.h"
 #include "ControllerGamepadEnumerator.h"
 #include "OrientationFilter.h"
+#include "OrientationFilterBatch.h"
+#include "PoseFilterInterface.h"
 #include "PSMoveProtocol.pb.h"
 #include "ServerLog.h"
 #include "ServerControllerView.h"
@@ -22,6 +24,7 @@ const int ControllerManagerConfig::CONFIG_VERSION = 1;
 ControllerManagerConfig::ControllerManagerConfig(const std::string &fnamebase)
     : PSMoveConfig(fnamebase)
     , virtual_controller_count(0)
+    , use_orientation_filter_batch(false)
 {
 
 };
@@ -33,6 +36,7 @@ ControllerManagerConfig::config2ptree()
 
     pt.put("version", ControllerManagerConfig::CONFIG_VERSION);
     pt.put("virtual_controller_count", virtual_controller_count);
+    pt.put("use_orientation_filter_batch", use_orientation_filter_batch);
 
     return pt;
 }
@@ -45,6 +49,7 @@ ControllerManagerConfig::ptree2config(const boost::property_tree::ptree &pt)
     if (version == ControllerManagerConfig::CONFIG_VERSION)
     {
         virtual_controller_count = pt.get<int>("virtual_controller_count", 0);
+        use_orientation_filter_batch = pt.get<bool>("use_orientation_filter_batch", false);
     }
     else
     {
@@ -57,6 +62,9 @@ ControllerManagerConfig::ptree2config(const boost::property_tree::ptree &pt)
 //-- Controller Manager ----
 ControllerManager::ControllerManager()
     : DeviceTypeManager(1000, 2)
+    , m_orientation_filter_batch(nullptr)
+    , m_batchedUpdateViewCount(0)
+    , m_taskUpdateViewCount(0)
 {
 }
 
@@ -83,6 +91,12 @@ ControllerManager::startup()
         VirtualControllerEnumerator::virtual_controller_count= cfg.virtual_controller_count;
         ControllerGamepadEnumerator::virtual_controller_count= cfg.virtual_controller_count;
 
+        // One orientation filter lane per controller
+        if (cfg.use_orientation_filter_batch)
+        {
+            m_orientation_filter_batch= new OrientationFilterBatch(k_max_devices);
+        }
+
         // Initialize HIDAPI
         if (hid_init() == -1)
         {
@@ -112,6 +126,13 @@ ControllerManager::shutdown()
 {
 	DeviceTypeManager::shutdown();
 
+	// The controller pose filters are gone now, so nothing uses the batch's lanes anymore
+	if (m_orientation_filter_batch != nullptr)
+	{
+		delete m_orientation_filter_batch;
+		m_orientation_filter_batch= nullptr;
+	}
+
 	// Shutdown HIDAPI
 	hid_exit();
 
@@ -123,8 +144,27 @@ ControllerManager::shutdown()
 }
 
 void
-ControllerManager::updateStateAndPredict(TrackerManager* tracker_manager)
+ControllerManager::requestTrackerProjections(TrackerManager* tracker_manager)
 {
+	for (int device_id = 0; device_id < getMaxDevices(); ++device_id)
+	{
+		ServerControllerViewPtr controllerView = getControllerViewPtr(device_id);
+
+		if (controllerView->getIsOpen() && 
+			controllerView->getControllerDeviceType() != CommonDeviceState::PSNavi &&
+            (controllerView->getIsBluetooth() || controllerView->getIsVirtualController()))
+		{
+			controllerView->requestTrackerProjections(tracker_manager);
+		}
+	}
+}
+
+int
+ControllerManager::prepareStateUpdate(TrackerManager* tracker_manager)
+{
+	m_batchedUpdateViewCount= 0;
+	m_taskUpdateViewCount= 0;
+
 	for (int device_id = 0; device_id < getMaxDevices(); ++device_id)
 	{
 		ServerControllerViewPtr controllerView = getControllerViewPtr(device_id);
@@ -134,9 +174,67 @@ ControllerManager::updateStateAndPredict(TrackerManager* tracker_manager)
             (controllerView->getIsBluetooth() || controllerView->getIsVirtualController()))
 		{
 			controllerView->updateOpticalPoseEstimation(tracker_manager);
-			controllerView->updateStateAndPredict();
+
+			const IPoseFilter *poseFilter= controllerView->getPoseFilter();
+			if (poseFilter != nullptr && poseFilter->getIsBatched())
+			{
+				m_batchedUpdateViews[m_batchedUpdateViewCount]= controllerView;
+				++m_batchedUpdateViewCount;
+			}
+			else
+			{
+				m_taskUpdateViews[m_taskUpdateViewCount]= controllerView;
+				++m_taskUpdateViewCount;
+			}
 		}
 	}
+
+	return (m_batchedUpdateViewCount > 0 ? 1 : 0) + m_taskUpdateViewCount;
+}
+
+void
+ControllerManager::runStateUpdateTask(const int task_index)
+{
+	if (m_batchedUpdateViewCount > 0 && task_index == 0)
+	{
+		// Hand the batched controllers their sensor packets in rounds of one packet per controller.
+		// The batched orientation filters stage their IMU updates during a round
+		// and then advance together in a single pass over the batch.
+		for (int view_index = 0; view_index < m_batchedUpdateViewCount; ++view_index)
+		{
+			m_batchedUpdateViews[view_index]->drainSensorPacketQueues();
+		}
+
+		m_orientation_filter_batch->setDeferUpdates(true);
+
+		bool bAppliedPacket= true;
+		while (bAppliedPacket)
+		{
+			bAppliedPacket= false;
+
+			for (int view_index = 0; view_index < m_batchedUpdateViewCount; ++view_index)
+			{
+				bAppliedPacket|= m_batchedUpdateViews[view_index]->applyNextSensorPacket();
+			}
+
+			m_orientation_filter_batch->update();
+
+			// Finish the parts of the controller updates that waited on the batch
+			for (int view_index = 0; view_index < m_batchedUpdateViewCount; ++view_index)
+			{
+				m_batchedUpdateViews[view_index]->getPoseFilterMutable()->completeBatchedUpdate();
+			}
+		}
+
+		m_orientation_filter_batch->setDeferUpdates(false);
+	}
+	else
+	{
+		const int view_index= (m_batchedUpdateViewCount > 0) ? task_index - 1 : task_index;
+		assert(view_index >= 0 && view_index < m_taskUpdateViewCount);
+
+		m_taskUpdateViews[view_index]->updateStateAndPredict();
+	}
 }
 
 void ControllerManager::publish()
@@ -13,6 +13,7 @@
 //-- typedefs -----
 class ServerControllerView;
 typedef std::shared_ptr<ServerControllerView> ServerControllerViewPtr;
+class OrientationFilterBatch;
 
 //-- definitions -----
 class ControllerManagerConfig : public PSMoveConfig
@@ -27,6 +28,9 @@ public:
 
     int version;
     int virtual_controller_count;
+    // Off by default: the batch hasn't measured faster than individual filter updates,
+    // and every batched controller gets updated by the same task
+    bool use_orientation_filter_batch;
 };
 
 class ControllerManager : public DeviceTypeManager
@@ -40,7 +44,15 @@ public:
     /// Call hid_close()
     void shutdown() override;
     
-    void updateStateAndPredict(TrackerManager* tracker_manager);
+    void requestTrackerProjections(TrackerManager* tracker_manager);
+
+    /// Estimate the optical poses and pick the controllers whose pose filters get updated this frame.
+    /// Returns the number of filter update tasks to run through runStateUpdateTask().
+    int prepareStateUpdate(TrackerManager* tracker_manager);
+
+    /// Compute the pose/prediction of the controllers of one task.
+    /// Tasks don't share any state, so they can run on different threads at the same time.
+    void runStateUpdateTask(const int task_index);
     void publish() override;
 
     inline const ControllerManagerConfig& getConfig() const
@@ -65,6 +77,12 @@ public:
 
     void setControllerRumble(int controller_id, float rumble_amount, CommonControllerState::RumbleChannel channel);
 
+    /// Shared by the controllers' Madgwick/complementary orientation filters (null if disabled in the config)
+    inline OrientationFilterBatch *getOrientationFilterBatch() const
+    {
+        return m_orientation_filter_batch;
+    }
+
 protected:
 	// Fetch latest controller state
 	void poll_devices() override;
@@ -82,6 +100,15 @@ private:
     static const PSMoveProtocol::Response_ResponseType k_list_udpated_response_type = PSMoveProtocol::Response_ResponseType_CONTROLLER_LIST_UPDATED;
     std::string m_bluetooth_host_address;
     ControllerManagerConfig cfg;
+    OrientationFilterBatch *m_orientation_filter_batch;
+
+    // Controllers picked by prepareStateUpdate().
+    // The controllers on the orientation filter batch all get updated by task 0,
+    // the rest get a task of their own.
+    ServerControllerViewPtr m_batchedUpdateViews[k_max_devices];
+    int m_batchedUpdateViewCount;
+    ServerControllerViewPtr m_taskUpdateViews[k_max_devices];
+    int m_taskUpdateViewCount;
 };
 
 #endif // CONTROLLER_MANAGER_H
\ No newline at end of file
@@ -19,8 +19,11 @@
 #include "PSMoveProtocol.pb.h"
 #include "PSMoveConfig.h"
 #include "TrackerManager.h"
+#include "WorkStealingTaskPool.h"
 
+#include <algorithm>
 #include <chrono>
+#include <thread>
 
 //-- constants -----
 static const int k_default_controller_reconnect_interval= 1000; // ms
@@ -29,6 +32,40 @@ static const int k_default_tracker_reconnect_interval= 10000; // ms
 static const int k_default_tracker_poll_interval= 13; // 1000/75 ms
 static const int k_default_hmd_reconnect_interval= 10000; // ms
 static const int k_default_hmd_poll_interval= 2; // ms
+static const int k_default_state_update_worker_count= -1; // one less than the number of cores
+static const int k_stage_timing_log_interval= 10000; // ms
+
+//-- private definitions -----
+using t_high_resolution_timepoint= std::chrono::time_point<std::chrono::high_resolution_clock>;
+
+/// Runs the pose filter updates of the controllers and the HMDs as one job.
+/// The controller tasks come first, followed by one task per HMD.
+class DeviceStateUpdateJob : public ITaskPoolJob
+{
+public:
+    DeviceStateUpdateJob(ControllerManager *controller_manager, HMDManager *hmd_manager, const int controller_task_count)
+        : m_controller_manager(controller_manager)
+        , m_hmd_manager(hmd_manager)
+        , m_controller_task_count(controller_task_count)
+    {}
+
+    void runTask(const int task_index) override
+    {
+        if (task_index < m_controller_task_count)
+        {
+            m_controller_manager->runStateUpdateTask(task_index);
+        }
+        else
+        {
+            m_hmd_manager->runStateUpdateTask(task_index - m_controller_task_count);
+        }
+    }
+
+private:
+    ControllerManager *m_controller_manager;
+    HMDManager *m_hmd_manager;
+    const int m_controller_task_count;
+};
 
 class DeviceManagerConfig : public PSMoveConfig
 {
@@ -45,6 +82,7 @@ public:
         , hmd_poll_interval(k_default_hmd_poll_interval)
 		, gamepad_api_enabled(true)
 		, platform_api_enabled(true)
+        , state_update_worker_count(k_default_state_update_worker_count)
     {};
 
     const boost::property_tree::ptree
@@ -61,6 +99,7 @@ public:
         pt.put("hmd_poll_interval", hmd_poll_interval); 
 		pt.put("gamepad_api_enabled", gamepad_api_enabled);
 		pt.put("platform_api_enabled", platform_api_enabled);
+        pt.put("state_update_worker_count", state_update_worker_count);
 
         return pt;
     }
@@ -80,6 +119,7 @@ public:
             hmd_poll_interval = pt.get<int>("hmd_poll_interval", k_default_hmd_poll_interval);
 		    gamepad_api_enabled = pt.get<bool>("gamepad_api_enabled", gamepad_api_enabled);
 		    platform_api_enabled = pt.get<bool>("platform_api_enabled", platform_api_enabled);
+            state_update_worker_count = pt.get<int>("state_update_worker_count", k_default_state_update_worker_count);
         }
         else
         {
@@ -98,6 +138,7 @@ public:
     int hmd_poll_interval;    
 	bool gamepad_api_enabled;
 	bool platform_api_enabled;
+    int state_update_worker_count; // 0 updates every device on the main thread
 };
 
 // DeviceManager - This is the interface used by PSMoveService
@@ -110,7 +151,13 @@ DeviceManager::DeviceManager()
     , m_controller_manager(new ControllerManager())
     , m_tracker_manager(new TrackerManager())
     , m_hmd_manager(new HMDManager())
+    , m_state_update_pool(nullptr)
+    , m_stage_timing_update_count(0)
 {
+    for (int stage_index = 0; stage_index < _UpdateStage_COUNT; ++stage_index)
+    {
+        m_stage_durations[stage_index]= std::chrono::duration<double, std::milli>::zero();
+    }
 }
 
 DeviceManager::~DeviceManager()
@@ -119,6 +166,11 @@ DeviceManager::~DeviceManager()
     delete m_tracker_manager;
     delete m_hmd_manager;
 
+    if (m_state_update_pool != nullptr)
+    {
+        delete m_state_update_pool;
+    }
+
 	if (m_platform_api != nullptr)
 	{
 		delete m_platform_api;
@@ -185,6 +237,20 @@ DeviceManager::startup()
     m_hmd_manager->reconnect_interval = hmd_reconnect_interval;
     m_hmd_manager->poll_interval = m_config->hmd_poll_interval;
     success &= m_hmd_manager->startup();    
+
+    // Devices get their pose filters updated in parallel on a pool of worker threads
+    int state_update_worker_count= m_config->state_update_worker_count;
+    if (state_update_worker_count < 0)
+    {
+        // Use the spare cores, but never more threads than there can be devices to update
+        const int core_count= static_cast<int>(std::thread::hardware_concurrency());
+        const int max_device_count= ControllerManager::k_max_devices + HMDManager::k_max_devices;
+
+        state_update_worker_count= std::max(std::min(core_count, max_device_count) - 1, 0);
+    }
+    m_state_update_pool= new WorkStealingTaskPool("DeviceUpdate", state_update_worker_count);
+    m_state_update_pool->startup();
+    m_last_stage_timing_log_time= std::chrono::high_resolution_clock::now();
     
     m_instance= this;
     
@@ -199,16 +265,72 @@ DeviceManager::update()
 		m_platform_api->poll(); // Send device hotplug events
 	}
 
+    t_high_resolution_timepoint stage_start_times[_UpdateStage_COUNT + 1];
+
+    stage_start_times[_UpdateStage_Poll]= std::chrono::high_resolution_clock::now();
     m_controller_manager->poll(); // Update controller counts and poll button/IMU state
     m_tracker_manager->poll(); // Update tracker count and poll video frames
     m_hmd_manager->poll(); // Update HMD count and poll IMU state
 
-    m_controller_manager->updateStateAndPredict(m_tracker_manager); // Compute pose/prediction of tracking blob+IMU state
-    m_hmd_manager->updateStateAndPredict(m_tracker_manager); // Compute pose/prediction of tracking blobs+IMU state
+    stage_start_times[_UpdateStage_TrackerProjection]= std::chrono::high_resolution_clock::now();
+    m_controller_manager->requestTrackerProjections(m_tracker_manager); // Start searching new video frames for controller tracking blobs
+    m_hmd_manager->requestTrackerProjections(m_tracker_manager); // Start searching new video frames for HMD tracking blobs
+    m_tracker_manager->processRequestedProjections(); // Segment each new video frame once and search it on the tracker vision threads
+
+    stage_start_times[_UpdateStage_StateUpdate]= std::chrono::high_resolution_clock::now();
+    {
+        // Triangulate the tracking blobs of each device on the main thread
+        const int controller_task_count= m_controller_manager->prepareStateUpdate(m_tracker_manager);
+        const int hmd_task_count= m_hmd_manager->prepareStateUpdate(m_tracker_manager);
+
+        // Compute pose/prediction of tracking blob+IMU state.
+        // The devices don't share any filter state, so the pool updates them in parallel
+        // and returns once every device is done.
+        DeviceStateUpdateJob state_update_job(m_controller_manager, m_hmd_manager, controller_task_count);
+        m_state_update_pool->runJob(&state_update_job, controller_task_count + hmd_task_count);
+    }
 
+    // Publish from the main thread in device order, same as before the parallel update
+    stage_start_times[_UpdateStage_Publish]= std::chrono::high_resolution_clock::now();
     m_controller_manager->publish(); // publish controller state to any listening clients  (common case)
     m_tracker_manager->publish(); // publish tracker state to any listening clients (probably only used by ConfigTool)
     m_hmd_manager->publish(); // publish hmd state to any listening clients (common case)
+
+    stage_start_times[_UpdateStage_COUNT]= std::chrono::high_resolution_clock::now();
+    update_stage_timings(stage_start_times);
+}
+
+void
+DeviceManager::update_stage_timings(const t_high_resolution_timepoint stage_start_times[_UpdateStage_COUNT + 1])
+{
+    for (int stage_index = 0; stage_index < _UpdateStage_COUNT; ++stage_index)
+    {
+        m_stage_durations[stage_index]+= stage_start_times[stage_index + 1] - stage_start_times[stage_index];
+    }
+    ++m_stage_timing_update_count;
+
+    const t_high_resolution_timepoint &now= stage_start_times[_UpdateStage_COUNT];
+    const std::chrono::duration<double, std::milli> time_since_last_log= now - m_last_stage_timing_log_time;
+
+    if (time_since_last_log.count() >= k_stage_timing_log_interval)
+    {
+        const double update_count= static_cast<double>(m_stage_timing_update_count);
+
+        SERVER_LOG_DEBUG("DeviceManager::update") <<
+            "Average stage times over " << m_stage_timing_update_count << " updates (ms): " <<
+            "poll " << m_stage_durations[_UpdateStage_Poll].count() / update_count <<
+            ", tracker projection " << m_stage_durations[_UpdateStage_TrackerProjection].count() / update_count <<
+            ", state update " << m_stage_durations[_UpdateStage_StateUpdate].count() / update_count <<
+            " (" << m_state_update_pool->getWorkerCount() << " worker threads)" <<
+            ", publish " << m_stage_durations[_UpdateStage_Publish].count() / update_count;
+
+        for (int stage_index = 0; stage_index < _UpdateStage_COUNT; ++stage_index)
+        {
+            m_stage_durations[stage_index]= std::chrono::duration<double, std::milli>::zero();
+        }
+        m_stage_timing_update_count= 0;
+        m_last_stage_timing_log_time= now;
+    }
 }
 
 void
@@ -219,6 +341,11 @@ DeviceManager::shutdown()
 		m_config->save();
 	}
 
+	if (m_state_update_pool != nullptr)
+	{
+		m_state_update_pool->shutdown();
+	}
+
 	if (m_controller_manager != nullptr)
 	{
 	    m_controller_manager->shutdown();
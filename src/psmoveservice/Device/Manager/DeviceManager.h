@@ -30,6 +30,8 @@ typedef std::shared_ptr<ServerTrackerView> ServerTrackerViewPtr;
 class ServerHMDView;
 typedef std::shared_ptr<ServerHMDView> ServerHMDViewPtr;
 
+class WorkStealingTaskPool;
+
 //-- definitions -----
 struct DeviceHotplugListener
 {
@@ -79,6 +81,19 @@ public:
 	void handle_bluetooth_request_finished();
     
 private:
+	// Stages of update(), timed to find where the update spends its time
+	enum eUpdateStage
+	{
+		_UpdateStage_Poll,
+		_UpdateStage_TrackerProjection,
+		_UpdateStage_StateUpdate,
+		_UpdateStage_Publish,
+
+		_UpdateStage_COUNT
+	};
+
+	void update_stage_timings(const std::chrono::time_point<std::chrono::high_resolution_clock> stage_start_times[_UpdateStage_COUNT + 1]);
+
 	/// Singleton instance of the class
 	/// Assigned in startup, cleared in teardown
 	static DeviceManager *m_instance;
@@ -92,6 +107,14 @@ private:
 	// List of registered hot-plug listeners
 	std::vector<DeviceHotplugListener> m_listeners;
 
+	// Worker threads that update the pose filters of the devices in parallel
+	WorkStealingTaskPool *m_state_update_pool;
+
+	// Stage times accumulated since the last time they were logged
+	std::chrono::duration<double, std::milli> m_stage_durations[_UpdateStage_COUNT];
+	int m_stage_timing_update_count;
+	std::chrono::time_point<std::chrono::high_resolution_clock> m_last_stage_timing_log_time;
+
 public:
     class ControllerManager *m_controller_manager;
     class TrackerManager *m_tracker_manager;
@@ -50,6 +50,7 @@ HMDManagerConfig::ptree2config(const boost::property_tree::ptree &pt)
 //-- HMD Manager -----
 HMDManager::HMDManager()
     : DeviceTypeManager(1000, 2)
+    , m_taskUpdateViewCount(0)
 {
 }
 
@@ -83,8 +84,24 @@ HMDManager::shutdown()
 }
 
 void
-HMDManager::updateStateAndPredict(TrackerManager* tracker_manager)
+HMDManager::requestTrackerProjections(TrackerManager* tracker_manager)
 {
+	for (int device_id = 0; device_id < getMaxDevices(); ++device_id)
+	{
+		ServerHMDViewPtr hmdView = getHMDViewPtr(device_id);
+
+		if (hmdView->getIsOpen())
+		{
+			hmdView->requestTrackerProjections(tracker_manager);
+		}
+	}
+}
+
+int
+HMDManager::prepareStateUpdate(TrackerManager* tracker_manager)
+{
+	m_taskUpdateViewCount= 0;
+
 	for (int device_id = 0; device_id < getMaxDevices(); ++device_id)
 	{
 		ServerHMDViewPtr hmdView = getHMDViewPtr(device_id);
@@ -92,9 +109,21 @@ HMDManager::updateStateAndPredict(TrackerManager* tracker_manager)
 		if (hmdView->getIsOpen())
 		{
 			hmdView->updateOpticalPoseEstimation(tracker_manager);
-			hmdView->updateStateAndPredict();
+
+			m_taskUpdateViews[m_taskUpdateViewCount]= hmdView;
+			++m_taskUpdateViewCount;
 		}
 	}
+
+	return m_taskUpdateViewCount;
+}
+
+void
+HMDManager::runStateUpdateTask(const int task_index)
+{
+	assert(task_index >= 0 && task_index < m_taskUpdateViewCount);
+
+	m_taskUpdateViews[task_index]->updateStateAndPredict();
 }
 
 ServerHMDViewPtr
@@ -38,7 +38,14 @@ public:
     virtual bool startup() override;
     virtual void shutdown() override;
 
-	void updateStateAndPredict(TrackerManager* tracker_manager);
+	void requestTrackerProjections(TrackerManager* tracker_manager);
+
+	/// Estimate the optical poses and pick the HMDs whose pose filters get updated this frame.
+	/// Returns the number of filter update tasks to run through runStateUpdateTask() (one per HMD).
+	int prepareStateUpdate(TrackerManager* tracker_manager);
+
+	/// Compute the pose/prediction of one HMD, can run on any thread
+	void runStateUpdateTask(const int task_index);
 
     static const int k_max_devices = PSMOVESERVICE_MAX_HMD_COUNT;
     int getMaxDevices() const override
@@ -62,6 +69,10 @@ protected:
 
 private:
     HMDManagerConfig cfg;
+
+    // HMDs picked by prepareStateUpdate()
+    ServerHMDViewPtr m_taskUpdateViews[k_max_devices];
+    int m_taskUpdateViewCount;
 };
 
 #endif // HMD_MANAGER_H
@@ -25,8 +25,9 @@ TrackerManagerConfig::TrackerManagerConfig(const std::string &fnamebase)
 	ignore_pose_from_one_tracker = false;
     optical_tracking_timeout= 100;
 	tracker_sleep_ms = 1;
-	use_bgr_to_hsv_lookup_table = true;
 	exclude_opposed_cameras = false;
+	max_triangulation_reprojection_error_px = 20.f;
+	use_bayer_roi_tracking = true;
 	min_valid_projection_area= 16;
 	disable_roi = false;
 	default_tracker_profile.frame_width = 640;
@@ -52,10 +53,12 @@ TrackerManagerConfig::config2ptree()
 	pt.put("controller_position_smoothing", controller_position_smoothing);
 	pt.put("ignore_pose_from_one_tracker", ignore_pose_from_one_tracker);
     pt.put("optical_tracking_timeout", optical_tracking_timeout);
-	pt.put("use_bgr_to_hsv_lookup_table", use_bgr_to_hsv_lookup_table);
 	pt.put("tracker_sleep_ms", tracker_sleep_ms);
 
 	pt.put("excluded_opposed_cameras", exclude_opposed_cameras);	
+	pt.put("max_triangulation_reprojection_error_px", max_triangulation_reprojection_error_px);
+
+	pt.put("use_bayer_roi_tracking", use_bayer_roi_tracking);
 
 	pt.put("min_valid_projection_area", min_valid_projection_area);	
 
@@ -84,9 +87,10 @@ TrackerManagerConfig::ptree2config(const boost::property_tree::ptree &pt)
 		controller_position_smoothing = pt.get<float>("controller_position_smoothing", controller_position_smoothing);
 		ignore_pose_from_one_tracker = pt.get<bool>("ignore_pose_from_one_tracker", ignore_pose_from_one_tracker);
         optical_tracking_timeout= pt.get<int>("optical_tracking_timeout", optical_tracking_timeout);
-		use_bgr_to_hsv_lookup_table = pt.get<bool>("use_bgr_to_hsv_lookup_table", use_bgr_to_hsv_lookup_table);
 		tracker_sleep_ms = pt.get<int>("tracker_sleep_ms", tracker_sleep_ms);
 		exclude_opposed_cameras = pt.get<bool>("excluded_opposed_cameras", exclude_opposed_cameras);
+		max_triangulation_reprojection_error_px = pt.get<float>("max_triangulation_reprojection_error_px", max_triangulation_reprojection_error_px);
+		use_bayer_roi_tracking = pt.get<bool>("use_bayer_roi_tracking", use_bayer_roi_tracking);
 		min_valid_projection_area = pt.get<float>("min_valid_projection_area", min_valid_projection_area);	
 		disable_roi = pt.get<bool>("disable_roi", disable_roi);
 		default_tracker_profile.frame_width = pt.get<float>("default_tracker_profile.frame_width", 640);
@@ -237,6 +241,31 @@ TrackerManager::getTrackerViewPtr(int device_id) const
     return std::static_pointer_cast<ServerTrackerView>(m_deviceViews[device_id]);
 }
 
+void
+TrackerManager::processRequestedProjections()
+{
+    // Kick off every tracker's vision thread before waiting on any of them
+    for (int tracker_id = 0; tracker_id < getMaxDevices(); ++tracker_id)
+    {
+        ServerTrackerViewPtr tracker_view = getTrackerViewPtr(tracker_id);
+
+        if (tracker_view->getIsOpen())
+        {
+            tracker_view->dispatchRequestedProjections();
+        }
+    }
+
+    for (int tracker_id = 0; tracker_id < getMaxDevices(); ++tracker_id)
+    {
+        ServerTrackerViewPtr tracker_view = getTrackerViewPtr(tracker_id);
+
+        if (tracker_view->getIsOpen())
+        {
+            tracker_view->waitForRequestedProjections();
+        }
+    }
+}
+
 int TrackerManager::getListUpdatedResponseType()
 {
 	return PSMoveProtocol::Response_ResponseType_TRACKER_LIST_UPDATED;
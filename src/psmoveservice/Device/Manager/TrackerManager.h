@@ -54,8 +54,9 @@ public:
     long version;
     int optical_tracking_timeout;
 	int tracker_sleep_ms;
-	bool use_bgr_to_hsv_lookup_table;
 	bool exclude_opposed_cameras;
+	float max_triangulation_reprojection_error_px; // trackers further off than this get left out of a triangulation
+	bool use_bayer_roi_tracking;
 	float min_valid_projection_area;
 	bool disable_roi;
     TrackerProfile default_tracker_profile;
@@ -86,6 +87,10 @@ public:
 
     ServerTrackerViewPtr getTrackerViewPtr(int device_id) const;
 
+    // Run the projections requested this tick on every tracker's vision thread
+    // and block until they have all finished
+    void processRequestedProjections();
+
     inline void saveDefaultTrackerProfile(const TrackerProfile *profile)
     {
         cfg.default_tracker_profile = *profile;
@@ -3,6 +3,7 @@
 
 #include "AtomicPrimitives.h"
 #include "BluetoothRequests.h"
+#include "CompactDataFrame.h"
 #include "ControllerManager.h"
 #include "DeviceManager.h"
 #include "MathAlignment.h"
@@ -10,6 +11,7 @@
 #include "ServerRequestHandler.h"
 #include "CompoundPoseFilter.h"
 #include "KalmanPoseFilter.h"
+#include "PoseFilterHistory.h"
 #include "PSDualShock4Controller.h"
 #include "PSMoveController.h"
 #include "PSNaviController.h"
@@ -29,6 +31,14 @@ using t_high_resolution_duration= t_high_resolution_timepoint::duration;
 static const float k_min_time_delta_seconds = 1 / 2500.f;
 static const float k_max_time_delta_seconds = 1 / 30.f;
 
+// Number of sensor packets the pose filter can be rewound through to fuse a late optical measurement.
+// Covers a bit over 200ms of IMU and optical packets.
+static const int k_pose_filter_history_length = 64;
+
+// Most IMU or optical packets fused per update.
+// If the update loop stalls the oldest packets get dropped so the filter catches up with the newest data.
+static const int k_max_sensor_packets_per_stream = 100;
+
 //-- macros -----
 #define SET_BUTTON_BIT(bitmask, bit_index, button_state) \
     bitmask|= (button_state == CommonControllerState::Button_DOWN || button_state == CommonControllerState::Button_PRESSED) ? (0x1 << (bit_index)) : 0x0;
@@ -61,7 +71,7 @@ static void post_imu_filter_packets_for_psmove(
 	t_controller_pose_sensor_queue *pose_filter_queue);
 static void post_optical_filter_packet_for_psmove(
     const PSMoveController *psmove,
-    const t_high_resolution_timepoint now,
+    const t_high_resolution_timepoint capture_timestamp,
     const ControllerOpticalPoseEstimation *poseEstimation,
 	t_controller_pose_optical_queue *pose_filter_queue);
 
@@ -73,13 +83,13 @@ static void post_imu_filter_packets_for_ds4(
 	t_controller_pose_sensor_queue *pose_filter_queue);
 static void post_optical_filter_packet_for_ds4(
     const PSDualShock4Controller *ds4,
-    const t_high_resolution_timepoint now,
+    const t_high_resolution_timepoint capture_timestamp,
     const ControllerOpticalPoseEstimation *poseEstimation,
 	t_controller_pose_optical_queue *pose_filter_queue);
 
 static void post_optical_filter_packet_for_virtual_controller(
     const VirtualController *ds4,
-    const t_high_resolution_timepoint now,
+    const t_high_resolution_timepoint capture_timestamp,
     const ControllerOpticalPoseEstimation *poseEstimation,
 	t_controller_pose_optical_queue *pose_filter_queue);
 
@@ -91,6 +101,14 @@ static void generate_psdualshock4_data_frame_for_stream(
     const ServerControllerView *controller_view, const ControllerStreamInfo *stream_info, PSMoveProtocol::DeviceOutputDataFrame *data_frame);
 static void generate_virtual_controller_data_frame_for_stream(
     const ServerControllerView *controller_view, const ControllerStreamInfo *stream_info, PSMoveProtocol::DeviceOutputDataFrame *data_frame);
+static void generate_psmove_compact_data_frame_for_stream(
+    const ServerControllerView *controller_view, const ControllerStreamInfo *stream_info, CompactControllerDataFrame *compact_frame);
+static void generate_psnavi_compact_data_frame_for_stream(
+    const ServerControllerView *controller_view, const ControllerStreamInfo *stream_info, CompactControllerDataFrame *compact_frame);
+static void generate_psdualshock4_compact_data_frame_for_stream(
+    const ServerControllerView *controller_view, const ControllerStreamInfo *stream_info, CompactControllerDataFrame *compact_frame);
+static void generate_virtual_controller_compact_data_frame_for_stream(
+    const ServerControllerView *controller_view, const ControllerStreamInfo *stream_info, CompactControllerDataFrame *compact_frame);
 
 static void computeSpherePoseForControllerFromSingleTracker(
     const ServerControllerView *controllerView,
@@ -129,9 +147,9 @@ ServerControllerView::ServerControllerView(const int device_id)
     , m_multicam_pose_estimation(nullptr)
     , m_pose_filter(nullptr)
     , m_pose_filter_space(nullptr)
+    , m_PoseSensorPacketMerger(k_max_sensor_packets_per_stream)
+    , m_pose_filter_history(nullptr)
     , m_lastPollSeqNumProcessed(-1)
-    , m_last_filter_update_timestamp()
-    , m_last_filter_update_timestamp_valid(false)
 {
     m_tracking_color = std::make_tuple(0x00, 0x00, 0x00);
     m_LED_override_color = std::make_tuple(0x00, 0x00, 0x00);
@@ -219,6 +237,12 @@ void ServerControllerView::free_device_interface()
         m_tracker_pose_estimations = nullptr;
     }
 
+    if (m_pose_filter_history != nullptr)
+    {
+        delete m_pose_filter_history;
+        m_pose_filter_history= nullptr;
+    }
+
     if (m_pose_filter != nullptr)
     {
         delete m_pose_filter;
@@ -326,10 +350,6 @@ bool ServerControllerView::open(const class DeviceEnumerator *enumerator)
         }
     }
 
-    // Clear the filter update timestamp
-    m_last_filter_update_timestamp = std::chrono::time_point<std::chrono::high_resolution_clock>();
-    m_last_filter_update_timestamp_valid= false;
-
     return bSuccess;
 }
 
@@ -390,6 +410,13 @@ bool ServerControllerView::recenterOrientation(const CommonDeviceQuaternion& q_p
 
         // Tell the pose filter that the orientation state should now be relative to controller_pose_relative_to_global_forward
         filter->recenterOrientation(controller_pose_relative_to_global_forward);
+
+        // Rewinding past the recenter would undo it
+        if (m_pose_filter_history != nullptr)
+        {
+            m_pose_filter_history->clearHistory();
+        }
+
         bSuccess = true;
     }
 
@@ -400,6 +427,12 @@ void ServerControllerView::resetPoseFilter()
 {
     assert(m_device != nullptr);
 
+    if (m_pose_filter_history != nullptr)
+    {
+        delete m_pose_filter_history;
+        m_pose_filter_history = nullptr;
+    }
+
     if (m_pose_filter != nullptr)
     {
         delete m_pose_filter;
@@ -438,11 +471,44 @@ void ServerControllerView::resetPoseFilter()
     default:
         assert(false && "unreachable");
     }
+
+    if (m_pose_filter != nullptr)
+    {
+        m_pose_filter_history = new PoseFilterHistory(k_min_time_delta_seconds, k_max_time_delta_seconds);
+
+        if (!m_pose_filter_history->init(m_pose_filter, m_pose_filter_space, k_pose_filter_history_length))
+        {
+            SERVER_LOG_WARNING("ServerControllerView::resetPoseFilter") <<
+                "Pose filter for controller " << getDeviceID() << " can't be rewound. Late optical packets will be fused on arrival.";
+        }
+    }
+}
+
+void ServerControllerView::requestTrackerProjections(TrackerManager* tracker_manager)
+{
+    if (getIsTrackingEnabled())
+    {
+        CommonDeviceTrackingShape trackingShape;
+        m_device->getTrackingShape(trackingShape);
+        assert(trackingShape.shape_type != eCommonTrackingShapeType::INVALID_SHAPE);
+
+        for (int tracker_id = 0; tracker_id < tracker_manager->getMaxDevices(); ++tracker_id)
+        {
+            ServerTrackerViewPtr tracker = tracker_manager->getTrackerViewPtr(tracker_id);
+
+            // Only bother searching if a new video frame is available this tick
+            if (tracker->getIsOpen() && tracker->getHasUnpublishedState())
+            {
+                tracker->requestControllerProjection(this, &trackingShape);
+            }
+        }
+    }
 }
 
 void ServerControllerView::updateOpticalPoseEstimation(TrackerManager* tracker_manager)
 {
     const std::chrono::time_point<std::chrono::high_resolution_clock> now= std::chrono::high_resolution_clock::now();
+    bool bHasNewOpticalPose= false;
 
     // TODO: Probably need to first update IMU state to get velocity.
     // If velocity is too high, don't bother getting a new position.
@@ -452,6 +518,7 @@ void ServerControllerView::updateOpticalPoseEstimation(TrackerManager* tracker_m
     {
         int valid_projection_tracker_ids[TrackerManager::k_max_devices];
         int projections_found = 0;
+        int new_projections_found = 0;
 
         CommonDeviceTrackingShape trackingShape;
         m_device->getTrackingShape(trackingShape);
@@ -466,6 +533,14 @@ void ServerControllerView::updateOpticalPoseEstimation(TrackerManager* tracker_m
 
             const bool bWasTracking= trackerPoseEstimateRef.bCurrentlyTracking;
 
+            // Pick up the newest projection the tracker's vision thread found (if any)
+            ControllerOpticalPoseEstimation newTrackerPoseEstimate;
+            bool bHasNewProjection= false;
+            while (m_TrackerProjectionQueues[tracker_id].try_dequeue(newTrackerPoseEstimate))
+            {
+                bHasNewProjection= true;
+            }
+
             // Assume we're going to lose tracking this frame
             bool bCurrentlyTracking = false;
 
@@ -485,26 +560,16 @@ void ServerControllerView::updateOpticalPoseEstimation(TrackerManager* tracker_m
                     // Initially the newTrackerPoseEstimate is a copy of the existing pose
                     bool bIsVisibleThisUpdate= false;
 
-                    // If a new video frame is available this tick, 
-                    // attempt to update the tracking location
-                    if (tracker->getHasUnpublishedState())
+                    // If the tracker found the controller in this tick's video frame, 
+                    // update the tracking location
+                    if (bHasNewProjection)
                     {
-                        // Create a copy of the pose estimate state so that in event of a 
-                        // failure part way through computing the projection we don't
-                        // set partially valid state
-                        ControllerOpticalPoseEstimation newTrackerPoseEstimate= trackerPoseEstimateRef;
-
-                        if (tracker->computeProjectionForController(
-                                this, 
-                                &trackingShape,
-                                &newTrackerPoseEstimate))
-                        {
-                            bIsVisibleThisUpdate= true;
+                        bIsVisibleThisUpdate= true;
+                        ++new_projections_found;
 
-                            // Actually apply the pose estimate state
-                            trackerPoseEstimateRef= newTrackerPoseEstimate;
-                            trackerPoseEstimateRef.last_visible_timestamp = now;
-                        }
+                        // Actually apply the pose estimate state
+                        trackerPoseEstimateRef= newTrackerPoseEstimate;
+                        trackerPoseEstimateRef.last_visible_timestamp = now;
                     }
 
                     // If the projection isn't too old (or updated this tick), 
@@ -540,7 +605,7 @@ void ServerControllerView::updateOpticalPoseEstimation(TrackerManager* tracker_m
         if (projections_found > 1)
         {
             // If multiple trackers can see the controller, 
-            // triangulate all pairs of projections and average the results
+            // triangulate the pose from all of their projections at once
             switch (trackingShape.shape_type)
             {
             case eCommonTrackingShapeType::Sphere:
@@ -602,17 +667,22 @@ void ServerControllerView::updateOpticalPoseEstimation(TrackerManager* tracker_m
         if (m_multicam_pose_estimation->bCurrentlyTracking)
         {
             m_multicam_pose_estimation->last_visible_timestamp = now;
+            m_multicam_pose_estimation->capture_timestamp = 
+                computeAverageCaptureTimestamp(
+                    m_tracker_pose_estimations, valid_projection_tracker_ids, projections_found, now);
         }
         m_multicam_pose_estimation->last_update_timestamp = now;
         m_multicam_pose_estimation->bValidTimestamps = true;
+
+        bHasNewOpticalPose = new_projections_found > 0;
     }
 
-	// Update the filter if we have a valid optically tracked pose
-	// TODO: These packets will eventually get posted from the notifyTrackerDataReceived()
-	// callback function which will be called by camera processing threads as new video
-	// frames are received.
-	if (m_multicam_pose_estimation->bCurrentlyTracking)
+	// Update the filter if we have a valid optically tracked pose computed from a new video frame.
+	// Re-posting an old pose would hand the filter the same measurement twice.
+	if (m_multicam_pose_estimation->bCurrentlyTracking && bHasNewOpticalPose)
 	{
+		const t_high_resolution_timepoint capture_timestamp= m_multicam_pose_estimation->capture_timestamp;
+
 		switch (getControllerDeviceType())
 		{
 		case CommonDeviceState::PSMove:
@@ -621,7 +691,7 @@ void ServerControllerView::updateOpticalPoseEstimation(TrackerManager* tracker_m
 
 				post_optical_filter_packet_for_psmove(
 					psmove,
-					now,
+					capture_timestamp,
 					m_multicam_pose_estimation,
 					&m_PoseSensorOpticalPacketQueue);
 			} break;
@@ -631,7 +701,7 @@ void ServerControllerView::updateOpticalPoseEstimation(TrackerManager* tracker_m
 
 				post_optical_filter_packet_for_ds4(
 					ds4,
-					now,
+					capture_timestamp,
 					m_multicam_pose_estimation,
 					&m_PoseSensorOpticalPacketQueue);
 			} break;
@@ -641,7 +711,7 @@ void ServerControllerView::updateOpticalPoseEstimation(TrackerManager* tracker_m
 
 				post_optical_filter_packet_for_virtual_controller(
 					virtual_controller,
-					now,
+					capture_timestamp,
 					m_multicam_pose_estimation,
 					&m_PoseSensorOpticalPacketQueue);
 			} break;
@@ -654,10 +724,14 @@ void ServerControllerView::updateOpticalPoseEstimation(TrackerManager* tracker_m
 void 
 ServerControllerView::notifySensorDataReceived(const CommonDeviceState *sensor_state)
 {
-    // Compute the time in seconds since the last update
-    const t_high_resolution_timepoint now = std::chrono::high_resolution_clock::now();
+    // Stamp the IMU samples with the time the HID packet was read, rather than when we got around to it
+    const t_high_resolution_timepoint now = 
+		sensor_state->hasCaptureTimestamp() 
+		? sensor_state->CaptureTimestamp 
+		: std::chrono::high_resolution_clock::now();
 	t_high_resolution_duration durationSinceLastUpdate= t_high_resolution_duration::zero();
 
+	// Compute the time in seconds since the last update
 	if (m_bIsLastSensorDataTimestampValid)
 	{
 		durationSinceLastUpdate = now - m_lastSensorDataTimestamp;
@@ -700,92 +774,60 @@ ServerControllerView::notifySensorDataReceived(const CommonDeviceState *sensor_s
     m_lastPollSeqNumProcessed = sensor_state->PollSequenceNumber;
 }
 
+void
+ServerControllerView::notifyTrackerDataReceived(
+	int tracker_id, 
+	const ControllerOpticalPoseEstimation *tracker_pose_estimate)
+{
+	assert(tracker_id >= 0 && tracker_id < TrackerManager::k_max_devices);
+
+	// Consumed on the main thread by updateOpticalPoseEstimation()
+	m_TrackerProjectionQueues[tracker_id].enqueue(*tracker_pose_estimate);
+}
+
 void ServerControllerView::updateStateAndPredict()
 {
-	std::vector<PoseSensorPacket> timeSortedPackets;
+	drainSensorPacketQueues();
 
-	// Drain the packet queues filled by the threads
-	PoseSensorPacket packet;
-	while (m_PoseSensorIMUPacketQueue.try_dequeue(packet))
+	while (applyNextSensorPacket())
 	{
-		timeSortedPackets.push_back(packet);
 	}
-	//TODO: m_PoseSensorOpticalPacketQueue is currently getting filled on the main thread by
-	// updateOpticalPoseEstimation() when triangulating the optical pose estimates.
-	// Eventually this work will move to it's own camera processing thread 
-	// this line will read from a lock-less queue just like the IMU packet queue.
-	while (m_PoseSensorOpticalPacketQueue.size() > 0)
-	{		
-		timeSortedPackets.push_back(m_PoseSensorOpticalPacketQueue.front());
-		m_PoseSensorOpticalPacketQueue.pop_front();
-	}
-
-	// Sort the packets in order of ascending time
-	if (timeSortedPackets.size() > 1)
-	{
-		std::sort(
-			timeSortedPackets.begin(), timeSortedPackets.end(), 
-			[](const PoseSensorPacket & a, const PoseSensorPacket & b) -> bool
-			{
-				return a.timestamp < b.timestamp; 
-			});
+}
 
-		t_high_resolution_duration duration= 
-			timeSortedPackets[timeSortedPackets.size()-1].timestamp - timeSortedPackets[0].timestamp;
-		std::chrono::duration<float, std::milli> milli_duration= duration;
+void ServerControllerView::drainSensorPacketQueues()
+{
+	// Drain the packet queues filled by the threads.
+	// Each queue is already in capture time order, so the merger only has to interleave the two.
+	m_PoseSensorPacketMerger.drainQueue(PoseSensorPacketMerger::IMUStream, m_PoseSensorIMUPacketQueue);
+	m_PoseSensorPacketMerger.drainQueue(PoseSensorPacketMerger::OpticalStream, m_PoseSensorOpticalPacketQueue);
 
-		const size_t k_max_process_count= 100;
-		if (timeSortedPackets.size() > k_max_process_count)
-		{
-			const size_t excess= timeSortedPackets.size() - k_max_process_count;
+	notifySensorPacketsDropped(m_PoseSensorPacketMerger.takeDroppedPacketCount());
+}
 
-			SERVER_LOG_WARNING("updatePoseFilter()") << "Incoming packet count: " << timeSortedPackets.size() << " (" << milli_duration.count() << "ms)" << ", trimming: " << excess;
-			timeSortedPackets.erase(timeSortedPackets.begin(), timeSortedPackets.begin()+excess);
-		}
-		else
-		{
-			//SERVER_LOG_DEBUG("updatePoseFilter()") << "Incoming packet count: " << timeSortedPackets.size() << " (" << milli_duration.count() << "ms)";
-		}
+bool ServerControllerView::applyNextSensorPacket()
+{
+	// Process the sensor packets from oldest to newest.
+	// A packet can still be older than ones from earlier updates
+	// (optical packets arrive well after the IMU packets captured at the same time).
+	// The filter history rewinds the filter to apply those at their capture time and replays the newer packets.
+	PoseSensorPacket sensorPacket;
+	if (!m_PoseSensorPacketMerger.popOldestPacket(sensorPacket))
+	{
+		return false;
 	}
 
-	// Process the sensor packets from oldest to newest
-	for (const PoseSensorPacket &sensorPacket : timeSortedPackets)
-    {
-		// Compute the time since the last packet
-		float time_delta_seconds;
-		if (m_last_filter_update_timestamp_valid)
-		{
-			const std::chrono::duration<float, std::milli> time_delta = sensorPacket.timestamp - m_last_filter_update_timestamp;
-			const float time_delta_milli = time_delta.count();
-
-			// convert delta to seconds clamp time delta between 2500hz and 30hz
-			time_delta_seconds = clampf(time_delta_milli / 1000.f, k_min_time_delta_seconds, k_max_time_delta_seconds);
-		}
-		else
-		{
-			time_delta_seconds = k_max_time_delta_seconds;
-		}
-
-		m_last_filter_update_timestamp = sensorPacket.timestamp;
-		m_last_filter_update_timestamp_valid = true;
-
-		{
-			PoseFilterPacket filter_packet;
-			filter_packet.clear();
-
-			// Create a filter input packet from the sensor data 
-			// and the filter's previous orientation and position
-			m_pose_filter_space->createFilterPacket(
-				sensorPacket,
-				m_pose_filter,
-				filter_packet);
-			// Process the filter packet
-			m_pose_filter->update(time_delta_seconds, filter_packet);
-		}
+	if (m_pose_filter_history != nullptr &&
+		m_pose_filter_history->applySensorPacket(sensorPacket))
+	{
+		// Track the end-to-end latency of the samples fed into the published pose
+		notifySampleFused(sensorPacket.timestamp);
 
 		// Flag the state as unpublished, which will trigger an update to the client
 		markStateAsUnpublished();
 	}
+	// else no filter to apply it to, or too old to rewind to
+
+	return true;
 }
 
 bool ServerControllerView::setHostBluetoothAddress(
@@ -796,6 +838,43 @@ bool ServerControllerView::setHostBluetoothAddress(
 
 CommonDevicePose
 ServerControllerView::getFilteredPose(float time) const
+{
+    if (m_filteredPoseCache.getIsActive())
+    {
+        // The streams being published share one prediction per prediction time
+        CommonDevicePose pose;
+        if (!m_filteredPoseCache.fetchPose(time, pose))
+        {
+            pose= compute_filtered_pose(time);
+            m_filteredPoseCache.storePose(time, pose);
+        }
+
+        return pose;
+    }
+
+    return compute_filtered_pose(time);
+}
+
+CommonDevicePhysics
+ServerControllerView::getFilteredPhysics() const
+{
+    if (m_filteredPoseCache.getIsActive())
+    {
+        CommonDevicePhysics physics;
+        if (!m_filteredPoseCache.fetchPhysics(physics))
+        {
+            physics= compute_filtered_physics();
+            m_filteredPoseCache.storePhysics(physics);
+        }
+
+        return physics;
+    }
+
+    return compute_filtered_physics();
+}
+
+CommonDevicePose
+ServerControllerView::compute_filtered_pose(float time) const
 {
     CommonDevicePose pose;
 
@@ -819,8 +898,8 @@ ServerControllerView::getFilteredPose(float time) const
     return pose;
 }
 
-CommonDevicePhysics 
-ServerControllerView::getFilteredPhysics() const
+CommonDevicePhysics
+ServerControllerView::compute_filtered_physics() const
 {
     CommonDevicePhysics physics;
 
@@ -1223,9 +1302,12 @@ bool ServerControllerView::setControllerRumble(
 void ServerControllerView::publish_device_data_frame()
 {
     // Tell the server request handler we want to send out controller updates.
-    // This will call generate_controller_data_frame_for_stream for each listening connection.
+    // This will call generate_controller_data_frame_for_stream, or generate_compact_controller_data_frame_for_stream
+    // for connections that asked for compact data frames, for each listening connection.
     ServerRequestHandler::get_instance()->publish_controller_data_frame(
-        this, &ServerControllerView::generate_controller_data_frame_for_stream);
+        this,
+        &ServerControllerView::generate_controller_data_frame_for_stream,
+        &ServerControllerView::generate_compact_controller_data_frame_for_stream);
 }
 
 void ServerControllerView::generate_controller_data_frame_for_stream(
@@ -1265,6 +1347,100 @@ void ServerControllerView::generate_controller_data_frame_for_stream(
     data_frame->set_device_category(PSMoveProtocol::DeviceOutputDataFrame::CONTROLLER);
 }
 
+void ServerControllerView::generate_compact_controller_data_frame_for_stream(
+    const ServerControllerView *controller_view,
+    const ControllerStreamInfo *stream_info,
+    CompactControllerDataFrame *compact_frame)
+{
+    initCompactDataFrameHeader(*compact_frame, PSMoveProtocol::DeviceOutputDataFrame::CONTROLLER);
+
+    compact_frame->controller_id= controller_view->getDeviceID();
+    compact_frame->sequence_num= controller_view->m_sequence_number;
+    compact_frame->flags= getCompactDataFrameFlag(controller_view->getDevice()->getIsOpen(), CompactDataFrameFlag_IsConnected);
+
+    switch (controller_view->getControllerDeviceType())
+    {
+    case CommonControllerState::PSMove:
+        {
+            generate_psmove_compact_data_frame_for_stream(controller_view, stream_info, compact_frame);
+        } break;
+    case CommonControllerState::PSNavi:
+        {
+            generate_psnavi_compact_data_frame_for_stream(controller_view, stream_info, compact_frame);
+        } break;
+    case CommonControllerState::PSDualShock4:
+        {
+            generate_psdualshock4_compact_data_frame_for_stream(controller_view, stream_info, compact_frame);
+        } break;
+    case CommonControllerState::VirtualController:
+        {
+            generate_virtual_controller_compact_data_frame_for_stream(controller_view, stream_info, compact_frame);
+        } break;
+    default:
+        assert(0 && "Unhandled controller type");
+    }
+}
+
+static unsigned int get_psmove_button_bitmask(const PSMoveControllerInputState *psmove_state)
+{
+    unsigned int button_bitmask= 0;
+    SET_BUTTON_BIT(button_bitmask, PSMoveProtocol::DeviceOutputDataFrame_ControllerDataPacket::TRIANGLE, psmove_state->Triangle);
+    SET_BUTTON_BIT(button_bitmask, PSMoveProtocol::DeviceOutputDataFrame_ControllerDataPacket::CIRCLE, psmove_state->Circle);
+    SET_BUTTON_BIT(button_bitmask, PSMoveProtocol::DeviceOutputDataFrame_ControllerDataPacket::CROSS, psmove_state->Cross);
+    SET_BUTTON_BIT(button_bitmask, PSMoveProtocol::DeviceOutputDataFrame_ControllerDataPacket::SQUARE, psmove_state->Square);
+    SET_BUTTON_BIT(button_bitmask, PSMoveProtocol::DeviceOutputDataFrame_ControllerDataPacket::SELECT, psmove_state->Select);
+    SET_BUTTON_BIT(button_bitmask, PSMoveProtocol::DeviceOutputDataFrame_ControllerDataPacket::START, psmove_state->Start);
+    SET_BUTTON_BIT(button_bitmask, PSMoveProtocol::DeviceOutputDataFrame_ControllerDataPacket::PS, psmove_state->PS);
+    SET_BUTTON_BIT(button_bitmask, PSMoveProtocol::DeviceOutputDataFrame_ControllerDataPacket::MOVE, psmove_state->Move);
+    SET_BUTTON_BIT(button_bitmask, PSMoveProtocol::DeviceOutputDataFrame_ControllerDataPacket::TRIGGER, psmove_state->Trigger);
+    return button_bitmask;
+}
+
+static unsigned int get_psnavi_button_bitmask(const PSNaviControllerInputState *psnavi_state)
+{
+    unsigned int button_bitmask= 0;
+    SET_BUTTON_BIT(button_bitmask, PSMoveProtocol::DeviceOutputDataFrame_ControllerDataPacket::L1, psnavi_state->L1);
+    SET_BUTTON_BIT(button_bitmask, PSMoveProtocol::DeviceOutputDataFrame_ControllerDataPacket::L2, psnavi_state->L2);
+    SET_BUTTON_BIT(button_bitmask, PSMoveProtocol::DeviceOutputDataFrame_ControllerDataPacket::TRIGGER, psnavi_state->L2);
+    SET_BUTTON_BIT(button_bitmask, PSMoveProtocol::DeviceOutputDataFrame_ControllerDataPacket::L3, psnavi_state->L3);
+    SET_BUTTON_BIT(button_bitmask, PSMoveProtocol::DeviceOutputDataFrame_ControllerDataPacket::CIRCLE, psnavi_state->Circle);
+    SET_BUTTON_BIT(button_bitmask, PSMoveProtocol::DeviceOutputDataFrame_ControllerDataPacket::CROSS, psnavi_state->Cross);
+    SET_BUTTON_BIT(button_bitmask, PSMoveProtocol::DeviceOutputDataFrame_ControllerDataPacket::PS, psnavi_state->PS);
+    SET_BUTTON_BIT(button_bitmask, PSMoveProtocol::DeviceOutputDataFrame_ControllerDataPacket::UP, psnavi_state->DPad_Up);
+    SET_BUTTON_BIT(button_bitmask, PSMoveProtocol::DeviceOutputDataFrame_ControllerDataPacket::RIGHT, psnavi_state->DPad_Right);
+    SET_BUTTON_BIT(button_bitmask, PSMoveProtocol::DeviceOutputDataFrame_ControllerDataPacket::DOWN, psnavi_state->DPad_Down);
+    SET_BUTTON_BIT(button_bitmask, PSMoveProtocol::DeviceOutputDataFrame_ControllerDataPacket::LEFT, psnavi_state->DPad_Left);
+    return button_bitmask;
+}
+
+static unsigned int get_psdualshock4_button_bitmask(const DualShock4ControllerInputState *psds4_state)
+{
+    unsigned int button_bitmask= 0;
+    SET_BUTTON_BIT(button_bitmask, PSMoveProtocol::DeviceOutputDataFrame_ControllerDataPacket::UP, psds4_state->DPad_Up);
+    SET_BUTTON_BIT(button_bitmask, PSMoveProtocol::DeviceOutputDataFrame_ControllerDataPacket::DOWN, psds4_state->DPad_Down);
+    SET_BUTTON_BIT(button_bitmask, PSMoveProtocol::DeviceOutputDataFrame_ControllerDataPacket::LEFT, psds4_state->DPad_Left);
+    SET_BUTTON_BIT(button_bitmask, PSMoveProtocol::DeviceOutputDataFrame_ControllerDataPacket::RIGHT, psds4_state->DPad_Right);
+
+    SET_BUTTON_BIT(button_bitmask, PSMoveProtocol::DeviceOutputDataFrame_ControllerDataPacket::L1, psds4_state->L1);
+    SET_BUTTON_BIT(button_bitmask, PSMoveProtocol::DeviceOutputDataFrame_ControllerDataPacket::R1, psds4_state->R1);
+    SET_BUTTON_BIT(button_bitmask, PSMoveProtocol::DeviceOutputDataFrame_ControllerDataPacket::L2, psds4_state->L2);
+    SET_BUTTON_BIT(button_bitmask, PSMoveProtocol::DeviceOutputDataFrame_ControllerDataPacket::R2, psds4_state->R2);
+    SET_BUTTON_BIT(button_bitmask, PSMoveProtocol::DeviceOutputDataFrame_ControllerDataPacket::L3, psds4_state->L3);
+    SET_BUTTON_BIT(button_bitmask, PSMoveProtocol::DeviceOutputDataFrame_ControllerDataPacket::R3, psds4_state->R3);
+
+    SET_BUTTON_BIT(button_bitmask, PSMoveProtocol::DeviceOutputDataFrame_ControllerDataPacket::TRIANGLE, psds4_state->Triangle);
+    SET_BUTTON_BIT(button_bitmask, PSMoveProtocol::DeviceOutputDataFrame_ControllerDataPacket::CIRCLE, psds4_state->Circle);
+    SET_BUTTON_BIT(button_bitmask, PSMoveProtocol::DeviceOutputDataFrame_ControllerDataPacket::CROSS, psds4_state->Cross);
+    SET_BUTTON_BIT(button_bitmask, PSMoveProtocol::DeviceOutputDataFrame_ControllerDataPacket::SQUARE, psds4_state->Square);
+
+    SET_BUTTON_BIT(button_bitmask, PSMoveProtocol::DeviceOutputDataFrame_ControllerDataPacket::SHARE, psds4_state->Share);
+    SET_BUTTON_BIT(button_bitmask, PSMoveProtocol::DeviceOutputDataFrame_ControllerDataPacket::OPTIONS, psds4_state->Options);
+
+    SET_BUTTON_BIT(button_bitmask, PSMoveProtocol::DeviceOutputDataFrame_ControllerDataPacket::PS, psds4_state->PS);
+    SET_BUTTON_BIT(button_bitmask, PSMoveProtocol::DeviceOutputDataFrame_ControllerDataPacket::TRACKPAD, psds4_state->TrackPadButton);
+    return button_bitmask;
+}
+
 static void generate_psmove_data_frame_for_stream(
     const ServerControllerView *controller_view,
     const ControllerStreamInfo *stream_info,
@@ -1311,17 +1487,7 @@ static void generate_psmove_data_frame_for_stream(
         psmove_data_frame->set_trigger_value(psmove_state->TriggerValue);
         psmove_data_frame->set_battery_value(psmove_state->BatteryValue);
 
-        unsigned int button_bitmask= 0;
-        SET_BUTTON_BIT(button_bitmask, PSMoveProtocol::DeviceOutputDataFrame_ControllerDataPacket::TRIANGLE, psmove_state->Triangle);
-        SET_BUTTON_BIT(button_bitmask, PSMoveProtocol::DeviceOutputDataFrame_ControllerDataPacket::CIRCLE, psmove_state->Circle);
-        SET_BUTTON_BIT(button_bitmask, PSMoveProtocol::DeviceOutputDataFrame_ControllerDataPacket::CROSS, psmove_state->Cross);
-        SET_BUTTON_BIT(button_bitmask, PSMoveProtocol::DeviceOutputDataFrame_ControllerDataPacket::SQUARE, psmove_state->Square);
-        SET_BUTTON_BIT(button_bitmask, PSMoveProtocol::DeviceOutputDataFrame_ControllerDataPacket::SELECT, psmove_state->Select);
-        SET_BUTTON_BIT(button_bitmask, PSMoveProtocol::DeviceOutputDataFrame_ControllerDataPacket::START, psmove_state->Start);
-        SET_BUTTON_BIT(button_bitmask, PSMoveProtocol::DeviceOutputDataFrame_ControllerDataPacket::PS, psmove_state->PS);
-        SET_BUTTON_BIT(button_bitmask, PSMoveProtocol::DeviceOutputDataFrame_ControllerDataPacket::MOVE, psmove_state->Move);
-        SET_BUTTON_BIT(button_bitmask, PSMoveProtocol::DeviceOutputDataFrame_ControllerDataPacket::TRIGGER, psmove_state->Trigger);
-        controller_data_frame->set_button_down_bitmask(button_bitmask);
+        controller_data_frame->set_button_down_bitmask(get_psmove_button_bitmask(psmove_state));
 
         // If requested, get the raw sensor data for the controller
         if (stream_info->include_raw_sensor_data)
@@ -1492,19 +1658,7 @@ static void generate_psnavi_data_frame_for_stream(
         psnavi_data_frame->set_stick_xaxis(psnavi_state->Stick_XAxis);
         psnavi_data_frame->set_stick_yaxis(psnavi_state->Stick_YAxis);
 
-        unsigned int button_bitmask= 0;
-        SET_BUTTON_BIT(button_bitmask, PSMoveProtocol::DeviceOutputDataFrame_ControllerDataPacket::L1, psnavi_state->L1);
-        SET_BUTTON_BIT(button_bitmask, PSMoveProtocol::DeviceOutputDataFrame_ControllerDataPacket::L2, psnavi_state->L2);
-        SET_BUTTON_BIT(button_bitmask, PSMoveProtocol::DeviceOutputDataFrame_ControllerDataPacket::TRIGGER, psnavi_state->L2);
-        SET_BUTTON_BIT(button_bitmask, PSMoveProtocol::DeviceOutputDataFrame_ControllerDataPacket::L3, psnavi_state->L3);
-        SET_BUTTON_BIT(button_bitmask, PSMoveProtocol::DeviceOutputDataFrame_ControllerDataPacket::CIRCLE, psnavi_state->Circle);
-        SET_BUTTON_BIT(button_bitmask, PSMoveProtocol::DeviceOutputDataFrame_ControllerDataPacket::CROSS, psnavi_state->Cross);
-        SET_BUTTON_BIT(button_bitmask, PSMoveProtocol::DeviceOutputDataFrame_ControllerDataPacket::PS, psnavi_state->PS);
-        SET_BUTTON_BIT(button_bitmask, PSMoveProtocol::DeviceOutputDataFrame_ControllerDataPacket::UP, psnavi_state->DPad_Up);
-        SET_BUTTON_BIT(button_bitmask, PSMoveProtocol::DeviceOutputDataFrame_ControllerDataPacket::RIGHT, psnavi_state->DPad_Right);
-        SET_BUTTON_BIT(button_bitmask, PSMoveProtocol::DeviceOutputDataFrame_ControllerDataPacket::DOWN, psnavi_state->DPad_Down);
-        SET_BUTTON_BIT(button_bitmask, PSMoveProtocol::DeviceOutputDataFrame_ControllerDataPacket::LEFT, psnavi_state->DPad_Left);
-        controller_data_frame->set_button_down_bitmask(button_bitmask);
+        controller_data_frame->set_button_down_bitmask(get_psnavi_button_bitmask(psnavi_state));
     }
 
     controller_data_frame->set_controller_type(PSMoveProtocol::PSNAVI);
@@ -1562,30 +1716,7 @@ static void generate_psdualshock4_data_frame_for_stream(
         psds4_data_frame->set_left_trigger_value(psds4_state->LeftTrigger);
         psds4_data_frame->set_right_trigger_value(psds4_state->RightTrigger);
 
-        unsigned int button_bitmask = 0;
-        SET_BUTTON_BIT(button_bitmask, PSMoveProtocol::DeviceOutputDataFrame_ControllerDataPacket::UP, psds4_state->DPad_Up);
-        SET_BUTTON_BIT(button_bitmask, PSMoveProtocol::DeviceOutputDataFrame_ControllerDataPacket::DOWN, psds4_state->DPad_Down);
-        SET_BUTTON_BIT(button_bitmask, PSMoveProtocol::DeviceOutputDataFrame_ControllerDataPacket::LEFT, psds4_state->DPad_Left);
-        SET_BUTTON_BIT(button_bitmask, PSMoveProtocol::DeviceOutputDataFrame_ControllerDataPacket::RIGHT, psds4_state->DPad_Right);
-
-        SET_BUTTON_BIT(button_bitmask, PSMoveProtocol::DeviceOutputDataFrame_ControllerDataPacket::L1, psds4_state->L1);
-        SET_BUTTON_BIT(button_bitmask, PSMoveProtocol::DeviceOutputDataFrame_ControllerDataPacket::R1, psds4_state->R1);
-        SET_BUTTON_BIT(button_bitmask, PSMoveProtocol::DeviceOutputDataFrame_ControllerDataPacket::L2, psds4_state->L2);
-        SET_BUTTON_BIT(button_bitmask, PSMoveProtocol::DeviceOutputDataFrame_ControllerDataPacket::R2, psds4_state->R2);
-        SET_BUTTON_BIT(button_bitmask, PSMoveProtocol::DeviceOutputDataFrame_ControllerDataPacket::L3, psds4_state->L3);
-        SET_BUTTON_BIT(button_bitmask, PSMoveProtocol::DeviceOutputDataFrame_ControllerDataPacket::R3, psds4_state->R3);
-
-        SET_BUTTON_BIT(button_bitmask, PSMoveProtocol::DeviceOutputDataFrame_ControllerDataPacket::TRIANGLE, psds4_state->Triangle);
-        SET_BUTTON_BIT(button_bitmask, PSMoveProtocol::DeviceOutputDataFrame_ControllerDataPacket::CIRCLE, psds4_state->Circle);
-        SET_BUTTON_BIT(button_bitmask, PSMoveProtocol::DeviceOutputDataFrame_ControllerDataPacket::CROSS, psds4_state->Cross);
-        SET_BUTTON_BIT(button_bitmask, PSMoveProtocol::DeviceOutputDataFrame_ControllerDataPacket::SQUARE, psds4_state->Square);
-
-        SET_BUTTON_BIT(button_bitmask, PSMoveProtocol::DeviceOutputDataFrame_ControllerDataPacket::SHARE, psds4_state->Share);
-        SET_BUTTON_BIT(button_bitmask, PSMoveProtocol::DeviceOutputDataFrame_ControllerDataPacket::OPTIONS, psds4_state->Options);
-
-        SET_BUTTON_BIT(button_bitmask, PSMoveProtocol::DeviceOutputDataFrame_ControllerDataPacket::PS, psds4_state->PS);
-        SET_BUTTON_BIT(button_bitmask, PSMoveProtocol::DeviceOutputDataFrame_ControllerDataPacket::TRACKPAD, psds4_state->TrackPadButton);
-        controller_data_frame->set_button_down_bitmask(button_bitmask);
+        controller_data_frame->set_button_down_bitmask(get_psdualshock4_button_bitmask(psds4_state));
 
         // If requested, get the raw sensor data for the controller
         if (stream_info->include_raw_sensor_data)
@@ -1894,6 +2025,152 @@ static void generate_virtual_controller_data_frame_for_stream(
     controller_data_frame->set_controller_type(PSMoveProtocol::VIRTUALCONTROLLER);
 }
 
+static void generate_psmove_compact_data_frame_for_stream(
+    const ServerControllerView *controller_view,
+    const ControllerStreamInfo *stream_info,
+    CompactControllerDataFrame *compact_frame)
+{
+    const PSMoveController *psmove_controller= controller_view->castCheckedConst<PSMoveController>();
+    const IPoseFilter *pose_filter= controller_view->getPoseFilter();
+    const PSMoveControllerConfig *psmove_config= psmove_controller->getConfig();
+    const CommonControllerState *controller_state= controller_view->getState();
+
+    if (controller_state != nullptr)
+    {
+        assert(controller_state->DeviceType == CommonDeviceState::PSMove);
+        const PSMoveControllerInputState * psmove_state= static_cast<const PSMoveControllerInputState *>(controller_state);
+        const CommonDevicePose controller_pose= controller_view->getFilteredPose(psmove_config->prediction_time);
+
+        compact_frame->flags|=
+            getCompactDataFrameFlag(psmove_config->is_valid, CompactDataFrameFlag_HasValidHardwareCalibration) |
+            getCompactDataFrameFlag(controller_view->getIsTrackingEnabled(), CompactDataFrameFlag_IsTrackingEnabled) |
+            getCompactDataFrameFlag(controller_view->getIsCurrentlyTracking(), CompactDataFrameFlag_IsCurrentlyTracking) |
+            getCompactDataFrameFlag(pose_filter->getIsOrientationStateValid(), CompactDataFrameFlag_IsOrientationValid) |
+            getCompactDataFrameFlag(pose_filter->getIsPositionStateValid(), CompactDataFrameFlag_IsPositionValid);
+        compact_frame->button_down_bitmask= get_psmove_button_bitmask(psmove_state);
+        ServerDeviceView::encodeCompactPose(controller_pose, stream_info->include_position_data, compact_frame->pose);
+
+        if (stream_info->include_physics_data)
+        {
+            ServerDeviceView::encodeCompactPhysics(controller_view->getFilteredPhysics(), true, compact_frame->physics);
+            compact_frame->flags|= CompactDataFrameFlag_HasPhysicsData;
+        }
+
+        compact_frame->psmove_state.trigger_value= psmove_state->TriggerValue;
+        compact_frame->psmove_state.battery_value= static_cast<uint8_t>(psmove_state->BatteryValue);
+    }
+
+    compact_frame->controller_type= PSMoveProtocol::PSMOVE;
+}
+
+static void generate_psnavi_compact_data_frame_for_stream(
+    const ServerControllerView *controller_view,
+    const ControllerStreamInfo *stream_info,
+    CompactControllerDataFrame *compact_frame)
+{
+    const CommonControllerState *controller_state= controller_view->getState();
+
+    if (controller_state != nullptr)
+    {
+        assert(controller_state->DeviceType == CommonDeviceState::PSNavi);
+        const PSNaviControllerInputState *psnavi_state= static_cast<const PSNaviControllerInputState *>(controller_state);
+
+        compact_frame->button_down_bitmask= get_psnavi_button_bitmask(psnavi_state);
+        compact_frame->psnavi_state.trigger_value= psnavi_state->Trigger;
+        compact_frame->psnavi_state.stick_xaxis= psnavi_state->Stick_XAxis;
+        compact_frame->psnavi_state.stick_yaxis= psnavi_state->Stick_YAxis;
+    }
+
+    compact_frame->controller_type= PSMoveProtocol::PSNAVI;
+}
+
+static void generate_psdualshock4_compact_data_frame_for_stream(
+    const ServerControllerView *controller_view,
+    const ControllerStreamInfo *stream_info,
+    CompactControllerDataFrame *compact_frame)
+{
+    const PSDualShock4Controller *ds4_controller= controller_view->castCheckedConst<PSDualShock4Controller>();
+    const IPoseFilter *pose_filter= controller_view->getPoseFilter();
+    const PSDualShock4ControllerConfig *ds4_config= ds4_controller->getConfig();
+    const CommonControllerState *controller_state= controller_view->getState();
+
+    if (controller_state != nullptr)
+    {
+        assert(controller_state->DeviceType == CommonDeviceState::PSDualShock4);
+        const DualShock4ControllerInputState * psds4_state= static_cast<const DualShock4ControllerInputState *>(controller_state);
+        const CommonDevicePose controller_pose= controller_view->getFilteredPose(ds4_config->prediction_time);
+
+        compact_frame->flags|=
+            getCompactDataFrameFlag(ds4_config->is_valid, CompactDataFrameFlag_HasValidHardwareCalibration) |
+            getCompactDataFrameFlag(controller_view->getIsTrackingEnabled(), CompactDataFrameFlag_IsTrackingEnabled) |
+            getCompactDataFrameFlag(controller_view->getIsCurrentlyTracking(), CompactDataFrameFlag_IsCurrentlyTracking) |
+            getCompactDataFrameFlag(pose_filter->getIsOrientationStateValid(), CompactDataFrameFlag_IsOrientationValid) |
+            getCompactDataFrameFlag(pose_filter->getIsPositionStateValid(), CompactDataFrameFlag_IsPositionValid);
+        compact_frame->button_down_bitmask= get_psdualshock4_button_bitmask(psds4_state);
+        ServerDeviceView::encodeCompactPose(controller_pose, stream_info->include_position_data, compact_frame->pose);
+
+        if (stream_info->include_physics_data)
+        {
+            ServerDeviceView::encodeCompactPhysics(controller_view->getFilteredPhysics(), true, compact_frame->physics);
+            compact_frame->flags|= CompactDataFrameFlag_HasPhysicsData;
+        }
+
+        compact_frame->psdualshock4_state.left_thumbstick_x= psds4_state->LeftAnalogX;
+        compact_frame->psdualshock4_state.left_thumbstick_y= psds4_state->LeftAnalogY;
+        compact_frame->psdualshock4_state.right_thumbstick_x= psds4_state->RightAnalogX;
+        compact_frame->psdualshock4_state.right_thumbstick_y= psds4_state->RightAnalogY;
+        compact_frame->psdualshock4_state.left_trigger_value= psds4_state->LeftTrigger;
+        compact_frame->psdualshock4_state.right_trigger_value= psds4_state->RightTrigger;
+    }
+
+    compact_frame->controller_type= PSMoveProtocol::PSDUALSHOCK4;
+}
+
+static void generate_virtual_controller_compact_data_frame_for_stream(
+    const ServerControllerView *controller_view,
+    const ControllerStreamInfo *stream_info,
+    CompactControllerDataFrame *compact_frame)
+{
+    const VirtualController *virtual_controller= controller_view->castCheckedConst<VirtualController>();
+    const IPoseFilter *pose_filter= controller_view->getPoseFilter();
+    const VirtualControllerConfig *controller_config= virtual_controller->getConfig();
+    const CommonControllerState *controller_state= controller_view->getState();
+
+    if (controller_state != nullptr)
+    {
+        assert(controller_state->DeviceType == CommonDeviceState::VirtualController);
+        const VirtualControllerState * virtual_controller_state= static_cast<const VirtualControllerState *>(controller_state);
+        const CommonDevicePose controller_pose= controller_view->getFilteredPose(controller_config->prediction_time);
+        CompactVirtualControllerState &compact_state= compact_frame->virtual_controller_state;
+        const int axis_count= std::min(virtual_controller_state->numAxes, PSM_MAX_VIRTUAL_CONTROLLER_AXES);
+
+        compact_frame->flags|=
+            getCompactDataFrameFlag(controller_view->getIsTrackingEnabled(), CompactDataFrameFlag_IsTrackingEnabled) |
+            getCompactDataFrameFlag(controller_view->getIsCurrentlyTracking(), CompactDataFrameFlag_IsCurrentlyTracking) |
+            getCompactDataFrameFlag(pose_filter->getIsPositionStateValid(), CompactDataFrameFlag_IsPositionValid);
+        compact_frame->button_down_bitmask= controller_state->AllButtons;
+        ServerDeviceView::encodeCompactPosition(controller_pose.PositionCm, stream_info->include_position_data, compact_frame->pose);
+
+        // Virtual controllers have no orientation, so only the linear physics terms get sent
+        if (stream_info->include_physics_data)
+        {
+            ServerDeviceView::encodeCompactPhysics(controller_view->getFilteredPhysics(), false, compact_frame->physics);
+            compact_frame->flags|= CompactDataFrameFlag_HasPhysicsData;
+        }
+
+        compact_state.vendor_id= virtual_controller_state->vendorID;
+        compact_state.product_id= virtual_controller_state->productID;
+        compact_state.num_buttons= static_cast<uint8_t>(virtual_controller_state->numButtons);
+        compact_state.num_axes= static_cast<uint8_t>(axis_count);
+        for (int axisIndex = 0; axisIndex < axis_count; ++axisIndex)
+        {
+            compact_state.axis_states[axisIndex]= virtual_controller_state->axisStates[axisIndex];
+        }
+    }
+
+    compact_frame->controller_type= PSMoveProtocol::VIRTUALCONTROLLER;
+}
+
 static IPoseFilter *
 pose_filter_factory(
     const CommonDeviceState::eDeviceType deviceType,
@@ -1903,20 +2180,25 @@ pose_filter_factory(
 {
     static IPoseFilter *filter= nullptr;
 
-    if (position_filter_type == "PoseKalman" && orientation_filter_type == "PoseKalman")
+    if ((position_filter_type == "PoseKalman" && orientation_filter_type == "PoseKalman") ||
+        (position_filter_type == "PoseKalmanFloat" && orientation_filter_type == "PoseKalmanFloat"))
     {
+        // "PoseKalmanFloat" runs the same filter in single precision
+        const KalmanFilterScalarType scalar_type=
+            (position_filter_type == "PoseKalmanFloat") ? KalmanFilterScalarFloat : KalmanFilterScalarDouble;
+
         switch (deviceType)
         {
         case CommonDeviceState::PSMove:
         case CommonDeviceState::VirtualController:
             {
-                KalmanPoseFilterPSMove *kalmanFilter = new KalmanPoseFilterPSMove();
+                KalmanPoseFilterPSMove *kalmanFilter = new KalmanPoseFilterPSMove(scalar_type);
                 kalmanFilter->init(constants);
                 filter= kalmanFilter;
             } break;
         case CommonDeviceState::PSDualShock4:
             {
-                KalmanPoseFilterDS4 *kalmanFilter = new KalmanPoseFilterDS4();
+                KalmanPoseFilterDS4 *kalmanFilter = new KalmanPoseFilterDS4(scalar_type);
                 kalmanFilter->init(constants);
                 filter= kalmanFilter;
             } break;
@@ -2006,6 +2288,10 @@ pose_filter_factory(
         {
             orientation_filter_enum = OrientationFilterTypeKalman;
         }
+        else if (orientation_filter_type == "OrientationKalmanFloat")
+        {
+            orientation_filter_enum = OrientationFilterTypeKalmanFloat;
+        }
         else
         {
             SERVER_LOG_INFO("pose_filter_factory()") << 
@@ -2028,8 +2314,12 @@ pose_filter_factory(
             }
         }
 
+        // Controllers share a batch that runs their Madgwick/complementary orientation filters side by side
+        OrientationFilterBatch *orientation_batch=
+            DeviceManager::getInstance()->m_controller_manager->getOrientationFilterBatch();
+
         CompoundPoseFilter *compound_pose_filter = new CompoundPoseFilter();
-        compound_pose_filter->init(deviceType, orientation_filter_enum, position_filter_enum, constants);
+        compound_pose_filter->init(deviceType, orientation_filter_enum, position_filter_enum, constants, orientation_batch);
         filter= compound_pose_filter;
     }
 
@@ -2315,7 +2605,7 @@ static void post_imu_filter_packets_for_psmove(
 
 static void post_optical_filter_packet_for_psmove(
     const PSMoveController *psmove,
-    const t_high_resolution_timepoint now,
+    const t_high_resolution_timepoint capture_timestamp,
     const ControllerOpticalPoseEstimation *pose_estimation,
 	t_controller_pose_optical_queue *pose_filter_queue)
 {
@@ -2323,7 +2613,7 @@ static void post_optical_filter_packet_for_psmove(
     PoseSensorPacket sensor_packet;
 
     sensor_packet.clear();
-	sensor_packet.timestamp= now;
+	sensor_packet.timestamp= capture_timestamp;
 
     // PSMove cant do optical orientation
     sensor_packet.optical_orientation = Eigen::Quaternionf::Identity();
@@ -2339,7 +2629,7 @@ static void post_optical_filter_packet_for_psmove(
 		sensor_packet.tracking_projection_area_px_sqr= pose_estimation->projection.screen_area;
     }
 
-	pose_filter_queue->push_back(sensor_packet);
+	pose_filter_queue->enqueue(sensor_packet);
 }
 
 static void post_imu_filter_packets_for_ds4(
@@ -2384,7 +2674,7 @@ static void post_imu_filter_packets_for_ds4(
 
 static void post_optical_filter_packet_for_ds4(
     const PSDualShock4Controller *ds4,
-    const t_high_resolution_timepoint now,
+    const t_high_resolution_timepoint capture_timestamp,
     const ControllerOpticalPoseEstimation *pose_estimation,
 	t_controller_pose_optical_queue *pose_filter_queue)
 {
@@ -2393,7 +2683,7 @@ static void post_optical_filter_packet_for_ds4(
     PoseSensorPacket sensor_packet;
 
     sensor_packet.clear();
-	sensor_packet.timestamp= now;
+	sensor_packet.timestamp= capture_timestamp;
 
     if (pose_estimation->bOrientationValid)
     {
@@ -2419,12 +2709,12 @@ static void post_optical_filter_packet_for_ds4(
 		sensor_packet.tracking_projection_area_px_sqr= screen_area;
     }
 
-	pose_filter_queue->push_back(sensor_packet);
+	pose_filter_queue->enqueue(sensor_packet);
 }
 
 static void post_optical_filter_packet_for_virtual_controller(
     const VirtualController *virtual_controller,
-    const t_high_resolution_timepoint now,
+    const t_high_resolution_timepoint capture_timestamp,
     const ControllerOpticalPoseEstimation *pose_estimation,
 	t_controller_pose_optical_queue *pose_filter_queue)
 {
@@ -2433,7 +2723,7 @@ static void post_optical_filter_packet_for_virtual_controller(
     PoseSensorPacket sensor_packet;
 
     sensor_packet.clear();
-	sensor_packet.timestamp= now;
+	sensor_packet.timestamp= capture_timestamp;
 
 	// Virtual controllers don't currently support an optical orientation
 	sensor_packet.optical_orientation = Eigen::Quaternionf::Identity();
@@ -2448,7 +2738,7 @@ static void post_optical_filter_packet_for_virtual_controller(
 		sensor_packet.tracking_projection_area_px_sqr= pose_estimation->projection.screen_area;
     }
 
-	pose_filter_queue->push_back(sensor_packet);
+	pose_filter_queue->enqueue(sensor_packet);
 }
 
 static void computeSpherePoseForControllerFromSingleTracker(
@@ -2515,6 +2805,31 @@ static void computeLightBarPoseForControllerFromSingleTracker(
     }
 }
 
+// Opposed trackers see the device from opposite sides of the tracking volume,
+// which makes for a poorly conditioned triangulation when they are the only trackers available
+static bool hasNonOpposedTrackerPair(
+    const ServerTrackerView * const *trackers,
+    const int tracker_count)
+{
+    for (int list_index = 0; list_index < tracker_count; ++list_index)
+    {
+        const CommonDevicePosition tracker_position = trackers[list_index]->getTrackerPose().PositionCm;
+
+        for (int other_list_index = list_index + 1; other_list_index < tracker_count; ++other_list_index)
+        {
+            const CommonDevicePosition other_tracker_position = trackers[other_list_index]->getTrackerPose().PositionCm;
+
+            if ((tracker_position.x > 0) != (other_tracker_position.x < 0) ||
+                (tracker_position.z > 0) != (other_tracker_position.z < 0))
+            {
+                return true;
+            }
+        }
+    }
+
+    return false;
+}
+
 static void computeSpherePoseForControllerFromMultipleTrackers(
     const ServerControllerView *controllerView,
     const TrackerManager* tracker_manager,
@@ -2528,95 +2843,67 @@ static void computeSpherePoseForControllerFromMultipleTrackers(
 
     // Project the tracker relative 3d tracking position back on to the tracker camera plane
     // and sum up the total controller projection area across all trackers
+    const ServerTrackerView *tracker_list[TrackerManager::k_max_devices];
     CommonDeviceScreenLocation position2d_list[TrackerManager::k_max_devices];
+    int biggest_projection_id = -1;
     for (int list_index = 0; list_index < projections_found; ++list_index)
     {
         const int tracker_id = valid_projection_tracker_ids[list_index];
         const ServerTrackerViewPtr tracker = tracker_manager->getTrackerViewPtr(tracker_id);
         const ControllerOpticalPoseEstimation &poseEstimate = tracker_pose_estimations[tracker_id];
 
+        tracker_list[list_index] = tracker.get();
         position2d_list[list_index] = tracker->projectTrackerRelativePosition(&poseEstimate.position_cm);
         screen_area_sum += poseEstimate.projection.screen_area;
-    }
 
-    // Compute triangulations amongst all pairs of projections
-    int pair_count = 0;
-    int biggest_prjection_id = -1;
-    CommonDevicePosition average_world_position = { 0.f, 0.f, 0.f };
-    for (int list_index = 0; list_index < projections_found; ++list_index)
-    {
-        const int tracker_id = valid_projection_tracker_ids[list_index];
-        const CommonDeviceScreenLocation &screen_location = position2d_list[list_index];
-        const ServerTrackerViewPtr tracker = tracker_manager->getTrackerViewPtr(tracker_id);
-
-        for (int other_list_index = list_index + 1; other_list_index < projections_found; ++other_list_index)
+        if (biggest_projection_id == -1 ||
+            poseEstimate.projection.screen_area > tracker_pose_estimations[biggest_projection_id].projection.screen_area)
         {
-            const int other_tracker_id = valid_projection_tracker_ids[other_list_index];
-            const CommonDeviceScreenLocation &other_screen_location = position2d_list[other_list_index];
-            const ServerTrackerViewPtr other_tracker = tracker_manager->getTrackerViewPtr(other_tracker_id);
-            // if trackers are on poposite sides
-            if (cfg.exclude_opposed_cameras)
-            {
-                if ((tracker->getTrackerPose().PositionCm.x > 0) == (other_tracker->getTrackerPose().PositionCm.x < 0) &&
-                    (tracker->getTrackerPose().PositionCm.z > 0) == (other_tracker->getTrackerPose().PositionCm.z < 0))
-                {
-                    float screen_area = tracker_pose_estimations[tracker_id].projection.screen_area;
-                    float other_screen_area = tracker_pose_estimations[other_tracker_id].projection.screen_area;
-
-                    biggest_prjection_id = screen_area > other_screen_area ? tracker_id : other_tracker_id;
-
-                    continue;
-                }
-            }
-
-            // Using the screen locations on two different trackers we can triangulate a world position
-            CommonDevicePosition world_position =
-                ServerTrackerView::triangulateWorldPosition(
-                    tracker.get(), &screen_location,
-                    other_tracker.get(), &other_screen_location);
-
-            average_world_position.x += world_position.x;
-            average_world_position.y += world_position.y;
-            average_world_position.z += world_position.z;
-
-            ++pair_count;
+            biggest_projection_id = tracker_id;
         }
     }
 
-    if (pair_count == 0 && biggest_prjection_id >= 0 && !DeviceManager::getInstance()->m_tracker_manager->getConfig().ignore_pose_from_one_tracker)
+    // Triangulate the position from all of the trackers at once,
+    // leaving out the trackers that disagree with the rest
+    CommonDevicePosition world_position;
+    int triangulated_tracker_count = 0;
+    if (!cfg.exclude_opposed_cameras || hasNonOpposedTrackerPair(tracker_list, projections_found))
     {
-        // Position not triangulated from opposed camera, estimate from one tracker only.
-
-        computeSpherePoseForControllerFromSingleTracker(
-            controllerView,
-            tracker_manager->getTrackerViewPtr(biggest_prjection_id),
-            &tracker_pose_estimations[biggest_prjection_id],
-            multicam_pose_estimation);		
+        triangulated_tracker_count =
+            ServerTrackerView::triangulateWorldPositionFromTrackers(
+                tracker_list,
+                position2d_list,
+                projections_found,
+                cfg.max_triangulation_reprojection_error_px,
+                &world_position);
     }
-    else if(pair_count > 0)
-    {
-        // Compute the average position
-        const float N = static_cast<float>(pair_count);
-
-        average_world_position.x /= N;
-        average_world_position.y /= N;
-        average_world_position.z /= N;
 
-        // Store the averaged tracking position
-        const float q = tracker_manager->getConfig().controller_position_smoothing;
+    if (triangulated_tracker_count > 0)
+    {
+        // Store the triangulated tracking position
+        const float q = cfg.controller_position_smoothing;
         if (q <= 0.01f)
         {
-            multicam_pose_estimation->position_cm = average_world_position;
+            multicam_pose_estimation->position_cm = world_position;
         }
         else
         {
-            multicam_pose_estimation->position_cm.x = q * multicam_pose_estimation->position_cm.x + (1 - q) * average_world_position.x;
-            multicam_pose_estimation->position_cm.y = q * multicam_pose_estimation->position_cm.y + (1 - q) * average_world_position.y;
-            multicam_pose_estimation->position_cm.z = q * multicam_pose_estimation->position_cm.z + (1 - q) * average_world_position.z;
+            multicam_pose_estimation->position_cm.x = q * multicam_pose_estimation->position_cm.x + (1 - q) * world_position.x;
+            multicam_pose_estimation->position_cm.y = q * multicam_pose_estimation->position_cm.y + (1 - q) * world_position.y;
+            multicam_pose_estimation->position_cm.z = q * multicam_pose_estimation->position_cm.z + (1 - q) * world_position.z;
         }
 
         multicam_pose_estimation->bCurrentlyTracking = true;
     }
+    else if (biggest_projection_id >= 0 && !cfg.ignore_pose_from_one_tracker)
+    {
+        // Position not triangulated (e.g. only opposed cameras), estimate from one tracker only.
+        computeSpherePoseForControllerFromSingleTracker(
+            controllerView,
+            tracker_manager->getTrackerViewPtr(biggest_projection_id),
+            &tracker_pose_estimations[biggest_projection_id],
+            multicam_pose_estimation);
+    }
 
     // No orientation for the sphere projection
     multicam_pose_estimation->orientation.clear();
@@ -2636,90 +2923,42 @@ static void computeLightBarPoseForControllerFromMultipleTrackers(
     ControllerOpticalPoseEstimation *tracker_pose_estimations,
     ControllerOpticalPoseEstimation *multicam_pose_estimation)
 {
-    const int k_max_pairs = TrackerManager::k_max_devices*(TrackerManager::k_max_devices - 1);
-    Eigen::Quaternionf world_orientations[k_max_pairs];
-    float orientation_weights[k_max_pairs];
+    const TrackerManagerConfig &cfg = tracker_manager->getConfig();
+    const ServerTrackerView *tracker_list[TrackerManager::k_max_devices];
+    const CommonDeviceTrackingProjection *projection_list[TrackerManager::k_max_devices];
     float screen_area_sum = 0;
 
-    // Compute triangulations amongst all pairs of projections
-    int pair_count = 0;
-    CommonDevicePosition average_world_position = { 0.f, 0.f, 0.f };
     for (int list_index = 0; list_index < projections_found; ++list_index)
     {
         const int tracker_id = valid_projection_tracker_ids[list_index];
-        const CommonDeviceTrackingProjection &projection = tracker_pose_estimations[list_index].projection;
-        const ServerTrackerViewPtr tracker = tracker_manager->getTrackerViewPtr(tracker_id);
+        const CommonDeviceTrackingProjection &projection = tracker_pose_estimations[tracker_id].projection;
 
+        tracker_list[list_index] = tracker_manager->getTrackerViewPtr(tracker_id).get();
+        projection_list[list_index] = &projection;
         screen_area_sum += projection.screen_area;
-
-        for (int other_list_index = list_index + 1; other_list_index < projections_found; ++other_list_index)
-        {
-            const int other_tracker_id = valid_projection_tracker_ids[other_list_index];
-            const CommonDeviceTrackingProjection &other_projection = tracker_pose_estimations[other_list_index].projection;
-            const ServerTrackerViewPtr other_tracker = tracker_manager->getTrackerViewPtr(other_tracker_id);
-
-            // Using the screen locations on two different trackers we can triangulate a world position
-            CommonDevicePose world_pose =
-                ServerTrackerView::triangulateWorldPose(
-                    tracker.get(), &projection,
-                    other_tracker.get(), &other_projection);
-
-            // Accumulate the position for averaging
-            // TODO: Make this a weighted average
-            average_world_position.x += world_pose.PositionCm.x;
-            average_world_position.y += world_pose.PositionCm.y;
-            average_world_position.z += world_pose.PositionCm.z;
-
-            // Add the quaternion to a list for the purpose of averaging
-            world_orientations[pair_count] = 
-                Eigen::Quaternionf(
-                    world_pose.Orientation.w,
-                    world_pose.Orientation.x,
-                    world_pose.Orientation.y, 
-                    world_pose.Orientation.z);
-
-            // Weight the quaternion base on how visible the controller is on each screen
-            orientation_weights[pair_count] = projection.screen_area + other_projection.screen_area;
-
-            ++pair_count;
-        }
     }
 
-    assert(pair_count >= 1);
-
-    // Compute the average position
+    assert(projections_found >= 2);
+
+    // Triangulate the light bar from all of the trackers at once,
+    // leaving out the trackers that disagree with the rest
+    CommonDevicePose world_pose;
+    if (ServerTrackerView::triangulateWorldPoseFromTrackers(
+            tracker_list,
+            projection_list,
+            projections_found,
+            cfg.max_triangulation_reprojection_error_px,
+            &world_pose))
     {
-        const float N = static_cast<float>(pair_count);
-
-        average_world_position.x /= N;
-        average_world_position.y /= N;
-        average_world_position.z /= N;
-
-        // Store the averaged tracking position
-        multicam_pose_estimation->position_cm = average_world_position;
+        multicam_pose_estimation->position_cm = world_pose.PositionCm;
+        multicam_pose_estimation->orientation = world_pose.Orientation;
+        multicam_pose_estimation->bOrientationValid = true;
         multicam_pose_estimation->bCurrentlyTracking = true;
     }
-
-    // Compute the average orientation
+    else
     {
-        Eigen::Quaternionf avg_world_orientation;
-
-        if (eigen_quaternion_compute_normalized_weighted_average(
-                world_orientations,
-                orientation_weights,
-                pair_count,
-                &avg_world_orientation))
-        {
-            multicam_pose_estimation->orientation.w = avg_world_orientation.w();
-            multicam_pose_estimation->orientation.x = avg_world_orientation.x();
-            multicam_pose_estimation->orientation.y = avg_world_orientation.y();
-            multicam_pose_estimation->orientation.z = avg_world_orientation.z();
-            multicam_pose_estimation->bOrientationValid = true;
-        }
-        else
-        {
-            multicam_pose_estimation->bOrientationValid = false;
-        }
+        multicam_pose_estimation->bOrientationValid = false;
+        multicam_pose_estimation->bCurrentlyTracking = false;
     }
 
     // Compute the average projection area.
@@ -5,12 +5,12 @@
 #include "DeviceInterface.h"
 #include "ServerDeviceView.h"
 #include "PoseFilterInterface.h"
+#include "PoseSensorPacketMerger.h"
 #include "PSMoveProtocolInterface.h"
 #include "TrackerManager.h"
 
 #include <atomic>
 #include <chrono>
-#include <deque>
 #include <vector>
 
 #include "readerwriterqueue.h" // lockfree queue
@@ -19,7 +19,7 @@
 class TrackerManager;
 
 using t_controller_pose_sensor_queue= moodycamel::ReaderWriterQueue<PoseSensorPacket, 1024>;
-using t_controller_pose_optical_queue= std::deque<PoseSensorPacket>;
+using t_controller_pose_optical_queue= moodycamel::ReaderWriterQueue<PoseSensorPacket, 1024>;
 
 template<typename t_object_type>
 class AtomicObject;
@@ -31,6 +31,8 @@ struct ControllerOpticalPoseEstimation
 {
     std::chrono::time_point<std::chrono::high_resolution_clock> last_update_timestamp;
     std::chrono::time_point<std::chrono::high_resolution_clock> last_visible_timestamp;
+    // When the video frame(s) the estimate was computed from were captured
+    std::chrono::time_point<std::chrono::high_resolution_clock> capture_timestamp;
     bool bValidTimestamps;
 
     CommonDevicePosition position_cm; // centimeters
@@ -44,6 +46,7 @@ struct ControllerOpticalPoseEstimation
     {
         last_update_timestamp = std::chrono::time_point<std::chrono::high_resolution_clock>();
         last_visible_timestamp = std::chrono::time_point<std::chrono::high_resolution_clock>();
+        capture_timestamp = std::chrono::time_point<std::chrono::high_resolution_clock>();
         bValidTimestamps= false;
 
         position_cm.clear();
@@ -57,6 +60,8 @@ struct ControllerOpticalPoseEstimation
     }
 };
 
+using t_controller_optical_projection_queue= moodycamel::ReaderWriterQueue<ControllerOpticalPoseEstimation>;
+
 class ServerControllerView : public ServerDeviceView, public IControllerListener
 {
 public:
@@ -74,10 +79,19 @@ public:
 	// Recreate and initialize the pose filter for the controller
 	void resetPoseFilter();
 
+    // Ask every tracker with a new video frame to search for this controller's tracking blob
+    void requestTrackerProjections(TrackerManager* tracker_manager);
+
     // Compute pose/prediction of tracking blob+IMU state
     void updateOpticalPoseEstimation(TrackerManager* tracker_manager);
     void updateStateAndPredict();
 
+    // The two halves of updateStateAndPredict(), so that the controller manager
+    // can interleave the sensor packets of all of the controllers.
+    // applyNextSensorPacket() returns false once there are no more packets to process.
+    void drainSensorPacketQueues();
+    bool applyNextSensorPacket();
+
     // Registers the address of the bluetooth adapter on the host PC with the controller
     bool setHostBluetoothAddress(const std::string &address);
     
@@ -198,15 +212,26 @@ public:
         const struct ControllerStreamInfo *stream_info,
         PSMoveProtocol::DeviceOutputDataFrame *data_frame);
 
+    // Helper used to publish the current controller state to the given compact data frame
+    static void generate_compact_controller_data_frame_for_stream(
+        const ServerControllerView *controller_view,
+        const struct ControllerStreamInfo *stream_info,
+        struct CompactControllerDataFrame *compact_frame);
+
 	// Incoming device data callbacks
 	void notifySensorDataReceived(const CommonDeviceState *sensor_state) override;
 
+	// Incoming tracker projection callback (called from the tracker's vision thread)
+	void notifyTrackerDataReceived(int tracker_id, const ControllerOpticalPoseEstimation *tracker_pose_estimate);
+
 protected:
     void set_tracking_enabled_internal(bool bEnabled);
     void update_LED_color_internal();
     bool allocate_device_interface(const class DeviceEnumerator *enumerator) override;
     void free_device_interface() override;
     void publish_device_data_frame() override;
+    CommonDevicePose compute_filtered_pose(float time) const;
+    CommonDevicePhysics compute_filtered_physics() const;
 
 private:
     // Tracking color state
@@ -230,16 +255,17 @@ private:
 
 	// Filter State (Shared)
 	t_controller_pose_sensor_queue m_PoseSensorIMUPacketQueue;
-	t_controller_pose_optical_queue m_PoseSensorOpticalPacketQueue; // TODO: Currently on main thread
+	t_controller_pose_optical_queue m_PoseSensorOpticalPacketQueue;
+	t_controller_optical_projection_queue m_TrackerProjectionQueues[TrackerManager::k_max_devices];
     
     // Filter state
+    PoseSensorPacketMerger m_PoseSensorPacketMerger;
     ControllerOpticalPoseEstimation *m_tracker_pose_estimations; // array of size TrackerManager::k_max_devices
     ControllerOpticalPoseEstimation *m_multicam_pose_estimation;
     class IPoseFilter *m_pose_filter;
     class PoseFilterSpace *m_pose_filter_space;
+    class PoseFilterHistory *m_pose_filter_history;
     int m_lastPollSeqNumProcessed;
-    std::chrono::time_point<std::chrono::high_resolution_clock> m_last_filter_update_timestamp;
-    bool m_last_filter_update_timestamp_valid;
 };
 
 #endif // SERVER_CONTROLLER_VIEW_H
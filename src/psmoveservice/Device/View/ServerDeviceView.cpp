@@ -1,19 +1,100 @@
 //-- includes -----
 #include "ServerDeviceView.h"
+#include "CompactDataFrame.h"
 #include "ServerLog.h"
 
+#include <algorithm>
 #include <chrono>
 
+//-- constants -----
+static const int k_dropped_packet_log_interval_msec= 1000;
+
 //-- private methods -----
 
 //-- public implementation -----
+FilteredPoseCache::FilteredPoseCache()
+    : m_poseCount(0)
+    , m_nextPoseIndex(0)
+    , m_bHasPhysics(false)
+    , m_bIsActive(false)
+{
+}
+
+void FilteredPoseCache::beginPublish()
+{
+    m_poseCount= 0;
+    m_nextPoseIndex= 0;
+    m_bHasPhysics= false;
+    m_bIsActive= true;
+}
+
+void FilteredPoseCache::endPublish()
+{
+    m_poseCount= 0;
+    m_nextPoseIndex= 0;
+    m_bHasPhysics= false;
+    m_bIsActive= false;
+}
+
+bool FilteredPoseCache::fetchPose(const float time, CommonDevicePose &out_pose) const
+{
+    for (int pose_index = 0; pose_index < m_poseCount; ++pose_index)
+    {
+        if (m_poseTimes[pose_index] == time)
+        {
+            out_pose= m_poses[pose_index];
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void FilteredPoseCache::storePose(const float time, const CommonDevicePose &pose)
+{
+    if (m_bIsActive)
+    {
+        m_poseTimes[m_nextPoseIndex]= time;
+        m_poses[m_nextPoseIndex]= pose;
+
+        if (m_poseCount < k_max_cached_poses)
+        {
+            ++m_poseCount;
+        }
+        m_nextPoseIndex= (m_nextPoseIndex + 1) % k_max_cached_poses;
+    }
+}
+
+bool FilteredPoseCache::fetchPhysics(CommonDevicePhysics &out_physics) const
+{
+    if (m_bHasPhysics)
+    {
+        out_physics= m_physics;
+    }
+
+    return m_bHasPhysics;
+}
+
+void FilteredPoseCache::storePhysics(const CommonDevicePhysics &physics)
+{
+    if (m_bIsActive)
+    {
+        m_physics= physics;
+        m_bHasPhysics= true;
+    }
+}
+
 ServerDeviceView::ServerDeviceView(
     const int device_id)
     : m_bHasUnpublishedState(false)
     , m_pollNoDataCount(0)
     , m_sequence_number(0)
+    , m_lastDroppedPacketLogTimestamp()
+    , m_unloggedDroppedPacketCount(0)
+    , m_totalDroppedPacketCount(0)
     , m_deviceID(device_id)
 {
+    resetSampleLatency();
 }
 
 ServerDeviceView::~ServerDeviceView()
@@ -36,6 +117,7 @@ ServerDeviceView::open(const DeviceEnumerator *enumerator)
     {
         // Consider a successful opening as an update
         m_pollNoDataCount= 0;
+        resetSampleLatency();
     }
 
     return bSuccess;
@@ -110,18 +192,151 @@ void ServerDeviceView::publish()
 {
     if (m_bHasUnpublishedState)
     {
+        m_filteredPoseCache.beginPublish();
         publish_device_data_frame();
+        m_filteredPoseCache.endPublish();
 
         m_bHasUnpublishedState= false;
         m_sequence_number++;
+
+        // Measure how old the freshest sample in the published state is
+        if (m_bHasFusedSample)
+        {
+            const std::chrono::duration<float, std::milli> latency= 
+                std::chrono::high_resolution_clock::now() - m_newestFusedSampleTimestamp;
+
+            m_totalSampleLatencyMilliseconds+= latency.count();
+            m_maxSampleLatencyMilliseconds= std::max(m_maxSampleLatencyMilliseconds, latency.count());
+            ++m_sampleLatencyCount;
+            m_bHasFusedSample= false;
+        }
     }
 }
 
+float ServerDeviceView::getAverageSampleLatencyMilliseconds() const
+{
+    return 
+        (m_sampleLatencyCount > 0) 
+        ? static_cast<float>(m_totalSampleLatencyMilliseconds / m_sampleLatencyCount) 
+        : 0.f;
+}
+
+void ServerDeviceView::notifySampleFused(
+    const std::chrono::time_point<std::chrono::high_resolution_clock> &capture_timestamp)
+{
+    if (!m_bHasFusedSample || capture_timestamp > m_newestFusedSampleTimestamp)
+    {
+        m_newestFusedSampleTimestamp= capture_timestamp;
+        m_bHasFusedSample= true;
+    }
+}
+
+void ServerDeviceView::notifySensorPacketsDropped(const int dropped_packet_count)
+{
+    if (dropped_packet_count <= 0)
+    {
+        return;
+    }
+
+    m_unloggedDroppedPacketCount+= dropped_packet_count;
+    m_totalDroppedPacketCount+= dropped_packet_count;
+
+    // Drops tend to come every update while the pose filter is behind, so only log a running count
+    const std::chrono::time_point<std::chrono::high_resolution_clock> now= std::chrono::high_resolution_clock::now();
+    if (now - m_lastDroppedPacketLogTimestamp >= std::chrono::milliseconds(k_dropped_packet_log_interval_msec))
+    {
+        SERVER_MT_LOG_WARNING("ServerDeviceView::notifySensorPacketsDropped") << "Device id " << getDeviceID() 
+            << " dropped " << m_unloggedDroppedPacketCount << " sensor packets the pose filter fell behind on";
+        m_unloggedDroppedPacketCount= 0;
+        m_lastDroppedPacketLogTimestamp= now;
+    }
+}
+
+void ServerDeviceView::encodeCompactPose(
+    const CommonDevicePose &pose,
+    const bool bIncludePosition,
+    CompactPoseData &out_pose)
+{
+    encodeCompactPosition(pose.PositionCm, bIncludePosition, out_pose);
+
+    out_pose.orientation[0]= pose.Orientation.w;
+    out_pose.orientation[1]= pose.Orientation.x;
+    out_pose.orientation[2]= pose.Orientation.y;
+    out_pose.orientation[3]= pose.Orientation.z;
+}
+
+void ServerDeviceView::encodeCompactPosition(
+    const CommonDevicePosition &position_cm,
+    const bool bIncludePosition,
+    CompactPoseData &out_pose)
+{
+    // Left at the origin when the stream didn't ask for positions
+    out_pose.position_cm[0]= bIncludePosition ? position_cm.x : 0.f;
+    out_pose.position_cm[1]= bIncludePosition ? position_cm.y : 0.f;
+    out_pose.position_cm[2]= bIncludePosition ? position_cm.z : 0.f;
+
+    // Devices with no orientation report the identity
+    out_pose.orientation[0]= 1.f;
+    out_pose.orientation[1]= 0.f;
+    out_pose.orientation[2]= 0.f;
+    out_pose.orientation[3]= 0.f;
+}
+
+void ServerDeviceView::encodeCompactPhysics(
+    const CommonDevicePhysics &physics,
+    const bool bIncludeAngularPhysics,
+    CompactPhysicsData &out_physics)
+{
+    out_physics.velocity_cm_per_sec[0]= physics.VelocityCmPerSec.i;
+    out_physics.velocity_cm_per_sec[1]= physics.VelocityCmPerSec.j;
+    out_physics.velocity_cm_per_sec[2]= physics.VelocityCmPerSec.k;
+
+    out_physics.acceleration_cm_per_sec_sqr[0]= physics.AccelerationCmPerSecSqr.i;
+    out_physics.acceleration_cm_per_sec_sqr[1]= physics.AccelerationCmPerSecSqr.j;
+    out_physics.acceleration_cm_per_sec_sqr[2]= physics.AccelerationCmPerSecSqr.k;
+
+    // Devices with no orientation leave the angular terms zeroed
+    if (bIncludeAngularPhysics)
+    {
+        out_physics.angular_velocity_rad_per_sec[0]= physics.AngularVelocityRadPerSec.i;
+        out_physics.angular_velocity_rad_per_sec[1]= physics.AngularVelocityRadPerSec.j;
+        out_physics.angular_velocity_rad_per_sec[2]= physics.AngularVelocityRadPerSec.k;
+
+        out_physics.angular_acceleration_rad_per_sec_sqr[0]= physics.AngularAccelerationRadPerSecSqr.i;
+        out_physics.angular_acceleration_rad_per_sec_sqr[1]= physics.AngularAccelerationRadPerSecSqr.j;
+        out_physics.angular_acceleration_rad_per_sec_sqr[2]= physics.AngularAccelerationRadPerSecSqr.k;
+    }
+}
+
+void ServerDeviceView::resetSampleLatency()
+{
+    m_newestFusedSampleTimestamp= std::chrono::time_point<std::chrono::high_resolution_clock>();
+    m_bHasFusedSample= false;
+    m_totalSampleLatencyMilliseconds= 0.0;
+    m_maxSampleLatencyMilliseconds= 0.f;
+    m_sampleLatencyCount= 0;
+}
+
 void
 ServerDeviceView::close()
 {
     if (getIsOpen())
     {
+        if (m_sampleLatencyCount > 0)
+        {
+            SERVER_LOG_INFO("ServerDeviceView::close") << "Device id " << getDeviceID() 
+                << " sample latency avg: " << getAverageSampleLatencyMilliseconds() 
+                << "ms, max: " << m_maxSampleLatencyMilliseconds << "ms";
+        }
+
+        if (m_totalDroppedPacketCount > 0)
+        {
+            SERVER_LOG_WARNING("ServerDeviceView::close") << "Device id " << getDeviceID() 
+                << " dropped " << m_totalDroppedPacketCount << " sensor packets in total";
+            m_totalDroppedPacketCount= 0;
+            m_unloggedDroppedPacketCount= 0;
+        }
+
         getDevice()->close();
         free_device_interface();
     }
@@ -7,6 +7,39 @@
 #include <assert.h>
 
 // -- declarations -----
+/// Filtered poses of a device computed while it publishes its state.
+/// Every stream listening to the device gets a data frame built during the same publish,
+/// so the streams share one prediction per prediction time instead of each asking the filter again.
+/// Poses are keyed on the exact prediction time, a stream never gets a pose predicted for another time.
+class FilteredPoseCache
+{
+public:
+    FilteredPoseCache();
+
+    /// The cache only holds poses while a publish is in progress,
+    /// since the filter state can change at any time between publishes
+    void beginPublish();
+    void endPublish();
+    inline bool getIsActive() const
+    { return m_bIsActive; }
+
+    bool fetchPose(const float time, CommonDevicePose &out_pose) const;
+    void storePose(const float time, const CommonDevicePose &pose);
+    bool fetchPhysics(CommonDevicePhysics &out_physics) const;
+    void storePhysics(const CommonDevicePhysics &physics);
+
+private:
+    static const int k_max_cached_poses= 4;
+
+    float m_poseTimes[k_max_cached_poses];
+    CommonDevicePose m_poses[k_max_cached_poses];
+    int m_poseCount;
+    int m_nextPoseIndex; // oldest pose, replaced once the cache is full
+    CommonDevicePhysics m_physics;
+    bool m_bHasPhysics;
+    bool m_bIsActive;
+};
+
 class ServerDeviceView
 {
 public:
@@ -55,22 +88,87 @@ public:
     { return m_bHasUnpublishedState; }
     inline std::chrono::time_point<std::chrono::high_resolution_clock> getLastNewDataTimestamp() const
     { return m_lastNewDataTimestamp; }
+
+    // End-to-end latency since the device was opened:
+    // the time from when the newest sample in a published state was captured (USB/HID read or camera frame)
+    // until that state was published
+    float getAverageSampleLatencyMilliseconds() const;
+    inline float getMaxSampleLatencyMilliseconds() const
+    { return m_maxSampleLatencyMilliseconds; }
     
     // setters
     inline void markStateAsUnpublished()
     { m_bHasUnpublishedState= true; }
-    
+
+    // Used by the device views to build compact data frames (see CompactDataFrame.h) straight from their state
+    static void encodeCompactPose(const CommonDevicePose &pose, const bool bIncludePosition, struct CompactPoseData &out_pose);
+    static void encodeCompactPosition(const CommonDevicePosition &position_cm, const bool bIncludePosition, struct CompactPoseData &out_pose);
+    static void encodeCompactPhysics(const CommonDevicePhysics &physics, const bool bIncludeAngularPhysics, struct CompactPhysicsData &out_physics);
+
 protected:
     virtual bool allocate_device_interface(const class DeviceEnumerator *enumerator) = 0;
     virtual void free_device_interface() = 0;
     virtual void publish_device_data_frame() = 0;
 
+    // The trackers aren't synchronized, so a pose triangulated from several of them
+    // was effectively captured at the average of their frame capture times
+    template <class t_optical_pose_estimation>
+    static std::chrono::time_point<std::chrono::high_resolution_clock> computeAverageCaptureTimestamp(
+        const t_optical_pose_estimation *tracker_pose_estimations,
+        const int *valid_projection_tracker_ids,
+        const int projections_found,
+        const std::chrono::time_point<std::chrono::high_resolution_clock> fallback_timestamp)
+    {
+        const std::chrono::time_point<std::chrono::high_resolution_clock> k_unset_timestamp;
+        std::chrono::high_resolution_clock::duration offset_sum= std::chrono::high_resolution_clock::duration::zero();
+        int timestamp_count= 0;
+
+        for (int list_index = 0; list_index < projections_found; ++list_index)
+        {
+            const int tracker_id= valid_projection_tracker_ids[list_index];
+            const std::chrono::time_point<std::chrono::high_resolution_clock> &capture_timestamp= 
+                tracker_pose_estimations[tracker_id].capture_timestamp;
+
+            if (capture_timestamp != k_unset_timestamp)
+            {
+                offset_sum+= capture_timestamp - fallback_timestamp;
+                ++timestamp_count;
+            }
+        }
+
+        return 
+            (timestamp_count > 0) 
+            ? fallback_timestamp + offset_sum / timestamp_count 
+            : fallback_timestamp;
+    }
+
+    // Called by the device views for every sample that gets fed into the published state
+    void notifySampleFused(const std::chrono::time_point<std::chrono::high_resolution_clock> &capture_timestamp);
+    void resetSampleLatency();
+
+    // Called by the device views (on the device update threads) with the packets their sensor packet merger dropped.
+    // The drops get logged at most once per second, and the total when the device is closed.
+    void notifySensorPacketsDropped(const int dropped_packet_count);
+
     bool m_bHasUnpublishedState;
     int m_pollNoDataCount;
     int m_sequence_number;
     std::chrono::time_point<std::chrono::high_resolution_clock> m_lastNewDataTimestamp;
+
+    // Filtered poses shared by the streams of the publish in progress
+    mutable FilteredPoseCache m_filteredPoseCache;
     
 private:
+    std::chrono::time_point<std::chrono::high_resolution_clock> m_newestFusedSampleTimestamp;
+    bool m_bHasFusedSample;
+    double m_totalSampleLatencyMilliseconds;
+    float m_maxSampleLatencyMilliseconds;
+    int m_sampleLatencyCount;
+
+    std::chrono::time_point<std::chrono::high_resolution_clock> m_lastDroppedPacketLogTimestamp;
+    int m_unloggedDroppedPacketCount;
+    int m_totalDroppedPacketCount;
+
     int m_deviceID;
 };
 
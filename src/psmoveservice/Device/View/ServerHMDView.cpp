@@ -1,10 +1,12 @@
 //-- includes -----
+#include "CompactDataFrame.h"
 #include "DeviceManager.h"
 #include "ServerHMDView.h"
 #include "MathAlignment.h"
 #include "MorpheusHMD.h"
 #include "VirtualHMD.h"
 #include "CompoundPoseFilter.h"
+#include "PoseFilterHistory.h"
 #include "PoseFilterInterface.h"
 #include "PSMoveProtocol.pb.h"
 #include "ServerLog.h"
@@ -12,10 +14,22 @@
 #include "ServerTrackerView.h"
 #include "TrackerManager.h"
 
+//-- typedefs ----
+using t_high_resolution_timepoint= std::chrono::time_point<std::chrono::high_resolution_clock>;
+using t_high_resolution_duration= t_high_resolution_timepoint::duration;
+
 //-- constants -----
-static const float k_min_time_delta_seconds = 1 / 120.f;
+static const float k_min_time_delta_seconds = 1 / 2500.f;
 static const float k_max_time_delta_seconds = 1 / 30.f;
 
+// Number of sensor packets the pose filter can be rewound through to fuse a late optical measurement.
+// The Morpheus sends two IMU samples per report, so this covers a bit over 100ms.
+static const int k_pose_filter_history_length = 128;
+
+// Most IMU or optical packets fused per update.
+// If the update loop stalls the oldest packets get dropped so the filter catches up with the newest data.
+static const int k_max_sensor_packets_per_stream = 100;
+
 //-- private methods -----
 static void init_filters_for_morpheus_hmd(
 	const MorpheusHMD *morpheusHMD, PoseFilterSpace **out_pose_filter_space, IPoseFilter **out_pose_filter);
@@ -25,20 +39,32 @@ static IPoseFilter *pose_filter_factory(
 	const CommonDeviceState::eDeviceType deviceType,
 	const std::string &position_filter_type, const std::string &orientation_filter_type,
 	const PoseFilterConstants &constants);
-static void update_filters_for_morpheus_hmd(
+static void post_imu_filter_packets_for_morpheus_hmd(
 	const MorpheusHMD *morpheusHMD, const MorpheusHMDState *morpheusHMDState,
-	const float delta_time,
-	const HMDOpticalPoseEstimation *poseEstimation, const PoseFilterSpace *poseFilterSpace, IPoseFilter *poseFilter);
-static void update_filters_for_virtual_hmd(
-	const VirtualHMD *virtualHMD, const VirtualHMDState *virtualHMDState,
-	const float delta_time,
-	const HMDOpticalPoseEstimation *poseEstimation, const PoseFilterSpace *poseFilterSpace, IPoseFilter *poseFilter);
+	const t_high_resolution_timepoint capture_timestamp, const t_high_resolution_duration duration_since_last_update,
+	PoseSensorPacketMerger *packet_merger);
+static void post_optical_filter_packet_for_morpheus_hmd(
+	const MorpheusHMD *morpheusHMD,
+	const t_high_resolution_timepoint capture_timestamp,
+	const HMDOpticalPoseEstimation *poseEstimation,
+	PoseSensorPacketMerger *packet_merger);
+static void post_optical_filter_packet_for_virtual_hmd(
+	const VirtualHMD *virtualHMD,
+	const t_high_resolution_timepoint capture_timestamp,
+	const HMDOpticalPoseEstimation *poseEstimation,
+	PoseSensorPacketMerger *packet_merger);
 static void generate_morpheus_hmd_data_frame_for_stream(
     const ServerHMDView *hmd_view, const HMDStreamInfo *stream_info,
-    DeviceOutputDataFramePtr &data_frame);
+    PSMoveProtocol::DeviceOutputDataFrame *data_frame);
 static void generate_virtual_hmd_data_frame_for_stream(
     const ServerHMDView *hmd_view, const HMDStreamInfo *stream_info,
-    DeviceOutputDataFramePtr &data_frame);
+    PSMoveProtocol::DeviceOutputDataFrame *data_frame);
+static void generate_morpheus_hmd_compact_data_frame_for_stream(
+    const ServerHMDView *hmd_view, const HMDStreamInfo *stream_info,
+    CompactHMDDataFrame *compact_frame);
+static void generate_virtual_hmd_compact_data_frame_for_stream(
+    const ServerHMDView *hmd_view, const HMDStreamInfo *stream_info,
+    CompactHMDDataFrame *compact_frame);
 
 static Eigen::Vector3f CommonDevicePosition_to_EigenVector3f(const CommonDevicePosition &p);
 static Eigen::Vector3f CommonDeviceVector_to_EigenVector3f(const CommonDeviceVector &v);
@@ -81,11 +107,13 @@ ServerHMDView::ServerHMDView(const int device_id)
 	, m_device(nullptr)
 	, m_tracker_pose_estimations(nullptr)
 	, m_multicam_pose_estimation(nullptr)
+	, m_PoseSensorPacketMerger(k_max_sensor_packets_per_stream)
 	, m_pose_filter(nullptr)
 	, m_pose_filter_space(nullptr)
+	, m_pose_filter_history(nullptr)
 	, m_lastPollSeqNumProcessed(-1)
-	, m_last_filter_update_timestamp()
-	, m_last_filter_update_timestamp_valid(false)
+	, m_lastSensorDataTimestamp()
+	, m_bIsLastSensorDataTimestampValid(false)
 {
 }
 
@@ -146,6 +174,12 @@ void ServerHMDView::free_device_interface()
 		m_tracker_pose_estimations = nullptr;
 	}
 
+	if (m_pose_filter_history != nullptr)
+	{
+		delete m_pose_filter_history;
+		m_pose_filter_history = nullptr;
+	}
+
 	if (m_pose_filter_space != nullptr)
 	{
 		delete m_pose_filter_space;
@@ -218,6 +252,7 @@ bool ServerHMDView::open(const class DeviceEnumerator *enumerator)
 
         // Reset the poll sequence number high water mark
         m_lastPollSeqNumProcessed = -1;
+        m_bIsLastSensorDataTimestampValid = false;
     }
 
     return bSuccess;
@@ -243,6 +278,12 @@ void ServerHMDView::resetPoseFilter()
 {
 	assert(m_device != nullptr);
 
+	if (m_pose_filter_history != nullptr)
+	{
+		delete m_pose_filter_history;
+		m_pose_filter_history = nullptr;
+	}
+
 	if (m_pose_filter != nullptr)
 	{
 		delete m_pose_filter;
@@ -272,11 +313,54 @@ void ServerHMDView::resetPoseFilter()
 	default:
 		break;
 	}
+
+	if (m_pose_filter != nullptr)
+	{
+		m_pose_filter_history = new PoseFilterHistory(k_min_time_delta_seconds, k_max_time_delta_seconds);
+
+		if (!m_pose_filter_history->init(m_pose_filter, m_pose_filter_space, k_pose_filter_history_length))
+		{
+			SERVER_LOG_WARNING("ServerHMDView::resetPoseFilter") <<
+				"Pose filter for HMD " << getDeviceID() << " can't be rewound. Late optical packets will be fused on arrival.";
+		}
+	}
+}
+
+void ServerHMDView::requestTrackerProjections(TrackerManager* tracker_manager)
+{
+    if (getIsTrackingEnabled())
+    {
+        CommonDeviceTrackingShape trackingShape;
+        m_device->getTrackingShape(trackingShape);
+        assert(trackingShape.shape_type != eCommonTrackingShapeType::INVALID_SHAPE);
+
+        for (int tracker_id = 0; tracker_id < tracker_manager->getMaxDevices(); ++tracker_id)
+        {
+            ServerTrackerViewPtr tracker = tracker_manager->getTrackerViewPtr(tracker_id);
+
+            // Only bother searching if a new video frame is available this tick
+            if (tracker->getIsOpen() && tracker->getHasUnpublishedState())
+            {
+                tracker->requestHMDProjection(this, &trackingShape);
+            }
+        }
+    }
+}
+
+void ServerHMDView::notifyTrackerDataReceived(
+    int tracker_id,
+    const HMDOpticalPoseEstimation *tracker_pose_estimate)
+{
+    assert(tracker_id >= 0 && tracker_id < TrackerManager::k_max_devices);
+
+    // Consumed on the main thread by updateOpticalPoseEstimation()
+    m_TrackerProjectionQueues[tracker_id].enqueue(*tracker_pose_estimate);
 }
 
 void ServerHMDView::updateOpticalPoseEstimation(TrackerManager* tracker_manager)
 {
     const std::chrono::time_point<std::chrono::high_resolution_clock> now= std::chrono::high_resolution_clock::now();
+    bool bHasNewOpticalPose= false;
 
     // TODO: Probably need to first update IMU state to get velocity.
     // If velocity is too high, don't bother getting a new position.
@@ -286,6 +370,7 @@ void ServerHMDView::updateOpticalPoseEstimation(TrackerManager* tracker_manager)
     {
         int valid_projection_tracker_ids[TrackerManager::k_max_devices];
         int projections_found = 0;
+        int new_projections_found = 0;
 
         CommonDeviceTrackingShape trackingShape;
         m_device->getTrackingShape(trackingShape);
@@ -300,6 +385,14 @@ void ServerHMDView::updateOpticalPoseEstimation(TrackerManager* tracker_manager)
 
             const bool bWasTracking= trackerPoseEstimateRef.bCurrentlyTracking;
 
+            // Pick up the newest projection the tracker's vision thread found (if any)
+            HMDOpticalPoseEstimation newTrackerPoseEstimate;
+            bool bHasNewProjection= false;
+            while (m_TrackerProjectionQueues[tracker_id].try_dequeue(newTrackerPoseEstimate))
+            {
+                bHasNewProjection= true;
+            }
+
             // Assume we're going to lose tracking this frame
             bool bCurrentlyTracking = false;
 
@@ -319,26 +412,16 @@ void ServerHMDView::updateOpticalPoseEstimation(TrackerManager* tracker_manager)
                     // Initially the newTrackerPoseEstimate is a copy of the existing pose
                     bool bIsVisibleThisUpdate= false;
 
-                    // If a new video frame is available this tick, 
-                    // attempt to update the tracking location
-                    if (tracker->getHasUnpublishedState())
+                    // If the tracker found the HMD in this tick's video frame, 
+                    // update the tracking location
+                    if (bHasNewProjection)
                     {
-                        // Create a copy of the pose estimate state so that in event of a 
-                        // failure part way through computing the projection we don't
-                        // set partially valid state
-                        HMDOpticalPoseEstimation newTrackerPoseEstimate= trackerPoseEstimateRef;
-
-                        if (tracker->computeProjectionForHMD(
-                                this, 
-                                &trackingShape,
-                                &newTrackerPoseEstimate))
-                        {
-                            bIsVisibleThisUpdate= true;
+                        bIsVisibleThisUpdate= true;
+                        ++new_projections_found;
 
-                            // Actually apply the pose estimate state
-                            trackerPoseEstimateRef= newTrackerPoseEstimate;
-                            trackerPoseEstimateRef.last_visible_timestamp = now;
-                        }
+                        // Actually apply the pose estimate state
+                        trackerPoseEstimateRef= newTrackerPoseEstimate;
+                        trackerPoseEstimateRef.last_visible_timestamp = now;
                     }
 
                     // If the projection isn't too old (or updated this tick), 
@@ -374,7 +457,7 @@ void ServerHMDView::updateOpticalPoseEstimation(TrackerManager* tracker_manager)
         if (projections_found > 1)
         {
             // If multiple trackers can see the controller, 
-            // triangulate all pairs of projections and average the results
+            // triangulate the pose from all of their projections at once
             switch (trackingShape.shape_type)
             {
             case eCommonTrackingShapeType::Sphere:
@@ -436,98 +519,170 @@ void ServerHMDView::updateOpticalPoseEstimation(TrackerManager* tracker_manager)
         if (m_multicam_pose_estimation->bCurrentlyTracking)
         {
             m_multicam_pose_estimation->last_visible_timestamp = now;
+            m_multicam_pose_estimation->capture_timestamp = 
+                computeAverageCaptureTimestamp(
+                    m_tracker_pose_estimations, valid_projection_tracker_ids, projections_found, now);
         }
         m_multicam_pose_estimation->last_update_timestamp = now;
         m_multicam_pose_estimation->bValidTimestamps = true;
+
+        bHasNewOpticalPose = new_projections_found > 0;
     }
+
+	// Queue up an optical packet if we have a valid optically tracked pose computed from a new video frame.
+	// Re-posting an old pose would hand the filter the same measurement twice.
+	if (m_multicam_pose_estimation != nullptr && m_multicam_pose_estimation->bCurrentlyTracking && bHasNewOpticalPose)
+	{
+		const t_high_resolution_timepoint capture_timestamp= m_multicam_pose_estimation->capture_timestamp;
+
+		switch (getHMDDeviceType())
+		{
+		case CommonDeviceState::Morpheus:
+			{
+				const MorpheusHMD *morpheusHMD = this->castCheckedConst<MorpheusHMD>();
+
+				post_optical_filter_packet_for_morpheus_hmd(
+					morpheusHMD,
+					capture_timestamp,
+					m_multicam_pose_estimation,
+					&m_PoseSensorPacketMerger);
+			} break;
+		case CommonDeviceState::VirtualHMD:
+			{
+				const VirtualHMD *virtualHMD = this->castCheckedConst<VirtualHMD>();
+
+				post_optical_filter_packet_for_virtual_hmd(
+					virtualHMD,
+					capture_timestamp,
+					m_multicam_pose_estimation,
+					&m_PoseSensorPacketMerger);
+			} break;
+		default:
+			assert(0 && "Unhandled HMD type");
+		}
+	}
 }
 
 void ServerHMDView::updateStateAndPredict()
 {
-	if (!getHasUnpublishedState())
+	// Turn the newly polled HMD states into IMU packets
+	if (getHasUnpublishedState())
 	{
-		return;
-	}
+		// Look backward in time to find the first HMD update state with a poll sequence number 
+		// newer than the last sequence number we've processed.
+		int firstLookBackIndex = -1;
+		int testLookBack = 0;
+		const CommonHMDState *state = getState(testLookBack);
+		while (state != nullptr && state->PollSequenceNumber > m_lastPollSeqNumProcessed)
+		{
+			firstLookBackIndex = testLookBack;
+			testLookBack++;
+			state = getState(testLookBack);
+		}
 
-	// Look backward in time to find the first HMD update state with a poll sequence number 
-	// newer than the last sequence number we've processed.
-	int firstLookBackIndex = -1;
-	int testLookBack = 0;
-	const CommonHMDState *state = getState(testLookBack);
-	while (state != nullptr && state->PollSequenceNumber > m_lastPollSeqNumProcessed)
-	{
-		firstLookBackIndex = testLookBack;
-		testLookBack++;
-		state = getState(testLookBack);
+		// Process the polled hmd states forward in time
+		const t_high_resolution_timepoint now = std::chrono::high_resolution_clock::now();
+		for (int lookBackIndex = firstLookBackIndex; lookBackIndex >= 0; --lookBackIndex)
+		{
+			const CommonHMDState *hmdState = getState(lookBackIndex);
+			const t_high_resolution_timepoint capture_timestamp= 
+				hmdState->hasCaptureTimestamp() ? hmdState->CaptureTimestamp : now;
+
+			// Compute the time since the last polled state
+			t_high_resolution_duration durationSinceLastUpdate= t_high_resolution_duration::zero();
+			if (m_bIsLastSensorDataTimestampValid)
+			{
+				durationSinceLastUpdate = capture_timestamp - m_lastSensorDataTimestamp;
+			}
+			m_lastSensorDataTimestamp= capture_timestamp;
+			m_bIsLastSensorDataTimestampValid= true;
+
+			switch (hmdState->DeviceType)
+			{
+			case CommonHMDState::Morpheus:
+				{
+					const MorpheusHMD *morpheusHMD = this->castCheckedConst<MorpheusHMD>();
+					const MorpheusHMDState *morpheusHMDState = static_cast<const MorpheusHMDState *>(hmdState);
+
+					post_imu_filter_packets_for_morpheus_hmd(
+						morpheusHMD, morpheusHMDState,
+						capture_timestamp, durationSinceLastUpdate,
+						&m_PoseSensorPacketMerger);
+				} break;
+			case CommonHMDState::VirtualHMD:
+				// No IMU, only optical packets
+				break;
+			default:
+				assert(0 && "Unhandled HMD type");
+			}
+
+			// Consider this hmd state sequence num processed
+			m_lastPollSeqNumProcessed = hmdState->PollSequenceNumber;
+		}
 	}
-	assert(firstLookBackIndex >= 0);
 
-	// Compute the time in seconds since the last update
-	const std::chrono::time_point<std::chrono::high_resolution_clock> now = std::chrono::high_resolution_clock::now();
-	float time_delta_seconds;
-	if (m_last_filter_update_timestamp_valid)
+	notifySensorPacketsDropped(m_PoseSensorPacketMerger.takeDroppedPacketCount());
+
+	// Process the IMU and optical packets from oldest to newest.
+	// Optical packets arrive well after the IMU packets captured at the same time,
+	// so the filter history rewinds the filter to apply those at their capture time and replays the newer packets.
+	PoseSensorPacket sensorPacket;
+	while (m_PoseSensorPacketMerger.popOldestPacket(sensorPacket))
 	{
-		const std::chrono::duration<float, std::milli> time_delta = now - m_last_filter_update_timestamp;
-		const float time_delta_milli = time_delta.count();
+		if (m_pose_filter_history == nullptr ||
+			!m_pose_filter_history->applySensorPacket(sensorPacket))
+		{
+			// No filter to apply it to, or too old to rewind to
+			continue;
+		}
+
+		// Track the end-to-end latency of the samples fed into the published pose
+		notifySampleFused(sensorPacket.timestamp);
 
-		// convert delta to seconds clamp time delta between 120hz and 30hz
-		time_delta_seconds = clampf(time_delta_milli / 1000.f, k_min_time_delta_seconds, k_max_time_delta_seconds);
+		// Flag the state as unpublished, which will trigger an update to the client
+		markStateAsUnpublished();
 	}
-	else
+}
+
+CommonDevicePose
+ServerHMDView::getFilteredPose(float time) const
+{
+	if (m_filteredPoseCache.getIsActive())
 	{
-		time_delta_seconds = k_max_time_delta_seconds;
+		// The streams being published share one prediction per prediction time
+		CommonDevicePose pose;
+		if (!m_filteredPoseCache.fetchPose(time, pose))
+		{
+			pose= compute_filtered_pose(time);
+			m_filteredPoseCache.storePose(time, pose);
+		}
+
+		return pose;
 	}
-	m_last_filter_update_timestamp = now;
-	m_last_filter_update_timestamp_valid = true;
 
-	// Evenly apply the list of hmd state updates over the time since last filter update
-	float per_state_time_delta_seconds = time_delta_seconds / static_cast<float>(firstLookBackIndex + 1);
+	return compute_filtered_pose(time);
+}
 
-	// Process the polled hmd states forward in time
-	// computing the new orientation along the way.
-	for (int lookBackIndex = firstLookBackIndex; lookBackIndex >= 0; --lookBackIndex)
+CommonDevicePhysics
+ServerHMDView::getFilteredPhysics() const
+{
+	if (m_filteredPoseCache.getIsActive())
 	{
-		const CommonHMDState *hmdState = getState(lookBackIndex);
-
-		switch (hmdState->DeviceType)
+		CommonDevicePhysics physics;
+		if (!m_filteredPoseCache.fetchPhysics(physics))
 		{
-		case CommonHMDState::Morpheus:
-		    {
-			    const MorpheusHMD *morpheusHMD = this->castCheckedConst<MorpheusHMD>();
-			    const MorpheusHMDState *morpheusHMDState = static_cast<const MorpheusHMDState *>(hmdState);
-
-			    // Only update the position filter when tracking is enabled
-			    update_filters_for_morpheus_hmd(
-				    morpheusHMD, morpheusHMDState,
-				    per_state_time_delta_seconds,
-				    m_multicam_pose_estimation,
-				    m_pose_filter_space,
-				    m_pose_filter);
-		    } break;
-		case CommonHMDState::VirtualHMD:
-		    {
-			    const VirtualHMD *virtualHMD = this->castCheckedConst<VirtualHMD>();
-			    const VirtualHMDState *virtualHMDState = static_cast<const VirtualHMDState *>(hmdState);
-
-			    // Only update the position filter when tracking is enabled
-			    update_filters_for_virtual_hmd(
-				    virtualHMD, virtualHMDState,
-				    per_state_time_delta_seconds,
-				    m_multicam_pose_estimation,
-				    m_pose_filter_space,
-				    m_pose_filter);
-		    } break;
-		default:
-			assert(0 && "Unhandled HMD type");
+			physics= compute_filtered_physics();
+			m_filteredPoseCache.storePhysics(physics);
 		}
 
-		// Consider this hmd state sequence num processed
-		m_lastPollSeqNumProcessed = hmdState->PollSequenceNumber;
+		return physics;
 	}
+
+	return compute_filtered_physics();
 }
 
 CommonDevicePose
-ServerHMDView::getFilteredPose(float time) const
+ServerHMDView::compute_filtered_pose(float time) const
 {
 	CommonDevicePose pose;
 
@@ -552,7 +707,7 @@ ServerHMDView::getFilteredPose(float time) const
 }
 
 CommonDevicePhysics
-ServerHMDView::getFilteredPhysics() const
+ServerHMDView::compute_filtered_physics() const
 {
 	CommonDevicePhysics physics;
 
@@ -729,15 +884,18 @@ float ServerHMDView::getROIPredictionTime() const
 void ServerHMDView::publish_device_data_frame()
 {
     // Tell the server request handler we want to send out HMD updates.
-    // This will call generate_hmd_data_frame_for_stream for each listening connection.
+    // This will call generate_hmd_data_frame_for_stream, or generate_compact_hmd_data_frame_for_stream
+    // for connections that asked for compact data frames, for each listening connection.
     ServerRequestHandler::get_instance()->publish_hmd_data_frame(
-        this, &ServerHMDView::generate_hmd_data_frame_for_stream);
+        this,
+        &ServerHMDView::generate_hmd_data_frame_for_stream,
+        &ServerHMDView::generate_compact_hmd_data_frame_for_stream);
 }
 
 void ServerHMDView::generate_hmd_data_frame_for_stream(
     const ServerHMDView *hmd_view,
     const struct HMDStreamInfo *stream_info,
-    DeviceOutputDataFramePtr &data_frame)
+    PSMoveProtocol::DeviceOutputDataFrame *data_frame)
 {
     PSMoveProtocol::DeviceOutputDataFrame_HMDDataPacket *hmd_data_frame =
         data_frame->mutable_hmd_data_packet();
@@ -763,6 +921,32 @@ void ServerHMDView::generate_hmd_data_frame_for_stream(
     data_frame->set_device_category(PSMoveProtocol::DeviceOutputDataFrame::HMD);
 }
 
+void ServerHMDView::generate_compact_hmd_data_frame_for_stream(
+    const ServerHMDView *hmd_view,
+    const struct HMDStreamInfo *stream_info,
+    CompactHMDDataFrame *compact_frame)
+{
+    initCompactDataFrameHeader(*compact_frame, PSMoveProtocol::DeviceOutputDataFrame::HMD);
+
+    compact_frame->hmd_id= hmd_view->getDeviceID();
+    compact_frame->sequence_num= hmd_view->m_sequence_number;
+    compact_frame->flags= getCompactDataFrameFlag(hmd_view->getDevice()->getIsOpen(), CompactDataFrameFlag_IsConnected);
+
+    switch (hmd_view->getHMDDeviceType())
+    {
+    case CommonHMDState::Morpheus:
+        {
+            generate_morpheus_hmd_compact_data_frame_for_stream(hmd_view, stream_info, compact_frame);
+        } break;
+    case CommonHMDState::VirtualHMD:
+        {
+            generate_virtual_hmd_compact_data_frame_for_stream(hmd_view, stream_info, compact_frame);
+        } break;
+    default:
+        assert(0 && "Unhandled HMD type");
+    }
+}
+
 static void
 init_filters_for_morpheus_hmd(
     const MorpheusHMD *morpheusHMD,
@@ -938,6 +1122,10 @@ pose_filter_factory(
 	{
 		orientation_filter_enum = OrientationFilterTypeKalman;
 	}
+	else if (orientation_filter_type == "OrientationKalmanFloat")
+	{
+		orientation_filter_enum = OrientationFilterTypeKalmanFloat;
+	}
 	else
 	{
 		SERVER_LOG_INFO("pose_filter_factory()") <<
@@ -967,139 +1155,120 @@ pose_filter_factory(
 }
 
 static void
-update_filters_for_morpheus_hmd(
+post_imu_filter_packets_for_morpheus_hmd(
     const MorpheusHMD *morpheusHMD,
     const MorpheusHMDState *morpheusHMDState,
-	const float delta_time,
-	const HMDOpticalPoseEstimation *poseEstimation,
-	const PoseFilterSpace *poseFilterSpace,
-	IPoseFilter *poseFilter)
+	const t_high_resolution_timepoint capture_timestamp,
+	const t_high_resolution_duration duration_since_last_update,
+	PoseSensorPacketMerger *packet_merger)
 {
-    const MorpheusHMDConfig *config = morpheusHMD->getConfig();
+	PoseSensorPacket sensorPacket;
 
-	// Update the orientation filter
-	if (poseFilter != nullptr)
-	{
-		PoseSensorPacket sensorPacket;
+	sensorPacket.clear();
 
-		sensorPacket.imu_magnetometer_unit = Eigen::Vector3f::Zero();
+	// Don't bother with the earlier frame if this is the very first IMU packet 
+	// (since we have no previous timestamp to use)
+	int start_frame_index= 0;
+	if (duration_since_last_update == t_high_resolution_duration::zero())
+	{
+		start_frame_index= 1;
+	}
 
-		if (poseEstimation->bOrientationValid)
-		{
-			sensorPacket.optical_orientation =
-				Eigen::Quaternionf(
-					poseEstimation->orientation.w,
-					poseEstimation->orientation.x,
-					poseEstimation->orientation.y,
-					poseEstimation->orientation.z);
-		}
-		else
-		{
-			sensorPacket.optical_orientation = Eigen::Quaternionf::Identity();
-		}
+	const t_high_resolution_timepoint prev_timestamp= capture_timestamp - (duration_since_last_update / 2);
+	const t_high_resolution_timepoint timestamps[2] = {prev_timestamp, capture_timestamp};
 
-		if (poseEstimation->bCurrentlyTracking)
-		{
-			sensorPacket.optical_position_cm =
-				Eigen::Vector3f(
-					poseEstimation->position_cm.x,
-					poseEstimation->position_cm.y,
-					poseEstimation->position_cm.z);
-			sensorPacket.tracking_projection_area_px_sqr = poseEstimation->projection.screen_area;
-		}
-		else
-		{
-			sensorPacket.optical_position_cm = Eigen::Vector3f::Zero();
-			sensorPacket.tracking_projection_area_px_sqr = 0.f;
-		}
+	// Each state update contains two readings (one earlier and one later) of accelerometer and gyro data
+	for (int frame = start_frame_index; frame < 2; ++frame)
+	{
+		const MorpheusHMDSensorFrame &sensorFrame= morpheusHMDState->SensorFrames[frame];
 
-		// Each state update contains two readings (one earlier and one later) of accelerometer and gyro data
-		for (int frame = 0; frame < 2; ++frame)
-		{
-			const MorpheusHMDSensorFrame &sensorFrame= morpheusHMDState->SensorFrames[frame];
-
-			sensorPacket.imu_accelerometer_g_units =
-				Eigen::Vector3f(
-					sensorFrame.CalibratedAccel.i,
-					sensorFrame.CalibratedAccel.j,
-					sensorFrame.CalibratedAccel.k);
-			sensorPacket.imu_gyroscope_rad_per_sec =
-				Eigen::Vector3f(
-					sensorFrame.CalibratedGyro.i,
-					sensorFrame.CalibratedGyro.j,
-					sensorFrame.CalibratedGyro.k);
-			sensorPacket.imu_magnetometer_unit = Eigen::Vector3f::Zero();
+		sensorPacket.timestamp= timestamps[frame];
 
-			{
-				PoseFilterPacket filterPacket;
+		sensorPacket.imu_accelerometer_g_units =
+			Eigen::Vector3f(
+				sensorFrame.CalibratedAccel.i,
+				sensorFrame.CalibratedAccel.j,
+				sensorFrame.CalibratedAccel.k);
+		sensorPacket.has_accelerometer_measurement= true;
 
-				// Create a filter input packet from the sensor data 
-				// and the filter's previous orientation and position
-				poseFilterSpace->createFilterPacket(
-					sensorPacket,
-					poseFilter,
-					filterPacket);
+		sensorPacket.imu_gyroscope_rad_per_sec =
+			Eigen::Vector3f(
+				sensorFrame.CalibratedGyro.i,
+				sensorFrame.CalibratedGyro.j,
+				sensorFrame.CalibratedGyro.k);
+		sensorPacket.has_gyroscope_measurement= true;
 
-				poseFilter->update(delta_time / 2.f, filterPacket);
-			}
-		}
+		packet_merger->pushPacket(PoseSensorPacketMerger::IMUStream, sensorPacket);
 	}
 }
 
 static void
-update_filters_for_virtual_hmd(
-    const VirtualHMD *virtualHMD,
-    const VirtualHMDState *virtualHMDState,
-	const float delta_time,
+post_optical_filter_packet_for_morpheus_hmd(
+	const MorpheusHMD *morpheusHMD,
+	const t_high_resolution_timepoint capture_timestamp,
 	const HMDOpticalPoseEstimation *poseEstimation,
-	const PoseFilterSpace *poseFilterSpace,
-	IPoseFilter *poseFilter)
+	PoseSensorPacketMerger *packet_merger)
 {
-    const VirtualHMDConfig *config = virtualHMD->getConfig();
+	PoseSensorPacket sensorPacket;
 
-	// Update the orientation filter
-	if (poseFilter != nullptr)
+	sensorPacket.clear();
+	sensorPacket.timestamp = capture_timestamp;
+
+	if (poseEstimation->bOrientationValid)
 	{
-		PoseSensorPacket sensorPacket;
+		sensorPacket.optical_orientation =
+			Eigen::Quaternionf(
+				poseEstimation->orientation.w,
+				poseEstimation->orientation.x,
+				poseEstimation->orientation.y,
+				poseEstimation->orientation.z);
+	}
 
-		sensorPacket.imu_magnetometer_unit = Eigen::Vector3f::Zero();
-		sensorPacket.optical_orientation = Eigen::Quaternionf::Identity();
+	if (poseEstimation->bCurrentlyTracking)
+	{
+		sensorPacket.optical_position_cm =
+			Eigen::Vector3f(
+				poseEstimation->position_cm.x,
+				poseEstimation->position_cm.y,
+				poseEstimation->position_cm.z);
+		sensorPacket.tracking_projection_area_px_sqr = poseEstimation->projection.screen_area;
+	}
 
-		if (poseEstimation->bCurrentlyTracking)
-		{
-			sensorPacket.optical_position_cm =
-				Eigen::Vector3f(
-					poseEstimation->position_cm.x,
-					poseEstimation->position_cm.y,
-					poseEstimation->position_cm.z);
-			sensorPacket.tracking_projection_area_px_sqr = poseEstimation->projection.screen_area;
-		}
-		else
-		{
-			sensorPacket.optical_position_cm = Eigen::Vector3f::Zero();
-			sensorPacket.tracking_projection_area_px_sqr = 0.f;
-		}
+	packet_merger->pushPacket(PoseSensorPacketMerger::OpticalStream, sensorPacket);
+}
 
-		sensorPacket.imu_accelerometer_g_units = Eigen::Vector3f::Zero();
-		sensorPacket.imu_gyroscope_rad_per_sec = Eigen::Vector3f::Zero();
-		sensorPacket.imu_magnetometer_unit = Eigen::Vector3f::Zero();
+static void
+post_optical_filter_packet_for_virtual_hmd(
+	const VirtualHMD *virtualHMD,
+	const t_high_resolution_timepoint capture_timestamp,
+	const HMDOpticalPoseEstimation *poseEstimation,
+	PoseSensorPacketMerger *packet_merger)
+{
+	PoseSensorPacket sensorPacket;
 
-		{
-			PoseFilterPacket filterPacket;
+	sensorPacket.clear();
+	sensorPacket.timestamp = capture_timestamp;
 
-			// Create a filter input packet from the sensor data 
-			// and the filter's previous orientation and position
-			poseFilterSpace->createFilterPacket(sensorPacket, poseFilter, filterPacket);
+	// Virtual HMD can't do optical orientation
+	sensorPacket.optical_orientation = Eigen::Quaternionf::Identity();
 
-			poseFilter->update(delta_time, filterPacket);
-		}
+	if (poseEstimation->bCurrentlyTracking)
+	{
+		sensorPacket.optical_position_cm =
+			Eigen::Vector3f(
+				poseEstimation->position_cm.x,
+				poseEstimation->position_cm.y,
+				poseEstimation->position_cm.z);
+		sensorPacket.tracking_projection_area_px_sqr = poseEstimation->projection.screen_area;
 	}
+
+	packet_merger->pushPacket(PoseSensorPacketMerger::OpticalStream, sensorPacket);
 }
 
 static void generate_morpheus_hmd_data_frame_for_stream(
     const ServerHMDView *hmd_view,
     const HMDStreamInfo *stream_info,
-    DeviceOutputDataFramePtr &data_frame)
+    PSMoveProtocol::DeviceOutputDataFrame *data_frame)
 {
     const MorpheusHMD *morpheus_hmd = hmd_view->castCheckedConst<MorpheusHMD>();
     const MorpheusHMDConfig *morpheus_config = morpheus_hmd->getConfig();
@@ -1271,7 +1440,7 @@ static void generate_morpheus_hmd_data_frame_for_stream(
 static void generate_virtual_hmd_data_frame_for_stream(
     const ServerHMDView *hmd_view,
     const HMDStreamInfo *stream_info,
-    DeviceOutputDataFramePtr &data_frame)
+    PSMoveProtocol::DeviceOutputDataFrame *data_frame)
 {
     const VirtualHMD *virtual_hmd = hmd_view->castCheckedConst<VirtualHMD>();
     const VirtualHMDConfig *virtual_hmd_config = virtual_hmd->getConfig();
@@ -1385,6 +1554,66 @@ static void generate_virtual_hmd_data_frame_for_stream(
     hmd_data_frame->set_hmd_type(PSMoveProtocol::VirtualHMD);
 }
 
+static void generate_morpheus_hmd_compact_data_frame_for_stream(
+    const ServerHMDView *hmd_view,
+    const HMDStreamInfo *stream_info,
+    CompactHMDDataFrame *compact_frame)
+{
+    const IPoseFilter *pose_filter= hmd_view->getPoseFilter();
+    const CommonHMDState *hmd_state= hmd_view->getState();
+
+    if (hmd_state != nullptr)
+    {
+        assert(hmd_state->DeviceType == CommonDeviceState::Morpheus);
+        const CommonDevicePose hmd_pose= hmd_view->getFilteredPose();
+
+        compact_frame->flags|=
+            getCompactDataFrameFlag(hmd_view->getIsTrackingEnabled(), CompactDataFrameFlag_IsTrackingEnabled) |
+            getCompactDataFrameFlag(hmd_view->getIsCurrentlyTracking(), CompactDataFrameFlag_IsCurrentlyTracking) |
+            getCompactDataFrameFlag(pose_filter->getIsStateValid(), CompactDataFrameFlag_IsOrientationValid) |
+            getCompactDataFrameFlag(pose_filter->getIsStateValid(), CompactDataFrameFlag_IsPositionValid);
+        ServerDeviceView::encodeCompactPose(hmd_pose, stream_info->include_position_data, compact_frame->pose);
+
+        if (stream_info->include_physics_data)
+        {
+            ServerDeviceView::encodeCompactPhysics(hmd_view->getFilteredPhysics(), true, compact_frame->physics);
+            compact_frame->flags|= CompactDataFrameFlag_HasPhysicsData;
+        }
+    }
+
+    compact_frame->hmd_type= PSMoveProtocol::Morpheus;
+}
+
+static void generate_virtual_hmd_compact_data_frame_for_stream(
+    const ServerHMDView *hmd_view,
+    const HMDStreamInfo *stream_info,
+    CompactHMDDataFrame *compact_frame)
+{
+    const IPoseFilter *pose_filter= hmd_view->getPoseFilter();
+    const CommonHMDState *hmd_state= hmd_view->getState();
+
+    if (hmd_state != nullptr)
+    {
+        assert(hmd_state->DeviceType == CommonDeviceState::VirtualHMD);
+        const CommonDevicePose hmd_pose= hmd_view->getFilteredPose();
+
+        compact_frame->flags|=
+            getCompactDataFrameFlag(hmd_view->getIsTrackingEnabled(), CompactDataFrameFlag_IsTrackingEnabled) |
+            getCompactDataFrameFlag(hmd_view->getIsCurrentlyTracking(), CompactDataFrameFlag_IsCurrentlyTracking) |
+            getCompactDataFrameFlag(pose_filter->getIsStateValid(), CompactDataFrameFlag_IsPositionValid);
+        ServerDeviceView::encodeCompactPosition(hmd_pose.PositionCm, stream_info->include_position_data, compact_frame->pose);
+
+        // Virtual HMDs have no orientation, so only the linear physics terms get sent
+        if (stream_info->include_physics_data)
+        {
+            ServerDeviceView::encodeCompactPhysics(hmd_view->getFilteredPhysics(), false, compact_frame->physics);
+            compact_frame->flags|= CompactDataFrameFlag_HasPhysicsData;
+        }
+    }
+
+    compact_frame->hmd_type= PSMoveProtocol::VirtualHMD;
+}
+
 static Eigen::Vector3f CommonDevicePosition_to_EigenVector3f(const CommonDevicePosition &p)
 {
     return Eigen::Vector3f(p.x, p.y, p.z);
@@ -1461,6 +1690,31 @@ static void computePointCloudPoseForHmdFromSingleTracker(
     multicam_pose_estimation->projection.screen_area = tracker_pose_estimation->projection.screen_area;
 }
 
+// Opposed trackers see the device from opposite sides of the tracking volume,
+// which makes for a poorly conditioned triangulation when they are the only trackers available
+static bool hasNonOpposedTrackerPair(
+    const ServerTrackerView * const *trackers,
+    const int tracker_count)
+{
+    for (int list_index = 0; list_index < tracker_count; ++list_index)
+    {
+        const CommonDevicePosition tracker_position = trackers[list_index]->getTrackerPose().PositionCm;
+
+        for (int other_list_index = list_index + 1; other_list_index < tracker_count; ++other_list_index)
+        {
+            const CommonDevicePosition other_tracker_position = trackers[other_list_index]->getTrackerPose().PositionCm;
+
+            if ((tracker_position.x > 0) != (other_tracker_position.x < 0) ||
+                (tracker_position.z > 0) != (other_tracker_position.z < 0))
+            {
+                return true;
+            }
+        }
+    }
+
+    return false;
+}
+
 static void computeSpherePoseForHmdFromMultipleTrackers(
     const ServerHMDView *hmdView,
     const TrackerManager* tracker_manager,
@@ -1474,94 +1728,67 @@ static void computeSpherePoseForHmdFromMultipleTrackers(
 
     // Project the tracker relative 3d tracking position back on to the tracker camera plane
     // and sum up the total controller projection area across all trackers
+    const ServerTrackerView *tracker_list[TrackerManager::k_max_devices];
     CommonDeviceScreenLocation position2d_list[TrackerManager::k_max_devices];
+    int biggest_projection_id = -1;
     for (int list_index = 0; list_index < projections_found; ++list_index)
     {
         const int tracker_id = valid_projection_tracker_ids[list_index];
         const ServerTrackerViewPtr tracker = tracker_manager->getTrackerViewPtr(tracker_id);
         const HMDOpticalPoseEstimation &poseEstimate = tracker_pose_estimations[tracker_id];
 
+        tracker_list[list_index] = tracker.get();
         position2d_list[list_index] = tracker->projectTrackerRelativePosition(&poseEstimate.position_cm);
         screen_area_sum += poseEstimate.projection.screen_area;
-    }
 
-    // Compute triangulations amongst all pairs of projections
-    int pair_count = 0;
-    int biggest_prjection_id = -1;
-    CommonDevicePosition average_world_position = { 0.f, 0.f, 0.f };
-    for (int list_index = 0; list_index < projections_found; ++list_index)
-    {
-        const int tracker_id = valid_projection_tracker_ids[list_index];
-        const CommonDeviceScreenLocation &screen_location = position2d_list[list_index];
-        const ServerTrackerViewPtr tracker = tracker_manager->getTrackerViewPtr(tracker_id);
-
-        for (int other_list_index = list_index + 1; other_list_index < projections_found; ++other_list_index)
+        if (biggest_projection_id == -1 ||
+            poseEstimate.projection.screen_area > tracker_pose_estimations[biggest_projection_id].projection.screen_area)
         {
-            const int other_tracker_id = valid_projection_tracker_ids[other_list_index];
-            const CommonDeviceScreenLocation &other_screen_location = position2d_list[other_list_index];
-            const ServerTrackerViewPtr other_tracker = tracker_manager->getTrackerViewPtr(other_tracker_id);
-            // if trackers are on opposite sides
-            if (cfg.exclude_opposed_cameras)
-            {
-                if ((tracker->getTrackerPose().PositionCm.x > 0) == (other_tracker->getTrackerPose().PositionCm.x < 0) &&
-                    (tracker->getTrackerPose().PositionCm.z > 0) == (other_tracker->getTrackerPose().PositionCm.z < 0))
-                {
-                    float screen_area = tracker_pose_estimations[tracker_id].projection.screen_area;
-                    float other_screen_area = tracker_pose_estimations[other_tracker_id].projection.screen_area;
-
-                    biggest_prjection_id = screen_area > other_screen_area ? tracker_id : other_tracker_id;
-
-                    continue;
-                }
-            }
-
-            // Using the screen locations on two different trackers we can triangulate a world position
-            CommonDevicePosition world_position =
-                ServerTrackerView::triangulateWorldPosition(
-                    tracker.get(), &screen_location,
-                    other_tracker.get(), &other_screen_location);
-
-            average_world_position.x += world_position.x;
-            average_world_position.y += world_position.y;
-            average_world_position.z += world_position.z;
-
-            ++pair_count;
+            biggest_projection_id = tracker_id;
         }
     }
 
-    if (pair_count == 0 && biggest_prjection_id >= 0 && !DeviceManager::getInstance()->m_tracker_manager->getConfig().ignore_pose_from_one_tracker)
+    // Triangulate the position from all of the trackers at once,
+    // leaving out the trackers that disagree with the rest
+    CommonDevicePosition world_position;
+    int triangulated_tracker_count = 0;
+    if (!cfg.exclude_opposed_cameras || hasNonOpposedTrackerPair(tracker_list, projections_found))
     {
-        // Position not triangulated from opposed camera, estimate from one tracker only.
-        computeSpherePoseForHmdFromSingleTracker(
-            hmdView,
-            tracker_manager->getTrackerViewPtr(biggest_prjection_id),
-            &tracker_pose_estimations[biggest_prjection_id],
-            multicam_pose_estimation);		
+        triangulated_tracker_count =
+            ServerTrackerView::triangulateWorldPositionFromTrackers(
+                tracker_list,
+                position2d_list,
+                projections_found,
+                cfg.max_triangulation_reprojection_error_px,
+                &world_position);
     }
-    else if(pair_count > 0)
-    {
-        // Compute the average position
-        const float N = static_cast<float>(pair_count);
 
-        average_world_position.x /= N;
-        average_world_position.y /= N;
-        average_world_position.z /= N;
-
-        // Store the averaged tracking position
-        const float q = tracker_manager->getConfig().controller_position_smoothing;
+    if (triangulated_tracker_count > 0)
+    {
+        // Store the triangulated tracking position
+        const float q = cfg.controller_position_smoothing;
         if (q <= 0.01f)
         {
-            multicam_pose_estimation->position_cm = average_world_position;
+            multicam_pose_estimation->position_cm = world_position;
         }
         else
         {
-            multicam_pose_estimation->position_cm.x = q * multicam_pose_estimation->position_cm.x + (1 - q) * average_world_position.x;
-            multicam_pose_estimation->position_cm.y = q * multicam_pose_estimation->position_cm.y + (1 - q) * average_world_position.y;
-            multicam_pose_estimation->position_cm.z = q * multicam_pose_estimation->position_cm.z + (1 - q) * average_world_position.z;
+            multicam_pose_estimation->position_cm.x = q * multicam_pose_estimation->position_cm.x + (1 - q) * world_position.x;
+            multicam_pose_estimation->position_cm.y = q * multicam_pose_estimation->position_cm.y + (1 - q) * world_position.y;
+            multicam_pose_estimation->position_cm.z = q * multicam_pose_estimation->position_cm.z + (1 - q) * world_position.z;
         }
 
         multicam_pose_estimation->bCurrentlyTracking = true;
     }
+    else if (biggest_projection_id >= 0 && !cfg.ignore_pose_from_one_tracker)
+    {
+        // Position not triangulated (e.g. only opposed cameras), estimate from one tracker only.
+        computeSpherePoseForHmdFromSingleTracker(
+            hmdView,
+            tracker_manager->getTrackerViewPtr(biggest_projection_id),
+            &tracker_pose_estimations[biggest_projection_id],
+            multicam_pose_estimation);
+    }
 
     // No orientation for the sphere projection
     multicam_pose_estimation->orientation.clear();
@@ -1586,94 +1813,67 @@ static void computePointCloudPoseForHmdFromMultipleTrackers(
 
     // Project the tracker relative 3d tracking position back on to the tracker camera plane
     // and sum up the total controller projection area across all trackers
+    const ServerTrackerView *tracker_list[TrackerManager::k_max_devices];
     CommonDeviceScreenLocation position2d_list[TrackerManager::k_max_devices];
+    int biggest_projection_id = -1;
     for (int list_index = 0; list_index < projections_found; ++list_index)
     {
         const int tracker_id = valid_projection_tracker_ids[list_index];
         const ServerTrackerViewPtr tracker = tracker_manager->getTrackerViewPtr(tracker_id);
         const HMDOpticalPoseEstimation &poseEstimate = tracker_pose_estimations[tracker_id];
 
+        tracker_list[list_index] = tracker.get();
         position2d_list[list_index] = tracker->projectTrackerRelativePosition(&poseEstimate.position_cm);
         screen_area_sum += poseEstimate.projection.screen_area;
-    }
 
-    // Compute triangulations amongst all pairs of projections
-    int pair_count = 0;
-    int biggest_prjection_id = -1;
-    CommonDevicePosition average_world_position = { 0.f, 0.f, 0.f };
-    for (int list_index = 0; list_index < projections_found; ++list_index)
-    {
-        const int tracker_id = valid_projection_tracker_ids[list_index];
-        const CommonDeviceScreenLocation &screen_location = position2d_list[list_index];
-        const ServerTrackerViewPtr tracker = tracker_manager->getTrackerViewPtr(tracker_id);
-
-        for (int other_list_index = list_index + 1; other_list_index < projections_found; ++other_list_index)
+        if (biggest_projection_id == -1 ||
+            poseEstimate.projection.screen_area > tracker_pose_estimations[biggest_projection_id].projection.screen_area)
         {
-            const int other_tracker_id = valid_projection_tracker_ids[other_list_index];
-            const CommonDeviceScreenLocation &other_screen_location = position2d_list[other_list_index];
-            const ServerTrackerViewPtr other_tracker = tracker_manager->getTrackerViewPtr(other_tracker_id);
-            // if trackers are on opposite sides
-            if (cfg.exclude_opposed_cameras)
-            {
-                if ((tracker->getTrackerPose().PositionCm.x > 0) == (other_tracker->getTrackerPose().PositionCm.x < 0) &&
-                    (tracker->getTrackerPose().PositionCm.z > 0) == (other_tracker->getTrackerPose().PositionCm.z < 0))
-                {
-                    float screen_area = tracker_pose_estimations[tracker_id].projection.screen_area;
-                    float other_screen_area = tracker_pose_estimations[other_tracker_id].projection.screen_area;
-
-                    biggest_prjection_id = screen_area > other_screen_area ? tracker_id : other_tracker_id;
-
-                    continue;
-                }
-            }
-
-            // Using the screen locations on two different trackers we can triangulate a world position
-            CommonDevicePosition world_position =
-                ServerTrackerView::triangulateWorldPosition(
-                    tracker.get(), &screen_location,
-                    other_tracker.get(), &other_screen_location);
-
-            average_world_position.x += world_position.x;
-            average_world_position.y += world_position.y;
-            average_world_position.z += world_position.z;
-
-            ++pair_count;
+            biggest_projection_id = tracker_id;
         }
     }
 
-    if (pair_count == 0 && biggest_prjection_id >= 0 && !DeviceManager::getInstance()->m_tracker_manager->getConfig().ignore_pose_from_one_tracker)
+    // Triangulate the position from all of the trackers at once,
+    // leaving out the trackers that disagree with the rest
+    CommonDevicePosition world_position;
+    int triangulated_tracker_count = 0;
+    if (!cfg.exclude_opposed_cameras || hasNonOpposedTrackerPair(tracker_list, projections_found))
     {
-        // Position not triangulated from opposed camera, estimate from one tracker only.
-        computePointCloudPoseForHmdFromSingleTracker(
-            hmdView,
-            tracker_manager->getTrackerViewPtr(biggest_prjection_id),
-            &tracker_pose_estimations[biggest_prjection_id],
-            multicam_pose_estimation);		
+        triangulated_tracker_count =
+            ServerTrackerView::triangulateWorldPositionFromTrackers(
+                tracker_list,
+                position2d_list,
+                projections_found,
+                cfg.max_triangulation_reprojection_error_px,
+                &world_position);
     }
-    else if(pair_count > 0)
-    {
-        // Compute the average position
-        const float N = static_cast<float>(pair_count);
-
-        average_world_position.x /= N;
-        average_world_position.y /= N;
-        average_world_position.z /= N;
 
-        // Store the averaged tracking position
-        const float q = tracker_manager->getConfig().controller_position_smoothing;
+    if (triangulated_tracker_count > 0)
+    {
+        // Store the triangulated tracking position
+        const float q = cfg.controller_position_smoothing;
         if (q <= 0.01f)
         {
-            multicam_pose_estimation->position_cm = average_world_position;
+            multicam_pose_estimation->position_cm = world_position;
         }
         else
         {
-            multicam_pose_estimation->position_cm.x = q * multicam_pose_estimation->position_cm.x + (1 - q) * average_world_position.x;
-            multicam_pose_estimation->position_cm.y = q * multicam_pose_estimation->position_cm.y + (1 - q) * average_world_position.y;
-            multicam_pose_estimation->position_cm.z = q * multicam_pose_estimation->position_cm.z + (1 - q) * average_world_position.z;
+            multicam_pose_estimation->position_cm.x = q * multicam_pose_estimation->position_cm.x + (1 - q) * world_position.x;
+            multicam_pose_estimation->position_cm.y = q * multicam_pose_estimation->position_cm.y + (1 - q) * world_position.y;
+            multicam_pose_estimation->position_cm.z = q * multicam_pose_estimation->position_cm.z + (1 - q) * world_position.z;
         }
 
         multicam_pose_estimation->bCurrentlyTracking = true;
     }
+    else if (biggest_projection_id >= 0 && !cfg.ignore_pose_from_one_tracker)
+    {
+        // Position not triangulated (e.g. only opposed cameras), estimate from one tracker only.
+        computePointCloudPoseForHmdFromSingleTracker(
+            hmdView,
+            tracker_manager->getTrackerViewPtr(biggest_projection_id),
+            &tracker_pose_estimations[biggest_projection_id],
+            multicam_pose_estimation);
+    }
 
     // No orientation for the sphere projection
     multicam_pose_estimation->orientation.clear();
@@ -4,8 +4,12 @@
 //-- includes -----
 #include "ServerDeviceView.h"
 #include "PSMoveProtocolInterface.h"
+#include "PoseSensorPacketMerger.h"
+#include "TrackerManager.h"
 #include <cstring>
 
+#include "readerwriterqueue.h" // lockfree queue
+
 // -- pre-declarations -----
 class TrackerManager;
 
@@ -14,6 +18,8 @@ struct HMDOpticalPoseEstimation
 {
 	std::chrono::time_point<std::chrono::high_resolution_clock> last_update_timestamp;
 	std::chrono::time_point<std::chrono::high_resolution_clock> last_visible_timestamp;
+	// When the video frame(s) the estimate was computed from were captured
+	std::chrono::time_point<std::chrono::high_resolution_clock> capture_timestamp;
 	bool bValidTimestamps;
 
 	CommonDevicePosition position_cm;
@@ -27,6 +33,7 @@ struct HMDOpticalPoseEstimation
 	{
 		last_update_timestamp = std::chrono::time_point<std::chrono::high_resolution_clock>();
 		last_visible_timestamp = std::chrono::time_point<std::chrono::high_resolution_clock>();
+		capture_timestamp = std::chrono::time_point<std::chrono::high_resolution_clock>();
 		bValidTimestamps = false;
 
 		position_cm.clear();
@@ -40,6 +47,8 @@ struct HMDOpticalPoseEstimation
 	}
 };
 
+using t_hmd_optical_projection_queue= moodycamel::ReaderWriterQueue<HMDOpticalPoseEstimation>;
+
 class ServerHMDView : public ServerDeviceView
 {
 public:
@@ -52,6 +61,9 @@ public:
 	// Recreate and initialize the pose filter for the HMD
 	void resetPoseFilter();
 
+	// Ask every tracker with a new video frame to search for this HMD's tracking blobs
+	void requestTrackerProjections(TrackerManager* tracker_manager);
+
 	// Compute pose/prediction of tracking blob+IMU state
 	void updateOpticalPoseEstimation(TrackerManager* tracker_manager);
     void updateStateAndPredict();
@@ -126,6 +138,9 @@ public:
 		return getIsTrackingEnabled() ? m_multicam_pose_estimation->bCurrentlyTracking : false;
 	}
 
+	// Incoming tracker projection callback (called from the tracker's vision thread)
+	void notifyTrackerDataReceived(int tracker_id, const HMDOpticalPoseEstimation *tracker_pose_estimate);
+
 protected:
 	void set_tracking_enabled_internal(bool bEnabled);
     bool allocate_device_interface(const class DeviceEnumerator *enumerator) override;
@@ -134,7 +149,13 @@ protected:
     static void generate_hmd_data_frame_for_stream(
         const ServerHMDView *hmd_view,
         const struct HMDStreamInfo *stream_info,
-        DeviceOutputDataFramePtr &data_frame);
+        PSMoveProtocol::DeviceOutputDataFrame *data_frame);
+    static void generate_compact_hmd_data_frame_for_stream(
+        const ServerHMDView *hmd_view,
+        const struct HMDStreamInfo *stream_info,
+        struct CompactHMDDataFrame *compact_frame);
+    CommonDevicePose compute_filtered_pose(float time) const;
+    CommonDevicePhysics compute_filtered_physics() const;
 
 private:
 	// Tracking color state
@@ -150,11 +171,14 @@ private:
 	// Filter state
 	HMDOpticalPoseEstimation *m_tracker_pose_estimations; // array of size TrackerManager::k_max_devices
 	HMDOpticalPoseEstimation *m_multicam_pose_estimation;
+	t_hmd_optical_projection_queue m_TrackerProjectionQueues[TrackerManager::k_max_devices];
+	PoseSensorPacketMerger m_PoseSensorPacketMerger;
 	class IPoseFilter *m_pose_filter;
 	class PoseFilterSpace *m_pose_filter_space;
+	class PoseFilterHistory *m_pose_filter_history;
     int m_lastPollSeqNumProcessed;
-	std::chrono::time_point<std::chrono::high_resolution_clock> m_last_filter_update_timestamp;
-	bool m_last_filter_update_timestamp_valid;
+	std::chrono::time_point<std::chrono::high_resolution_clock> m_lastSensorDataTimestamp;
+	bool m_bIsLastSensorDataTimestampValid;
 };
 
 #endif // SERVER_HMD_VIEW_H
\ No newline at end of file
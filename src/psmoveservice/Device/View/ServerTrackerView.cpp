@@ -9,6 +9,8 @@
 #include "MathGLM.h"
 #include "MathAlignment.h"
 #include "PS3EyeTracker.h"
+#include "BlobExtractor.h"
+#include "HSVThresholdKernel.h"
 #include "PSMoveProtocol.pb.h"
 #include "ServerUtility.h"
 #include "ServerLog.h"
@@ -16,21 +18,43 @@
 #include "SharedTrackerState.h"
 #include "TrackerManager.h"
 #include "PoseFilterInterface.h"
+#include "WorkerThread.h"
 
 #include <boost/interprocess/shared_memory_object.hpp>
 #include <boost/interprocess/mapped_region.hpp>
-#include <boost/interprocess/sync/scoped_lock.hpp>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
 #include <memory>
+#include <mutex>
+#include <thread>
 
 #include "opencv2/opencv.hpp"
 #include "opencv2/calib3d/calib3d.hpp"
 
 #include <algorithm>
 
+#include "readerwriterqueue.h" // lockfree queue
+
 #define USE_OPEN_CV_ELLIPSE_FIT
 
 //-- constants ----
 static const int k_min_roi_size= 32;
+static const int k_debayer_border= 2; // Extra pixels debayered around a region so its edges get real neighbors
+static const int k_max_vision_jobs= PSMOVESERVICE_MAX_CONTROLLER_COUNT + PSMOVESERVICE_MAX_HMD_COUNT;
+static const std::int64_t k_vision_job_wait_timeout_usec= 10000;
+static const int k_vision_job_slow_warning_msec= 100; // Vision batches that take longer than this get logged
+
+// The tracking color lookup table quantizes each color channel down to this many bits.
+// 6 bits per channel gives a 64x64x64 table of 1-byte color masks (256KB), which stays in L2 cache.
+static const int k_tracking_color_lut_channel_bits= 6;
+static const int k_tracking_color_lut_channel_shift= 8 - k_tracking_color_lut_channel_bits;
+static const int k_tracking_color_lut_channel_size= 1 << k_tracking_color_lut_channel_bits;
+static const int k_tracking_color_lut_entry_count= 
+    k_tracking_color_lut_channel_size * k_tracking_color_lut_channel_size * k_tracking_color_lut_channel_size;
+// One label per bit of the 8-bit label image, i.e. at most this many distinct color ranges per frame
+static const int k_max_tracking_color_labels= 8;
+static_assert(eCommonTrackingColorID::MAX_TRACKING_COLOR_TYPES <= k_max_tracking_color_labels, "Every tracking color id needs its own label");
 
 //-- typedefs ----
 typedef std::vector<cv::Point> t_opencv_int_contour;
@@ -43,6 +67,11 @@ typedef std::vector<t_opencv_float_contour> t_opencv_float_contour_list;
 template<typename t_opencv_contour_type>
 cv::Point2f computeSafeCenterOfMassForContour(const t_opencv_contour_type &contour);
 
+//-- utility methods
+static void computeOpenCVCameraIntrinsicMatrix(const ITrackerInterface *tracker_device,
+                                               cv::Matx33f &intrinsicOut,
+                                               cv::Matx<float, 5, 1> &distortionOut);
+
 //-- private methods -----
 class SharedVideoFrameReadWriteAccessor
 {
@@ -50,6 +79,7 @@ public:
     SharedVideoFrameReadWriteAccessor()
         : m_shared_memory_object(nullptr)
         , m_region(nullptr)
+        , m_writing_frame_index(0)
     {}
 
     ~SharedVideoFrameReadWriteAccessor()
@@ -84,23 +114,22 @@ public:
                     permissions);
 
             // Resize the shared memory
-            m_shared_memory_object->truncate(SharedVideoFrameHeader::computeTotalSize(stride, width));
+            m_shared_memory_object->truncate(SharedVideoFrameHeader::computeTotalSize(stride, height));
 
             // Map all of the shared memory for read/write access
             m_region = new boost::interprocess::mapped_region(*m_shared_memory_object, boost::interprocess::read_write);
 
             // Initialize the shared memory (call constructor using placement new)
-            // This make sure the mutex has the constructor called on it.
+            // This make sure the slot sequence counters have the constructor called on them.
             SharedVideoFrameHeader *frameState = new (getFrameHeader()) SharedVideoFrameHeader();
             
             frameState->width = width;
             frameState->height = height;
             frameState->stride = stride;
-            frameState->frame_index = 0;
             std::memset(
-                frameState->getBufferMutable(),
+                frameState->getSlotBufferMutable(0),
                 0,
-                SharedVideoFrameHeader::computeVideoBufferSize(stride, height));
+                SHARED_VIDEO_FRAME_SLOT_COUNT*SharedVideoFrameHeader::computeVideoBufferSize(stride, height));
 
             bSuccess = true;
         }
@@ -119,7 +148,6 @@ public:
         if (m_region != nullptr)
         {
             // Call the destructor manually on the frame header since it was constructed via placement new
-            // This will make sure the mutex has the destructor called on it.
             getFrameHeader()->~SharedVideoFrameHeader();
             
             delete m_region;
@@ -138,19 +166,45 @@ public:
         }
     }
 
-    void writeVideoFrame(const unsigned char *buffer)
+    // Claims the next slot in the frame ring and returns its buffer for the caller to draw the frame into.
+    // Readers skip over the slot until endVideoFrameWrite() is called, so this never waits on a reader.
+    unsigned char *beginVideoFrameWrite()
     {
         SharedVideoFrameHeader *sharedFrameState = getFrameHeader();
-        boost::interprocess::scoped_lock<boost::interprocess::interprocess_mutex> lock(sharedFrameState->mutex);
+        assert(m_region->get_size() >= SharedVideoFrameHeader::computeTotalSize(sharedFrameState->stride, sharedFrameState->height));
+        assert(m_writing_frame_index == 0);
 
-        size_t buffer_size = 
-            SharedVideoFrameHeader::computeVideoBufferSize(sharedFrameState->stride, sharedFrameState->height);
-        size_t total_shared_mem_size =
-            SharedVideoFrameHeader::computeTotalSize(sharedFrameState->stride, sharedFrameState->height);
-        assert(m_region->get_size() >= total_shared_mem_size);
+        m_writing_frame_index = sharedFrameState->latest_frame_index.load(std::memory_order_relaxed) + 1;
 
-        ++sharedFrameState->frame_index;
-        std::memcpy(sharedFrameState->getBufferMutable(), buffer, buffer_size);
+        const int slot_index = SharedVideoFrameHeader::getSlotIndex(m_writing_frame_index);
+        SharedVideoFrameSlot &slot = sharedFrameState->slots[slot_index];
+
+        // Odd sequence number marks the slot as being written
+        slot.sequence.store(slot.sequence.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        slot.frame_index.store(m_writing_frame_index, std::memory_order_relaxed);
+
+        return sharedFrameState->getSlotBufferMutable(slot_index);
+    }
+
+    // Publishes the frame started with beginVideoFrameWrite() as the newest frame
+    void endVideoFrameWrite()
+    {
+        assert(m_writing_frame_index != 0);
+
+        SharedVideoFrameHeader *sharedFrameState = getFrameHeader();
+        SharedVideoFrameSlot &slot = sharedFrameState->slots[SharedVideoFrameHeader::getSlotIndex(m_writing_frame_index)];
+
+        // Even sequence number marks the slot as complete
+        slot.sequence.store(slot.sequence.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+        sharedFrameState->latest_frame_index.store(m_writing_frame_index, std::memory_order_release);
+
+        m_writing_frame_index = 0;
+    }
+
+    inline bool getIsWritingVideoFrame() const
+    {
+        return m_writing_frame_index != 0;
     }
 
 protected:
@@ -163,6 +217,7 @@ private:
     const char *m_shared_memory_name;
     boost::interprocess::shared_memory_object *m_shared_memory_object;
     boost::interprocess::mapped_region *m_region;
+    int m_writing_frame_index;
 };
 
 struct OpenCVPlane2D
@@ -248,17 +303,19 @@ struct OpenCVPlane2D
     }
 };
 
-class OpenCVBGRToHSVMapper
+// The HSV color at the center of every bin of the quantized RGB color cube.
+// This never changes, so a single copy is shared by every tracker.
+class OpenCVQuantizedRGBToHSVTable
 {
 public:
     typedef cv::Point3_<uint8_t> ColorTuple;
 
-    static OpenCVBGRToHSVMapper *allocate()
+    static OpenCVQuantizedRGBToHSVTable *allocate()
     {
         if (m_refCount == 0)
         {
             assert(m_instance == nullptr);
-            m_instance = new OpenCVBGRToHSVMapper();
+            m_instance = new OpenCVQuantizedRGBToHSVTable();
         }
         assert(m_instance != nullptr);
 
@@ -266,7 +323,7 @@ public:
         return m_instance;
     }
 
-    static void dispose(OpenCVBGRToHSVMapper *instance)
+    static void dispose(OpenCVQuantizedRGBToHSVTable *instance)
     {
         assert(m_instance != nullptr);
         assert(m_instance == instance);
@@ -280,90 +337,312 @@ public:
         }
     }
 
-    void cvtColor(const cv::Mat &bgrBuffer, cv::Mat &hsvBuffer)
-    {
-        hsvBuffer.forEach<ColorTuple>([&bgrBuffer, this](ColorTuple &hsvColor, const int position[]) -> void {
-            const ColorTuple &bgrColor = bgrBuffer.at<ColorTuple>(position[0], position[1]);
-            const int b = bgrColor.x;
-            const int g = bgrColor.y;
-            const int r = bgrColor.z;
-            const int LUTIndex = OpenCVBGRToHSVMapper::getLUTIndex(r, g, b);
+    // Planar copies of the table, in the layout the threshold kernels want
+    inline const uint8_t *getHuePlane() const { return hsvPlanes[0].ptr<uint8_t>(); }
+    inline const uint8_t *getSaturationPlane() const { return hsvPlanes[1].ptr<uint8_t>(); }
+    inline const uint8_t *getValuePlane() const { return hsvPlanes[2].ptr<uint8_t>(); }
 
-            hsvColor = bgr2hsv->at<ColorTuple>(LUTIndex, 0);
-        });
+    static inline int getLUTIndex(const int r, const int g, const int b)
+    {
+        return
+            ((r >> k_tracking_color_lut_channel_shift) << (2*k_tracking_color_lut_channel_bits)) |
+            ((g >> k_tracking_color_lut_channel_shift) << k_tracking_color_lut_channel_bits) |
+            (b >> k_tracking_color_lut_channel_shift);
     }
 
 private:
-    static OpenCVBGRToHSVMapper *m_instance;
+    static OpenCVQuantizedRGBToHSVTable *m_instance;
     static int m_refCount;
 
-    OpenCVBGRToHSVMapper()
+    OpenCVQuantizedRGBToHSVTable()
     {
-        bgr2hsv = new cv::Mat(256*256*256, 1, CV_8UC3);
+        cv::Mat rgb2hsv(k_tracking_color_lut_entry_count, 1, CV_8UC3);
+
+        // Sample the center of each bin
+        const int bin_center = (1 << k_tracking_color_lut_channel_shift) / 2;
 
         int LUTIndex = 0;
-        for (int r = 0; r < 256; ++r)
+        for (int r = 0; r < k_tracking_color_lut_channel_size; ++r)
         {
-            for (int g = 0; g < 256; ++g)
+            for (int g = 0; g < k_tracking_color_lut_channel_size; ++g)
             {
-                for (int b = 0; b < 256; ++b)
+                for (int b = 0; b < k_tracking_color_lut_channel_size; ++b)
                 {
-                    bgr2hsv->at<ColorTuple>(LUTIndex, 0) = ColorTuple(b, g, r);
+                    rgb2hsv.at<ColorTuple>(LUTIndex, 0) = 
+                        ColorTuple(
+                            (b << k_tracking_color_lut_channel_shift) + bin_center,
+                            (g << k_tracking_color_lut_channel_shift) + bin_center,
+                            (r << k_tracking_color_lut_channel_shift) + bin_center);
                     ++LUTIndex;
                 }
             }
         }
 
-        cv::cvtColor(*bgr2hsv, *bgr2hsv, cv::COLOR_BGR2HSV);
+        cv::cvtColor(rgb2hsv, rgb2hsv, cv::COLOR_BGR2HSV);
+        cv::split(rgb2hsv, hsvPlanes);
+    }
+
+    cv::Mat hsvPlanes[3];
+};
+OpenCVQuantizedRGBToHSVTable *OpenCVQuantizedRGBToHSVTable::m_instance = nullptr;
+int OpenCVQuantizedRGBToHSVTable::m_refCount= 0;
+
+// Integer bounds of a tracking color's HSV range, matching what cv::inRange would test against.
+// Hue ranges that wrap around 0/180 get split into two hue intervals.
+static HSVThresholdBounds createHSVThresholdBounds(const CommonHSVColorRange &hsvColorRange)
+{
+    HSVThresholdBounds bounds;
+
+    const float hue_min = hsvColorRange.hue_range.center - hsvColorRange.hue_range.range;
+    const float hue_max = hsvColorRange.hue_range.center + hsvColorRange.hue_range.range;
+
+    bounds.saturation_min = cv::saturate_cast<uint8_t>(clampf(hsvColorRange.saturation_range.center - hsvColorRange.saturation_range.range, 0, 255));
+    bounds.saturation_max = cv::saturate_cast<uint8_t>(clampf(hsvColorRange.saturation_range.center + hsvColorRange.saturation_range.range, 0, 255));
+    bounds.value_min = cv::saturate_cast<uint8_t>(clampf(hsvColorRange.value_range.center - hsvColorRange.value_range.range, 0, 255));
+    bounds.value_max = cv::saturate_cast<uint8_t>(clampf(hsvColorRange.value_range.center + hsvColorRange.value_range.range, 0, 255));
+
+    if (hue_min < 0)
+    {
+        bounds.hue_min[0] = 0;
+        bounds.hue_max[0] = cv::saturate_cast<uint8_t>(clampf(hue_max, 0, 180));
+        bounds.hue_min[1] = cv::saturate_cast<uint8_t>(clampf(180 + hue_min, 0, 180));
+        bounds.hue_max[1] = 180;
+    }
+    else if (hue_max > 180)
+    {
+        bounds.hue_min[0] = 0;
+        bounds.hue_max[0] = cv::saturate_cast<uint8_t>(clampf(hue_max - 180, 0, 180));
+        bounds.hue_min[1] = cv::saturate_cast<uint8_t>(clampf(hue_min, 0, 180));
+        bounds.hue_max[1] = 180;
+    }
+    else
+    {
+        bounds.hue_min[0] = bounds.hue_min[1] = cv::saturate_cast<uint8_t>(hue_min);
+        bounds.hue_max[0] = bounds.hue_max[1] = cv::saturate_cast<uint8_t>(hue_max);
+    }
+
+    return bounds;
+}
+
+static bool areHSVThresholdBoundsEqual(const HSVThresholdBounds &a, const HSVThresholdBounds &b)
+{
+    return
+        a.hue_min[0] == b.hue_min[0] && a.hue_max[0] == b.hue_max[0] &&
+        a.hue_min[1] == b.hue_min[1] && a.hue_max[1] == b.hue_max[1] &&
+        a.saturation_min == b.saturation_min && a.saturation_max == b.saturation_max &&
+        a.value_min == b.value_min && a.value_max == b.value_max;
+}
+
+// Maps a quantized BGR pixel straight to a bitmask of the labeled color ranges it matches (bit N = label N),
+// so segmenting a frame never has to convert it to HSV.
+// Each label owns one bit-plane of the table, which only gets rebuilt
+// when the HSV range assigned to that label changes.
+class OpenCVTrackingColorClassifier
+{
+public:
+    OpenCVTrackingColorClassifier()
+        : rgb2hsv(OpenCVQuantizedRGBToHSVTable::allocate())
+        , colorMasks(new uint8_t[k_tracking_color_lut_entry_count])
+    {
+        std::memset(colorMasks, 0, k_tracking_color_lut_entry_count);
+
+        for (int label_index = 0; label_index < k_max_tracking_color_labels; ++label_index)
+        {
+            bLabelBoundsValid[label_index] = false;
+        }
+    }
+
+    ~OpenCVTrackingColorClassifier()
+    {
+        delete[] colorMasks;
+        OpenCVQuantizedRGBToHSVTable::dispose(rgb2hsv);
+    }
+
+    inline bool hasLabelBounds(const int label_index, const HSVThresholdBounds &bounds) const
+    {
+        return bLabelBoundsValid[label_index] && areHSVThresholdBoundsEqual(labelBounds[label_index], bounds);
     }
 
-    ~OpenCVBGRToHSVMapper()
+    // Returns true if the bit-plane for the given label had to be rebuilt
+    bool updateLabelBounds(const int label_index, const HSVThresholdBounds &bounds)
     {
-        delete bgr2hsv;
+        if (hasLabelBounds(label_index, bounds))
+        {
+            return false;
+        }
+
+        // Threshold the whole table against the new range in one (SIMD) pass
+        hsv_threshold_update_mask_bit(
+            rgb2hsv->getHuePlane(),
+            rgb2hsv->getSaturationPlane(),
+            rgb2hsv->getValuePlane(),
+            k_tracking_color_lut_entry_count,
+            bounds,
+            static_cast<uint8_t>(1 << label_index),
+            colorMasks);
+
+        labelBounds[label_index] = bounds;
+        bLabelBoundsValid[label_index] = true;
+
+        return true;
     }
 
-    static int getLUTIndex(int r, int g, int b)
+    inline uint8_t classify(const int b, const int g, const int r) const
     {
-        return (256 * 256)*r + 256*g + b;
+        return colorMasks[OpenCVQuantizedRGBToHSVTable::getLUTIndex(r, g, b)];
     }
 
-    cv::Mat *bgr2hsv;
+private:
+    OpenCVQuantizedRGBToHSVTable *rgb2hsv;
+    uint8_t *colorMasks;
+    HSVThresholdBounds labelBounds[k_max_tracking_color_labels];
+    bool bLabelBoundsValid[k_max_tracking_color_labels];
+};
+
+// Caches the camera intrinsics of a tracker along with the undistorted location of every pixel in its frame.
+// Contour points are always integer pixels, so undistorting a contour becomes a table lookup per point
+// instead of running the iterative cv::undistortPoints() solve on every contour of every frame.
+// Has to be rebuilt whenever the camera intrinsics or the frame size change.
+class OpenCVUndistortionTable
+{
+public:
+    OpenCVUndistortionTable()
+        : frameWidth(0)
+        , frameHeight(0)
+    {
+    }
+
+    void rebuild(const ITrackerInterface *tracker_device)
+    {
+        tracker_device->getVideoFrameDimensions(&frameWidth, &frameHeight, nullptr);
+        computeOpenCVCameraIntrinsicMatrix(tracker_device, intrinsicMatrix, distortionCoefficients);
+
+        // Undistort every pixel of the frame in one batch
+        t_opencv_float_contour pixels;
+        pixels.reserve(frameWidth*frameHeight);
+        for (int y = 0; y < frameHeight; ++y)
+        {
+            for (int x = 0; x < frameWidth; ++x)
+            {
+                pixels.push_back(cv::Point2f(static_cast<float>(x), static_cast<float>(y)));
+            }
+        }
+
+        if (pixels.size() > 0)
+        {
+            cv::undistortPoints(pixels, normalizedPoints, intrinsicMatrix, distortionCoefficients);
+        }
+        else
+        {
+            normalizedPoints.clear();
+        }
+    }
+
+    inline const cv::Matx33f &getIntrinsicMatrix() const { return intrinsicMatrix; }
+    inline const cv::Matx<float, 5, 1> &getDistortionCoefficients() const { return distortionCoefficients; }
+
+    // Same as cv::undistortPoints(contour, out_contour, camera_matrix, distortions):
+    // the points are relative to the focal length and principal point
+    void undistortContourToNormalized(const t_opencv_int_contour &contour, t_opencv_float_contour &out_contour) const
+    {
+        out_contour.resize(contour.size());
+
+        for (size_t point_index = 0; point_index < contour.size(); ++point_index)
+        {
+            out_contour[point_index] = lookupNormalizedPoint(contour[point_index]);
+        }
+    }
+
+    // Same as above, but writes the normalized points straight into a point list for the Eigen fitting functions
+    void undistortContourToNormalized(const t_opencv_int_contour &contour, std::vector<Eigen::Vector2f> &out_points) const
+    {
+        out_points.resize(contour.size());
+
+        for (size_t point_index = 0; point_index < contour.size(); ++point_index)
+        {
+            const cv::Point2f &normalized = lookupNormalizedPoint(contour[point_index]);
+
+            out_points[point_index] = Eigen::Vector2f(normalized.x, normalized.y);
+        }
+    }
+
+    // Same as cv::undistortPoints(contour, out_contour, camera_matrix, distortions, cv::noArray(), camera_matrix):
+    // the normalized points get projected back onto the image
+    void undistortContourToPixels(const t_opencv_int_contour &contour, t_opencv_float_contour &out_contour) const
+    {
+        const float fx = intrinsicMatrix(0, 0), fy = intrinsicMatrix(1, 1);
+        const float cx = intrinsicMatrix(0, 2), cy = intrinsicMatrix(1, 2);
+
+        out_contour.resize(contour.size());
+
+        for (size_t point_index = 0; point_index < contour.size(); ++point_index)
+        {
+            const cv::Point2f &normalized = lookupNormalizedPoint(contour[point_index]);
+
+            out_contour[point_index] = cv::Point2f(normalized.x*fx + cx, normalized.y*fy + cy);
+        }
+    }
+
+private:
+    inline const cv::Point2f &lookupNormalizedPoint(const cv::Point &pixel) const
+    {
+        assert(pixel.x >= 0 && pixel.x < frameWidth && pixel.y >= 0 && pixel.y < frameHeight);
+        return normalizedPoints[pixel.y*frameWidth + pixel.x];
+    }
+
+    int frameWidth;
+    int frameHeight;
+    cv::Matx33f intrinsicMatrix;
+    cv::Matx<float, 5, 1> distortionCoefficients;
+    t_opencv_float_contour normalizedPoints; // undistorted location of every pixel, row major
 };
-OpenCVBGRToHSVMapper *OpenCVBGRToHSVMapper::m_instance = nullptr;
-int OpenCVBGRToHSVMapper::m_refCount= 0;
 
 class OpenCVBufferState
 {
 public:
     OpenCVBufferState(ITrackerInterface *device)
-        : bgrBuffer(nullptr)
+        : bayerBuffer(nullptr)
+        , bgrBuffer(nullptr)
         , bgrShmemBuffer(nullptr)
-        , hsvBuffer(nullptr)
-        , gsLowerBuffer(nullptr)
-        , gsUpperBuffer(nullptr)
+        , labelBuffer(nullptr)
         , maskedBuffer(nullptr)
+        , colorClassifier(nullptr)
+        , blobExtractor(nullptr)
+        , undistortionTable(nullptr)
     {
         device->getVideoFrameDimensions(&frameWidth, &frameHeight, nullptr);
-
-        bgrBuffer = new cv::Mat(frameHeight, frameWidth, CV_8UC3);
-        bgrShmemBuffer = new cv::Mat(frameHeight, frameWidth, CV_8UC3);
-        hsvBuffer = new cv::Mat(frameHeight, frameWidth, CV_8UC3);
-        gsLowerBuffer = new cv::Mat(frameHeight, frameWidth, CV_8UC1);
-        gsUpperBuffer = new cv::Mat(frameHeight, frameWidth, CV_8UC1);
-        maskedBuffer = new cv::Mat(frameHeight, frameWidth, CV_8UC3);
-        
-        const TrackerManagerConfig &cfg= DeviceManager::getInstance()->m_tracker_manager->getConfig();
-        if (cfg.use_bgr_to_hsv_lookup_table)
+        frameFormat = device->getVideoFrameFormat();
+        bIsBGRBufferComplete = false;
+        bDrawDebugOverlay = false;
+
+        // The source frame buffers just point at the tracker's current video frame (see writeVideoFrame()).
+        // Only Bayer trackers need storage of their own to debayer into.
+        bayerBuffer = new cv::Mat();
+        if (frameFormat == ITrackerInterface::BayerGB)
         {
-            bgr2hsv = OpenCVBGRToHSVMapper::allocate();
+            bgrBuffer = new cv::Mat(frameHeight, frameWidth, CV_8UC3);
         }
         else
         {
-            bgr2hsv = nullptr;
+            bgrBuffer = new cv::Mat();
         }
-        
+        bgrShmemBuffer = new cv::Mat();
+        labelBuffer = new cv::Mat(frameHeight, frameWidth, CV_8UC1, cv::Scalar(0));
+        maskedBuffer = new cv::Mat(frameHeight, frameWidth, CV_8UC3);
+        colorClassifier = new OpenCVTrackingColorClassifier();
+        blobExtractor = new BlobExtractor();
+        blobExtractor->reserve(frameWidth, frameHeight, CommonDeviceTrackingProjection::MAX_POINT_CLOUD_POINT_COUNT);
+        undistortionTable = new OpenCVUndistortionTable();
+        undistortionTable->rebuild(device);
+
+        // One contour buffer per blob we can ever keep, so tracing contours doesn't allocate once they've grown
+        biggestContours.resize(CommonDeviceTrackingProjection::MAX_POINT_CLOUD_POINT_COUNT);
+        biggestContourAreas.reserve(CommonDeviceTrackingProjection::MAX_POINT_CLOUD_POINT_COUNT);
+        undistortedContours.resize(CommonDeviceTrackingProjection::MAX_POINT_CLOUD_POINT_COUNT);
+
         //Apply default ROI (full frame).
-        applyROI(cv::Rect2i(cv::Point(0,0), cv::Size(frameWidth, frameHeight)));
+        segmentedROI = cv::Rect2i(cv::Point(0,0), cv::Size(frameWidth, frameHeight));
+        applyROI(segmentedROI);
     }
 
     virtual ~OpenCVBufferState()
@@ -373,61 +652,236 @@ public:
             delete maskedBuffer;
         }
         
-        if (gsLowerBuffer != nullptr)
+        if (labelBuffer != nullptr)
         {
-            delete gsLowerBuffer;
+            delete labelBuffer;
         }
         
-        if (gsUpperBuffer != nullptr)
+        if (bgrShmemBuffer != nullptr)
         {
-            delete gsUpperBuffer;
+            delete bgrShmemBuffer;
         }
         
-        if (hsvBuffer != nullptr)
+        if (bgrBuffer != nullptr)
         {
-            delete hsvBuffer;
+            delete bgrBuffer;
         }
         
-        if (bgrShmemBuffer != nullptr)
+        if (bayerBuffer != nullptr)
         {
-            delete bgrShmemBuffer;
+            delete bayerBuffer;
         }
         
-        if (bgrBuffer != nullptr)
+        if (colorClassifier != nullptr)
         {
-            delete bgrBuffer;
+            delete colorClassifier;
         }
-        
-        if (bgr2hsv != nullptr)
+
+        if (blobExtractor != nullptr)
         {
-            OpenCVBGRToHSVMapper::dispose(bgr2hsv);
+            delete blobExtractor;
+        }
+
+        if (undistortionTable != nullptr)
+        {
+            delete undistortionTable;
         }
     }
 
-    void writeVideoFrame(const unsigned char *video_buffer)
+    // The video buffer is referenced rather than copied.
+    // It belongs to the tracker and stays valid until the tracker is polled again,
+    // which never happens while the vision thread is processing the frame.
+    // Changing the capture settings can free it too, so the vision thread gets paused
+    // and releaseVideoFrame() called before those change (see ServerTrackerView::pauseVisionProcessor()).
+    // Only when someone is watching the video stream do we copy the frame into the given
+    // debug frame buffer (a slot of the shared memory video ring) to draw the debug overlay on.
+    // Returns the number of bytes copied.
+    size_t writeVideoFrame(const unsigned char *video_buffer, unsigned char *debug_frame_buffer)
     {
-        const cv::Mat videoBufferMat(frameHeight, frameWidth, CV_8UC3, const_cast<unsigned char *>(video_buffer));
+        const bool bNeedsDebugFrame = debug_frame_buffer != nullptr;
+        size_t copied_byte_count = 0;
 
-        videoBufferMat.copyTo(*bgrBuffer);
-        videoBufferMat.copyTo(*bgrShmemBuffer);
+        if (frameFormat == ITrackerInterface::BayerGB)
+        {
+            *bayerBuffer = cv::Mat(frameHeight, frameWidth, CV_8UC1, const_cast<unsigned char *>(video_buffer));
+
+            // Only pay for debayering the whole frame if someone is watching the video stream.
+            // Otherwise segmentTrackingColors() debayers just the regions it needs.
+            if (bNeedsDebugFrame)
+            {
+                cv::cvtColor(*bayerBuffer, *bgrBuffer, cv::COLOR_BayerGB2BGR);
+                bIsBGRBufferComplete = true;
+            }
+            else
+            {
+                bIsBGRBufferComplete = false;
+            }
+        }
+        else
+        {
+            *bgrBuffer = cv::Mat(frameHeight, frameWidth, CV_8UC3, const_cast<unsigned char *>(video_buffer));
+            bIsBGRBufferComplete = true;
+        }
+
+        if (bNeedsDebugFrame)
+        {
+            *bgrShmemBuffer = cv::Mat(frameHeight, frameWidth, CV_8UC3, debug_frame_buffer);
+            bgrBuffer->copyTo(*bgrShmemBuffer);
+            copied_byte_count += bgrBuffer->total() * bgrBuffer->elemSize();
+        }
+        else
+        {
+            bgrShmemBuffer->release();
+        }
+        bDrawDebugOverlay = bNeedsDebugFrame;
+
+        return copied_byte_count;
+    }
+
+    // Drop the references to the tracker's video frame and the shared memory video ring slot
+    void releaseVideoFrame()
+    {
+        bayerBuffer->release();
+        if (frameFormat != ITrackerInterface::BayerGB)
+        {
+            bgrBuffer->release();
+        }
+        bgrShmemBuffer->release();
+        bIsBGRBufferComplete = false;
+        bDrawDebugOverlay = false;
+    }
+
+    // Fill in the bgr buffer over the given region from the raw Bayer frame
+    void debayerRegion(const cv::Rect2i &region)
+    {
+        // Keep the origin on an even pixel so the sub-image starts on the same Bayer phase as the full frame
+        const int x0 = std::max(region.x - k_debayer_border, 0) & ~1;
+        const int y0 = std::max(region.y - k_debayer_border, 0) & ~1;
+        const int x1 = std::min(region.x + region.width + k_debayer_border, frameWidth);
+        const int y1 = std::min(region.y + region.height + k_debayer_border, frameHeight);
+        const cv::Rect2i debayer_region(x0, y0, x1 - x0, y1 - y0);
+
+        const cv::Mat bayerRegion(*bayerBuffer, debayer_region);
+        cv::Mat bgrRegion(*bgrBuffer, debayer_region);
+        cv::cvtColor(bayerRegion, bgrRegion, cv::COLOR_BayerGB2BGR);
     }
     
-    void updateHsvBuffer()
+    // Classify every pixel in the given region against all of the given color ranges in one pass.
+    // Each distinct color range gets a label, and each pixel of the label buffer gets a bitmask
+    // with bit N set if the pixel matches label N. Devices sharing a tracking color id can still
+    // have their own presets, so labels are handed out per color range rather than per color id.
+    // Every device on this tracker then pulls its own mask (out_label_masks) out of the same label buffer.
+    void segmentTrackingColors(
+        const CommonHSVColorRange * const *color_ranges,
+        const eCommonTrackingColorID *color_ids,
+        const int range_count,
+        uint8_t *out_label_masks,
+        cv::Rect2i region)
+    {
+        region = clampROI(region);
+
+        // Refresh the bit-planes of any labels whose range changed since the last frame
+        HSVThresholdBounds label_bounds[k_max_tracking_color_labels];
+        uint8_t active_label_mask = 0;
+        for (int range_index = 0; range_index < range_count; ++range_index)
+        {
+            const HSVThresholdBounds bounds = createHSVThresholdBounds(*color_ranges[range_index]);
+            const int label_index = findTrackingColorLabel(bounds, color_ids[range_index], label_bounds, active_label_mask);
+
+            if (label_index >= 0)
+            {
+                const uint8_t label_mask = static_cast<uint8_t>(1 << label_index);
+
+                if ((active_label_mask & label_mask) == 0)
+                {
+                    colorClassifier->updateLabelBounds(label_index, bounds);
+                    label_bounds[label_index] = bounds;
+                    active_label_mask |= label_mask;
+                }
+
+                out_label_masks[range_index] = label_mask;
+            }
+            else
+            {
+                SERVER_MT_LOG_WARNING("OpenCVBufferState::segmentTrackingColors") <<
+                    "More than " << k_max_tracking_color_labels << " distinct tracking color ranges on one tracker";
+                out_label_masks[range_index] = 0;
+            }
+        }
+
+        // Raw Bayer frames only get debayered where we are about to look
+        if (!bIsBGRBufferComplete)
+        {
+            debayerRegion(region);
+        }
+
+        // One table lookup per pixel, no matter how many devices we are looking for
+        const cv::Mat bgrRegion(*bgrBuffer, region);
+        cv::Mat labelRegion(*labelBuffer, region);
+
+        for (int row = 0; row < region.height; ++row)
+        {
+            const uint8_t *bgr_pixel = bgrRegion.ptr<uint8_t>(row);
+            uint8_t *label_pixel = labelRegion.ptr<uint8_t>(row);
+
+            for (int col = 0; col < region.width; ++col, bgr_pixel += 3)
+            {
+                label_pixel[col] = 
+                    colorClassifier->classify(bgr_pixel[0], bgr_pixel[1], bgr_pixel[2]) & active_label_mask;
+            }
+        }
+
+        segmentedROI = region;
+    }
+
+    // Pick the label for a color range being segmented this frame.
+    // Ranges already labeled this frame share that label. Otherwise prefer an unused label whose
+    // bit-plane already holds the range, then the label matching the color id,
+    // so that the classifier table rarely has to be rebuilt.
+    // Returns -1 if every label is in use.
+    int findTrackingColorLabel(
+        const HSVThresholdBounds &bounds,
+        const eCommonTrackingColorID color_id,
+        const HSVThresholdBounds label_bounds[k_max_tracking_color_labels],
+        const uint8_t active_label_mask) const
     {
-        // Convert the video buffer to the HSV color space
-        if (bgr2hsv != nullptr)
+        for (int label_index = 0; label_index < k_max_tracking_color_labels; ++label_index)
         {
-            bgr2hsv->cvtColor(bgrROI, hsvROI);
+            if ((active_label_mask & (1 << label_index)) != 0 &&
+                areHSVThresholdBoundsEqual(label_bounds[label_index], bounds))
+            {
+                return label_index;
+            }
         }
-        else
+
+        for (int label_index = 0; label_index < k_max_tracking_color_labels; ++label_index)
+        {
+            if ((active_label_mask & (1 << label_index)) == 0 &&
+                colorClassifier->hasLabelBounds(label_index, bounds))
+            {
+                return label_index;
+            }
+        }
+
+        if ((active_label_mask & (1 << color_id)) == 0)
         {
-            cv::cvtColor(bgrROI, hsvROI, cv::COLOR_BGR2HSV);
+            return color_id;
         }
+
+        for (int label_index = 0; label_index < k_max_tracking_color_labels; ++label_index)
+        {
+            if ((active_label_mask & (1 << label_index)) == 0)
+            {
+                return label_index;
+            }
+        }
+
+        return -1;
     }
-    
-    void applyROI(cv::Rect2i ROI)
+
+    // Make sure the ROI box is always clamped in bounds of the frame buffer
+    cv::Rect2i clampROI(cv::Rect2i ROI) const
     {
-        // Make sure the ROI box is always clamped in bounds of the frame buffer
         int x0= std::min(std::max(ROI.tl().x, 0), frameWidth-1);
         int y0= std::min(std::max(ROI.tl().y, 0), frameHeight-1);
         int x1= std::min(std::max(ROI.br().x, 0), frameWidth-1);
@@ -451,157 +905,70 @@ public:
             ROI.width = frameWidth;
             ROI.height = frameHeight;
         }
+
+        return ROI;
+    }
+    
+    void applyROI(cv::Rect2i ROI)
+    {
+        // Never look outside of the region that was segmented this frame
+        ROI = clampROI(ROI) & segmentedROI;
+        if (ROI.area() <= 0)
+        {
+            ROI = segmentedROI;
+        }
        
-        //Create the ROI matrices.
-        //It's not a full copy, so this isn't too slow.
-        //adjustROI is probably slightly faster but I ran into trouble with it.
-        bgrROI = cv::Mat(*bgrBuffer, ROI);
-        hsvROI = cv::Mat(*hsvBuffer, ROI);
-        gsLowerROI = cv::Mat(*gsLowerBuffer, ROI);
-        gsUpperROI = cv::Mat(*gsUpperBuffer, ROI);
-        
-        updateHsvBuffer();
+        labelROI = ROI;
         
         //Draw ROI.
-        cv::rectangle(*bgrShmemBuffer, ROI, cv::Scalar(255, 0, 0));
+        if (bDrawDebugOverlay)
+        {
+            cv::rectangle(*bgrShmemBuffer, ROI, cv::Scalar(255, 0, 0));
+        }
     }
 
+    // Traces the biggest N contours into the first entries of biggestContours and returns how many were found.
     // Return points in raw image space:
     // i.e. [0, 0] at lower left  to [frameWidth-1, frameHeight-1] at lower right
-    bool computeBiggestNContours(
-        const CommonHSVColorRange &hsvColorRange,
-        t_opencv_int_contour_list &out_biggest_N_contours,
-        std::vector<double> &out_contour_areas,
+    int computeBiggestNContours(
+        const uint8_t label_mask,
         const int max_contour_count,
         const int min_points_in_contour = 6)
     {
-        out_biggest_N_contours.clear();
-        out_contour_areas.clear();
-        
-        // Clamp the HSV image, taking into account wrapping the hue angle
-        {
-            const float hue_min = hsvColorRange.hue_range.center - hsvColorRange.hue_range.range;
-            const float hue_max = hsvColorRange.hue_range.center + hsvColorRange.hue_range.range;
-            const float saturation_min = clampf(hsvColorRange.saturation_range.center - hsvColorRange.saturation_range.range, 0, 255);
-            const float saturation_max = clampf(hsvColorRange.saturation_range.center + hsvColorRange.saturation_range.range, 0, 255);
-            const float value_min = clampf(hsvColorRange.value_range.center - hsvColorRange.value_range.range, 0, 255);
-            const float value_max = clampf(hsvColorRange.value_range.center + hsvColorRange.value_range.range, 0, 255);
+        assert(max_contour_count <= static_cast<int>(biggestContours.size()));
+        int contour_count = 0;
 
-            if (hue_min < 0)
-            {
-                cv::inRange(
-                    hsvROI,
-                    cv::Scalar(0, saturation_min, value_min),
-                    cv::Scalar(clampf(hue_max, 0, 180), saturation_max, value_max),
-                    gsLowerROI);
-                cv::inRange(
-                    hsvROI,
-                    cv::Scalar(clampf(180 + hue_min, 0, 180), saturation_min, value_min),
-                    cv::Scalar(180, saturation_max, value_max),
-                    gsUpperROI);
-                cv::bitwise_or(gsLowerROI, gsUpperROI, gsLowerROI);
-            }
-            else if (hue_max > 180)
-            {
-                cv::inRange(
-                    hsvROI,
-                    cv::Scalar(0, saturation_min, value_min),
-                    cv::Scalar(clampf(hue_max - 180, 0, 180), saturation_max, value_max),
-                    gsLowerROI);
-                cv::inRange(
-                    hsvROI,
-                    cv::Scalar(clampf(hue_min, 0, 180), saturation_min, value_min),
-                    cv::Scalar(180, saturation_max, value_max),
-                    gsUpperROI);
-                cv::bitwise_or(gsLowerROI, gsUpperROI, gsLowerROI);
-            }
-            else
-            {
-                cv::inRange(
-                    hsvROI,
-                    cv::Scalar(hue_min, saturation_min, value_min),
-                    cv::Scalar(hue_max, saturation_max, value_max),
-                    gsLowerROI);
-            }
-        }
-        
-        //TODO: Why no blurring of the gsLowerBuffer?
+        biggestContourAreas.clear();
+
+        // Label the blobs of the tracking color straight out of the label image computed by segmentTrackingColors()
+        const int blob_count=
+            blobExtractor->extractBiggestNBlobs(*labelBuffer, labelROI, label_mask, max_contour_count);
 
-        // Find the largest convex blob in the filtered grayscale buffer
+        // Only trace the boundaries of the blobs we keep
+        for (int blob_index = 0; blob_index < blob_count; ++blob_index)
         {
-            struct ContourInfo
-            {
-                int contour_index;
-                double contour_area;
-            };
-            std::vector<ContourInfo> sorted_contour_list;
-
-            // Find all counters in the image buffer
-            cv::Size size; cv::Point ofs;
-            gsLowerROI.locateROI(size, ofs);
-            t_opencv_int_contour_list contours;
-            cv::findContours(gsLowerROI,
-                             contours,
-                             CV_RETR_EXTERNAL,
-                             CV_CHAIN_APPROX_SIMPLE,  //CV_CHAIN_APPROX_NONE?
-                             ofs);
-
-            // Compute the area of each contour
-            int contour_index = 0;
-            for (auto it = contours.begin(); it != contours.end(); ++it) 
-            {
-                const double contour_area = cv::contourArea(*it);
-                const ContourInfo contour_info = { contour_index, contour_area };
+            t_opencv_int_contour &contour = biggestContours[contour_count];
 
-                sorted_contour_list.push_back(contour_info);
-                ++contour_index;
-            }
-            
-            // Sort the list of contours by area, largest to smallest
-            if (sorted_contour_list.size() > 1)
-            {
-                std::sort(
-                    sorted_contour_list.begin(), sorted_contour_list.end(), 
-                    [](const ContourInfo &a, const ContourInfo &b) {
-                        return b.contour_area < a.contour_area;
-                });
-            }
+            blobExtractor->traceBlobBoundary(blob_index, contour);
 
-            // Copy up to N valid contours
-            for (auto it = sorted_contour_list.begin(); 
-                it != sorted_contour_list.end() && static_cast<int>(out_biggest_N_contours.size()) < max_contour_count; 
-                ++it)
+            if (contour.size() > min_points_in_contour)
             {
-                const ContourInfo &contour_info = *it;
-                t_opencv_int_contour &contour = contours[contour_info.contour_index];
-
-                if (contour.size() > min_points_in_contour)
-                {
-                    // Remove any points in contour on edge of camera/ROI
-                    // TODO: Contours touching image border will be clipped,
-                    // so this might not be necessary.
-                    t_opencv_int_contour::iterator it = contour.begin();
-                    while (it != contour.end()) 
-                    {
-                        if (it->x == 0 || it->x == (frameWidth - 1) || it->y == 0 || it->y == (frameHeight - 1))
-                        {
-                            it = contour.erase(it);
-                        }
-                        else
-                        {
-                            ++it;
-                        }
-                    }
-
-                    // Add cleaned up contour to the output list
-                    out_biggest_N_contours.push_back(contour);
-                    // Add its area to the output list too.
-                    out_contour_areas.push_back(contour_info.contour_area);
-                }
+                // Remove any points in contour on edge of camera/ROI
+                // TODO: Contours touching image border will be clipped,
+                // so this might not be necessary.
+                contour.erase(
+                    std::remove_if(contour.begin(), contour.end(), [this](const cv::Point &point) {
+                        return point.x == 0 || point.x == (frameWidth - 1) || point.y == 0 || point.y == (frameHeight - 1);
+                    }),
+                    contour.end());
+
+                // Add its area to the output list too.
+                biggestContourAreas.push_back(static_cast<double>(blobExtractor->getBlob(blob_index).area));
+                ++contour_count;
             }
         }
 
-        return (out_biggest_N_contours.size() > 0);
+        return contour_count;
     }
     
     void
@@ -609,9 +976,13 @@ public:
     {
         // Draws the contour directly onto the shared mem buffer.
         // This is useful for debugging
-        std::vector<t_opencv_int_contour> contours = {contour};
+        if (!bDrawDebugOverlay)
+        {
+            return;
+        }
+
         const cv::Point2f massCenter = computeSafeCenterOfMassForContour<t_opencv_int_contour>(contour);
-        cv::drawContours(*bgrShmemBuffer, contours, 0, cv::Scalar(255, 255, 255));
+        cv::polylines(*bgrShmemBuffer, contour, true, cv::Scalar(255, 255, 255));
         cv::rectangle(*bgrShmemBuffer, cv::boundingRect(contour), cv::Scalar(255, 255, 255));
         cv::drawMarker(*bgrShmemBuffer, massCenter, cv::Scalar(255, 255, 255), 0,
             (cv::boundingRect(contour).height < cv::boundingRect(contour).width) ?
@@ -622,6 +993,11 @@ public:
     draw_pose_projection(const CommonDeviceTrackingProjection &pose_projection)
     {
         // Draw the projection of the pose onto the shared mem buffer.
+        if (!bDrawDebugOverlay)
+        {
+            return;
+        }
+
         switch (pose_projection.shape_type)
         {
         case eCommonTrackingProjectionType::ProjectionType_Ellipse:
@@ -697,18 +1073,25 @@ public:
 
     int frameWidth;
     int frameHeight;
-
-    cv::Mat *bgrBuffer; // source video frame
-    cv::Mat *bgrShmemBuffer; //Frame onto which we draw debug lines, and transmit via shared mem.
-    cv::Mat bgrROI;
-    cv::Mat *hsvBuffer; // source frame converted to HSV color space
-    cv::Mat hsvROI;
-    cv::Mat *gsLowerBuffer; // HSV image clamped by HSV range into grayscale mask
-    cv::Mat gsLowerROI;
-    cv::Mat *gsUpperBuffer; // HSV image clamped by HSV range into grayscale mask
-    cv::Mat gsUpperROI;
+    ITrackerInterface::eVideoFrameFormat frameFormat;
+    bool bIsBGRBufferComplete; // false when only the segmented regions of a Bayer frame have been debayered
+    bool bDrawDebugOverlay; // true when the frame was copied to bgrShmemBuffer for a video stream
+
+    cv::Mat *bayerBuffer; // raw source video frame (Bayer trackers only, references the tracker's buffer)
+    cv::Mat *bgrBuffer; // source video frame (references the tracker's buffer unless debayered)
+    cv::Mat *bgrShmemBuffer; //Frame onto which we draw debug lines. Points into shared mem, only when streaming.
+    cv::Mat *labelBuffer; // per-pixel bitmask of matching tracking colors
+    cv::Rect2i labelROI; // region of the label image the current device is searched for in
+    cv::Rect2i segmentedROI; // region of the label image that is valid for the current frame
     cv::Mat *maskedBuffer; // bgr image ANDed together with grayscale mask
-    OpenCVBGRToHSVMapper *bgr2hsv; // Used to convert an rgb image to an hsv image
+    OpenCVTrackingColorClassifier *colorClassifier; // Maps bgr pixels to a bitmask of matching tracking colors
+    BlobExtractor *blobExtractor; // Finds the biggest blobs of a tracking color in the label image
+    OpenCVUndistortionTable *undistortionTable; // Camera intrinsics and the undistorted location of every pixel
+    t_opencv_int_contour sphereConvexContour; // convex hull of the last sphere blob, kept to reuse its storage
+    std::vector<Eigen::Vector2f> sphereUndistortedContour; // normalized points of sphereConvexContour
+    t_opencv_int_contour_list biggestContours; // contour buffers filled by computeBiggestNContours()
+    std::vector<double> biggestContourAreas; // blob area of each contour found by computeBiggestNContours()
+    t_opencv_float_contour_list undistortedContours; // pixel space undistorted copies of biggestContours
 };
 
 // -- Utility Methods -----
@@ -717,10 +1100,12 @@ static glm::mat4 computeGLMCameraTransformMatrix(const ITrackerInterface *tracke
 static void computeOpenCVCameraExtrinsicMatrix(const ITrackerInterface *tracker_device,
                                                       cv::Matx34f &extrinsicOut);
 cv::Mat cvDistCoeffs = cv::Mat(4, 1, cv::DataType<float>::type, 0.f);
-static void computeOpenCVCameraIntrinsicMatrix(const ITrackerInterface *tracker_device,
-                                               cv::Matx33f &intrinsicOut,
-                                               cv::Matx<float, 5, 1> &distortionOut);
 static cv::Matx34f computeOpenCVCameraPinholeMatrix(const ITrackerInterface *tracker_device);
+static Eigen::Matrix<float, 3, 4> computeEigenCameraPinholeMatrix(const ITrackerInterface *tracker_device);
+static bool computeWorldLightBarPoseFromPoints(
+    const ServerTrackerView *facing_tracker,
+    Eigen::Vector3f *lightbar_points,
+    CommonDevicePose *out_pose);
 static bool computeTrackerRelativeLightBarProjection(
     const CommonDeviceTrackingShape *tracking_shape,
     const t_opencv_float_contour &opencv_contour,
@@ -735,6 +1120,7 @@ static bool computeTrackerRelativePointCloudContourPose(
     const ITrackerInterface *tracker_device,
     const CommonDeviceTrackingShape *tracking_shape,
     const t_opencv_float_contour_list &opencv_contours,
+    const int contour_count,
     const CommonDevicePose *tracker_relative_pose_guess,
     HMDOpticalPoseEstimation *out_pose_estimate);
 static cv::Rect2i computeTrackerROIForPoseProjection(
@@ -769,12 +1155,174 @@ static void angleAxisVectorToCommonDeviceOrientation(
     const float axis_x, const float axis_y, const float axis_z, const float radians,
     CommonDeviceQuaternion &orientation);
 
+//-- private definitions -----
+struct TrackerVisionJob
+{
+    // Filled in on the main thread when the projection is requested
+    ServerControllerView *tracked_controller;
+    ServerHMDView *tracked_hmd;
+    CommonDeviceTrackingShape tracking_shape;
+
+    // Filled in on the vision thread before the frame is segmented
+    eCommonTrackingColorID tracked_color_id;
+    CommonHSVColorRange hsv_color_range;
+    cv::Rect2i roi;
+    bool bRoiDisabled;
+
+    // Filled in on the vision thread when the frame is segmented.
+    // The bit of the label image holding this device's color range (0 if it wasn't segmented).
+    uint8_t label_mask;
+};
+
+// Finds the projections of tracked devices in the tracker's newest video frame on a worker thread.
+// The main thread posts one job per tracked device and then dispatches them as a single batch,
+// so the frame only has to be segmented once for all of the devices.
+// The main thread then blocks in waitForJobs() until every tracker has finished,
+// so all trackers process their frames in parallel and no frame gets polled over while it's being read.
+// Found projections are handed back to the tracked device through its lock-free projection queue.
+class TrackerVisionProcessor : public WorkerThread
+{
+public:
+    TrackerVisionProcessor(ServerTrackerView *tracker_view)
+        : WorkerThread("TrackerVisionProcessor")
+        , m_trackerView(tracker_view)
+        , m_batchQueue()
+        , m_bBatchPending({ false })
+        , m_bBatchDispatched(false)
+        , m_jobCount(0)
+    {
+    }
+
+    void start()
+    {
+        if (!hasThreadStarted())
+        {
+            WorkerThread::startThread();
+        }
+    }
+
+    void stop()
+    {
+        WorkerThread::stopThread();
+
+        // Throw away anything that was never processed
+        int job_count;
+        while (m_batchQueue.try_dequeue(job_count))
+        {
+        }
+        m_bBatchPending.store(false);
+        m_bBatchDispatched = false;
+        m_jobCount = 0;
+    }
+
+    // Called on the main thread
+    void postJob(const TrackerVisionJob &job)
+    {
+        // The worker owns the job list while a batch is pending
+        if (!m_bBatchPending.load() && m_jobCount < k_max_vision_jobs)
+        {
+            m_jobs[m_jobCount] = job;
+            ++m_jobCount;
+        }
+    }
+
+    // Called on the main thread
+    void dispatchJobs()
+    {
+        if (m_jobCount > 0)
+        {
+            if (hasThreadStarted() && !hasThreadEnded())
+            {
+                // The worker owns the job list until it clears the pending flag
+                m_bBatchPending.store(true);
+                m_bBatchDispatched = true;
+                m_batchQueue.enqueue(m_jobCount);
+            }
+            else
+            {
+                // No worker to hand the jobs to, so just do the work on the calling thread
+                m_trackerView->computeRequestedProjections(m_jobs, m_jobCount);
+                m_jobCount = 0;
+            }
+        }
+    }
+
+    // Called on the main thread
+    void waitForJobs()
+    {
+        if (m_bBatchDispatched)
+        {
+            std::unique_lock<std::mutex> lock(m_batchMutex);
+            auto bBatchFinished = [this]{ return !m_bBatchPending.load() || hasThreadEnded(); };
+
+            // The worker reads the tracker's video frame, buffers and the tracked devices' state,
+            // so it has to be done before the tracker gets polled again.
+            // A slow batch only gets logged (once), we still wait for it.
+            // The timed wait also re-checks whether the worker thread has exited.
+            bool bLoggedSlowBatch = false;
+            while (!m_batchFinishedCondition.wait_for(
+                    lock, std::chrono::milliseconds(k_vision_job_slow_warning_msec), bBatchFinished))
+            {
+                if (!bLoggedSlowBatch)
+                {
+                    SERVER_LOG_WARNING("TrackerVisionProcessor::waitForJobs") << 
+                        "Vision jobs for tracker " << m_trackerView->getDeviceID() << 
+                        " are taking longer than " << k_vision_job_slow_warning_msec << "ms";
+                    bLoggedSlowBatch = true;
+                }
+            }
+
+            m_bBatchDispatched = false;
+        }
+
+        m_jobCount = 0;
+    }
+
+protected:
+    bool doWork() override
+    {
+        int job_count;
+
+        // Wake up periodically to check for the exit signal
+        if (m_batchQueue.wait_dequeue_timed(job_count, k_vision_job_wait_timeout_usec))
+        {
+            m_trackerView->computeRequestedProjections(m_jobs, job_count);
+
+            {
+                // Taking the lock makes sure the main thread can't miss the wake up between testing and waiting
+                std::lock_guard<std::mutex> lock(m_batchMutex);
+                m_bBatchPending.store(false);
+            }
+            m_batchFinishedCondition.notify_one();
+        }
+
+        return true;
+    }
+
+private:
+    ServerTrackerView *m_trackerView;
+
+    // Multithreaded state
+    moodycamel::BlockingReaderWriterQueue<int> m_batchQueue;
+    std::atomic_bool m_bBatchPending;
+    std::mutex m_batchMutex;
+    std::condition_variable m_batchFinishedCondition;
+
+    // Owned by the main thread, except while a batch is pending
+    TrackerVisionJob m_jobs[k_max_vision_jobs];
+    bool m_bBatchDispatched;
+    int m_jobCount;
+};
+
 //-- public implementation -----
 ServerTrackerView::ServerTrackerView(const int device_id)
     : ServerDeviceView(device_id)
     , m_shared_memory_accesor(nullptr)
     , m_shared_memory_video_stream_count(0)
+    , m_video_frame_count(0)
+    , m_video_frame_copy_byte_count(0)
     , m_opencv_buffer_state(nullptr)
+    , m_vision_processor(nullptr)
     , m_device(nullptr)
 {
     ServerUtility::format_string(m_shared_memory_name, sizeof(m_shared_memory_name), "tracker_view_%d", device_id);
@@ -782,6 +1330,12 @@ ServerTrackerView::ServerTrackerView(const int device_id)
 
 ServerTrackerView::~ServerTrackerView()
 {
+    if (m_vision_processor != nullptr)
+    {
+        m_vision_processor->stop();
+        delete m_vision_processor;
+    }
+
     if (m_shared_memory_accesor != nullptr)
     {
         delete m_shared_memory_accesor;
@@ -849,6 +1403,15 @@ bool ServerTrackerView::open(const class DeviceEnumerator *enumerator)
 
             // Allocate the OpenCV scratch buffers used for finding tracking blobs
             m_opencv_buffer_state = new OpenCVBufferState(m_device);
+            m_video_frame_count = 0;
+            m_video_frame_copy_byte_count = 0;
+
+            // Spin up the thread that searches the video frames for tracking blobs
+            if (m_vision_processor == nullptr)
+            {
+                m_vision_processor = new TrackerVisionProcessor(this);
+            }
+            m_vision_processor->start();
         }
         else
         {
@@ -861,6 +1424,18 @@ bool ServerTrackerView::open(const class DeviceEnumerator *enumerator)
 
 void ServerTrackerView::close()
 {
+    if (m_vision_processor != nullptr)
+    {
+        m_vision_processor->stop();
+    }
+
+    if (m_video_frame_count > 0)
+    {
+        SERVER_LOG_INFO("ServerTrackerView::close()") << "Tracker " << getDeviceID()
+            << " copied " << m_video_frame_copy_byte_count << " bytes of video over " << m_video_frame_count << " frames ("
+            << getAverageVideoFrameCopyByteCount() << " bytes/frame)";
+    }
+
     if (m_shared_memory_accesor != nullptr)
     {
         delete m_shared_memory_accesor;
@@ -870,6 +1445,11 @@ void ServerTrackerView::close()
     ServerDeviceView::close();
 }
 
+uint64_t ServerTrackerView::getAverageVideoFrameCopyByteCount() const
+{
+    return (m_video_frame_count > 0) ? m_video_frame_copy_byte_count / m_video_frame_count : 0;
+}
+
 void ServerTrackerView::startSharedMemoryVideoStream()
 {
     ++m_shared_memory_video_stream_count;
@@ -885,16 +1465,40 @@ bool ServerTrackerView::poll()
 {
     bool bSuccess = ServerDeviceView::poll();
 
-    if (bSuccess && m_device != nullptr)
+    // Only bother caching the video frame when the tracker handed us a new one this poll
+    if (bSuccess && m_device != nullptr && getHasUnpublishedState())
     {
         const unsigned char *buffer = m_device->getVideoFrameBuffer();
+        const CommonDeviceState *device_state = m_device->getState();
+
+        // Projections found in this frame get stamped with the time the camera captured it
+        m_video_frame_capture_timestamp =
+            (device_state != nullptr && device_state->hasCaptureTimestamp())
+            ? device_state->CaptureTimestamp
+            : getLastNewDataTimestamp();
 
         if (buffer != nullptr)
         {
             // Cache the raw video frame
             if (m_opencv_buffer_state != nullptr)
             {
-                m_opencv_buffer_state->writeVideoFrame(buffer);
+                unsigned char *debug_frame_buffer = nullptr;
+
+                // Draw the debug overlay straight into the next slot of the shared memory video ring.
+                // The slot gets published to the readers in publish_device_data_frame().
+                if (m_shared_memory_accesor != nullptr && m_shared_memory_video_stream_count > 0)
+                {
+                    if (m_shared_memory_accesor->getIsWritingVideoFrame())
+                    {
+                        m_shared_memory_accesor->endVideoFrameWrite();
+                    }
+
+                    debug_frame_buffer = m_shared_memory_accesor->beginVideoFrameWrite();
+                }
+
+                m_video_frame_copy_byte_count += 
+                    m_opencv_buffer_state->writeVideoFrame(buffer, debug_frame_buffer);
+                ++m_video_frame_count;
             }
         }
     }
@@ -931,10 +1535,10 @@ void ServerTrackerView::free_device_interface()
 
 void ServerTrackerView::publish_device_data_frame()
 {
-    // Copy the video frame to shared memory (if requested)
-    if (m_shared_memory_accesor != nullptr && m_shared_memory_video_stream_count > 0)
+    // Hand the video frame drawn in shared memory over to the readers (if requested)
+    if (m_shared_memory_accesor != nullptr && m_shared_memory_accesor->getIsWritingVideoFrame())
     {
-        m_shared_memory_accesor->writeVideoFrame(m_opencv_buffer_state->bgrShmemBuffer->data);
+        m_shared_memory_accesor->endVideoFrameWrite();
     }
     
     // Tell the server request handler we want to send out tracker updates.
@@ -946,7 +1550,7 @@ void ServerTrackerView::publish_device_data_frame()
 void ServerTrackerView::generate_tracker_data_frame_for_stream(
     const ServerTrackerView *tracker_view,
     const struct TrackerStreamInfo *stream_info,
-    DeviceOutputDataFramePtr &data_frame)
+    PSMoveProtocol::DeviceOutputDataFrame *data_frame)
 {
     PSMoveProtocol::DeviceOutputDataFrame_TrackerDataPacket *tracker_data_frame =
         data_frame->mutable_tracker_data_packet();
@@ -970,7 +1574,15 @@ void ServerTrackerView::generate_tracker_data_frame_for_stream(
 
 void ServerTrackerView::loadSettings()
 {
+    // Loaded settings can change the frame size or frame rate, which resets the tracker's video frames
+    const bool bWasProcessing = pauseVisionProcessor();
+
     m_device->loadSettings();
+
+    if (bWasProcessing)
+    {
+        resumeVisionProcessor();
+    }
 }
 
 void ServerTrackerView::saveSettings()
@@ -987,6 +1599,9 @@ void ServerTrackerView::setFrameWidth(double value, bool bUpdateConfig)
 {
     if (value == m_device->getFrameWidth()) return;
 
+    // The vision thread can't be looking at the frame buffers that get reallocated below
+    const bool bWasProcessing = pauseVisionProcessor();
+
     // close buffer
     if (m_shared_memory_accesor != nullptr)
     {
@@ -1017,13 +1632,22 @@ void ServerTrackerView::setFrameWidth(double value, bool bUpdateConfig)
             SERVER_LOG_ERROR("ServerTrackerView::open()") << "Failed to allocated shared memory: " << m_shared_memory_name;
         }
 
-        // Allocate the OpenCV scratch buffers used for finding tracking blobs
+        // Re-allocate the OpenCV scratch buffers used for finding tracking blobs for the new frame size
+        if (m_opencv_buffer_state != nullptr)
+        {
+            delete m_opencv_buffer_state;
+        }
         m_opencv_buffer_state = new OpenCVBufferState(m_device);
     }
     else
     {
         SERVER_LOG_ERROR("ServerTrackerView::open()") << "Failed to video frame dimensions";
     }
+
+    if (bWasProcessing)
+    {
+        resumeVisionProcessor();
+    }
 }
 
 double ServerTrackerView::getFrameHeight() const
@@ -1035,6 +1659,9 @@ void ServerTrackerView::setFrameHeight(double value, bool bUpdateConfig)
 {
     if (value == m_device->getFrameHeight()) return;
 
+    // The vision thread can't be looking at the frame buffers that get reallocated below
+    const bool bWasProcessing = pauseVisionProcessor();
+
     // close buffer
     if (m_shared_memory_accesor != nullptr)
     {
@@ -1065,13 +1692,22 @@ void ServerTrackerView::setFrameHeight(double value, bool bUpdateConfig)
             SERVER_LOG_ERROR("ServerTrackerView::open()") << "Failed to allocated shared memory: " << m_shared_memory_name;
         }
 
-        // Allocate the OpenCV scratch buffers used for finding tracking blobs
+        // Re-allocate the OpenCV scratch buffers used for finding tracking blobs for the new frame size
+        if (m_opencv_buffer_state != nullptr)
+        {
+            delete m_opencv_buffer_state;
+        }
         m_opencv_buffer_state = new OpenCVBufferState(m_device);
     }
     else
     {
         SERVER_LOG_ERROR("ServerTrackerView::open()") << "Failed to video frame dimensions";
     }
+
+    if (bWasProcessing)
+    {
+        resumeVisionProcessor();
+    }
 }
 
 double ServerTrackerView::getFrameRate() const
@@ -1081,7 +1717,15 @@ double ServerTrackerView::getFrameRate() const
 
 void ServerTrackerView::setFrameRate(double value, bool bUpdateConfig)
 {
+    // Changing the frame rate restarts the camera stream, which resets the tracker's video frames
+    const bool bWasProcessing = pauseVisionProcessor();
+
     m_device->setFrameRate(value, bUpdateConfig);
+
+    if (bWasProcessing)
+    {
+        resumeVisionProcessor();
+    }
 }
 
 double ServerTrackerView::getExposure() const
@@ -1123,11 +1767,25 @@ void ServerTrackerView::setCameraIntrinsics(
     float distortionK1, float distortionK2, float distortionK3,
     float distortionP1, float distortionP2)
 {
+    // The vision thread can't be looking up points in the undistortion table while it gets rebuilt
+    const bool bWasProcessing = pauseVisionProcessor();
+
     m_device->setCameraIntrinsics(
         focalLengthX, focalLengthY,
         principalX, principalY,
         distortionK1, distortionK2, distortionK3,
         distortionP1, distortionP2);
+
+    // Undistorted contour points get looked up from a table built off of the intrinsics
+    if (m_opencv_buffer_state != nullptr)
+    {
+        m_opencv_buffer_state->undistortionTable->rebuild(m_device);
+    }
+
+    if (bWasProcessing)
+    {
+        resumeVisionProcessor();
+    }
 }
 
 CommonDevicePose ServerTrackerView::getTrackerPose() const
@@ -1234,63 +1892,235 @@ void ServerTrackerView::getHMDTrackingColorPreset(
     return m_device->getTrackingColorPreset(hmd_id, color, out_preset);
 }
 
-bool
-ServerTrackerView::computeProjectionForController(
-    const ServerControllerView* tracked_controller,
-    const CommonDeviceTrackingShape *tracking_shape,
-    ControllerOpticalPoseEstimation *out_pose_estimate)
+void ServerTrackerView::requestControllerProjection(
+    ServerControllerView* tracked_controller,
+    const CommonDeviceTrackingShape *tracking_shape)
 {
-    bool bSuccess = true;
+    if (m_vision_processor != nullptr && m_opencv_buffer_state != nullptr)
+    {
+        TrackerVisionJob job;
+        job.tracked_controller = tracked_controller;
+        job.tracked_hmd = nullptr;
+        job.tracking_shape = *tracking_shape;
 
-    // Get the HSV filter used to find the tracking blob
-    CommonHSVColorRange hsvColorRange;
-    if (bSuccess)
+        m_vision_processor->postJob(job);
+    }
+}
+
+void ServerTrackerView::requestHMDProjection(
+    ServerHMDView* tracked_hmd,
+    const CommonDeviceTrackingShape *tracking_shape)
+{
+    if (m_vision_processor != nullptr && m_opencv_buffer_state != nullptr)
+    {
+        TrackerVisionJob job;
+        job.tracked_controller = nullptr;
+        job.tracked_hmd = tracked_hmd;
+        job.tracking_shape = *tracking_shape;
+
+        m_vision_processor->postJob(job);
+    }
+}
+
+bool ServerTrackerView::pauseVisionProcessor()
+{
+    bool bWasProcessing = false;
+
+    if (m_vision_processor != nullptr && m_vision_processor->hasThreadStarted())
+    {
+        // Blocks until any vision job still running has finished
+        m_vision_processor->stop();
+        bWasProcessing = true;
+    }
+
+    if (m_opencv_buffer_state != nullptr)
+    {
+        m_opencv_buffer_state->releaseVideoFrame();
+    }
+
+    return bWasProcessing;
+}
+
+void ServerTrackerView::resumeVisionProcessor()
+{
+    if (m_vision_processor != nullptr)
+    {
+        m_vision_processor->start();
+    }
+}
+
+void ServerTrackerView::dispatchRequestedProjections()
+{
+    if (m_vision_processor != nullptr)
+    {
+        m_vision_processor->dispatchJobs();
+    }
+}
+
+void ServerTrackerView::waitForRequestedProjections()
+{
+    if (m_vision_processor != nullptr)
+    {
+        m_vision_processor->waitForJobs();
+    }
+}
+
+void ServerTrackerView::computeRequestedProjections(
+    TrackerVisionJob *jobs,
+    const int job_count)
+{
+    const int tracker_id = getDeviceID();
+    const TrackerManagerConfig &trackerMgrConfig= DeviceManager::getInstance()->m_tracker_manager->getConfig();
+
+    // The color range of every device with a tracking color, keyed by job
+    const CommonHSVColorRange *color_ranges[k_max_vision_jobs];
+    eCommonTrackingColorID color_ids[k_max_vision_jobs];
+    uint8_t label_masks[k_max_vision_jobs];
+    int range_job_indices[k_max_vision_jobs];
+    int range_count = 0;
+
+    // Work out which colors we are looking for and where we expect to find them
+    cv::Rect2i segmented_region;
+    bool bHasSegmentedRegion = false;
+    for (int job_index = 0; job_index < job_count; ++job_index)
     {
-        eCommonTrackingColorID tracked_color_id = tracked_controller->getTrackingColorID();
+        TrackerVisionJob &job = jobs[job_index];
+        const IPoseFilter *pose_filter = nullptr;
+        const CommonDeviceTrackingProjection *prior_projection = nullptr;
 
-        if (tracked_color_id != eCommonTrackingColorID::INVALID_COLOR)
+        if (job.tracked_controller != nullptr)
         {
-            getControllerTrackingColorPreset(tracked_controller, tracked_color_id, &hsvColorRange);
+            const ControllerOpticalPoseEstimation *priorPoseEst= job.tracked_controller->getTrackerPoseEstimate(tracker_id);
+
+            job.tracked_color_id = job.tracked_controller->getTrackingColorID();
+            job.bRoiDisabled = job.tracked_controller->getIsROIDisabled() || trackerMgrConfig.disable_roi;
+            if (job.tracked_color_id != eCommonTrackingColorID::INVALID_COLOR)
+            {
+                getControllerTrackingColorPreset(job.tracked_controller, job.tracked_color_id, &job.hsv_color_range);
+            }
+
+            if (priorPoseEst->bCurrentlyTracking)
+            {
+                pose_filter = job.tracked_controller->getPoseFilter();
+                prior_projection = &priorPoseEst->projection;
+            }
         }
         else
         {
-            bSuccess = false;
+            const HMDOpticalPoseEstimation *priorPoseEst= job.tracked_hmd->getTrackerPoseEstimate(tracker_id);
+
+            job.tracked_color_id = job.tracked_hmd->getTrackingColorID();
+            job.bRoiDisabled = job.tracked_hmd->getIsROIDisabled() || trackerMgrConfig.disable_roi;
+            if (job.tracked_color_id != eCommonTrackingColorID::INVALID_COLOR)
+            {
+                getHMDTrackingColorPreset(job.tracked_hmd, job.tracked_color_id, &job.hsv_color_range);
+            }
+
+            if (priorPoseEst->bCurrentlyTracking)
+            {
+                pose_filter = job.tracked_hmd->getPoseFilter();
+                prior_projection = &priorPoseEst->projection;
+            }
+        }
+
+        // Compute a region of interest in the tracker buffer around where we expect to find the tracking shape
+        job.roi = 
+            m_opencv_buffer_state->clampROI(
+                computeTrackerROIForPoseProjection(
+                    job.bRoiDisabled,
+                    this,
+                    pose_filter,
+                    prior_projection,
+                    &job.tracking_shape));
+
+        job.label_mask = 0;
+        if (job.tracked_color_id != eCommonTrackingColorID::INVALID_COLOR)
+        {
+            color_ranges[range_count] = &job.hsv_color_range;
+            color_ids[range_count] = job.tracked_color_id;
+            range_job_indices[range_count] = job_index;
+            ++range_count;
+
+            segmented_region = bHasSegmentedRegion ? (segmented_region | job.roi) : job.roi;
+            bHasSegmentedRegion = true;
         }
     }
 
-    // Compute a region of interest in the tracker buffer around where we expect to find the tracking shape
-    const TrackerManagerConfig &trackerMgrConfig= DeviceManager::getInstance()->m_tracker_manager->getConfig();
-    const bool bRoiDisabled = tracked_controller->getIsROIDisabled() || trackerMgrConfig.disable_roi;
+    // Classify the pixels against every tracking color in a single pass over the union of the ROIs
+    if (bHasSegmentedRegion)
+    {
+        m_opencv_buffer_state->segmentTrackingColors(color_ranges, color_ids, range_count, label_masks, segmented_region);
+
+        for (int range_index = 0; range_index < range_count; ++range_index)
+        {
+            jobs[range_job_indices[range_index]].label_mask = label_masks[range_index];
+        }
+    }
+
+    // Extract each device's projection from the segmented frame
+    for (int job_index = 0; job_index < job_count; ++job_index)
+    {
+        const TrackerVisionJob &job = jobs[job_index];
+
+        if (job.label_mask == 0)
+        {
+            continue;
+        }
 
-    const ControllerOpticalPoseEstimation *priorPoseEst= 
-        tracked_controller->getTrackerPoseEstimate(this->getDeviceID());
-    const bool bIsTracking = priorPoseEst->bCurrentlyTracking;
+        if (job.tracked_controller != nullptr)
+        {
+            // Start from a copy of the existing pose estimate so that in event of a 
+            // failure part way through computing the projection we don't post partially valid state
+            ControllerOpticalPoseEstimation newTrackerPoseEstimate = 
+                *job.tracked_controller->getTrackerPoseEstimate(tracker_id);
+
+            if (computeProjectionForController(&job, &newTrackerPoseEstimate))
+            {
+                newTrackerPoseEstimate.capture_timestamp = m_video_frame_capture_timestamp;
+                job.tracked_controller->notifyTrackerDataReceived(tracker_id, &newTrackerPoseEstimate);
+            }
+        }
+        else
+        {
+            HMDOpticalPoseEstimation newTrackerPoseEstimate = 
+                *job.tracked_hmd->getTrackerPoseEstimate(tracker_id);
+
+            if (computeProjectionForHMD(&job, &newTrackerPoseEstimate))
+            {
+                newTrackerPoseEstimate.capture_timestamp = m_video_frame_capture_timestamp;
+                job.tracked_hmd->notifyTrackerDataReceived(tracker_id, &newTrackerPoseEstimate);
+            }
+        }
+    }
+}
 
-    cv::Rect2i ROI= computeTrackerROIForPoseProjection(
-        bRoiDisabled,
-        this,		
-        bIsTracking ? tracked_controller->getPoseFilter() : nullptr,
-        bIsTracking ? &priorPoseEst->projection : nullptr,
-        tracking_shape);
+bool
+ServerTrackerView::computeProjectionForController(
+    const TrackerVisionJob *job,
+    ControllerOpticalPoseEstimation *out_pose_estimate)
+{
+    const TrackerManagerConfig &trackerMgrConfig= DeviceManager::getInstance()->m_tracker_manager->getConfig();
+    const CommonDeviceTrackingShape *tracking_shape= &job->tracking_shape;
+    const bool bRoiDisabled = job->bRoiDisabled;
+    const cv::Rect2i &ROI= job->roi;
+    bool bSuccess = true;
 
     m_opencv_buffer_state->applyROI(ROI);
 
     // Find the contour associated with the controller
-    t_opencv_int_contour_list biggest_contours;
-    std::vector<double> contour_areas;
+    const t_opencv_int_contour_list &biggest_contours = m_opencv_buffer_state->biggestContours;
     if (bSuccess)
     {
-        bSuccess = m_opencv_buffer_state->computeBiggestNContours(hsvColorRange, biggest_contours, contour_areas, 1);
+        bSuccess = m_opencv_buffer_state->computeBiggestNContours(job->label_mask, 1) > 0;
     }
     
     // Process the contour for its 2D and 3D pose.
     if (bSuccess)
     {
         // Get camera parameters.
-        // Needed for undistortion.
-        cv::Matx33f camera_matrix;
-        cv::Matx<float, 5, 1> distortions;
-        computeOpenCVCameraIntrinsicMatrix(m_device, camera_matrix, distortions);
+        // Cached along with the undistortion table.
+        const OpenCVUndistortionTable *undistortion_table = m_opencv_buffer_state->undistortionTable;
+        const cv::Matx33f &camera_matrix = undistortion_table->getIntrinsicMatrix();
                 
         // Compute the tracker relative 3d position of the controller from the contour
         switch (tracking_shape->shape_type)
@@ -1299,41 +2129,28 @@ ServerTrackerView::computeProjectionForController(
         case eCommonTrackingShapeType::Sphere:
             {
                 // Compute the convex hull of the contour
-                t_opencv_int_contour convex_contour;
+                // (reusing the buffer state's point buffers, so this doesn't allocate once they've grown)
+                t_opencv_int_contour &convex_contour = m_opencv_buffer_state->sphereConvexContour;
                 cv::convexHull(biggest_contours[0], convex_contour);
                 m_opencv_buffer_state->draw_contour(convex_contour);
 
-                // Convert integer to float
-                t_opencv_float_contour convex_contour_f;
-                cv::Mat(convex_contour).convertTo(convex_contour_f, cv::Mat(convex_contour_f).type());
-
                 // Undistort points
-                t_opencv_float_contour undistort_contour;  //destination for undistorted contour
-                cv::undistortPoints(convex_contour_f, undistort_contour,
-                                    camera_matrix,
-                                    distortions);//,
-                                    //cv::noArray(),
-                                    //camera_matrix);
-                // Note: if we omit the last two arguments, then
-                // undistort_contour points are in 'normalized' space.
+                std::vector<Eigen::Vector2f> &eigen_contour = m_opencv_buffer_state->sphereUndistortedContour;
+                undistortion_table->undistortContourToNormalized(convex_contour, eigen_contour);
+                // Note: eigen_contour points are in 'normalized' space.
                 // i.e., they are relative to their F_PX,F_PY
                 
                 // Compute the sphere center AND the projected ellipse
+                // (large blobs close to the camera get subsampled to a bounded number of hull points)
                 Eigen::Vector3f sphere_center;
                 EigenFitEllipse ellipse_projection;
 
-                std::vector<Eigen::Vector2f> eigen_contour;
-                std::for_each(undistort_contour.begin(),
-                              undistort_contour.end(),
-                              [&eigen_contour](cv::Point2f& p) {
-                                  eigen_contour.push_back(Eigen::Vector2f(p.x, p.y));
-                              });
-                eigen_alignment_fit_focal_cone_to_sphere(eigen_contour.data(),
-                                                         static_cast<int>(eigen_contour.size()),
-                                                         tracking_shape->shape.sphere.radius_cm,
-                                                         1, //I was expecting this to be -1. Is it +1 because we're using -F_PY?
-                                                         &sphere_center,
-                                                         &ellipse_projection);
+                eigen_alignment_fit_focal_cone_to_sphere_bounded(eigen_contour.data(),
+                                                                 static_cast<int>(eigen_contour.size()),
+                                                                 tracking_shape->shape.sphere.radius_cm,
+                                                                 1, //I was expecting this to be -1. Is it +1 because we're using -F_PY?
+                                                                 &sphere_center,
+                                                                 &ellipse_projection);
                 
                 if (ellipse_projection.area > k_real_epsilon)
                 {
@@ -1374,17 +2191,9 @@ ServerTrackerView::computeProjectionForController(
                 // Draw the raw source contour
                 m_opencv_buffer_state->draw_contour(biggest_contours[0]);
 
-                // Convert integer contour to float
-                t_opencv_float_contour biggest_contour_f;
-                cv::Mat(biggest_contours[0]).convertTo(biggest_contour_f, cv::Mat(biggest_contour_f).type());
-
                 // Compute an undistorted version of the contour
-                t_opencv_float_contour undistort_contour;
-                cv::undistortPoints(biggest_contour_f, undistort_contour,
-                                    camera_matrix,
-                                    distortions,
-                                    cv::noArray(),
-                                    camera_matrix);
+                t_opencv_float_contour &undistort_contour = m_opencv_buffer_state->undistortedContours[0];
+                undistortion_table->undistortContourToPixels(biggest_contours[0], undistort_contour);
 
                 // Compute the lightbar tracking projection from the undistored contour
                 bSuccess=
@@ -1419,60 +2228,31 @@ ServerTrackerView::computeProjectionForController(
 }
 
 bool ServerTrackerView::computeProjectionForHMD(
-    const class ServerHMDView* tracked_hmd,
-    const struct CommonDeviceTrackingShape *tracking_shape,
+    const TrackerVisionJob *job,
     struct HMDOpticalPoseEstimation *out_pose_estimate)
 {
+    const ServerHMDView *tracked_hmd= job->tracked_hmd;
+    const CommonDeviceTrackingShape *tracking_shape= &job->tracking_shape;
     bool bSuccess = true;
 
-    // Get the HSV filter used to find the tracking blob
-    CommonHSVColorRange hsvColorRange;
-    if (bSuccess)
-    {
-        eCommonTrackingColorID tracked_color_id = tracked_hmd->getTrackingColorID();
-
-        if (tracked_color_id != eCommonTrackingColorID::INVALID_COLOR)
-        {
-            getHMDTrackingColorPreset(tracked_hmd, tracked_color_id, &hsvColorRange);
-        }
-        else
-        {
-            bSuccess = false;
-        }
-    }
-    
-    // Compute a region of interest in the tracker buffer around where we expect to find the tracking shape
-    const TrackerManagerConfig &trackerMgrConfig= DeviceManager::getInstance()->m_tracker_manager->getConfig();
-    const bool bRoiDisabled = tracked_hmd->getIsROIDisabled() || trackerMgrConfig.disable_roi;
-
-    const HMDOpticalPoseEstimation *priorPoseEst= 
-        tracked_hmd->getTrackerPoseEstimate(this->getDeviceID());
-    const bool bIsTracking = priorPoseEst->bCurrentlyTracking;
-
-    cv::Rect2i ROI = computeTrackerROIForPoseProjection(
-        bRoiDisabled,
-        this, 
-        bIsTracking ? tracked_hmd->getPoseFilter() : nullptr,
-        bIsTracking ? &priorPoseEst->projection : nullptr,
-        tracking_shape);
-    m_opencv_buffer_state->applyROI(ROI);
+    m_opencv_buffer_state->applyROI(job->roi);
 
     // Find the N best contours associated with the HMD
-    t_opencv_int_contour_list biggest_contours;
-    std::vector<double> contour_areas;
+    const t_opencv_int_contour_list &biggest_contours = m_opencv_buffer_state->biggestContours;
+    int contour_count = 0;
     if (bSuccess)
     {
-        bSuccess = 
+        contour_count = 
             m_opencv_buffer_state->computeBiggestNContours(
-                hsvColorRange, biggest_contours, contour_areas, CommonDeviceTrackingProjection::MAX_POINT_CLOUD_POINT_COUNT);
+                job->label_mask, CommonDeviceTrackingProjection::MAX_POINT_CLOUD_POINT_COUNT);
+        bSuccess = contour_count > 0;
     }
 
     // Compute the tracker relative 3d position of the controller from the contour
     if (bSuccess)
     {
-        cv::Matx33f camera_matrix;
-        cv::Matx<float, 5, 1> distortions;
-        computeOpenCVCameraIntrinsicMatrix(m_device, camera_matrix, distortions);
+        const OpenCVUndistortionTable *undistortion_table = m_opencv_buffer_state->undistortionTable;
+        const cv::Matx33f &camera_matrix = undistortion_table->getIntrinsicMatrix();
 
         switch (tracking_shape->shape_type)
         {
@@ -1480,41 +2260,28 @@ bool ServerTrackerView::computeProjectionForHMD(
         case eCommonTrackingShapeType::Sphere:
             {
                 // Compute the convex hull of the contour
-                t_opencv_int_contour convex_contour;
+                // (reusing the buffer state's point buffers, so this doesn't allocate once they've grown)
+                t_opencv_int_contour &convex_contour = m_opencv_buffer_state->sphereConvexContour;
                 cv::convexHull(biggest_contours[0], convex_contour);
                 m_opencv_buffer_state->draw_contour(convex_contour);
 
-                // Convert integer to float
-                t_opencv_float_contour convex_contour_f;
-                cv::Mat(convex_contour).convertTo(convex_contour_f, cv::Mat(convex_contour_f).type());
-
                 // Undistort points
-                t_opencv_float_contour undistorted_contour;  //destination for undistorted contour
-                cv::undistortPoints(convex_contour_f, undistorted_contour,
-                                    camera_matrix,
-                                    distortions);//,
-                                    //cv::noArray(),
-                                    //camera_matrix);
-                // Note: if we omit the last two arguments, then
-                // undistort_contour points are in 'normalized' space.
+                std::vector<Eigen::Vector2f> &eigen_contour = m_opencv_buffer_state->sphereUndistortedContour;
+                undistortion_table->undistortContourToNormalized(convex_contour, eigen_contour);
+                // Note: eigen_contour points are in 'normalized' space.
                 // i.e., they are relative to their F_PX,F_PY
                 
                 // Compute the sphere center AND the projected ellipse
+                // (large blobs close to the camera get subsampled to a bounded number of hull points)
                 Eigen::Vector3f sphere_center;
                 EigenFitEllipse ellipse_projection;
 
-                std::vector<Eigen::Vector2f> eigen_contour;
-                std::for_each(undistorted_contour.begin(),
-                              undistorted_contour.end(),
-                              [&eigen_contour](const cv::Point2f& p) {
-                                  eigen_contour.push_back(Eigen::Vector2f(p.x, p.y));
-                              });
-                eigen_alignment_fit_focal_cone_to_sphere(eigen_contour.data(),
-                                                         static_cast<int>(eigen_contour.size()),
-                                                         tracking_shape->shape.sphere.radius_cm,
-                                                         1, //I was expecting this to be -1. Is it +1 because we're using -F_PY?
-                                                         &sphere_center,
-                                                         &ellipse_projection);
+                eigen_alignment_fit_focal_cone_to_sphere_bounded(eigen_contour.data(),
+                                                                 static_cast<int>(eigen_contour.size()),
+                                                                 tracking_shape->shape.sphere.radius_cm,
+                                                                 1, //I was expecting this to be -1. Is it +1 because we're using -F_PY?
+                                                                 &sphere_center,
+                                                                 &ellipse_projection);
                 
                 if (ellipse_projection.area > k_real_epsilon)
                 {
@@ -1554,25 +2321,14 @@ bool ServerTrackerView::computeProjectionForHMD(
                 CommonDevicePose tracker_pose_guess= {prior_post_est->position_cm, prior_post_est->orientation};
 
                 // Undistort the source contours
-                t_opencv_float_contour_list undistorted_contours;
-                for (auto it = biggest_contours.begin(); it != biggest_contours.end(); ++it)
+                t_opencv_float_contour_list &undistorted_contours = m_opencv_buffer_state->undistortedContours;
+                for (int contour_index = 0; contour_index < contour_count; ++contour_index)
                 {
                     // Draw the source contour
-                    m_opencv_buffer_state->draw_contour(*it);
-
-                    // Convert integer contour to float
-                    t_opencv_float_contour biggest_contour_f;
-                    cv::Mat(*it).convertTo(biggest_contour_f, cv::Mat(biggest_contour_f).type());
+                    m_opencv_buffer_state->draw_contour(biggest_contours[contour_index]);
 
                     // Compute an undistorted version of the contour
-                    t_opencv_float_contour undistort_contour;
-                    cv::undistortPoints(biggest_contour_f, undistort_contour,
-                        camera_matrix,
-                        distortions,
-                        cv::noArray(),
-                        camera_matrix);
-
-                    undistorted_contours.push_back(biggest_contour_f);
+                    undistortion_table->undistortContourToPixels(biggest_contours[contour_index], undistorted_contours[contour_index]);
                 }
 
                 bSuccess =
@@ -1580,6 +2336,7 @@ bool ServerTrackerView::computeProjectionForHMD(
                         m_device,
                         tracking_shape,
                         undistorted_contours,
+                        contour_count,
                         prior_post_est->bCurrentlyTracking ? &tracker_pose_guess : nullptr,
                         out_pose_estimate);
 
@@ -1704,134 +2461,108 @@ ServerTrackerView::computeTrackerOrientation(
     return result;
 }
 
-CommonDevicePose
-ServerTrackerView::triangulateWorldPose(
-    const ServerTrackerView *tracker, 
-    const CommonDeviceTrackingProjection *tracker_relative_projection,
-    const ServerTrackerView *other_tracker,
-    const CommonDeviceTrackingProjection *other_tracker_relative_projection)
+int
+ServerTrackerView::triangulateWorldPositionFromTrackers(
+    const ServerTrackerView * const *trackers,
+    const CommonDeviceScreenLocation *screen_locations,
+    const int tracker_count,
+    const float max_reprojection_error_px,
+    CommonDevicePosition *out_position)
+{
+    assert(tracker_count <= k_max_triangulation_view_count);
+
+    Eigen::Matrix<float, 3, 4> projection_matrices[k_max_triangulation_view_count];
+    Eigen::Vector2f image_points[k_max_triangulation_view_count];
+    for (int tracker_index = 0; tracker_index < tracker_count; ++tracker_index)
+    {
+        const CommonDeviceScreenLocation &screen_location= screen_locations[tracker_index];
+
+        projection_matrices[tracker_index]= computeEigenCameraPinholeMatrix(trackers[tracker_index]->m_device);
+        image_points[tracker_index]= Eigen::Vector2f(screen_location.x, screen_location.y);
+    }
+
+    Eigen::Vector3f world_position;
+    const int inlier_count= 
+        eigen_alignment_triangulate_point(
+            projection_matrices, image_points, tracker_count,
+            max_reprojection_error_px,
+            &world_position);
+
+    if (inlier_count > 0)
+    {
+        out_position->set(world_position.x(), world_position.y(), world_position.z());
+    }
+
+    return inlier_count;
+}
+
+bool
+ServerTrackerView::triangulateWorldPoseFromTrackers(
+    const ServerTrackerView * const *trackers,
+    const CommonDeviceTrackingProjection * const *tracker_relative_projections,
+    const int tracker_count,
+    const float max_reprojection_error_px,
+    CommonDevicePose *out_pose)
 {
-    assert(tracker_relative_projection->shape_type == other_tracker_relative_projection->shape_type);
-    CommonDevicePose pose;
+    assert(tracker_count >= 2);
+    assert(tracker_count <= k_max_triangulation_view_count);
+    bool bSuccess= false;
 
-    pose.clear();
-    switch(tracker_relative_projection->shape_type)
+    out_pose->clear();
+    switch (tracker_relative_projections[0]->shape_type)
     {
     case eCommonTrackingProjectionType::ProjectionType_Ellipse:
         {
-            pose.PositionCm =
-                triangulateWorldPosition(
-                    tracker,
-                    &tracker_relative_projection->shape.ellipse.center,
-                    other_tracker,
-                    &other_tracker_relative_projection->shape.ellipse.center);
-            pose.Orientation.clear();
+            CommonDeviceScreenLocation screen_locations[k_max_triangulation_view_count];
+            for (int tracker_index = 0; tracker_index < tracker_count; ++tracker_index)
+            {
+                screen_locations[tracker_index]= tracker_relative_projections[tracker_index]->shape.ellipse.center;
+            }
+
+            bSuccess= 
+                triangulateWorldPositionFromTrackers(
+                    trackers, screen_locations, tracker_count,
+                    max_reprojection_error_px,
+                    &out_pose->PositionCm) > 0;
         } break;
     case eCommonTrackingProjectionType::ProjectionType_LightBar:
         {
-            // Copy the lightbar triangle and quad screen space points into flat arrays
             const int k_vertex_count= CommonDeviceTrackingShape::QuadVertexCount+CommonDeviceTrackingShape::TriVertexCount;
-            CommonDeviceScreenLocation screen_locations[k_vertex_count];
-            CommonDeviceScreenLocation other_screen_locations[k_vertex_count];			
-            for (int quad_index = 0; quad_index < CommonDeviceTrackingShape::QuadVertexCount; ++quad_index)
-            {
-                screen_locations[quad_index]= tracker_relative_projection->shape.lightbar.quad[quad_index];
-                other_screen_locations[quad_index]= other_tracker_relative_projection->shape.lightbar.quad[quad_index];
-            }
-            for (int tri_index = 0; tri_index < CommonDeviceTrackingShape::TriVertexCount; ++tri_index)
-            {
-                screen_locations[CommonDeviceTrackingShape::QuadVertexCount + tri_index]= 
-                    tracker_relative_projection->shape.lightbar.triangle[tri_index];
-                other_screen_locations[CommonDeviceTrackingShape::QuadVertexCount + tri_index]=
-                    other_tracker_relative_projection->shape.lightbar.triangle[tri_index];
-            }
 
-            // Triangulate the 7 points on the lightbar
-            Eigen::Vector3f lightbar_points[k_vertex_count];
+            Eigen::Matrix<float, 3, 4> projection_matrices[k_max_triangulation_view_count];
+            for (int tracker_index = 0; tracker_index < tracker_count; ++tracker_index)
             {
-                CommonDevicePosition world_positions[k_vertex_count];
-                ServerTrackerView::triangulateWorldPositions(
-                    tracker, 
-                    screen_locations,
-                    other_tracker,
-                    other_screen_locations,
-                    k_vertex_count,
-                    world_positions);
-
-                for (int point_index = 0; point_index < k_vertex_count; ++point_index)
-                {
-                    const CommonDevicePosition &p= world_positions[point_index];
-
-                    lightbar_points[point_index]= Eigen::Vector3f(p.x, p.y, p.z);
-                }
+                projection_matrices[tracker_index]= computeEigenCameraPinholeMatrix(trackers[tracker_index]->m_device);
             }
 
-            // Compute best fit plane for the world space light bar points
-            Eigen::Vector3f centroid, normal;
-            if (eigen_alignment_fit_least_squares_plane(
-                    lightbar_points, k_vertex_count,
-                    &centroid, &normal))
+            // Triangulate each of the 7 points on the lightbar from every tracker
+            Eigen::Vector3f lightbar_points[k_vertex_count];
+            bSuccess= true;
+            for (int vertex_index = 0; bSuccess && vertex_index < k_vertex_count; ++vertex_index)
             {
-                // Assume that the normal for the projection should be facing the tracker.
-                // Since the projection is planar and both trackers can see the projection
-                // it doesn't matter which tracker we use for the facing test.
+                Eigen::Vector2f image_points[k_max_triangulation_view_count];
+                for (int tracker_index = 0; tracker_index < tracker_count; ++tracker_index)
                 {
-                    const CommonDevicePosition commonTrackerPosition= tracker->getTrackerPose().PositionCm;
-                    const Eigen::Vector3f trackerPosition(commonTrackerPosition.x, commonTrackerPosition.y, commonTrackerPosition.z);
-                    const Eigen::Vector3f centroidToTracker= trackerPosition - centroid;
-
-                    if (centroidToTracker.dot(normal) < 0.f)
-                    {
-                        normal= -normal;
-                    }
-                }
-
-                // Project the lightbar 
-                float projection_error= eigen_alignment_project_points_on_plane(centroid, normal, lightbar_points, k_vertex_count);
+                    const CommonDeviceTrackingProjection *projection= tracker_relative_projections[tracker_index];
+                    const CommonDeviceScreenLocation &screen_location=
+                        (vertex_index < CommonDeviceTrackingShape::QuadVertexCount)
+                        ? projection->shape.lightbar.quad[vertex_index]
+                        : projection->shape.lightbar.triangle[vertex_index - CommonDeviceTrackingShape::QuadVertexCount];
 
-                // Compute the orientation of the lightbar
-                // Forward is the normal vector
-                // Up is defined by the orientation of the lightbar vertices
-                {
-                    const Eigen::Vector3f &mid_left_vertex= 
-                        (lightbar_points[CommonDeviceTrackingShape::QuadVertexUpperLeft] 
-                        + lightbar_points[CommonDeviceTrackingShape::QuadVertexLowerLeft]) / 2.f;
-                    const Eigen::Vector3f &mid_right_vertex =
-                        (lightbar_points[CommonDeviceTrackingShape::QuadVertexUpperRight]
-                        + lightbar_points[CommonDeviceTrackingShape::QuadVertexLowerRight]) / 2.f;
-                    const Eigen::Vector3f right= mid_right_vertex - mid_left_vertex;
-
-                    // Get the global definition of tracking space "forward" and "right"
-                    const TrackerManagerConfig &cfg= DeviceManager::getInstance()->m_tracker_manager->getConfig();
-                    const CommonDeviceVector &global_forward = cfg.get_global_forward_axis();
-                    const CommonDeviceVector &global_right = cfg.get_global_right_axis();
-                    const Eigen::Vector3f eigen_global_forward(global_forward.i, global_forward.j, global_forward.k);
-                    const Eigen::Vector3f eigen_global_right(global_right.i, global_right.j, global_right.k);
-
-                    // Compute the rotation that would align the global forward and right 
-                    // with the normal and right vectors computed for the light bar
-                    const Eigen::Quaternionf align_normal_rotation= 
-                        Eigen::Quaternionf::FromTwoVectors(eigen_global_forward, normal);
-                    const Eigen::Vector3f x_axis_in_plane = 
-                        align_normal_rotation * eigen_global_right;
-                    const Eigen::Quaternionf align_right_rotation = 
-                        Eigen::Quaternionf::FromTwoVectors(x_axis_in_plane, right);
-                    const Eigen::Quaternionf q = (align_right_rotation*align_normal_rotation).normalized();
-
-                    pose.Orientation.w= q.w();
-                    pose.Orientation.x= q.x();
-                    pose.Orientation.y= q.y();
-                    pose.Orientation.z= q.z();
+                    image_points[tracker_index]= Eigen::Vector2f(screen_location.x, screen_location.y);
                 }
 
-                // Use the centroid as the world pose location
-                pose.PositionCm.x= centroid.x();
-                pose.PositionCm.y= centroid.y();
-                pose.PositionCm.z= centroid.z();
+                bSuccess= 
+                    eigen_alignment_triangulate_point(
+                        projection_matrices, image_points, tracker_count,
+                        max_reprojection_error_px,
+                        &lightbar_points[vertex_index]) > 0;
             }
-            else
+
+            // Compute the pose of the light bar from the plane the world space points lie on
+            if (bSuccess)
             {
-                pose.clear();
+                bSuccess= computeWorldLightBarPoseFromPoints(trackers[0], lightbar_points, out_pose);
             }
         } break;
     case eCommonTrackingProjectionType::ProjectionType_Points:
@@ -1842,91 +2573,12 @@ ServerTrackerView::triangulateWorldPose(
         assert(0 && "unreachable");
     }
 
-    return pose;
-}
-
-CommonDevicePosition
-ServerTrackerView::triangulateWorldPosition(
-    const ServerTrackerView *tracker, 
-    const CommonDeviceScreenLocation *screen_location,
-    const ServerTrackerView *other_tracker,
-    const CommonDeviceScreenLocation *other_screen_location)
-{
-    float screenWidth, screenHeight;
-    tracker->getPixelDimensions(screenWidth, screenHeight);
-    
-    float otherScreenWidth, otherScreenHeight;
-    tracker->getPixelDimensions(otherScreenWidth, otherScreenHeight);
-
-    cv::Mat projPoints1 = cv::Mat(cv::Point2f(screen_location->x, screen_location->y));
-    cv::Mat projPoints2 = cv::Mat(cv::Point2f(other_screen_location->x, other_screen_location->y));
-
-    // Compute the pinhole camera matrix for each tracker that allows you to raycast
-    // from the tracker center in world space through the screen location, into the world
-    // See: http://docs.opencv.org/2.4/modules/calib3d/doc/camera_calibration_and_3d_reconstruction.html
-    cv::Mat projMat1 = cv::Mat(computeOpenCVCameraPinholeMatrix(tracker->m_device));
-    cv::Mat projMat2 = cv::Mat(computeOpenCVCameraPinholeMatrix(other_tracker->m_device));
-
-    // Triangulate the world position from the two cameras
-    cv::Mat point3D(1, 1, CV_32FC4);
-    cv::triangulatePoints(projMat1, projMat2, projPoints1, projPoints2, point3D);
-
-    // Return the world space position
-    CommonDevicePosition result;
-    const float w = point3D.at<float>(3, 0);
-    result.x = point3D.at<float>(0, 0) / w;
-    result.y = point3D.at<float>(1, 0) / w;
-    result.z = point3D.at<float>(2, 0) / w;
-
-    return result;
-}
-
-void
-ServerTrackerView::triangulateWorldPositions(
-    const ServerTrackerView *tracker, 
-    const CommonDeviceScreenLocation *screen_locations,
-    const ServerTrackerView *other_tracker,
-    const CommonDeviceScreenLocation *other_screen_locations,
-    const int screen_location_count,
-    CommonDevicePosition *out_result)
-{
-    float screenWidth, screenHeight;
-    tracker->getPixelDimensions(screenWidth, screenHeight);
-
-    float otherScreenWidth, otherScreenHeight;
-    tracker->getPixelDimensions(otherScreenWidth, otherScreenHeight);
-
-    std::vector<cv::Point2f> projPoints1;
-    std::vector<cv::Point2f> projPoints2;
-    for (int point_index = 0; point_index < screen_location_count; ++point_index)
+    if (!bSuccess)
     {
-        const CommonDeviceScreenLocation &p1= screen_locations[point_index];
-        const CommonDeviceScreenLocation &p2= other_screen_locations[point_index];
-
-        projPoints1.push_back(cv::Point2f(p1.x, p1.y));
-        projPoints2.push_back(cv::Point2f(p2.x, p2.y));
+        out_pose->clear();
     }
 
-    // Compute the pinhole camera matrix for each tracker that allows you to raycast
-    // from the tracker center in world space through the screen location, into the world
-    // See: http://docs.opencv.org/2.4/modules/calib3d/doc/camera_calibration_and_3d_reconstruction.html
-    cv::Mat projMat1 = cv::Mat(computeOpenCVCameraPinholeMatrix(tracker->m_device));
-    cv::Mat projMat2 = cv::Mat(computeOpenCVCameraPinholeMatrix(other_tracker->m_device));
-
-    // Triangulate the world positions from the two cameras
-    cv::Mat points3D(1, screen_location_count, CV_32FC4);
-    cv::triangulatePoints(projMat1, projMat2, projPoints1, projPoints2, points3D);
-
-    // Return the world space positions
-    for (int point_index = 0; point_index < screen_location_count; ++point_index)
-    {
-        CommonDevicePosition &result= out_result[point_index];
-
-        const float w = points3D.at<float>(3, point_index);
-        result.x = points3D.at<float>(0, point_index) / w;
-        result.y = points3D.at<float>(1, point_index) / w;
-        result.z = points3D.at<float>(2, point_index) / w;
-    }
+    return bSuccess;
 }
 
 
@@ -2045,6 +2697,99 @@ static cv::Matx34f computeOpenCVCameraPinholeMatrix(const ITrackerInterface *tra
     return pinhole_matrix;
 }
 
+static Eigen::Matrix<float, 3, 4> computeEigenCameraPinholeMatrix(const ITrackerInterface *tracker_device)
+{
+    const cv::Matx34f cv_pinhole_matrix = computeOpenCVCameraPinholeMatrix(tracker_device);
+    Eigen::Matrix<float, 3, 4> pinhole_matrix;
+
+    for (int row = 0; row < 3; ++row)
+    {
+        for (int col = 0; col < 4; ++col)
+        {
+            pinhole_matrix(row, col) = cv_pinhole_matrix(row, col);
+        }
+    }
+
+    return pinhole_matrix;
+}
+
+static bool computeWorldLightBarPoseFromPoints(
+    const ServerTrackerView *facing_tracker,
+    Eigen::Vector3f *lightbar_points,
+    CommonDevicePose *out_pose)
+{
+    const int k_lightbar_vertex_count= CommonDeviceTrackingShape::QuadVertexCount+CommonDeviceTrackingShape::TriVertexCount;
+
+    // Compute best fit plane for the world space light bar points
+    Eigen::Vector3f centroid, normal;
+    bool bSuccess= false;
+    if (eigen_alignment_fit_least_squares_plane(
+            lightbar_points, k_lightbar_vertex_count,
+            &centroid, &normal))
+    {
+        // Assume that the normal for the projection should be facing the tracker.
+        // Since the projection is planar and every tracker used can see the projection
+        // it doesn't matter which tracker we use for the facing test.
+        {
+            const CommonDevicePosition commonTrackerPosition= facing_tracker->getTrackerPose().PositionCm;
+            const Eigen::Vector3f trackerPosition(commonTrackerPosition.x, commonTrackerPosition.y, commonTrackerPosition.z);
+            const Eigen::Vector3f centroidToTracker= trackerPosition - centroid;
+
+            if (centroidToTracker.dot(normal) < 0.f)
+            {
+                normal= -normal;
+            }
+        }
+
+        // Project the lightbar 
+        float projection_error= eigen_alignment_project_points_on_plane(centroid, normal, lightbar_points, k_lightbar_vertex_count);
+
+        // Compute the orientation of the lightbar
+        // Forward is the normal vector
+        // Up is defined by the orientation of the lightbar vertices
+        {
+            const Eigen::Vector3f &mid_left_vertex= 
+                (lightbar_points[CommonDeviceTrackingShape::QuadVertexUpperLeft] 
+                + lightbar_points[CommonDeviceTrackingShape::QuadVertexLowerLeft]) / 2.f;
+            const Eigen::Vector3f &mid_right_vertex =
+                (lightbar_points[CommonDeviceTrackingShape::QuadVertexUpperRight]
+                + lightbar_points[CommonDeviceTrackingShape::QuadVertexLowerRight]) / 2.f;
+            const Eigen::Vector3f right= mid_right_vertex - mid_left_vertex;
+
+            // Get the global definition of tracking space "forward" and "right"
+            const TrackerManagerConfig &cfg= DeviceManager::getInstance()->m_tracker_manager->getConfig();
+            const CommonDeviceVector &global_forward = cfg.get_global_forward_axis();
+            const CommonDeviceVector &global_right = cfg.get_global_right_axis();
+            const Eigen::Vector3f eigen_global_forward(global_forward.i, global_forward.j, global_forward.k);
+            const Eigen::Vector3f eigen_global_right(global_right.i, global_right.j, global_right.k);
+
+            // Compute the rotation that would align the global forward and right 
+            // with the normal and right vectors computed for the light bar
+            const Eigen::Quaternionf align_normal_rotation= 
+                Eigen::Quaternionf::FromTwoVectors(eigen_global_forward, normal);
+            const Eigen::Vector3f x_axis_in_plane = 
+                align_normal_rotation * eigen_global_right;
+            const Eigen::Quaternionf align_right_rotation = 
+                Eigen::Quaternionf::FromTwoVectors(x_axis_in_plane, right);
+            const Eigen::Quaternionf q = (align_right_rotation*align_normal_rotation).normalized();
+
+            out_pose->Orientation.w= q.w();
+            out_pose->Orientation.x= q.x();
+            out_pose->Orientation.y= q.y();
+            out_pose->Orientation.z= q.z();
+        }
+
+        // Use the centroid as the world pose location
+        out_pose->PositionCm.x= centroid.x();
+        out_pose->PositionCm.y= centroid.y();
+        out_pose->PositionCm.z= centroid.z();
+
+        bSuccess= true;
+    }
+
+    return bSuccess;
+}
+
 static bool computeTrackerRelativeLightBarProjection(
     const CommonDeviceTrackingShape *tracking_shape,
     const t_opencv_float_contour &opencv_contour,
@@ -2265,6 +3010,7 @@ static bool computeTrackerRelativePointCloudContourPose(
     const ITrackerInterface *tracker_device,
     const CommonDeviceTrackingShape *tracking_shape,
     const t_opencv_float_contour_list &opencv_contours,
+    const int contour_count,
     const CommonDevicePose *tracker_relative_pose_guess,
     HMDOpticalPoseEstimation *out_pose_estimate)
 {
@@ -2274,15 +3020,14 @@ static bool computeTrackerRelativePointCloudContourPose(
     float projectionArea = 0.f;
 
     // Compute centers of mass for the contours
-    t_opencv_float_contour cvImagePoints;
-    for (auto it = opencv_contours.begin(); it != opencv_contours.end(); ++it)
+    assert(contour_count <= CommonDeviceTrackingProjection::MAX_POINT_CLOUD_POINT_COUNT);
+    cv::Point2f cvImagePoints[CommonDeviceTrackingProjection::MAX_POINT_CLOUD_POINT_COUNT];
+    for (int contour_index = 0; contour_index < contour_count; ++contour_index)
     {
-        cv::Point2f massCenter= computeSafeCenterOfMassForContour<t_opencv_float_contour>(*it);
-
-        cvImagePoints.push_back(massCenter);
+        cvImagePoints[contour_index]= computeSafeCenterOfMassForContour<t_opencv_float_contour>(opencv_contours[contour_index]);
     }
 
-    if (cvImagePoints.size() >= 3)
+    if (contour_count >= 3)
     {
         //###HipsterSloth $TODO Solve the pose using SoftPOSIT
         out_pose_estimate->position_cm.clear();
@@ -2295,7 +3040,7 @@ static bool computeTrackerRelativePointCloudContourPose(
     if (bValidTrackerPose)
     {
         CommonDeviceTrackingProjection *out_projection = &out_pose_estimate->projection;
-        const int imagePointCount = static_cast<int>(cvImagePoints.size());
+        const int imagePointCount = contour_count;
 
         out_projection->shape_type = eCommonTrackingProjectionType::ProjectionType_Points;
 
@@ -2486,7 +3231,7 @@ static bool computeBestFitTriangleForContour(
     }
     catch( cv::Exception& e )
     {
-        SERVER_LOG_INFO("computeBestFitTriangleForContour") << e.what();
+        SERVER_MT_LOG_INFO("computeBestFitTriangleForContour") << e.what();
         return false;
     }
 
@@ -4,6 +4,7 @@
 //-- includes -----
 #include "ServerDeviceView.h"
 #include "PSMoveProtocolInterface.h"
+#include <stdint.h>
 #include <vector>
 
 // -- pre-declarations -----
@@ -44,6 +45,16 @@ public:
 
     // Returns the name of the shared memory block video frames are written to
     std::string getSharedMemoryStreamName() const;
+
+    // Video frame copy accounting since the tracker was opened.
+    // Frames are only copied when a shared memory video stream is active.
+    inline uint64_t getVideoFrameCount() const { return m_video_frame_count; }
+    inline uint64_t getVideoFrameCopyByteCount() const { return m_video_frame_copy_byte_count; }
+    uint64_t getAverageVideoFrameCopyByteCount() const;
+
+    // When the camera captured the video frame currently being processed
+    inline std::chrono::time_point<std::chrono::high_resolution_clock> getVideoFrameCaptureTimestamp() const
+    { return m_video_frame_capture_timestamp; }
     
     void loadSettings();
     void saveSettings();
@@ -63,14 +74,27 @@ public:
     double getGain() const;
     void setGain(double value, bool bUpdateConfig);
     
-    bool computeProjectionForController(
-        const class ServerControllerView* tracked_controller, 
-		const struct CommonDeviceTrackingShape *tracking_shape,
-        struct ControllerOpticalPoseEstimation *out_pose_estimate);
-    bool computeProjectionForHMD(
-		const class ServerHMDView* tracked_hmd,
-		const struct CommonDeviceTrackingShape *tracking_shape,
-		struct HMDOpticalPoseEstimation *out_pose_estimate);
+    // Queue up a search for the given device in the newest video frame.
+    // The search runs on this tracker's vision thread and any projection found
+    // is handed back through the device's notifyTrackerDataReceived() callback.
+    void requestControllerProjection(
+        class ServerControllerView* tracked_controller,
+        const struct CommonDeviceTrackingShape *tracking_shape);
+    void requestHMDProjection(
+        class ServerHMDView* tracked_hmd,
+        const struct CommonDeviceTrackingShape *tracking_shape);
+
+    // Hand all of the projections requested this tick to the vision thread
+    void dispatchRequestedProjections();
+
+    // Block until the vision thread has finished all of the requested projections
+    void waitForRequestedProjections();
+
+    // Called on the vision thread.
+    // Segments the newest video frame once for all of the requested tracking colors
+    // and then extracts each requested device's projection from the segmented frame.
+    void computeRequestedProjections(struct TrackerVisionJob *jobs, const int job_count);
+
     bool computePoseForProjection(
 		const struct CommonDeviceTrackingProjection *projection,
 		const struct CommonDeviceTrackingShape *tracking_shape,
@@ -88,24 +112,25 @@ public:
     CommonDevicePosition computeTrackerPosition(const CommonDevicePosition *world_relative_position) const;
     CommonDeviceQuaternion computeTrackerOrientation(const CommonDeviceQuaternion *world_relative_orientation) const;
 
-    /// Given a single screen location on two different trackers, compute the triangulated world space location
-    static CommonDevicePosition triangulateWorldPosition(
-        const ServerTrackerView *tracker, const CommonDeviceScreenLocation *screen_location,
-        const ServerTrackerView *other_tracker, const CommonDeviceScreenLocation *other_screen_location);
-
-	/// Given a set of screen locations on two different trackers, compute the triangulated world space locations
-	static void triangulateWorldPositions(
-		const ServerTrackerView *tracker, 
-		const CommonDeviceScreenLocation *screen_locations,
-		const ServerTrackerView *other_tracker,
-		const CommonDeviceScreenLocation *other_screen_locations,
-		const int screen_location_count,
-		CommonDevicePosition *out_result);
-
-    /// Given screen projections on two different trackers, compute the triangulated world space location
-    static CommonDevicePose triangulateWorldPose(
-        const ServerTrackerView *tracker, const CommonDeviceTrackingProjection *tracker_relative_projection,
-        const ServerTrackerView *other_tracker, const CommonDeviceTrackingProjection *other_tracker_relative_projection);
+    /// Given a single screen location on each of several trackers, compute the least squares triangulated world space location.
+    /// Trackers whose reprojection error is above max_reprojection_error_px get rejected one at a time (worst first)
+    /// as long as two trackers remain.
+    /// Returns the number of trackers the location was triangulated from, 0 on failure.
+    static int triangulateWorldPositionFromTrackers(
+        const ServerTrackerView * const *trackers,
+        const CommonDeviceScreenLocation *screen_locations,
+        const int tracker_count,
+        const float max_reprojection_error_px,
+        CommonDevicePosition *out_position);
+
+    /// Given screen projections on several trackers, compute the least squares triangulated world space pose
+    /// (see triangulateWorldPositionFromTrackers() for the outlier rejection)
+    static bool triangulateWorldPoseFromTrackers(
+        const ServerTrackerView * const *trackers,
+        const CommonDeviceTrackingProjection * const *tracker_relative_projections,
+        const int tracker_count,
+        const float max_reprojection_error_px,
+        CommonDevicePose *out_pose);
 
     void getCameraIntrinsics(
         float &outFocalLengthX, float &outFocalLengthY,
@@ -139,18 +164,34 @@ public:
 	void getHMDTrackingColorPreset(const class ServerHMDView *controller, eCommonTrackingColorID color, CommonHSVColorRange *out_preset) const;
 
 protected:
+    bool computeProjectionForController(
+        const struct TrackerVisionJob *job,
+        struct ControllerOpticalPoseEstimation *out_pose_estimate);
+    bool computeProjectionForHMD(
+        const struct TrackerVisionJob *job,
+        struct HMDOpticalPoseEstimation *out_pose_estimate);
+
     bool allocate_device_interface(const class DeviceEnumerator *enumerator) override;
     void free_device_interface() override;
     void publish_device_data_frame() override;
     static void generate_tracker_data_frame_for_stream(
         const ServerTrackerView *tracker_view, const struct TrackerStreamInfo *stream_info,
-        DeviceOutputDataFramePtr &data_frame);
+        PSMoveProtocol::DeviceOutputDataFrame *data_frame);
 
 private:
+    // Stops the vision thread and drops its references to the current video frame.
+    // Returns true if the thread was running and should be resumed afterwards.
+    bool pauseVisionProcessor();
+    void resumeVisionProcessor();
+
     char m_shared_memory_name[256];
     class SharedVideoFrameReadWriteAccessor *m_shared_memory_accesor;
     int m_shared_memory_video_stream_count;
+    uint64_t m_video_frame_count;
+    uint64_t m_video_frame_copy_byte_count;
+    std::chrono::time_point<std::chrono::high_resolution_clock> m_video_frame_capture_timestamp;
     class OpenCVBufferState *m_opencv_buffer_state;
+    class TrackerVisionProcessor *m_vision_processor;
     ITrackerInterface *m_device;
 };
 
@@ -1,6 +1,7 @@
 // -- includes --
 #include "CompoundPoseFilter.h"
 #include "OrientationFilter.h"
+#include "OrientationFilterBatch.h"
 #include "PositionFilter.h"
 #include "KalmanPositionFilter.h"
 #include "KalmanOrientationFilter.h"
@@ -10,11 +11,12 @@ bool CompoundPoseFilter::init(
 	const CommonDeviceState::eDeviceType deviceType,
 	const OrientationFilterType orientationFilterType,
 	const PositionFilterType positionFilterType,
-	const PoseFilterConstants &constant)
+	const PoseFilterConstants &constant,
+	OrientationFilterBatch *orientation_batch)
 {
 	bool bSuccess = true;
 
-	allocate_filters(deviceType, orientationFilterType, positionFilterType, constant);
+	allocate_filters(deviceType, orientationFilterType, positionFilterType, constant, orientation_batch);
 
 	if (m_orientation_filter != nullptr)
 	{
@@ -35,11 +37,12 @@ bool CompoundPoseFilter::init(
 	const PositionFilterType positionFilterType,
 	const PoseFilterConstants &constant,
 	const Eigen::Vector3f &initial_position,
-	const Eigen::Quaternionf &initial_orientation)
+	const Eigen::Quaternionf &initial_orientation,
+	OrientationFilterBatch *orientation_batch)
 {
 	bool bSuccess = true;
 
-	allocate_filters(deviceType, orientationFilterType, positionFilterType, constant);
+	allocate_filters(deviceType, orientationFilterType, positionFilterType, constant, orientation_batch);
 
 	if (m_orientation_filter != nullptr)
 	{
@@ -58,47 +61,91 @@ void CompoundPoseFilter::allocate_filters(
 	const CommonDeviceState::eDeviceType deviceType,
 	const OrientationFilterType orientationFilterType,
 	const PositionFilterType positionFilterType,
-	const PoseFilterConstants &constant)
+	const PoseFilterConstants &constant,
+	OrientationFilterBatch *orientation_batch)
 {
 	dispose_filters();
 
-	switch(orientationFilterType)
+	// Run the Madgwick and complementary orientation filters on the shared batch, if there is one
+	if (orientation_batch != nullptr)
 	{
-    case OrientationFilterTypeNone:
-		m_orientation_filter = nullptr;
-		break;
-    case OrientationFilterTypePassThru:
-		m_orientation_filter = new OrientationFilterPassThru();
-		break;
-    case OrientationFilterTypeMadgwickARG:
-		m_orientation_filter = new OrientationFilterMadgwickARG;
-		break;
-    case OrientationFilterTypeMadgwickMARG:
-		m_orientation_filter = new OrientationFilterMadgwickMARG;
-		break;
-    case OrientationFilterTypeComplementaryOpticalARG:
-		m_orientation_filter = new OrientationFilterComplementaryOpticalARG;
-		break;
-    case OrientationFilterTypeComplementaryMARG:
-		m_orientation_filter = new OrientationFilterComplementaryMARG;
-		break;
-	case OrientationFilterTypeKalman:
+		switch (orientationFilterType)
+		{
+		case OrientationFilterTypeMadgwickARG:
+			m_orientation_batch_lane = new OrientationFilterBatchLane(orientation_batch, OrientationFilterBatchMadgwickARG);
+			break;
+		case OrientationFilterTypeMadgwickMARG:
+			m_orientation_batch_lane = new OrientationFilterBatchLane(orientation_batch, OrientationFilterBatchMadgwickMARG);
+			break;
+		case OrientationFilterTypeComplementaryMARG:
+			m_orientation_batch_lane = new OrientationFilterBatchLane(orientation_batch, OrientationFilterBatchComplementaryMARG);
+			break;
+		default:
+			break;
+		}
+
+		// Fall back to a standalone filter if the batch is out of lanes
+		if (m_orientation_batch_lane != nullptr && !m_orientation_batch_lane->getHasLane())
 		{
-			switch (deviceType)
+			delete m_orientation_batch_lane;
+			m_orientation_batch_lane = nullptr;
+		}
+	}
+
+	if (m_orientation_batch_lane != nullptr)
+	{
+		m_orientation_filter = m_orientation_batch_lane;
+	}
+	else
+	{
+		switch(orientationFilterType)
+		{
+	    case OrientationFilterTypeNone:
+			m_orientation_filter = nullptr;
+			break;
+	    case OrientationFilterTypePassThru:
+			m_orientation_filter = new OrientationFilterPassThru();
+			break;
+	    case OrientationFilterTypeMadgwickARG:
+			m_orientation_filter = new OrientationFilterMadgwickARG;
+			break;
+	    case OrientationFilterTypeMadgwickMARG:
+			m_orientation_filter = new OrientationFilterMadgwickMARG;
+			break;
+	    case OrientationFilterTypeComplementaryOpticalARG:
+			m_orientation_filter = new OrientationFilterComplementaryOpticalARG;
+			break;
+	    case OrientationFilterTypeComplementaryMARG:
+			m_orientation_filter = new OrientationFilterComplementaryMARG;
+			break;
+		case OrientationFilterTypeKalman:
+		case OrientationFilterTypeKalmanFloat:
 			{
-			case CommonDeviceState::PSDualShock4:
-				m_orientation_filter = new KalmanOrientationFilterDS4;
-				break;
-			case CommonDeviceState::PSMove:
-				m_orientation_filter = new KalmanOrientationFilterPSMove;
-				break;
-			default:
-				assert(0 && "unreachable");
+				// The float variant runs the same filter in single precision
+				const KalmanFilterScalarType scalar_type =
+					(orientationFilterType == OrientationFilterTypeKalmanFloat)
+					? KalmanFilterScalarFloat
+					: KalmanFilterScalarDouble;
+
+				switch (deviceType)
+				{
+				case CommonDeviceState::PSDualShock4:
+					m_orientation_filter = new KalmanOrientationFilterDS4(scalar_type);
+					break;
+				case CommonDeviceState::PSMove:
+					m_orientation_filter = new KalmanOrientationFilterPSMove(scalar_type);
+					break;
+				case CommonDeviceState::Morpheus:
+					m_orientation_filter = new KalmanOrientationFilterPSVR(scalar_type);
+					break;
+				default:
+					assert(0 && "unreachable");
+				}
 			}
+			break;
+		default:
+			assert(0 && "unreachable");
 		}
-		break;
-	default:
-		assert(0 && "unreachable");
 	}
 
 	switch(positionFilterType)
@@ -144,15 +191,28 @@ void CompoundPoseFilter::update(
 	const float delta_time,
 	const PoseFilterPacket &orientation_filter_packet)
 {
+	complete_pending_position_update();
+
     Eigen::Quaternionf filtered_orientation= Eigen::Quaternionf::Identity();
 	if (m_orientation_filter != nullptr && m_position_filter != nullptr)
 	{
 		// Update the orientation filter first
 		m_orientation_filter->update(delta_time, orientation_filter_packet);
-        filtered_orientation= m_orientation_filter->getOrientation();
+
+		if (m_orientation_batch_lane != nullptr && m_orientation_batch_lane->getHasPendingUpdate())
+		{
+			// Hold the position update until the batch has applied the orientation update
+			m_pending_position_packet= orientation_filter_packet;
+			m_pending_position_delta_time= delta_time;
+			m_bHasPendingPositionUpdate= true;
+		}
+		else
+		{
+			filtered_orientation= m_orientation_filter->getOrientation();
+		}
     }
 
-    if (m_position_filter != nullptr)
+    if (m_position_filter != nullptr && !m_bHasPendingPositionUpdate)
     {
 		// Update the position filter using the latest orientation
 		PoseFilterPacket position_filter_packet= orientation_filter_packet;
@@ -169,6 +229,8 @@ void CompoundPoseFilter::update(
 
 void CompoundPoseFilter::resetState()
 {
+	m_bHasPendingPositionUpdate= false;
+
 	if (m_orientation_filter != nullptr && m_position_filter != nullptr)
 	{
 		m_orientation_filter->resetState();
@@ -185,6 +247,61 @@ void CompoundPoseFilter::recenterOrientation(const Eigen::Quaternionf& q_pose)
 	}
 }
 
+bool CompoundPoseFilter::allocateStateHistory(const int state_count)
+{
+	bool bSuccess = true;
+
+	// The compound filter can only be rewound if all of its filters can
+	if (m_orientation_filter != nullptr)
+	{
+		bSuccess &= m_orientation_filter->allocateStateHistory(state_count);
+	}
+
+	if (m_position_filter != nullptr)
+	{
+		bSuccess &= m_position_filter->allocateStateHistory(state_count);
+	}
+
+	m_time_history.resize(state_count);
+
+	return bSuccess;
+}
+
+void CompoundPoseFilter::saveState(const int state_index)
+{
+	complete_pending_position_update();
+
+	if (m_orientation_filter != nullptr)
+	{
+		m_orientation_filter->saveState(state_index);
+	}
+
+	if (m_position_filter != nullptr)
+	{
+		m_position_filter->saveState(state_index);
+	}
+
+	m_time_history[state_index]= m_time;
+}
+
+void CompoundPoseFilter::restoreState(const int state_index)
+{
+	// The restored orientation filter drops its staged update, so drop the matching position update too
+	m_bHasPendingPositionUpdate= false;
+
+	if (m_orientation_filter != nullptr)
+	{
+		m_orientation_filter->restoreState(state_index);
+	}
+
+	if (m_position_filter != nullptr)
+	{
+		m_position_filter->restoreState(state_index);
+	}
+
+	m_time= m_time_history[state_index];
+}
+
 bool CompoundPoseFilter::getIsPositionStateValid() const
 {
 	return m_position_filter != nullptr && m_position_filter->getIsStateValid();
@@ -225,17 +342,48 @@ Eigen::Vector3f CompoundPoseFilter::getAccelerationCmPerSecSqr() const
 	return (m_position_filter != nullptr) ? m_position_filter->getAccelerationCmPerSecSqr() : Eigen::Vector3f::Zero();
 }
 
+bool CompoundPoseFilter::getIsBatched() const
+{
+	return m_orientation_batch_lane != nullptr;
+}
+
+void CompoundPoseFilter::completeBatchedUpdate()
+{
+	complete_pending_position_update();
+}
+
 void CompoundPoseFilter::dispose_filters()
 {
 	if (m_orientation_filter != nullptr)
 	{
 		delete m_orientation_filter;
 		m_orientation_filter= nullptr;
+		m_orientation_batch_lane= nullptr;
 	}
 
+	m_bHasPendingPositionUpdate= false;
+
 	if (m_position_filter != nullptr)
 	{
 		delete m_position_filter;
 		m_position_filter= nullptr;
 	}
-}
\ No newline at end of file
+}
+
+void CompoundPoseFilter::complete_pending_position_update()
+{
+	if (m_bHasPendingPositionUpdate)
+	{
+		m_bHasPendingPositionUpdate= false;
+
+		// The batch may not have run yet (a filter history replay or a second packet in the same batch round),
+		// so apply the staged orientation update before reading the orientation
+		m_orientation_batch_lane->flushPendingUpdate();
+
+		// Update the position filter using the orientation the batch produced
+		PoseFilterPacket position_filter_packet= m_pending_position_packet;
+		position_filter_packet.current_orientation= m_orientation_filter->getOrientation();
+
+		m_position_filter->update(m_pending_position_delta_time, position_filter_packet);
+	}
+}
@@ -4,6 +4,11 @@
 //-- includes -----
 #include "PoseFilterInterface.h"
 #include "DeviceInterface.h"
+#include <vector>
+
+// -- pre-declarations --
+class OrientationFilterBatch;
+class OrientationFilterBatchLane;
 
 // -- constants --
 enum OrientationFilterType {
@@ -14,6 +19,7 @@ enum OrientationFilterType {
     OrientationFilterTypeComplementaryOpticalARG,
     OrientationFilterTypeComplementaryMARG,
 	OrientationFilterTypeKalman,
+	OrientationFilterTypeKalmanFloat,
 };
 
 enum PositionFilterType {
@@ -30,9 +36,14 @@ enum PositionFilterType {
 class CompoundPoseFilter : public IPoseFilter
 {
 public:
+    EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+
     CompoundPoseFilter() 
         : m_position_filter(nullptr)
         , m_orientation_filter(nullptr)
+        , m_orientation_batch_lane(nullptr)
+        , m_bHasPendingPositionUpdate(false)
+        , m_pending_position_delta_time(0.f)
     {}
     virtual ~CompoundPoseFilter()
     { dispose_filters(); }
@@ -41,14 +52,16 @@ public:
 		const CommonDeviceState::eDeviceType deviceType,
         const OrientationFilterType orientationFilterType, 
         const PositionFilterType positionFilterType,
-        const PoseFilterConstants &constant);
+        const PoseFilterConstants &constant,
+        OrientationFilterBatch *orientation_batch = nullptr);
 	bool init(
 		const CommonDeviceState::eDeviceType deviceType,
 		const OrientationFilterType orientationFilterType,
 		const PositionFilterType positionFilterType,
 		const PoseFilterConstants &constant,
 		const Eigen::Vector3f &initial_position,
-		const Eigen::Quaternionf &initial_orientation);
+		const Eigen::Quaternionf &initial_orientation,
+		OrientationFilterBatch *orientation_batch = nullptr);
 
     // -- IStateFilter --
     bool getIsStateValid() const override;
@@ -56,6 +69,9 @@ public:
     void update(const float delta_time, const PoseFilterPacket &packet) override;
     void resetState() override;
 	void recenterOrientation(const Eigen::Quaternionf& q_pose) override;
+    bool allocateStateHistory(const int state_count) override;
+    void saveState(const int state_index) override;
+    void restoreState(const int state_index) override;
 
     // -- IPoseFilter ---
     bool getIsPositionStateValid() const override;
@@ -66,18 +82,32 @@ public:
     Eigen::Vector3f getPositionCm(float time = 0.f) const override;
     Eigen::Vector3f getVelocityCmPerSec() const override;
     Eigen::Vector3f getAccelerationCmPerSecSqr() const override;
+    bool getIsBatched() const override;
+    void completeBatchedUpdate() override;
 
 protected:
 	void allocate_filters(
 		const CommonDeviceState::eDeviceType deviceType,
 		const OrientationFilterType orientationFilterType,
 		const PositionFilterType positionFilterType,
-		const PoseFilterConstants &constant);
+		const PoseFilterConstants &constant,
+		OrientationFilterBatch *orientation_batch);
     void dispose_filters();
+    void complete_pending_position_update();
 
     IPositionFilter *m_position_filter;
     IOrientationFilter *m_orientation_filter;
+
+    // Set when the orientation filter runs on a lane of a shared OrientationFilterBatch.
+    // While the lane's IMU update is staged in the batch the position update waits for it
+    // (until completeBatchedUpdate()), since the position filter needs the updated orientation.
+    OrientationFilterBatchLane *m_orientation_batch_lane;
+    bool m_bHasPendingPositionUpdate;
+    PoseFilterPacket m_pending_position_packet;
+    float m_pending_position_delta_time;
+
     double m_time;
+    std::vector<double> m_time_history;
 };
 
 #endif // COMPOUND_POSE_FILTER_H
\ No newline at end of file
@@ -2,6 +2,8 @@
 #include "KalmanOrientationFilter.h"
 #include "MathAlignment.h"
 
+#include <vector>
+
 #include <kalman/MeasurementModel.hpp>
 #include <kalman/SystemModel.hpp>
 #include <kalman/SquareRootBase.hpp>
@@ -83,25 +85,24 @@ public:
 	{
 		OrientationStateVector<T> result= OrientationStateVector<T>::Zero();
 
-		result[ERROR_QUATERNION_W] = 1.0;
+		result[ERROR_QUATERNION_W] = T(1);
 
 		return result;
 	}
 
     // Accessors
-	Eigen::Quaterniond get_error_quaterniond() const {
-		return Eigen::Quaterniond((*this)[ERROR_QUATERNION_W], (*this)[ERROR_QUATERNION_X], (*this)[ERROR_QUATERNION_Y], (*this)[ERROR_QUATERNION_Z]);
+	Eigen::Quaternion<T> get_error_quaternion() const {
+		return Eigen::Quaternion<T>((*this)[ERROR_QUATERNION_W], (*this)[ERROR_QUATERNION_X], (*this)[ERROR_QUATERNION_Y], (*this)[ERROR_QUATERNION_Z]);
 	}
 
     // Mutators
-	void set_error_quaterniond(const Eigen::Quaterniond &q) {
+	void set_error_quaternion(const Eigen::Quaternion<T> &q) {
 		(*this)[ERROR_QUATERNION_W] = q.w();
 		(*this)[ERROR_QUATERNION_X] = q.x();
 		(*this)[ERROR_QUATERNION_Y] = q.y();
 		(*this)[ERROR_QUATERNION_Z] = q.z();
 	}
 };
-typedef OrientationStateVector<double> OrientationStateVectord;
 
 template<typename T>
 class OrientationControlVector : public Kalman::Vector<T, CONTROL_PARAMETER_COUNT>
@@ -110,18 +111,17 @@ public:
 	KALMAN_VECTOR(OrientationControlVector, T, CONTROL_PARAMETER_COUNT)
 
     // Accessors
-	Eigen::Vector3d get_angular_rates() const {
-		return Eigen::Vector3d((*this)[CONTROL_GYROSCOPE_PITCH], (*this)[CONTROL_GYROSCOPE_YAW], (*this)[CONTROL_GYROSCOPE_ROLL]);
+	Eigen::Matrix<T, 3, 1> get_angular_rates() const {
+		return Eigen::Matrix<T, 3, 1>((*this)[CONTROL_GYROSCOPE_PITCH], (*this)[CONTROL_GYROSCOPE_YAW], (*this)[CONTROL_GYROSCOPE_ROLL]);
 	}
 
     // Mutators
-	void set_angular_rates(const Eigen::Vector3d &v) {
+	void set_angular_rates(const Eigen::Matrix<T, 3, 1> &v) {
 		(*this)[CONTROL_GYROSCOPE_PITCH] = v.x();
 		(*this)[CONTROL_GYROSCOPE_YAW] = v.y();
 		(*this)[CONTROL_GYROSCOPE_ROLL] = v.z();
 	}
 };
-typedef OrientationControlVector<double> OrientationControlVectord;
 
 /**
 * @brief System model for a controller
@@ -129,15 +129,19 @@ typedef OrientationControlVector<double> OrientationControlVectord;
 * This is the system model defining how a controller advances from one
 * time-step to the next, i.e. how the system state evolves over time.
 */
-class OrientationSystemModel : public Kalman::SystemModel<OrientationStateVectord, OrientationControlVectord, Kalman::SquareRootBase>
+template<typename T>
+class OrientationSystemModel : public Kalman::SystemModel<OrientationStateVector<T>, OrientationControlVector<T>, Kalman::SquareRootBase>
 {
 public:
-	inline void set_time_step(const double dt) { m_time_step = dt; }
+	typedef OrientationStateVector<T> StateVector;
+	typedef OrientationControlVector<T> ControlVector;
+
+	inline void set_time_step(const double dt) { m_time_step = static_cast<T>(dt); }
 
 	void init(const OrientationFilterConstants &constants)
 	{
 		m_last_tracking_projection_area = -1.f;
-		m_gyro_bias= constants.gyro_drift.cast<double>();
+		m_gyro_bias= constants.gyro_drift.cast<T>();
 		update_process_noise(constants, 0.f);
 	}
 
@@ -154,12 +158,12 @@ public:
 			// Initialize the process covariance matrix Q
 			const float mean_orientation_dT = constants.mean_update_time_delta;
 			const float discrete_variance= orientation_variance*mean_orientation_dT*mean_orientation_dT;
-			Kalman::Covariance<OrientationStateVectord> Q = Kalman::Covariance<OrientationStateVectord>::Zero();
+			Kalman::Covariance<StateVector> Q = Kalman::Covariance<StateVector>::Zero();
 			Q(0,0) = discrete_variance;
 			Q(1,1) = discrete_variance;
 			Q(2,2) = discrete_variance;
 			Q(3,3) = discrete_variance;
-			setCovariance(Q);
+			this->setCovariance(Q);
 
 			// Keep track last tracking projection area we built the covariance matrix for
 			m_last_tracking_projection_area = tracking_projection_area;
@@ -178,44 +182,52 @@ public:
 	* @param [in] u The control vector input
 	* @returns The (predicted) system state in the next time-step
 	*/
-	OrientationStateVectord f(const OrientationStateVectord& old_state, const OrientationControlVectord& control) const
+	StateVector f(const StateVector& old_state, const ControlVector& control) const
 	{
 		// Extract quaternion from the old state
-		const Eigen::Quaterniond error_q_old = old_state.get_error_quaterniond();
+		const Eigen::Quaternion<T> error_q_old = old_state.get_error_quaternion();
 
 		// Compute the true angular rate from the control vector
-		const Eigen::Vector3d omega= control - m_gyro_bias;
+		const Eigen::Matrix<T, 3, 1> omega= control - m_gyro_bias;
 
 		// Compute the quaternion derivative of the current state
 		// q_new= q + q_dot*dT
-		const Eigen::Quaterniond q_dot = eigen_angular_velocity_to_quaterniond_derivative(error_q_old, omega);
-		const Eigen::Quaterniond error_q_step = Eigen::Quaterniond(q_dot.coeffs() * m_time_step);
-		const Eigen::Quaterniond error_q_new = Eigen::Quaterniond(error_q_old.coeffs() + error_q_step.coeffs());
+		const Eigen::Quaternion<T> q_dot = eigen_angular_velocity_to_quaternion_derivative_t(error_q_old, omega);
+		const Eigen::Quaternion<T> error_q_step = Eigen::Quaternion<T>(q_dot.coeffs() * m_time_step);
+		const Eigen::Quaternion<T> error_q_new = Eigen::Quaternion<T>(error_q_old.coeffs() + error_q_step.coeffs());
 
 		// Save results to the new state
-		OrientationStateVectord new_state;
-		new_state.set_error_quaterniond(error_q_new.normalized());
+		StateVector new_state;
+		new_state.set_error_quaternion(error_q_new.normalized());
 
 		return new_state;
 	}
 
 protected:
-	double m_time_step;
+	T m_time_step;
 	float m_last_tracking_projection_area;
-	Eigen::Vector3d m_gyro_bias;
+	Eigen::Matrix<T, 3, 1> m_gyro_bias;
 };
 
-class OrientationSRUKF : public Kalman::SquareRootUnscentedKalmanFilter<OrientationStateVectord>
+template<typename T>
+class OrientationSRUKF : public Kalman::SquareRootUnscentedKalmanFilter<OrientationStateVector<T> >
 {
 public:
-	OrientationSRUKF(double alpha = 1.0, double beta = 2.0, double kappa = 0.0)
-		: Kalman::SquareRootUnscentedKalmanFilter<OrientationStateVectord>(alpha, beta, kappa)
+	typedef Kalman::SquareRootUnscentedKalmanFilter<OrientationStateVector<T> > Base;
+
+	OrientationSRUKF(T alpha = T(1), T beta = T(2), T kappa = T(0))
+		: Base(alpha, beta, kappa)
 	{
 	}
 
-	State& getStateMutable()
+	typename Base::State& getStateMutable()
 	{
-		return x;
+		return this->x;
+	}
+
+	Kalman::CovarianceSquareRoot<OrientationStateVector<T> >& getCovarianceSquareRootMutable()
+	{
+		return this->S;
 	}
 };
 
@@ -226,39 +238,42 @@ public:
 	KALMAN_VECTOR(GravMeasurementVector, T, G_MEASUREMENT_PARAMETER_COUNT)
 
 	// Accessors
-	Eigen::Vector3d get_accelerometer() const {
-		return Eigen::Vector3d((*this)[ACCELEROMETER_X], (*this)[ACCELEROMETER_Y], (*this)[ACCELEROMETER_Z]);
+	Eigen::Matrix<T, 3, 1> get_accelerometer() const {
+		return Eigen::Matrix<T, 3, 1>((*this)[ACCELEROMETER_X], (*this)[ACCELEROMETER_Y], (*this)[ACCELEROMETER_Z]);
 	}
 
 	// Mutators
-	void set_accelerometer(const Eigen::Vector3d &a) {
+	void set_accelerometer(const Eigen::Matrix<T, 3, 1> &a) {
 		(*this)[ACCELEROMETER_X] = a.x(); (*this)[ACCELEROMETER_Y] = a.y(); (*this)[ACCELEROMETER_Z] = a.z();
 	}
 };
-typedef GravMeasurementVector<double> GravMeasurementVectord;
 
+template<typename T>
 class GravMeasurementModel : 
-	public Kalman::MeasurementModel<OrientationStateVectord, GravMeasurementVectord, Kalman::SquareRootBase>
+	public Kalman::MeasurementModel<OrientationStateVector<T>, GravMeasurementVector<T>, Kalman::SquareRootBase>
 {
 public:
+	typedef OrientationStateVector<T> StateVector;
+	typedef GravMeasurementVector<T> MeasurementVector;
+
 	void init(const OrientationFilterConstants &constants)
 	{
 		// Update the measurement covariance R
-		Kalman::Covariance<GravMeasurementVectord> R =
-			Kalman::Covariance<GravMeasurementVectord>::Zero();
+		Kalman::Covariance<MeasurementVector> R =
+			Kalman::Covariance<MeasurementVector>::Zero();
 
 		// Only diagonals used so no need to compute Cholesky
 		static float r_accelerometer_scale = R_SCALE;
 		R(ACCELEROMETER_X, ACCELEROMETER_X) = r_accelerometer_scale*constants.accelerometer_variance.x();
 		R(ACCELEROMETER_Y, ACCELEROMETER_Y) = r_accelerometer_scale*constants.accelerometer_variance.y();
 		R(ACCELEROMETER_Z, ACCELEROMETER_Z) = r_accelerometer_scale*constants.accelerometer_variance.z();
-		setCovariance(R);
+		this->setCovariance(R);
 
-		identity_gravity_direction = constants.gravity_calibration_direction.cast<double>();
-		m_last_world_orientation = Eigen::Quaterniond::Identity();
+		identity_gravity_direction = constants.gravity_calibration_direction.cast<T>();
+		m_last_world_orientation = Eigen::Quaternion<T>::Identity();
 	}
 
-	void update_world_orientation(const Eigen::Quaterniond &orientation)
+	void update_world_orientation(const Eigen::Quaternion<T> &orientation)
 	{
 		m_last_world_orientation = orientation;
 	}
@@ -273,21 +288,21 @@ public:
 	* @param [in] x The system state in current time-step
 	* @returns The (predicted) sensor measurement for the system state
 	*/
-	GravMeasurementVectord h(const OrientationStateVectord& x) const
+	MeasurementVector h(const StateVector& x) const
 	{
-		GravMeasurementVectord predicted_measurement;
+		MeasurementVector predicted_measurement;
 
 		// Use the orientation from the state for prediction
-		const Eigen::Quaterniond error_orientation = x.get_error_quaterniond();
-		const Eigen::Quaterniond world_to_local_orientation = eigen_quaternion_concatenate(m_last_world_orientation, error_orientation).normalized();
+		const Eigen::Quaternion<T> error_orientation = x.get_error_quaternion();
+		const Eigen::Quaternion<T> world_to_local_orientation = eigen_quaternion_concatenate(m_last_world_orientation, error_orientation).normalized();
 
 		// Use the current linear acceleration from last frame's state (###HipsterSloth $TODO Skews controller too much)
 		// and the current orientation from the state to predict
 		// what the accelerometer reading will be (in the space of the controller)
-		const Eigen::Vector3d &gravity_accel_g_units = identity_gravity_direction;
-		const Eigen::Vector3d linear_accel_g_units = Eigen::Vector3d::Zero(); //m_last_world_linear_acceleration * k_ms2_to_g_units;
-		const Eigen::Vector3d accel_world = linear_accel_g_units + gravity_accel_g_units;
-		const Eigen::Vector3d accel_local = eigen_vector3d_clockwise_rotate(world_to_local_orientation, accel_world);
+		const Eigen::Matrix<T, 3, 1> &gravity_accel_g_units = identity_gravity_direction;
+		const Eigen::Matrix<T, 3, 1> linear_accel_g_units = Eigen::Matrix<T, 3, 1>::Zero(); //m_last_world_linear_acceleration * k_ms2_to_g_units;
+		const Eigen::Matrix<T, 3, 1> accel_world = linear_accel_g_units + gravity_accel_g_units;
+		const Eigen::Matrix<T, 3, 1> accel_local = eigen_vector3_clockwise_rotate(world_to_local_orientation, accel_world);
 
 		// Save the predictions into the measurement vector
 		predicted_measurement.set_accelerometer(accel_local);
@@ -296,8 +311,10 @@ public:
 	}
 
 public:
-	Eigen::Vector3d identity_gravity_direction;
-	Eigen::Quaterniond m_last_world_orientation;
+	EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+
+	Eigen::Matrix<T, 3, 1> identity_gravity_direction;
+	Eigen::Quaternion<T> m_last_world_orientation;
 };
 
 template<typename T>
@@ -307,32 +324,35 @@ public:
 	KALMAN_VECTOR(MagGravMeasurementVector, T, MG_MEASUREMENT_PARAMETER_COUNT)
 
 	// Accessors
-	Eigen::Vector3d get_accelerometer() const {
-		return Eigen::Vector3d((*this)[ACCELEROMETER_X], (*this)[ACCELEROMETER_Y], (*this)[ACCELEROMETER_Z]);
+	Eigen::Matrix<T, 3, 1> get_accelerometer() const {
+		return Eigen::Matrix<T, 3, 1>((*this)[ACCELEROMETER_X], (*this)[ACCELEROMETER_Y], (*this)[ACCELEROMETER_Z]);
 	}
-	Eigen::Vector3d get_magnetometer() const {
-		return Eigen::Vector3d((*this)[MAGNETOMETER_X], (*this)[MAGNETOMETER_Y], (*this)[MAGNETOMETER_Z]);
+	Eigen::Matrix<T, 3, 1> get_magnetometer() const {
+		return Eigen::Matrix<T, 3, 1>((*this)[MAGNETOMETER_X], (*this)[MAGNETOMETER_Y], (*this)[MAGNETOMETER_Z]);
 	}
 
 	// Mutators
-	void set_accelerometer(const Eigen::Vector3d &a) {
+	void set_accelerometer(const Eigen::Matrix<T, 3, 1> &a) {
 		(*this)[ACCELEROMETER_X] = a.x(); (*this)[ACCELEROMETER_Y] = a.y(); (*this)[ACCELEROMETER_Z] = a.z();
 	}
-	void set_magnetometer(const Eigen::Vector3d &m) {
+	void set_magnetometer(const Eigen::Matrix<T, 3, 1> &m) {
 		(*this)[MAGNETOMETER_X] = m.x(); (*this)[MAGNETOMETER_Y] = m.y(); (*this)[MAGNETOMETER_Z] = m.z();
 	}
 };
-typedef MagGravMeasurementVector<double> MagGravMeasurementVectord;
 
+template<typename T>
 class MagGravMeasurementModel : 
-	public Kalman::MeasurementModel<OrientationStateVectord, MagGravMeasurementVectord, Kalman::SquareRootBase>
+	public Kalman::MeasurementModel<OrientationStateVector<T>, MagGravMeasurementVector<T>, Kalman::SquareRootBase>
 {
 public:
+	typedef OrientationStateVector<T> StateVector;
+	typedef MagGravMeasurementVector<T> MeasurementVector;
+
 	void init(const OrientationFilterConstants &constants)
 	{
 		// Update the measurement covariance R
-		Kalman::Covariance<MagGravMeasurementVectord> R =
-			Kalman::Covariance<MagGravMeasurementVectord>::Zero();
+		Kalman::Covariance<MeasurementVector> R =
+			Kalman::Covariance<MeasurementVector>::Zero();
 
 		// Only diagonals used so no need to compute Cholesky
 		static float r_accelerometer_scale = R_SCALE;
@@ -343,14 +363,14 @@ public:
 		R(MAGNETOMETER_X, MAGNETOMETER_X) = r_magnetometer_scale*constants.magnetometer_variance.x();
 		R(MAGNETOMETER_Y, MAGNETOMETER_Y) = r_magnetometer_scale*constants.magnetometer_variance.y();
 		R(MAGNETOMETER_Z, MAGNETOMETER_Z) = r_magnetometer_scale*constants.magnetometer_variance.z();
-		setCovariance(R);
+		this->setCovariance(R);
 
-		identity_gravity_direction = constants.gravity_calibration_direction.cast<double>();
-		identity_magnetometer_direction = constants.magnetometer_calibration_direction.cast<double>();
-		m_last_world_orientation = Eigen::Quaterniond::Identity();
+		identity_gravity_direction = constants.gravity_calibration_direction.cast<T>();
+		identity_magnetometer_direction = constants.magnetometer_calibration_direction.cast<T>();
+		m_last_world_orientation = Eigen::Quaternion<T>::Identity();
 	}
 
-	void update_world_orientation(const Eigen::Quaterniond &orientation)
+	void update_world_orientation(const Eigen::Quaternion<T> &orientation)
 	{
 		m_last_world_orientation = orientation;
 	}
@@ -365,26 +385,26 @@ public:
 	* @param [in] x The system state in current time-step
 	* @returns The (predicted) sensor measurement for the system state
 	*/
-	MagGravMeasurementVectord h(const OrientationStateVectord& x) const
+	MeasurementVector h(const StateVector& x) const
 	{
-		MagGravMeasurementVectord predicted_measurement;
+		MeasurementVector predicted_measurement;
 
 		// Use the orientation from the state for prediction
-		const Eigen::Quaterniond error_orientation = x.get_error_quaterniond();
-		const Eigen::Quaterniond world_to_local_orientation = eigen_quaternion_concatenate(m_last_world_orientation, error_orientation).normalized();
+		const Eigen::Quaternion<T> error_orientation = x.get_error_quaternion();
+		const Eigen::Quaternion<T> world_to_local_orientation = eigen_quaternion_concatenate(m_last_world_orientation, error_orientation).normalized();
 
 		// Use the current linear acceleration from last frame's state (###HipsterSloth $TODO Skews controller too much)
 		// and the current orientation from the state to predict
 		// what the accelerometer reading will be (in the space of the controller)
-		const Eigen::Vector3d &gravity_accel_g_units = identity_gravity_direction;
-		const Eigen::Vector3d linear_accel_g_units = Eigen::Vector3d::Zero(); //m_last_world_linear_acceleration * k_ms2_to_g_units;
-		const Eigen::Vector3d accel_world = linear_accel_g_units + gravity_accel_g_units;
-		const Eigen::Vector3d accel_local = eigen_vector3d_clockwise_rotate(world_to_local_orientation, accel_world);
+		const Eigen::Matrix<T, 3, 1> &gravity_accel_g_units = identity_gravity_direction;
+		const Eigen::Matrix<T, 3, 1> linear_accel_g_units = Eigen::Matrix<T, 3, 1>::Zero(); //m_last_world_linear_acceleration * k_ms2_to_g_units;
+		const Eigen::Matrix<T, 3, 1> accel_world = linear_accel_g_units + gravity_accel_g_units;
+		const Eigen::Matrix<T, 3, 1> accel_local = eigen_vector3_clockwise_rotate(world_to_local_orientation, accel_world);
 
 		// Use the orientation from the state to predict
 		// what the magnetometer reading should be (in the space of the controller)
-		const Eigen::Vector3d &mag_world = identity_magnetometer_direction;
-		const Eigen::Vector3d mag_local = eigen_vector3d_clockwise_rotate(world_to_local_orientation, mag_world);
+		const Eigen::Matrix<T, 3, 1> &mag_world = identity_magnetometer_direction;
+		const Eigen::Matrix<T, 3, 1> mag_local = eigen_vector3_clockwise_rotate(world_to_local_orientation, mag_world);
 
 		// Save the predictions into the measurement vector
 		predicted_measurement.set_accelerometer(accel_local);
@@ -394,10 +414,12 @@ public:
 	}
 
 public:
-	Eigen::Vector3d identity_gravity_direction;
-	Eigen::Vector3d identity_magnetometer_direction;
-	Eigen::Quaterniond m_last_world_orientation;
-	Eigen::Vector3d m_last_world_linear_acceleration_m_per_sec_sqr;
+	EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+
+	Eigen::Matrix<T, 3, 1> identity_gravity_direction;
+	Eigen::Matrix<T, 3, 1> identity_magnetometer_direction;
+	Eigen::Quaternion<T> m_last_world_orientation;
+	Eigen::Matrix<T, 3, 1> m_last_world_linear_acceleration_m_per_sec_sqr;
 };
 
 
@@ -408,8 +430,8 @@ public:
 	KALMAN_VECTOR(OrientationMeasurementVector, T, OPTICAL_MEASUREMENT_PARAMETER_COUNT)
 
     // Accessors
-	Eigen::Quaterniond get_optical_quaterniond() const {
-		return Eigen::Quaterniond(
+	Eigen::Quaternion<T> get_optical_quaternion() const {
+		return Eigen::Quaternion<T>(
 			(*this)[OPTICAL_QUATERNION_W], 
 			(*this)[OPTICAL_QUATERNION_X],
 			(*this)[OPTICAL_QUATERNION_Y], 
@@ -417,23 +439,26 @@ public:
 	}
 
     // Mutators
-	void set_optical_quaterniond(const Eigen::Quaterniond &q) {
+	void set_optical_quaternion(const Eigen::Quaternion<T> &q) {
 		(*this)[OPTICAL_QUATERNION_W] = q.w();
 		(*this)[OPTICAL_QUATERNION_X] = q.x();
 		(*this)[OPTICAL_QUATERNION_Y] = q.y();
 		(*this)[OPTICAL_QUATERNION_Z] = q.z();
 	}
 };
-typedef OrientationMeasurementVector<double> OrientationMeasurementVectord;
 
+template<typename T>
 class OpticalOrientationMeasurementModel
-	: public Kalman::MeasurementModel<OrientationStateVectord, OrientationMeasurementVectord, Kalman::SquareRootBase>
+	: public Kalman::MeasurementModel<OrientationStateVector<T>, OrientationMeasurementVector<T>, Kalman::SquareRootBase>
 {
 public:
+	typedef OrientationStateVector<T> StateVector;
+	typedef OrientationMeasurementVector<T> MeasurementVector;
+
 	void init(const OrientationFilterConstants &constants)
 	{
 		m_last_tracking_projection_area = -1.f;
-		m_last_world_orientation = Eigen::Quaterniond::Identity();
+		m_last_world_orientation = Eigen::Quaternion<T>::Identity();
 		update_measurement_statistics(constants, 0.f);
 	}
 
@@ -446,8 +471,8 @@ public:
 			!is_nearly_equal(tracking_projection_area, m_last_tracking_projection_area, 10.f))
 		{
 			// Update the measurement covariance R
-			Kalman::Covariance<OrientationMeasurementVectord> R =
-				Kalman::Covariance<OrientationMeasurementVectord>::Zero();
+			Kalman::Covariance<MeasurementVector> R =
+				Kalman::Covariance<MeasurementVector>::Zero();
 			const float orientation_variance = constants.orientation_variance_curve.evaluate(tracking_projection_area);
 
 			static float r_scale = R_SCALE;
@@ -455,14 +480,14 @@ public:
 			R(OPTICAL_QUATERNION_X, OPTICAL_QUATERNION_X) = r_scale*orientation_variance;
 			R(OPTICAL_QUATERNION_Y, OPTICAL_QUATERNION_Y) = r_scale*orientation_variance;
 			R(OPTICAL_QUATERNION_Z, OPTICAL_QUATERNION_Z) = r_scale*orientation_variance;
-			setCovariance(R);
+			this->setCovariance(R);
 
 			// Keep track last tracking projection area we built the covariance matrix for
 			m_last_tracking_projection_area = tracking_projection_area;
 		}
 	}
 
-	void update_world_orientation(const Eigen::Quaterniond &orientation)
+	void update_world_orientation(const Eigen::Quaternion<T> &orientation)
 	{
 		m_last_world_orientation = orientation;
 	}
@@ -477,25 +502,42 @@ public:
 	* @param [in] x The system state in current time-step
 	* @returns The (predicted) sensor measurement for the system state
 	*/
-	OrientationMeasurementVectord h(const OrientationStateVectord& x) const
+	MeasurementVector h(const StateVector& x) const
 	{
-		OrientationMeasurementVectord predicted_measurement;
+		MeasurementVector predicted_measurement;
 
 		// Use the orientation from the state for prediction
-		const Eigen::Quaterniond error_orientation = x.get_error_quaterniond();
-		const Eigen::Quaterniond world_to_local_orientation = eigen_quaternion_concatenate(m_last_world_orientation, error_orientation).normalized();
+		const Eigen::Quaternion<T> error_orientation = x.get_error_quaternion();
+		const Eigen::Quaternion<T> world_to_local_orientation = eigen_quaternion_concatenate(m_last_world_orientation, error_orientation).normalized();
 
 		// Save the predictions into the measurement vector
-		predicted_measurement.set_optical_quaterniond(world_to_local_orientation);
+		predicted_measurement.set_optical_quaternion(world_to_local_orientation);
 
 		return predicted_measurement;
 	}
 
 public:
+	EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+
 	float m_last_tracking_projection_area;
-	Eigen::Quaterniond m_last_world_orientation;
+	Eigen::Quaternion<T> m_last_world_orientation;
+};
+
+/// A copy of the state of a TKalmanOrientationFilterImpl, used to rewind the filter
+template<typename T>
+struct KalmanOrientationFilterSnapshot
+{
+	EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+
+	bool bIsValid;
+	bool bSeenOrientationMeasurement;
+	OrientationStateVector<T> state;
+	Kalman::CovarianceSquareRoot<OrientationStateVector<T> > covariance_square_root;
+	double time;
+	Eigen::Quaternion<T> world_orientation;
 };
 
+/// Scalar type independent interface to the filter implementation used by KalmanOrientationFilter
 class KalmanOrientationFilterImpl
 {
 public:
@@ -505,85 +547,168 @@ public:
 	/// True if we have seen a valid orientation measurement (>0 orientation quality)
 	bool bSeenOrientationMeasurement;
 
+    double time;
+
+	KalmanOrientationFilterImpl()
+		: bIsValid(false)
+		, bSeenOrientationMeasurement(false)
+		, time(0.0)
+	{
+	}
+
+	virtual ~KalmanOrientationFilterImpl()
+	{
+	}
+
+	virtual void init(const OrientationFilterConstants &constants) = 0;
+	virtual void init(const OrientationFilterConstants &constants, const Eigen::Quaternionf &orientation) = 0;
+	virtual void update(const float delta_time, const PoseFilterPacket &packet) = 0;
+
+	virtual Eigen::Quaternionf get_world_quaternion() const = 0;
+	virtual void recenter(const Eigen::Quaternionf &q_pose) = 0;
+
+	virtual void allocate_state_history(const int state_count) = 0;
+	virtual void save_state(const int state_index) = 0;
+	virtual void restore_state(const int state_index) = 0;
+};
+
+/// The filter state and UKF math for the scalar type T (double or float)
+template<typename T>
+class TKalmanOrientationFilterImpl : public KalmanOrientationFilterImpl
+{
+public:
+	EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+
+	typedef OrientationStateVector<T> StateVector;
+	typedef OrientationControlVector<T> ControlVector;
+	typedef KalmanOrientationFilterSnapshot<T> Snapshot;
+
     /// Used to model how the physics of the controller evolves
-    OrientationSystemModel system_model;
+    OrientationSystemModel<T> system_model;
 
     /// Unscented Kalman Filter instance
-	OrientationSRUKF ukf;
-
-    double time;
+	OrientationSRUKF<T> ukf;
 
 	/// The final output of this filter.
 	/// This isn't part of the UKF state vector because it's non-linear.
 	/// Instead we store "error euler angles" in the UKF state vector and then apply it 
 	/// to this quaternion after a time step and then zero out the error.
-	Eigen::Quaterniond world_orientation;
+	Eigen::Quaternion<T> world_orientation;
 
-	KalmanOrientationFilterImpl()
-		: bIsValid(false)
-		, bSeenOrientationMeasurement(false)
+	/// Saved filter states used to rewind the filter
+	std::vector<Snapshot, Eigen::aligned_allocator<Snapshot> > state_history;
+
+	TKalmanOrientationFilterImpl()
+		: KalmanOrientationFilterImpl()
 		, system_model()
-		, ukf(k_ukf_alpha, k_ukf_beta, k_ukf_kappa)
-        , world_orientation(Eigen::Quaternionf::Identity())
-        , time(0.0)
+		, ukf(T(k_ukf_alpha), T(k_ukf_beta), T(k_ukf_kappa))
+        , world_orientation(Eigen::Quaternion<T>::Identity())
     {
     }
 
-    virtual void init(const OrientationFilterConstants &constants)
+    void init(const OrientationFilterConstants &constants) override
     {
 		bIsValid = false;
 		bSeenOrientationMeasurement = false;
 
-		world_orientation = Eigen::Quaterniond::Identity();
+		world_orientation = Eigen::Quaternion<T>::Identity();
 
         system_model.init(constants);
-        ukf.init(OrientationStateVectord::Identity());
+        ukf.init(StateVector::Identity());
     }
 
-	virtual void init(
+	void init(
 		const OrientationFilterConstants &constants,
-		const Eigen::Quaternionf &orientation)
+		const Eigen::Quaternionf &orientation) override
 	{
 		bIsValid = true;
 		bSeenOrientationMeasurement = true;
 
-		world_orientation = orientation.cast<double>();
+		world_orientation = orientation.cast<T>();
 
 		system_model.init(constants);
-		ukf.init(OrientationStateVectord::Identity());
+		ukf.init(StateVector::Identity());
 		apply_error_to_world_quaternion();
 	}
 
 	// -- World Quaternion Accessors --
-	inline Eigen::Quaterniond compute_net_world_quaternion() const
+	inline Eigen::Quaternion<T> compute_net_world_quaternion() const
 	{
-		const Eigen::Quaterniond error_quaternion= ukf.getState().get_error_quaterniond();
-		const Eigen::Quaterniond output_quaternion = eigen_quaternion_concatenate(world_orientation, error_quaternion).normalized();
+		const Eigen::Quaternion<T> error_quaternion= ukf.getState().get_error_quaternion();
+		const Eigen::Quaternion<T> output_quaternion = eigen_quaternion_concatenate(world_orientation, error_quaternion).normalized();
 		return output_quaternion;
 	}
 
+	Eigen::Quaternionf get_world_quaternion() const override
+	{
+		return compute_net_world_quaternion().template cast<float>();
+	}
+
 	// -- World Quaternion Mutators --
-	inline void set_world_quaternion(const Eigen::Quaterniond &orientation)
+	inline void set_world_quaternion(const Eigen::Quaternion<T> &orientation)
 	{
 		world_orientation = orientation;
-		ukf.getStateMutable().set_error_quaterniond(Eigen::Quaterniond::Identity());
+		ukf.getStateMutable().set_error_quaternion(Eigen::Quaternion<T>::Identity());
 	}
 
 	void apply_error_to_world_quaternion()
 	{
 		set_world_quaternion(compute_net_world_quaternion());
 	}
+
+	void recenter(const Eigen::Quaternionf &q_pose) override
+	{
+		world_orientation = q_pose.cast<T>();
+		ukf.init(StateVector::Identity());
+	}
+
+	// -- State History --
+	void allocate_state_history(const int state_count) override
+	{
+		state_history.resize(state_count);
+	}
+
+	void save_state(const int state_index) override
+	{
+		assert(state_index >= 0 && state_index < static_cast<int>(state_history.size()));
+		Snapshot &snapshot= state_history[state_index];
+
+		snapshot.bIsValid= bIsValid;
+		snapshot.bSeenOrientationMeasurement= bSeenOrientationMeasurement;
+		snapshot.state= ukf.getState();
+		snapshot.covariance_square_root= ukf.getCovarianceSquareRoot();
+		snapshot.time= time;
+		snapshot.world_orientation= world_orientation;
+	}
+
+	void restore_state(const int state_index) override
+	{
+		assert(state_index >= 0 && state_index < static_cast<int>(state_history.size()));
+		const Snapshot &snapshot= state_history[state_index];
+
+		bIsValid= snapshot.bIsValid;
+		bSeenOrientationMeasurement= snapshot.bSeenOrientationMeasurement;
+		ukf.getStateMutable()= snapshot.state;
+		ukf.getCovarianceSquareRootMutable()= snapshot.covariance_square_root;
+		time= snapshot.time;
+		world_orientation= snapshot.world_orientation;
+	}
 };
 
-class PSVRKalmanPoseFilterImpl : public KalmanOrientationFilterImpl
+template<typename T>
+class PSVRKalmanOrientationFilterImpl : public TKalmanOrientationFilterImpl<T>
 {
 public:
-	GravMeasurementModel imu_measurement_model;
-	OpticalOrientationMeasurementModel optical_measurement_model;
+	typedef TKalmanOrientationFilterImpl<T> Super;
+	typedef typename Super::StateVector StateVector;
+	typedef typename Super::ControlVector ControlVector;
+
+	GravMeasurementModel<T> imu_measurement_model;
+	OpticalOrientationMeasurementModel<T> optical_measurement_model;
 
 	void init(const OrientationFilterConstants &constants) override
 	{
-		KalmanOrientationFilterImpl::init(constants);
+		Super::init(constants);
 		imu_measurement_model.init(constants);
 		optical_measurement_model.init(constants);
 	}
@@ -592,21 +717,101 @@ public:
 		const OrientationFilterConstants &constants,
 		const Eigen::Quaternionf &orientation) override
 	{
-		KalmanOrientationFilterImpl::init(constants, orientation);
+		Super::init(constants, orientation);
 		imu_measurement_model.init(constants);
 		optical_measurement_model.init(constants);
 	}
+
+	void restore_state(const int state_index) override
+	{
+		Super::restore_state(state_index);
+
+		// The measurement models predict from the orientation of the restored state
+		imu_measurement_model.update_world_orientation(this->world_orientation);
+		optical_measurement_model.update_world_orientation(this->world_orientation);
+	}
+
+	void update(const float delta_time, const PoseFilterPacket &packet) override
+	{
+		if (this->bIsValid)
+		{
+			// Predict state for current time-step using the filters
+			this->system_model.set_time_step(delta_time);
+
+			if (packet.has_imu_measurements())
+			{
+				ControlVector control;
+				control.set_angular_rates(packet.imu_gyroscope_rad_per_sec.cast<T>());
+
+				this->ukf.predict(this->system_model, control);
+			}
+			else
+			{
+				this->ukf.predict(this->system_model);
+			}
+
+			// Apply any optical measurement to the filter
+			if (packet.has_optical_measurement())
+			{
+				assert(packet.tracking_projection_area_px_sqr > 0.f);
+				Eigen::Quaternion<T> optical_orientation= packet.optical_orientation.cast<T>();
+
+				// If this is the first time we have seen an orientation measurement, 
+				// snap the orientation state to a best fit alignment of the sensor measurements.
+				if (!this->bSeenOrientationMeasurement)
+				{
+					optical_measurement_model.update_world_orientation(optical_orientation);
+					imu_measurement_model.update_world_orientation(optical_orientation);
+					this->set_world_quaternion(optical_orientation);
+					this->bSeenOrientationMeasurement = true;
+				}
+
+				OrientationMeasurementVector<T> measurement = OrientationMeasurementVector<T>::Zero();
+				measurement.set_optical_quaternion(optical_orientation);
+				this->ukf.update(optical_measurement_model, measurement);
+			}
+
+			// Apply any IMU measurement to the filter
+			if (packet.has_imu_measurements())
+			{
+				assert(packet.has_accelerometer_measurement);
+
+				GravMeasurementVector<T> measurement = GravMeasurementVector<T>::Zero();
+				measurement.set_accelerometer(packet.imu_accelerometer_g_units.cast<T>());
+				this->ukf.update(imu_measurement_model, measurement);
+			}
+
+			// Apply the orientation error in the UKF state to the output quaternion.
+			// Zero out the error in the UKF state vector.
+			this->apply_error_to_world_quaternion();
+
+			// Update the measurement model with the latest estimate of the orientation (without error)
+			// so that we can predict what the controller relative sensor measurements will be
+			optical_measurement_model.update_world_orientation(this->world_orientation);
+			imu_measurement_model.update_world_orientation(this->world_orientation);
+		}
+		else
+		{
+			this->ukf.init(StateVector::Identity());
+			this->bIsValid= true;
+		}
+	}
 };
 
-class DS4KalmanOrientationFilterImpl : public KalmanOrientationFilterImpl
+template<typename T>
+class DS4KalmanOrientationFilterImpl : public TKalmanOrientationFilterImpl<T>
 {
 public:
-	GravMeasurementModel imu_measurement_model;
-	OpticalOrientationMeasurementModel optical_measurement_model;
+	typedef TKalmanOrientationFilterImpl<T> Super;
+	typedef typename Super::StateVector StateVector;
+	typedef typename Super::ControlVector ControlVector;
+
+	GravMeasurementModel<T> imu_measurement_model;
+	OpticalOrientationMeasurementModel<T> optical_measurement_model;
 
 	void init(const OrientationFilterConstants &constants) override
 	{
-		KalmanOrientationFilterImpl::init(constants);
+		Super::init(constants);
 		imu_measurement_model.init(constants);
 		optical_measurement_model.init(constants);
 	}
@@ -615,21 +820,101 @@ public:
 		const OrientationFilterConstants &constants,
 		const Eigen::Quaternionf &orientation) override
 	{
-		KalmanOrientationFilterImpl::init(constants, orientation);
+		Super::init(constants, orientation);
 		imu_measurement_model.init(constants);
 		optical_measurement_model.init(constants);
 	}
+
+	void restore_state(const int state_index) override
+	{
+		Super::restore_state(state_index);
+
+		// The measurement models predict from the orientation of the restored state
+		imu_measurement_model.update_world_orientation(this->world_orientation);
+		optical_measurement_model.update_world_orientation(this->world_orientation);
+	}
+
+	void update(const float delta_time, const PoseFilterPacket &packet) override
+	{
+		if (this->bIsValid)
+		{
+			// Predict state for current time-step using the filters
+			this->system_model.set_time_step(delta_time);
+
+			if (packet.has_imu_measurements())
+			{
+				ControlVector control;
+				control.set_angular_rates(packet.imu_gyroscope_rad_per_sec.cast<T>());
+
+				this->ukf.predict(this->system_model, control);
+			}
+			else
+			{
+				this->ukf.predict(this->system_model);
+			}
+
+			// Apply any optical measurement to the filter
+			if (packet.has_optical_measurement())
+			{
+				assert(packet.tracking_projection_area_px_sqr > 0.f);
+				Eigen::Quaternion<T> optical_orientation= packet.optical_orientation.cast<T>();
+
+				// If this is the first time we have seen an orientation measurement, 
+				// snap the orientation state to a best fit alignment of the sensor measurements.
+				if (!this->bSeenOrientationMeasurement)
+				{
+					optical_measurement_model.update_world_orientation(optical_orientation);
+					imu_measurement_model.update_world_orientation(optical_orientation);
+					this->set_world_quaternion(optical_orientation);
+					this->bSeenOrientationMeasurement = true;
+				}
+
+				OrientationMeasurementVector<T> measurement = OrientationMeasurementVector<T>::Zero();
+				measurement.set_optical_quaternion(optical_orientation);
+				this->ukf.update(optical_measurement_model, measurement);
+			}
+
+			// Apply any IMU measurement to the filter
+			if (packet.has_imu_measurements())
+			{
+				assert(packet.has_accelerometer_measurement);
+
+				GravMeasurementVector<T> measurement = GravMeasurementVector<T>::Zero();
+				measurement.set_accelerometer(packet.imu_accelerometer_g_units.cast<T>());
+				this->ukf.update(imu_measurement_model, measurement);
+			}
+
+			// Apply the orientation error in the UKF state to the output quaternion.
+			// Zero out the error in the UKF state vector.
+			this->apply_error_to_world_quaternion();
+
+			// Update the measurement model with the latest estimate of the orientation (without error)
+			// so that we can predict what the controller relative sensor measurements will be
+			optical_measurement_model.update_world_orientation(this->world_orientation);
+			imu_measurement_model.update_world_orientation(this->world_orientation);
+		}
+		else
+		{
+			this->ukf.init(StateVector::Identity());
+			this->bIsValid= true;
+		}
+	}
 };
 
-class PSMoveKalmanPoseFilterImpl : public KalmanOrientationFilterImpl
+template<typename T>
+class PSMoveKalmanOrientationFilterImpl : public TKalmanOrientationFilterImpl<T>
 {
 public:
-	MagGravMeasurementModel imu_measurement_model;
-	OpticalOrientationMeasurementModel optical_measurement_model;
+	typedef TKalmanOrientationFilterImpl<T> Super;
+	typedef typename Super::StateVector StateVector;
+	typedef typename Super::ControlVector ControlVector;
+
+	MagGravMeasurementModel<T> imu_measurement_model;
+	OpticalOrientationMeasurementModel<T> optical_measurement_model;
 
 	void init(const OrientationFilterConstants &constants) override
 	{
-		KalmanOrientationFilterImpl::init(constants);
+		Super::init(constants);
 		imu_measurement_model.init(constants);
 		optical_measurement_model.init(constants);
 	}
@@ -638,17 +923,103 @@ public:
 		const OrientationFilterConstants &constants,
 		const Eigen::Quaternionf &orientation) override
 	{
-		KalmanOrientationFilterImpl::init(constants, orientation);
+		Super::init(constants, orientation);
 		imu_measurement_model.init(constants);
 		optical_measurement_model.init(constants);
 	}
 
+	void restore_state(const int state_index) override
+	{
+		Super::restore_state(state_index);
+
+		// The measurement models predict from the orientation of the restored state
+		imu_measurement_model.update_world_orientation(this->world_orientation);
+		optical_measurement_model.update_world_orientation(this->world_orientation);
+	}
+
+	void update(const float delta_time, const PoseFilterPacket &packet) override
+	{
+		if (this->bIsValid)
+		{
+			// Predict state for current time-step using the filters
+			this->system_model.set_time_step(delta_time);
+
+			if (packet.has_imu_measurements())
+			{
+				ControlVector control;
+				control.set_angular_rates(packet.imu_gyroscope_rad_per_sec.cast<T>());
+
+				this->ukf.predict(this->system_model, control);
+			}
+			else
+			{
+				this->ukf.predict(this->system_model);
+			}
+
+			// Apply any optical measurement to the filter
+			if (packet.has_optical_measurement())
+			{
+				assert(packet.tracking_projection_area_px_sqr > 0.f);
+				Eigen::Quaternion<T> optical_orientation= packet.optical_orientation.cast<T>();
+
+				// If this is the first time we have seen an orientation measurement, 
+				// snap the orientation state to a best fit alignment of the sensor measurements.
+				if (!this->bSeenOrientationMeasurement)
+				{
+					optical_measurement_model.update_world_orientation(optical_orientation);
+					imu_measurement_model.update_world_orientation(optical_orientation);
+					this->set_world_quaternion(optical_orientation);
+					this->bSeenOrientationMeasurement = true;
+				}
+
+				OrientationMeasurementVector<T> measurement = OrientationMeasurementVector<T>::Zero();
+				measurement.set_optical_quaternion(optical_orientation);
+				this->ukf.update(optical_measurement_model, measurement);
+			}
+
+			// Apply any IMU measurement to the filter
+			if (packet.has_imu_measurements())
+			{
+				assert(packet.has_accelerometer_measurement);
+
+				MagGravMeasurementVector<T> measurement = MagGravMeasurementVector<T>::Zero();
+				measurement.set_accelerometer(packet.imu_accelerometer_g_units.cast<T>());
+				measurement.set_magnetometer(packet.imu_magnetometer_unit.cast<T>());
+				this->ukf.update(imu_measurement_model, measurement);
+			}
+
+			// Apply the orientation error in the UKF state to the output quaternion.
+			// Zero out the error in the UKF state vector.
+			this->apply_error_to_world_quaternion();
+
+			// Update the measurement model with the latest estimate of the orientation (without error)
+			// so that we can predict what the controller relative sensor measurements will be
+			optical_measurement_model.update_world_orientation(this->world_orientation);
+			imu_measurement_model.update_world_orientation(this->world_orientation);
+		}
+		else
+		{
+			this->ukf.init(StateVector::Identity());
+			this->bIsValid= true;
+		}
+	}
 };
 
+// The filter implementations come in double and float precision.
+// The float versions do roughly half the math work per update, at the cost of some numeric drift.
+template class PSVRKalmanOrientationFilterImpl<double>;
+template class PSVRKalmanOrientationFilterImpl<float>;
+template class DS4KalmanOrientationFilterImpl<double>;
+template class DS4KalmanOrientationFilterImpl<float>;
+template class PSMoveKalmanOrientationFilterImpl<double>;
+template class PSMoveKalmanOrientationFilterImpl<float>;
+
 //-- public interface --
 //-- KalmanOrientationFilter --
-KalmanOrientationFilter::KalmanOrientationFilter()
-    : m_filter(nullptr)
+KalmanOrientationFilter::KalmanOrientationFilter(const KalmanFilterScalarType scalar_type)
+    : m_scalar_type(scalar_type)
+    , m_filter(nullptr)
+    , m_state_history_count(0)
 {
     memset(&m_constants, 0, sizeof(OrientationFilterConstants));
 }
@@ -658,7 +1029,7 @@ KalmanOrientationFilter::~KalmanOrientationFilter()
     if (m_filter != nullptr)
     {
         delete m_filter;
-        m_filter;
+        m_filter= nullptr;
     }
 }
 
@@ -670,12 +1041,16 @@ bool KalmanOrientationFilter::init(const OrientationFilterConstants &constants)
     if (m_filter != nullptr)
     {
         delete m_filter;
-        m_filter;
+        m_filter= nullptr;
     }
 
 	// Create and initialize the private filter implementation
-    KalmanOrientationFilterImpl *filter = new KalmanOrientationFilterImpl();
+    KalmanOrientationFilterImpl *filter = allocate_filter();
     filter->init(constants);
+    if (m_state_history_count > 0)
+    {
+        filter->allocate_state_history(m_state_history_count);
+    }
     m_filter = filter;
 
     return true;
@@ -691,12 +1066,16 @@ bool KalmanOrientationFilter::init(
 	if (m_filter != nullptr)
 	{
 		delete m_filter;
-		m_filter;
+		m_filter= nullptr;
 	}
 
 	// Create and initialize the private filter implementation
-	KalmanOrientationFilterImpl *filter = new KalmanOrientationFilterImpl();
+	KalmanOrientationFilterImpl *filter = allocate_filter();
 	filter->init(constants, orientation);
+	if (m_state_history_count > 0)
+	{
+		filter->allocate_state_history(m_state_history_count);
+	}
 	m_filter = filter;
 
 	return true;
@@ -712,6 +1091,11 @@ double KalmanOrientationFilter::getTimeInSeconds() const
     return m_filter->time;
 }
 
+void KalmanOrientationFilter::update(const float delta_time, const PoseFilterPacket &packet)
+{
+	m_filter->update(delta_time, packet);
+}
+
 void KalmanOrientationFilter::resetState()
 {
 	m_filter->init(m_constants);
@@ -719,8 +1103,29 @@ void KalmanOrientationFilter::resetState()
 
 void KalmanOrientationFilter::recenterOrientation(const Eigen::Quaternionf& q_pose)
 {
-	m_filter->world_orientation = q_pose.cast<double>();
-	m_filter->ukf.init(OrientationStateVectord::Identity());
+	m_filter->recenter(q_pose);
+}
+
+bool KalmanOrientationFilter::allocateStateHistory(const int state_count)
+{
+	m_state_history_count = state_count;
+
+	if (m_filter != nullptr)
+	{
+		m_filter->allocate_state_history(state_count);
+	}
+
+	return true;
+}
+
+void KalmanOrientationFilter::saveState(const int state_index)
+{
+	m_filter->save_state(state_index);
+}
+
+void KalmanOrientationFilter::restoreState(const int state_index)
+{
+	m_filter->restore_state(state_index);
 }
 
 Eigen::Quaternionf KalmanOrientationFilter::getOrientation(float time) const
@@ -729,7 +1134,7 @@ Eigen::Quaternionf KalmanOrientationFilter::getOrientation(float time) const
 
 	if (m_filter->bIsValid)
 	{
-		const Eigen::Quaternionf state_orientation = m_filter->compute_net_world_quaternion().cast<float>();
+		const Eigen::Quaternionf state_orientation = m_filter->get_world_quaternion();
 		Eigen::Quaternionf predicted_orientation = state_orientation;
 
 		if (fabsf(time) > k_real_epsilon)
@@ -761,287 +1166,40 @@ Eigen::Vector3f KalmanOrientationFilter::getAngularAccelerationRadPerSecSqr() co
 }
 
 //-- KalmanOrientationFilterPSVR --
-bool KalmanOrientationFilterPSVR::init(const OrientationFilterConstants &constants)
+KalmanOrientationFilterImpl *KalmanOrientationFilterPSVR::allocate_filter() const
 {
-	KalmanOrientationFilter::init(constants);
-
-	PSVRKalmanPoseFilterImpl *filter = new PSVRKalmanPoseFilterImpl();
-	filter->init(constants);
-	m_filter = filter;
-
-	return true;
-}
-
-bool KalmanOrientationFilterPSVR::init(
-	const OrientationFilterConstants &constants,
-	const Eigen::Quaternionf &orientation)
-{
-	KalmanOrientationFilter::init(constants);
-
-	PSVRKalmanPoseFilterImpl *filter = new PSVRKalmanPoseFilterImpl();
-	filter->init(constants, orientation);
-	m_filter = filter;
-
-	return true;
-}
-
-void KalmanOrientationFilterPSVR::update(const float delta_time, const PoseFilterPacket &packet)
-{
-    if (m_filter->bIsValid)
-    {
-		PSVRKalmanPoseFilterImpl *filter = static_cast<PSVRKalmanPoseFilterImpl *>(m_filter);
-		OpticalOrientationMeasurementModel &optical_measurement_model = filter->optical_measurement_model;
-		GravMeasurementModel &imu_measurement_model= filter->imu_measurement_model;
-
-        // Predict state for current time-step using the filters
-		filter->system_model.set_time_step(delta_time);
-
-		if (packet.has_imu_measurements())
-		{
-			OrientationControlVectord control;
-			control.set_angular_rates(packet.imu_gyroscope_rad_per_sec.cast<double>());
-
-			filter->ukf.predict(filter->system_model, control);
-		}
-		else
-		{
-			filter->ukf.predict(filter->system_model);
-		}
-
-		// Apply any optical measurement to the filter
-		if (packet.has_optical_measurement())
-		{
-			assert(packet.tracking_projection_area_px_sqr > 0.f);
-			Eigen::Quaterniond optical_orientation= packet.optical_orientation.cast<double>();
-
-			// If this is the first time we have seen an orientation measurement, 
-			// snap the orientation state to a best fit alignment of the sensor measurements.
-			if (!m_filter->bSeenOrientationMeasurement)
-			{
-				optical_measurement_model.update_world_orientation(optical_orientation);
-				imu_measurement_model.update_world_orientation(optical_orientation);
-				filter->set_world_quaternion(optical_orientation);
-				filter->bSeenOrientationMeasurement = true;
-			}
-
-			OrientationMeasurementVectord measurement = OrientationMeasurementVectord::Zero();
-			measurement.set_optical_quaterniond(optical_orientation);
-			filter->ukf.update(optical_measurement_model, measurement);
-		}
-
-		// Apply any IMU measurement to the filter
-		if (packet.has_imu_measurements())
-		{
-			assert(packet.has_accelerometer_measurement);
-
-			GravMeasurementVectord measurement = GravMeasurementVectord::Zero();
-			measurement.set_accelerometer(packet.imu_accelerometer_g_units.cast<double>());
-			filter->ukf.update(imu_measurement_model, measurement);
-		}
-
-		// Apply the orientation error in the UKF state to the output quaternion.
-		// Zero out the error in the UKF state vector.
-		filter->apply_error_to_world_quaternion();
-
-		// Update the measurement model with the latest estimate of the orientation (without error)
-		// so that we can predict what the controller relative sensor measurements will be
-		optical_measurement_model.update_world_orientation(filter->world_orientation);
-		imu_measurement_model.update_world_orientation(filter->world_orientation);
-    }
-    else
-    {
-		m_filter->ukf.init(OrientationStateVectord::Identity());
-        m_filter->bIsValid= true;
-    }
+	if (m_scalar_type == KalmanFilterScalarFloat)
+	{
+		return new PSVRKalmanOrientationFilterImpl<float>();
+	}
+	else
+	{
+		return new PSVRKalmanOrientationFilterImpl<double>();
+	}
 }
 
 //-- KalmanOrientationFilterDS4 --
-bool KalmanOrientationFilterDS4::init(const OrientationFilterConstants &constants)
-{
-	KalmanOrientationFilter::init(constants);
-
-	DS4KalmanOrientationFilterImpl *filter = new DS4KalmanOrientationFilterImpl();
-	filter->init(constants);
-	m_filter = filter;
-
-	return true;
-}
-
-bool KalmanOrientationFilterDS4::init(
-	const OrientationFilterConstants &constants,
-	const Eigen::Quaternionf &orientation)
-{
-	KalmanOrientationFilter::init(constants);
-
-	DS4KalmanOrientationFilterImpl *filter = new DS4KalmanOrientationFilterImpl();
-	filter->init(constants, orientation);
-	m_filter = filter;
-
-	return true;
-}
-
-void KalmanOrientationFilterDS4::update(const float delta_time, const PoseFilterPacket &packet)
+KalmanOrientationFilterImpl *KalmanOrientationFilterDS4::allocate_filter() const
 {
-    if (m_filter->bIsValid)
-    {
-		PSVRKalmanPoseFilterImpl *filter = static_cast<PSVRKalmanPoseFilterImpl *>(m_filter);
-		OpticalOrientationMeasurementModel &optical_measurement_model = filter->optical_measurement_model;
-		GravMeasurementModel &imu_measurement_model= filter->imu_measurement_model;
-
-        // Predict state for current time-step using the filters
-		filter->system_model.set_time_step(delta_time);
-
-		if (packet.has_imu_measurements())
-		{
-			OrientationControlVectord control;
-			control.set_angular_rates(packet.imu_gyroscope_rad_per_sec.cast<double>());
-
-			filter->ukf.predict(filter->system_model, control);
-		}
-		else
-		{
-			filter->ukf.predict(filter->system_model);
-		}
-
-		// Apply any optical measurement to the filter
-		if (packet.has_optical_measurement())
-		{
-			assert(packet.tracking_projection_area_px_sqr > 0.f);
-			Eigen::Quaterniond optical_orientation= packet.optical_orientation.cast<double>();
-
-			// If this is the first time we have seen an orientation measurement, 
-			// snap the orientation state to a best fit alignment of the sensor measurements.
-			if (!m_filter->bSeenOrientationMeasurement)
-			{
-				optical_measurement_model.update_world_orientation(optical_orientation);
-				imu_measurement_model.update_world_orientation(optical_orientation);
-				filter->set_world_quaternion(optical_orientation);
-				filter->bSeenOrientationMeasurement = true;
-			}
-
-			OrientationMeasurementVectord measurement = OrientationMeasurementVectord::Zero();
-			measurement.set_optical_quaterniond(optical_orientation);
-			filter->ukf.update(optical_measurement_model, measurement);
-		}
-
-		// Apply any IMU measurement to the filter
-		if (packet.has_imu_measurements())
-		{
-			assert(packet.has_accelerometer_measurement);
-
-			GravMeasurementVectord measurement = GravMeasurementVectord::Zero();
-			measurement.set_accelerometer(packet.imu_accelerometer_g_units.cast<double>());
-			filter->ukf.update(imu_measurement_model, measurement);
-		}
-
-		// Apply the orientation error in the UKF state to the output quaternion.
-		// Zero out the error in the UKF state vector.
-		filter->apply_error_to_world_quaternion();
-
-		// Update the measurement model with the latest estimate of the orientation (without error)
-		// so that we can predict what the controller relative sensor measurements will be
-		optical_measurement_model.update_world_orientation(filter->world_orientation);
-		imu_measurement_model.update_world_orientation(filter->world_orientation);
-    }
-    else
-    {
-		m_filter->ukf.init(OrientationStateVectord::Identity());
-        m_filter->bIsValid= true;
-    }
+	if (m_scalar_type == KalmanFilterScalarFloat)
+	{
+		return new DS4KalmanOrientationFilterImpl<float>();
+	}
+	else
+	{
+		return new DS4KalmanOrientationFilterImpl<double>();
+	}
 }
 
 //-- KalmanOrientationFilterPSMove --
-bool KalmanOrientationFilterPSMove::init(const OrientationFilterConstants &constants)
-{
-	KalmanOrientationFilter::init(constants);
-
-	PSMoveKalmanPoseFilterImpl *filter = new PSMoveKalmanPoseFilterImpl();
-	filter->init(constants);
-	m_filter = filter;
-
-	return true;
-}
-
-bool KalmanOrientationFilterPSMove::init(
-	const OrientationFilterConstants &constants,
-	const Eigen::Quaternionf &orientation)
-{
-	KalmanOrientationFilter::init(constants);
-
-	PSMoveKalmanPoseFilterImpl *filter = new PSMoveKalmanPoseFilterImpl();
-	filter->init(constants, orientation);
-	m_filter = filter;
-
-	return true;
-}
-
-void KalmanOrientationFilterPSMove::update(const float delta_time, const PoseFilterPacket &packet)
+KalmanOrientationFilterImpl *KalmanOrientationFilterPSMove::allocate_filter() const
 {
-    if (m_filter->bIsValid)
-    {
-		PSMoveKalmanPoseFilterImpl *filter = static_cast<PSMoveKalmanPoseFilterImpl *>(m_filter);
-		OpticalOrientationMeasurementModel &optical_measurement_model = filter->optical_measurement_model;
-		MagGravMeasurementModel &imu_measurement_model= filter->imu_measurement_model;
-
-        // Predict state for current time-step using the filters
-		filter->system_model.set_time_step(delta_time);
-
-		if (packet.has_imu_measurements())
-		{
-			OrientationControlVectord control;
-			control.set_angular_rates(packet.imu_gyroscope_rad_per_sec.cast<double>());
-
-			filter->ukf.predict(filter->system_model, control);
-		}
-		else
-		{
-			filter->ukf.predict(filter->system_model);
-		}
-
-		// Apply any optical measurement to the filter
-		if (packet.has_optical_measurement())
-		{
-			assert(packet.tracking_projection_area_px_sqr > 0.f);
-			Eigen::Quaterniond optical_orientation= packet.optical_orientation.cast<double>();
-
-			// If this is the first time we have seen an orientation measurement, 
-			// snap the orientation state to a best fit alignment of the sensor measurements.
-			if (!m_filter->bSeenOrientationMeasurement)
-			{
-				optical_measurement_model.update_world_orientation(optical_orientation);
-				imu_measurement_model.update_world_orientation(optical_orientation);
-				filter->set_world_quaternion(optical_orientation);
-				filter->bSeenOrientationMeasurement = true;
-			}
-
-			OrientationMeasurementVectord measurement = OrientationMeasurementVectord::Zero();
-			measurement.set_optical_quaterniond(optical_orientation);
-			filter->ukf.update(optical_measurement_model, measurement);
-		}
-
-		// Apply any IMU measurement to the filter
-		if (packet.has_imu_measurements())
-		{
-			assert(packet.has_accelerometer_measurement);
-
-			MagGravMeasurementVectord measurement = MagGravMeasurementVectord::Zero();
-			measurement.set_accelerometer(packet.imu_accelerometer_g_units.cast<double>());
-			measurement.set_magnetometer(packet.imu_magnetometer_unit.cast<double>());
-			filter->ukf.update(imu_measurement_model, measurement);
-		}
-
-		// Apply the orientation error in the UKF state to the output quaternion.
-		// Zero out the error in the UKF state vector.
-		filter->apply_error_to_world_quaternion();
-
-		// Update the measurement model with the latest estimate of the orientation (without error)
-		// so that we can predict what the controller relative sensor measurements will be
-		optical_measurement_model.update_world_orientation(filter->world_orientation);
-		imu_measurement_model.update_world_orientation(filter->world_orientation);
-    }
-    else
-    {
-		m_filter->ukf.init(OrientationStateVectord::Identity());
-        m_filter->bIsValid= true;
-    }
+	if (m_scalar_type == KalmanFilterScalarFloat)
+	{
+		return new PSMoveKalmanOrientationFilterImpl<float>();
+	}
+	else
+	{
+		return new PSMoveKalmanOrientationFilterImpl<double>();
+	}
 }
\ No newline at end of file
@@ -3,11 +3,12 @@
 
 #include "PoseFilterInterface.h"
 
-/// Base Kalman Orientation filter
+/// Base Kalman Orientation filter.
+/// The filter math runs in either double or float precision, picked when the filter is constructed.
 class KalmanOrientationFilter : public IOrientationFilter
 {
 public:
-	KalmanOrientationFilter();
+	KalmanOrientationFilter(const KalmanFilterScalarType scalar_type);
 	virtual ~KalmanOrientationFilter();
 
 	bool init(const OrientationFilterConstants &constant) override;
@@ -16,44 +17,64 @@ public:
 	// -- IStateFilter --
 	bool getIsStateValid() const override;
     double getTimeInSeconds() const override;
+	void update(const float delta_time, const PoseFilterPacket &packet) override;
 	void resetState() override;
 	void recenterOrientation(const Eigen::Quaternionf& q_pose) override;
+	bool allocateStateHistory(const int state_count) override;
+	void saveState(const int state_index) override;
+	void restoreState(const int state_index) override;
 
 	// -- IOrientationFilter ---
 	Eigen::Quaternionf getOrientation(float time = 0.f) const override;
 	Eigen::Vector3f getAngularVelocityRadPerSec() const override;
 	Eigen::Vector3f getAngularAccelerationRadPerSecSqr() const override;
 
+	inline KalmanFilterScalarType getScalarType() const { return m_scalar_type; }
+
 protected:
+	/// Create the device specific filter implementation for m_scalar_type
+	virtual class KalmanOrientationFilterImpl *allocate_filter() const = 0;
+
 	OrientationFilterConstants m_constants;
+	KalmanFilterScalarType m_scalar_type;
 	class KalmanOrientationFilterImpl *m_filter;
+	int m_state_history_count;
 };
 
 /// Kalman Orientation filter for Optical + Angular Rate(Gyroscope) + Gravity(Accelerometer)
 class KalmanOrientationFilterPSVR : public KalmanOrientationFilter
 {
 public:
-	bool init(const OrientationFilterConstants &constant) override;
-	bool init(const OrientationFilterConstants &constant, const Eigen::Quaternionf &orientation) override;
-	void update(const float delta_time, const PoseFilterPacket &packet) override;
+	KalmanOrientationFilterPSVR(const KalmanFilterScalarType scalar_type = KalmanFilterScalarDouble)
+		: KalmanOrientationFilter(scalar_type)
+	{}
+
+protected:
+	class KalmanOrientationFilterImpl *allocate_filter() const override;
 };
 
 /// Kalman Orientation filter for Optical Yaw + Angular Rate(Gyroscope) + Gravity(Accelerometer)
 class KalmanOrientationFilterDS4 : public KalmanOrientationFilter
 {
 public:
-	bool init(const OrientationFilterConstants &constant) override;
-	bool init(const OrientationFilterConstants &constant, const Eigen::Quaternionf &orientation) override;
-	void update(const float delta_time, const PoseFilterPacket &packet) override;
+	KalmanOrientationFilterDS4(const KalmanFilterScalarType scalar_type = KalmanFilterScalarDouble)
+		: KalmanOrientationFilter(scalar_type)
+	{}
+
+protected:
+	class KalmanOrientationFilterImpl *allocate_filter() const override;
 };
 
 /// Kalman Orientation filter for Magnetometer + Angular Rate(Gyroscope) + Gravity(Accelerometer)
 class KalmanOrientationFilterPSMove : public KalmanOrientationFilter
 {
 public:
-	bool init(const OrientationFilterConstants &constant) override;
-	bool init(const OrientationFilterConstants &constant, const Eigen::Quaternionf &orientation) override;
-	void update(const float delta_time, const PoseFilterPacket &packet) override;
+	KalmanOrientationFilterPSMove(const KalmanFilterScalarType scalar_type = KalmanFilterScalarDouble)
+		: KalmanOrientationFilter(scalar_type)
+	{}
+
+protected:
+	class KalmanOrientationFilterImpl *allocate_filter() const override;
 };
 
 #endif // KALMAN_ORIENTATION_FILTER_H
\ No newline at end of file
@@ -115,43 +115,42 @@ public:
     {
         PoseStateVector<T> result= PoseStateVector<T>::Zero();
 
-        result[POSE_ERROR_QUATERNION_W] = 1.0;
+        result[POSE_ERROR_QUATERNION_W] = T(1);
 
         return result;
     }
 
     // Accessors
-    Eigen::Vector3d get_position_meters() const { 
-        return Eigen::Vector3d((*this)[POSE_POSITION_X], (*this)[POSE_POSITION_Y], (*this)[POSE_POSITION_Z]); 
+    Eigen::Matrix<T, 3, 1> get_position_meters() const { 
+        return Eigen::Matrix<T, 3, 1>((*this)[POSE_POSITION_X], (*this)[POSE_POSITION_Y], (*this)[POSE_POSITION_Z]); 
     }
-    Eigen::Vector3d get_linear_velocity_m_per_sec() const {
-        return Eigen::Vector3d((*this)[POSE_LINEAR_VELOCITY_X], (*this)[POSE_LINEAR_VELOCITY_Y], (*this)[POSE_LINEAR_VELOCITY_Z]);
+    Eigen::Matrix<T, 3, 1> get_linear_velocity_m_per_sec() const {
+        return Eigen::Matrix<T, 3, 1>((*this)[POSE_LINEAR_VELOCITY_X], (*this)[POSE_LINEAR_VELOCITY_Y], (*this)[POSE_LINEAR_VELOCITY_Z]);
     }
-    Eigen::Vector3d get_linear_acceleration_m_per_sec_sqr() const {
-        return Eigen::Vector3d((*this)[POSE_LINEAR_ACCELERATION_X], (*this)[POSE_LINEAR_ACCELERATION_Y], (*this)[POSE_LINEAR_ACCELERATION_Z]);
+    Eigen::Matrix<T, 3, 1> get_linear_acceleration_m_per_sec_sqr() const {
+        return Eigen::Matrix<T, 3, 1>((*this)[POSE_LINEAR_ACCELERATION_X], (*this)[POSE_LINEAR_ACCELERATION_Y], (*this)[POSE_LINEAR_ACCELERATION_Z]);
     }
-    Eigen::Quaterniond get_error_quaterniond() const {
-        return Eigen::Quaterniond((*this)[POSE_ERROR_QUATERNION_W], (*this)[POSE_ERROR_QUATERNION_X], (*this)[POSE_ERROR_QUATERNION_Y], (*this)[POSE_ERROR_QUATERNION_Z]);
+    Eigen::Quaternion<T> get_error_quaternion() const {
+        return Eigen::Quaternion<T>((*this)[POSE_ERROR_QUATERNION_W], (*this)[POSE_ERROR_QUATERNION_X], (*this)[POSE_ERROR_QUATERNION_Y], (*this)[POSE_ERROR_QUATERNION_Z]);
     }
 
     // Mutators
-    void set_position_meters(const Eigen::Vector3d &p) {
+    void set_position_meters(const Eigen::Matrix<T, 3, 1> &p) {
         (*this)[POSE_POSITION_X] = p.x(); (*this)[POSE_POSITION_Y] = p.y(); (*this)[POSE_POSITION_Z] = p.z();
     }
-    void set_linear_velocity_m_per_sec(const Eigen::Vector3d &v) {
+    void set_linear_velocity_m_per_sec(const Eigen::Matrix<T, 3, 1> &v) {
         (*this)[POSE_LINEAR_VELOCITY_X] = v.x(); (*this)[POSE_LINEAR_VELOCITY_Y] = v.y(); (*this)[POSE_LINEAR_VELOCITY_Z] = v.z();
     }
-    void set_linear_acceleration_m_per_sec_sqr(const Eigen::Vector3d &a) {
+    void set_linear_acceleration_m_per_sec_sqr(const Eigen::Matrix<T, 3, 1> &a) {
         (*this)[POSE_LINEAR_ACCELERATION_X] = a.x(); (*this)[POSE_LINEAR_ACCELERATION_Y] = a.y(); (*this)[POSE_LINEAR_ACCELERATION_Z] = a.z();
     }
-    void set_error_quaterniond(const Eigen::Quaterniond &q) {
+    void set_error_quaternion(const Eigen::Quaternion<T> &q) {
         (*this)[POSE_ERROR_QUATERNION_W] = q.w();
         (*this)[POSE_ERROR_QUATERNION_X] = q.x();
         (*this)[POSE_ERROR_QUATERNION_Y] = q.y();
         (*this)[POSE_ERROR_QUATERNION_Z] = q.z();
     }
 };
-typedef PoseStateVector<double> PoseStateVectord;
 
 template<typename T>
 class PoseControlVector : public Kalman::Vector<T, POSE_CONTROL_PARAMETER_COUNT>
@@ -160,18 +159,17 @@ public:
 	KALMAN_VECTOR(PoseControlVector, T, POSE_CONTROL_PARAMETER_COUNT)
 
 	// Accessors
-	Eigen::Vector3d get_angular_rates() const {
-		return Eigen::Vector3d((*this)[POSE_CONTROL_GYROSCOPE_PITCH], (*this)[POSE_CONTROL_GYROSCOPE_YAW], (*this)[POSE_CONTROL_GYROSCOPE_ROLL]);
+	Eigen::Matrix<T, 3, 1> get_angular_rates() const {
+		return Eigen::Matrix<T, 3, 1>((*this)[POSE_CONTROL_GYROSCOPE_PITCH], (*this)[POSE_CONTROL_GYROSCOPE_YAW], (*this)[POSE_CONTROL_GYROSCOPE_ROLL]);
 	}
 
 	// Mutators
-	void set_angular_rates(const Eigen::Vector3d &v) {
+	void set_angular_rates(const Eigen::Matrix<T, 3, 1> &v) {
 		(*this)[POSE_CONTROL_GYROSCOPE_PITCH] = v.x();
 		(*this)[POSE_CONTROL_GYROSCOPE_YAW] = v.y();
 		(*this)[POSE_CONTROL_GYROSCOPE_ROLL] = v.z();
 	}
 };
-typedef PoseControlVector<double> PoseControlVectord;
 
 /**
 * @brief System model for a controller
@@ -179,16 +177,20 @@ typedef PoseControlVector<double> PoseControlVectord;
 * This is the system model defining how a controller advances from one
 * time-step to the next, i.e. how the system state evolves over time.
 */
-class PoseSystemModel : public Kalman::SystemModel<PoseStateVectord, PoseControlVectord, Kalman::SquareRootBase>
+template<typename T>
+class PoseSystemModel : public Kalman::SystemModel<PoseStateVector<T>, PoseControlVector<T>, Kalman::SquareRootBase>
 {
 public:
-    inline void set_time_step(const double dt) { m_time_step = dt; }
+    typedef PoseStateVector<T> StateVector;
+    typedef PoseControlVector<T> ControlVector;
+
+    inline void set_time_step(const double dt) { m_time_step = static_cast<T>(dt); }
 
     void init(const PoseFilterConstants &constants)
     {
         use_linear_acceleration = constants.position_constants.use_linear_acceleration;
         m_last_tracking_projection_area_px_sqr = -1.f;
-		m_gyro_bias = constants.orientation_constants.gyro_drift.cast<double>();
+		m_gyro_bias = constants.orientation_constants.gyro_drift.cast<T>();
         update_process_noise(constants, 0.f);
     }
 
@@ -220,15 +222,15 @@ public:
                 k_centimeters_to_meters*k_centimeters_to_meters*position_variance_cm_sqr;
 
             // Initialize the process covariance matrix Q
-            Kalman::Covariance<PoseStateVectord> Q = Kalman::Covariance<PoseStateVectord>::Zero();
-            Q_discrete_3rd_order_white_noise<PoseStateVectord>(mean_position_dT, position_variance_m_sqr, POSE_POSITION_X, Q);
-            Q_discrete_3rd_order_white_noise<PoseStateVectord>(mean_position_dT, position_variance_m_sqr, POSE_POSITION_Y, Q);
-            Q_discrete_3rd_order_white_noise<PoseStateVectord>(mean_position_dT, position_variance_m_sqr, POSE_POSITION_Z, Q);
-			Q_discrete_1st_order_white_noise<PoseStateVectord>(mean_orientation_dT, orientation_variance, POSE_ERROR_QUATERNION_W, Q);
-			Q_discrete_1st_order_white_noise<PoseStateVectord>(mean_orientation_dT, orientation_variance, POSE_ERROR_QUATERNION_X, Q);
-			Q_discrete_1st_order_white_noise<PoseStateVectord>(mean_orientation_dT, orientation_variance, POSE_ERROR_QUATERNION_Y, Q);
-			Q_discrete_1st_order_white_noise<PoseStateVectord>(mean_orientation_dT, orientation_variance, POSE_ERROR_QUATERNION_Z, Q);
-            setCovariance(Q);
+            Kalman::Covariance<StateVector> Q = Kalman::Covariance<StateVector>::Zero();
+            Q_discrete_3rd_order_white_noise<StateVector>(mean_position_dT, position_variance_m_sqr, POSE_POSITION_X, Q);
+            Q_discrete_3rd_order_white_noise<StateVector>(mean_position_dT, position_variance_m_sqr, POSE_POSITION_Y, Q);
+            Q_discrete_3rd_order_white_noise<StateVector>(mean_position_dT, position_variance_m_sqr, POSE_POSITION_Z, Q);
+			Q_discrete_1st_order_white_noise<StateVector>(mean_orientation_dT, orientation_variance, POSE_ERROR_QUATERNION_W, Q);
+			Q_discrete_1st_order_white_noise<StateVector>(mean_orientation_dT, orientation_variance, POSE_ERROR_QUATERNION_X, Q);
+			Q_discrete_1st_order_white_noise<StateVector>(mean_orientation_dT, orientation_variance, POSE_ERROR_QUATERNION_Y, Q);
+			Q_discrete_1st_order_white_noise<StateVector>(mean_orientation_dT, orientation_variance, POSE_ERROR_QUATERNION_Z, Q);
+            this->setCovariance(Q);
 
             // Keep track last tracking projection area we built the covariance matrix for
             m_last_tracking_projection_area_px_sqr = tracking_projection_area_px_sqr;
@@ -247,31 +249,31 @@ public:
     * @param [in] u The control vector input
     * @returns The (predicted) system state in the next time-step
     */
-    PoseStateVectord f(const PoseStateVectord& old_state, const PoseControlVectord& control) const
+    StateVector f(const StateVector& old_state, const ControlVector& control) const
     {
         // Predicted state vector after transition
-        PoseStateVectord new_state;
+        StateVector new_state;
 
         // Extract parameters from the old state
-        const Eigen::Vector3d old_position_meters = old_state.get_position_meters();
-        const Eigen::Vector3d old_linear_velocity_m_per_sec = old_state.get_linear_velocity_m_per_sec();
-        const Eigen::Vector3d old_linear_acceleration_m_per_sec_sqr = old_state.get_linear_acceleration_m_per_sec_sqr();
+        const Eigen::Matrix<T, 3, 1> old_position_meters = old_state.get_position_meters();
+        const Eigen::Matrix<T, 3, 1> old_linear_velocity_m_per_sec = old_state.get_linear_velocity_m_per_sec();
+        const Eigen::Matrix<T, 3, 1> old_linear_acceleration_m_per_sec_sqr = old_state.get_linear_acceleration_m_per_sec_sqr();
 
         // Extract parameters from the old state
-        const Eigen::Quaterniond error_q_old = old_state.get_error_quaterniond();
+        const Eigen::Quaternion<T> error_q_old = old_state.get_error_quaternion();
 
 		// Compute the true angular rate from the control vector
-		const Eigen::Vector3d omega = control - m_gyro_bias;
+		const Eigen::Matrix<T, 3, 1> omega = control - m_gyro_bias;
 
         // Compute the position state update
-        Eigen::Vector3d new_position_meters;
-        Eigen::Vector3d new_linear_velocity_m_per_sec;
+        Eigen::Matrix<T, 3, 1> new_position_meters;
+        Eigen::Matrix<T, 3, 1> new_linear_velocity_m_per_sec;
         if (use_linear_acceleration)
         {
             new_position_meters =
                 old_position_meters
                 + old_linear_velocity_m_per_sec*m_time_step
-                + old_linear_acceleration_m_per_sec_sqr*m_time_step*m_time_step*0.5f;			
+                + old_linear_acceleration_m_per_sec_sqr*m_time_step*m_time_step*T(0.5);			
             new_linear_velocity_m_per_sec = 
                 old_linear_velocity_m_per_sec 
                 + old_linear_acceleration_m_per_sec_sqr*m_time_step;
@@ -282,18 +284,18 @@ public:
                 old_position_meters
                 + old_linear_velocity_m_per_sec*m_time_step;			
             new_linear_velocity_m_per_sec =
-                (m_time_step > k_real64_normal_epsilon)
-                ? (new_position_meters - old_position_meters) / m_time_step
+                (m_time_step > T(k_real64_normal_epsilon))
+                ? Eigen::Matrix<T, 3, 1>((new_position_meters - old_position_meters) / m_time_step)
                 : old_linear_velocity_m_per_sec;
         }
 
-        const Eigen::Vector3d &new_linear_acceleration_m_per_sec_sqr = old_linear_acceleration_m_per_sec_sqr;
+        const Eigen::Matrix<T, 3, 1> &new_linear_acceleration_m_per_sec_sqr = old_linear_acceleration_m_per_sec_sqr;
 
 		// Compute the quaternion derivative of the current state
 		// q_new= q + q_dot*dT
-		const Eigen::Quaterniond q_dot = eigen_angular_velocity_to_quaterniond_derivative(error_q_old, omega);
-		const Eigen::Quaterniond error_q_step = Eigen::Quaterniond(q_dot.coeffs() * m_time_step);
-		const Eigen::Quaterniond error_q_new = Eigen::Quaterniond(error_q_old.coeffs() + error_q_step.coeffs());
+		const Eigen::Quaternion<T> q_dot = eigen_angular_velocity_to_quaternion_derivative_t(error_q_old, omega);
+		const Eigen::Quaternion<T> error_q_step = Eigen::Quaternion<T>(q_dot.coeffs() * m_time_step);
+		const Eigen::Quaternion<T> error_q_new = Eigen::Quaternion<T>(error_q_old.coeffs() + error_q_step.coeffs());
 
         // Save results to the new state
         new_state.set_position_meters(new_position_meters);
@@ -301,29 +303,37 @@ public:
         new_state.set_linear_acceleration_m_per_sec_sqr(new_linear_acceleration_m_per_sec_sqr);
 
         // Save results to the new state
-        new_state.set_error_quaterniond(error_q_new.normalized());
+        new_state.set_error_quaternion(error_q_new.normalized());
 
         return new_state;
     }
 
 protected:
     bool use_linear_acceleration;
-    double m_time_step;
+    T m_time_step;
     float m_last_tracking_projection_area_px_sqr;
-	Eigen::Vector3d m_gyro_bias;
+	Eigen::Matrix<T, 3, 1> m_gyro_bias;
 };
 
-class PoseSRUKF : public Kalman::SquareRootUnscentedKalmanFilter<PoseStateVectord>
+template<typename T>
+class PoseSRUKF : public Kalman::SquareRootUnscentedKalmanFilter<PoseStateVector<T> >
 {
 public:
-    PoseSRUKF(double alpha = 1.0, double beta = 2.0, double kappa = 0.0)
-        : Kalman::SquareRootUnscentedKalmanFilter<PoseStateVectord>(alpha, beta, kappa)
+    typedef Kalman::SquareRootUnscentedKalmanFilter<PoseStateVector<T> > Base;
+
+    PoseSRUKF(T alpha = T(1), T beta = T(2), T kappa = T(0))
+        : Base(alpha, beta, kappa)
     {
     }
 
-    State& getStateMutable()
+    typename Base::State& getStateMutable()
     {
-        return x;
+        return this->x;
+    }
+
+    Kalman::CovarianceSquareRoot<PoseStateVector<T> >& getCovarianceSquareRootMutable()
+    {
+        return this->S;
     }
 };
 
@@ -333,36 +343,39 @@ class PoseGravMeasurementVector : public Kalman::Vector<T, POSE_G_MEASUREMENT_PA
 public:
 	KALMAN_VECTOR(PoseGravMeasurementVector, T, POSE_G_MEASUREMENT_PARAMETER_COUNT)
 
-		// Accessors
-		Eigen::Vector3d get_accelerometer() const {
-		return Eigen::Vector3d((*this)[POSE_ACCELEROMETER_X], (*this)[POSE_ACCELEROMETER_Y], (*this)[POSE_ACCELEROMETER_Z]);
+	// Accessors
+	Eigen::Matrix<T, 3, 1> get_accelerometer() const {
+		return Eigen::Matrix<T, 3, 1>((*this)[POSE_ACCELEROMETER_X], (*this)[POSE_ACCELEROMETER_Y], (*this)[POSE_ACCELEROMETER_Z]);
 	}
 
 	// Mutators
-	void set_accelerometer(const Eigen::Vector3d &a) {
+	void set_accelerometer(const Eigen::Matrix<T, 3, 1> &a) {
 		(*this)[POSE_ACCELEROMETER_X] = a.x(); (*this)[POSE_ACCELEROMETER_Y] = a.y(); (*this)[POSE_ACCELEROMETER_Z] = a.z();
 	}
 };
-typedef PoseGravMeasurementVector<double> PoseGravMeasurementVectord;
 
+template<typename T>
 class PoseGravMeasurementModel :
-	public Kalman::MeasurementModel<PoseStateVectord, PoseGravMeasurementVectord, Kalman::SquareRootBase>
+	public Kalman::MeasurementModel<PoseStateVector<T>, PoseGravMeasurementVector<T>, Kalman::SquareRootBase>
 {
 public:
-	void init(const OrientationFilterConstants &constants, const Eigen::Quaterniond *last_world_orientation_ptr)
+	typedef PoseStateVector<T> StateVector;
+	typedef PoseGravMeasurementVector<T> MeasurementVector;
+
+	void init(const OrientationFilterConstants &constants, const Eigen::Quaternion<T> *last_world_orientation_ptr)
 	{
 		// Update the measurement covariance R
-		Kalman::Covariance<PoseGravMeasurementVectord> R =
-			Kalman::Covariance<PoseGravMeasurementVectord>::Zero();
+		Kalman::Covariance<MeasurementVector> R =
+			Kalman::Covariance<MeasurementVector>::Zero();
 
 		// Only diagonals used so no need to compute Cholesky
 		static float r_accelerometer_scale = R_SCALE;
 		R(POSE_ACCELEROMETER_X, POSE_ACCELEROMETER_X) = r_accelerometer_scale*constants.accelerometer_variance.x();
 		R(POSE_ACCELEROMETER_Y, POSE_ACCELEROMETER_Y) = r_accelerometer_scale*constants.accelerometer_variance.y();
 		R(POSE_ACCELEROMETER_Z, POSE_ACCELEROMETER_Z) = r_accelerometer_scale*constants.accelerometer_variance.z();
-		setCovariance(R);
+		this->setCovariance(R);
 
-		identity_gravity_direction = constants.gravity_calibration_direction.cast<double>();
+		identity_gravity_direction = constants.gravity_calibration_direction.cast<T>();
 		m_last_world_orientation_ptr = last_world_orientation_ptr;
 	}
 
@@ -376,25 +389,25 @@ public:
 	* @param [in] x The system state in current time-step
 	* @returns The (predicted) sensor measurement for the system state
 	*/
-	PoseGravMeasurementVectord h(const PoseStateVectord& x) const
+	MeasurementVector h(const StateVector& x) const
 	{
-		PoseGravMeasurementVectord predicted_measurement;
+		MeasurementVector predicted_measurement;
 
 		// Use the orientation + linear acceleration state from the state for prediction
-		const Eigen::Quaterniond error_orientation = x.get_error_quaterniond();
-		const Eigen::Quaterniond world_to_local_orientation = 
+		const Eigen::Quaternion<T> error_orientation = x.get_error_quaternion();
+		const Eigen::Quaternion<T> world_to_local_orientation = 
 			eigen_quaternion_concatenate(*m_last_world_orientation_ptr, error_orientation).normalized();
 
 		// Convert the world space linear acceleration in the state into a local space predicted measurement in the accelerometer 
-		const Eigen::Vector3d world_linear_accel_g_units = x.get_linear_acceleration_m_per_sec_sqr() * k_ms2_to_g_units;
-		const Eigen::Vector3d local_linear_accel_g_units = eigen_vector3d_clockwise_rotate(world_to_local_orientation, world_linear_accel_g_units);
+		const Eigen::Matrix<T, 3, 1> world_linear_accel_g_units = x.get_linear_acceleration_m_per_sec_sqr() * T(k_ms2_to_g_units);
+		const Eigen::Matrix<T, 3, 1> local_linear_accel_g_units = eigen_vector3_clockwise_rotate(world_to_local_orientation, world_linear_accel_g_units);
 
 		// Convert the world space gravitational acceleration in the state into a local space predicted measurement in the accelerometer 
-		const Eigen::Vector3d &world_gravity_accel_g_units = identity_gravity_direction;
-		const Eigen::Vector3d local_gravity_accel_g_units = eigen_vector3d_clockwise_rotate(world_to_local_orientation, world_gravity_accel_g_units);
+		const Eigen::Matrix<T, 3, 1> &world_gravity_accel_g_units = identity_gravity_direction;
+		const Eigen::Matrix<T, 3, 1> local_gravity_accel_g_units = eigen_vector3_clockwise_rotate(world_to_local_orientation, world_gravity_accel_g_units);
 		
 		// Combine the linear and gravitational accelerometer predictions into the final predicted accelerometer reading
-		const Eigen::Vector3d accel_local = local_linear_accel_g_units + local_gravity_accel_g_units;
+		const Eigen::Matrix<T, 3, 1> accel_local = local_linear_accel_g_units + local_gravity_accel_g_units;
 
 		// Save the predictions into the measurement vector
 		predicted_measurement.set_accelerometer(accel_local);
@@ -403,8 +416,10 @@ public:
 	}
 
 public:
-	Eigen::Vector3d identity_gravity_direction;
-	const Eigen::Quaterniond *m_last_world_orientation_ptr;
+	EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+
+	Eigen::Matrix<T, 3, 1> identity_gravity_direction;
+	const Eigen::Quaternion<T> *m_last_world_orientation_ptr;
 };
 
 template<typename T>
@@ -414,32 +429,35 @@ public:
 	KALMAN_VECTOR(PoseMagGravMeasurementVector, T, POSE_MG_MEASUREMENT_PARAMETER_COUNT)
 
 	// Accessors
-	Eigen::Vector3d get_accelerometer() const {
-		return Eigen::Vector3d((*this)[POSE_ACCELEROMETER_X], (*this)[POSE_ACCELEROMETER_Y], (*this)[POSE_ACCELEROMETER_Z]);
+	Eigen::Matrix<T, 3, 1> get_accelerometer() const {
+		return Eigen::Matrix<T, 3, 1>((*this)[POSE_ACCELEROMETER_X], (*this)[POSE_ACCELEROMETER_Y], (*this)[POSE_ACCELEROMETER_Z]);
 	}
-	Eigen::Vector3d get_magnetometer() const {
-		return Eigen::Vector3d((*this)[POSE_MAGNETOMETER_X], (*this)[POSE_MAGNETOMETER_Y], (*this)[POSE_MAGNETOMETER_Z]);
+	Eigen::Matrix<T, 3, 1> get_magnetometer() const {
+		return Eigen::Matrix<T, 3, 1>((*this)[POSE_MAGNETOMETER_X], (*this)[POSE_MAGNETOMETER_Y], (*this)[POSE_MAGNETOMETER_Z]);
 	}
 
 	// Mutators
-	void set_accelerometer(const Eigen::Vector3d &a) {
+	void set_accelerometer(const Eigen::Matrix<T, 3, 1> &a) {
 		(*this)[POSE_ACCELEROMETER_X] = a.x(); (*this)[POSE_ACCELEROMETER_Y] = a.y(); (*this)[POSE_ACCELEROMETER_Z] = a.z();
 	}
-	void set_magnetometer(const Eigen::Vector3d &m) {
+	void set_magnetometer(const Eigen::Matrix<T, 3, 1> &m) {
 		(*this)[POSE_MAGNETOMETER_X] = m.x(); (*this)[POSE_MAGNETOMETER_Y] = m.y(); (*this)[POSE_MAGNETOMETER_Z] = m.z();
 	}
 };
-typedef PoseMagGravMeasurementVector<double> PoseMagGravMeasurementVectord;
 
+template<typename T>
 class PoseMagGravMeasurementModel :
-	public Kalman::MeasurementModel<PoseStateVectord, PoseMagGravMeasurementVectord, Kalman::SquareRootBase>
+	public Kalman::MeasurementModel<PoseStateVector<T>, PoseMagGravMeasurementVector<T>, Kalman::SquareRootBase>
 {
 public:
-	void init(const OrientationFilterConstants &constants, const Eigen::Quaterniond *last_world_orientation_ptr)
+	typedef PoseStateVector<T> StateVector;
+	typedef PoseMagGravMeasurementVector<T> MeasurementVector;
+
+	void init(const OrientationFilterConstants &constants, const Eigen::Quaternion<T> *last_world_orientation_ptr)
 	{
 		// Update the measurement covariance R
-		Kalman::Covariance<PoseMagGravMeasurementVectord> R =
-			Kalman::Covariance<PoseMagGravMeasurementVectord>::Zero();
+		Kalman::Covariance<MeasurementVector> R =
+			Kalman::Covariance<MeasurementVector>::Zero();
 
 		// Only diagonals used so no need to compute Cholesky
 		static float r_accelerometer_scale = R_SCALE;
@@ -450,10 +468,10 @@ public:
 		R(POSE_MAGNETOMETER_X, POSE_MAGNETOMETER_X) = r_magnetometer_scale*constants.magnetometer_variance.x();
 		R(POSE_MAGNETOMETER_Y, POSE_MAGNETOMETER_Y) = r_magnetometer_scale*constants.magnetometer_variance.y();
 		R(POSE_MAGNETOMETER_Z, POSE_MAGNETOMETER_Z) = r_magnetometer_scale*constants.magnetometer_variance.z();
-		setCovariance(R);
+		this->setCovariance(R);
 
-		identity_gravity_direction = constants.gravity_calibration_direction.cast<double>();
-		identity_magnetometer_direction = constants.magnetometer_calibration_direction.cast<double>();
+		identity_gravity_direction = constants.gravity_calibration_direction.cast<T>();
+		identity_magnetometer_direction = constants.magnetometer_calibration_direction.cast<T>();
 		m_last_world_orientation_ptr = last_world_orientation_ptr;
 	}
 
@@ -467,30 +485,30 @@ public:
 	* @param [in] x The system state in current time-step
 	* @returns The (predicted) sensor measurement for the system state
 	*/
-	PoseMagGravMeasurementVectord h(const PoseStateVectord& x) const
+	MeasurementVector h(const StateVector& x) const
 	{
-		PoseMagGravMeasurementVectord predicted_measurement;
+		MeasurementVector predicted_measurement;
 
 		// Use the orientation + linear acceleration state from the state for prediction
-		const Eigen::Quaterniond error_orientation = x.get_error_quaterniond();
-		const Eigen::Quaterniond world_to_local_orientation = 
+		const Eigen::Quaternion<T> error_orientation = x.get_error_quaternion();
+		const Eigen::Quaternion<T> world_to_local_orientation = 
 			eigen_quaternion_concatenate(*m_last_world_orientation_ptr, error_orientation).normalized();
 
 		// Convert the world space linear acceleration in the state into a local space predicted measurement in the accelerometer 
-		const Eigen::Vector3d world_linear_accel_g_units = x.get_linear_acceleration_m_per_sec_sqr() * k_ms2_to_g_units;
-		const Eigen::Vector3d local_linear_accel_g_units = eigen_vector3d_clockwise_rotate(world_to_local_orientation, world_linear_accel_g_units);
+		const Eigen::Matrix<T, 3, 1> world_linear_accel_g_units = x.get_linear_acceleration_m_per_sec_sqr() * T(k_ms2_to_g_units);
+		const Eigen::Matrix<T, 3, 1> local_linear_accel_g_units = eigen_vector3_clockwise_rotate(world_to_local_orientation, world_linear_accel_g_units);
 
 		// Convert the world space gravitational acceleration in the state into a local space predicted measurement in the accelerometer 
-		const Eigen::Vector3d &world_gravity_accel_g_units = identity_gravity_direction;
-		const Eigen::Vector3d local_gravity_accel_g_units = eigen_vector3d_clockwise_rotate(world_to_local_orientation, world_gravity_accel_g_units);
+		const Eigen::Matrix<T, 3, 1> &world_gravity_accel_g_units = identity_gravity_direction;
+		const Eigen::Matrix<T, 3, 1> local_gravity_accel_g_units = eigen_vector3_clockwise_rotate(world_to_local_orientation, world_gravity_accel_g_units);
 
 		// Combine the linear and gravitational accelerometer predictions into the final predicted accelerometer reading
-		const Eigen::Vector3d accel_local = local_linear_accel_g_units + local_gravity_accel_g_units;
+		const Eigen::Matrix<T, 3, 1> accel_local = local_linear_accel_g_units + local_gravity_accel_g_units;
 
 		// Use the orientation from the state to predict
 		// what the magnetometer reading should be (in the space of the controller)
-		const Eigen::Vector3d &mag_world = identity_magnetometer_direction;
-		const Eigen::Vector3d mag_local = eigen_vector3d_clockwise_rotate(world_to_local_orientation, mag_world);
+		const Eigen::Matrix<T, 3, 1> &mag_world = identity_magnetometer_direction;
+		const Eigen::Matrix<T, 3, 1> mag_local = eigen_vector3_clockwise_rotate(world_to_local_orientation, mag_world);
 
 		// Save the predictions into the measurement vector
 		predicted_measurement.set_accelerometer(accel_local);
@@ -500,9 +518,11 @@ public:
 	}
 
 public:
-	Eigen::Vector3d identity_gravity_direction;
-	Eigen::Vector3d identity_magnetometer_direction;
-	const Eigen::Quaterniond *m_last_world_orientation_ptr;
+	EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+
+	Eigen::Matrix<T, 3, 1> identity_gravity_direction;
+	Eigen::Matrix<T, 3, 1> identity_magnetometer_direction;
+	const Eigen::Quaternion<T> *m_last_world_orientation_ptr;
 	//Eigen::Vector3d m_last_world_linear_acceleration_m_per_sec_sqr;
 };
 
@@ -513,21 +533,20 @@ public:
     KALMAN_VECTOR(PoseLEDMeasurementVector, T, POSE_LED_MEASUREMENT_PARAMETER_COUNT)
 
     // Accessors
-    Eigen::Vector3d get_LED_position_meters() const {
-        return Eigen::Vector3d(
+    Eigen::Matrix<T, 3, 1> get_LED_position_meters() const {
+        return Eigen::Matrix<T, 3, 1>(
                 (*this)[POSE_LED_POSITION_X], 
                 (*this)[POSE_LED_POSITION_Y],
                 (*this)[POSE_LED_POSITION_Z]);
     }
 
     // Mutators
-    void set_LED_position_meters(const Eigen::Vector3d &p) {
+    void set_LED_position_meters(const Eigen::Matrix<T, 3, 1> &p) {
         (*this)[POSE_LED_POSITION_X] = p.x();
 		(*this)[POSE_LED_POSITION_Y] = p.y();
 		(*this)[POSE_LED_POSITION_Z] = p.z();
     }
 };
-typedef PoseLEDMeasurementVector<double> PoseLEDMeasurementVectord;
 
 /**
 * @brief LED Measurement model for measuring PSVR controller
@@ -535,11 +554,15 @@ typedef PoseLEDMeasurementVector<double> PoseLEDMeasurementVectord;
 * This is the measurement model for measuring the position and magnetometer of the PSVR controller.
 * The measurement is given by the optical trackers.
 */
+template<typename T>
 class PoseLEDMeasurementModel : 
-    public Kalman::MeasurementModel<PoseStateVectord, PoseLEDMeasurementVectord, Kalman::SquareRootBase>
+    public Kalman::MeasurementModel<PoseStateVector<T>, PoseLEDMeasurementVector<T>, Kalman::SquareRootBase>
 {
 public:
-    void init(const PoseFilterConstants &constants, int led_index, const Eigen::Quaterniond *last_world_orientation)
+    typedef PoseStateVector<T> StateVector;
+    typedef PoseLEDMeasurementVector<T> MeasurementVector;
+
+    void init(const PoseFilterConstants &constants, int led_index, const Eigen::Quaternion<T> *last_world_orientation)
     {
         m_last_world_orientation_ptr = last_world_orientation;
 		m_last_tracking_projection_area_px_sqr = -1.f;
@@ -551,10 +574,10 @@ public:
 
 		// LED model is in centimeters while filter is in meters
         m_LED_model_vertex= 
-			Eigen::Vector3d(
-				static_cast<double>(p.x * k_centimeters_to_meters),
-				static_cast<double>(p.y * k_centimeters_to_meters),
-				static_cast<double>(p.z * k_centimeters_to_meters));
+			Eigen::Matrix<T, 3, 1>(
+				static_cast<T>(p.x * k_centimeters_to_meters),
+				static_cast<T>(p.y * k_centimeters_to_meters),
+				static_cast<T>(p.z * k_centimeters_to_meters));
     }
 
 	void updateMeasurementCovariance(
@@ -577,11 +600,11 @@ public:
 			// Update the measurement covariance R
             // Only diagonals used so no need to compute Cholesky
             static float r_position_scale = R_SCALE;
-			Kalman::Covariance<PoseLEDMeasurementVectord> R = Kalman::Covariance<PoseLEDMeasurementVectord>::Zero();
-			R(POSE_LED_POSITION_X, POSE_LED_POSITION_X) = fmax(r_position_scale*position_variance_m_sqr, R_MIN);
-			R(POSE_LED_POSITION_Y, POSE_LED_POSITION_Y) = fmax(r_position_scale*position_variance_m_sqr, R_MIN);
-			R(POSE_LED_POSITION_Z, POSE_LED_POSITION_Z) = fmax(r_position_scale*position_variance_m_sqr, R_MIN);
-			setCovariance(R);
+			Kalman::Covariance<MeasurementVector> R = Kalman::Covariance<MeasurementVector>::Zero();
+			R(POSE_LED_POSITION_X, POSE_LED_POSITION_X) = static_cast<T>(fmax(r_position_scale*position_variance_m_sqr, R_MIN));
+			R(POSE_LED_POSITION_Y, POSE_LED_POSITION_Y) = static_cast<T>(fmax(r_position_scale*position_variance_m_sqr, R_MIN));
+			R(POSE_LED_POSITION_Z, POSE_LED_POSITION_Z) = static_cast<T>(fmax(r_position_scale*position_variance_m_sqr, R_MIN));
+			this->setCovariance(R);
 
 			// Keep track last position quality we built the covariance matrix for
 			m_last_tracking_projection_area_px_sqr = tracking_projection_area_px_sqr;
@@ -598,29 +621,24 @@ public:
     * @param [in] x The system state in current time-step
     * @returns The (predicted) sensor measurement for the system state
     */
-    PoseLEDMeasurementVectord h(const PoseStateVectord& x) const
+    MeasurementVector h(const StateVector& x) const
     {
-		PoseLEDMeasurementVectord predicted_measurement;
+		MeasurementVector predicted_measurement;
 
         // Use the position and orientation from the state for predictions
-        const Eigen::Vector3d position_meters= x.get_position_meters();
-        const Eigen::Quaterniond error_orientation = x.get_error_quaterniond();
-        const Eigen::Quaterniond local_to_world_orientation = 
+        const Eigen::Matrix<T, 3, 1> position_meters= x.get_position_meters();
+        const Eigen::Quaternion<T> error_orientation = x.get_error_quaternion();
+        const Eigen::Quaternion<T> local_to_world_orientation = 
 			eigen_quaternion_concatenate(*m_last_world_orientation_ptr, error_orientation).normalized();
 
 		//predicted_measurement.set_optical_orientation(local_to_world_orientation);
 		//predicted_measurement.set_optical_position_meters(position_meters);
         // Compute where we expect to find the tracking LEDs
-        Eigen::Affine3d local_to_world= Eigen::Affine3d::Identity();
+        Eigen::Transform<T, 3, Eigen::Affine> local_to_world= Eigen::Transform<T, 3, Eigen::Affine>::Identity();
         local_to_world.linear()= local_to_world_orientation.toRotationMatrix();
-        local_to_world.translation()= x.get_position_meters();
+        local_to_world.translation()= position_meters;
 
-		const Eigen::Vector3d led_model_vertex=
-			Eigen::Vector3d(
-				m_LED_model_vertex.x(),
-				m_LED_model_vertex.y(),
-				m_LED_model_vertex.z());
-        const Eigen::Vector3d predicted_led_position= local_to_world * led_model_vertex;
+        const Eigen::Matrix<T, 3, 1> predicted_led_position= local_to_world * m_LED_model_vertex;
 
         predicted_measurement.set_LED_position_meters(predicted_led_position);
 
@@ -628,8 +646,10 @@ public:
     }
 
 public:
-    Eigen::Vector3d m_LED_model_vertex; // in meters!
-    const Eigen::Quaterniond *m_last_world_orientation_ptr;
+    EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+
+    Eigen::Matrix<T, 3, 1> m_LED_model_vertex; // in meters!
+    const Eigen::Quaternion<T> *m_last_world_orientation_ptr;
     double m_time_step;
 	float m_last_tracking_projection_area_px_sqr;
 };
@@ -641,8 +661,8 @@ public:
 	KALMAN_VECTOR(PoseOrientationMeasurementVector, T, POSE_OPTICAL_MEASUREMENT_PARAMETER_COUNT)
 
     // Accessors
-	Eigen::Quaterniond get_optical_quaterniond() const {
-		return Eigen::Quaterniond(
+	Eigen::Quaternion<T> get_optical_quaternion() const {
+		return Eigen::Quaternion<T>(
 			(*this)[POSE_OPTICAL_QUATERNION_W], 
 			(*this)[POSE_OPTICAL_QUATERNION_X],
 			(*this)[POSE_OPTICAL_QUATERNION_Y], 
@@ -650,20 +670,23 @@ public:
 	}
 
     // Mutators
-	void set_optical_quaterniond(const Eigen::Quaterniond &q) {
+	void set_optical_quaternion(const Eigen::Quaternion<T> &q) {
 		(*this)[POSE_OPTICAL_QUATERNION_W] = q.w();
 		(*this)[POSE_OPTICAL_QUATERNION_X] = q.x();
 		(*this)[POSE_OPTICAL_QUATERNION_Y] = q.y();
 		(*this)[POSE_OPTICAL_QUATERNION_Z] = q.z();
 	}
 };
-typedef PoseOrientationMeasurementVector<double> PoseOrientationMeasurementVectord;
 
+template<typename T>
 class PoseOrientationMeasurementModel
-	: public Kalman::MeasurementModel<PoseStateVectord, PoseOrientationMeasurementVectord, Kalman::SquareRootBase>
+	: public Kalman::MeasurementModel<PoseStateVector<T>, PoseOrientationMeasurementVector<T>, Kalman::SquareRootBase>
 {
 public:
-	void init(const OrientationFilterConstants &constants, const Eigen::Quaterniond *last_world_orientation)
+	typedef PoseStateVector<T> StateVector;
+	typedef PoseOrientationMeasurementVector<T> MeasurementVector;
+
+	void init(const OrientationFilterConstants &constants, const Eigen::Quaternion<T> *last_world_orientation)
 	{
 		m_last_tracking_projection_area = -1.f;
 		m_last_world_orientation_ptr= last_world_orientation;
@@ -679,8 +702,8 @@ public:
 			!is_nearly_equal(tracking_projection_area, m_last_tracking_projection_area, 10.f))
 		{
 			// Update the measurement covariance R
-			Kalman::Covariance<PoseOrientationMeasurementVectord> R =
-				Kalman::Covariance<PoseOrientationMeasurementVectord>::Zero();
+			Kalman::Covariance<MeasurementVector> R =
+				Kalman::Covariance<MeasurementVector>::Zero();
 			const float orientation_variance = constants.orientation_variance_curve.evaluate(tracking_projection_area);
 
 			static float r_scale = R_SCALE;
@@ -688,7 +711,7 @@ public:
 			R(POSE_OPTICAL_QUATERNION_X, POSE_OPTICAL_QUATERNION_X) = r_scale*orientation_variance;
 			R(POSE_OPTICAL_QUATERNION_Y, POSE_OPTICAL_QUATERNION_Y) = r_scale*orientation_variance;
 			R(POSE_OPTICAL_QUATERNION_Z, POSE_OPTICAL_QUATERNION_Z) = r_scale*orientation_variance;
-			setCovariance(R);
+			this->setCovariance(R);
 
 			// Keep track last tracking projection area we built the covariance matrix for
 			m_last_tracking_projection_area = tracking_projection_area;
@@ -705,27 +728,43 @@ public:
 	* @param [in] x The system state in current time-step
 	* @returns The (predicted) sensor measurement for the system state
 	*/
-	PoseOrientationMeasurementVectord h(const PoseStateVectord& x) const
+	MeasurementVector h(const StateVector& x) const
 	{
-		PoseOrientationMeasurementVectord predicted_measurement;
+		MeasurementVector predicted_measurement;
 
 		// Use the orientation from the state for prediction
-		const Eigen::Quaterniond error_orientation = x.get_error_quaterniond();
-		const Eigen::Quaterniond world_to_local_orientation = 
+		const Eigen::Quaternion<T> error_orientation = x.get_error_quaternion();
+		const Eigen::Quaternion<T> world_to_local_orientation = 
 			eigen_quaternion_concatenate(*m_last_world_orientation_ptr, error_orientation).normalized();
 
 		// Save the predictions into the measurement vector
-		predicted_measurement.set_optical_quaterniond(world_to_local_orientation);
+		predicted_measurement.set_optical_quaternion(world_to_local_orientation);
 
 		return predicted_measurement;
 	}
 
 public:
 	float m_last_tracking_projection_area;
-	const Eigen::Quaterniond *m_last_world_orientation_ptr;
+	const Eigen::Quaternion<T> *m_last_world_orientation_ptr;
 };
 
+/// A copy of the state of a TKalmanPoseFilterImpl, used to rewind the filter
+template<typename T>
+struct KalmanPoseFilterSnapshot
+{
+    EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+
+    bool bIsValid;
+    bool bSeenPositionMeasurement;
+    bool bSeenOrientationMeasurement;
+    Eigen::Vector3f origin_position_meters;
+    PoseStateVector<T> state;
+    Kalman::CovarianceSquareRoot<PoseStateVector<T> > covariance_square_root;
+    double time;
+    Eigen::Quaternion<T> world_orientation;
+};
 
+/// Scalar type independent interface to the filter implementation used by KalmanPoseFilter
 class KalmanPoseFilterImpl
 {
 public:
@@ -741,109 +780,304 @@ public:
     /// Position that's considered the origin position 
     Eigen::Vector3f origin_position_meters; // meters
 
+    /// The duration the filter has been running
+    double time;
+
+    /// The constants the filter was initialized with
+    PoseFilterConstants constants;
+
+    KalmanPoseFilterImpl()
+        : bIsValid(false)
+        , bSeenPositionMeasurement(false)
+        , bSeenOrientationMeasurement(false)
+        , origin_position_meters(Eigen::Vector3f::Zero())
+        , time(0.0)
+    {
+        constants.clear();
+    }
+
+    virtual ~KalmanPoseFilterImpl()
+    {
+    }
+
+    virtual void init(const PoseFilterConstants &constants) = 0;
+    virtual void init(
+        const PoseFilterConstants &constants,
+        const Eigen::Vector3f &initial_position_meters,
+        const Eigen::Quaternionf &orientation) = 0;
+    virtual void update(const float delta_time, const PoseFilterPacket &packet) = 0;
+
+    virtual Eigen::Quaternionf get_world_quaternion() const = 0;
+    virtual Eigen::Vector3f get_position_meters() const = 0;
+    virtual Eigen::Vector3f get_linear_velocity_m_per_sec() const = 0;
+    virtual Eigen::Vector3f get_linear_acceleration_m_per_sec_sqr() const = 0;
+    virtual void recenter(const Eigen::Quaternionf &q_pose) = 0;
+
+    virtual void allocate_state_history(const int state_count) = 0;
+    virtual void save_state(const int state_index) = 0;
+    virtual void restore_state(const int state_index) = 0;
+};
+
+/// The filter state and UKF math for the scalar type T (double or float)
+template<typename T>
+class TKalmanPoseFilterImpl : public KalmanPoseFilterImpl
+{
+public:
+    EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+
+    typedef PoseStateVector<T> StateVector;
+    typedef PoseControlVector<T> ControlVector;
+    typedef KalmanPoseFilterSnapshot<T> Snapshot;
+
     /// Used to model how the physics of the controller evolves
-    PoseSystemModel system_model;
+    PoseSystemModel<T> system_model;
 
     /// Unscented Kalman Filter instance
-    PoseSRUKF ukf;
-
-    /// The duration the filter has been running
-    double time;
+    PoseSRUKF<T> ukf;
 
     /// The final output of this filter.
     /// This isn't part of the UKF state vector because it's non-linear.
     /// Instead we store an "error quaternion" in the UKF state vector and then apply it 
     /// to this quaternion after a time step and then zero out the error.
-    Eigen::Quaterniond world_orientation;
+    Eigen::Quaternion<T> world_orientation;
 
-    KalmanPoseFilterImpl()
-        : bIsValid(false)
-        , bSeenOrientationMeasurement(false)
+    /// Used to apply optical orientation measurements
+    PoseOrientationMeasurementModel<T> optical_measurement_model;
+
+    /// Saved filter states used to rewind the filter
+    std::vector<Snapshot, Eigen::aligned_allocator<Snapshot> > state_history;
+
+    TKalmanPoseFilterImpl()
+        : KalmanPoseFilterImpl()
         , system_model()
-        , ukf(k_ukf_alpha, k_ukf_beta, k_ukf_kappa)
-        , world_orientation(Eigen::Quaternionf::Identity())
-        , time(0.0)
+        , ukf(T(k_ukf_alpha), T(k_ukf_beta), T(k_ukf_kappa))
+        , world_orientation(Eigen::Quaternion<T>::Identity())
     {
     }
 
-    virtual void init(const PoseFilterConstants &constants)
+    void init(const PoseFilterConstants &filter_constants) override
     {
         bIsValid = false;
         bSeenOrientationMeasurement = false;
         bSeenPositionMeasurement= false;
+        constants= filter_constants;
 
-        world_orientation = Eigen::Quaterniond::Identity();
+        world_orientation = Eigen::Quaternion<T>::Identity();
         origin_position_meters = Eigen::Vector3f::Zero();
 
-        system_model.init(constants);
-        ukf.init(PoseStateVectord::Identity());
+        system_model.init(filter_constants);
+        ukf.init(StateVector::Identity());
+        optical_measurement_model.init(filter_constants.orientation_constants, &world_orientation);
     }
 
-    virtual void init(
-        const PoseFilterConstants &constants,
+    void init(
+        const PoseFilterConstants &filter_constants,
         const Eigen::Vector3f &initial_position_meters,
-        const Eigen::Quaternionf &orientation)
+        const Eigen::Quaternionf &orientation) override
     {
         bIsValid = true;
         bSeenOrientationMeasurement = true;
         bSeenPositionMeasurement= true;
+        constants= filter_constants;
 
         origin_position_meters = Eigen::Vector3f::Zero();
-        world_orientation = orientation.cast<double>();
+        world_orientation = orientation.cast<T>();
 
-        PoseStateVectord state_vector = PoseStateVectord::Identity();
-        state_vector.set_position_meters(initial_position_meters.cast<double>());
+        StateVector state_vector = StateVector::Identity();
+        state_vector.set_position_meters(initial_position_meters.cast<T>());
 
-        system_model.init(constants);
-        ukf.init(PoseStateVectord::Identity());
+        system_model.init(filter_constants);
+        ukf.init(StateVector::Identity());
         apply_error_to_world_quaternion();
+        optical_measurement_model.init(filter_constants.orientation_constants, &world_orientation);
     }
 
     // -- World Quaternion Accessors --
-    inline Eigen::Quaterniond compute_net_world_quaternion() const
+    inline Eigen::Quaternion<T> compute_net_world_quaternion() const
     {
-        const Eigen::Quaterniond error_quaternion= ukf.getState().get_error_quaterniond();
-        const Eigen::Quaterniond output_quaternion = eigen_quaternion_concatenate(world_orientation, error_quaternion).normalized();
+        const Eigen::Quaternion<T> error_quaternion= ukf.getState().get_error_quaternion();
+        const Eigen::Quaternion<T> output_quaternion = eigen_quaternion_concatenate(world_orientation, error_quaternion).normalized();
         return output_quaternion;
     }
 
+    Eigen::Quaternionf get_world_quaternion() const override
+    {
+        return compute_net_world_quaternion().template cast<float>();
+    }
+
+    // -- Position Accessors --
+    Eigen::Vector3f get_position_meters() const override
+    {
+        return ukf.getState().get_position_meters().template cast<float>();
+    }
+
+    Eigen::Vector3f get_linear_velocity_m_per_sec() const override
+    {
+        return ukf.getState().get_linear_velocity_m_per_sec().template cast<float>();
+    }
+
+    Eigen::Vector3f get_linear_acceleration_m_per_sec_sqr() const override
+    {
+        return ukf.getState().get_linear_acceleration_m_per_sec_sqr().template cast<float>();
+    }
+
     // -- World Quaternion Mutators --
-    inline void set_world_quaternion(const Eigen::Quaterniond &orientation)
+    inline void set_world_quaternion(const Eigen::Quaternion<T> &orientation)
     {
         world_orientation = orientation;
-        ukf.getStateMutable().set_error_quaterniond(Eigen::Quaterniond::Identity());
+        ukf.getStateMutable().set_error_quaternion(Eigen::Quaternion<T>::Identity());
     }
 
     void apply_error_to_world_quaternion()
     {
         set_world_quaternion(compute_net_world_quaternion());
     }
+
+    void recenter(const Eigen::Quaternionf &q_pose) override
+    {
+        world_orientation = q_pose.cast<T>();
+        ukf.init(StateVector::Identity());
+    }
+
+    // -- State History --
+    void allocate_state_history(const int state_count) override
+    {
+        state_history.resize(state_count);
+    }
+
+    void save_state(const int state_index) override
+    {
+        assert(state_index >= 0 && state_index < static_cast<int>(state_history.size()));
+        Snapshot &snapshot= state_history[state_index];
+
+        snapshot.bIsValid= bIsValid;
+        snapshot.bSeenPositionMeasurement= bSeenPositionMeasurement;
+        snapshot.bSeenOrientationMeasurement= bSeenOrientationMeasurement;
+        snapshot.origin_position_meters= origin_position_meters;
+        snapshot.state= ukf.getState();
+        snapshot.covariance_square_root= ukf.getCovarianceSquareRoot();
+        snapshot.time= time;
+        snapshot.world_orientation= world_orientation;
+    }
+
+    void restore_state(const int state_index) override
+    {
+        assert(state_index >= 0 && state_index < static_cast<int>(state_history.size()));
+        const Snapshot &snapshot= state_history[state_index];
+
+        bIsValid= snapshot.bIsValid;
+        bSeenPositionMeasurement= snapshot.bSeenPositionMeasurement;
+        bSeenOrientationMeasurement= snapshot.bSeenOrientationMeasurement;
+        origin_position_meters= snapshot.origin_position_meters;
+        ukf.getStateMutable()= snapshot.state;
+        ukf.getCovarianceSquareRootMutable()= snapshot.covariance_square_root;
+        time= snapshot.time;
+        world_orientation= snapshot.world_orientation;
+    }
+
+protected:
+    // -- Update Steps shared by all devices --
+    void predict_state(const float delta_time, const PoseFilterPacket &packet)
+    {
+        // Adjust the amount we trust the process model based on the tracking projection area
+        system_model.update_process_noise(
+            constants,
+            packet.tracking_projection_area_px_sqr);
+
+        // Predict state for current time-step using the filters
+        system_model.set_time_step(delta_time);
+
+        // Snap filter state if we haven't seen an optical measurement before
+        if (packet.has_optical_measurement())
+        {
+            assert(packet.tracking_projection_area_px_sqr > 0.f);
+
+            // If this is the first time we have seen the position, snap the position state
+            if (!bSeenPositionMeasurement)
+            {
+                const Eigen::Matrix<T, 3, 1> optical_position_meters = packet.get_optical_position_in_meters().cast<T>();
+
+                ukf.getStateMutable().set_position_meters(optical_position_meters);
+                bSeenPositionMeasurement = true;
+            }
+
+            // If this is the first time we have seen the orientation, snap the orientation state
+            if (!bSeenOrientationMeasurement)
+            {
+                const Eigen::Quaternion<T> world_quaternion = packet.optical_orientation.cast<T>();
+
+                set_world_quaternion(world_quaternion);
+                bSeenOrientationMeasurement = true;
+            }
+        }
+
+        // Apply a physics update to the filter state
+        if (packet.has_imu_measurements())
+        {
+            ControlVector control;
+            control.set_angular_rates(packet.imu_gyroscope_rad_per_sec.cast<T>());
+
+            ukf.predict(system_model, control);
+        }
+        else
+        {
+            ukf.predict(system_model);
+        }
+    }
+
+    void apply_optical_measurement(const PoseFilterPacket &packet)
+    {
+        // Apply any optical measurement to the filter
+        if (packet.has_optical_measurement())
+        {
+            assert(packet.tracking_projection_area_px_sqr > 0.f);
+            const Eigen::Quaternion<T> world_quaternion = packet.optical_orientation.cast<T>();
+
+            //TODO: Port over point area and shape point index for the LED measurement models
+
+            PoseOrientationMeasurementVector<T> measurement = PoseOrientationMeasurementVector<T>::Zero();
+            measurement.set_optical_quaternion(world_quaternion);
+            ukf.update(optical_measurement_model, measurement);
+        }
+    }
+
+    void finish_update(const float delta_time)
+    {
+        // Apply the orientation error in the UKF state to the output quaternion.
+        // Zero out the error in the UKF state vector.
+        apply_error_to_world_quaternion();
+        time += (double)delta_time;
+    }
+
+    void start_filter()
+    {
+        ukf.init(StateVector::Identity());
+        time = 0.0;
+        bIsValid = true;
+    }
 };
 
-class PointCloudKalmanPoseFilterImpl : public KalmanPoseFilterImpl
+template<typename T>
+class PointCloudKalmanPoseFilterImpl : public TKalmanPoseFilterImpl<T>
 {
 public:
+    EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+
+    typedef TKalmanPoseFilterImpl<T> Super;
+
 	virtual ~PointCloudKalmanPoseFilterImpl()
 	{
 		cleanup();
 	}
 
-    std::vector<PoseLEDMeasurementModel *> led_measurement_models;
-	PoseOrientationMeasurementModel optical_measurement_model;
+    std::vector<PoseLEDMeasurementModel<T> *> led_measurement_models;
 
     void init(const PoseFilterConstants &constants) override
     {
 		cleanup();
 
-        KalmanPoseFilterImpl::init(constants);
-		for (int led_index = 0; led_index < constants.shape.shape.point_cloud.point_count; ++led_index)
-		{
-			PoseLEDMeasurementModel*led_model = new PoseLEDMeasurementModel();
-
-			led_model->init(constants, led_index, &world_orientation);
-			led_measurement_models.push_back(led_model);
-		}
-		optical_measurement_model.init(constants.orientation_constants, &world_orientation);
+        Super::init(constants);
+		init_led_models(constants);
     }
 
     void init(
@@ -853,20 +1087,38 @@ public:
     {
 		cleanup();
 
-        KalmanPoseFilterImpl::init(constants, position, orientation);
+        Super::init(constants, position, orientation);
+		init_led_models(constants);
+    }
+
+	void update(const float delta_time, const PoseFilterPacket &packet) override
+	{
+		if (this->bIsValid)
+		{
+			this->predict_state(delta_time, packet);
+			this->apply_optical_measurement(packet);
+			this->finish_update(delta_time);
+		}
+		else
+		{
+			this->start_filter();
+		}
+	}
+
+	void init_led_models(const PoseFilterConstants &constants)
+	{
 		for (int led_index = 0; led_index < constants.shape.shape.point_cloud.point_count; ++led_index)
 		{
-			PoseLEDMeasurementModel*led_model = new PoseLEDMeasurementModel();
+			PoseLEDMeasurementModel<T> *led_model = new PoseLEDMeasurementModel<T>();
 
-			led_model->init(constants, led_index, &world_orientation);
+			led_model->init(constants, led_index, &this->world_orientation);
 			led_measurement_models.push_back(led_model);
 		}
-		optical_measurement_model.init(constants.orientation_constants, &world_orientation);
-    }
+	}
 
 	void cleanup()
 	{
-		for (PoseLEDMeasurementModel *model : led_measurement_models)
+		for (PoseLEDMeasurementModel<T> *model : led_measurement_models)
 		{
 			delete model;
 		}
@@ -874,30 +1126,29 @@ public:
 	}
 };
 
-class MorpheusKalmanPoseFilterImpl : public KalmanPoseFilterImpl
+template<typename T>
+class MorpheusKalmanPoseFilterImpl : public TKalmanPoseFilterImpl<T>
 {
 public:
+    EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+
+    typedef TKalmanPoseFilterImpl<T> Super;
+
 	virtual ~MorpheusKalmanPoseFilterImpl()
 	{
 		cleanup();
 	}
 
-	PoseGravMeasurementModel imu_measurement_model;
-	std::vector<PoseLEDMeasurementModel *> led_measurement_models;
-	PoseOrientationMeasurementModel optical_measurement_model;
+	PoseGravMeasurementModel<T> imu_measurement_model;
+	std::vector<PoseLEDMeasurementModel<T> *> led_measurement_models;
 
     void init(const PoseFilterConstants &constants) override
     {
-        KalmanPoseFilterImpl::init(constants);
-		imu_measurement_model.init(constants.orientation_constants, &world_orientation);
-		for (int led_index = 0; led_index < constants.shape.shape.point_cloud.point_count; ++led_index)
-		{
-			PoseLEDMeasurementModel*led_model = new PoseLEDMeasurementModel();
+		cleanup();
 
-			led_model->init(constants, led_index, &world_orientation);
-			led_measurement_models.push_back(led_model);
-		}
-		optical_measurement_model.init(constants.orientation_constants, &world_orientation);
+        Super::init(constants);
+		imu_measurement_model.init(constants.orientation_constants, &this->world_orientation);
+		init_led_models(constants);
 	}
 
     void init(
@@ -905,21 +1156,52 @@ public:
         const Eigen::Vector3f &position,
         const Eigen::Quaternionf &orientation) override
     {
-        KalmanPoseFilterImpl::init(constants, position, orientation);
-		imu_measurement_model.init(constants.orientation_constants, &world_orientation);
+		cleanup();
+
+        Super::init(constants, position, orientation);
+		imu_measurement_model.init(constants.orientation_constants, &this->world_orientation);
+		init_led_models(constants);
+	}
+
+	void update(const float delta_time, const PoseFilterPacket &packet) override
+	{
+		if (this->bIsValid)
+		{
+			this->predict_state(delta_time, packet);
+			this->apply_optical_measurement(packet);
+
+			// Apply any IMU measurement to the filter
+			if (packet.has_imu_measurements())
+			{
+				assert(packet.has_accelerometer_measurement);
+
+				PoseGravMeasurementVector<T> measurement = PoseGravMeasurementVector<T>::Zero();
+				measurement.set_accelerometer(packet.imu_accelerometer_g_units.cast<T>());
+				this->ukf.update(imu_measurement_model, measurement);
+			}
+
+			this->finish_update(delta_time);
+		}
+		else
+		{
+			this->start_filter();
+		}
+	}
+
+	void init_led_models(const PoseFilterConstants &constants)
+	{
 		for (int led_index = 0; led_index < constants.shape.shape.point_cloud.point_count; ++led_index)
 		{
-			PoseLEDMeasurementModel*led_model = new PoseLEDMeasurementModel();
+			PoseLEDMeasurementModel<T> *led_model = new PoseLEDMeasurementModel<T>();
 
-			led_model->init(constants, led_index, &world_orientation);
+			led_model->init(constants, led_index, &this->world_orientation);
 			led_measurement_models.push_back(led_model);
 		}
-		optical_measurement_model.init(constants.orientation_constants, &world_orientation);
 	}
 
 	void cleanup()
 	{
-		for (PoseLEDMeasurementModel *model : led_measurement_models)
+		for (PoseLEDMeasurementModel<T> *model : led_measurement_models)
 		{
 			delete model;
 		}
@@ -927,18 +1209,21 @@ public:
 	}
 };
 
-class DS4KalmanPoseFilterImpl : public KalmanPoseFilterImpl
+template<typename T>
+class DS4KalmanPoseFilterImpl : public TKalmanPoseFilterImpl<T>
 {
 public:
-	PoseGravMeasurementModel imu_measurement_model;
-	PoseOrientationMeasurementModel optical_measurement_model;
+    EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+
+    typedef TKalmanPoseFilterImpl<T> Super;
+
+	PoseGravMeasurementModel<T> imu_measurement_model;
 
 	void init(
 		const PoseFilterConstants &constants) override
 	{
-        KalmanPoseFilterImpl::init(constants);
-		imu_measurement_model.init(constants.orientation_constants, &world_orientation);
-		optical_measurement_model.init(constants.orientation_constants, &world_orientation);
+        Super::init(constants);
+		imu_measurement_model.init(constants.orientation_constants, &this->world_orientation);
 	}
 
 	void init(
@@ -946,24 +1231,51 @@ public:
 		const Eigen::Vector3f &position,
 		const Eigen::Quaternionf &orientation) override
 	{
-        KalmanPoseFilterImpl::init(constants, position, orientation);
-		imu_measurement_model.init(constants.orientation_constants, &world_orientation);
-		optical_measurement_model.init(constants.orientation_constants, &world_orientation);
+        Super::init(constants, position, orientation);
+		imu_measurement_model.init(constants.orientation_constants, &this->world_orientation);
+	}
+
+	void update(const float delta_time, const PoseFilterPacket &packet) override
+	{
+		if (this->bIsValid)
+		{
+			this->predict_state(delta_time, packet);
+			this->apply_optical_measurement(packet);
+
+			// Apply any IMU measurement to the filter
+			if (packet.has_imu_measurements())
+			{
+				assert(packet.has_accelerometer_measurement);
+
+				PoseGravMeasurementVector<T> measurement = PoseGravMeasurementVector<T>::Zero();
+				measurement.set_accelerometer(packet.imu_accelerometer_g_units.cast<T>());
+				this->ukf.update(imu_measurement_model, measurement);
+			}
+
+			this->finish_update(delta_time);
+		}
+		else
+		{
+			this->start_filter();
+		}
 	}
 };
 
-class PSMoveKalmanPoseFilterImpl : public KalmanPoseFilterImpl
+template<typename T>
+class PSMoveKalmanPoseFilterImpl : public TKalmanPoseFilterImpl<T>
 {
 public:
-	PoseMagGravMeasurementModel imu_measurement_model;
-	PoseOrientationMeasurementModel optical_measurement_model;
+    EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+
+    typedef TKalmanPoseFilterImpl<T> Super;
+
+	PoseMagGravMeasurementModel<T> imu_measurement_model;
 
 	void init(
 		const PoseFilterConstants &constants) override
 	{
-        KalmanPoseFilterImpl::init(constants);
-		imu_measurement_model.init(constants.orientation_constants, &world_orientation);
-		optical_measurement_model.init(constants.orientation_constants, &world_orientation);
+        Super::init(constants);
+		imu_measurement_model.init(constants.orientation_constants, &this->world_orientation);
 	}
 
 	void init(
@@ -971,16 +1283,54 @@ public:
 		const Eigen::Vector3f &position,
 		const Eigen::Quaternionf &orientation) override
 	{
-        KalmanPoseFilterImpl::init(constants, position, orientation);
-		imu_measurement_model.init(constants.orientation_constants, &world_orientation);
-		optical_measurement_model.init(constants.orientation_constants, &world_orientation);
+        Super::init(constants, position, orientation);
+		imu_measurement_model.init(constants.orientation_constants, &this->world_orientation);
+	}
+
+	void update(const float delta_time, const PoseFilterPacket &packet) override
+	{
+		if (this->bIsValid)
+		{
+			this->predict_state(delta_time, packet);
+			this->apply_optical_measurement(packet);
+
+			// Apply any IMU measurement to the filter
+			if (packet.has_imu_measurements())
+			{
+				assert(packet.has_accelerometer_measurement);
+
+				PoseMagGravMeasurementVector<T> measurement = PoseMagGravMeasurementVector<T>::Zero();
+				measurement.set_accelerometer(packet.imu_accelerometer_g_units.cast<T>());
+				measurement.set_magnetometer(packet.imu_magnetometer_unit.cast<T>());
+				this->ukf.update(imu_measurement_model, measurement);
+			}
+
+			this->finish_update(delta_time);
+		}
+		else
+		{
+			this->start_filter();
+		}
 	}
 };
 
+// The filter implementations come in double and float precision.
+// The float versions do roughly half the math work per update, at the cost of some numeric drift.
+template class PointCloudKalmanPoseFilterImpl<double>;
+template class PointCloudKalmanPoseFilterImpl<float>;
+template class MorpheusKalmanPoseFilterImpl<double>;
+template class MorpheusKalmanPoseFilterImpl<float>;
+template class DS4KalmanPoseFilterImpl<double>;
+template class DS4KalmanPoseFilterImpl<float>;
+template class PSMoveKalmanPoseFilterImpl<double>;
+template class PSMoveKalmanPoseFilterImpl<float>;
+
 //-- public interface --
 //-- KalmanPoseFilter --
-KalmanPoseFilter::KalmanPoseFilter()
-    : m_filter(nullptr)
+KalmanPoseFilter::KalmanPoseFilter(const KalmanFilterScalarType scalar_type)
+    : m_scalar_type(scalar_type)
+    , m_filter(nullptr)
+    , m_state_history_count(0)
 {
     memset(&m_constants, 0, sizeof(PoseFilterConstants));
 }
@@ -990,7 +1340,7 @@ KalmanPoseFilter::~KalmanPoseFilter()
     if (m_filter != nullptr)
     {
         delete m_filter;
-        m_filter;
+        m_filter= nullptr;
     }
 }
 
@@ -1002,12 +1352,16 @@ bool KalmanPoseFilter::init(const PoseFilterConstants &constants)
     if (m_filter != nullptr)
     {
         delete m_filter;
-        m_filter;
+        m_filter= nullptr;
     }
 
     // Create and initialize the private filter implementation
-    KalmanPoseFilterImpl *filter = new KalmanPoseFilterImpl();
+    KalmanPoseFilterImpl *filter = allocate_filter();
     filter->init(constants);
+    if (m_state_history_count > 0)
+    {
+        filter->allocate_state_history(m_state_history_count);
+    }
     m_filter = filter;
 
     return true;
@@ -1024,12 +1378,16 @@ bool KalmanPoseFilter::init(
     if (m_filter != nullptr)
     {
         delete m_filter;
-        m_filter;
+        m_filter= nullptr;
     }
 
     // Create and initialize the private filter implementation
-    KalmanPoseFilterImpl *filter = new KalmanPoseFilterImpl();
+    KalmanPoseFilterImpl *filter = allocate_filter();
     filter->init(constants, position, orientation);
+    if (m_state_history_count > 0)
+    {
+        filter->allocate_state_history(m_state_history_count);
+    }
     m_filter = filter;
 
     return true;
@@ -1055,6 +1413,11 @@ double KalmanPoseFilter::getTimeInSeconds() const
     return m_filter->time;
 }
 
+void KalmanPoseFilter::update(const float delta_time, const PoseFilterPacket &packet)
+{
+    m_filter->update(delta_time, packet);
+}
+
 void KalmanPoseFilter::resetState()
 {
     m_filter->init(m_constants);
@@ -1062,8 +1425,29 @@ void KalmanPoseFilter::resetState()
 
 void KalmanPoseFilter::recenterOrientation(const Eigen::Quaternionf& q_pose)
 {
-    m_filter->world_orientation = q_pose.cast<double>();
-    m_filter->ukf.init(PoseStateVectord::Identity());
+    m_filter->recenter(q_pose);
+}
+
+bool KalmanPoseFilter::allocateStateHistory(const int state_count)
+{
+    m_state_history_count = state_count;
+
+    if (m_filter != nullptr)
+    {
+        m_filter->allocate_state_history(state_count);
+    }
+
+    return true;
+}
+
+void KalmanPoseFilter::saveState(const int state_index)
+{
+    m_filter->save_state(state_index);
+}
+
+void KalmanPoseFilter::restoreState(const int state_index)
+{
+    m_filter->restore_state(state_index);
 }
 
 Eigen::Quaternionf KalmanPoseFilter::getOrientation(float time) const
@@ -1072,7 +1456,7 @@ Eigen::Quaternionf KalmanPoseFilter::getOrientation(float time) const
 
     if (m_filter->bIsValid)
     {
-        const Eigen::Quaternionf state_orientation = m_filter->compute_net_world_quaternion().cast<float>();
+        const Eigen::Quaternionf state_orientation = m_filter->get_world_quaternion();
         Eigen::Quaternionf predicted_orientation = state_orientation;
 
         if (fabsf(time) > k_real_epsilon)
@@ -1109,8 +1493,8 @@ Eigen::Vector3f KalmanPoseFilter::getPositionCm(float time) const
 
     if (m_filter->bIsValid)
     {
-        Eigen::Vector3f state_position_meters= m_filter->ukf.getState().get_position_meters().cast<float>();
-		Eigen::Vector3f state_velocity_m_per_sec = m_filter->ukf.getState().get_linear_velocity_m_per_sec().cast<float>();
+        Eigen::Vector3f state_position_meters= m_filter->get_position_meters();
+		Eigen::Vector3f state_velocity_m_per_sec = m_filter->get_linear_velocity_m_per_sec();
         Eigen::Vector3f predicted_position =
             is_nearly_zero(time)
             ? state_position_meters
@@ -1124,509 +1508,68 @@ Eigen::Vector3f KalmanPoseFilter::getPositionCm(float time) const
 
 Eigen::Vector3f KalmanPoseFilter::getVelocityCmPerSec() const
 {
-	Eigen::Vector3d vel= m_filter->ukf.getState().get_linear_velocity_m_per_sec() * k_meters_to_centimeters;
-
-    return vel.cast<float>();
+	return m_filter->get_linear_velocity_m_per_sec() * k_meters_to_centimeters;
 }
 
 Eigen::Vector3f KalmanPoseFilter::getAccelerationCmPerSecSqr() const
 {
-    Eigen::Vector3d accel= m_filter->ukf.getState().get_linear_acceleration_m_per_sec_sqr() * k_meters_to_centimeters;
-
-	return accel.cast<float>();
-}
-
-//-- KalmanPoseFilterPointCloud --
-bool KalmanPoseFilterPointCloud::init(const PoseFilterConstants &constants)
-{
-    KalmanPoseFilter::init(constants);
-
-    PointCloudKalmanPoseFilterImpl *filter = new PointCloudKalmanPoseFilterImpl();
-    filter->init(constants);
-    m_filter = filter;
-
-    return true;
+	return m_filter->get_linear_acceleration_m_per_sec_sqr() * k_meters_to_centimeters;
 }
 
-bool KalmanPoseFilterPointCloud::init(
-    const PoseFilterConstants &constants,
-    const Eigen::Vector3f &position,
-    const Eigen::Quaternionf &orientation)
+bool KalmanPoseFilter::getIsBatched() const
 {
-    KalmanPoseFilter::init(constants);
-
-    PointCloudKalmanPoseFilterImpl *filter = new PointCloudKalmanPoseFilterImpl();
-    filter->init(constants, position, orientation);
-    m_filter = filter;
-
-    return true;
+	return false;
 }
 
-void KalmanPoseFilterPointCloud::update(const float delta_time, const PoseFilterPacket &packet)
+//-- KalmanPoseFilterPointCloud --
+KalmanPoseFilterImpl *KalmanPoseFilterPointCloud::allocate_filter() const
 {
-    if (m_filter->bIsValid)
-    {
-        PointCloudKalmanPoseFilterImpl *filter = static_cast<PointCloudKalmanPoseFilterImpl *>(m_filter);
-		PoseOrientationMeasurementModel &optical_measurement_model = filter->optical_measurement_model;
-
-        // Adjust the amount we trust the process model based on the total tracking projection area
-        filter->system_model.update_process_noise(
-			m_constants, 
-			packet.tracking_projection_area_px_sqr);
-
-        // Predict state for current time-step using the filters
-        filter->system_model.set_time_step(delta_time);
-
-		// Snap filter state if we haven't seen an optical measurement before
-		if (packet.has_optical_measurement())
-		{
-			assert(packet.tracking_projection_area_px_sqr > 0.f);
-
-			// If this is the first time we have seen the position, snap the position state
-			if (!m_filter->bSeenPositionMeasurement)
-			{
-				const Eigen::Vector3d optical_position_meters = packet.get_optical_position_in_meters().cast<double>();
-
-				m_filter->ukf.getStateMutable().set_position_meters(optical_position_meters);
-				m_filter->bSeenPositionMeasurement = true;
-			}
-
-			// If this is the first time we have seen the orientation, snap the orientation state
-			if (!m_filter->bSeenOrientationMeasurement)
-			{
-				const Eigen::Quaterniond world_quaternion = packet.optical_orientation.cast<double>();
-
-				filter->set_world_quaternion(world_quaternion);
-				m_filter->bSeenOrientationMeasurement = true;
-			}
-		}
-
-		// Apply a physics update to the filter state
-		if (packet.has_imu_measurements())
-		{
-			PoseControlVectord control;
-			control.set_angular_rates(packet.imu_gyroscope_rad_per_sec.cast<double>());
-
-			filter->ukf.predict(filter->system_model, control);
-		}
-		else
-		{
-			filter->ukf.predict(filter->system_model);
-		}
-
-		// Apply any optical measurement to the filter
-		if (packet.has_optical_measurement())
-		{
-			assert(packet.tracking_projection_area_px_sqr > 0.f);
-			const Eigen::Quaterniond world_quaternion = packet.optical_orientation.cast<double>();
-
-			//TODO: Port over point area and shape point index
-			//for (int model_led_index = 0; model_led_index < packet.optical_tracking_shape_cm.shape.pointcloud.point_count; ++model_led_index)
-			//{
-			//	const float led_screen_area= 
-			//		PSVR_PointCloudTrackingProjectionGetPointArea(
-			//			&packet.optical_tracking_projection, model_led_index);
-
-			//	if (led_screen_area > 0.f)
-			//	{
-			//		const PSVRVector3f &p = packet.optical_tracking_shape_cm.shape.pointcloud.points[model_led_index];
-			//		
-			//		PoseLEDMeasurementModel *led_model= filter->led_measurement_models[model_led_index];
-			//		led_model->updateMeasurementCovariance(m_constants, led_screen_area);
-
-			//		PoseLEDMeasurementVectord led_measurement = PoseLEDMeasurementVectord::Zero();
-			//		led_measurement.set_LED_position_meters(
-			//			Eigen::Vector3d(
-			//				static_cast<double>(p.x * k_centimeters_to_meters), 
-			//				static_cast<double>(p.y * k_centimeters_to_meters),
-			//				static_cast<double>(p.z * k_centimeters_to_meters)));
-
-			//		filter->ukf.update(*led_model, led_measurement);
-			//	}
-			//}
-
-			PoseOrientationMeasurementVectord measurement = PoseOrientationMeasurementVectord::Zero();
-			measurement.set_optical_quaterniond(world_quaternion);
-			filter->ukf.update(optical_measurement_model, measurement);
-		}
-
-        // Apply the orientation error in the UKF state to the output quaternion.
-        // Zero out the error in the UKF state vector.
-        filter->apply_error_to_world_quaternion();
-
-        filter->time+= (double)delta_time;
-    }
-    else
-    {
-        m_filter->ukf.init(PoseStateVectord::Identity());
-        m_filter->time= 0.0;
-        m_filter->bIsValid = true;
-    }
+	if (m_scalar_type == KalmanFilterScalarFloat)
+	{
+		return new PointCloudKalmanPoseFilterImpl<float>();
+	}
+	else
+	{
+		return new PointCloudKalmanPoseFilterImpl<double>();
+	}
 }
 
 //-- KalmanPoseFilterMorpheus --
-bool KalmanPoseFilterMorpheus::init(const PoseFilterConstants &constants)
+KalmanPoseFilterImpl *KalmanPoseFilterMorpheus::allocate_filter() const
 {
-    KalmanPoseFilter::init(constants);
-
-    MorpheusKalmanPoseFilterImpl *filter = new MorpheusKalmanPoseFilterImpl();
-    filter->init(constants);
-    m_filter = filter;
-
-    return true;
-}
-
-bool KalmanPoseFilterMorpheus::init(
-    const PoseFilterConstants &constants,
-    const Eigen::Vector3f &position,
-    const Eigen::Quaternionf &orientation)
-{
-    KalmanPoseFilter::init(constants);
-
-    MorpheusKalmanPoseFilterImpl *filter = new MorpheusKalmanPoseFilterImpl();
-    filter->init(constants, position, orientation);
-    m_filter = filter;
-
-    return true;
-}
-
-void KalmanPoseFilterMorpheus::update(const float delta_time, const PoseFilterPacket &packet)
-{
-	if (m_filter->bIsValid)
+	if (m_scalar_type == KalmanFilterScalarFloat)
 	{
-		MorpheusKalmanPoseFilterImpl *filter = static_cast<MorpheusKalmanPoseFilterImpl *>(m_filter);
-		PoseOrientationMeasurementModel &optical_measurement_model = filter->optical_measurement_model;
-		PoseGravMeasurementModel &imu_measurement_model= filter->imu_measurement_model;
-
-		// Adjust the amount we trust the process model based on the tracking projection area
-		filter->system_model.update_process_noise(
-			m_constants,
-			packet.tracking_projection_area_px_sqr);
-
-		// Predict state for current time-step using the filters
-		filter->system_model.set_time_step(delta_time);
-
-		// Snap filter state if we haven't seen an optical measurement before
-		if (packet.has_optical_measurement())
-		{
-			assert(packet.tracking_projection_area_px_sqr > 0.f);
-
-			// If this is the first time we have seen the position, snap the position state
-			if (!m_filter->bSeenPositionMeasurement)
-			{
-				const Eigen::Vector3d optical_position_meters = packet.get_optical_position_in_meters().cast<double>();
-
-				m_filter->ukf.getStateMutable().set_position_meters(optical_position_meters);
-				m_filter->bSeenPositionMeasurement = true;
-			}
-
-			// If this is the first time we have seen the orientation, snap the orientation state
-			if (!m_filter->bSeenOrientationMeasurement)
-			{
-				const Eigen::Quaterniond world_quaternion = packet.optical_orientation.cast<double>();
-
-				filter->set_world_quaternion(world_quaternion);
-				m_filter->bSeenOrientationMeasurement = true;
-			}
-		}
-
-		// Apply a physics update to the filter state
-		if (packet.has_imu_measurements())
-		{
-			PoseControlVectord control;
-			control.set_angular_rates(packet.imu_gyroscope_rad_per_sec.cast<double>());
-
-			filter->ukf.predict(filter->system_model, control);
-		}
-		else
-		{
-			filter->ukf.predict(filter->system_model);
-		}
-
-		// Apply any optical measurement to the filter
-		if (packet.has_optical_measurement())
-		{
-			assert(packet.tracking_projection_area_px_sqr > 0.f);
-			const Eigen::Quaterniond world_quaternion = packet.optical_orientation.cast<double>();
-
-			//TODO: Port over point area and shape point index
-			//for (int model_led_index = 0; model_led_index < packet.optical_tracking_shape_cm.shape.pointcloud.point_count; ++model_led_index)
-			//{
-			//	const float led_screen_area= 
-			//		PSVR_PointCloudTrackingProjectionGetPointArea(
-			//			&packet.optical_tracking_projection, model_led_index);
-
-			//	if (led_screen_area > 0.f)
-			//	{
-			//		const PSVRVector3f &p = packet.optical_tracking_shape_cm.shape.pointcloud.points[model_led_index];
-
-			//		// Update parameters on the LED model before applying the measurement
-			//		PoseLEDMeasurementModel *led_model = filter->led_measurement_models[model_led_index];
-			//		led_model->updateMeasurementCovariance(m_constants, led_screen_area);
-
-			//		PoseLEDMeasurementVectord led_measurement = PoseLEDMeasurementVectord::Zero();
-			//		led_measurement.set_LED_position_meters(
-			//			Eigen::Vector3d(
-			//				static_cast<double>(p.x * k_centimeters_to_meters),
-			//				static_cast<double>(p.y * k_centimeters_to_meters),
-			//				static_cast<double>(p.z * k_centimeters_to_meters)));
-
-			//		filter->ukf.update(*led_model, led_measurement);
-			//	}
-			//}
-
-			PoseOrientationMeasurementVectord measurement = PoseOrientationMeasurementVectord::Zero();
-			measurement.set_optical_quaterniond(world_quaternion);
-			filter->ukf.update(optical_measurement_model, measurement);
-		}
-
-		// Apply any IMU measurement to the filter
-		if (packet.has_imu_measurements())
-		{
-			assert(packet.has_accelerometer_measurement);
-
-			PoseGravMeasurementVectord measurement = PoseGravMeasurementVectord::Zero();
-			measurement.set_accelerometer(packet.imu_accelerometer_g_units.cast<double>());
-			filter->ukf.update(filter->imu_measurement_model, measurement);
-		}
-
-		// Apply the orientation error in the UKF state to the output quaternion.
-		// Zero out the error in the UKF state vector.
-		filter->apply_error_to_world_quaternion();
-		filter->time += (double)delta_time;
+		return new MorpheusKalmanPoseFilterImpl<float>();
 	}
 	else
 	{
-		m_filter->ukf.init(PoseStateVectord::Identity());
-		m_filter->time = 0.0;
-		m_filter->bIsValid = true;
+		return new MorpheusKalmanPoseFilterImpl<double>();
 	}
 }
 
 //-- KalmanPoseFilterDS4 --
-bool KalmanPoseFilterDS4::init(
-	const PoseFilterConstants &constants)
-{
-	KalmanPoseFilter::init(constants);
-
-	DS4KalmanPoseFilterImpl *filter = new DS4KalmanPoseFilterImpl();
-	filter->init(constants);
-	m_filter = filter;
-
-	return true;
-}
-
-bool KalmanPoseFilterDS4::init(
-	const PoseFilterConstants &constants,
-	const Eigen::Vector3f &position, 
-	const Eigen::Quaternionf &orientation)
+KalmanPoseFilterImpl *KalmanPoseFilterDS4::allocate_filter() const
 {
-    KalmanPoseFilter::init(constants, position, orientation);
-
-    DS4KalmanPoseFilterImpl *filter = new DS4KalmanPoseFilterImpl();
-    filter->init(constants, position, orientation);
-    m_filter = filter;
-
-    return true;
-}
-
-void KalmanPoseFilterDS4::update(const float delta_time, const PoseFilterPacket &packet)
-{
-	if (m_filter->bIsValid)
+	if (m_scalar_type == KalmanFilterScalarFloat)
 	{
-		DS4KalmanPoseFilterImpl *filter = static_cast<DS4KalmanPoseFilterImpl *>(m_filter);
-		PoseOrientationMeasurementModel &optical_measurement_model = filter->optical_measurement_model;
-		PoseGravMeasurementModel &imu_measurement_model= filter->imu_measurement_model;
-
-		// Adjust the amount we trust the process model based on the tracking projection area
-		filter->system_model.update_process_noise(
-			m_constants,
-			packet.tracking_projection_area_px_sqr);
-
-		// Predict state for current time-step using the filters
-		filter->system_model.set_time_step(delta_time);
-
-		// Snap filter state if we haven't seen an optical measurement before
-		if (packet.has_optical_measurement())
-		{
-			assert(packet.tracking_projection_area_px_sqr > 0.f);
-
-			// If this is the first time we have seen the position, snap the position state
-			if (!m_filter->bSeenPositionMeasurement)
-			{
-				const Eigen::Vector3d optical_position_meters = packet.get_optical_position_in_meters().cast<double>();
-
-				m_filter->ukf.getStateMutable().set_position_meters(optical_position_meters);
-				m_filter->bSeenPositionMeasurement = true;
-			}
-
-			// If this is the first time we have seen the orientation, snap the orientation state
-			if (!m_filter->bSeenOrientationMeasurement)
-			{
-				const Eigen::Quaterniond world_quaternion = packet.optical_orientation.cast<double>();
-
-				filter->set_world_quaternion(world_quaternion);
-				m_filter->bSeenOrientationMeasurement = true;
-			}
-		}
-
-		// Apply a physics update to the filter state
-		if (packet.has_imu_measurements())
-		{
-			PoseControlVectord control;
-			control.set_angular_rates(packet.imu_gyroscope_rad_per_sec.cast<double>());
-
-			filter->ukf.predict(filter->system_model, control);
-		}
-		else
-		{
-			filter->ukf.predict(filter->system_model);
-		}
-
-		// Apply any optical measurement to the filter
-		if (packet.has_optical_measurement())
-		{
-			assert(packet.tracking_projection_area_px_sqr > 0.f);
-			const Eigen::Quaterniond world_quaternion = packet.optical_orientation.cast<double>();
-			PoseOrientationMeasurementVectord measurement = PoseOrientationMeasurementVectord::Zero();
-			measurement.set_optical_quaterniond(world_quaternion);
-			filter->ukf.update(optical_measurement_model, measurement);
-		}
-
-		// Apply any IMU measurement to the filter
-		if (packet.has_imu_measurements())
-		{
-			assert(packet.has_accelerometer_measurement);
-
-			PoseGravMeasurementVectord measurement = PoseGravMeasurementVectord::Zero();
-			measurement.set_accelerometer(packet.imu_accelerometer_g_units.cast<double>());
-			filter->ukf.update(filter->imu_measurement_model, measurement);
-		}
-
-		// Apply the orientation error in the UKF state to the output quaternion.
-		// Zero out the error in the UKF state vector.
-		filter->apply_error_to_world_quaternion();
-		filter->time += (double)delta_time;
+		return new DS4KalmanPoseFilterImpl<float>();
 	}
 	else
 	{
-		m_filter->ukf.init(PoseStateVectord::Identity());
-		m_filter->time = 0.0;
-		m_filter->bIsValid = true;
+		return new DS4KalmanPoseFilterImpl<double>();
 	}
 }
 
 //-- PSMovePoseKalmanFilter --
-bool KalmanPoseFilterPSMove::init(
-	const PoseFilterConstants &constants)
-{
-	KalmanPoseFilter::init(constants);
-
-	PSMoveKalmanPoseFilterImpl *filter = new PSMoveKalmanPoseFilterImpl();
-	filter->init(constants);
-	m_filter = filter;
-
-	return true;
-}
-
-bool KalmanPoseFilterPSMove::init(
-	const PoseFilterConstants &constants,
-	const Eigen::Vector3f &position,
-	const Eigen::Quaternionf &orientation)
+KalmanPoseFilterImpl *KalmanPoseFilterPSMove::allocate_filter() const
 {
-    KalmanPoseFilter::init(constants, position, orientation);
-
-    PSMoveKalmanPoseFilterImpl *filter = new PSMoveKalmanPoseFilterImpl();
-    filter->init(constants, position, orientation);
-    m_filter = filter;
-
-    return true;
-}
-
-void KalmanPoseFilterPSMove::update(const float delta_time, const PoseFilterPacket &packet)
-{
-	if (m_filter->bIsValid)
+	if (m_scalar_type == KalmanFilterScalarFloat)
 	{
-		PSMoveKalmanPoseFilterImpl *filter = static_cast<PSMoveKalmanPoseFilterImpl *>(m_filter);
-		PoseOrientationMeasurementModel &optical_measurement_model = filter->optical_measurement_model;
-		PoseMagGravMeasurementModel &imu_measurement_model= filter->imu_measurement_model;
-
-		// Adjust the amount we trust the process model based on the tracking projection area
-		filter->system_model.update_process_noise(
-			m_constants,
-			packet.tracking_projection_area_px_sqr);
-
-		// Predict state for current time-step using the filters
-		filter->system_model.set_time_step(delta_time);
-
-		// Snap filter state if we haven't seen an optical measurement before
-		if (packet.has_optical_measurement())
-		{
-			assert(packet.tracking_projection_area_px_sqr > 0.f);
-
-			// If this is the first time we have seen the position, snap the position state
-			if (!m_filter->bSeenPositionMeasurement)
-			{
-				const Eigen::Vector3d optical_position_meters = packet.get_optical_position_in_meters().cast<double>();
-
-				m_filter->ukf.getStateMutable().set_position_meters(optical_position_meters);
-				m_filter->bSeenPositionMeasurement = true;
-			}
-
-			// If this is the first time we have seen the orientation, snap the orientation state
-			if (!m_filter->bSeenOrientationMeasurement)
-			{
-				const Eigen::Quaterniond world_quaternion = packet.optical_orientation.cast<double>();
-
-				filter->set_world_quaternion(world_quaternion);
-				m_filter->bSeenOrientationMeasurement = true;
-			}
-		}
-
-		// Apply a physics update to the filter state
-		if (packet.has_imu_measurements())
-		{
-			PoseControlVectord control;
-			control.set_angular_rates(packet.imu_gyroscope_rad_per_sec.cast<double>());
-
-			filter->ukf.predict(filter->system_model, control);
-		}
-		else
-		{
-			filter->ukf.predict(filter->system_model);
-		}
-
-		// Apply any optical measurement to the filter
-		if (packet.has_optical_measurement())
-		{
-			assert(packet.tracking_projection_area_px_sqr > 0.f);
-			const Eigen::Quaterniond world_quaternion = packet.optical_orientation.cast<double>();
-			PoseOrientationMeasurementVectord measurement = PoseOrientationMeasurementVectord::Zero();
-			measurement.set_optical_quaterniond(world_quaternion);
-			filter->ukf.update(optical_measurement_model, measurement);
-		}
-
-		// Apply any IMU measurement to the filter
-		if (packet.has_imu_measurements())
-		{
-			assert(packet.has_accelerometer_measurement);
-
-			PoseMagGravMeasurementVectord measurement = PoseMagGravMeasurementVectord::Zero();
-			measurement.set_accelerometer(packet.imu_accelerometer_g_units.cast<double>());
-			measurement.set_magnetometer(packet.imu_magnetometer_unit.cast<double>());
-			filter->ukf.update(filter->imu_measurement_model, measurement);
-		}
-
-		// Apply the orientation error in the UKF state to the output quaternion.
-		// Zero out the error in the UKF state vector.
-		filter->apply_error_to_world_quaternion();
-		filter->time += (double)delta_time;
+		return new PSMoveKalmanPoseFilterImpl<float>();
 	}
 	else
 	{
-		m_filter->ukf.init(PoseStateVectord::Identity());
-		m_filter->time = 0.0;
-		m_filter->bIsValid = true;
+		return new PSMoveKalmanPoseFilterImpl<double>();
 	}
 }
 
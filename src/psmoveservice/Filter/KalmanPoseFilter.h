@@ -3,11 +3,12 @@
 
 #include "PoseFilterInterface.h"
 
-/// Base Kalman Pose filter
+/// Base Kalman Pose filter.
+/// The filter math runs in either double or float precision, picked when the filter is constructed.
 class KalmanPoseFilter : public IPoseFilter
 {
 public:
-	KalmanPoseFilter();
+	KalmanPoseFilter(const KalmanFilterScalarType scalar_type);
 	virtual ~KalmanPoseFilter();
 
     virtual bool init(const PoseFilterConstants &constant);
@@ -18,8 +19,12 @@ public:
 	// -- IStateFilter --
 	bool getIsStateValid() const override;
     double getTimeInSeconds() const override;
+	void update(const float delta_time, const PoseFilterPacket &packet) override;
 	void resetState() override;
 	void recenterOrientation(const Eigen::Quaternionf& q_pose) override;
+	bool allocateStateHistory(const int state_count) override;
+	void saveState(const int state_index) override;
+	void restoreState(const int state_index) override;
 
 	// -- IPoseFilter ---
     /// Not true until the filter has updated at least once
@@ -46,49 +51,68 @@ public:
     /// Get the current velocity of the filter state (cm/s^2)
     Eigen::Vector3f getAccelerationCmPerSecSqr() const override;
 
+    /// Kalman pose filters keep all of their state to themselves
+    bool getIsBatched() const override;
+    void completeBatchedUpdate() override {}
+
+	inline KalmanFilterScalarType getScalarType() const { return m_scalar_type; }
+
 protected:
+	/// Create the device specific filter implementation for m_scalar_type
+	virtual class KalmanPoseFilterImpl *allocate_filter() const = 0;
+
 	PoseFilterConstants m_constants;
+	KalmanFilterScalarType m_scalar_type;
 	class KalmanPoseFilterImpl *m_filter;
+	int m_state_history_count;
 };
 
 /// Kalman Pose filter for Optical Point Cloud
 class KalmanPoseFilterPointCloud : public KalmanPoseFilter
 {
 public:
-	bool init(const PoseFilterConstants &constant) override;
-	bool init(const PoseFilterConstants &constant, 
-              const Eigen::Vector3f &initial_position,
-              const Eigen::Quaternionf &initial_orientation) override;
-	void update(const float delta_time, const PoseFilterPacket &packet) override;
+	KalmanPoseFilterPointCloud(const KalmanFilterScalarType scalar_type = KalmanFilterScalarDouble)
+		: KalmanPoseFilter(scalar_type)
+	{}
+
+protected:
+	class KalmanPoseFilterImpl *allocate_filter() const override;
 };
 
 /// Kalman Pose filter for Optical Point Cloud + Angular Rate(Gyroscope) + Gravity(Accelerometer)
 class KalmanPoseFilterMorpheus : public KalmanPoseFilter
 {
 public:
-	bool init(const PoseFilterConstants &constant) override;
-	bool init(const PoseFilterConstants &constant, 
-              const Eigen::Vector3f &initial_position,
-              const Eigen::Quaternionf &initial_orientation) override;
-	void update(const float delta_time, const PoseFilterPacket &packet) override;
+	KalmanPoseFilterMorpheus(const KalmanFilterScalarType scalar_type = KalmanFilterScalarDouble)
+		: KalmanPoseFilter(scalar_type)
+	{}
+
+protected:
+	class KalmanPoseFilterImpl *allocate_filter() const override;
 };
 
 /// Kalman Pose filter for Optical Pose + Angular Rate(Gyroscope) + Gravity(Accelerometer)
 class KalmanPoseFilterDS4 : public KalmanPoseFilter
 {
 public:
-	bool init(const PoseFilterConstants &constant) override;
-	bool init(const PoseFilterConstants &constant, const Eigen::Vector3f &position, const Eigen::Quaternionf &orientation) override;
-	void update(const float delta_time, const PoseFilterPacket &packet) override;
+	KalmanPoseFilterDS4(const KalmanFilterScalarType scalar_type = KalmanFilterScalarDouble)
+		: KalmanPoseFilter(scalar_type)
+	{}
+
+protected:
+	class KalmanPoseFilterImpl *allocate_filter() const override;
 };
 
 /// Kalman Pose filter for Optical Position + Magnetometer + Angular Rate(Gyroscope) + Gravity(Accelerometer)
 class KalmanPoseFilterPSMove : public KalmanPoseFilter
 {
 public:
-	bool init(const PoseFilterConstants &constant) override;
-	bool init(const PoseFilterConstants &constant, const Eigen::Vector3f &position, const Eigen::Quaternionf &orientation) override;
-	void update(const float delta_time, const PoseFilterPacket &packet) override;
+	KalmanPoseFilterPSMove(const KalmanFilterScalarType scalar_type = KalmanFilterScalarDouble)
+		: KalmanPoseFilter(scalar_type)
+	{}
+
+protected:
+	class KalmanPoseFilterImpl *allocate_filter() const override;
 };
 
 #endif // KALMAN_POSE_FILTER_H
\ No newline at end of file
@@ -2,6 +2,7 @@
 #include "KalmanPositionFilter.h"
 #include "MathAlignment.h"
 
+#include <assert.h>
 #include <kalman/MeasurementModel.hpp>
 #include <kalman/SystemModel.hpp>
 #include <kalman/SquareRootBase.hpp>
@@ -238,6 +239,11 @@ public:
 	{
 		return x;
 	}
+
+	Kalman::CovarianceSquareRoot<PositionStateVectord>& getCovarianceSquareRootMutable()
+	{
+		return S;
+	}
 };
 
 /**
@@ -334,6 +340,19 @@ protected:
 	float m_last_tracking_projection_area_px_sqr;
 };
 
+/// A copy of the state of a KalmanPositionFilterImpl, used to rewind the filter
+struct KalmanPositionFilterSnapshot
+{
+	EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+
+	bool bIsValid;
+	bool bSeenPositionMeasurement;
+	Eigen::Vector3f origin_position_meters;
+	PositionStateVectord state;
+	Kalman::CovarianceSquareRoot<PositionStateVectord> covariance_square_root;
+	double time;
+};
+
 class KalmanPositionFilterImpl
 {
 public:
@@ -391,12 +410,35 @@ public:
 		ukf.init(state_vector);
         time= 0.0;
 	}
+
+	// -- State History --
+	void save_state(KalmanPositionFilterSnapshot &snapshot) const
+	{
+		snapshot.bIsValid= bIsValid;
+		snapshot.bSeenPositionMeasurement= bSeenPositionMeasurement;
+		snapshot.origin_position_meters= origin_position_meters;
+		snapshot.state= ukf.getState();
+		snapshot.covariance_square_root= ukf.getCovarianceSquareRoot();
+		snapshot.time= time;
+	}
+
+	void restore_state(const KalmanPositionFilterSnapshot &snapshot)
+	{
+		bIsValid= snapshot.bIsValid;
+		bSeenPositionMeasurement= snapshot.bSeenPositionMeasurement;
+		origin_position_meters= snapshot.origin_position_meters;
+		ukf.getStateMutable()= snapshot.state;
+		ukf.getCovarianceSquareRootMutable()= snapshot.covariance_square_root;
+		time= snapshot.time;
+	}
 };
 
 //-- public interface --
 //-- KalmanFilterOpticalPoseARG --
 KalmanPositionFilter::KalmanPositionFilter() 
     : m_filter(nullptr)
+    , m_state_history(nullptr)
+    , m_state_history_count(0)
 {
     memset(&m_constants, 0, sizeof(PositionFilterConstants));
 }
@@ -408,6 +450,8 @@ KalmanPositionFilter::~KalmanPositionFilter()
         delete m_filter;
         m_filter;
     }
+
+    delete[] m_state_history;
 }
 
 bool KalmanPositionFilter::init(const PositionFilterConstants &constants)
@@ -571,6 +615,27 @@ void KalmanPositionFilter::recenterOrientation(const Eigen::Quaternionf& q_pose)
 {
 }
 
+bool KalmanPositionFilter::allocateStateHistory(const int state_count)
+{
+    delete[] m_state_history;
+    m_state_history = new KalmanPositionFilterSnapshot[state_count];
+    m_state_history_count = state_count;
+
+    return true;
+}
+
+void KalmanPositionFilter::saveState(const int state_index)
+{
+    assert(state_index >= 0 && state_index < m_state_history_count);
+    m_filter->save_state(m_state_history[state_index]);
+}
+
+void KalmanPositionFilter::restoreState(const int state_index)
+{
+    assert(state_index >= 0 && state_index < m_state_history_count);
+    m_filter->restore_state(m_state_history[state_index]);
+}
+
 Eigen::Vector3f KalmanPositionFilter::getPositionCm(float time) const
 {
     Eigen::Vector3f result = Eigen::Vector3f::Zero();
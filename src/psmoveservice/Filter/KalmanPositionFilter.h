@@ -19,6 +19,9 @@ public:
     double getTimeInSeconds() const override;
 	void resetState() override;
 	void recenterOrientation(const Eigen::Quaternionf& q_pose) override;
+	bool allocateStateHistory(const int state_count) override;
+	void saveState(const int state_index) override;
+	void restoreState(const int state_index) override;
 
 	// -- IPositionFilter ---
 	Eigen::Vector3f getPositionCm(float time = 0.f) const override;
@@ -28,6 +31,8 @@ public:
 protected:
 	PositionFilterConstants m_constants;
 	class KalmanPositionFilterImpl *m_filter;
+	struct KalmanPositionFilterSnapshot *m_state_history; // array of size m_state_history_count
+	int m_state_history_count;
 };
 
 #endif // KALMAN_POSITION_FILTER_H
\ No newline at end of file
@@ -2,6 +2,7 @@
 #include "OrientationFilter.h"
 #include "MathAlignment.h"
 #include "ServerLog.h"
+#include <assert.h>
 #include <deque>
 
 //-- constants -----
@@ -61,7 +62,7 @@ struct OrientationFilterState
         }
         else
         {
-            SERVER_LOG_WARNING("OrientationFilter") << "Orientation is NaN!";
+            SERVER_MT_LOG_WARNING("OrientationFilter") << "Orientation is NaN!";
         }
 
         if (eigen_vector3f_is_valid(new_angular_velocity))
@@ -70,7 +71,7 @@ struct OrientationFilterState
         }
         else
         {
-            SERVER_LOG_WARNING("OrientationFilter") << "Angular Velocity is NaN!";
+            SERVER_MT_LOG_WARNING("OrientationFilter") << "Angular Velocity is NaN!";
         }
 
         if (eigen_vector3f_is_valid(new_angular_acceleration))
@@ -79,7 +80,7 @@ struct OrientationFilterState
         }
         else
         {
-            SERVER_LOG_WARNING("OrientationFilter") << "Angular Acceleration is NaN!";
+            SERVER_MT_LOG_WARNING("OrientationFilter") << "Angular Acceleration is NaN!";
         }
 
 		if (is_valid_float(delta_time))
@@ -89,7 +90,7 @@ struct OrientationFilterState
 		}
 		else
 		{
-			SERVER_LOG_WARNING("PositionFilter") << "time delta is NaN!";
+			SERVER_MT_LOG_WARNING("PositionFilter") << "time delta is NaN!";
 		}
 
         // state is valid now that we have had an update
@@ -106,7 +107,7 @@ struct OrientationFilterState
         }
         else
         {
-            SERVER_LOG_WARNING("OrientationFilter") << "Orientation is NaN!";
+            SERVER_MT_LOG_WARNING("OrientationFilter") << "Orientation is NaN!";
         }
 
 		if (is_valid_float(delta_time))
@@ -116,7 +117,7 @@ struct OrientationFilterState
 		}
 		else
 		{
-			SERVER_LOG_WARNING("PositionFilter") << "time delta is NaN!";
+			SERVER_MT_LOG_WARNING("PositionFilter") << "time delta is NaN!";
 		}
 
         // state is valid now that we have had an update
@@ -131,7 +132,7 @@ struct OrientationFilterState
 		}
 		else
 		{
-			SERVER_LOG_WARNING("PositionFilter") << "optical time delta is NaN!";
+			SERVER_MT_LOG_WARNING("PositionFilter") << "optical time delta is NaN!";
 		}
 	}
 
@@ -143,7 +144,7 @@ struct OrientationFilterState
 		}
 		else
 		{
-			SERVER_LOG_WARNING("PositionFilter") << "imu time delta is NaN!";
+			SERVER_MT_LOG_WARNING("PositionFilter") << "imu time delta is NaN!";
 		}
 	}
 };
@@ -151,7 +152,9 @@ struct OrientationFilterState
 // -- public interface -----
 //-- Orientation Filter --
 OrientationFilter::OrientationFilter() :
-    m_state(new OrientationFilterState)
+    m_state(new OrientationFilterState),
+    m_state_history(nullptr),
+    m_state_history_count(0)
 {
     memset(&m_constants, 0, sizeof(OrientationFilterConstants));
     resetState();
@@ -160,6 +163,7 @@ OrientationFilter::OrientationFilter() :
 OrientationFilter::~OrientationFilter()
 {
     delete m_state;
+    delete[] m_state_history;
 }
 
 bool OrientationFilter::getIsStateValid() const
@@ -185,6 +189,27 @@ void OrientationFilter::recenterOrientation(const Eigen::Quaternionf& q_pose)
     m_state->reset_orientation= q_pose*q_inverse;
 }
 
+bool OrientationFilter::allocateStateHistory(const int state_count)
+{
+    delete[] m_state_history;
+    m_state_history= new OrientationFilterState[state_count];
+    m_state_history_count= state_count;
+
+    return true;
+}
+
+void OrientationFilter::saveState(const int state_index)
+{
+    assert(state_index >= 0 && state_index < m_state_history_count);
+    m_state_history[state_index]= *m_state;
+}
+
+void OrientationFilter::restoreState(const int state_index)
+{
+    assert(state_index >= 0 && state_index < m_state_history_count);
+    *m_state= m_state_history[state_index];
+}
+
 bool OrientationFilter::init(const OrientationFilterConstants &constants)
 {
     resetState();
@@ -345,6 +370,29 @@ void OrientationFilterMadgwickMARG::resetState()
     m_omega_bias_x= m_omega_bias_y= m_omega_bias_z= 0.f;
 }
 
+bool OrientationFilterMadgwickMARG::allocateStateHistory(const int state_count)
+{
+    m_omega_bias_history.resize(state_count);
+
+    return OrientationFilterMadgwickARG::allocateStateHistory(state_count);
+}
+
+void OrientationFilterMadgwickMARG::saveState(const int state_index)
+{
+    OrientationFilterMadgwickARG::saveState(state_index);
+    m_omega_bias_history[state_index]= Eigen::Vector3f(m_omega_bias_x, m_omega_bias_y, m_omega_bias_z);
+}
+
+void OrientationFilterMadgwickMARG::restoreState(const int state_index)
+{
+    OrientationFilterMadgwickARG::restoreState(state_index);
+
+    const Eigen::Vector3f &omega_bias= m_omega_bias_history[state_index];
+    m_omega_bias_x= omega_bias.x();
+    m_omega_bias_y= omega_bias.y();
+    m_omega_bias_z= omega_bias.z();
+}
+
 void OrientationFilterMadgwickMARG::update(const float delta_time, const PoseFilterPacket &packet)
 {
 	if (packet.has_imu_measurements())
@@ -596,6 +644,25 @@ void OrientationFilterComplementaryMARG::resetState()
     mg_weight= 1.f;
 }
 
+bool OrientationFilterComplementaryMARG::allocateStateHistory(const int state_count)
+{
+    mg_weight_history.resize(state_count);
+
+    return OrientationFilter::allocateStateHistory(state_count);
+}
+
+void OrientationFilterComplementaryMARG::saveState(const int state_index)
+{
+    OrientationFilter::saveState(state_index);
+    mg_weight_history[state_index]= mg_weight;
+}
+
+void OrientationFilterComplementaryMARG::restoreState(const int state_index)
+{
+    OrientationFilter::restoreState(state_index);
+    mg_weight= mg_weight_history[state_index];
+}
+
 void OrientationFilterComplementaryMARG::update(const float delta_time, const PoseFilterPacket &packet)
 {
 	if (packet.has_imu_measurements())
@@ -3,6 +3,7 @@
 
 //-- includes -----
 #include "PoseFilterInterface.h"
+#include <vector>
 
 //-- definitions --
 /// Abstract base class for all orientation only filters
@@ -17,6 +18,9 @@ public:
     double getTimeInSeconds() const override;
     void resetState() override;
     void recenterOrientation(const Eigen::Quaternionf& q_pose) override;
+    bool allocateStateHistory(const int state_count) override;
+    void saveState(const int state_index) override;
+    void restoreState(const int state_index) override;
 
     // -- IOrientationFilter --
     bool init(const OrientationFilterConstants &constant) override;
@@ -28,6 +32,8 @@ public:
 protected:
     OrientationFilterConstants m_constants;
     struct OrientationFilterState *m_state;
+    struct OrientationFilterState *m_state_history; // array of size m_state_history_count
+    int m_state_history_count;
 };
 
 /// Just use the optical orientation passed in unfiltered
@@ -56,12 +62,16 @@ public:
     {}
 
     void resetState() override;
+    bool allocateStateHistory(const int state_count) override;
+    void saveState(const int state_index) override;
+    void restoreState(const int state_index) override;
     void update(const float delta_time, const PoseFilterPacket &packet) override;
 
 protected:
     float m_omega_bias_x;
     float m_omega_bias_y;
     float m_omega_bias_z;
+    std::vector<Eigen::Vector3f> m_omega_bias_history;
 };
 
 /// Angular Rate, Gravity, and Optical fusion algorithm
@@ -83,10 +93,14 @@ public:
     {}
 
     void resetState() override;
+    bool allocateStateHistory(const int state_count) override;
+    void saveState(const int state_index) override;
+    void restoreState(const int state_index) override;
     void update(const float delta_time, const PoseFilterPacket &packet) override;
 
 protected:
     float mg_weight;
+    std::vector<float> mg_weight_history;
 };
 
 #endif // ORIENTATION_FILTER_H
\ No newline at end of file
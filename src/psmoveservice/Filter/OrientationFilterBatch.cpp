@@ -0,0 +1,898 @@
+// -- includes -----
+#include "OrientationFilterBatch.h"
+#include "MathAlignment.h"
+#include "ServerLog.h"
+#include <assert.h>
+
+//-- constants -----
+// Lanes are allocated in blocks this wide so the lane loops
+// always cover whole vector registers (8 floats = one AVX register)
+#define k_lane_block_size 8
+
+// Complementary MARG Filter constants (see OrientationFilter.cpp)
+#define k_base_earth_frame_align_weight 0.02f
+
+// Mag-Grav alignment constants (see eigen_alignment_quaternion_between_vector_frames)
+#define k_alignment_tolerance 0.1f
+#define k_alignment_max_iterations 32
+
+// -- private methods -----
+static inline float select_float(const bool bCondition, const float a, const float b);
+static inline void quaternion_multiply(
+    const float aw, const float ax, const float ay, const float az,
+    const float bw, const float bx, const float by, const float bz,
+    float &out_w, float &out_x, float &out_y, float &out_z);
+static inline void quaternion_normalize(float &w, float &x, float &y, float &z);
+static inline void copy_block(const float *block, const int block_size, float *out_channel);
+static inline void compute_alignment_objective(
+    const float qw, const float qx, const float qy, const float qz,
+    const float dx, const float dy, const float dz,
+    const float sx, const float sy, const float sz,
+    float &out_fx, float &out_fy, float &out_fz);
+static inline void accumulate_alignment_gradient(
+    const float qw, const float qx, const float qy, const float qz,
+    const float dx, const float dy, const float dz,
+    const float fx, const float fy, const float fz,
+    const float weight,
+    float &inout_g0, float &inout_g1, float &inout_g2, float &inout_g3);
+
+// -- public interface -----
+//-- Orientation Filter Batch --
+OrientationFilterBatch::OrientationFilterBatch(const int max_lane_count)
+    : m_lane_capacity(((max_lane_count + k_lane_block_size - 1) / k_lane_block_size) * k_lane_block_size)
+    , m_bDeferUpdates(false)
+    , m_staged_lane_count(0)
+    , m_channels(LANE_CHANNEL_COUNT * m_lane_capacity, 0.f)
+    , m_lane_types(m_lane_capacity, -1)
+    , m_is_valid(m_lane_capacity, 0)
+    , m_is_staged(m_lane_capacity, 0)
+    , m_delta_time(m_lane_capacity, 0.f)
+    , m_time(m_lane_capacity, 0.0)
+    , m_accumulated_imu_time_delta(m_lane_capacity, 0.0)
+    , m_accumulated_optical_time_delta(m_lane_capacity, 0.0)
+{
+    assert(max_lane_count > 0);
+}
+
+int OrientationFilterBatch::allocateLane(const OrientationFilterBatchType filter_type)
+{
+    for (int lane = 0; lane < m_lane_capacity; ++lane)
+    {
+        if (m_lane_types[lane] == -1)
+        {
+            m_lane_types[lane]= filter_type;
+            resetLane(lane);
+
+            return lane;
+        }
+    }
+
+    return -1;
+}
+
+void OrientationFilterBatch::freeLane(const int lane)
+{
+    assert(lane >= 0 && lane < m_lane_capacity);
+    assert(m_lane_types[lane] != -1);
+
+    resetLane(lane);
+    m_lane_types[lane]= -1;
+}
+
+void OrientationFilterBatch::initLane(const int lane, const OrientationFilterConstants &constants)
+{
+    resetLane(lane);
+
+    getChannel(CHANNEL_GRAVITY_X)[lane]= constants.gravity_calibration_direction.x();
+    getChannel(CHANNEL_GRAVITY_Y)[lane]= constants.gravity_calibration_direction.y();
+    getChannel(CHANNEL_GRAVITY_Z)[lane]= constants.gravity_calibration_direction.z();
+    getChannel(CHANNEL_MAGNETOMETER_X)[lane]= constants.magnetometer_calibration_direction.x();
+    getChannel(CHANNEL_MAGNETOMETER_Y)[lane]= constants.magnetometer_calibration_direction.y();
+    getChannel(CHANNEL_MAGNETOMETER_Z)[lane]= constants.magnetometer_calibration_direction.z();
+    getChannel(CHANNEL_BETA)[lane]=
+        sqrtf(3.0f / 4.0f) * fmaxf(fmaxf(constants.gyro_variance.x(), constants.gyro_variance.y()), constants.gyro_variance.z());
+}
+
+void OrientationFilterBatch::resetLane(const int lane)
+{
+    assert(lane >= 0 && lane < m_lane_capacity);
+
+    if (m_is_staged[lane] != 0)
+    {
+        m_is_staged[lane]= 0;
+        --m_staged_lane_count;
+    }
+
+    getChannel(CHANNEL_QW)[lane]= 1.f;
+    getChannel(CHANNEL_QX)[lane]= 0.f;
+    getChannel(CHANNEL_QY)[lane]= 0.f;
+    getChannel(CHANNEL_QZ)[lane]= 0.f;
+    getChannel(CHANNEL_BIAS_X)[lane]= 0.f;
+    getChannel(CHANNEL_BIAS_Y)[lane]= 0.f;
+    getChannel(CHANNEL_BIAS_Z)[lane]= 0.f;
+    getChannel(CHANNEL_MG_WEIGHT)[lane]= 1.f;
+
+    m_is_valid[lane]= 0;
+    m_delta_time[lane]= 0.f;
+    m_time[lane]= 0.0;
+    m_accumulated_imu_time_delta[lane]= 0.0;
+    m_accumulated_optical_time_delta[lane]= 0.0;
+}
+
+void OrientationFilterBatch::setDeferUpdates(const bool bDeferUpdates)
+{
+    if (m_bDeferUpdates && !bDeferUpdates)
+    {
+        // Don't leave anything staged once updates apply right away again
+        update();
+    }
+
+    m_bDeferUpdates= bDeferUpdates;
+}
+
+void OrientationFilterBatch::updateLane(const int lane, const float delta_time, const PoseFilterPacket &packet)
+{
+    assert(lane >= 0 && lane < m_lane_capacity);
+    assert(m_lane_types[lane] != -1);
+
+    // A lane holds at most one staged update
+    flushLane(lane);
+
+    if (!packet.has_imu_measurements())
+    {
+        // None of the batched filters use optical measurements,
+        // just keep track of the time since the last IMU update
+        if (is_valid_float(delta_time))
+        {
+            m_accumulated_imu_time_delta[lane]+= (double)delta_time;
+        }
+        else
+        {
+            SERVER_MT_LOG_WARNING("OrientationFilterBatch") << "imu time delta is NaN!";
+        }
+
+        return;
+    }
+
+    Eigen::Vector3f current_g= packet.imu_accelerometer_g_units;
+    eigen_vector3f_normalize_with_default(current_g, Eigen::Vector3f::Zero());
+
+    Eigen::Vector3f current_m= packet.imu_magnetometer_unit;
+    eigen_vector3f_normalize_with_default(current_m, Eigen::Vector3f::Zero());
+
+    // Without a gravity direction the Madgwick filters just integrate the gyroscope,
+    // and without a magnetometer direction the MARG filter falls back to the ARG update
+    const bool bUseGravity= !current_g.isZero(k_normal_epsilon);
+    const bool bUseMagnetometer=
+        m_lane_types[lane] == OrientationFilterBatchMadgwickMARG &&
+        bUseGravity &&
+        !current_m.isZero(k_normal_epsilon);
+
+    // Time delta used for filter update is time delta passed in
+    // plus the accumulated time since the packet hasn't has an IMU measurement
+    getChannel(CHANNEL_TOTAL_DELTA_TIME)[lane]= (float)m_accumulated_imu_time_delta[lane] + delta_time;
+    getChannel(CHANNEL_GYRO_X)[lane]= packet.imu_gyroscope_rad_per_sec.x();
+    getChannel(CHANNEL_GYRO_Y)[lane]= packet.imu_gyroscope_rad_per_sec.y();
+    getChannel(CHANNEL_GYRO_Z)[lane]= packet.imu_gyroscope_rad_per_sec.z();
+    getChannel(CHANNEL_ACCEL_X)[lane]= current_g.x();
+    getChannel(CHANNEL_ACCEL_Y)[lane]= current_g.y();
+    getChannel(CHANNEL_ACCEL_Z)[lane]= current_g.z();
+    getChannel(CHANNEL_MAG_X)[lane]= current_m.x();
+    getChannel(CHANNEL_MAG_Y)[lane]= current_m.y();
+    getChannel(CHANNEL_MAG_Z)[lane]= current_m.z();
+    getChannel(CHANNEL_USE_GRAVITY)[lane]= bUseGravity ? 1.f : 0.f;
+    getChannel(CHANNEL_USE_MAGNETOMETER)[lane]= bUseMagnetometer ? 1.f : 0.f;
+    m_delta_time[lane]= delta_time;
+
+    m_is_staged[lane]= 1;
+    ++m_staged_lane_count;
+
+    if (!m_bDeferUpdates)
+    {
+        flushLane(lane);
+    }
+}
+
+void OrientationFilterBatch::flushLane(const int lane)
+{
+    if (m_is_staged[lane] == 0)
+    {
+        return;
+    }
+
+    if (m_lane_types[lane] == OrientationFilterBatchComplementaryMARG)
+    {
+        advance_complementary_lanes(lane, lane + 1);
+    }
+    else
+    {
+        advance_madgwick_lanes(lane, lane + 1);
+    }
+
+    commit_lane(lane);
+}
+
+void OrientationFilterBatch::update()
+{
+    if (m_staged_lane_count == 0)
+    {
+        return;
+    }
+
+    bool bHasStagedMadgwickLane= false;
+    bool bHasStagedComplementaryLane= false;
+    for (int lane = 0; lane < m_lane_capacity; ++lane)
+    {
+        if (m_is_staged[lane] != 0)
+        {
+            bHasStagedMadgwickLane|= m_lane_types[lane] != OrientationFilterBatchComplementaryMARG;
+            bHasStagedComplementaryLane|= m_lane_types[lane] == OrientationFilterBatchComplementaryMARG;
+        }
+    }
+
+    // Run each filter kernel once across all of the lanes.
+    // Lanes that aren't staged (or run the other filter) compute results that just get ignored.
+    // Both kernels write the same output channels, so commit one kernel's lanes before running the other.
+    if (bHasStagedMadgwickLane)
+    {
+        advance_madgwick_lanes(0, m_lane_capacity);
+        commit_staged_lanes(false);
+    }
+
+    if (bHasStagedComplementaryLane)
+    {
+        advance_complementary_lanes(0, m_lane_capacity);
+        commit_staged_lanes(true);
+    }
+}
+
+Eigen::Quaternionf OrientationFilterBatch::getLaneOrientation(const int lane) const
+{
+    return Eigen::Quaternionf(
+        getChannel(CHANNEL_QW)[lane],
+        getChannel(CHANNEL_QX)[lane],
+        getChannel(CHANNEL_QY)[lane],
+        getChannel(CHANNEL_QZ)[lane]);
+}
+
+void OrientationFilterBatch::setLaneOrientation(const int lane, const Eigen::Quaternionf &orientation)
+{
+    getChannel(CHANNEL_QW)[lane]= orientation.w();
+    getChannel(CHANNEL_QX)[lane]= orientation.x();
+    getChannel(CHANNEL_QY)[lane]= orientation.y();
+    getChannel(CHANNEL_QZ)[lane]= orientation.z();
+    m_is_valid[lane]= 1;
+}
+
+void OrientationFilterBatch::saveLaneState(const int lane, OrientationFilterBatchLaneState &out_state) const
+{
+    out_state.orientation[0]= getChannel(CHANNEL_QW)[lane];
+    out_state.orientation[1]= getChannel(CHANNEL_QX)[lane];
+    out_state.orientation[2]= getChannel(CHANNEL_QY)[lane];
+    out_state.orientation[3]= getChannel(CHANNEL_QZ)[lane];
+    out_state.omega_bias[0]= getChannel(CHANNEL_BIAS_X)[lane];
+    out_state.omega_bias[1]= getChannel(CHANNEL_BIAS_Y)[lane];
+    out_state.omega_bias[2]= getChannel(CHANNEL_BIAS_Z)[lane];
+    out_state.mg_weight= getChannel(CHANNEL_MG_WEIGHT)[lane];
+    out_state.time= m_time[lane];
+    out_state.accumulated_imu_time_delta= m_accumulated_imu_time_delta[lane];
+    out_state.accumulated_optical_time_delta= m_accumulated_optical_time_delta[lane];
+    out_state.bIsValid= m_is_valid[lane] != 0;
+}
+
+void OrientationFilterBatch::restoreLaneState(const int lane, const OrientationFilterBatchLaneState &state)
+{
+    // A staged update came after the state being restored, so it gets dropped
+    if (m_is_staged[lane] != 0)
+    {
+        m_is_staged[lane]= 0;
+        --m_staged_lane_count;
+    }
+
+    getChannel(CHANNEL_QW)[lane]= state.orientation[0];
+    getChannel(CHANNEL_QX)[lane]= state.orientation[1];
+    getChannel(CHANNEL_QY)[lane]= state.orientation[2];
+    getChannel(CHANNEL_QZ)[lane]= state.orientation[3];
+    getChannel(CHANNEL_BIAS_X)[lane]= state.omega_bias[0];
+    getChannel(CHANNEL_BIAS_Y)[lane]= state.omega_bias[1];
+    getChannel(CHANNEL_BIAS_Z)[lane]= state.omega_bias[2];
+    getChannel(CHANNEL_MG_WEIGHT)[lane]= state.mg_weight;
+    m_time[lane]= state.time;
+    m_accumulated_imu_time_delta[lane]= state.accumulated_imu_time_delta;
+    m_accumulated_optical_time_delta[lane]= state.accumulated_optical_time_delta;
+    m_is_valid[lane]= state.bIsValid ? 1 : 0;
+}
+
+// -- private methods -----
+// This algorithm comes from Sebastian O.H. Madgwick's 2010 paper:
+// "An efficient orientation filter for inertial and inertial/magnetic sensor arrays"
+// https://www.samba.org/tridge/UAV/madgwick_internal_report.pdf
+// Same math as OrientationFilterMadgwickARG/MARG::update, written without branches
+// so the loop over the lanes vectorizes.
+void OrientationFilterBatch::advance_madgwick_lanes(const int begin_lane, const int end_lane)
+{
+    const float *qw= getChannel(CHANNEL_QW);
+    const float *qx= getChannel(CHANNEL_QX);
+    const float *qy= getChannel(CHANNEL_QY);
+    const float *qz= getChannel(CHANNEL_QZ);
+    const float *bias_x= getChannel(CHANNEL_BIAS_X);
+    const float *bias_y= getChannel(CHANNEL_BIAS_Y);
+    const float *bias_z= getChannel(CHANNEL_BIAS_Z);
+    const float *gravity_x= getChannel(CHANNEL_GRAVITY_X);
+    const float *gravity_y= getChannel(CHANNEL_GRAVITY_Y);
+    const float *gravity_z= getChannel(CHANNEL_GRAVITY_Z);
+    const float *magnetometer_x= getChannel(CHANNEL_MAGNETOMETER_X);
+    const float *magnetometer_y= getChannel(CHANNEL_MAGNETOMETER_Y);
+    const float *magnetometer_z= getChannel(CHANNEL_MAGNETOMETER_Z);
+    const float *beta= getChannel(CHANNEL_BETA);
+    const float *total_delta_time= getChannel(CHANNEL_TOTAL_DELTA_TIME);
+    const float *gyro_x= getChannel(CHANNEL_GYRO_X);
+    const float *gyro_y= getChannel(CHANNEL_GYRO_Y);
+    const float *gyro_z= getChannel(CHANNEL_GYRO_Z);
+    const float *accel_x= getChannel(CHANNEL_ACCEL_X);
+    const float *accel_y= getChannel(CHANNEL_ACCEL_Y);
+    const float *accel_z= getChannel(CHANNEL_ACCEL_Z);
+    const float *mag_x= getChannel(CHANNEL_MAG_X);
+    const float *mag_y= getChannel(CHANNEL_MAG_Y);
+    const float *mag_z= getChannel(CHANNEL_MAG_Z);
+    const float *use_gravity= getChannel(CHANNEL_USE_GRAVITY);
+    const float *use_magnetometer= getChannel(CHANNEL_USE_MAGNETOMETER);
+
+    for (int block_begin = begin_lane; block_begin < end_lane; block_begin+= k_lane_block_size)
+    {
+        const int block_size= (end_lane - block_begin < k_lane_block_size) ? end_lane - block_begin : k_lane_block_size;
+
+        // Results go to local arrays first so the compiler doesn't have to
+        // prove that the output channels don't overlap the input channels
+        float block_qw[k_lane_block_size], block_qx[k_lane_block_size], block_qy[k_lane_block_size], block_qz[k_lane_block_size];
+        float block_bias_x[k_lane_block_size], block_bias_y[k_lane_block_size], block_bias_z[k_lane_block_size];
+
+        for (int block_lane = 0; block_lane < block_size; ++block_lane)
+        {
+            const int lane= block_begin + block_lane;
+            const float w= qw[lane], x= qx[lane], y= qy[lane], z= qz[lane];
+            const float dt= total_delta_time[lane];
+            const bool bUseMagnetometer= use_magnetometer[lane] > 0.f;
+
+            // Eqn 15) Objective function for the gravity (and magnetometer) alignment
+            float f_gx, f_gy, f_gz;
+            compute_alignment_objective(
+                w, x, y, z,
+                gravity_x[lane], gravity_y[lane], gravity_z[lane],
+                accel_x[lane], accel_y[lane], accel_z[lane],
+                f_gx, f_gy, f_gz);
+
+            float f_mx, f_my, f_mz;
+            compute_alignment_objective(
+                w, x, y, z,
+                magnetometer_x[lane], magnetometer_y[lane], magnetometer_z[lane],
+                mag_x[lane], mag_y[lane], mag_z[lane],
+                f_mx, f_my, f_mz);
+
+            // Eqn 34) gradient_F= J_gb(SEq, Eb)*f(SEq, Sa, Eb, Sm)
+            float g0= 0.f, g1= 0.f, g2= 0.f, g3= 0.f;
+            accumulate_alignment_gradient(
+                w, x, y, z,
+                gravity_x[lane], gravity_y[lane], gravity_z[lane],
+                f_gx, f_gy, f_gz,
+                use_gravity[lane],
+                g0, g1, g2, g3);
+            accumulate_alignment_gradient(
+                w, x, y, z,
+                magnetometer_x[lane], magnetometer_y[lane], magnetometer_z[lane],
+                f_mx, f_my, f_mz,
+                use_magnetometer[lane],
+                g0, g1, g2, g3);
+
+            // normalize the gradient (zero if there is no gradient)
+            const float gradient_length= sqrtf(g0*g0 + g1*g1 + g2*g2 + g3*g3);
+            const bool bHasGradient= gradient_length > k_real_epsilon;
+            const float gradient_scale= select_float(bHasGradient, 1.f / select_float(bHasGradient, gradient_length, 1.f), 0.f);
+            g0*= gradient_scale; g1*= gradient_scale; g2*= gradient_scale; g3*= gradient_scale;
+
+            // Eqn 47) omega_err= 2*SEq*SEqHatDot
+            float err_w, err_x, err_y, err_z;
+            quaternion_multiply(2.f*w, 2.f*x, 2.f*y, 2.f*z, g0, g1, g2, g3, err_w, err_x, err_y, err_z);
+
+            // Eqn 48) net_omega_bias+= zeta*omega_err (MARG only)
+            const float bias_step= beta[lane]*dt;
+            const float omega_bias_w= select_float(bUseMagnetometer, err_w*bias_step, 0.f);
+            const float omega_bias_x= select_float(bUseMagnetometer, bias_x[lane] + err_x*bias_step, 0.f);
+            const float omega_bias_y= select_float(bUseMagnetometer, bias_y[lane] + err_y*bias_step, 0.f);
+            const float omega_bias_z= select_float(bUseMagnetometer, bias_z[lane] + err_z*bias_step, 0.f);
+
+            // Eqn 49) omega_corrected = omega - net_omega_bias
+            // Eqn 12) q_dot = 0.5*q*omega
+            float dot_w, dot_x, dot_y, dot_z;
+            quaternion_multiply(
+                0.5f*w, 0.5f*x, 0.5f*y, 0.5f*z,
+                -omega_bias_w, gyro_x[lane] - omega_bias_x, gyro_y[lane] - omega_bias_y, gyro_z[lane] - omega_bias_z,
+                dot_w, dot_x, dot_y, dot_z);
+
+            // Eqn 43) SEq_est = SEqDot_omega - beta*SEqHatDot
+            // Eqn 42) SEq_new = SEq + SEqDot_est*delta_t
+            float nw= w + (dot_w - g0*beta[lane])*dt;
+            float nx= x + (dot_x - g1*beta[lane])*dt;
+            float ny= y + (dot_y - g2*beta[lane])*dt;
+            float nz= z + (dot_z - g3*beta[lane])*dt;
+            quaternion_normalize(nw, nx, ny, nz);
+
+            block_qw[block_lane]= nw; block_qx[block_lane]= nx; block_qy[block_lane]= ny; block_qz[block_lane]= nz;
+            block_bias_x[block_lane]= select_float(bUseMagnetometer, omega_bias_x, bias_x[lane]);
+            block_bias_y[block_lane]= select_float(bUseMagnetometer, omega_bias_y, bias_y[lane]);
+            block_bias_z[block_lane]= select_float(bUseMagnetometer, omega_bias_z, bias_z[lane]);
+        }
+
+        copy_block(block_qw, block_size, getChannel(CHANNEL_NEW_QW) + block_begin);
+        copy_block(block_qx, block_size, getChannel(CHANNEL_NEW_QX) + block_begin);
+        copy_block(block_qy, block_size, getChannel(CHANNEL_NEW_QY) + block_begin);
+        copy_block(block_qz, block_size, getChannel(CHANNEL_NEW_QZ) + block_begin);
+        copy_block(block_bias_x, block_size, getChannel(CHANNEL_NEW_BIAS_X) + block_begin);
+        copy_block(block_bias_y, block_size, getChannel(CHANNEL_NEW_BIAS_Y) + block_begin);
+        copy_block(block_bias_z, block_size, getChannel(CHANNEL_NEW_BIAS_Z) + block_begin);
+    }
+}
+
+// Same math as OrientationFilterComplementaryMARG::update.
+// The Mag-Grav alignment (see eigen_alignment_quaternion_between_vector_frames) is a gradient descent
+// that converges after a different number of steps on each lane, so all lanes of a block take each step together
+// and a lane stops changing once it meets one of the descent's stopping conditions.
+void OrientationFilterBatch::advance_complementary_lanes(const int begin_lane, const int end_lane)
+{
+    const float *qw= getChannel(CHANNEL_QW);
+    const float *qx= getChannel(CHANNEL_QX);
+    const float *qy= getChannel(CHANNEL_QY);
+    const float *qz= getChannel(CHANNEL_QZ);
+    const float *mg_weight= getChannel(CHANNEL_MG_WEIGHT);
+    const float *gravity_x= getChannel(CHANNEL_GRAVITY_X);
+    const float *gravity_y= getChannel(CHANNEL_GRAVITY_Y);
+    const float *gravity_z= getChannel(CHANNEL_GRAVITY_Z);
+    const float *magnetometer_x= getChannel(CHANNEL_MAGNETOMETER_X);
+    const float *magnetometer_y= getChannel(CHANNEL_MAGNETOMETER_Y);
+    const float *magnetometer_z= getChannel(CHANNEL_MAGNETOMETER_Z);
+    const float *total_delta_time= getChannel(CHANNEL_TOTAL_DELTA_TIME);
+    const float *gyro_x= getChannel(CHANNEL_GYRO_X);
+    const float *gyro_y= getChannel(CHANNEL_GYRO_Y);
+    const float *gyro_z= getChannel(CHANNEL_GYRO_Z);
+    const float *accel_x= getChannel(CHANNEL_ACCEL_X);
+    const float *accel_y= getChannel(CHANNEL_ACCEL_Y);
+    const float *accel_z= getChannel(CHANNEL_ACCEL_Z);
+    const float *mag_x= getChannel(CHANNEL_MAG_X);
+    const float *mag_y= getChannel(CHANNEL_MAG_Y);
+    const float *mag_z= getChannel(CHANNEL_MAG_Z);
+
+    for (int block_begin = begin_lane; block_begin < end_lane; block_begin+= k_lane_block_size)
+    {
+        const int block_size= (end_lane - block_begin < k_lane_block_size) ? end_lane - block_begin : k_lane_block_size;
+
+        // Gradient descent state of each lane in the block
+        float mg_qw[k_lane_block_size], mg_qx[k_lane_block_size], mg_qy[k_lane_block_size], mg_qz[k_lane_block_size];
+        float prev_qw[k_lane_block_size], prev_qx[k_lane_block_size], prev_qy[k_lane_block_size], prev_qz[k_lane_block_size];
+        float prev_error[k_lane_block_size];
+        float error[k_lane_block_size];
+        float error_delta[k_lane_block_size];
+        float gamma[k_lane_block_size];
+        float backtracked[k_lane_block_size];
+        float active[k_lane_block_size];
+
+        // Start the Mag-Grav alignment from the current orientation.
+        // Only the staged complementary lanes take part in the descent.
+        for (int block_lane = 0; block_lane < block_size; ++block_lane)
+        {
+            const int lane= block_begin + block_lane;
+
+            mg_qw[block_lane]= prev_qw[block_lane]= qw[lane];
+            mg_qx[block_lane]= prev_qx[block_lane]= qx[lane];
+            mg_qy[block_lane]= prev_qy[block_lane]= qy[lane];
+            mg_qz[block_lane]= prev_qz[block_lane]= qz[lane];
+            prev_error[block_lane]= k_real_max;
+            error[block_lane]= k_real_max;
+            error_delta[block_lane]= k_real_max;
+            gamma[block_lane]= 0.5f;
+            backtracked[block_lane]= 0.f;
+            active[block_lane]=
+                (m_is_staged[lane] != 0 && m_lane_types[lane] == OrientationFilterBatchComplementaryMARG)
+                ? 1.f : 0.f;
+        }
+
+        for (int iteration = 0; iteration < k_alignment_max_iterations; ++iteration)
+        {
+            float active_lane_count= 0.f;
+
+            for (int block_lane = 0; block_lane < block_size; ++block_lane)
+            {
+                const int lane= block_begin + block_lane;
+                const bool bIsActive=
+                    active[block_lane] > 0.f &&
+                    error[block_lane] > k_alignment_tolerance && // Aren't within tolerance of the destination
+                    error_delta[block_lane] > k_normal_epsilon && // Haven't reached a minima
+                    gamma[block_lane] > k_normal_epsilon; // Haven't reduced our step size to zero
+                active[block_lane]= bIsActive ? 1.f : 0.f;
+                active_lane_count+= active[block_lane];
+
+                const float w= mg_qw[block_lane], x= mg_qx[block_lane], y= mg_qy[block_lane], z= mg_qz[block_lane];
+
+                float f_gx, f_gy, f_gz;
+                compute_alignment_objective(
+                    w, x, y, z,
+                    gravity_x[lane], gravity_y[lane], gravity_z[lane],
+                    accel_x[lane], accel_y[lane], accel_z[lane],
+                    f_gx, f_gy, f_gz);
+
+                float f_mx, f_my, f_mz;
+                compute_alignment_objective(
+                    w, x, y, z,
+                    magnetometer_x[lane], magnetometer_y[lane], magnetometer_z[lane],
+                    mag_x[lane], mag_y[lane], mag_z[lane],
+                    f_mx, f_my, f_mz);
+
+                const float step_error=
+                    sqrtf(f_gx*f_gx + f_gy*f_gy + f_gz*f_gz) +
+                    sqrtf(f_mx*f_mx + f_my*f_my + f_mz*f_mz);
+
+                // Step down the gradient
+                float g0= 0.f, g1= 0.f, g2= 0.f, g3= 0.f;
+                accumulate_alignment_gradient(
+                    w, x, y, z,
+                    gravity_x[lane], gravity_y[lane], gravity_z[lane],
+                    f_gx, f_gy, f_gz,
+                    1.f,
+                    g0, g1, g2, g3);
+                accumulate_alignment_gradient(
+                    w, x, y, z,
+                    magnetometer_x[lane], magnetometer_y[lane], magnetometer_z[lane],
+                    f_mx, f_my, f_mz,
+                    1.f,
+                    g0, g1, g2, g3);
+
+                float step_w= w - g0*gamma[block_lane];
+                float step_x= x - g1*gamma[block_lane];
+                float step_y= y - g2*gamma[block_lane];
+                float step_z= z - g3*gamma[block_lane];
+                quaternion_normalize(step_w, step_x, step_y, step_z);
+
+                // Keep good steps, otherwise return to the previous orientation and halve the step size
+                const bool bIsGoodStep= step_error <= prev_error[block_lane];
+                const bool bTakeStep= bIsActive && bIsGoodStep;
+                const bool bBacktrack= bIsActive && !bIsGoodStep;
+
+                error_delta[block_lane]=
+                    select_float(
+                        bTakeStep && backtracked[block_lane] == 0.f,
+                        fabsf(step_error - prev_error[block_lane]),
+                        error_delta[block_lane]);
+                backtracked[block_lane]= select_float(bIsActive, bBacktrack ? 1.f : 0.f, backtracked[block_lane]);
+                prev_error[block_lane]= select_float(bTakeStep, step_error, prev_error[block_lane]);
+                prev_qw[block_lane]= select_float(bTakeStep, w, prev_qw[block_lane]);
+                prev_qx[block_lane]= select_float(bTakeStep, x, prev_qx[block_lane]);
+                prev_qy[block_lane]= select_float(bTakeStep, y, prev_qy[block_lane]);
+                prev_qz[block_lane]= select_float(bTakeStep, z, prev_qz[block_lane]);
+                mg_qw[block_lane]= select_float(bTakeStep, step_w, select_float(bBacktrack, prev_qw[block_lane], w));
+                mg_qx[block_lane]= select_float(bTakeStep, step_x, select_float(bBacktrack, prev_qx[block_lane], x));
+                mg_qy[block_lane]= select_float(bTakeStep, step_y, select_float(bBacktrack, prev_qy[block_lane], y));
+                mg_qz[block_lane]= select_float(bTakeStep, step_z, select_float(bBacktrack, prev_qz[block_lane], z));
+                gamma[block_lane]= select_float(bBacktrack, gamma[block_lane]*0.5f, gamma[block_lane]);
+                error[block_lane]= select_float(bIsActive, step_error, error[block_lane]);
+            }
+
+            if (active_lane_count == 0.f)
+            {
+                break;
+            }
+        }
+
+        float block_qw[k_lane_block_size], block_qx[k_lane_block_size], block_qy[k_lane_block_size], block_qz[k_lane_block_size];
+
+        for (int block_lane = 0; block_lane < block_size; ++block_lane)
+        {
+            const int lane= block_begin + block_lane;
+            const float w= qw[lane], x= qx[lane], y= qy[lane], z= qz[lane];
+            const float dt= total_delta_time[lane];
+
+            // Angular Rotation (AR) Update
+            // q_dot = 0.5*q*omega, q_new= q + q_dot*dT
+            float dot_w, dot_x, dot_y, dot_z;
+            quaternion_multiply(
+                0.5f*w, 0.5f*x, 0.5f*y, 0.5f*z,
+                0.f, gyro_x[lane], gyro_y[lane], gyro_z[lane],
+                dot_w, dot_x, dot_y, dot_z);
+
+            float ar_w= w + dot_w*dt;
+            float ar_x= x + dot_x*dt;
+            float ar_y= y + dot_y*dt;
+            float ar_z= z + dot_z*dt;
+            quaternion_normalize(ar_w, ar_x, ar_y, ar_z);
+
+            // Blend between the integrated orientation and absolute rotation from the earth-frame
+            const float weight= mg_weight[lane];
+            float nw= ar_w*(1.f - weight) + mg_qw[block_lane]*weight;
+            float nx= ar_x*(1.f - weight) + mg_qx[block_lane]*weight;
+            float ny= ar_y*(1.f - weight) + mg_qy[block_lane]*weight;
+            float nz= ar_z*(1.f - weight) + mg_qz[block_lane]*weight;
+            quaternion_normalize(nw, nx, ny, nz);
+
+            block_qw[block_lane]= nw; block_qx[block_lane]= nx; block_qy[block_lane]= ny; block_qz[block_lane]= nz;
+        }
+
+        copy_block(block_qw, block_size, getChannel(CHANNEL_NEW_QW) + block_begin);
+        copy_block(block_qx, block_size, getChannel(CHANNEL_NEW_QX) + block_begin);
+        copy_block(block_qy, block_size, getChannel(CHANNEL_NEW_QY) + block_begin);
+        copy_block(block_qz, block_size, getChannel(CHANNEL_NEW_QZ) + block_begin);
+    }
+}
+
+void OrientationFilterBatch::commit_staged_lanes(const bool bComplementaryLanes)
+{
+    for (int lane = 0; lane < m_lane_capacity; ++lane)
+    {
+        if (m_is_staged[lane] != 0 &&
+            (m_lane_types[lane] == OrientationFilterBatchComplementaryMARG) == bComplementaryLanes)
+        {
+            commit_lane(lane);
+        }
+    }
+}
+
+void OrientationFilterBatch::commit_lane(const int lane)
+{
+    const Eigen::Quaternionf new_orientation(
+        getChannel(CHANNEL_NEW_QW)[lane],
+        getChannel(CHANNEL_NEW_QX)[lane],
+        getChannel(CHANNEL_NEW_QY)[lane],
+        getChannel(CHANNEL_NEW_QZ)[lane]);
+
+    if (eigen_quaternion_is_valid(new_orientation))
+    {
+        getChannel(CHANNEL_QW)[lane]= new_orientation.w();
+        getChannel(CHANNEL_QX)[lane]= new_orientation.x();
+        getChannel(CHANNEL_QY)[lane]= new_orientation.y();
+        getChannel(CHANNEL_QZ)[lane]= new_orientation.z();
+    }
+    else
+    {
+        SERVER_MT_LOG_WARNING("OrientationFilterBatch") << "Orientation is NaN!";
+    }
+
+    if (is_valid_float(m_delta_time[lane]))
+    {
+        m_time[lane]= m_accumulated_imu_time_delta[lane] + (double)m_delta_time[lane];
+        m_accumulated_imu_time_delta[lane]= 0.0;
+    }
+    else
+    {
+        SERVER_MT_LOG_WARNING("OrientationFilterBatch") << "time delta is NaN!";
+    }
+
+    if (m_lane_types[lane] == OrientationFilterBatchComplementaryMARG)
+    {
+        // Exponential blend the MG weight from 1 down to k_base_earth_frame_align_weight
+        float *mg_weight= getChannel(CHANNEL_MG_WEIGHT);
+        mg_weight[lane]= lerp_clampf(mg_weight[lane], k_base_earth_frame_align_weight, 0.9f);
+    }
+    else
+    {
+        getChannel(CHANNEL_BIAS_X)[lane]= getChannel(CHANNEL_NEW_BIAS_X)[lane];
+        getChannel(CHANNEL_BIAS_Y)[lane]= getChannel(CHANNEL_NEW_BIAS_Y)[lane];
+        getChannel(CHANNEL_BIAS_Z)[lane]= getChannel(CHANNEL_NEW_BIAS_Z)[lane];
+    }
+
+    // state is valid now that we have had an update
+    m_is_valid[lane]= 1;
+
+    m_is_staged[lane]= 0;
+    --m_staged_lane_count;
+}
+
+//-- Orientation Filter Batch Lane --
+OrientationFilterBatchLane::OrientationFilterBatchLane(
+    OrientationFilterBatch *batch,
+    const OrientationFilterBatchType filter_type)
+    : m_batch(batch)
+    , m_lane(batch->allocateLane(filter_type))
+    , m_reset_orientation(Eigen::Quaternionf::Identity())
+{
+}
+
+OrientationFilterBatchLane::~OrientationFilterBatchLane()
+{
+    if (m_lane != -1)
+    {
+        m_batch->freeLane(m_lane);
+    }
+}
+
+bool OrientationFilterBatchLane::getHasPendingUpdate() const
+{
+    return m_lane != -1 && m_batch->getIsLaneStaged(m_lane);
+}
+
+void OrientationFilterBatchLane::flushPendingUpdate()
+{
+    m_batch->flushLane(m_lane);
+}
+
+bool OrientationFilterBatchLane::getIsStateValid() const
+{
+    return m_batch->getIsLaneValid(m_lane);
+}
+
+double OrientationFilterBatchLane::getTimeInSeconds() const
+{
+    return m_batch->getLaneTime(m_lane);
+}
+
+void OrientationFilterBatchLane::update(const float delta_time, const PoseFilterPacket &packet)
+{
+    m_batch->updateLane(m_lane, delta_time, packet);
+}
+
+void OrientationFilterBatchLane::resetState()
+{
+    m_batch->resetLane(m_lane);
+    m_reset_orientation= Eigen::Quaternionf::Identity();
+}
+
+void OrientationFilterBatchLane::recenterOrientation(const Eigen::Quaternionf& q_pose)
+{
+    m_batch->flushLane(m_lane);
+
+    Eigen::Quaternionf q_inverse = m_batch->getLaneOrientation(m_lane).conjugate();
+
+    eigen_quaternion_normalize_with_default(q_inverse, Eigen::Quaternionf::Identity());
+    m_reset_orientation= q_pose*q_inverse;
+}
+
+bool OrientationFilterBatchLane::allocateStateHistory(const int state_count)
+{
+    m_state_history.resize(state_count);
+    m_reset_orientation_history.resize(state_count);
+
+    return true;
+}
+
+void OrientationFilterBatchLane::saveState(const int state_index)
+{
+    m_batch->flushLane(m_lane);
+    m_batch->saveLaneState(m_lane, m_state_history[state_index]);
+    m_reset_orientation_history[state_index]= m_reset_orientation;
+}
+
+void OrientationFilterBatchLane::restoreState(const int state_index)
+{
+    m_batch->restoreLaneState(m_lane, m_state_history[state_index]);
+    m_reset_orientation= m_reset_orientation_history[state_index];
+}
+
+bool OrientationFilterBatchLane::init(const OrientationFilterConstants &constants)
+{
+    m_batch->initLane(m_lane, constants);
+    m_reset_orientation= Eigen::Quaternionf::Identity();
+
+    return true;
+}
+
+bool OrientationFilterBatchLane::init(const OrientationFilterConstants &constants, const Eigen::Quaternionf &initial_orientation)
+{
+    m_batch->initLane(m_lane, constants);
+    m_batch->setLaneOrientation(m_lane, initial_orientation);
+    m_reset_orientation= Eigen::Quaternionf::Identity();
+
+    return true;
+}
+
+Eigen::Quaternionf OrientationFilterBatchLane::getOrientation(float time) const
+{
+    Eigen::Quaternionf result = Eigen::Quaternionf::Identity();
+
+    // The batched filters don't track angular velocity (same as the filters they mirror),
+    // so there is nothing to extrapolate the orientation with
+    if (m_batch->getIsLaneValid(m_lane))
+    {
+        result = m_reset_orientation * m_batch->getLaneOrientation(m_lane);
+    }
+
+    return result;
+}
+
+Eigen::Vector3f OrientationFilterBatchLane::getAngularVelocityRadPerSec() const
+{
+    return Eigen::Vector3f::Zero();
+}
+
+Eigen::Vector3f OrientationFilterBatchLane::getAngularAccelerationRadPerSecSqr() const
+{
+    return Eigen::Vector3f::Zero();
+}
+
+// -- private methods -----
+static inline float select_float(const bool bCondition, const float a, const float b)
+{
+    return bCondition ? a : b;
+}
+
+static inline void quaternion_multiply(
+    const float aw, const float ax, const float ay, const float az,
+    const float bw, const float bx, const float by, const float bz,
+    float &out_w, float &out_x, float &out_y, float &out_z)
+{
+    out_w= aw*bw - ax*bx - ay*by - az*bz;
+    out_x= aw*bx + ax*bw + ay*bz - az*by;
+    out_y= aw*by + ay*bw + az*bx - ax*bz;
+    out_z= aw*bz + az*bw + ax*by - ay*bx;
+}
+
+// Same as Eigen::Quaternionf::normalize(), which leaves a zero quaternion alone
+static inline void quaternion_normalize(float &w, float &x, float &y, float &z)
+{
+    const float squared_norm= w*w + x*x + y*y + z*z;
+    const float inv_norm= 1.f / sqrtf(select_float(squared_norm > 0.f, squared_norm, 1.f));
+
+    w*= inv_norm; x*= inv_norm; y*= inv_norm; z*= inv_norm;
+}
+
+static inline void copy_block(const float *block, const int block_size, float *out_channel)
+{
+    for (int block_lane = 0; block_lane < block_size; ++block_lane)
+    {
+        out_channel[block_lane]= block[block_lane];
+    }
+}
+
+// f(q; d, s)= (q^-1 * d * q) - s, see eigen_alignment_compute_objective_vector
+static inline void compute_alignment_objective(
+    const float qw, const float qx, const float qy, const float qz,
+    const float dx, const float dy, const float dz,
+    const float sx, const float sy, const float sz,
+    float &out_fx, float &out_fy, float &out_fz)
+{
+    // Rotate d by the conjugate of q: d + w*2(u x d) + u x 2(u x d), u= -q.xyz
+    const float ux= -qx, uy= -qy, uz= -qz;
+    const float tx= 2.f*(uy*dz - uz*dy);
+    const float ty= 2.f*(uz*dx - ux*dz);
+    const float tz= 2.f*(ux*dy - uy*dx);
+
+    out_fx= dx + qw*tx + (uy*tz - uz*ty) - sx;
+    out_fy= dy + qw*ty + (uz*tx - ux*tz) - sy;
+    out_fz= dz + qw*tz + (ux*ty - uy*tx) - sz;
+}
+
+// gradient+= weight * J(q, d)*f, see eigen_alignment_compute_objective_jacobian
+static inline void accumulate_alignment_gradient(
+    const float qw, const float qx, const float qy, const float qz,
+    const float dx, const float dy, const float dz,
+    const float fx, const float fy, const float fz,
+    const float weight,
+    float &inout_g0, float &inout_g1, float &inout_g2, float &inout_g3)
+{
+    const float two_dxq1 = 2.f*dx*qw;
+    const float two_dxq2 = 2.f*dx*qx;
+    const float two_dxq3 = 2.f*dx*qy;
+    const float two_dxq4 = 2.f*dx*qz;
+
+    const float two_dyq1 = 2.f*dy*qw;
+    const float two_dyq2 = 2.f*dy*qx;
+    const float two_dyq3 = 2.f*dy*qy;
+    const float two_dyq4 = 2.f*dy*qz;
+
+    const float two_dzq1 = 2.f*dz*qw;
+    const float two_dzq2 = 2.f*dz*qx;
+    const float two_dzq3 = 2.f*dz*qy;
+    const float two_dzq4 = 2.f*dz*qz;
+
+    inout_g0+= weight*(
+        (two_dyq4 - two_dzq3)*fx +
+        (-two_dxq4 + two_dzq2)*fy +
+        (two_dxq3 - two_dyq2)*fz);
+    inout_g1+= weight*(
+        (two_dyq3 + two_dzq4)*fx +
+        (two_dxq3 - 2.f*two_dyq2 + two_dzq1)*fy +
+        (two_dxq4 - two_dyq1 - 2.f*two_dzq2)*fz);
+    inout_g2+= weight*(
+        (-2.f*two_dxq3 + two_dyq2 - two_dzq1)*fx +
+        (two_dxq2 + two_dzq4)*fy +
+        (two_dxq1 + two_dyq4 - 2.f*two_dzq3)*fz);
+    inout_g3+= weight*(
+        (-2.f*two_dxq4 + two_dyq1 + two_dzq2)*fx +
+        (-two_dxq1 - 2.f*two_dyq4 + two_dzq3)*fy +
+        (two_dxq2 + two_dyq3)*fz);
+}
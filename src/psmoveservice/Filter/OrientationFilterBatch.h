@@ -0,0 +1,168 @@
+#ifndef ORIENTATION_FILTER_BATCH_H
+#define ORIENTATION_FILTER_BATCH_H
+
+//-- includes -----
+#include "PoseFilterInterface.h"
+#include <vector>
+
+//-- constants -----
+enum OrientationFilterBatchType
+{
+    OrientationFilterBatchMadgwickARG,
+    OrientationFilterBatchMadgwickMARG,
+    OrientationFilterBatchComplementaryMARG,
+};
+
+//-- definitions -----
+/// Copy of a single lane's filter state, used to rewind the lane
+struct OrientationFilterBatchLaneState
+{
+    float orientation[4]; // w, x, y, z
+    float omega_bias[3];
+    float mg_weight;
+    double time;
+    double accumulated_imu_time_delta;
+    double accumulated_optical_time_delta;
+    bool bIsValid;
+};
+
+/// Runs the Madgwick ARG/MARG and complementary MARG orientation filters of many devices side by side.
+/// Every device gets a lane in a structure-of-arrays holding the filter state of all devices,
+/// so a single pass over the lanes advances every device that was handed a new IMU sample
+/// and the compiler can vectorize the filter math across devices.
+///
+/// IMU updates are either applied as soon as they are handed to a lane,
+/// or (while deferring updates) staged until update() advances all of the staged lanes at once.
+class OrientationFilterBatch
+{
+public:
+    OrientationFilterBatch(const int max_lane_count);
+
+    /// Returns -1 if every lane is in use
+    int allocateLane(const OrientationFilterBatchType filter_type);
+    void freeLane(const int lane);
+
+    void initLane(const int lane, const OrientationFilterConstants &constants);
+    void resetLane(const int lane);
+
+    /// Stage IMU updates until the next call to update() instead of applying them right away
+    void setDeferUpdates(const bool bDeferUpdates);
+    inline bool getDeferUpdates() const { return m_bDeferUpdates; }
+
+    /// Hand a filter packet to the lane
+    void updateLane(const int lane, const float delta_time, const PoseFilterPacket &packet);
+
+    /// Apply the lane's staged IMU update, if it has one
+    void flushLane(const int lane);
+
+    /// Apply the staged IMU updates of every lane
+    void update();
+
+    inline bool getIsLaneStaged(const int lane) const { return m_is_staged[lane] != 0; }
+    inline int getStagedLaneCount() const { return m_staged_lane_count; }
+
+    // Lane state accessors, these don't apply staged updates
+    inline bool getIsLaneValid(const int lane) const { return m_is_valid[lane] != 0; }
+    inline double getLaneTime(const int lane) const { return m_time[lane]; }
+    Eigen::Quaternionf getLaneOrientation(const int lane) const;
+    void setLaneOrientation(const int lane, const Eigen::Quaternionf &orientation);
+    void saveLaneState(const int lane, OrientationFilterBatchLaneState &out_state) const;
+    void restoreLaneState(const int lane, const OrientationFilterBatchLaneState &state);
+
+private:
+    // Per-lane float channels, each one m_lane_capacity floats long
+    enum eLaneChannel
+    {
+        // Filter state
+        CHANNEL_QW, CHANNEL_QX, CHANNEL_QY, CHANNEL_QZ,
+        CHANNEL_BIAS_X, CHANNEL_BIAS_Y, CHANNEL_BIAS_Z,
+        CHANNEL_MG_WEIGHT,
+
+        // Filter constants
+        CHANNEL_GRAVITY_X, CHANNEL_GRAVITY_Y, CHANNEL_GRAVITY_Z,
+        CHANNEL_MAGNETOMETER_X, CHANNEL_MAGNETOMETER_Y, CHANNEL_MAGNETOMETER_Z,
+        CHANNEL_BETA,
+
+        // Staged IMU update
+        CHANNEL_TOTAL_DELTA_TIME,
+        CHANNEL_GYRO_X, CHANNEL_GYRO_Y, CHANNEL_GYRO_Z,
+        CHANNEL_ACCEL_X, CHANNEL_ACCEL_Y, CHANNEL_ACCEL_Z,
+        CHANNEL_MAG_X, CHANNEL_MAG_Y, CHANNEL_MAG_Z,
+        CHANNEL_USE_GRAVITY,
+        CHANNEL_USE_MAGNETOMETER,
+
+        // Filter output
+        CHANNEL_NEW_QW, CHANNEL_NEW_QX, CHANNEL_NEW_QY, CHANNEL_NEW_QZ,
+        CHANNEL_NEW_BIAS_X, CHANNEL_NEW_BIAS_Y, CHANNEL_NEW_BIAS_Z,
+
+        LANE_CHANNEL_COUNT
+    };
+
+    inline float *getChannel(const eLaneChannel channel) { return &m_channels[channel*m_lane_capacity]; }
+    inline const float *getChannel(const eLaneChannel channel) const { return &m_channels[channel*m_lane_capacity]; }
+
+    void advance_madgwick_lanes(const int begin_lane, const int end_lane);
+    void advance_complementary_lanes(const int begin_lane, const int end_lane);
+    void commit_staged_lanes(const bool bComplementaryLanes);
+    void commit_lane(const int lane);
+
+    const int m_lane_capacity; // rounded up to a whole number of vector blocks
+    bool m_bDeferUpdates;
+    int m_staged_lane_count;
+
+    std::vector<float> m_channels;
+    std::vector<int> m_lane_types; // -1 for free lanes
+    std::vector<char> m_is_valid;
+    std::vector<char> m_is_staged;
+    std::vector<float> m_delta_time;
+    std::vector<double> m_time;
+    std::vector<double> m_accumulated_imu_time_delta;
+    std::vector<double> m_accumulated_optical_time_delta;
+};
+
+/// Orientation filter whose state lives on a lane of a shared OrientationFilterBatch.
+/// Reading the filter doesn't apply an IMU update still staged in the batch,
+/// the staged update shows up once OrientationFilterBatch::update() ran.
+class OrientationFilterBatchLane : public IOrientationFilter
+{
+public:
+    EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+
+    OrientationFilterBatchLane(OrientationFilterBatch *batch, const OrientationFilterBatchType filter_type);
+    virtual ~OrientationFilterBatchLane();
+
+    /// False if the batch had no free lane for the filter
+    inline bool getHasLane() const { return m_lane != -1; }
+
+    /// True while the last IMU update handed to the filter is staged in the batch
+    bool getHasPendingUpdate() const;
+
+    /// Apply the staged IMU update now instead of waiting for OrientationFilterBatch::update()
+    void flushPendingUpdate();
+
+    //-- IStateFilter --
+    bool getIsStateValid() const override;
+    double getTimeInSeconds() const override;
+    void update(const float delta_time, const PoseFilterPacket &packet) override;
+    void resetState() override;
+    void recenterOrientation(const Eigen::Quaternionf& q_pose) override;
+    bool allocateStateHistory(const int state_count) override;
+    void saveState(const int state_index) override;
+    void restoreState(const int state_index) override;
+
+    // -- IOrientationFilter --
+    bool init(const OrientationFilterConstants &constant) override;
+    bool init(const OrientationFilterConstants &constant, const Eigen::Quaternionf &initial_orientation) override;
+    Eigen::Quaternionf getOrientation(float time = 0.f) const override;
+    Eigen::Vector3f getAngularVelocityRadPerSec() const override;
+    Eigen::Vector3f getAngularAccelerationRadPerSecSqr() const override;
+
+protected:
+    OrientationFilterBatch *m_batch;
+    int m_lane;
+    Eigen::Quaternionf m_reset_orientation;
+    std::vector<OrientationFilterBatchLaneState> m_state_history;
+    std::vector<Eigen::Quaternionf, Eigen::aligned_allocator<Eigen::Quaternionf>> m_reset_orientation_history;
+};
+
+#endif // ORIENTATION_FILTER_BATCH_H
@@ -0,0 +1,177 @@
+//-- includes -----
+#include "PoseFilterHistory.h"
+#include "MathUtility.h"
+#include <assert.h>
+
+//-- public implementation -----
+PoseFilterHistory::PoseFilterHistory(const float min_time_delta_seconds, const float max_time_delta_seconds)
+    : m_pose_filter(nullptr)
+    , m_pose_filter_space(nullptr)
+    , m_min_time_delta_seconds(min_time_delta_seconds)
+    , m_max_time_delta_seconds(max_time_delta_seconds)
+    , m_bCanRewind(false)
+    , m_packets()
+    , m_history_length(0)
+    , m_oldest_ring_index(0)
+    , m_packet_count(0)
+    , m_history_start_timestamp()
+    , m_bHistoryStartTimestampValid(false)
+{
+}
+
+bool PoseFilterHistory::init(
+    IPoseFilter *pose_filter,
+    const PoseFilterSpace *pose_filter_space,
+    const int history_length)
+{
+    assert(pose_filter != nullptr);
+    assert(pose_filter_space != nullptr);
+    assert(history_length > 0);
+
+    m_pose_filter= pose_filter;
+    m_pose_filter_space= pose_filter_space;
+    m_bCanRewind= m_pose_filter->allocateStateHistory(history_length);
+
+    m_packets.resize(m_bCanRewind ? history_length : 0);
+    m_history_length= m_bCanRewind ? history_length : 0;
+    m_oldest_ring_index= 0;
+    m_packet_count= 0;
+    m_history_start_timestamp= std::chrono::time_point<std::chrono::high_resolution_clock>();
+    m_bHistoryStartTimestampValid= false;
+
+    return m_bCanRewind;
+}
+
+void PoseFilterHistory::clearHistory()
+{
+    if (m_packet_count > 0)
+    {
+        m_history_start_timestamp= m_packets[getRingIndex(m_packet_count - 1)].timestamp;
+        m_bHistoryStartTimestampValid= true;
+    }
+
+    m_oldest_ring_index= 0;
+    m_packet_count= 0;
+}
+
+bool PoseFilterHistory::applySensorPacket(const PoseSensorPacket &sensor_packet)
+{
+    if (!m_bCanRewind)
+    {
+        // Apply the packet in arrival order, but never let the filter clock run backwards
+        updateFilter(sensor_packet, computeTimeDelta(sensor_packet.timestamp, 0));
+
+        if (!m_bHistoryStartTimestampValid || sensor_packet.timestamp > m_history_start_timestamp)
+        {
+            m_history_start_timestamp= sensor_packet.timestamp;
+            m_bHistoryStartTimestampValid= true;
+        }
+
+        return true;
+    }
+
+    // Find where the packet goes in the time ordered history
+    int insert_index= m_packet_count;
+    while (insert_index > 0 && sensor_packet.timestamp < m_packets[getRingIndex(insert_index - 1)].timestamp)
+    {
+        --insert_index;
+    }
+
+    // Drop the packet if it's older than the oldest state we can rewind to
+    if (insert_index == 0 &&
+        (m_packet_count == m_history_length ||
+         (m_bHistoryStartTimestampValid && sensor_packet.timestamp < m_history_start_timestamp)))
+    {
+        return false;
+    }
+
+    // Make room by dropping the oldest packet
+    if (m_packet_count == m_history_length)
+    {
+        m_history_start_timestamp= m_packets[m_oldest_ring_index].timestamp;
+        m_bHistoryStartTimestampValid= true;
+        m_oldest_ring_index= (m_oldest_ring_index + 1) % m_history_length;
+        --m_packet_count;
+        --insert_index;
+    }
+
+    if (insert_index < m_packet_count)
+    {
+        // Rewind the filter to the state from before the first packet newer than this one
+        m_pose_filter->restoreState(getRingIndex(insert_index));
+
+        // Shift the newer packets up one slot, they get replayed after this one
+        for (int history_index = m_packet_count; history_index > insert_index; --history_index)
+        {
+            m_packets[getRingIndex(history_index)]= m_packets[getRingIndex(history_index - 1)];
+        }
+    }
+
+    m_packets[getRingIndex(insert_index)]= sensor_packet;
+    ++m_packet_count;
+
+    replayFrom(insert_index);
+
+    return true;
+}
+
+//-- private implementation -----
+float PoseFilterHistory::computeTimeDelta(
+    const std::chrono::time_point<std::chrono::high_resolution_clock> &timestamp,
+    const int history_index) const
+{
+    std::chrono::time_point<std::chrono::high_resolution_clock> previous_timestamp;
+    bool bHasPreviousTimestamp;
+
+    if (history_index > 0)
+    {
+        previous_timestamp= m_packets[getRingIndex(history_index - 1)].timestamp;
+        bHasPreviousTimestamp= true;
+    }
+    else
+    {
+        previous_timestamp= m_history_start_timestamp;
+        bHasPreviousTimestamp= m_bHistoryStartTimestampValid;
+    }
+
+    float time_delta_seconds;
+    if (bHasPreviousTimestamp)
+    {
+        const std::chrono::duration<float, std::milli> time_delta = timestamp - previous_timestamp;
+        const float time_delta_milli = time_delta.count();
+
+        time_delta_seconds = clampf(time_delta_milli / 1000.f, m_min_time_delta_seconds, m_max_time_delta_seconds);
+    }
+    else
+    {
+        time_delta_seconds = m_max_time_delta_seconds;
+    }
+
+    return time_delta_seconds;
+}
+
+void PoseFilterHistory::replayFrom(const int history_index)
+{
+    for (int replay_index = history_index; replay_index < m_packet_count; ++replay_index)
+    {
+        const int ring_index= getRingIndex(replay_index);
+        const PoseSensorPacket &sensor_packet= m_packets[ring_index];
+
+        // Save the state from before the packet so later packets can rewind to it
+        m_pose_filter->saveState(ring_index);
+        updateFilter(sensor_packet, computeTimeDelta(sensor_packet.timestamp, replay_index));
+    }
+}
+
+void PoseFilterHistory::updateFilter(const PoseSensorPacket &sensor_packet, const float time_delta_seconds)
+{
+    PoseFilterPacket filter_packet;
+    filter_packet.clear();
+
+    // Create a filter input packet from the sensor data
+    // and the filter's previous orientation and position
+    m_pose_filter_space->createFilterPacket(sensor_packet, m_pose_filter, filter_packet);
+
+    // Process the filter packet
+    m_pose_filter->update(time_delta_seconds, filter_packet);
+}
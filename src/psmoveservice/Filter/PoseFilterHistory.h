@@ -0,0 +1,62 @@
+#ifndef POSE_FILTER_HISTORY_H
+#define POSE_FILTER_HISTORY_H
+
+//-- includes -----
+#include "PoseFilterInterface.h"
+#include <chrono>
+#include <vector>
+
+//-- definitions -----
+/// Fuses sensor packets into a pose filter at the time they were captured.
+/// Optical measurements show up tens of milliseconds after the IMU samples that cover the same instant.
+/// The history keeps a bounded ring of the most recent sensor packets along with the filter state
+/// from just before each of them was applied. A late packet rewinds the filter to the state
+/// before its capture time, gets applied there, and the newer packets get replayed on top of it.
+class PoseFilterHistory
+{
+public:
+    PoseFilterHistory(const float min_time_delta_seconds, const float max_time_delta_seconds);
+
+    /// Size the history for the given filter.
+    /// Returns false if the filter can't be rewound, in which case packets get applied in arrival order.
+    bool init(IPoseFilter *pose_filter, const PoseFilterSpace *pose_filter_space, const int history_length);
+
+    /// Forget the saved filter states (but keep the filter clock running).
+    /// Needed whenever the filter state gets changed outside of the history, like when recentering.
+    void clearHistory();
+
+    /// Apply the sensor packet to the filter at the time the packet was captured.
+    /// Returns false if the packet is older than anything the filter can be rewound to and got dropped.
+    bool applySensorPacket(const PoseSensorPacket &sensor_packet);
+
+    inline bool getCanRewind() const { return m_bCanRewind; }
+
+private:
+    inline int getRingIndex(const int history_index) const
+    { return (m_oldest_ring_index + history_index) % m_history_length; }
+
+    float computeTimeDelta(
+        const std::chrono::time_point<std::chrono::high_resolution_clock> &timestamp,
+        const int history_index) const;
+    void replayFrom(const int history_index);
+    void updateFilter(const PoseSensorPacket &sensor_packet, const float time_delta_seconds);
+
+    IPoseFilter *m_pose_filter;
+    const PoseFilterSpace *m_pose_filter_space;
+    const float m_min_time_delta_seconds;
+    const float m_max_time_delta_seconds;
+    bool m_bCanRewind;
+
+    // Ring of the most recent sensor packets in ascending time order.
+    // Filter state slot N holds the state from just before the packet in ring slot N was applied.
+    std::vector<PoseSensorPacket> m_packets;
+    int m_history_length;
+    int m_oldest_ring_index;
+    int m_packet_count;
+
+    // Timestamp of the last packet applied before the oldest packet in the ring
+    std::chrono::time_point<std::chrono::high_resolution_clock> m_history_start_timestamp;
+    bool m_bHistoryStartTimestampValid;
+};
+
+#endif // POSE_FILTER_HISTORY_H
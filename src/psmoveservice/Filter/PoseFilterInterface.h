@@ -23,6 +23,13 @@ extern const Eigen::Matrix3f *k_eigen_sensor_transform_opengl;
 #define k_meters_to_centimeters  100.f
 #define k_centimeters_to_meters  0.01f
 
+/// Scalar type the Kalman filters run their state and covariance math in
+enum KalmanFilterScalarType
+{
+    KalmanFilterScalarDouble,
+    KalmanFilterScalarFloat
+};
+
 //-- declarations -----
 struct ExponentialCurve
 {
@@ -292,6 +299,9 @@ struct PoseFilterConstants
 class IStateFilter
 {
 public:
+    /// Filters get deleted through these interfaces
+    virtual ~IStateFilter() {}
+
     /// Not true until the filter has updated at least once
     virtual bool getIsStateValid() const = 0;
 
@@ -306,6 +316,16 @@ public:
 
     /// The current state becomes the identity pose
     virtual void recenterOrientation(const Eigen::Quaternionf& q_pose) = 0;
+
+    /// Make room to save the given number of filter states so that the filter can be rewound.
+    /// Returns false if the filter can't save its state.
+    virtual bool allocateStateHistory(const int state_count) = 0;
+
+    /// Save the current filter state in the given slot of the state history
+    virtual void saveState(const int state_index) = 0;
+
+    /// Rewind the filter to the state saved in the given slot of the state history
+    virtual void restoreState(const int state_index) = 0;
 };
 
 /// Common interface to all orientation filters
@@ -369,6 +389,14 @@ public:
 
     /// Get the current velocity of the filter state (cm/s^2)
     virtual Eigen::Vector3f getAccelerationCmPerSecSqr() const = 0;
+
+    /// True if part of the filter state lives in a batch shared with the filters of other devices.
+    /// Filters sharing a batch have to be updated on the same thread.
+    virtual bool getIsBatched() const = 0;
+
+    /// Finish an update that waited on the batch the filter shares with other devices.
+    /// Called once the batch was updated, the getters only see the state up to the last completed update.
+    virtual void completeBatchedUpdate() = 0;
 };
 
 #endif // POSE_FILTER_INTERFACE_H
\ No newline at end of file
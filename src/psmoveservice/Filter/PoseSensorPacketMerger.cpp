@@ -0,0 +1,88 @@
+//-- includes -----
+#include "PoseSensorPacketMerger.h"
+#include <assert.h>
+
+//-- public implementation -----
+PoseSensorPacketMerger::PoseSensorPacketMerger(const int packets_per_stream)
+    : m_packets_per_stream(packets_per_stream)
+    , m_dropped_packet_count(0)
+{
+    assert(packets_per_stream > 0);
+
+    for (int stream_index = 0; stream_index < SENSOR_STREAM_COUNT; ++stream_index)
+    {
+        PacketRing &ring= m_streams[stream_index];
+
+        ring.packets.resize(packets_per_stream);
+        ring.oldest_index= 0;
+        ring.packet_count= 0;
+    }
+}
+
+void PoseSensorPacketMerger::clear()
+{
+    for (int stream_index = 0; stream_index < SENSOR_STREAM_COUNT; ++stream_index)
+    {
+        m_streams[stream_index].oldest_index= 0;
+        m_streams[stream_index].packet_count= 0;
+    }
+}
+
+void PoseSensorPacketMerger::pushPacket(const eSensorStream stream, const PoseSensorPacket &packet)
+{
+    PacketRing &ring= m_streams[stream];
+
+    if (ring.packet_count == m_packets_per_stream)
+    {
+        // Make room by dropping the oldest packet
+        ring.oldest_index= (ring.oldest_index + 1) % m_packets_per_stream;
+        --ring.packet_count;
+        ++m_dropped_packet_count;
+    }
+
+    ring.packets[(ring.oldest_index + ring.packet_count) % m_packets_per_stream]= packet;
+    ++ring.packet_count;
+}
+
+bool PoseSensorPacketMerger::popOldestPacket(PoseSensorPacket &out_packet)
+{
+    PacketRing &imu_ring= m_streams[IMUStream];
+    PacketRing &optical_ring= m_streams[OpticalStream];
+    PacketRing *source_ring= nullptr;
+
+    if (imu_ring.packet_count > 0 && optical_ring.packet_count > 0)
+    {
+        // Ties go to the IMU packet so the optical measurement gets fused on top of it
+        source_ring=
+            (optical_ring.packets[optical_ring.oldest_index].timestamp < imu_ring.packets[imu_ring.oldest_index].timestamp)
+            ? &optical_ring
+            : &imu_ring;
+    }
+    else if (imu_ring.packet_count > 0)
+    {
+        source_ring= &imu_ring;
+    }
+    else if (optical_ring.packet_count > 0)
+    {
+        source_ring= &optical_ring;
+    }
+    else
+    {
+        return false;
+    }
+
+    out_packet= source_ring->packets[source_ring->oldest_index];
+    source_ring->oldest_index= (source_ring->oldest_index + 1) % m_packets_per_stream;
+    --source_ring->packet_count;
+
+    return true;
+}
+
+int PoseSensorPacketMerger::takeDroppedPacketCount()
+{
+    const int dropped_packet_count= m_dropped_packet_count;
+
+    m_dropped_packet_count= 0;
+
+    return dropped_packet_count;
+}
@@ -0,0 +1,69 @@
+#ifndef POSE_SENSOR_PACKET_MERGER_H
+#define POSE_SENSOR_PACKET_MERGER_H
+
+//-- includes -----
+#include "PoseFilterInterface.h"
+#include <vector>
+
+//-- definitions -----
+/// Merges the IMU and optical sensor packet streams of a device into a single stream in capture time order.
+/// Each stream arrives already in capture time order, so the streams get buffered in preallocated rings
+/// and the oldest packet at the front of either ring is handed out next (a two-way merge).
+/// Nothing gets allocated or sorted after construction.
+/// A packet pushed onto a full ring makes room by dropping the oldest packet in that ring,
+/// which keeps the filter caught up with the newest data after a stall.
+class PoseSensorPacketMerger
+{
+public:
+    enum eSensorStream
+    {
+        IMUStream,
+        OpticalStream,
+
+        SENSOR_STREAM_COUNT
+    };
+
+    PoseSensorPacketMerger(const int packets_per_stream);
+
+    /// Forget all buffered packets
+    void clear();
+
+    /// Append a packet to the stream, dropping the stream's oldest packet if its ring is full
+    void pushPacket(const eSensorStream stream, const PoseSensorPacket &packet);
+
+    /// Move packets from a lock-free queue (ReaderWriterQueue) onto the stream until the queue is empty
+    template <typename t_packet_queue>
+    void drainQueue(const eSensorStream stream, t_packet_queue &queue)
+    {
+        const PoseSensorPacket *packet;
+
+        while ((packet= queue.peek()) != nullptr)
+        {
+            pushPacket(stream, *packet);
+            queue.pop();
+        }
+    }
+
+    /// Take the oldest buffered packet across both streams.
+    /// Returns false once both streams are empty.
+    bool popOldestPacket(PoseSensorPacket &out_packet);
+
+    inline int getBufferedPacketCount(const eSensorStream stream) const { return m_streams[stream].packet_count; }
+
+    /// Returns the number of packets dropped since the last call
+    int takeDroppedPacketCount();
+
+private:
+    struct PacketRing
+    {
+        std::vector<PoseSensorPacket> packets;
+        int oldest_index;
+        int packet_count;
+    };
+
+    const int m_packets_per_stream;
+    PacketRing m_streams[SENSOR_STREAM_COUNT];
+    int m_dropped_packet_count;
+};
+
+#endif // POSE_SENSOR_PACKET_MERGER_H
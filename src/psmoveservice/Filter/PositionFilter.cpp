@@ -3,6 +3,7 @@
 #include "MathEigen.h"
 #include "ServerLog.h"
 
+#include <assert.h>
 #include <chrono>
 #include <numeric>
 
@@ -83,7 +84,7 @@ struct PositionFilterState
 		}
 		else
 		{
-			SERVER_LOG_WARNING("PositionFilter") << "Position is NaN!";
+			SERVER_MT_LOG_WARNING("PositionFilter") << "Position is NaN!";
 		}
 
 		if (eigen_vector3f_is_valid(new_velocity_m_per_sec))
@@ -92,7 +93,7 @@ struct PositionFilterState
 		}
 		else
 		{
-			SERVER_LOG_WARNING("PositionFilter") << "Velocity is NaN!";
+			SERVER_MT_LOG_WARNING("PositionFilter") << "Velocity is NaN!";
 		}
 
 		if (eigen_vector3f_is_valid(new_acceleration_m_per_sec_sqr))
@@ -101,7 +102,7 @@ struct PositionFilterState
 		}
 		else
 		{
-			SERVER_LOG_WARNING("PositionFilter") << "Acceleration is NaN!";
+			SERVER_MT_LOG_WARNING("PositionFilter") << "Acceleration is NaN!";
 		}
 
 		if (eigen_vector3f_is_valid(new_accelerometer_g_units))
@@ -110,7 +111,7 @@ struct PositionFilterState
 		}
 		else
 		{
-			SERVER_LOG_WARNING("PositionFilter") << "Accelerometer is NaN!";
+			SERVER_MT_LOG_WARNING("PositionFilter") << "Accelerometer is NaN!";
 		}
 
 		if (eigen_vector3f_is_valid(new_accelerometer_derivative_g_per_sec))
@@ -119,7 +120,7 @@ struct PositionFilterState
 		}
 		else
 		{
-			SERVER_LOG_WARNING("PositionFilter") << "AccelerometerDerivative is NaN!";
+			SERVER_MT_LOG_WARNING("PositionFilter") << "AccelerometerDerivative is NaN!";
 		}
 
 		if (is_valid_float(delta_time))
@@ -129,7 +130,7 @@ struct PositionFilterState
 		}
 		else
 		{
-			SERVER_LOG_WARNING("PositionFilter") << "time delta is NaN!";
+			SERVER_MT_LOG_WARNING("PositionFilter") << "time delta is NaN!";
 		}
 
         // state is valid now that we have had an update
@@ -154,7 +155,7 @@ struct PositionFilterState
 		}
 		else
 		{
-			SERVER_LOG_WARNING("PositionFilter") << "Position is NaN!";
+			SERVER_MT_LOG_WARNING("PositionFilter") << "Position is NaN!";
 		}
 
 		if (eigen_vector3f_is_valid(new_velocity_m_per_sec))
@@ -163,7 +164,7 @@ struct PositionFilterState
 		}
 		else
 		{
-			SERVER_LOG_WARNING("PositionFilter") << "Velocity is NaN!";
+			SERVER_MT_LOG_WARNING("PositionFilter") << "Velocity is NaN!";
 		}
 
 		if (is_valid_float(delta_time))
@@ -173,7 +174,7 @@ struct PositionFilterState
 		}
 		else
 		{
-			SERVER_LOG_WARNING("PositionFilter") << "time delta is NaN!";
+			SERVER_MT_LOG_WARNING("PositionFilter") << "time delta is NaN!";
 		}
 
         // state is valid now that we have had an update
@@ -188,7 +189,7 @@ struct PositionFilterState
 		}
 		else
 		{
-			SERVER_LOG_WARNING("PositionFilter") << "optical time delta is NaN!";
+			SERVER_MT_LOG_WARNING("PositionFilter") << "optical time delta is NaN!";
 		}
 	}
 
@@ -200,7 +201,7 @@ struct PositionFilterState
 		}
 		else
 		{
-			SERVER_LOG_WARNING("PositionFilter") << "imu time delta is NaN!";
+			SERVER_MT_LOG_WARNING("PositionFilter") << "imu time delta is NaN!";
 		}
 	}
 };
@@ -235,6 +236,8 @@ static void lowpass_filter_imu_step(
 //-- Orientation Filter -----
 PositionFilter::PositionFilter()
     : m_state(new PositionFilterState)
+    , m_state_history(nullptr)
+    , m_state_history_count(0)
 {
     memset(&m_constants, 0, sizeof(PositionFilterConstants));
     resetState();
@@ -243,6 +246,7 @@ PositionFilter::PositionFilter()
 PositionFilter::~PositionFilter()
 {
     delete m_state;
+    delete[] m_state_history;
 }
 
 bool PositionFilter::getIsStateValid() const
@@ -264,6 +268,27 @@ void PositionFilter::recenterOrientation(const Eigen::Quaternionf& q_pose)
 {
 }
 
+bool PositionFilter::allocateStateHistory(const int state_count)
+{
+    delete[] m_state_history;
+    m_state_history= new PositionFilterState[state_count];
+    m_state_history_count= state_count;
+
+    return true;
+}
+
+void PositionFilter::saveState(const int state_index)
+{
+    assert(state_index >= 0 && state_index < m_state_history_count);
+    m_state_history[state_index]= *m_state;
+}
+
+void PositionFilter::restoreState(const int state_index)
+{
+    assert(state_index >= 0 && state_index < m_state_history_count);
+    *m_state= m_state_history[state_index];
+}
+
 bool PositionFilter::init(const PositionFilterConstants &constants)
 {
     resetState();
@@ -463,6 +488,31 @@ void PositionFilterComplimentaryOpticalIMU::update(const float delta_time, const
 }
 
 // -- PositionFilterComplimentaryOpticalIMU --
+bool PositionFilterLowPassExponential::allocateStateHistory(const int state_count)
+{
+	deltaTimeHistoryStates.resize(state_count);
+	blendedPositionHistoryStates.resize(state_count);
+
+	return PositionFilter::allocateStateHistory(state_count);
+}
+
+void PositionFilterLowPassExponential::saveState(const int state_index)
+{
+	PositionFilter::saveState(state_index);
+
+	// List assignment reuses the nodes already in the saved copy
+	deltaTimeHistoryStates[state_index]= deltaTimeHistory;
+	blendedPositionHistoryStates[state_index]= blendedPositionHistory;
+}
+
+void PositionFilterLowPassExponential::restoreState(const int state_index)
+{
+	PositionFilter::restoreState(state_index);
+
+	deltaTimeHistory= deltaTimeHistoryStates[state_index];
+	blendedPositionHistory= blendedPositionHistoryStates[state_index];
+}
+
 void PositionFilterLowPassExponential::update(const float delta_time, const PoseFilterPacket &packet)
 {
 	const int history_queue_length = 20;
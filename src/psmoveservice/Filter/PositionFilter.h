@@ -5,6 +5,7 @@
 #include "PoseFilterInterface.h"
 #include <chrono>
 #include <list>
+#include <vector>
 
 //-- definitions -----
 /// Abstract base class for all orientation only filters
@@ -19,6 +20,9 @@ public:
     double getTimeInSeconds() const override;
     void resetState() override;
     void recenterOrientation(const Eigen::Quaternionf& q_pose) override;
+    bool allocateStateHistory(const int state_count) override;
+    void saveState(const int state_index) override;
+    void restoreState(const int state_index) override;
 
     // -- IOrientationFilter --
     bool init(const PositionFilterConstants &constant) override;
@@ -30,6 +34,8 @@ public:
 protected:
     PositionFilterConstants m_constants;
     struct PositionFilterState *m_state;
+    struct PositionFilterState *m_state_history; // array of size m_state_history_count
+    int m_state_history_count;
 };
 
 /// Just use the optical orientation passed in unfiltered
@@ -54,9 +60,17 @@ public:
 class PositionFilterLowPassExponential : public PositionFilter
 {
 public:
+	bool allocateStateHistory(const int state_count) override;
+	void saveState(const int state_index) override;
+	void restoreState(const int state_index) override;
 	void update(const float delta_time, const PoseFilterPacket &packet) override;
 	std::list<float> deltaTimeHistory;
 	std::list<Eigen::Vector3f> blendedPositionHistory;
+
+protected:
+	// Copies of the history lists for each saved filter state
+	std::vector<std::list<float>> deltaTimeHistoryStates;
+	std::vector<std::list<Eigen::Vector3f>> blendedPositionHistoryStates;
 };
 
 class PositionFilterComplimentaryOpticalIMU : public PositionFilter
@@ -554,6 +554,8 @@ MorpheusHMD::poll()
 		{
 			// Attempt to read the next update packet from the controller
 			int res = hid_read(USBContext->sensor_device_handle, (unsigned char*)InData, sizeof(MorpheusSensorData));
+			const std::chrono::time_point<std::chrono::high_resolution_clock> read_timestamp= 
+				std::chrono::high_resolution_clock::now();
 
 			if (res == 0)
 			{
@@ -590,6 +592,9 @@ MorpheusHMD::poll()
 			// https://github.com/hrl7/node-psvr/blob/master/lib/psvr.js
 			MorpheusHMDState newState;
 
+			// Remember when the packet came off of the wire
+			newState.CaptureTimestamp = read_timestamp;
+
 			// Increment the sequence for every new polling packet
 			newState.PollSequenceNumber = NextPollSequenceNumber;
 			++NextPollSequenceNumber;
@@ -327,6 +327,8 @@ protected:
 		// Attempt to read the next sensor update packet from the HMD
 		memcpy(&m_previousHIDInputPacket, &m_currentHIDInputPacket, sizeof(DualShock4DataInput));
 		int res = hid_read(m_hidDevice, (unsigned char*)&m_currentHIDInputPacket, sizeof(DualShock4DataInput));
+		const std::chrono::time_point<std::chrono::high_resolution_clock> read_timestamp= 
+			std::chrono::high_resolution_clock::now();
 
 		if (res > 0)
 		{
@@ -336,6 +338,9 @@ protected:
 			// https://github.com/hrl7/node-psvr/blob/master/lib/psvr.js
 			DualShock4ControllerInputState newState;
 
+			// Remember when the packet came off of the wire
+			newState.CaptureTimestamp = read_timestamp;
+
 			// Increment the sequence for every new polling packet
 			newState.PollSequenceNumber = m_nextPollSequenceNumber;
 			++m_nextPollSequenceNumber;
@@ -376,12 +376,17 @@ protected:
 			memcpy(&m_previousHIDInputPacket.data.zcm1, &m_currentHIDInputPacket.data.zcm1, sizeof(PSMoveDataInputZCM1));
 			res= hid_read_timeout(m_hidDevice, (unsigned char*)&m_currentHIDInputPacket.data.zcm1, sizeof(PSMoveDataInputZCM1), cfg.poll_timeout_ms);
 		}
+		const std::chrono::time_point<std::chrono::high_resolution_clock> read_timestamp= 
+			std::chrono::high_resolution_clock::now();
 
 		if (res > 0)
 		{
 			// https://github.com/hrl7/node-psvr/blob/master/lib/psvr.js
 			PSMoveControllerInputState newState;
 
+			// Remember when the packet came off of the wire
+			newState.CaptureTimestamp = read_timestamp;
+
 			// Increment the sequence for every new polling packet
 			newState.PollSequenceNumber = m_nextPollSequenceNumber;
 			++m_nextPollSequenceNumber;
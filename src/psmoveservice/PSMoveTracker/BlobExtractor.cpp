@@ -0,0 +1,292 @@
+//-- includes -----
+#include "BlobExtractor.h"
+#include <algorithm>
+#include <assert.h>
+
+//-- constants -----
+// Neighbor offsets in clockwise order (image space, y down), starting east
+static const int k_neighbor_dx[8] = {1, 1, 0, -1, -1, -1, 0, 1};
+static const int k_neighbor_dy[8] = {0, 1, 1, 1, 0, -1, -1, -1};
+static const int k_neighbor_west= 4;
+
+//-- private methods -----
+static bool blob_has_smaller_area(const BlobInfo &a, const BlobInfo &b)
+{
+    // Used as the heap ordering, so the heap front is the smallest blob
+    return a.area > b.area;
+}
+
+//-- public implementation -----
+BlobExtractor::BlobExtractor()
+    : m_roi()
+    , m_mask_bit(0)
+{
+}
+
+void BlobExtractor::reserve(int frame_width, int frame_height, int max_blob_count)
+{
+    // Worst case is a checkerboard: every other pixel of a row starts a new run
+    const size_t max_run_count= static_cast<size_t>((frame_width + 1) / 2) * static_cast<size_t>(frame_height);
+
+    m_runs.reserve(max_run_count);
+    m_accumulators.reserve(max_run_count);
+    m_blobs.reserve(max_blob_count);
+}
+
+int BlobExtractor::extractBiggestNBlobs(
+    const cv::Mat &label_image,
+    const cv::Rect2i &roi,
+    const uint8_t mask_bit,
+    const int max_blob_count,
+    const int min_blob_area)
+{
+    assert(label_image.type() == CV_8UC1);
+
+    m_runs.clear();
+    m_blobs.clear();
+    m_label_image= label_image;
+    m_roi= roi & cv::Rect2i(0, 0, label_image.cols, label_image.rows);
+    m_mask_bit= mask_bit;
+
+    if (max_blob_count <= 0 || m_roi.area() <= 0)
+    {
+        return 0;
+    }
+
+    // Run-length encode each row and union every run with the runs it touches in the row above
+    const int roi_x_end= m_roi.x + m_roi.width;
+    const int roi_y_end= m_roi.y + m_roi.height;
+    int prev_row_begin= 0;
+    int prev_row_end= 0;
+
+    for (int y = m_roi.y; y < roi_y_end; ++y)
+    {
+        const uint8_t *row= label_image.ptr<uint8_t>(y);
+        const int row_begin= static_cast<int>(m_runs.size());
+        int prev_run= prev_row_begin;
+        int x= m_roi.x;
+
+        while (x < roi_x_end)
+        {
+            if ((row[x] & mask_bit) == 0)
+            {
+                ++x;
+                continue;
+            }
+
+            const int x_begin= x;
+            while (x < roi_x_end && (row[x] & mask_bit) != 0)
+            {
+                ++x;
+            }
+
+            const int run_index= static_cast<int>(m_runs.size());
+            const BlobRun run= {y, x_begin, x, run_index};
+            m_runs.push_back(run);
+
+            // With 8-connectivity a run above touches this one if it overlaps [x_begin-1, x]
+            while (prev_run < prev_row_end && m_runs[prev_run].x_end < x_begin)
+            {
+                ++prev_run;
+            }
+            for (int touching_run = prev_run;
+                touching_run < prev_row_end && m_runs[touching_run].x_begin <= x;
+                ++touching_run)
+            {
+                unionRuns(touching_run, run_index);
+            }
+        }
+
+        prev_row_begin= row_begin;
+        prev_row_end= static_cast<int>(m_runs.size());
+    }
+
+    // Accumulate the statistics of every run into its root.
+    // A root always comes before the rest of its runs, so it gets initialized first.
+    const int run_count= static_cast<int>(m_runs.size());
+    m_accumulators.resize(run_count);
+
+    for (int run_index = 0; run_index < run_count; ++run_index)
+    {
+        const BlobRun &run= m_runs[run_index];
+        const int root_index= findRootRun(run_index);
+        const int length= run.x_end - run.x_begin;
+        const int64_t run_sum_x= static_cast<int64_t>(length) * (run.x_begin + run.x_end - 1) / 2;
+        const int64_t run_sum_y= static_cast<int64_t>(length) * run.y;
+        BlobAccumulator &accumulator= m_accumulators[root_index];
+
+        if (root_index == run_index)
+        {
+            accumulator.area= length;
+            accumulator.sum_x= run_sum_x;
+            accumulator.sum_y= run_sum_y;
+            accumulator.min_x= run.x_begin;
+            accumulator.max_x= run.x_end - 1;
+            accumulator.min_y= run.y;
+            accumulator.max_y= run.y;
+        }
+        else
+        {
+            accumulator.area+= length;
+            accumulator.sum_x+= run_sum_x;
+            accumulator.sum_y+= run_sum_y;
+            accumulator.min_x= std::min(accumulator.min_x, run.x_begin);
+            accumulator.max_x= std::max(accumulator.max_x, run.x_end - 1);
+            accumulator.max_y= run.y; // runs are in scan order
+        }
+    }
+
+    // Keep the N biggest blobs
+    for (int run_index = 0; run_index < run_count; ++run_index)
+    {
+        const BlobRun &run= m_runs[run_index];
+        if (run.parent != run_index)
+        {
+            continue;
+        }
+
+        const BlobAccumulator &accumulator= m_accumulators[run_index];
+        if (accumulator.area < min_blob_area)
+        {
+            continue;
+        }
+
+        BlobInfo blob;
+        blob.area= accumulator.area;
+        blob.centroid= cv::Point2f(
+            static_cast<float>(static_cast<double>(accumulator.sum_x) / accumulator.area),
+            static_cast<float>(static_cast<double>(accumulator.sum_y) / accumulator.area));
+        blob.bounding_box= cv::Rect2i(
+            accumulator.min_x, accumulator.min_y,
+            accumulator.max_x - accumulator.min_x + 1, accumulator.max_y - accumulator.min_y + 1);
+        blob.trace_start= cv::Point2i(run.x_begin, run.y);
+
+        pushBlob(blob, max_blob_count);
+    }
+
+    std::sort_heap(m_blobs.begin(), m_blobs.end(), blob_has_smaller_area);
+
+    return getBlobCount();
+}
+
+void BlobExtractor::traceBlobBoundary(int blob_index, std::vector<cv::Point> &out_contour) const
+{
+    // Outer border following from Suzuki & Abe,
+    // "Topological Structural Analysis of Digitized Binary Images by Border Following" (1985)
+    // which is also what cv::findContours implements.
+    const cv::Point2i start= m_blobs[blob_index].trace_start;
+
+    out_contour.clear();
+
+    // Look clockwise around the start pixel, from its west neighbor (which is never in the blob),
+    // for the last pixel of the border
+    int first_direction= -1;
+    for (int step = 0; step < 8; ++step)
+    {
+        const int direction= (k_neighbor_west + step) & 7;
+
+        if (isBlobPixel(start.x + k_neighbor_dx[direction], start.y + k_neighbor_dy[direction]))
+        {
+            first_direction= direction;
+            break;
+        }
+    }
+
+    if (first_direction == -1)
+    {
+        // Single pixel blob
+        out_contour.push_back(start);
+        return;
+    }
+
+    const cv::Point2i last(start.x + k_neighbor_dx[first_direction], start.y + k_neighbor_dy[first_direction]);
+    cv::Point2i current= start;
+    int previous_direction= first_direction; // direction from the current pixel to the previous one
+    int incoming_direction= (first_direction + 4) & 7; // direction we moved in to reach the current pixel
+
+    for (;;)
+    {
+        // Look counterclockwise around the current pixel, starting after the previous one.
+        // The previous pixel is in the blob, so this always finds something.
+        int direction= previous_direction;
+        for (int step = 1; step <= 8; ++step)
+        {
+            direction= (previous_direction - step) & 7;
+
+            if (isBlobPixel(current.x + k_neighbor_dx[direction], current.y + k_neighbor_dy[direction]))
+            {
+                break;
+            }
+        }
+
+        const cv::Point2i next(current.x + k_neighbor_dx[direction], current.y + k_neighbor_dy[direction]);
+
+        // Only keep the pixels where the border changes direction
+        if (direction != incoming_direction)
+        {
+            out_contour.push_back(current);
+        }
+
+        if (next == start && current == last)
+        {
+            break;
+        }
+
+        previous_direction= (direction + 4) & 7;
+        incoming_direction= direction;
+        current= next;
+    }
+}
+
+//-- private implementation -----
+int BlobExtractor::findRootRun(int run_index)
+{
+    // Path halving
+    while (m_runs[run_index].parent != run_index)
+    {
+        m_runs[run_index].parent= m_runs[m_runs[run_index].parent].parent;
+        run_index= m_runs[run_index].parent;
+    }
+
+    return run_index;
+}
+
+void BlobExtractor::unionRuns(int run_a, int run_b)
+{
+    const int root_a= findRootRun(run_a);
+    const int root_b= findRootRun(run_b);
+
+    // Keep the earliest run in scan order as the root,
+    // so the root run starts at the top-most, left-most pixel of the blob
+    if (root_a < root_b)
+    {
+        m_runs[root_b].parent= root_a;
+    }
+    else if (root_b < root_a)
+    {
+        m_runs[root_a].parent= root_b;
+    }
+}
+
+void BlobExtractor::pushBlob(const BlobInfo &blob, const int max_blob_count)
+{
+    if (static_cast<int>(m_blobs.size()) < max_blob_count)
+    {
+        m_blobs.push_back(blob);
+        std::push_heap(m_blobs.begin(), m_blobs.end(), blob_has_smaller_area);
+    }
+    else if (blob.area > m_blobs.front().area)
+    {
+        // Replace the smallest blob kept so far
+        std::pop_heap(m_blobs.begin(), m_blobs.end(), blob_has_smaller_area);
+        m_blobs.back()= blob;
+        std::push_heap(m_blobs.begin(), m_blobs.end(), blob_has_smaller_area);
+    }
+}
+
+bool BlobExtractor::isBlobPixel(int x, int y) const
+{
+    return
+        m_roi.contains(cv::Point2i(x, y)) &&
+        (m_label_image.ptr<uint8_t>(y)[x] & m_mask_bit) != 0;
+}
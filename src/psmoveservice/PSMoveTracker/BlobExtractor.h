@@ -0,0 +1,82 @@
+#ifndef BLOB_EXTRACTOR_H
+#define BLOB_EXTRACTOR_H
+
+//-- includes -----
+#include "opencv2/core/core.hpp"
+#include <stdint.h>
+#include <vector>
+
+//-- definitions -----
+// A connected blob of pixels (8-connectivity) in a label image. All coordinates are in image space.
+struct BlobInfo
+{
+    int area; // pixel count
+    cv::Point2f centroid;
+    cv::Rect2i bounding_box;
+    cv::Point2i trace_start; // top-most, left-most pixel of the blob, where its boundary trace starts
+};
+
+// Finds the N biggest blobs of pixels that have a given bit set in a label image.
+// The blobs are labeled in a single pass over the run-length encoded rows (union-find on runs),
+// and a bounded min-heap keeps only the N biggest ones, so nothing gets sorted.
+// Boundaries are only traced for the blobs that are asked for.
+// All scratch memory is owned by the extractor and reused frame to frame,
+// so once reserved for the frame size the extraction never allocates.
+class BlobExtractor
+{
+public:
+    BlobExtractor();
+
+    // Reserve the scratch memory for the worst case frame of the given size.
+    // Only address space gets reserved. Pages get touched as the runs of a frame need them.
+    void reserve(int frame_width, int frame_height, int max_blob_count);
+
+    // Labels the pixels inside the roi of the CV_8UC1 label image that have the mask bit set
+    // and keeps the max_blob_count biggest blobs of at least min_blob_area pixels, biggest first.
+    // Returns the number of blobs found.
+    int extractBiggestNBlobs(
+        const cv::Mat &label_image,
+        const cv::Rect2i &roi,
+        const uint8_t mask_bit,
+        const int max_blob_count,
+        const int min_blob_area = 1);
+
+    inline int getBlobCount() const { return static_cast<int>(m_blobs.size()); }
+    inline const BlobInfo &getBlob(int blob_index) const { return m_blobs[blob_index]; }
+
+    // Traces the outer boundary of a blob found by the last extraction.
+    // Straight horizontal, vertical and diagonal segments are compressed to their end points,
+    // the same way CV_CHAIN_APPROX_SIMPLE would.
+    void traceBlobBoundary(int blob_index, std::vector<cv::Point> &out_contour) const;
+
+private:
+    struct BlobRun
+    {
+        int y;
+        int x_begin, x_end; // [x_begin, x_end)
+        int parent; // union-find parent run, the root is the first run of the blob in scan order
+    };
+
+    struct BlobAccumulator
+    {
+        int area;
+        int64_t sum_x, sum_y;
+        int min_x, min_y, max_x, max_y;
+    };
+
+    int findRootRun(int run_index);
+    void unionRuns(int run_a, int run_b);
+    void pushBlob(const BlobInfo &blob, const int max_blob_count);
+    bool isBlobPixel(int x, int y) const;
+
+    std::vector<BlobRun> m_runs;
+    std::vector<BlobAccumulator> m_accumulators; // indexed by root run
+    std::vector<BlobInfo> m_blobs; // min-heap on area while extracting, sorted biggest first after
+
+    // State of the last extraction, needed to trace the blob boundaries
+    cv::Mat m_label_image;
+    cv::Rect2i m_roi;
+    uint8_t m_mask_bit;
+};
+
+#endif // BLOB_EXTRACTOR_H
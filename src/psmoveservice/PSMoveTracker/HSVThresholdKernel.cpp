@@ -0,0 +1,303 @@
+//-- includes -----
+#include "HSVThresholdKernel.h"
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+    #define HSV_THRESHOLD_X86
+
+    // SSE2 is always there on x64, but has to be switched on for 32-bit builds
+    #if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+        #define HSV_THRESHOLD_SSE2
+    #endif
+
+    // AVX2 gets compiled per-function and is only ever called after checking the CPU at runtime
+    #if defined(__GNUC__) || (defined(_MSC_VER) && _MSC_VER >= 1700)
+        #define HSV_THRESHOLD_AVX2
+    #endif
+#endif
+
+#if defined(HSV_THRESHOLD_X86)
+    #if defined(_MSC_VER)
+        #include <intrin.h>
+    #endif
+    #include <immintrin.h>
+#endif
+
+#if defined(_MSC_VER)
+    #define HSV_THRESHOLD_TARGET_AVX2
+#else
+    #define HSV_THRESHOLD_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+
+//-- private methods -----
+static inline bool hsv_threshold_contains(
+    const HSVThresholdBounds &bounds,
+    const uint8_t h,
+    const uint8_t s,
+    const uint8_t v)
+{
+    return
+        s >= bounds.saturation_min && s <= bounds.saturation_max &&
+        v >= bounds.value_min && v <= bounds.value_max &&
+        ((h >= bounds.hue_min[0] && h <= bounds.hue_max[0]) || (h >= bounds.hue_min[1] && h <= bounds.hue_max[1]));
+}
+
+static void hsv_threshold_kernel_scalar(
+    const uint8_t *hue,
+    const uint8_t *saturation,
+    const uint8_t *value,
+    const int pixel_count,
+    const HSVThresholdBounds &bounds,
+    const uint8_t mask_bit,
+    uint8_t *out_masks)
+{
+    const uint8_t clear_mask = static_cast<uint8_t>(~mask_bit);
+
+    for (int pixel_index = 0; pixel_index < pixel_count; ++pixel_index)
+    {
+        const uint8_t mask = out_masks[pixel_index] & clear_mask;
+
+        out_masks[pixel_index] =
+            hsv_threshold_contains(bounds, hue[pixel_index], saturation[pixel_index], value[pixel_index])
+            ? (mask | mask_bit)
+            : mask;
+    }
+}
+
+#if defined(HSV_THRESHOLD_SSE2)
+// There is no unsigned byte compare in SSE2, but x is in [lo, hi] exactly when max(x, lo) == x and min(x, hi) == x
+static inline __m128i hsv_threshold_in_range_sse2(const __m128i x, const __m128i lo, const __m128i hi)
+{
+    return _mm_and_si128(
+        _mm_cmpeq_epi8(_mm_max_epu8(x, lo), x),
+        _mm_cmpeq_epi8(_mm_min_epu8(x, hi), x));
+}
+
+static void hsv_threshold_kernel_sse2(
+    const uint8_t *hue,
+    const uint8_t *saturation,
+    const uint8_t *value,
+    const int pixel_count,
+    const HSVThresholdBounds &bounds,
+    const uint8_t mask_bit,
+    uint8_t *out_masks)
+{
+    const __m128i hue_min0 = _mm_set1_epi8(static_cast<char>(bounds.hue_min[0]));
+    const __m128i hue_max0 = _mm_set1_epi8(static_cast<char>(bounds.hue_max[0]));
+    const __m128i hue_min1 = _mm_set1_epi8(static_cast<char>(bounds.hue_min[1]));
+    const __m128i hue_max1 = _mm_set1_epi8(static_cast<char>(bounds.hue_max[1]));
+    const __m128i saturation_min = _mm_set1_epi8(static_cast<char>(bounds.saturation_min));
+    const __m128i saturation_max = _mm_set1_epi8(static_cast<char>(bounds.saturation_max));
+    const __m128i value_min = _mm_set1_epi8(static_cast<char>(bounds.value_min));
+    const __m128i value_max = _mm_set1_epi8(static_cast<char>(bounds.value_max));
+    const __m128i bit = _mm_set1_epi8(static_cast<char>(mask_bit));
+
+    const int block_size = 16;
+    const int block_pixel_count = pixel_count - (pixel_count % block_size);
+
+    for (int pixel_index = 0; pixel_index < block_pixel_count; pixel_index += block_size)
+    {
+        const __m128i h = _mm_loadu_si128(reinterpret_cast<const __m128i *>(hue + pixel_index));
+        const __m128i s = _mm_loadu_si128(reinterpret_cast<const __m128i *>(saturation + pixel_index));
+        const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(value + pixel_index));
+        const __m128i in_hue =
+            _mm_or_si128(
+                hsv_threshold_in_range_sse2(h, hue_min0, hue_max0),
+                hsv_threshold_in_range_sse2(h, hue_min1, hue_max1));
+        const __m128i in_bounds =
+            _mm_and_si128(
+                in_hue,
+                _mm_and_si128(
+                    hsv_threshold_in_range_sse2(s, saturation_min, saturation_max),
+                    hsv_threshold_in_range_sse2(v, value_min, value_max)));
+
+        __m128i *mask_block = reinterpret_cast<__m128i *>(out_masks + pixel_index);
+        const __m128i masks = _mm_loadu_si128(mask_block);
+
+        _mm_storeu_si128(
+            mask_block,
+            _mm_or_si128(_mm_andnot_si128(bit, masks), _mm_and_si128(in_bounds, bit)));
+    }
+
+    hsv_threshold_kernel_scalar(
+        hue + block_pixel_count,
+        saturation + block_pixel_count,
+        value + block_pixel_count,
+        pixel_count - block_pixel_count,
+        bounds,
+        mask_bit,
+        out_masks + block_pixel_count);
+}
+#endif // HSV_THRESHOLD_SSE2
+
+#if defined(HSV_THRESHOLD_AVX2)
+HSV_THRESHOLD_TARGET_AVX2
+static inline __m256i hsv_threshold_in_range_avx2(const __m256i x, const __m256i lo, const __m256i hi)
+{
+    return _mm256_and_si256(
+        _mm256_cmpeq_epi8(_mm256_max_epu8(x, lo), x),
+        _mm256_cmpeq_epi8(_mm256_min_epu8(x, hi), x));
+}
+
+HSV_THRESHOLD_TARGET_AVX2
+static void hsv_threshold_kernel_avx2(
+    const uint8_t *hue,
+    const uint8_t *saturation,
+    const uint8_t *value,
+    const int pixel_count,
+    const HSVThresholdBounds &bounds,
+    const uint8_t mask_bit,
+    uint8_t *out_masks)
+{
+    const __m256i hue_min0 = _mm256_set1_epi8(static_cast<char>(bounds.hue_min[0]));
+    const __m256i hue_max0 = _mm256_set1_epi8(static_cast<char>(bounds.hue_max[0]));
+    const __m256i hue_min1 = _mm256_set1_epi8(static_cast<char>(bounds.hue_min[1]));
+    const __m256i hue_max1 = _mm256_set1_epi8(static_cast<char>(bounds.hue_max[1]));
+    const __m256i saturation_min = _mm256_set1_epi8(static_cast<char>(bounds.saturation_min));
+    const __m256i saturation_max = _mm256_set1_epi8(static_cast<char>(bounds.saturation_max));
+    const __m256i value_min = _mm256_set1_epi8(static_cast<char>(bounds.value_min));
+    const __m256i value_max = _mm256_set1_epi8(static_cast<char>(bounds.value_max));
+    const __m256i bit = _mm256_set1_epi8(static_cast<char>(mask_bit));
+
+    const int block_size = 32;
+    const int block_pixel_count = pixel_count - (pixel_count % block_size);
+
+    for (int pixel_index = 0; pixel_index < block_pixel_count; pixel_index += block_size)
+    {
+        const __m256i h = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(hue + pixel_index));
+        const __m256i s = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(saturation + pixel_index));
+        const __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(value + pixel_index));
+        const __m256i in_hue =
+            _mm256_or_si256(
+                hsv_threshold_in_range_avx2(h, hue_min0, hue_max0),
+                hsv_threshold_in_range_avx2(h, hue_min1, hue_max1));
+        const __m256i in_bounds =
+            _mm256_and_si256(
+                in_hue,
+                _mm256_and_si256(
+                    hsv_threshold_in_range_avx2(s, saturation_min, saturation_max),
+                    hsv_threshold_in_range_avx2(v, value_min, value_max)));
+
+        __m256i *mask_block = reinterpret_cast<__m256i *>(out_masks + pixel_index);
+        const __m256i masks = _mm256_loadu_si256(mask_block);
+
+        _mm256_storeu_si256(
+            mask_block,
+            _mm256_or_si256(_mm256_andnot_si256(bit, masks), _mm256_and_si256(in_bounds, bit)));
+    }
+
+    hsv_threshold_kernel_scalar(
+        hue + block_pixel_count,
+        saturation + block_pixel_count,
+        value + block_pixel_count,
+        pixel_count - block_pixel_count,
+        bounds,
+        mask_bit,
+        out_masks + block_pixel_count);
+}
+
+static bool hsv_threshold_cpu_has_avx2()
+{
+#if defined(_MSC_VER)
+    int cpu_info[4];
+
+    __cpuid(cpu_info, 0);
+    if (cpu_info[0] < 7)
+    {
+        return false;
+    }
+
+    // The OS has to save the AVX registers on a context switch too
+    __cpuid(cpu_info, 1);
+    const bool bHasOSXSave = (cpu_info[2] & (1 << 27)) != 0;
+    const bool bHasAVX = (cpu_info[2] & (1 << 28)) != 0;
+    if (!bHasOSXSave || !bHasAVX || (_xgetbv(0) & 0x6) != 0x6)
+    {
+        return false;
+    }
+
+    __cpuidex(cpu_info, 7, 0);
+    return (cpu_info[1] & (1 << 5)) != 0;
+#else
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2") != 0;
+#endif
+}
+#endif // HSV_THRESHOLD_AVX2
+
+//-- public interface -----
+const char *hsv_threshold_get_kernel_name(eHSVThresholdKernel kernel)
+{
+    switch (kernel)
+    {
+    case _hsv_threshold_kernel_scalar:
+        return "scalar";
+    case _hsv_threshold_kernel_sse2:
+        return "sse2";
+    case _hsv_threshold_kernel_avx2:
+        return "avx2";
+    default:
+        return "unknown";
+    }
+}
+
+bool hsv_threshold_is_kernel_supported(eHSVThresholdKernel kernel)
+{
+    return hsv_threshold_get_kernel(kernel) != nullptr;
+}
+
+eHSVThresholdKernel hsv_threshold_get_best_kernel()
+{
+    static const eHSVThresholdKernel best_kernel= []() -> eHSVThresholdKernel {
+        for (int kernel_index = _hsv_threshold_kernel_count - 1; kernel_index > _hsv_threshold_kernel_scalar; --kernel_index)
+        {
+            if (hsv_threshold_is_kernel_supported(static_cast<eHSVThresholdKernel>(kernel_index)))
+            {
+                return static_cast<eHSVThresholdKernel>(kernel_index);
+            }
+        }
+
+        return _hsv_threshold_kernel_scalar;
+    }();
+
+    return best_kernel;
+}
+
+t_hsv_threshold_kernel hsv_threshold_get_kernel(eHSVThresholdKernel kernel)
+{
+    switch (kernel)
+    {
+    case _hsv_threshold_kernel_scalar:
+        return hsv_threshold_kernel_scalar;
+    case _hsv_threshold_kernel_sse2:
+#if defined(HSV_THRESHOLD_SSE2)
+        return hsv_threshold_kernel_sse2;
+#else
+        return nullptr;
+#endif
+    case _hsv_threshold_kernel_avx2:
+#if defined(HSV_THRESHOLD_AVX2)
+        {
+            static const bool bHasAVX2 = hsv_threshold_cpu_has_avx2();
+            return bHasAVX2 ? hsv_threshold_kernel_avx2 : nullptr;
+        }
+#else
+        return nullptr;
+#endif
+    default:
+        return nullptr;
+    }
+}
+
+void hsv_threshold_update_mask_bit(
+    const uint8_t *hue,
+    const uint8_t *saturation,
+    const uint8_t *value,
+    const int pixel_count,
+    const HSVThresholdBounds &bounds,
+    const uint8_t mask_bit,
+    uint8_t *out_masks)
+{
+    static const t_hsv_threshold_kernel best_kernel = hsv_threshold_get_kernel(hsv_threshold_get_best_kernel());
+
+    best_kernel(hue, saturation, value, pixel_count, bounds, mask_bit, out_masks);
+}
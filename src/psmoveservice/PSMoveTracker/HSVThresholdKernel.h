@@ -0,0 +1,62 @@
+#ifndef HSV_THRESHOLD_KERNEL_H
+#define HSV_THRESHOLD_KERNEL_H
+
+//-- includes -----
+#include <stdint.h>
+
+//-- definitions -----
+// Inclusive HSV bounds of a tracking color, as cv::inRange would test them.
+// A hue range that wraps around 0/180 is split into two hue intervals.
+// A hue range that doesn't wrap just uses the same interval twice.
+struct HSVThresholdBounds
+{
+    uint8_t hue_min[2];
+    uint8_t hue_max[2];
+    uint8_t saturation_min, saturation_max;
+    uint8_t value_min, value_max;
+};
+
+enum eHSVThresholdKernel
+{
+    _hsv_threshold_kernel_scalar,
+    _hsv_threshold_kernel_sse2,
+    _hsv_threshold_kernel_avx2,
+
+    _hsv_threshold_kernel_count
+};
+
+// Sets the given bit in out_masks[i] for every pixel i whose planar H, S and V values are inside the bounds,
+// and clears it for every pixel that is outside of them. The other bits of the mask are left untouched.
+// Wrapped hue, saturation and value are all tested in a single pass over the pixels.
+typedef void (*t_hsv_threshold_kernel)(
+    const uint8_t *hue,
+    const uint8_t *saturation,
+    const uint8_t *value,
+    const int pixel_count,
+    const HSVThresholdBounds &bounds,
+    const uint8_t mask_bit,
+    uint8_t *out_masks);
+
+//-- interface -----
+const char *hsv_threshold_get_kernel_name(eHSVThresholdKernel kernel);
+
+// Returns true if the kernel was compiled in and the CPU we are running on supports it
+bool hsv_threshold_is_kernel_supported(eHSVThresholdKernel kernel);
+
+// The fastest kernel the CPU supports. Chosen once on first use.
+eHSVThresholdKernel hsv_threshold_get_best_kernel();
+
+// Returns nullptr if the kernel isn't supported
+t_hsv_threshold_kernel hsv_threshold_get_kernel(eHSVThresholdKernel kernel);
+
+// Runs the fastest supported kernel
+void hsv_threshold_update_mask_bit(
+    const uint8_t *hue,
+    const uint8_t *saturation,
+    const uint8_t *value,
+    const int pixel_count,
+    const HSVThresholdBounds &bounds,
+    const uint8_t mask_bit,
+    uint8_t *out_masks);
+
+#endif // HSV_THRESHOLD_KERNEL_H
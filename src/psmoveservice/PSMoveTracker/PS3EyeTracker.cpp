@@ -1,31 +1,240 @@
 // -- includes -----
 #include "PS3EyeTracker.h"
+#include "DeviceManager.h"
 #include "ServerLog.h"
 #include "ServerUtility.h"
 #include "PSEyeVideoCapture.h"
 #include "PSMoveProtocol.pb.h"
 #include "TrackerDeviceEnumerator.h"
 #include "TrackerManager.h"
+#include "WorkerThread.h"
 #include "opencv2/opencv.hpp"
 
+#include <algorithm>
+#include <atomic>
+#include <thread>
+
 // -- constants -----
-#define PS3EYE_STATE_BUFFER_MAX 16
+// Minimum number of slots needed so that the capture thread always has a free slot to write into
+// while the main thread holds one slot and one completed frame waits to be picked up
+#define PS3EYE_CAPTURE_RING_SIZE 3
 
 static const char *OPTION_FOV_SETTING = "FOV Setting";
 static const char *OPTION_FOV_RED_DOT = "Red Dot";
 static const char *OPTION_FOV_BLUE_DOT = "Blue Dot";
 
+// Exposure and gain are never negative, so this marks a sensor setting slot with nothing queued
+static const double k_no_pending_sensor_setting = -1.0;
+
 // -- private definitions -----
-class PSEyeCaptureData
+struct PSEyeCaptureFrame
+{
+    cv::Mat frame;
+    std::chrono::time_point<std::chrono::high_resolution_clock> capture_timestamp;
+    int frame_sequence_number;
+};
+
+// Pulls frames off of the camera on a dedicated thread so that the main thread never blocks on the camera.
+// Completed frames are handed over through a lock-free ring of frame slots:
+// * The capture thread owns the "write" slot and fills it
+// * The main thread owns the "read" slot and processes it
+// * The "pending" slot holds the newest completed frame not yet picked up by the main thread
+// Slots are swapped with a single atomic exchange, so neither side ever waits on the other
+// and the main thread always gets the newest frame.
+// Sensor settings (exposure and gain) are queued by the main thread and applied by the capture thread
+// between frames, so the camera is never written to while the capture thread is inside grab().
+class PSEyeCaptureProcessor : public WorkerThread
 {
 public:
-    PSEyeCaptureData()
-        : frame()
+    PSEyeCaptureProcessor(PSEyeVideoCapture *video_capture, int retrieve_flag)
+        : WorkerThread("PS3EyeCaptureProcessor")
+        , m_videoCapture(video_capture)
+        , m_retrieveFlag(retrieve_flag)
+        , m_pendingSlot({ k_initial_pending_slot })
+        , m_pendingExposure(k_no_pending_sensor_setting)
+        , m_pendingGain(k_no_pending_sensor_setting)
+        , m_writeSlot(k_initial_write_slot)
+        , m_nextFrameSequenceNumber(0)
+        , m_readSlot(k_initial_read_slot)
+    {
+        resetFrameRing();
+    }
+
+    void start()
     {
+        if (!hasThreadStarted())
+        {
+            WorkerThread::startThread();
+        }
+    }
+
+    void stop()
+    {
+        WorkerThread::stopThread();
 
+        // The capture thread is gone, so apply anything it didn't get to
+        applyPendingSensorSettings();
+
+        // Any frames still in the ring may have been captured with old camera settings
+        resetFrameRing();
     }
 
-    cv::Mat frame;
+    // Called on the main thread.
+    // Returns true if a new frame arrived since the last call, in which case getCurrentFrame() refers to it.
+    bool fetchLatestFrame()
+    {
+        bool bNewFrame = false;
+
+        if ((m_pendingSlot.load() & k_fresh_frame_flag) != 0)
+        {
+            // Hand our old slot back to the capture thread and take the newest completed frame
+            const int previous_pending_slot = m_pendingSlot.exchange(m_readSlot);
+
+            m_readSlot = previous_pending_slot & k_slot_index_mask;
+            bNewFrame = true;
+        }
+
+        return bNewFrame;
+    }
+
+    // Called on the main thread
+    inline const PSEyeCaptureFrame &getCurrentFrame() const
+    {
+        return m_frameRing[m_readSlot];
+    }
+
+    // Called on the main thread.
+    // Returns false if the property isn't a sensor setting the capture thread can apply while streaming.
+    bool queueSensorSetting(int property_id, double value)
+    {
+        std::atomic<double> *pending_setting = getPendingSensorSetting(property_id);
+
+        if (pending_setting != nullptr)
+        {
+            pending_setting->store(value);
+        }
+
+        return pending_setting != nullptr;
+    }
+
+    // Called on the main thread.
+    // Returns true if a value for the given sensor setting is still waiting to be applied.
+    bool fetchPendingSensorSetting(int property_id, double &out_value)
+    {
+        std::atomic<double> *pending_setting = getPendingSensorSetting(property_id);
+        bool bIsPending = false;
+
+        if (pending_setting != nullptr)
+        {
+            out_value = pending_setting->load();
+            bIsPending = out_value != k_no_pending_sensor_setting;
+        }
+
+        return bIsPending;
+    }
+
+protected:
+    bool doWork() override
+    {
+        PSEyeCaptureFrame &capture_frame = m_frameRing[m_writeSlot];
+
+        applyPendingSensorSettings();
+
+        if (m_videoCapture->grab() &&
+            m_videoCapture->retrieve(capture_frame.frame, m_retrieveFlag))
+        {
+            capture_frame.capture_timestamp = std::chrono::high_resolution_clock::now();
+            capture_frame.frame_sequence_number = m_nextFrameSequenceNumber;
+            ++m_nextFrameSequenceNumber;
+
+            // Publish the completed frame and take back whatever slot was pending.
+            // If that slot was never picked up by the main thread its frame gets overwritten (dropped).
+            const int previous_pending_slot = m_pendingSlot.exchange(m_writeSlot | k_fresh_frame_flag);
+
+            m_writeSlot = previous_pending_slot & k_slot_index_mask;
+        }
+        else
+        {
+            // Don't spin on a camera that isn't streaming
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+
+        return true;
+    }
+
+    // Only called while the worker thread isn't running
+    void resetFrameRing()
+    {
+        for (int slot_index = 0; slot_index < PS3EYE_CAPTURE_RING_SIZE; ++slot_index)
+        {
+            PSEyeCaptureFrame &capture_frame = m_frameRing[slot_index];
+
+            capture_frame.frame.release();
+            capture_frame.capture_timestamp = std::chrono::time_point<std::chrono::high_resolution_clock>();
+            capture_frame.frame_sequence_number = -1;
+        }
+
+        m_pendingSlot.store(k_initial_pending_slot);
+        m_writeSlot = k_initial_write_slot;
+        m_readSlot = k_initial_read_slot;
+    }
+
+    // Called on the capture thread, or on the main thread while the capture thread isn't running
+    void applyPendingSensorSettings()
+    {
+        applyPendingSensorSetting(cv::CAP_PROP_EXPOSURE, m_pendingExposure);
+        applyPendingSensorSetting(cv::CAP_PROP_GAIN, m_pendingGain);
+    }
+
+    void applyPendingSensorSetting(int property_id, std::atomic<double> &pending_setting)
+    {
+        const double value = pending_setting.exchange(k_no_pending_sensor_setting);
+
+        if (value != k_no_pending_sensor_setting)
+        {
+            m_videoCapture->set(property_id, value);
+        }
+    }
+
+    std::atomic<double> *getPendingSensorSetting(int property_id)
+    {
+        std::atomic<double> *pending_setting = nullptr;
+
+        switch (property_id)
+        {
+        case cv::CAP_PROP_EXPOSURE:
+            pending_setting = &m_pendingExposure;
+            break;
+        case cv::CAP_PROP_GAIN:
+            pending_setting = &m_pendingGain;
+            break;
+        }
+
+        return pending_setting;
+    }
+
+private:
+    static const int k_fresh_frame_flag = 0x100;
+    static const int k_slot_index_mask = 0x0ff;
+    static const int k_initial_read_slot = 0;
+    static const int k_initial_pending_slot = 1;
+    static const int k_initial_write_slot = 2;
+
+    PSEyeVideoCapture *m_videoCapture;
+    int m_retrieveFlag;
+    PSEyeCaptureFrame m_frameRing[PS3EYE_CAPTURE_RING_SIZE];
+
+    // Multithreaded state
+    std::atomic_int m_pendingSlot;
+    std::atomic<double> m_pendingExposure;
+    std::atomic<double> m_pendingGain;
+
+    // Worker thread state
+    int m_writeSlot;
+    int m_nextFrameSequenceNumber;
+
+    // Main thread state
+    int m_readSlot;
 };
 
 // -- public methods
@@ -259,10 +468,14 @@ PS3EyeTracker::PS3EyeTracker()
     : cfg()
     , USBDevicePath()
     , VideoCapture(nullptr)
-    , CaptureData(nullptr)
+    , CaptureProcessor(nullptr)
     , DriverType(PS3EyeTracker::Libusb)
+    , VideoFrameFormat(PS3EyeTracker::BGR)
     , NextPollSequenceNumber(0)
-    , TrackerStates()
+    , TrackerStateCount(0)
+    , NextTrackerStateIndex(0)
+    , LastFrameSequenceNumber(-1)
+    , DroppedFrameCount(0)
 {
 }
 
@@ -334,7 +547,22 @@ bool PS3EyeTracker::open(const DeviceEnumerator *enumerator)
 
         if (VideoCapture->isOpened())
         {
-            CaptureData = new PSEyeCaptureData;
+            // Leave debayering to the tracker view if the camera can hand us raw frames,
+            // so that it only has to debayer the regions it is actually looking at
+            const TrackerManagerConfig &trackerCfg = DeviceManager::getInstance()->m_tracker_manager->getConfig();
+            int retrieve_flag;
+            if (trackerCfg.use_bayer_roi_tracking && VideoCapture->getSupportsBayerFrames())
+            {
+                VideoFrameFormat = ITrackerInterface::BayerGB;
+                retrieve_flag = PSEYE_RETRIEVE_BAYER_GB;
+            }
+            else
+            {
+                VideoFrameFormat = ITrackerInterface::BGR;
+                retrieve_flag = cv::CAP_OPENNI_BGR_IMAGE;
+            }
+
+            CaptureProcessor = new PSEyeCaptureProcessor(VideoCapture, retrieve_flag);
             USBDevicePath = enumerator->get_path();
             bSuccess = true;
         }
@@ -363,6 +591,13 @@ bool PS3EyeTracker::open(const DeviceEnumerator *enumerator)
 		VideoCapture->set(cv::CAP_PROP_EXPOSURE, cfg.exposure);
 		VideoCapture->set(cv::CAP_PROP_GAIN, cfg.gain);
 		VideoCapture->set(cv::CAP_PROP_FPS, cfg.frame_rate);
+
+        // Start pulling frames off the camera
+        TrackerStateCount = 0;
+        NextTrackerStateIndex = 0;
+        LastFrameSequenceNumber = -1;
+        DroppedFrameCount = 0;
+        CaptureProcessor->start();
     }
 
     return bSuccess;
@@ -382,37 +617,40 @@ IDeviceInterface::ePollResult PS3EyeTracker::poll()
 {
     IDeviceInterface::ePollResult result = IDeviceInterface::_PollResultFailure;
 
-    if (getIsOpen())
+    if (getIsOpen() && !CaptureProcessor->hasThreadEnded())
     {
-        if (!VideoCapture->grab() || 
-            !VideoCapture->retrieve(CaptureData->frame, cv::CAP_OPENNI_BGR_IMAGE))
+        if (CaptureProcessor->fetchLatestFrame())
         {
-            // Device still in valid state
-            result = IControllerInterface::_PollResultSuccessNoData;
-        }
-        else
-        {
-            // New data available. Keep iterating.
-            result = IControllerInterface::_PollResultSuccessNewData;
-        }
+            const PSEyeCaptureFrame &capture_frame = CaptureProcessor->getCurrentFrame();
 
-        {
-            PS3EyeTrackerState newState;
+            // Any frames the capture thread published since the last one we consumed were dropped
+            if (LastFrameSequenceNumber >= 0 && 
+                capture_frame.frame_sequence_number > LastFrameSequenceNumber + 1)
+            {
+                DroppedFrameCount += capture_frame.frame_sequence_number - LastFrameSequenceNumber - 1;
+            }
+            LastFrameSequenceNumber = capture_frame.frame_sequence_number;
 
-            // TODO: Process the frame and extract the blobs
+            // Overwrite the oldest entry in the state ring
+            PS3EyeTrackerState &newState = TrackerStates[NextTrackerStateIndex];
+            newState.clear();
+            newState.CaptureTimestamp = capture_frame.capture_timestamp;
+            newState.FrameSequenceNumber = capture_frame.frame_sequence_number;
 
             // Increment the sequence for every new polling packet
             newState.PollSequenceNumber = NextPollSequenceNumber;
             ++NextPollSequenceNumber;
 
-            // Make room for new entry if at the max queue size
-            //###bwalker $TODO Make this a fixed size circular buffer
-            if (TrackerStates.size() >= PS3EYE_STATE_BUFFER_MAX)
-            {
-                TrackerStates.erase(TrackerStates.begin(), TrackerStates.begin() + TrackerStates.size() - PS3EYE_STATE_BUFFER_MAX);
-            }
+            NextTrackerStateIndex = (NextTrackerStateIndex + 1) % PS3EYE_STATE_BUFFER_MAX;
+            TrackerStateCount = std::min(TrackerStateCount + 1, PS3EYE_STATE_BUFFER_MAX);
 
-            TrackerStates.push_back(newState);
+            // New data available. Keep iterating.
+            result = IControllerInterface::_PollResultSuccessNewData;
+        }
+        else
+        {
+            // Device still in valid state
+            result = IControllerInterface::_PollResultSuccessNoData;
         }
     }
 
@@ -421,10 +659,15 @@ IDeviceInterface::ePollResult PS3EyeTracker::poll()
 
 void PS3EyeTracker::close()
 {
-    if (CaptureData != nullptr)
+    if (CaptureProcessor != nullptr)
     {
-        delete CaptureData;
-        CaptureData = nullptr;
+        CaptureProcessor->stop();
+
+        SERVER_LOG_INFO("PS3EyeTracker::close") << "PS3EyeTracker(" << USBDevicePath << ") dropped " 
+            << DroppedFrameCount << " of " << (LastFrameSequenceNumber + 1) << " captured frames";
+
+        delete CaptureProcessor;
+        CaptureProcessor = nullptr;
     }
 
     if (VideoCapture != nullptr)
@@ -446,9 +689,15 @@ CommonDeviceState::eDeviceType PS3EyeTracker::getDeviceType() const
 
 const CommonDeviceState *PS3EyeTracker::getState(int lookBack) const
 {
-    const int queueSize = static_cast<int>(TrackerStates.size());
-    const CommonDeviceState * result =
-        (lookBack < queueSize) ? &TrackerStates.at(queueSize - lookBack - 1) : nullptr;
+    const CommonDeviceState * result = nullptr;
+
+    if (lookBack >= 0 && lookBack < TrackerStateCount)
+    {
+        const int stateIndex = 
+            (NextTrackerStateIndex - lookBack - 1 + PS3EYE_STATE_BUFFER_MAX) % PS3EYE_STATE_BUFFER_MAX;
+
+        result = &TrackerStates[stateIndex];
+    }
 
     return result;
 }
@@ -526,44 +775,91 @@ const unsigned char *PS3EyeTracker::getVideoFrameBuffer() const
 {
     const unsigned char *result = nullptr;
 
-    if (CaptureData != nullptr)
+    if (CaptureProcessor != nullptr)
     {
-        return static_cast<const unsigned char *>(CaptureData->frame.data);
+        const PSEyeCaptureFrame &capture_frame = CaptureProcessor->getCurrentFrame();
+
+        // Empty until the first frame arrives (or right after the capture settings changed)
+        if (!capture_frame.frame.empty())
+        {
+            result = static_cast<const unsigned char *>(capture_frame.frame.data);
+        }
     }
 
     return result;
 }
 
+ITrackerInterface::eVideoFrameFormat PS3EyeTracker::getVideoFrameFormat() const
+{
+    return VideoFrameFormat;
+}
+
 void PS3EyeTracker::loadSettings()
 {
 	const double currentFrameWidth = VideoCapture->get(cv::CAP_PROP_FRAME_WIDTH);
 	const double currentFrameRate = VideoCapture->get(cv::CAP_PROP_FPS);
-    const double currentExposure= VideoCapture->get(cv::CAP_PROP_EXPOSURE);
-    const double currentGain= VideoCapture->get(cv::CAP_PROP_GAIN);
+    const double currentExposure= getVideoCaptureProperty(cv::CAP_PROP_EXPOSURE);
+    const double currentGain= getVideoCaptureProperty(cv::CAP_PROP_GAIN);
 
     cfg.load();
 
 	if (currentFrameWidth != cfg.frame_width)
 	{
-		VideoCapture->set(cv::CAP_PROP_FRAME_WIDTH, cfg.frame_width);
+		setVideoCaptureProperty(cv::CAP_PROP_FRAME_WIDTH, cfg.frame_width);
 	}
 
     if (currentExposure != cfg.exposure)
     {
-        VideoCapture->set(cv::CAP_PROP_EXPOSURE, cfg.exposure);
+        setVideoCaptureProperty(cv::CAP_PROP_EXPOSURE, cfg.exposure);
     }
 
     if (currentGain != cfg.gain)
     {
-        VideoCapture->set(cv::CAP_PROP_GAIN, cfg.gain);
+        setVideoCaptureProperty(cv::CAP_PROP_GAIN, cfg.gain);
     }
 
 	if (currentFrameRate != cfg.frame_rate)
 	{
-		VideoCapture->set(cv::CAP_PROP_FPS, cfg.frame_rate);
+		setVideoCaptureProperty(cv::CAP_PROP_FPS, cfg.frame_rate);
 	}
 }
 
+void PS3EyeTracker::setVideoCaptureProperty(int property_id, double value)
+{
+    const bool bIsCapturing = CaptureProcessor != nullptr && CaptureProcessor->hasThreadStarted();
+
+    if (bIsCapturing)
+    {
+        // Sensor settings like exposure and gain can be changed while streaming,
+        // but only from the capture thread so they don't race with grab().
+        if (!CaptureProcessor->queueSensorSetting(property_id, value))
+        {
+            // Changing the frame size or frame rate restarts the camera stream out from under the capture thread,
+            // so pause the capture thread while those are applied.
+            CaptureProcessor->stop();
+            VideoCapture->set(property_id, value);
+            CaptureProcessor->start();
+        }
+    }
+    else
+    {
+        VideoCapture->set(property_id, value);
+    }
+}
+
+double PS3EyeTracker::getVideoCaptureProperty(int property_id) const
+{
+    double value;
+
+    // A sensor setting that is still queued for the capture thread is the value the camera is about to have
+    if (CaptureProcessor == nullptr || !CaptureProcessor->fetchPendingSensorSetting(property_id, value))
+    {
+        value = VideoCapture->get(property_id);
+    }
+
+    return value;
+}
+
 void PS3EyeTracker::saveSettings()
 {
     cfg.save();
@@ -571,7 +867,7 @@ void PS3EyeTracker::saveSettings()
 
 void PS3EyeTracker::setFrameWidth(double value, bool bUpdateConfig)
 {
-	VideoCapture->set(cv::CAP_PROP_FRAME_WIDTH, value);
+	setVideoCaptureProperty(cv::CAP_PROP_FRAME_WIDTH, value);
 
 	if (bUpdateConfig)
 	{
@@ -586,7 +882,7 @@ double PS3EyeTracker::getFrameWidth() const
 
 void PS3EyeTracker::setFrameHeight(double value, bool bUpdateConfig)
 {
-	VideoCapture->set(cv::CAP_PROP_FRAME_HEIGHT, value);
+	setVideoCaptureProperty(cv::CAP_PROP_FRAME_HEIGHT, value);
 
 	if (bUpdateConfig)
 	{
@@ -601,7 +897,7 @@ double PS3EyeTracker::getFrameHeight() const
 
 void PS3EyeTracker::setFrameRate(double value, bool bUpdateConfig)
 {
-	VideoCapture->set(cv::CAP_PROP_FPS, value);
+	setVideoCaptureProperty(cv::CAP_PROP_FPS, value);
 
 	if (bUpdateConfig)
 	{
@@ -616,7 +912,7 @@ double PS3EyeTracker::getFrameRate() const
 
 void PS3EyeTracker::setExposure(double value, bool bUpdateConfig)
 {
-    VideoCapture->set(cv::CAP_PROP_EXPOSURE, value);
+    setVideoCaptureProperty(cv::CAP_PROP_EXPOSURE, value);
 
 	if (bUpdateConfig)
 	{
@@ -626,12 +922,12 @@ void PS3EyeTracker::setExposure(double value, bool bUpdateConfig)
 
 double PS3EyeTracker::getExposure() const
 {
-    return VideoCapture->get(cv::CAP_PROP_EXPOSURE);
+    return getVideoCaptureProperty(cv::CAP_PROP_EXPOSURE);
 }
 
 void PS3EyeTracker::setGain(double value, bool bUpdateConfig)
 {
-	VideoCapture->set(cv::CAP_PROP_GAIN, value);
+	setVideoCaptureProperty(cv::CAP_PROP_GAIN, value);
 
 	if (bUpdateConfig)
 	{
@@ -641,7 +937,7 @@ void PS3EyeTracker::setGain(double value, bool bUpdateConfig)
 
 double PS3EyeTracker::getGain() const
 {
-	return VideoCapture->get(cv::CAP_PROP_GAIN);
+	return getVideoCaptureProperty(cv::CAP_PROP_GAIN);
 }
 
 void PS3EyeTracker::getCameraIntrinsics(
@@ -5,9 +5,12 @@
 #include "PSMoveConfig.h"
 #include "DeviceEnumerator.h"
 #include "DeviceInterface.h"
+#include <chrono>
 #include <string>
 #include <vector>
-#include <deque>
+
+// -- constants -----
+#define PS3EYE_STATE_BUFFER_MAX 16
 
 // -- pre-declarations -----
 namespace PSMoveProtocol
@@ -67,6 +70,10 @@ public:
 
 struct PS3EyeTrackerState : public CommonDeviceState
 {   
+    // The CaptureTimestamp is the time the capture thread received the frame from the camera.
+    // Sequence number assigned by the capture thread (gaps mean dropped frames)
+    int FrameSequenceNumber;
+
     PS3EyeTrackerState()
     {
         clear();
@@ -76,6 +83,7 @@ struct PS3EyeTrackerState : public CommonDeviceState
     {
         CommonDeviceState::clear();
         DeviceType = CommonDeviceState::PS3EYE;
+        FrameSequenceNumber = -1;
     }
 };
 
@@ -105,6 +113,7 @@ public:
     std::string getUSBDevicePath() const override;
     bool getVideoFrameDimensions(int *out_width, int *out_height, int *out_stride) const override;
     const unsigned char *getVideoFrameBuffer() const override;
+    ITrackerInterface::eVideoFrameFormat getVideoFrameFormat() const override;
     void loadSettings() override;
     void saveSettings() override;
 	void setFrameWidth(double value, bool bUpdateConfig) override;
@@ -142,15 +151,29 @@ public:
     inline const PS3EyeTrackerConfig &getConfig() const
     { return cfg; }
 
+    // Number of frames the capture thread produced that poll() never consumed
+    inline int getDroppedFrameCount() const
+    { return DroppedFrameCount; }
+
 private:
+    void setVideoCaptureProperty(int property_id, double value);
+    double getVideoCaptureProperty(int property_id) const;
+
     PS3EyeTrackerConfig cfg;
     std::string USBDevicePath;
     class PSEyeVideoCapture *VideoCapture;
-    class PSEyeCaptureData *CaptureData;
+    class PSEyeCaptureProcessor *CaptureProcessor;
     ITrackerInterface::eDriverType DriverType;    
+    ITrackerInterface::eVideoFrameFormat VideoFrameFormat;
     
     // Read Controller State
     int NextPollSequenceNumber;
-    std::deque<PS3EyeTrackerState> TrackerStates;
+    PS3EyeTrackerState TrackerStates[PS3EYE_STATE_BUFFER_MAX];
+    int TrackerStateCount;
+    int NextTrackerStateIndex;
+
+    // Frame accounting
+    int LastFrameSequenceNumber;
+    int DroppedFrameCount;
 };
 #endif // PS3EYE_TRACKER_H
@@ -370,9 +370,18 @@ public:
 
     bool retrieveFrame(int outputType, cv::OutputArray outArray)
     {
-        eye->getFrame(m_MatBayer.data);
+        if (outputType == PSEYE_RETRIEVE_BAYER_GB)
+        {
+            // Let the caller debayer only the parts of the frame it cares about
+            outArray.create(cv::Size(m_width, m_height), CV_8UC1);
+            eye->getFrame(outArray.getMat().data);
+        }
+        else
+        {
+            eye->getFrame(m_MatBayer.data);
 
-        cv::cvtColor(m_MatBayer, outArray, CV_BayerGB2BGR);
+            cv::cvtColor(m_MatBayer, outArray, CV_BayerGB2BGR);
+        }
         return true;
     }
 
@@ -620,6 +629,15 @@ std::string PSEyeVideoCapture::getUniqueIndentifier() const
     return m_indentifier;
 }
 
+bool PSEyeVideoCapture::getSupportsBayerFrames() const
+{
+#ifdef HAVE_PS3EYE
+    return !icap.empty() && icap->getCaptureDomain() == PSEYE_CAP_PS3EYE;
+#else
+    return false;
+#endif
+}
+
 cv::Ptr<cv::IVideoCapture> PSEyeVideoCapture::pseyeVideoCapture_create(int index)
 {
     // https://github.com/Itseez/opencv/blob/09e6c82190b558e74e2e6a53df09844665443d6d/modules/videoio/src/cap.cpp#L432
@@ -3,6 +3,10 @@
 
 #include <opencv2/videoio.hpp>
 
+/// Pass as the flag to retrieve() to get the raw 8-bit GBRG Bayer frame instead of a debayered BGR frame.
+/// Only valid when PSEyeVideoCapture::getSupportsBayerFrames() is true.
+#define PSEYE_RETRIEVE_BAYER_GB 0x5045
+
 /// Video capture class that prioritizes PS3 Eye devices.
 /**
 Device opening priority:
@@ -48,6 +52,9 @@ public:
 
     /// Get the unique identifier for the camera
     std::string getUniqueIndentifier() const;
+
+    /// True if retrieve() can hand back the raw Bayer frame (see \ref PSEYE_RETRIEVE_BAYER_GB)
+    bool getSupportsBayerFrames() const;
     
 protected:
     int m_index; /**< Keep track of index. Necessary for PSEYE_CLEYE_DRIVER */
@@ -133,9 +133,20 @@ ThreadSafeLoggerStream::ThreadSafeLoggerStream(bool bEmit) :
 {
 }
 
+ThreadSafeLoggerStream::~ThreadSafeLoggerStream()
+{
+	// The base class destructor would only reach the unlocked LoggerStream::write_line()
+	write_line();
+	m_bEmitLine= false;
+}
+
 void ThreadSafeLoggerStream::write_line()
 {
-	std::lock_guard<std::mutex> lock(*g_logger_mutex);
+	// No mutex also means no streams to write to (log_init() wasn't called)
+	if (g_logger_mutex != nullptr)
+	{
+		std::lock_guard<std::mutex> lock(*g_logger_mutex);
 
-	LoggerStream::write_line();
+		LoggerStream::write_line();
+	}
 }
\ No newline at end of file
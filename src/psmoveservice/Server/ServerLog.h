@@ -47,6 +47,7 @@ class ThreadSafeLoggerStream : public LoggerStream
 {
 public:
 	ThreadSafeLoggerStream(bool bEmit);
+	virtual ~ThreadSafeLoggerStream();
 
 protected:
 	void write_line() override;
@@ -2,6 +2,7 @@
 #include "ServerNetworkManager.h"
 #include "ServerRequestHandler.h"
 #include "ServerLog.h"
+#include "CompactDataFrame.h"
 #include "PackedMessage.h"
 #include "PSMoveProtocolInterface.h"
 #include "PSMoveProtocol.pb.h"
@@ -34,7 +35,154 @@ typedef std::pair<int, ClientConnectionPtr> t_id_client_connection_pair;
 //-- constants -----
 const int PSMOVE_SERVER_PORT = 9512;
 
+// Enough packed data frames for a full publish of every device to a few connections
+// with a couple of frames backed up on each one. The pool grows if this isn't enough.
+const int k_initial_packed_data_frame_pool_size = 64;
+
 //-- private implementation -----
+// -PackedDataFramePool-
+/// Recycles the buffers of packed data frames so that packing a data frame doesn't allocate.
+/// Only used from the main thread, like the rest of the network manager.
+class PackedDataFramePool
+{
+public:
+    PackedDataFramePool(const int initial_frame_count)
+        : m_frames()
+        , m_free_frames()
+    {
+        m_frames.reserve(initial_frame_count);
+        m_free_frames.reserve(initial_frame_count);
+
+        for (int frame_index = 0; frame_index < initial_frame_count; ++frame_index)
+        {
+            PackedDeviceOutputDataFrame *frame= new PackedDeviceOutputDataFrame(this);
+
+            m_frames.push_back(frame);
+            m_free_frames.push_back(frame);
+        }
+    }
+
+    virtual ~PackedDataFramePool()
+    {
+        for (PackedDeviceOutputDataFrame *frame : m_frames)
+        {
+            if (frame->m_ref_count.load() == 0)
+            {
+                delete frame;
+            }
+            else
+            {
+                // Still queued on a connection that hasn't been cleaned up yet,
+                // the last reference deletes the frame instead of recycling it
+                frame->m_pool= nullptr;
+            }
+        }
+    }
+
+    PackedDeviceOutputDataFramePtr pack(const PSMoveProtocol::DeviceOutputDataFrame &data_frame)
+    {
+        PackedDeviceOutputDataFramePtr result;
+
+        // The client reads data frames into a buffer of this size
+        if (data_frame.ByteSize() < MAX_OUTPUT_DATA_FRAME_MESSAGE_SIZE)
+        {
+            PackedDeviceOutputDataFrame *frame= allocate_frame();
+
+            if (PackedMessage<PSMoveProtocol::DeviceOutputDataFrame>::pack_message(data_frame, frame->m_buffer))
+            {
+                result= frame;
+            }
+            else
+            {
+                recycle_frame(frame);
+            }
+        }
+        else
+        {
+            SERVER_LOG_ERROR("ServerNetworkManager::pack_device_data_frame") 
+                << "DataFrame too big to fit in packet!";
+        }
+
+        return result;
+    }
+
+    PackedDeviceOutputDataFramePtr pack_compact(const CompactDataFrameHeader *compact_data_frame)
+    {
+        PackedDeviceOutputDataFrame *frame= allocate_frame();
+
+        // A compact data frame is already in its wire format, it just gets copied.
+        // Stays within the capacity the buffer was created with, so this doesn't allocate.
+        frame->m_buffer.resize(compact_data_frame->frame_size);
+        memcpy(frame->m_buffer.data(), compact_data_frame, compact_data_frame->frame_size);
+
+        return PackedDeviceOutputDataFramePtr(frame);
+    }
+
+    void recycle_frame(PackedDeviceOutputDataFrame *frame)
+    {
+        m_free_frames.push_back(frame);
+    }
+
+protected:
+    PackedDeviceOutputDataFrame *allocate_frame()
+    {
+        PackedDeviceOutputDataFrame *frame= nullptr;
+
+        if (m_free_frames.size() > 0)
+        {
+            frame= m_free_frames.back();
+            m_free_frames.pop_back();
+        }
+        else
+        {
+            frame= new PackedDeviceOutputDataFrame(this);
+            m_frames.push_back(frame);
+
+            // Keep room to recycle every frame without the free list reallocating
+            m_free_frames.reserve(m_frames.size());
+
+            SERVER_LOG_DEBUG("PackedDataFramePool::allocate_frame") 
+                << "Grew packed data frame pool to " << m_frames.size() << " frames";
+        }
+
+        return frame;
+    }
+
+private:
+    std::vector<PackedDeviceOutputDataFrame *> m_frames;
+    std::vector<PackedDeviceOutputDataFrame *> m_free_frames;
+};
+
+PackedDeviceOutputDataFrame::PackedDeviceOutputDataFrame(PackedDataFramePool *pool)
+    : m_pool(pool)
+    , m_buffer()
+{
+    m_ref_count= 0;
+    m_buffer.reserve(HEADER_SIZE + MAX_OUTPUT_DATA_FRAME_MESSAGE_SIZE);
+}
+
+void intrusive_ptr_add_ref(const PackedDeviceOutputDataFrame *packed_data_frame)
+{
+    ++packed_data_frame->m_ref_count;
+}
+
+void intrusive_ptr_release(const PackedDeviceOutputDataFrame *packed_data_frame)
+{
+    if (--packed_data_frame->m_ref_count == 0)
+    {
+        PackedDeviceOutputDataFrame *frame= const_cast<PackedDeviceOutputDataFrame *>(packed_data_frame);
+
+        if (frame->m_pool != nullptr)
+        {
+            frame->m_pool->recycle_frame(frame);
+        }
+        else
+        {
+            delete frame;
+        }
+    }
+}
+
 class IServerNetworkEventListener
 {
 public:
@@ -187,6 +335,14 @@ public:
         return m_is_udp_remote_endpoint_bound;
     }
 
+    bool is_loopback() const
+    {
+        boost::system::error_code error;
+        const tcp::endpoint remote_endpoint= m_tcp_socket.remote_endpoint(error);
+
+        return !error && remote_endpoint.address().is_loopback();
+    }
+
     bool can_send_data_to_client() const
     {
         return m_connection_started && !m_connection_stopped;
@@ -248,9 +404,9 @@ public:
         return write_in_progress;
     }
     
-    void add_device_data_frame_to_write_queue(DeviceOutputDataFramePtr data_frame)
+    void add_device_data_frame_to_write_queue(PackedDeviceOutputDataFramePtr packed_data_frame)
     {
-        m_pending_dataframes.push_back(data_frame);
+        m_pending_dataframes.push_back(packed_data_frame);
     }
 
     bool start_udp_write_queued_device_data_frame()
@@ -263,34 +419,42 @@ public:
             {
                 if (m_pending_dataframes.size() > 0)
                 {
-                    DeviceOutputDataFramePtr dataframe= m_pending_dataframes.front();
-
-                    m_packed_output_dataframe.set_msg(dataframe);
-                    if (m_packed_output_dataframe.pack(m_output_dataframe_buffer, sizeof(m_output_dataframe_buffer)))
+                    // Every data frame is self delimiting (length header or compact frame size),
+                    // so as many queued frames as fit get sent back to back in a single datagram.
+                    // The packed data frames may be shared with other connections, 
+                    // they stay alive in the queue until the write completes.
+                    size_t datagram_size= 0;
+
+                    m_udp_write_buffers.clear();
+                    for (const PackedDeviceOutputDataFramePtr &packed_dataframe : m_pending_dataframes)
                     {
-                        int msg_size= m_packed_output_dataframe.get_msg()->ByteSize();
-
-                        SERVER_LOG_DEBUG("ClientConnection::start_udp_write_queued_device_data_frame") << "Sending UDP DataFrame";
-                        SERVER_LOG_DEBUG("   ") << show_hex(m_output_dataframe_buffer, HEADER_SIZE+msg_size);
-                        SERVER_LOG_DEBUG("   ") << msg_size << " bytes";
-
-                        // The queue should prevent us from writing more than one data frame at once
-                        assert(!m_has_pending_udp_write);
-                        m_has_pending_udp_write= true;
-                        write_in_progress= true;
-
-                        // Start an asynchronous operation to send the data frame
-                        // NOTE: Even if the write completes immediate, the callback will only be called from io_service::poll()
-                        m_udp_socket_ref.async_send_to(
-                            boost::asio::buffer(m_output_dataframe_buffer, sizeof(m_output_dataframe_buffer)),
-                            m_udp_remote_endpoint,
-                            boost::bind(&ClientConnection::handle_udp_write_device_data_frame_complete, this, _1));
-                    }
-                    else
-                    {
-                        SERVER_LOG_ERROR("ClientConnection::start_udp_write_queued_device_data_frame") 
-                            << "DataFrame too big to fit in packet!";
+                        const std::vector<unsigned char> &frame_buffer= packed_dataframe->getBuffer();
+
+                        if (m_udp_write_buffers.size() > 0 && 
+                            datagram_size + frame_buffer.size() > MAX_OUTPUT_DATA_FRAME_DATAGRAM_SIZE)
+                        {
+                            break;
+                        }
+
+                        m_udp_write_buffers.push_back(boost::asio::buffer(frame_buffer));
+                        datagram_size+= frame_buffer.size();
                     }
+
+                    SERVER_LOG_DEBUG("ClientConnection::start_udp_write_queued_device_data_frame") 
+                        << "Sending UDP datagram with " << m_udp_write_buffers.size() << " DataFrame(s), "
+                        << datagram_size << " bytes";
+
+                    // The queue should prevent us from writing more than one datagram at once
+                    assert(!m_has_pending_udp_write);
+                    m_has_pending_udp_write= true;
+                    write_in_progress= true;
+
+                    // Start an asynchronous operation to send the gathered data frames as one datagram
+                    // NOTE: Even if the write completes immediate, the callback will only be called from io_service::poll()
+                    m_udp_socket_ref.async_send_to(
+                        m_udp_write_buffers,
+                        m_udp_remote_endpoint,
+                        boost::bind(&ClientConnection::handle_udp_write_device_data_frame_complete, this, _1));
                 }
             }
             else
@@ -321,11 +485,10 @@ private:
     vector<uint8_t> m_response_write_buffer;
     PackedMessage<PSMoveProtocol::Response> m_packed_response;
 
-    uint8_t m_output_dataframe_buffer[HEADER_SIZE+MAX_OUTPUT_DATA_FRAME_MESSAGE_SIZE];
-    PackedMessage<PSMoveProtocol::DeviceOutputDataFrame> m_packed_output_dataframe;
-
     deque<ResponsePtr> m_pending_responses;
-    deque<DeviceOutputDataFramePtr> m_pending_dataframes;
+    deque<PackedDeviceOutputDataFramePtr> m_pending_dataframes;
+    // The front of m_pending_dataframes gathered into the datagram being written
+    std::vector<boost::asio::const_buffer> m_udp_write_buffers;
     
     bool m_connection_started;
     bool m_connection_stopped;
@@ -348,15 +511,14 @@ private:
         , m_packed_request(std::shared_ptr<PSMoveProtocol::Request>(new PSMoveProtocol::Request()))
         , m_response_write_buffer()
         , m_packed_response()
-        , m_packed_output_dataframe()
         , m_pending_responses()
         , m_pending_dataframes()
+        , m_udp_write_buffers()
         , m_connection_started(false)
         , m_connection_stopped(false)
         , m_has_pending_tcp_write(false)
         , m_has_pending_udp_write(false)
     {
-        memset(m_output_dataframe_buffer, 0, sizeof(m_output_dataframe_buffer));
         next_connection_id++;
     }
 
@@ -524,13 +686,16 @@ private:
         if (!ec)
         {
             SERVER_LOG_TRACE("ClientConnection::handle_udp_write_device_data_frame_complete") 
-                << "Sent UDP data frame on connection id " << m_connection_id;
+                << "Sent " << m_udp_write_buffers.size() << " UDP data frame(s) on connection id " << m_connection_id;
 
             // no longer is there a pending write
             m_has_pending_udp_write= false;
 
-            // Remove the dataframe from the pending send queue now that it's sent
-            m_pending_dataframes.pop_front();
+            // Remove the dataframes from the pending send queue now that they're sent
+            m_pending_dataframes.erase(
+                m_pending_dataframes.begin(), 
+                m_pending_dataframes.begin() + m_udp_write_buffers.size());
+            m_udp_write_buffers.clear();
         }
         else
         {
@@ -557,6 +722,7 @@ public:
         , m_packed_input_dataframe(std::shared_ptr<PSMoveProtocol::DeviceInputDataFrame>(new PSMoveProtocol::DeviceInputDataFrame()))
         , m_udp_connection_result_write_buffer(false)
         , m_has_pending_udp_read(false)
+        , m_packed_data_frame_pool(k_initial_packed_data_frame_pool_size)
         , m_connections()
     {
         memset(m_input_dataframe_buffer, 0, sizeof(m_input_dataframe_buffer));
@@ -710,7 +876,24 @@ public:
         }
     }
 
-    void send_device_data_frame(int connection_id, DeviceOutputDataFramePtr data_frame)
+    bool get_is_loopback_connection(int connection_id)
+    {
+        t_client_connection_map_iter entry = m_connections.find(connection_id);
+
+        return entry != m_connections.end() && entry->second->is_loopback();
+    }
+
+    PackedDeviceOutputDataFramePtr pack_device_data_frame(const PSMoveProtocol::DeviceOutputDataFrame &data_frame)
+    {
+        return m_packed_data_frame_pool.pack(data_frame);
+    }
+
+    PackedDeviceOutputDataFramePtr pack_compact_data_frame(const CompactDataFrameHeader *compact_data_frame)
+    {
+        return m_packed_data_frame_pool.pack_compact(compact_data_frame);
+    }
+
+    void send_packed_device_data_frame(int connection_id, PackedDeviceOutputDataFramePtr packed_data_frame)
     {
         t_client_connection_map_iter entry = m_connections.find(connection_id);
 
@@ -721,9 +904,9 @@ public:
             SERVER_LOG_TRACE("ServerNetworkManager::send_device_data_frame") 
                 << "Sending data_frame to connection " << connection_id;
 
-            connection->add_device_data_frame_to_write_queue(data_frame);
-
-            start_udp_queued_data_frame_write();
+            // The write gets started by poll() once all of the data frames of this update are queued,
+            // so that they go out together in as few datagrams as possible
+            connection->add_device_data_frame_to_write_queue(packed_data_frame);
         }
         else
         {
@@ -772,6 +955,9 @@ private:
     // If true, we are already waiting for a client to send the connection id
     bool m_has_pending_udp_read;
 
+    // Buffers recycled by the packed data frames queued on the connections
+    PackedDataFramePool m_packed_data_frame_pool;
+
     // A mapping from connection_id -> ClientConnectionPtr
     t_client_connection_map m_connections;
 
@@ -1035,10 +1221,52 @@ void ServerNetworkManager::send_notification_to_all_clients(ResponsePtr response
 	}
 }
 
+bool ServerNetworkManager::get_is_loopback_connection(int connection_id)
+{
+	return implementation_ptr != nullptr && implementation_ptr->get_is_loopback_connection(connection_id);
+}
+
 void ServerNetworkManager::send_device_data_frame(int connection_id, DeviceOutputDataFramePtr data_frame)
 {
 	if (implementation_ptr != nullptr)
 	{    
-		implementation_ptr->send_device_data_frame(connection_id, data_frame);
+		PackedDeviceOutputDataFramePtr packed_data_frame= pack_device_data_frame(*data_frame);
+
+		if (packed_data_frame)
+		{
+			implementation_ptr->send_packed_device_data_frame(connection_id, packed_data_frame);
+		}
+	}
+}
+
+void ServerNetworkManager::send_packed_device_data_frame(int connection_id, PackedDeviceOutputDataFramePtr packed_data_frame)
+{
+	if (implementation_ptr != nullptr)
+	{    
+		implementation_ptr->send_packed_device_data_frame(connection_id, packed_data_frame);
 	}
 }
+
+PackedDeviceOutputDataFramePtr ServerNetworkManager::pack_device_data_frame(const PSMoveProtocol::DeviceOutputDataFrame &data_frame)
+{
+	PackedDeviceOutputDataFramePtr result;
+
+	if (implementation_ptr != nullptr)
+	{
+		result= implementation_ptr->pack_device_data_frame(data_frame);
+	}
+
+	return result;
+}
+
+PackedDeviceOutputDataFramePtr ServerNetworkManager::pack_compact_data_frame(const CompactDataFrameHeader *compact_data_frame)
+{
+	PackedDeviceOutputDataFramePtr result;
+
+	if (implementation_ptr != nullptr)
+	{
+		result= implementation_ptr->pack_compact_data_frame(compact_data_frame);
+	}
+
+	return result;
+}
@@ -4,6 +4,9 @@
 //-- includes -----
 #include "PSMoveProtocolInterface.h"
 #include "PSMoveConfig.h"
+#include <boost/intrusive_ptr.hpp>
+#include <atomic>
+#include <vector>
 
 //-- pre-declarations -----
 class ServerRequestHandler;
@@ -15,6 +18,28 @@ namespace boost {
 }
 
 //-- definitions -----
+/// A data frame packed (header + message) for sending over UDP.
+/// The buffer is never modified once packed, so it can be queued on any number of connections.
+/// Packed data frames come from a pool of preallocated buffers
+/// and go back to the pool once the last connection is done sending them.
+class PackedDeviceOutputDataFrame
+{
+public:
+    inline const std::vector<unsigned char> &getBuffer() const { return m_buffer; }
+
+private:
+    friend class PackedDataFramePool;
+    friend void intrusive_ptr_add_ref(const PackedDeviceOutputDataFrame *packed_data_frame);
+    friend void intrusive_ptr_release(const PackedDeviceOutputDataFrame *packed_data_frame);
+
+    PackedDeviceOutputDataFrame(class PackedDataFramePool *pool);
+
+    class PackedDataFramePool *m_pool;
+    mutable std::atomic_int m_ref_count;
+    std::vector<unsigned char> m_buffer; // capacity for the biggest data frame packet
+};
+typedef boost::intrusive_ptr<const PackedDeviceOutputDataFrame> PackedDeviceOutputDataFramePtr;
+
 class NetworkManagerConfig : public PSMoveConfig
 {
 public:
@@ -69,6 +94,20 @@ public:
     
     void send_device_data_frame(int connection_id, DeviceOutputDataFramePtr data_frame);
 
+    /// True if the client on the given connection runs on this machine (connected over the loopback interface)
+    bool get_is_loopback_connection(int connection_id);
+
+    /// Queue a data frame packed with pack_device_data_frame() on the given connection
+    void send_packed_device_data_frame(int connection_id, PackedDeviceOutputDataFramePtr packed_data_frame);
+
+    /// Pack a data frame once so that it can be sent to several connections.
+    /// Returns an empty pointer if the data frame doesn't fit in a data frame packet.
+    PackedDeviceOutputDataFramePtr pack_device_data_frame(const PSMoveProtocol::DeviceOutputDataFrame &data_frame);
+
+    /// Pack a controller or HMD data frame that was built in the fixed layout of CompactDataFrame.h.
+    /// The frame_size in the header covers the whole frame.
+    PackedDeviceOutputDataFramePtr pack_compact_data_frame(const struct CompactDataFrameHeader *compact_data_frame);
+
 private:   
 	/// Configuration settings used by the network manager
 	NetworkManagerConfig m_cfg;
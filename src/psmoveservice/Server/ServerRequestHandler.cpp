@@ -25,6 +25,7 @@
 #include "ServerHMDView.h"
 #include "ServerLog.h"
 #include "ServerUtility.h"
+#include "SharedDevicePoseTable.h"
 #include "TrackerManager.h"
 #include "VirtualController.h"
 
@@ -32,11 +33,17 @@
 #include <bitset>
 #include <map>
 #include <boost/shared_ptr.hpp>
+#include <boost/interprocess/shared_memory_object.hpp>
+#include <boost/interprocess/mapped_region.hpp>
 
 //-- pre-declarations -----
 class ServerRequestHandlerImpl;
 typedef boost::shared_ptr<ServerRequestHandlerImpl> ServerRequestHandlerImplPtr;
 
+//-- constants -----
+// Big enough for every data frame built during a single publish
+const size_t k_data_frame_arena_block_size = 16*1024;
+
 //-- definitions -----
 struct RequestConnectionState
 {
@@ -84,6 +91,124 @@ struct RequestContext
     RequestPtr request;
 };
 
+// Owns the shared memory the device pose table gets published in for local clients
+class SharedDevicePoseTableReadWriteAccessor
+{
+public:
+    SharedDevicePoseTableReadWriteAccessor()
+        : m_shared_memory_object(nullptr)
+        , m_region(nullptr)
+    {}
+
+    ~SharedDevicePoseTableReadWriteAccessor()
+    {
+        dispose();
+    }
+
+    bool initialize()
+    {
+        bool bSuccess = false;
+
+        try
+        {
+            SERVER_LOG_INFO("SharedDevicePoseTable::initialize()") << "Allocating shared memory: " << SHARED_DEVICE_POSE_TABLE_NAME;
+
+            // Make sure the shared memory block has been removed first
+            boost::interprocess::shared_memory_object::remove(SHARED_DEVICE_POSE_TABLE_NAME);
+
+            // Allow non admin-level processed to access the shared memory
+            boost::interprocess::permissions permissions;
+            permissions.set_unrestricted();
+
+            // Create the shared memory object
+            m_shared_memory_object =
+                new boost::interprocess::shared_memory_object(
+                    boost::interprocess::create_only,
+                    SHARED_DEVICE_POSE_TABLE_NAME,
+                    boost::interprocess::read_write,
+                    permissions);
+
+            // Resize the shared memory
+            m_shared_memory_object->truncate(sizeof(SharedDevicePoseTable));
+
+            // Map all of the shared memory for read/write access
+            m_region = new boost::interprocess::mapped_region(*m_shared_memory_object, boost::interprocess::read_write);
+
+            // Initialize the shared memory (call constructor using placement new)
+            // This make sure the entry sequence counters have the constructor called on them.
+            new (getTable()) SharedDevicePoseTable();
+
+            bSuccess = true;
+        }
+        catch (boost::interprocess::interprocess_exception &ex)
+        {
+            dispose();
+            SERVER_LOG_ERROR("SharedDevicePoseTable::initialize()") << "Failed to allocated shared memory: " << SHARED_DEVICE_POSE_TABLE_NAME
+                << ", reason: " << ex.what();
+        }
+
+        return bSuccess;
+    }
+
+    void dispose()
+    {
+        if (m_region != nullptr)
+        {
+            // Call the destructor manually on the table since it was constructed via placement new
+            getTable()->~SharedDevicePoseTable();
+
+            delete m_region;
+            m_region = nullptr;
+        }
+
+        if (m_shared_memory_object != nullptr)
+        {
+            delete m_shared_memory_object;
+            m_shared_memory_object = nullptr;
+
+            if (!boost::interprocess::shared_memory_object::remove(SHARED_DEVICE_POSE_TABLE_NAME))
+            {
+                SERVER_LOG_ERROR("SharedDevicePoseTable::dispose") << "Failed to free shared memory: " << SHARED_DEVICE_POSE_TABLE_NAME;
+            }
+        }
+    }
+
+    inline bool getIsOpen() const
+    {
+        return m_region != nullptr;
+    }
+
+    void writeControllerDataFrame(int controller_id, const std::vector<unsigned char> &compact_data_frame)
+    {
+        if (controller_id >= 0 && controller_id < PSMOVESERVICE_MAX_CONTROLLER_COUNT &&
+            compact_data_frame.size() == sizeof(CompactControllerDataFrame))
+        {
+            SharedDevicePoseTable::writeEntry(
+                getTable()->controllers[controller_id], compact_data_frame.data(), compact_data_frame.size());
+        }
+    }
+
+    void writeHmdDataFrame(int hmd_id, const std::vector<unsigned char> &compact_data_frame)
+    {
+        if (hmd_id >= 0 && hmd_id < PSMOVESERVICE_MAX_HMD_COUNT &&
+            compact_data_frame.size() == sizeof(CompactHMDDataFrame))
+        {
+            SharedDevicePoseTable::writeEntry(
+                getTable()->hmds[hmd_id], compact_data_frame.data(), compact_data_frame.size());
+        }
+    }
+
+protected:
+    SharedDevicePoseTable *getTable()
+    {
+        return reinterpret_cast<SharedDevicePoseTable *>(m_region->get_address());
+    }
+
+private:
+    boost::interprocess::shared_memory_object *m_shared_memory_object;
+    boost::interprocess::mapped_region *m_region;
+};
+
 //-- private implementation -----
 class ServerRequestHandlerImpl
 {
@@ -91,7 +216,24 @@ public:
     ServerRequestHandlerImpl(DeviceManager &deviceManager)
         : m_device_manager(deviceManager)
         , m_connection_state_map()
+        , m_published_data_frames()
+        , m_data_frame_arena_block(k_data_frame_arena_block_size)
+        , m_data_frame_arena(make_data_frame_arena_options(m_data_frame_arena_block))
+        , m_shared_pose_table()
     {
+        memset(m_shared_pose_table_controller_subscribers, 0, sizeof(m_shared_pose_table_controller_subscribers));
+        memset(m_shared_pose_table_hmd_subscribers, 0, sizeof(m_shared_pose_table_hmd_subscribers));
+
+        // The shared pose table holds everything a compact data frame can carry
+        m_shared_pose_table_controller_stream_info.Clear();
+        m_shared_pose_table_controller_stream_info.include_position_data= true;
+        m_shared_pose_table_controller_stream_info.include_physics_data= true;
+        m_shared_pose_table_controller_stream_info.use_compact_data_frames= true;
+
+        m_shared_pose_table_hmd_stream_info.Clear();
+        m_shared_pose_table_hmd_stream_info.include_position_data= true;
+        m_shared_pose_table_hmd_stream_info.include_physics_data= true;
+        m_shared_pose_table_hmd_stream_info.use_compact_data_frames= true;
     }
 
     virtual ~ServerRequestHandlerImpl()
@@ -100,6 +242,20 @@ public:
         // "Delete called on 'class ServerRequestHandlerImpl' that has virtual functions but non-virtual destructor"
     }
 
+    void startup()
+    {
+        // Not fatal, local clients just fall back to the data frame stream
+        if (!m_shared_pose_table.initialize())
+        {
+            SERVER_LOG_WARNING("ServerRequestHandler::startup") << "Shared device pose table unavailable";
+        }
+    }
+
+    void shutdown()
+    {
+        m_shared_pose_table.dispose();
+    }
+
     bool any_active_bluetooth_requests() const
     {
         bool any_active= false;
@@ -432,6 +588,11 @@ public:
                 const ControllerStreamInfo &streamInfo = connection_state->active_controller_stream_info[controller_id];
                 ServerControllerViewPtr controller_view = m_device_manager.getControllerViewPtr(controller_id);
 
+                if (streamInfo.use_shared_pose_table)
+                {
+                    --m_shared_pose_table_controller_subscribers[controller_id];
+                }
+
                 if (controller_view->getIsOpen())
                 {
                     // Clear any LED overrides we had active
@@ -480,6 +641,11 @@ public:
                 const HMDStreamInfo &streamInfo = connection_state->active_hmd_stream_info[hmd_id];
                 ServerHMDViewPtr hmd_view = m_device_manager.getHMDViewPtr(hmd_id);
 
+                if (streamInfo.use_shared_pose_table)
+                {
+                    --m_shared_pose_table_hmd_subscribers[hmd_id];
+                }
+
                 // Undo the ROI suppression
                 if (streamInfo.disable_roi)
                 {
@@ -500,7 +666,8 @@ public:
 
     void publish_controller_data_frame(
          ServerControllerView *controller_view, 
-         ServerRequestHandler::t_generate_controller_data_frame_for_stream callback)
+         ServerRequestHandler::t_generate_controller_data_frame_for_stream callback,
+         ServerRequestHandler::t_generate_compact_controller_data_frame_for_stream compact_callback)
     {
         int controller_id= controller_view->getDeviceID();
 
@@ -515,14 +682,29 @@ public:
                 const ControllerStreamInfo &streamInfo=
                     connection_state->active_controller_stream_info[controller_id];
 
-                // Fill out a data frame specific to this stream using the given callback
-                DeviceOutputDataFramePtr data_frame(new PSMoveProtocol::DeviceOutputDataFrame);
-                callback(controller_view, &streamInfo, data_frame.get());
+                // The client reads this controller out of the shared pose table instead
+                if (streamInfo.use_shared_pose_table)
+                {
+                    continue;
+                }
+
+                PackedDeviceOutputDataFramePtr packed_data_frame= 
+                    get_controller_data_frame_for_stream(controller_view, streamInfo, callback, compact_callback);
 
                 // Send the controller data frame over the network
-                ServerNetworkManager::get_instance()->send_device_data_frame(connection_id, data_frame);
+                if (packed_data_frame)
+                {
+                    ServerNetworkManager::get_instance()->send_packed_device_data_frame(connection_id, packed_data_frame);
+                }
             }
         }
+
+        if (m_shared_pose_table_controller_subscribers[controller_id] > 0)
+        {
+            write_shared_controller_pose(controller_view, callback, compact_callback);
+        }
+
+        release_published_data_frames();
     }
 
     void publish_tracker_data_frame(
@@ -542,19 +724,35 @@ public:
                 const TrackerStreamInfo &streamInfo =
                     connection_state->active_tracker_stream_info[tracker_id];
 
-                // Fill out a data frame specific to this stream using the given callback
-                DeviceOutputDataFramePtr data_frame(new PSMoveProtocol::DeviceOutputDataFrame);
-                callback(tracker_view, &streamInfo, data_frame);
+                const int data_frame_signature = streamInfo.GetDataFrameSignature();
+                PackedDeviceOutputDataFramePtr packed_data_frame;
+
+                if (!find_published_data_frame(data_frame_signature, packed_data_frame))
+                {
+                    // Fill out a data frame specific to this kind of stream using the given callback
+                    PSMoveProtocol::DeviceOutputDataFrame *data_frame = create_data_frame();
+                    callback(tracker_view, &streamInfo, data_frame);
+
+                    packed_data_frame = add_published_data_frame(
+                        data_frame_signature, 
+                        ServerNetworkManager::get_instance()->pack_device_data_frame(*data_frame));
+                }
 
                 // Send the tracker data frame over the network
-                ServerNetworkManager::get_instance()->send_device_data_frame(connection_id, data_frame);
+                if (packed_data_frame)
+                {
+                    ServerNetworkManager::get_instance()->send_packed_device_data_frame(connection_id, packed_data_frame);
+                }
             }
         }
+
+        release_published_data_frames();
     }
 
     void publish_hmd_data_frame(
         class ServerHMDView *hmd_view,
-        ServerRequestHandler::t_generate_hmd_data_frame_for_stream callback)
+        ServerRequestHandler::t_generate_hmd_data_frame_for_stream callback,
+        ServerRequestHandler::t_generate_compact_hmd_data_frame_for_stream compact_callback)
     {
         int hmd_id = hmd_view->getDeviceID();
 
@@ -569,17 +767,199 @@ public:
                 const HMDStreamInfo &streamInfo =
                     connection_state->active_hmd_stream_info[hmd_id];
 
-                // Fill out a data frame specific to this stream using the given callback
-                DeviceOutputDataFramePtr data_frame(new PSMoveProtocol::DeviceOutputDataFrame);
-                callback(hmd_view, &streamInfo, data_frame);
+                // The client reads this HMD out of the shared pose table instead
+                if (streamInfo.use_shared_pose_table)
+                {
+                    continue;
+                }
+
+                PackedDeviceOutputDataFramePtr packed_data_frame = 
+                    get_hmd_data_frame_for_stream(hmd_view, streamInfo, callback, compact_callback);
 
                 // Send the hmd data frame over the network
-                ServerNetworkManager::get_instance()->send_device_data_frame(connection_id, data_frame);
+                if (packed_data_frame)
+                {
+                    ServerNetworkManager::get_instance()->send_packed_device_data_frame(connection_id, packed_data_frame);
+                }
             }
         }
+
+        if (m_shared_pose_table_hmd_subscribers[hmd_id] > 0)
+        {
+            write_shared_hmd_pose(hmd_view, callback, compact_callback);
+        }
+
+        release_published_data_frames();
     }    
 
 protected:
+    // The shared pose table is only honored while it's there to read from,
+    // and only for clients on this machine, every other client gets data frames
+    bool can_use_shared_pose_table(const RequestContext &context, const bool bRequested)
+    {
+        return
+            bRequested &&
+            m_shared_pose_table.getIsOpen() &&
+            ServerNetworkManager::get_instance()->get_is_loopback_connection(context.connection_state->connection_id);
+    }
+
+    // Reuses the compact data frame of a stream with the same settings if one was built already
+    void write_shared_controller_pose(
+        ServerControllerView *controller_view,
+        ServerRequestHandler::t_generate_controller_data_frame_for_stream callback,
+        ServerRequestHandler::t_generate_compact_controller_data_frame_for_stream compact_callback)
+    {
+        PackedDeviceOutputDataFramePtr packed_data_frame= 
+            get_controller_data_frame_for_stream(
+                controller_view, m_shared_pose_table_controller_stream_info, callback, compact_callback);
+
+        if (packed_data_frame)
+        {
+            m_shared_pose_table.writeControllerDataFrame(controller_view->getDeviceID(), packed_data_frame->getBuffer());
+        }
+    }
+
+    void write_shared_hmd_pose(
+        class ServerHMDView *hmd_view,
+        ServerRequestHandler::t_generate_hmd_data_frame_for_stream callback,
+        ServerRequestHandler::t_generate_compact_hmd_data_frame_for_stream compact_callback)
+    {
+        PackedDeviceOutputDataFramePtr packed_data_frame= 
+            get_hmd_data_frame_for_stream(
+                hmd_view, m_shared_pose_table_hmd_stream_info, callback, compact_callback);
+
+        if (packed_data_frame)
+        {
+            m_shared_pose_table.writeHmdDataFrame(hmd_view->getDeviceID(), packed_data_frame->getBuffer());
+        }
+    }
+
+    // Fill out the data frame for this kind of stream using the given callbacks,
+    // compact data frames get built straight from the controller view without a protobuf message in between
+    PackedDeviceOutputDataFramePtr get_controller_data_frame_for_stream(
+        ServerControllerView *controller_view,
+        const ControllerStreamInfo &streamInfo,
+        ServerRequestHandler::t_generate_controller_data_frame_for_stream callback,
+        ServerRequestHandler::t_generate_compact_controller_data_frame_for_stream compact_callback)
+    {
+        const int data_frame_signature= streamInfo.GetDataFrameSignature();
+        PackedDeviceOutputDataFramePtr packed_data_frame;
+
+        if (!find_published_data_frame(data_frame_signature, packed_data_frame))
+        {
+            ServerNetworkManager *network_manager= ServerNetworkManager::get_instance();
+
+            if (streamInfo.use_compact_data_frames)
+            {
+                CompactControllerDataFrame compact_data_frame;
+                memset(&compact_data_frame, 0, sizeof(compact_data_frame));
+                compact_callback(controller_view, &streamInfo, &compact_data_frame);
+
+                packed_data_frame= add_published_data_frame(
+                    data_frame_signature, network_manager->pack_compact_data_frame(&compact_data_frame.header));
+            }
+            else
+            {
+                PSMoveProtocol::DeviceOutputDataFrame *data_frame= create_data_frame();
+                callback(controller_view, &streamInfo, data_frame);
+
+                packed_data_frame= add_published_data_frame(
+                    data_frame_signature, network_manager->pack_device_data_frame(*data_frame));
+            }
+        }
+
+        return packed_data_frame;
+    }
+
+    PackedDeviceOutputDataFramePtr get_hmd_data_frame_for_stream(
+        class ServerHMDView *hmd_view,
+        const HMDStreamInfo &streamInfo,
+        ServerRequestHandler::t_generate_hmd_data_frame_for_stream callback,
+        ServerRequestHandler::t_generate_compact_hmd_data_frame_for_stream compact_callback)
+    {
+        const int data_frame_signature= streamInfo.GetDataFrameSignature();
+        PackedDeviceOutputDataFramePtr packed_data_frame;
+
+        if (!find_published_data_frame(data_frame_signature, packed_data_frame))
+        {
+            ServerNetworkManager *network_manager= ServerNetworkManager::get_instance();
+
+            if (streamInfo.use_compact_data_frames)
+            {
+                CompactHMDDataFrame compact_data_frame;
+                memset(&compact_data_frame, 0, sizeof(compact_data_frame));
+                compact_callback(hmd_view, &streamInfo, &compact_data_frame);
+
+                packed_data_frame= add_published_data_frame(
+                    data_frame_signature, network_manager->pack_compact_data_frame(&compact_data_frame.header));
+            }
+            else
+            {
+                PSMoveProtocol::DeviceOutputDataFrame *data_frame= create_data_frame();
+                callback(hmd_view, &streamInfo, data_frame);
+
+                packed_data_frame= add_published_data_frame(
+                    data_frame_signature, network_manager->pack_device_data_frame(*data_frame));
+            }
+        }
+
+        return packed_data_frame;
+    }
+
+    // Connections whose streams have the same data frame signature get sent the same packed data frame,
+    // so each distinct data frame is only generated and packed once per publish
+    bool find_published_data_frame(const int data_frame_signature, PackedDeviceOutputDataFramePtr &out_packed_data_frame) const
+    {
+        for (const PublishedDataFrame &published_data_frame : m_published_data_frames)
+        {
+            if (published_data_frame.data_frame_signature == data_frame_signature)
+            {
+                out_packed_data_frame= published_data_frame.packed_data_frame;
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    // Data frames only live until they are packed, so they are built on an arena that's reset after every publish
+    PSMoveProtocol::DeviceOutputDataFrame *create_data_frame()
+    {
+        return google::protobuf::Arena::CreateMessage<PSMoveProtocol::DeviceOutputDataFrame>(&m_data_frame_arena);
+    }
+
+    PackedDeviceOutputDataFramePtr add_published_data_frame(
+        const int data_frame_signature,
+        PackedDeviceOutputDataFramePtr packed_data_frame)
+    {
+        PublishedDataFrame published_data_frame;
+        published_data_frame.data_frame_signature= data_frame_signature;
+        // Empty if the data frame couldn't be packed, which stops it from being rebuilt for every connection
+        published_data_frame.packed_data_frame= packed_data_frame;
+
+        m_published_data_frames.push_back(published_data_frame);
+
+        return published_data_frame.packed_data_frame;
+    }
+
+    void release_published_data_frames()
+    {
+        // Hands the packed data frames that have been sent back to the network manager's pool
+        m_published_data_frames.clear();
+
+        // Keeps the initial block for the next publish, so building data frames doesn't allocate
+        m_data_frame_arena.Reset();
+    }
+
+    static google::protobuf::ArenaOptions make_data_frame_arena_options(std::vector<char> &initial_block)
+    {
+        google::protobuf::ArenaOptions options;
+        options.initial_block= initial_block.data();
+        options.initial_block_size= initial_block.size();
+
+        return options;
+    }
+
     RequestConnectionStatePtr FindOrCreateConnectionState(int connection_id)
     {
         t_connection_state_iter iter= m_connection_state_map.find(connection_id);
@@ -801,6 +1181,12 @@ protected:
                 // All we have to do is keep track of which connections care about the updates.
                 context.connection_state->active_controller_streams.set(controller_id, true);
 
+                // Restarting a stream drops its previous shared pose table subscription
+                if (streamInfo.use_shared_pose_table)
+                {
+                    --m_shared_pose_table_controller_subscribers[controller_id];
+                }
+
                 // Set control flags for the stream
                 streamInfo.Clear();
                 streamInfo.include_position_data = request.include_position_data();
@@ -809,6 +1195,26 @@ protected:
                 streamInfo.include_calibrated_sensor_data = request.include_calibrated_sensor_data();
                 streamInfo.include_raw_tracker_data = request.include_raw_tracker_data();
                 streamInfo.disable_roi = request.disable_roi();
+                streamInfo.use_compact_data_frames = request.use_compact_data_frames();
+                streamInfo.use_shared_pose_table = can_use_shared_pose_table(context, request.use_shared_pose_table());
+
+                if (streamInfo.use_shared_pose_table)
+                {
+                    ++m_shared_pose_table_controller_subscribers[controller_id];
+                }
+
+                // Compact data frames have no room for the raw sensor or tracker data
+                if (streamInfo.use_compact_data_frames &&
+                    (streamInfo.include_raw_sensor_data || 
+                     streamInfo.include_calibrated_sensor_data || 
+                     streamInfo.include_raw_tracker_data))
+                {
+                    SERVER_LOG_WARNING("ServerRequestHandler") << "Controller(" << controller_id << ") stream "
+                        << "can't include raw data in compact data frames, dropping the raw data flags";
+                    streamInfo.include_raw_sensor_data = false;
+                    streamInfo.include_calibrated_sensor_data = false;
+                    streamInfo.include_raw_tracker_data = false;
+                }
 
                 SERVER_LOG_INFO("ServerRequestHandler") << "Start controller(" << controller_id << ") stream ("
                     << "pos=" << streamInfo.include_position_data
@@ -817,6 +1223,8 @@ protected:
                     << ",cal_sens=" << streamInfo.include_calibrated_sensor_data
                     << ",trkr=" << streamInfo.include_raw_tracker_data
                     << ",roi=" << streamInfo.disable_roi
+                    << ",compact=" << streamInfo.use_compact_data_frames
+                    << ",shm=" << streamInfo.use_shared_pose_table
                     << ")";
 
                 if (streamInfo.include_position_data)
@@ -830,6 +1238,7 @@ protected:
                     PSMoveProtocol::DeviceOutputDataFrame* data_frame= stream_started_response->mutable_initial_data_frame();
                     
                     ServerControllerView::generate_controller_data_frame_for_stream(controller_view.get(), &streamInfo, data_frame);
+                    stream_started_response->set_use_shared_pose_table(streamInfo.use_shared_pose_table);
                 }
 
                 if (streamInfo.disable_roi)
@@ -884,6 +1293,11 @@ protected:
 
                 SERVER_LOG_INFO("ServerRequestHandler") << "Stop controller(" << controller_id << ") stream";
 
+                if (streamInfo.use_shared_pose_table)
+                {
+                    --m_shared_pose_table_controller_subscribers[controller_id];
+                }
+
                 context.connection_state->active_controller_streams.set(controller_id, false);
                 context.connection_state->active_controller_stream_info[controller_id].Clear();
 
@@ -2711,6 +3125,8 @@ protected:
             context.request->request_start_hmd_data_stream();
         int hmd_id = request.hmd_id();
 
+        response->set_type(PSMoveProtocol::Response_ResponseType_HMD_STREAM_STARTED);
+
         if (ServerUtility::is_index_valid(hmd_id, m_device_manager.getHMDViewMaxCount()))
         {
             ServerHMDViewPtr hmd_view = m_device_manager.getHMDViewPtr(hmd_id);
@@ -2724,6 +3140,12 @@ protected:
                 // All we have to do is keep track of which connections care about the updates.
                 context.connection_state->active_hmd_streams.set(hmd_id, true);
 
+                // Restarting a stream drops its previous shared pose table subscription
+                if (streamInfo.use_shared_pose_table)
+                {
+                    --m_shared_pose_table_hmd_subscribers[hmd_id];
+                }
+
                 // Set control flags for the stream
                 streamInfo.Clear();
                 streamInfo.include_position_data = request.include_position_data();
@@ -2732,6 +3154,28 @@ protected:
                 streamInfo.include_calibrated_sensor_data = request.include_calibrated_sensor_data();
                 streamInfo.include_raw_tracker_data = request.include_raw_tracker_data();
                 streamInfo.disable_roi = request.disable_roi();
+                streamInfo.use_compact_data_frames = request.use_compact_data_frames();
+                streamInfo.use_shared_pose_table = can_use_shared_pose_table(context, request.use_shared_pose_table());
+
+                if (streamInfo.use_shared_pose_table)
+                {
+                    ++m_shared_pose_table_hmd_subscribers[hmd_id];
+                }
+
+                // Compact data frames have no room for the raw sensor or tracker data
+                if (streamInfo.use_compact_data_frames &&
+                    (streamInfo.include_raw_sensor_data || 
+                     streamInfo.include_calibrated_sensor_data || 
+                     streamInfo.include_raw_tracker_data))
+                {
+                    SERVER_LOG_WARNING("ServerRequestHandler") << "HMD(" << hmd_id << ") stream "
+                        << "can't include raw data in compact data frames, dropping the raw data flags";
+                    streamInfo.include_raw_sensor_data = false;
+                    streamInfo.include_calibrated_sensor_data = false;
+                    streamInfo.include_raw_tracker_data = false;
+                }
+
+                response->mutable_result_hmd_stream_started()->set_use_shared_pose_table(streamInfo.use_shared_pose_table);
 
                 SERVER_LOG_INFO("ServerRequestHandler") << "Start hmd(" << hmd_id << ") stream ("
                     << "pos=" << streamInfo.include_position_data
@@ -2740,6 +3184,8 @@ protected:
                     << ",cal_sens=" << streamInfo.include_calibrated_sensor_data
                     << ",trkr=" << streamInfo.include_raw_tracker_data
                     << ",roi=" << streamInfo.disable_roi
+                    << ",compact=" << streamInfo.use_compact_data_frames
+                    << ",shm=" << streamInfo.use_shared_pose_table
                     << ")";
 
                 if (streamInfo.disable_roi)
@@ -2795,6 +3241,11 @@ protected:
                     hmd_view->stopTracking();
                 }
 
+                if (streamInfo.use_shared_pose_table)
+                {
+                    --m_shared_pose_table_hmd_subscribers[hmd_id];
+                }
+
                 context.connection_state->active_hmd_streams.set(hmd_id, false);
                 context.connection_state->active_hmd_stream_info[hmd_id].Clear();
 
@@ -3225,8 +3676,24 @@ protected:
     }
 
 private:
+    struct PublishedDataFrame
+    {
+        int data_frame_signature;
+        PackedDeviceOutputDataFramePtr packed_data_frame;
+    };
+
     DeviceManager &m_device_manager;
     t_connection_state_map m_connection_state_map;
+    std::vector<PublishedDataFrame> m_published_data_frames; // data frames packed by the current publish call
+    std::vector<char> m_data_frame_arena_block;
+    google::protobuf::Arena m_data_frame_arena;
+    SharedDevicePoseTableReadWriteAccessor m_shared_pose_table;
+    ControllerStreamInfo m_shared_pose_table_controller_stream_info;
+    HMDStreamInfo m_shared_pose_table_hmd_stream_info;
+    // Number of streams reading each device out of the shared pose table,
+    // a device only gets written into the table while it has any
+    int m_shared_pose_table_controller_subscribers[ControllerManager::k_max_devices];
+    int m_shared_pose_table_hmd_subscribers[HMDManager::k_max_devices];
 };
 
 //-- public interface -----
@@ -3256,6 +3723,7 @@ bool ServerRequestHandler::any_active_bluetooth_requests() const
 bool ServerRequestHandler::startup()
 {
     m_instance= this;
+    m_implementation_ptr->startup();
     return true;
 }
 
@@ -3266,6 +3734,7 @@ void ServerRequestHandler::update()
 
 void ServerRequestHandler::shutdown()
 {
+    m_implementation_ptr->shutdown();
     m_instance= NULL;
 }
 
@@ -3286,9 +3755,10 @@ void ServerRequestHandler::handle_client_connection_stopped(int connection_id)
 
 void ServerRequestHandler::publish_controller_data_frame(
     ServerControllerView *controller_view, 
-    t_generate_controller_data_frame_for_stream callback)
+    t_generate_controller_data_frame_for_stream callback,
+    t_generate_compact_controller_data_frame_for_stream compact_callback)
 {
-    return m_implementation_ptr->publish_controller_data_frame(controller_view, callback);
+    return m_implementation_ptr->publish_controller_data_frame(controller_view, callback, compact_callback);
 }
 
 void ServerRequestHandler::publish_tracker_data_frame(
@@ -3300,7 +3770,8 @@ void ServerRequestHandler::publish_tracker_data_frame(
 
 void ServerRequestHandler::publish_hmd_data_frame(
     class ServerHMDView *hmd_view,
-    t_generate_hmd_data_frame_for_stream callback)
+    t_generate_hmd_data_frame_for_stream callback,
+    t_generate_compact_hmd_data_frame_for_stream compact_callback)
 {
-    return m_implementation_ptr->publish_hmd_data_frame(hmd_view, callback);
+    return m_implementation_ptr->publish_hmd_data_frame(hmd_view, callback, compact_callback);
 }
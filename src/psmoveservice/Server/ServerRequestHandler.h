@@ -21,6 +21,8 @@ struct ControllerStreamInfo
     bool include_raw_tracker_data;
     bool led_override_active;
 	bool disable_roi;
+    bool use_compact_data_frames;
+    bool use_shared_pose_table;
     int last_data_input_sequence_number;
     int selected_tracker_index;
 
@@ -33,9 +35,26 @@ struct ControllerStreamInfo
         include_raw_tracker_data = false;
         led_override_active = false;
 		disable_roi = false;
+        use_compact_data_frames = false;
+        use_shared_pose_table = false;
 		last_data_input_sequence_number = -1;
         selected_tracker_index = 0;
     }
+
+    /// Streams with the same signature get identical controller data frames.
+    /// Shared pose table streams don't get data frames, so use_shared_pose_table isn't part of it.
+    /// Compact data frames never carry raw tracker data, so the selected tracker doesn't matter for them.
+    inline int GetDataFrameSignature() const
+    {
+        return
+            (include_position_data ? 0x01 : 0) |
+            (include_physics_data ? 0x02 : 0) |
+            (include_raw_sensor_data ? 0x04 : 0) |
+            (include_calibrated_sensor_data ? 0x08 : 0) |
+            (include_raw_tracker_data ? 0x10 : 0) |
+            (use_compact_data_frames ? 0x20 : 0) |
+            (use_compact_data_frames ? 0 : (selected_tracker_index << 6));
+    }
 };
 
 struct TrackerStreamInfo
@@ -48,6 +67,13 @@ struct TrackerStreamInfo
         streaming_video_data = false;
 		has_temp_settings_override = false;
     }
+
+    /// Streams with the same signature get identical tracker data frames
+    inline int GetDataFrameSignature() const
+    {
+        // The tracker data frame doesn't depend on any of the stream settings
+        return 0;
+    }
 };
 
 struct HMDStreamInfo
@@ -58,6 +84,8 @@ struct HMDStreamInfo
 	bool include_calibrated_sensor_data;
 	bool include_raw_tracker_data;
 	bool disable_roi;
+    bool use_compact_data_frames;
+    bool use_shared_pose_table;
     int selected_tracker_index;
 
     inline void Clear()
@@ -68,8 +96,25 @@ struct HMDStreamInfo
 		include_calibrated_sensor_data = false;
 		include_raw_tracker_data = false;
 		disable_roi = false;
+        use_compact_data_frames = false;
+        use_shared_pose_table = false;
         selected_tracker_index = 0;
     }
+
+    /// Streams with the same signature get identical HMD data frames.
+    /// Shared pose table streams don't get data frames, so use_shared_pose_table isn't part of it.
+    /// Compact data frames never carry raw tracker data, so the selected tracker doesn't matter for them.
+    inline int GetDataFrameSignature() const
+    {
+        return
+            (include_position_data ? 0x01 : 0) |
+            (include_physics_data ? 0x02 : 0) |
+            (include_raw_sensor_data ? 0x04 : 0) |
+            (include_calibrated_sensor_data ? 0x08 : 0) |
+            (include_raw_tracker_data ? 0x10 : 0) |
+            (use_compact_data_frames ? 0x20 : 0) |
+            (use_compact_data_frames ? 0 : (selected_tracker_index << 6));
+    }
 };
 
 class ServerRequestHandler 
@@ -94,23 +139,32 @@ public:
     /// we need to provide a callback that will fill out a data frame given:
     /// * A \ref ServerControllerView we want to publish to all listening connections
     /// * A \ref ControllerStreamInfo that describes what info the connection wants
-    /// This callback will be called for each listening connection
+    /// This callback will be called once for each distinct kind of stream (see ControllerStreamInfo::GetDataFrameSignature())
     typedef void (*t_generate_controller_data_frame_for_stream)(
             const class ServerControllerView *controller_view,
             const ControllerStreamInfo *stream_info,
             PSMoveProtocol::DeviceOutputDataFrame *data_frame);
+
+    /// Same as above, but fills out a compact data frame (see CompactDataFrame.h)
+    /// for the streams that asked for use_compact_data_frames
+    typedef void (*t_generate_compact_controller_data_frame_for_stream)(
+            const class ServerControllerView *controller_view,
+            const ControllerStreamInfo *stream_info,
+            struct CompactControllerDataFrame *data_frame);
     void publish_controller_data_frame(
-        class ServerControllerView *controller_view, t_generate_controller_data_frame_for_stream callback);
+        class ServerControllerView *controller_view, 
+        t_generate_controller_data_frame_for_stream callback,
+        t_generate_compact_controller_data_frame_for_stream compact_callback);
 
     /// When publishing tracker data to all listening connections
     /// we need to provide a callback that will fill out a data frame given:
     /// * A \ref ServerTrackerView we want to publish to all listening connections
     /// * A \ref TrackerStreamInfo that describes what info the connection wants
-    /// This callback will be called for each listening connection
+    /// This callback will be called once for each distinct kind of stream (see TrackerStreamInfo::GetDataFrameSignature())
     typedef void(*t_generate_tracker_data_frame_for_stream)(
         const class ServerTrackerView *tracker_view,
         const TrackerStreamInfo *stream_info,
-        DeviceOutputDataFramePtr &data_frame);
+        PSMoveProtocol::DeviceOutputDataFrame *data_frame);
     void publish_tracker_data_frame(
         class ServerTrackerView *tracker_view, t_generate_tracker_data_frame_for_stream callback);
         
@@ -118,13 +172,22 @@ public:
     /// we need to provide a callback that will fill out a data frame given:
     /// * A \ref ServerHMDView we want to publish to all listening connections
     /// * A \ref HMDStreamInfo that describes what info the connection wants
-    /// This callback will be called for each listening connection
+    /// This callback will be called once for each distinct kind of stream (see HMDStreamInfo::GetDataFrameSignature())
     typedef void(*t_generate_hmd_data_frame_for_stream)(
         const class ServerHMDView *hmd_view,
         const HMDStreamInfo *stream_info,
-        DeviceOutputDataFramePtr &data_frame);
+        PSMoveProtocol::DeviceOutputDataFrame *data_frame);
+
+    /// Same as above, but fills out a compact data frame (see CompactDataFrame.h)
+    /// for the streams that asked for use_compact_data_frames
+    typedef void(*t_generate_compact_hmd_data_frame_for_stream)(
+        const class ServerHMDView *hmd_view,
+        const HMDStreamInfo *stream_info,
+        struct CompactHMDDataFrame *data_frame);
     void publish_hmd_data_frame(
-        class ServerHMDView *hmd_view, t_generate_hmd_data_frame_for_stream callback);        
+        class ServerHMDView *hmd_view, 
+        t_generate_hmd_data_frame_for_stream callback,
+        t_generate_compact_hmd_data_frame_for_stream compact_callback);        
 
 private:
     // private implementation - same lifetime as the ServerRequestHandler
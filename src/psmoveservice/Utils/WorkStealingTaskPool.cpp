@@ -0,0 +1,225 @@
+#include "WorkStealingTaskPool.h"
+#include "WorkerThread.h"
+#include "ServerLog.h"
+
+#include <sstream>
+
+//-- private definitions -----
+class TaskPoolWorker final : public WorkerThread
+{
+public:
+    TaskPoolWorker(const std::string &thread_name, WorkStealingTaskPool *pool, const int range_index)
+        : WorkerThread(thread_name)
+        , m_pool(pool)
+        , m_range_index(range_index)
+        , m_job_generation(0)
+    {
+    }
+
+protected:
+    void onThreadHaltBegin() override
+    {
+        // Wake the worker up so that it notices the exit flag
+        m_pool->wakeWorkers();
+    }
+
+    bool doWork() override
+    {
+        if (!m_pool->waitForJob(m_job_generation, m_exitSignaled))
+        {
+            return false;
+        }
+
+        m_pool->runTasks(m_range_index);
+        m_pool->notifyWorkerFinished();
+
+        return true;
+    }
+
+private:
+    WorkStealingTaskPool *m_pool;
+    const int m_range_index;
+    int m_job_generation; // last job this worker ran
+};
+
+//-- public methods -----
+WorkStealingTaskPool::WorkStealingTaskPool(const std::string &pool_name, const int worker_count)
+    : m_pool_name(pool_name)
+    , m_workers()
+    , m_bIsStarted(false)
+    , m_job(nullptr)
+    , m_job_generation(0)
+    , m_task_ranges(nullptr)
+{
+    m_busy_worker_count= 0;
+
+    // Range 0 belongs to the thread calling runJob()
+    m_task_ranges= new TaskRange[worker_count + 1];
+    for (int range_index = 0; range_index <= worker_count; ++range_index)
+    {
+        m_task_ranges[range_index].next_task_index= 0;
+        m_task_ranges[range_index].end_task_index= 0;
+    }
+
+    for (int worker_index = 0; worker_index < worker_count; ++worker_index)
+    {
+        std::stringstream thread_name;
+        thread_name << pool_name << " " << worker_index;
+
+        m_workers.push_back(new TaskPoolWorker(thread_name.str(), this, worker_index + 1));
+    }
+}
+
+WorkStealingTaskPool::~WorkStealingTaskPool()
+{
+    shutdown();
+
+    for (TaskPoolWorker *worker : m_workers)
+    {
+        delete worker;
+    }
+    m_workers.clear();
+
+    delete[] m_task_ranges;
+}
+
+void WorkStealingTaskPool::startup()
+{
+    if (!m_bIsStarted)
+    {
+        SERVER_LOG_INFO("WorkStealingTaskPool::startup") <<
+            "Starting " << m_pool_name << " pool with " << m_workers.size() << " worker threads";
+
+        for (TaskPoolWorker *worker : m_workers)
+        {
+            worker->startThread();
+        }
+
+        m_bIsStarted= true;
+    }
+}
+
+void WorkStealingTaskPool::shutdown()
+{
+    if (m_bIsStarted)
+    {
+        for (TaskPoolWorker *worker : m_workers)
+        {
+            worker->stopThread();
+        }
+
+        m_bIsStarted= false;
+    }
+}
+
+void WorkStealingTaskPool::runJob(ITaskPoolJob *job, const int task_count)
+{
+    if (!m_bIsStarted || m_workers.empty() || task_count <= 1)
+    {
+        for (int task_index = 0; task_index < task_count; ++task_index)
+        {
+            job->runTask(task_index);
+        }
+
+        return;
+    }
+
+    // Fork: split the tasks evenly over the worker threads and the calling thread
+    {
+        std::lock_guard<std::mutex> lock(m_job_mutex);
+
+        const int range_count= getWorkerCount() + 1;
+        for (int range_index = 0; range_index < range_count; ++range_index)
+        {
+            m_task_ranges[range_index].next_task_index= (task_count * range_index) / range_count;
+            m_task_ranges[range_index].end_task_index= (task_count * (range_index + 1)) / range_count;
+        }
+
+        m_job= job;
+        m_busy_worker_count= getWorkerCount();
+        ++m_job_generation;
+    }
+    m_job_posted_condition.notify_all();
+
+    runTasks(0);
+
+    // Join: every worker has to be done with the job before the next one can be posted
+    {
+        std::unique_lock<std::mutex> lock(m_job_mutex);
+
+        m_job_finished_condition.wait(lock, [this]{ return m_busy_worker_count.load() == 0; });
+        m_job= nullptr;
+    }
+}
+
+//-- private methods -----
+bool WorkStealingTaskPool::waitForJob(int &inout_job_generation, const std::atomic_bool &exit_signaled)
+{
+    std::unique_lock<std::mutex> lock(m_job_mutex);
+
+    m_job_posted_condition.wait(lock, [this, &inout_job_generation, &exit_signaled]{
+        return exit_signaled.load() || m_job_generation != inout_job_generation;
+    });
+
+    if (exit_signaled.load())
+    {
+        return false;
+    }
+
+    inout_job_generation= m_job_generation;
+
+    return true;
+}
+
+void WorkStealingTaskPool::wakeWorkers()
+{
+    // Taking the lock makes sure a worker can't miss the wake up between testing and waiting
+    {
+        std::lock_guard<std::mutex> lock(m_job_mutex);
+    }
+    m_job_posted_condition.notify_all();
+}
+
+void WorkStealingTaskPool::runTasks(const int range_index)
+{
+    const int range_count= getWorkerCount() + 1;
+
+    // Work through our own range first, then steal from the other ranges
+    for (int range_offset = 0; range_offset < range_count; ++range_offset)
+    {
+        const int victim_range_index= (range_index + range_offset) % range_count;
+
+        int task_index;
+        while (claimTask(victim_range_index, task_index))
+        {
+            m_job->runTask(task_index);
+        }
+    }
+}
+
+bool WorkStealingTaskPool::claimTask(const int range_index, int &out_task_index)
+{
+    TaskRange &range= m_task_ranges[range_index];
+
+    // Cheap test first so that threads done with a range don't keep bumping its counter
+    if (range.next_task_index.load() >= range.end_task_index)
+    {
+        return false;
+    }
+
+    out_task_index= range.next_task_index.fetch_add(1);
+
+    return out_task_index < range.end_task_index;
+}
+
+void WorkStealingTaskPool::notifyWorkerFinished()
+{
+    if (m_busy_worker_count.fetch_sub(1) == 1)
+    {
+        // Last worker out wakes up the thread waiting in runJob()
+        {
+            std::lock_guard<std::mutex> lock(m_job_mutex);
+        }
+        m_job_finished_condition.notify_one();
+    }
+}
@@ -0,0 +1,72 @@
+#ifndef WORK_STEALING_TASK_POOL_H
+#define WORK_STEALING_TASK_POOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <vector>
+
+/// A batch of independent tasks handed to a WorkStealingTaskPool
+class ITaskPoolJob
+{
+public:
+    virtual ~ITaskPoolJob() {}
+
+    /// Called exactly once for every task index of the job, possibly on a worker thread
+    virtual void runTask(const int task_index) = 0;
+};
+
+/// Persistent pool of worker threads that run the tasks of one job at a time (fork/join).
+/// The tasks of a job are split into one contiguous range per thread (the calling thread included).
+/// A thread that finishes its own range steals the remaining tasks of the other ranges,
+/// so one slow task doesn't hold up the tasks queued behind it.
+class WorkStealingTaskPool
+{
+public:
+    WorkStealingTaskPool(const std::string &pool_name, const int worker_count);
+    virtual ~WorkStealingTaskPool();
+
+    void startup();
+    void shutdown();
+
+    inline int getWorkerCount() const { return static_cast<int>(m_workers.size()); }
+
+    /// Run every task of the job and return once all of them have finished.
+    /// Tasks run on the calling thread alone if the pool isn't started or there is only one task.
+    void runJob(ITaskPoolJob *job, const int task_count);
+
+private:
+    friend class TaskPoolWorker;
+
+    struct TaskRange
+    {
+        std::atomic_int next_task_index;
+        int end_task_index;
+        char padding[56]; // keep the ranges on separate cache lines
+    };
+
+    /// Blocks the worker until a job newer than the given one is posted.
+    /// Returns false if the pool is shutting down instead.
+    bool waitForJob(int &inout_job_generation, const std::atomic_bool &exit_signaled);
+    void wakeWorkers();
+
+    void runTasks(const int range_index);
+    bool claimTask(const int range_index, int &out_task_index);
+    void notifyWorkerFinished();
+
+    const std::string m_pool_name;
+    std::vector<class TaskPoolWorker *> m_workers;
+    bool m_bIsStarted;
+
+    // Current job, written by the calling thread while holding m_job_mutex
+    std::mutex m_job_mutex;
+    std::condition_variable m_job_posted_condition;
+    std::condition_variable m_job_finished_condition;
+    ITaskPoolJob *m_job;
+    int m_job_generation;
+    TaskRange *m_task_ranges; // one per worker + one for the calling thread
+    std::atomic_int m_busy_worker_count;
+};
+
+#endif // WORK_STEALING_TASK_POOL_H
@@ -2,6 +2,8 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <assert.h>
+#include <chrono>
+#include <vector>
 
 #include "MathAlignment.h"
 #include "MathUtility.h"
@@ -12,10 +14,71 @@ bool run_math_alignment_unit_tests()
 {
 	UNIT_TEST_MODULE_BEGIN("math_alignment")
 		UNIT_TEST_MODULE_CALL_TEST(math_alignment_test_best_fit_exponential);
+		UNIT_TEST_MODULE_CALL_TEST(math_alignment_test_fit_sphere_bounded);
+		UNIT_TEST_MODULE_CALL_TEST(math_alignment_test_fit_sphere_bounded_matches_unbounded);
+		UNIT_TEST_MODULE_CALL_TEST(math_alignment_test_triangulate_point);
 	UNIT_TEST_MODULE_END()
 }
 
 //-- private functions -----
+// Pinhole camera at the given position looking at the origin
+static Eigen::Matrix<float, 3, 4>
+make_look_at_origin_camera(const Eigen::Vector3f &camera_position)
+{
+	const Eigen::Vector3f forward = -camera_position.normalized();
+	const Eigen::Vector3f right = forward.cross(Eigen::Vector3f::UnitY()).normalized();
+	const Eigen::Vector3f down = forward.cross(right);
+
+	Eigen::Matrix3f R;
+	R.row(0) = right;
+	R.row(1) = down;
+	R.row(2) = forward;
+
+	Eigen::Matrix3f K;
+	K << 550.f, 0.f, 320.f,
+		0.f, 550.f, 240.f,
+		0.f, 0.f, 1.f;
+
+	Eigen::Matrix<float, 3, 4> extrinsic;
+	extrinsic.leftCols<3>() = R;
+	extrinsic.col(3) = -R*camera_position;
+
+	return K*extrinsic;
+}
+
+static Eigen::Vector2f
+project_point(const Eigen::Matrix<float, 3, 4> &P, const Eigen::Vector3f &point)
+{
+	const Eigen::Vector3f p = P*Eigen::Vector4f(point.x(), point.y(), point.z(), 1.f);
+
+	return p.head<2>() / p.z();
+}
+
+// Outline of a sphere projected onto the z=focal_length plane
+static void
+make_projected_sphere_contour(
+	const Eigen::Vector3f &sphere_center,
+	const float sphere_radius,
+	const float focal_length,
+	const int point_count,
+	std::vector<Eigen::Vector2f> &out_points)
+{
+	const Eigen::Vector3f axis = sphere_center.normalized();
+	const Eigen::Vector3f u = axis.cross(Eigen::Vector3f::UnitY()).normalized();
+	const Eigen::Vector3f v = axis.cross(u);
+	const float sin_alpha = sphere_radius / sphere_center.norm();
+	const float cos_alpha = sqrtf(1.f - sin_alpha*sin_alpha);
+
+	out_points.resize(point_count);
+	for (int i = 0; i < point_count; ++i)
+	{
+		const float theta = k_real_two_pi*static_cast<float>(i) / static_cast<float>(point_count);
+		const Eigen::Vector3f ray = cos_alpha*axis + sin_alpha*(cosf(theta)*u + sinf(theta)*v);
+
+		out_points[i] = Eigen::Vector2f(ray.x(), ray.y())*(focal_length / ray.z());
+	}
+}
+
 bool
 math_alignment_test_best_fit_exponential()
 {
@@ -45,5 +108,153 @@ math_alignment_test_best_fit_exponential()
 	success = is_nearly_equal(curve.y(), 0.4488802f, k_normal_epsilon);
 	assert(success);	
 	
+	UNIT_TEST_COMPLETE()
+}
+
+bool
+math_alignment_test_fit_sphere_bounded()
+{
+	UNIT_TEST_BEGIN("fit_sphere_bounded")
+
+	const float k_sphere_radius = 2.25f;
+	std::vector<Eigen::Vector2f> contour;
+
+	// Small contour: fits every point, same as the unbounded fit
+	{
+		const Eigen::Vector3f true_center(10.f, -5.f, 150.f);
+		make_projected_sphere_contour(true_center, k_sphere_radius, 1.f, 40, contour);
+
+		Eigen::Vector3f center, bounded_center;
+		EigenFitEllipse ellipse, bounded_ellipse;
+		eigen_alignment_fit_focal_cone_to_sphere(
+			contour.data(), static_cast<int>(contour.size()), k_sphere_radius, 1.f, &center, &ellipse);
+		eigen_alignment_fit_focal_cone_to_sphere_bounded(
+			contour.data(), static_cast<int>(contour.size()), k_sphere_radius, 1.f, &bounded_center, &bounded_ellipse);
+
+		success &= (bounded_center - center).norm() < 0.01f;
+		assert(success);
+		success &= (bounded_center - true_center).norm() < 0.1f;
+		assert(success);
+		success &= is_nearly_equal(bounded_ellipse.area, ellipse.area, k_normal_epsilon);
+		assert(success);
+	}
+
+	// Large blob close to the camera: subsampled down to the point budget
+	{
+		const Eigen::Vector3f true_center(3.f, 2.f, 12.f);
+		make_projected_sphere_contour(true_center, k_sphere_radius, 1.f, 400, contour);
+
+		Eigen::Vector3f center, bounded_center;
+		EigenFitEllipse ellipse, bounded_ellipse;
+		eigen_alignment_fit_focal_cone_to_sphere(
+			contour.data(), static_cast<int>(contour.size()), k_sphere_radius, 1.f, &center, &ellipse);
+		eigen_alignment_fit_focal_cone_to_sphere_bounded(
+			contour.data(), static_cast<int>(contour.size()), k_sphere_radius, 1.f, &bounded_center, &bounded_ellipse);
+
+		success &= (bounded_center - center).norm() < 0.01f;
+		assert(success);
+		success &= (bounded_center - true_center).norm() < 0.01f;
+		assert(success);
+		success &= bounded_ellipse.area > k_real_epsilon;
+		assert(success);
+	}
+
+	UNIT_TEST_COMPLETE()
+}
+
+bool
+math_alignment_test_triangulate_point()
+{
+	UNIT_TEST_BEGIN("triangulate_point")
+
+	const int k_camera_count = 4;
+	const Eigen::Matrix<float, 3, 4> cameras[k_camera_count] = {
+		make_look_at_origin_camera(Eigen::Vector3f(200.f, 20.f, 0.f)),
+		make_look_at_origin_camera(Eigen::Vector3f(0.f, 30.f, 200.f)),
+		make_look_at_origin_camera(Eigen::Vector3f(-150.f, 10.f, 150.f)),
+		make_look_at_origin_camera(Eigen::Vector3f(150.f, 40.f, 150.f))
+	};
+	const Eigen::Vector3f true_point(10.f, -5.f, 20.f);
+
+	Eigen::Vector2f image_points[k_camera_count];
+	for (int i = 0; i < k_camera_count; ++i)
+	{
+		image_points[i] = project_point(cameras[i], true_point);
+	}
+
+	// Two cameras
+	Eigen::Vector3f point;
+	bool inliers[k_camera_count];
+	int inlier_count = eigen_alignment_triangulate_point(cameras, image_points, 2, 10.f, &point);
+	success &= inlier_count == 2 && (point - true_point).norm() < 0.01f;
+	assert(success);
+
+	// All cameras agree
+	inlier_count = eigen_alignment_triangulate_point(cameras, image_points, k_camera_count, 10.f, &point, inliers);
+	success &= inlier_count == k_camera_count && (point - true_point).norm() < 0.01f;
+	assert(success);
+
+	// One camera is way off and gets rejected
+	image_points[2] += Eigen::Vector2f(60.f, -40.f);
+	inlier_count = eigen_alignment_triangulate_point(cameras, image_points, k_camera_count, 10.f, &point, inliers);
+	success &= inlier_count == k_camera_count - 1 && !inliers[2] && inliers[0] && inliers[1] && inliers[3];
+	assert(success);
+	success &= (point - true_point).norm() < 0.01f;
+	assert(success);
+
+	// Not enough cameras
+	inlier_count = eigen_alignment_triangulate_point(cameras, image_points, 1, 10.f, &point);
+	success &= inlier_count == 0;
+	assert(success);
+
+	UNIT_TEST_COMPLETE()
+}
+
+bool
+math_alignment_test_fit_sphere_bounded_matches_unbounded()
+{
+	UNIT_TEST_BEGIN("fit_sphere_bounded_matches_unbounded")
+
+	const int k_iteration_count = 2000;
+	const float k_sphere_radius = 2.25f;
+	std::vector<Eigen::Vector2f> contour;
+	make_projected_sphere_contour(Eigen::Vector3f(3.f, 2.f, 12.f), k_sphere_radius, 1.f, 400, contour);
+
+	Eigen::Vector3f center, bounded_center;
+	EigenFitEllipse ellipse, bounded_ellipse;
+	float checksum = 0.f; // keeps the fits from being optimized away
+
+	auto start = std::chrono::high_resolution_clock::now();
+	for (int i = 0; i < k_iteration_count; ++i)
+	{
+		eigen_alignment_fit_focal_cone_to_sphere(
+			contour.data(), static_cast<int>(contour.size()), k_sphere_radius, 1.f, &center, &ellipse);
+		checksum += center.z();
+	}
+	auto unbounded_duration = std::chrono::high_resolution_clock::now() - start;
+
+	start = std::chrono::high_resolution_clock::now();
+	for (int i = 0; i < k_iteration_count; ++i)
+	{
+		eigen_alignment_fit_focal_cone_to_sphere_bounded(
+			contour.data(), static_cast<int>(contour.size()), k_sphere_radius, 1.f, &bounded_center, &bounded_ellipse);
+		checksum += bounded_center.z();
+	}
+	auto bounded_duration = std::chrono::high_resolution_clock::now() - start;
+
+	const double unbounded_ns =
+		static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(unbounded_duration).count()) / k_iteration_count;
+	const double bounded_ns =
+		static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(bounded_duration).count()) / k_iteration_count;
+	fprintf(stdout, "      %d point contour: %.0fns per fit, %.0fns per bounded fit (checksum %f)\n",
+		static_cast<int>(contour.size()), unbounded_ns, bounded_ns, checksum);
+
+	// The timings are only informational, they depend too much on the machine running the tests.
+	// The bounded fit has to land on the same sphere as the unbounded one though.
+	success &= (bounded_center - center).norm() < 0.01f;
+	assert(success);
+	success &= (bounded_ellipse.center - ellipse.center).norm() < 0.01f;
+	assert(success);
+
 	UNIT_TEST_COMPLETE()
 }
\ No newline at end of file
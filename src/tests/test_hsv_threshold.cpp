@@ -0,0 +1,127 @@
+// Micro-benchmark for the HSV threshold kernels used to build the tracking color lookup table.
+// Compares each kernel the CPU supports against the cv::inRange path the tracker used to take,
+// and checks that every kernel produces exactly the same mask as OpenCV.
+#include "HSVThresholdKernel.h"
+
+#include "opencv2/opencv.hpp"
+
+#include <chrono>
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+
+static const int k_frame_width= 640;
+static const int k_frame_height= 480;
+static const int k_iteration_count= 200;
+static const uint8_t k_mask_bit= 1 << 2;
+
+// Time the old approach: two cv::inRange calls for a wrapped hue range, then a bitwise_or to combine them
+static double benchmark_opencv(const cv::Mat &hsvFrame, const HSVThresholdBounds &bounds, cv::Mat &outMask)
+{
+	cv::Mat lowerMask(hsvFrame.rows, hsvFrame.cols, CV_8UC1);
+	cv::Mat upperMask(hsvFrame.rows, hsvFrame.cols, CV_8UC1);
+	const cv::Scalar lower_min(bounds.hue_min[0], bounds.saturation_min, bounds.value_min);
+	const cv::Scalar lower_max(bounds.hue_max[0], bounds.saturation_max, bounds.value_max);
+	const cv::Scalar upper_min(bounds.hue_min[1], bounds.saturation_min, bounds.value_min);
+	const cv::Scalar upper_max(bounds.hue_max[1], bounds.saturation_max, bounds.value_max);
+
+	const auto start_time= std::chrono::high_resolution_clock::now();
+	for (int iteration = 0; iteration < k_iteration_count; ++iteration)
+	{
+		cv::inRange(hsvFrame, lower_min, lower_max, lowerMask);
+		cv::inRange(hsvFrame, upper_min, upper_max, upperMask);
+		cv::bitwise_or(lowerMask, upperMask, outMask);
+	}
+	const auto end_time= std::chrono::high_resolution_clock::now();
+
+	return std::chrono::duration<double, std::micro>(end_time - start_time).count() / k_iteration_count;
+}
+
+static double benchmark_kernel(
+	t_hsv_threshold_kernel kernel,
+	const cv::Mat hsvPlanes[3],
+	const HSVThresholdBounds &bounds,
+	std::vector<uint8_t> &outMasks)
+{
+	const int pixel_count= hsvPlanes[0].rows * hsvPlanes[0].cols;
+
+	const auto start_time= std::chrono::high_resolution_clock::now();
+	for (int iteration = 0; iteration < k_iteration_count; ++iteration)
+	{
+		kernel(
+			hsvPlanes[0].ptr<uint8_t>(),
+			hsvPlanes[1].ptr<uint8_t>(),
+			hsvPlanes[2].ptr<uint8_t>(),
+			pixel_count,
+			bounds,
+			k_mask_bit,
+			outMasks.data());
+	}
+	const auto end_time= std::chrono::high_resolution_clock::now();
+
+	return std::chrono::duration<double, std::micro>(end_time - start_time).count() / k_iteration_count;
+}
+
+int main(int argc, char *argv[])
+{
+	// A random frame with hues in OpenCV's [0, 180] range
+	cv::Mat hsvFrame(k_frame_height, k_frame_width, CV_8UC3);
+	cv::randu(hsvFrame, cv::Scalar(0, 0, 0), cv::Scalar(181, 256, 256));
+
+	cv::Mat hsvPlanes[3];
+	cv::split(hsvFrame, hsvPlanes);
+
+	// A red tracking color, whose hue range wraps around 0
+	HSVThresholdBounds bounds;
+	bounds.hue_min[0]= 0;
+	bounds.hue_max[0]= 10;
+	bounds.hue_min[1]= 170;
+	bounds.hue_max[1]= 180;
+	bounds.saturation_min= 128;
+	bounds.saturation_max= 255;
+	bounds.value_min= 32;
+	bounds.value_max= 255;
+
+	cv::Mat opencvMask;
+	const double opencv_usec= benchmark_opencv(hsvFrame, bounds, opencvMask);
+	printf("%-8s %10.1f usec/frame\n", "opencv", opencv_usec);
+
+	bool bSuccess= true;
+	for (int kernel_index = 0; kernel_index < _hsv_threshold_kernel_count; ++kernel_index)
+	{
+		const eHSVThresholdKernel kernel_type= static_cast<eHSVThresholdKernel>(kernel_index);
+		const char *kernel_name= hsv_threshold_get_kernel_name(kernel_type);
+		t_hsv_threshold_kernel kernel= hsv_threshold_get_kernel(kernel_type);
+
+		if (kernel == nullptr)
+		{
+			printf("%-8s not supported\n", kernel_name);
+			continue;
+		}
+
+		// Fill the other bits of the mask with junk to make sure the kernel leaves them alone
+		std::vector<uint8_t> masks(k_frame_width*k_frame_height, static_cast<uint8_t>(~k_mask_bit));
+		const double kernel_usec= benchmark_kernel(kernel, hsvPlanes, bounds, masks);
+
+		int mismatch_count= 0;
+		for (int pixel_index = 0; pixel_index < k_frame_width*k_frame_height; ++pixel_index)
+		{
+			const bool bInOpenCVMask= opencvMask.data[pixel_index] != 0;
+			const uint8_t expected_mask= static_cast<uint8_t>(~k_mask_bit) | (bInOpenCVMask ? k_mask_bit : 0);
+
+			if (masks[pixel_index] != expected_mask)
+			{
+				++mismatch_count;
+			}
+		}
+
+		printf("%-8s %10.1f usec/frame (%.2fx) %s\n",
+			kernel_name, kernel_usec, opencv_usec / kernel_usec,
+			mismatch_count == 0 ? "matches opencv" : "MISMATCH");
+		bSuccess&= mismatch_count == 0;
+	}
+
+	printf("best kernel: %s\n", hsv_threshold_get_kernel_name(hsv_threshold_get_best_kernel()));
+
+	return bSuccess ? EXIT_SUCCESS : EXIT_FAILURE;
+}
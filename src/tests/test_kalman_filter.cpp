@@ -7,6 +7,8 @@
 #include <unistd.h>
 #endif
 
+#include <algorithm>
+#include <chrono>
 #include <stdio.h>
 #include <vector>
 
@@ -374,20 +376,40 @@ private:
 	FILE* m_fp;
 };
 
+// Filter output for each movement sample, used to compare the float and double filters
+struct FilterRunResult
+{
+	std::vector<Eigen::Quaternionf, Eigen::aligned_allocator<Eigen::Quaternionf>> orientations;
+	std::vector<Eigen::Vector3f> positions;
+	double total_update_seconds;
+
+	double getMeanUpdateMicroseconds() const
+	{
+		return (orientations.size() > 0) ? total_update_seconds * 1000000.0 / static_cast<double>(orientations.size()) : 0.0;
+	}
+};
+
 static void apply_filter(
 	const bool bUseCompoundFilter,
+	const KalmanFilterScalarType scalar_type,
 	ControllerInputStream &stationary_stream,
 	ControllerInputStream &movement_stream,
-	FilterOutputStream &output_stream);
+	FilterOutputStream &output_stream,
+	FilterRunResult &out_result);
+static void print_filter_comparison(
+	const FilterRunResult &double_result,
+	const FilterRunResult &float_result);
 static void init_filter_for_psdualshock4(
 	const ControllerInputStream &stationary_stream,
 	const Eigen::Vector3f &initial_position, const Eigen::Quaternionf &initial_orientation,
 	const bool bUseCompoundFilter,
+	const KalmanFilterScalarType scalar_type,
 	PoseFilterSpace **out_pose_filter_space, IPoseFilter **out_pose_filter);
 static void init_filter_for_psmove(
 	const ControllerInputStream &stationary_stream,
 	const Eigen::Vector3f &initial_position, const Eigen::Quaternionf &initial_orientation,
 	const bool bUseCompoundFilter,
+	const KalmanFilterScalarType scalar_type,
 	PoseFilterSpace **out_pose_filter_space, IPoseFilter **out_pose_filter);
 
 int main(int argc, char *argv[])
@@ -412,12 +434,28 @@ int main(int argc, char *argv[])
 		return -1;
 	}
 
+	FilterRunResult double_result;
 	FilterOutputStream compoundfilter_output_stream("compoundfilter_", argv[3]);
 	apply_filter(
 		true, // use compound orientation kalman + position kalman filter
+		KalmanFilterScalarDouble,
 		stationary_stream,
 		movement_stream,
-		compoundfilter_output_stream);
+		compoundfilter_output_stream,
+		double_result);
+
+	// Run the same data through the single precision filter to see what it costs in accuracy
+	FilterRunResult float_result;
+	FilterOutputStream compoundfilter_float_output_stream("compoundfilter_float_", argv[3]);
+	apply_filter(
+		true,
+		KalmanFilterScalarFloat,
+		stationary_stream,
+		movement_stream,
+		compoundfilter_float_output_stream,
+		float_result);
+
+	print_filter_comparison(double_result, float_result);
 
 	//###HipsterSloth $TODO full pose kalman filter doesn't work yet
 	//FilterOutputStream posefilter_output_stream("posefilter_", argv[3]);
@@ -433,9 +471,11 @@ int main(int argc, char *argv[])
 static void
 apply_filter(
 	const bool bUseCompoundFilter,
+	const KalmanFilterScalarType scalar_type,
 	ControllerInputStream &stationary_stream,
 	ControllerInputStream &movement_stream,
-	FilterOutputStream &output_stream)
+	FilterOutputStream &output_stream,
+	FilterRunResult &out_result)
 {
 	PoseFilterSpace *pose_filter_space = nullptr;
 	IPoseFilter *pose_filter = nullptr;
@@ -451,6 +491,7 @@ apply_filter(
 			stationary_stream,
 			initial_pos, initial_ori,
 			bUseCompoundFilter,
+			scalar_type,
 			&pose_filter_space, &pose_filter);
 		break;
 	case CommonDeviceState::PSDualShock4:
@@ -458,6 +499,7 @@ apply_filter(
 			stationary_stream,
 			initial_pos, initial_ori,
 			bUseCompoundFilter,
+			scalar_type,
 			&pose_filter_space, &pose_filter);
 		break;
 	default:
@@ -466,6 +508,10 @@ apply_filter(
 
 	float lastTime = movement_stream.getSample(0).time - stationary_stream.computeMeanTimeDelta();
 
+	out_result.orientations.clear();
+	out_result.positions.clear();
+	out_result.total_update_seconds = 0.0;
+
 	movement_stream.reset();
 	while (movement_stream.hasNext())
 	{
@@ -483,7 +529,13 @@ apply_filter(
 		PoseFilterPacket filterPacket;
 		pose_filter_space->createFilterPacket(sensorPacket, pose_filter, filterPacket);
 
+		const std::chrono::time_point<std::chrono::high_resolution_clock> update_start = std::chrono::high_resolution_clock::now();
 		pose_filter->update(dT, filterPacket);
+		const std::chrono::duration<double> update_duration = std::chrono::high_resolution_clock::now() - update_start;
+
+		out_result.total_update_seconds += update_duration.count();
+		out_result.orientations.push_back(pose_filter->getOrientation());
+		out_result.positions.push_back(pose_filter->getPositionCm());
 
 		output_stream.writeFilterState(sample, pose_filter, sample.time);
 	}
@@ -498,12 +550,55 @@ apply_filter(
 	}
 }
 
+static void
+print_filter_comparison(
+	const FilterRunResult &double_result,
+	const FilterRunResult &float_result)
+{
+	const size_t sample_count = std::min(double_result.orientations.size(), float_result.orientations.size());
+
+	float max_angle_error = 0.f, mean_angle_error = 0.f;
+	float max_position_error = 0.f, mean_position_error = 0.f;
+	for (size_t sample_index = 0; sample_index < sample_count; ++sample_index)
+	{
+		const float angle_error =
+			eigen_quaternion_unsigned_angle_between(
+				double_result.orientations[sample_index].normalized(),
+				float_result.orientations[sample_index].normalized());
+		const float position_error =
+			(double_result.positions[sample_index] - float_result.positions[sample_index]).norm();
+
+		max_angle_error = std::max(max_angle_error, angle_error);
+		mean_angle_error += angle_error;
+		max_position_error = std::max(max_position_error, position_error);
+		mean_position_error += position_error;
+	}
+
+	if (sample_count > 0)
+	{
+		mean_angle_error /= static_cast<float>(sample_count);
+		mean_position_error /= static_cast<float>(sample_count);
+	}
+
+	const double double_update_us = double_result.getMeanUpdateMicroseconds();
+	const double float_update_us = float_result.getMeanUpdateMicroseconds();
+
+	printf("Mean filter update time: double=%.2fus, float=%.2fus (%.2fx)\n",
+		double_update_us, float_update_us,
+		(float_update_us > 0.0) ? double_update_us / float_update_us : 0.0);
+	printf("Float vs double orientation drift: max=%fdeg, mean=%fdeg\n",
+		max_angle_error * k_radians_to_degreees, mean_angle_error * k_radians_to_degreees);
+	printf("Float vs double position drift: max=%fcm, mean=%fcm\n",
+		max_position_error, mean_position_error);
+}
+
 static void
 init_filter_for_psmove(
 	const ControllerInputStream &stationary_stream,
 	const Eigen::Vector3f &initial_position,
 	const Eigen::Quaternionf &initial_orientation,
 	const bool bUseCompoundFilter,
+	const KalmanFilterScalarType scalar_type,
 	PoseFilterSpace **out_pose_filter_space,
 	IPoseFilter **out_pose_filter)
 {
@@ -560,7 +655,8 @@ init_filter_for_psmove(
 		CompoundPoseFilter *compoundFilter = new CompoundPoseFilter();
 		compoundFilter->init(
 			CommonDeviceState::PSMove, 
-			OrientationFilterTypeKalman, PositionFilterTypeKalman, 
+			(scalar_type == KalmanFilterScalarFloat) ? OrientationFilterTypeKalmanFloat : OrientationFilterTypeKalman,
+			PositionFilterTypeKalman, 
 			constants,
 			initial_position, initial_orientation);
 
@@ -568,7 +664,7 @@ init_filter_for_psmove(
 	}
 	else
 	{
-		KalmanPoseFilterPSMove *fullPoseFilter = new KalmanPoseFilterPSMove();
+		KalmanPoseFilterPSMove *fullPoseFilter = new KalmanPoseFilterPSMove(scalar_type);
 		fullPoseFilter->init(constants, initial_position, initial_orientation);
 
 		*out_pose_filter = fullPoseFilter;
@@ -583,6 +679,7 @@ init_filter_for_psdualshock4(
 	const Eigen::Vector3f &initial_position,
 	const Eigen::Quaternionf &initial_orientation,
 	const bool bUseCompoundFilter,
+	const KalmanFilterScalarType scalar_type,
 	PoseFilterSpace **out_pose_filter_space,
 	IPoseFilter **out_pose_filter)
 {
@@ -636,7 +733,8 @@ init_filter_for_psdualshock4(
 		CompoundPoseFilter *compoundFilter = new CompoundPoseFilter();
 		compoundFilter->init(
 			CommonDeviceState::PSDualShock4,
-			OrientationFilterTypeKalman, PositionFilterTypeKalman,
+			(scalar_type == KalmanFilterScalarFloat) ? OrientationFilterTypeKalmanFloat : OrientationFilterTypeKalman,
+			PositionFilterTypeKalman,
 			constants,
 			initial_position, initial_orientation);
 
@@ -644,7 +742,7 @@ init_filter_for_psdualshock4(
 	}
 	else
 	{
-		KalmanPoseFilterPSMove *fullPoseFilter = new KalmanPoseFilterPSMove();
+		KalmanPoseFilterPSMove *fullPoseFilter = new KalmanPoseFilterPSMove(scalar_type);
 		fullPoseFilter->init(constants, initial_position, initial_orientation);
 
 		*out_pose_filter = fullPoseFilter;
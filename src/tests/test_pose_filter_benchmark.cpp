@@ -0,0 +1,864 @@
+#include "DeviceInterface.h"
+#include "CompoundPoseFilter.h"
+#include "KalmanPoseFilter.h"
+#include "OrientationFilterBatch.h"
+#include "MathAlignment.h"
+#include "MathUtility.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__linux)
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#include <algorithm>
+#include <chrono>
+#include <new>
+#include <random>
+#include <vector>
+
+//-- constants -----
+// Roughly the rates the service sees from a controller:
+// two IMU frames per input report and one optical update per camera frame
+static const float k_imu_packets_per_second = 240.f;
+static const float k_optical_packets_per_second = 60.f;
+static const float k_default_stream_duration_seconds = 20.f;
+
+// Updates at the start of a run that don't count towards the statistics
+// (lets the filters initialize their state and warms up the caches)
+static const int k_warmup_update_count = 120;
+
+static const float k_gyroscope_noise_rad_per_sec = 0.01f;
+static const float k_accelerometer_noise_g_units = 0.005f;
+static const float k_magnetometer_noise_unit = 0.01f;
+static const float k_optical_position_noise_cm = 0.25f;
+
+// Config names used by pose_filter_factory, indexed by filter type
+static const char *k_orientation_filter_names[] = {
+	"",
+	"PassThru",
+	"MadgwickARG",
+	"MadgwickMARG",
+	"ComplementaryOpticalARG",
+	"ComplementaryMARG",
+	"OrientationKalman",
+	"OrientationKalmanFloat",
+};
+
+static const char *k_position_filter_names[] = {
+	"",
+	"PassThru",
+	"LowPassOptical",
+	"LowPassIMU",
+	"ComplimentaryOpticalIMU",
+	"LowPassExponential",
+	"PositionKalman",
+};
+
+//-- allocation counting -----
+// The benchmark is single threaded, so plain globals are enough here.
+// Only allocations made while g_bCountAllocations is set get counted.
+static bool g_bCountAllocations = false;
+static size_t g_allocation_count = 0;
+
+#if defined(__GLIBC__)
+// Hooking malloc catches both operator new and the Eigen heap allocations
+extern "C" void *__libc_malloc(size_t size);
+
+extern "C" void *malloc(size_t size)
+{
+	if (g_bCountAllocations)
+	{
+		++g_allocation_count;
+	}
+
+	return __libc_malloc(size);
+}
+#else
+// Eigen heap allocations bypass operator new on these platforms and don't get counted
+void *operator new(size_t size)
+{
+	if (g_bCountAllocations)
+	{
+		++g_allocation_count;
+	}
+
+	void *p = malloc(size > 0 ? size : 1);
+	if (p == nullptr)
+	{
+		throw std::bad_alloc();
+	}
+
+	return p;
+}
+
+void *operator new[](size_t size)
+{
+	return operator new(size);
+}
+
+void operator delete(void *p) noexcept
+{
+	free(p);
+}
+
+void operator delete[](void *p) noexcept
+{
+	free(p);
+}
+#endif
+
+//-- definitions -----
+typedef std::vector<PoseSensorPacket, Eigen::aligned_allocator<PoseSensorPacket>> t_sensor_packet_stream;
+
+/// Counts the last level cache misses of this process using the linux perf events API.
+/// Not available on other platforms, or when the kernel doesn't allow it (see perf_event_paranoid).
+class CacheMissCounter
+{
+public:
+	CacheMissCounter()
+		: m_fd(-1)
+	{
+#if defined(__linux)
+		perf_event_attr attr;
+		memset(&attr, 0, sizeof(perf_event_attr));
+		attr.type = PERF_TYPE_HARDWARE;
+		attr.size = sizeof(perf_event_attr);
+		attr.config = PERF_COUNT_HW_CACHE_MISSES;
+		attr.disabled = 1;
+		attr.exclude_kernel = 1;
+		attr.exclude_hv = 1;
+
+		m_fd = static_cast<int>(syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0));
+#endif
+	}
+
+	~CacheMissCounter()
+	{
+#if defined(__linux)
+		if (m_fd != -1)
+		{
+			close(m_fd);
+		}
+#endif
+	}
+
+	inline bool getIsAvailable() const
+	{
+		return m_fd != -1;
+	}
+
+	void start()
+	{
+#if defined(__linux)
+		if (m_fd != -1)
+		{
+			ioctl(m_fd, PERF_EVENT_IOC_RESET, 0);
+			ioctl(m_fd, PERF_EVENT_IOC_ENABLE, 0);
+		}
+#endif
+	}
+
+	long long stop()
+	{
+		long long miss_count = 0;
+
+#if defined(__linux)
+		if (m_fd != -1)
+		{
+			ioctl(m_fd, PERF_EVENT_IOC_DISABLE, 0);
+			if (read(m_fd, &miss_count, sizeof(long long)) != sizeof(long long))
+			{
+				miss_count = 0;
+			}
+		}
+#endif
+
+		return miss_count;
+	}
+
+private:
+	int m_fd;
+};
+
+enum eBenchmarkFilterKind
+{
+	CompoundFilter,
+	KalmanPoseFilterPSMoveKind,
+	KalmanPoseFilterDS4Kind,
+	KalmanPoseFilterMorpheusKind,
+	KalmanPoseFilterPointCloudKind,
+};
+
+struct FilterBenchmarkCase
+{
+	CommonDeviceState::eDeviceType device_type;
+	eBenchmarkFilterKind filter_kind;
+	OrientationFilterType orientation_filter_type;
+	PositionFilterType position_filter_type;
+	KalmanFilterScalarType scalar_type;
+};
+
+struct FilterBenchmarkResult
+{
+	double mean_update_ns;
+	double p99_update_ns;
+	double max_update_ns;
+	double allocations_per_update;
+	double cache_misses_per_update;
+};
+
+static const FilterBenchmarkCase k_benchmark_cases[] = {
+	// PSMove
+	{CommonDeviceState::PSMove, KalmanPoseFilterPSMoveKind, OrientationFilterTypeNone, PositionFilterTypeNone, KalmanFilterScalarDouble},
+	{CommonDeviceState::PSMove, KalmanPoseFilterPSMoveKind, OrientationFilterTypeNone, PositionFilterTypeNone, KalmanFilterScalarFloat},
+	{CommonDeviceState::PSMove, CompoundFilter, OrientationFilterTypePassThru, PositionFilterTypePassThru, KalmanFilterScalarDouble},
+	{CommonDeviceState::PSMove, CompoundFilter, OrientationFilterTypeMadgwickARG, PositionFilterTypePassThru, KalmanFilterScalarDouble},
+	{CommonDeviceState::PSMove, CompoundFilter, OrientationFilterTypeMadgwickMARG, PositionFilterTypePassThru, KalmanFilterScalarDouble},
+	{CommonDeviceState::PSMove, CompoundFilter, OrientationFilterTypeComplementaryOpticalARG, PositionFilterTypePassThru, KalmanFilterScalarDouble},
+	{CommonDeviceState::PSMove, CompoundFilter, OrientationFilterTypeComplementaryMARG, PositionFilterTypePassThru, KalmanFilterScalarDouble},
+	{CommonDeviceState::PSMove, CompoundFilter, OrientationFilterTypeKalman, PositionFilterTypePassThru, KalmanFilterScalarDouble},
+	{CommonDeviceState::PSMove, CompoundFilter, OrientationFilterTypeKalmanFloat, PositionFilterTypePassThru, KalmanFilterScalarFloat},
+	{CommonDeviceState::PSMove, CompoundFilter, OrientationFilterTypePassThru, PositionFilterTypeLowPassOptical, KalmanFilterScalarDouble},
+	{CommonDeviceState::PSMove, CompoundFilter, OrientationFilterTypePassThru, PositionFilterTypeLowPassIMU, KalmanFilterScalarDouble},
+	{CommonDeviceState::PSMove, CompoundFilter, OrientationFilterTypePassThru, PositionFilterTypeComplimentaryOpticalIMU, KalmanFilterScalarDouble},
+	{CommonDeviceState::PSMove, CompoundFilter, OrientationFilterTypePassThru, PositionFilterTypeLowPassExponential, KalmanFilterScalarDouble},
+	{CommonDeviceState::PSMove, CompoundFilter, OrientationFilterTypePassThru, PositionFilterTypeKalman, KalmanFilterScalarDouble},
+	{CommonDeviceState::PSMove, CompoundFilter, OrientationFilterTypeComplementaryMARG, PositionFilterTypeLowPassExponential, KalmanFilterScalarDouble},
+	{CommonDeviceState::PSMove, CompoundFilter, OrientationFilterTypeKalman, PositionFilterTypeKalman, KalmanFilterScalarDouble},
+	// DualShock4
+	{CommonDeviceState::PSDualShock4, KalmanPoseFilterDS4Kind, OrientationFilterTypeNone, PositionFilterTypeNone, KalmanFilterScalarDouble},
+	{CommonDeviceState::PSDualShock4, KalmanPoseFilterDS4Kind, OrientationFilterTypeNone, PositionFilterTypeNone, KalmanFilterScalarFloat},
+	{CommonDeviceState::PSDualShock4, CompoundFilter, OrientationFilterTypeMadgwickARG, PositionFilterTypePassThru, KalmanFilterScalarDouble},
+	{CommonDeviceState::PSDualShock4, CompoundFilter, OrientationFilterTypeComplementaryOpticalARG, PositionFilterTypePassThru, KalmanFilterScalarDouble},
+	{CommonDeviceState::PSDualShock4, CompoundFilter, OrientationFilterTypeKalman, PositionFilterTypePassThru, KalmanFilterScalarDouble},
+	{CommonDeviceState::PSDualShock4, CompoundFilter, OrientationFilterTypeKalmanFloat, PositionFilterTypePassThru, KalmanFilterScalarFloat},
+	{CommonDeviceState::PSDualShock4, CompoundFilter, OrientationFilterTypeComplementaryOpticalARG, PositionFilterTypeComplimentaryOpticalIMU, KalmanFilterScalarDouble},
+	{CommonDeviceState::PSDualShock4, CompoundFilter, OrientationFilterTypeKalman, PositionFilterTypeKalman, KalmanFilterScalarDouble},
+	// Morpheus
+	{CommonDeviceState::Morpheus, KalmanPoseFilterMorpheusKind, OrientationFilterTypeNone, PositionFilterTypeNone, KalmanFilterScalarDouble},
+	{CommonDeviceState::Morpheus, KalmanPoseFilterMorpheusKind, OrientationFilterTypeNone, PositionFilterTypeNone, KalmanFilterScalarFloat},
+	{CommonDeviceState::Morpheus, KalmanPoseFilterPointCloudKind, OrientationFilterTypeNone, PositionFilterTypeNone, KalmanFilterScalarDouble},
+	{CommonDeviceState::Morpheus, KalmanPoseFilterPointCloudKind, OrientationFilterTypeNone, PositionFilterTypeNone, KalmanFilterScalarFloat},
+	{CommonDeviceState::Morpheus, CompoundFilter, OrientationFilterTypeMadgwickARG, PositionFilterTypeLowPassExponential, KalmanFilterScalarDouble},
+	{CommonDeviceState::Morpheus, CompoundFilter, OrientationFilterTypeKalman, PositionFilterTypeLowPassExponential, KalmanFilterScalarDouble},
+	{CommonDeviceState::Morpheus, CompoundFilter, OrientationFilterTypeKalmanFloat, PositionFilterTypeLowPassExponential, KalmanFilterScalarFloat},
+};
+static const int k_benchmark_case_count = sizeof(k_benchmark_cases) / sizeof(FilterBenchmarkCase);
+
+// Orientation filters that can run on an OrientationFilterBatch,
+// compared against the same filters updated one controller at a time
+static const OrientationFilterType k_batched_orientation_filter_types[] = {
+	OrientationFilterTypeMadgwickARG,
+	OrientationFilterTypeMadgwickMARG,
+	OrientationFilterTypeComplementaryMARG,
+};
+static const int k_batched_orientation_filter_type_count =
+	sizeof(k_batched_orientation_filter_types) / sizeof(OrientationFilterType);
+
+// Same as PSMOVESERVICE_MAX_CONTROLLER_COUNT (the size of the service's batch)
+static const int k_batched_controller_count = 5;
+
+struct BatchComparisonResult
+{
+	double individual_mean_update_ns; // per controller update
+	double batched_mean_update_ns; // per controller update
+	double max_orientation_difference_degrees;
+};
+
+//-- prototypes -----
+static void init_filter_space(const CommonDeviceState::eDeviceType device_type, PoseFilterSpace &out_pose_filter_space);
+static void init_filter_constants(
+	const CommonDeviceState::eDeviceType device_type,
+	const PoseFilterSpace &pose_filter_space,
+	PoseFilterConstants &out_constants);
+static void generate_sensor_stream(
+	const CommonDeviceState::eDeviceType device_type,
+	const PoseFilterSpace &pose_filter_space,
+	const float duration_seconds,
+	t_sensor_packet_stream &out_stream);
+static IPoseFilter *allocate_filter(const FilterBenchmarkCase &benchmark_case, const PoseFilterConstants &constants);
+static void run_benchmark(
+	const FilterBenchmarkCase &benchmark_case,
+	const PoseFilterSpace &pose_filter_space,
+	const PoseFilterConstants &constants,
+	const t_sensor_packet_stream &stream,
+	CacheMissCounter &cache_miss_counter,
+	FilterBenchmarkResult &out_result);
+static void run_batch_comparison(
+	const OrientationFilterType orientation_filter_type,
+	const int controller_count,
+	const PoseFilterSpace &pose_filter_space,
+	const PoseFilterConstants &constants,
+	const t_sensor_packet_stream &stream,
+	BatchComparisonResult &out_result);
+static const char *get_device_name(const CommonDeviceState::eDeviceType device_type);
+static const char *get_filter_kind_name(const eBenchmarkFilterKind filter_kind);
+
+//-- entry point -----
+int main(int argc, char *argv[])
+{
+	float duration_seconds = k_default_stream_duration_seconds;
+
+	if (argc >= 2)
+	{
+		duration_seconds = static_cast<float>(atof(argv[1]));
+
+		if (duration_seconds <= 0.f)
+		{
+			printf("usage test_pose_filter_benchmark [stream_duration_seconds]\n");
+			return -1;
+		}
+	}
+
+	CacheMissCounter cache_miss_counter;
+	if (!cache_miss_counter.getIsAvailable())
+	{
+		printf("Cache miss counter not available, cache misses will be reported as n/a\n");
+	}
+#if !defined(__GLIBC__)
+	printf("Eigen heap allocations aren't counted on this platform\n");
+#endif
+
+	printf("Synthetic stream: %.1fs, %.0f IMU packets/s, %.0f optical packets/s\n\n",
+		duration_seconds, k_imu_packets_per_second, k_optical_packets_per_second);
+	printf("%-12s %-24s %-24s %-24s %10s %10s %10s %12s %14s\n",
+		"DEVICE", "FILTER", "POSITION", "ORIENTATION",
+		"MEAN(ns)", "P99(ns)", "MAX(ns)", "ALLOCS/UPD", "CACHEMISS/UPD");
+
+	CommonDeviceState::eDeviceType stream_device_type = CommonDeviceState::INVALID_DEVICE_TYPE;
+	PoseFilterSpace pose_filter_space;
+	PoseFilterConstants constants;
+	t_sensor_packet_stream stream;
+
+	for (int case_index = 0; case_index < k_benchmark_case_count; ++case_index)
+	{
+		const FilterBenchmarkCase &benchmark_case = k_benchmark_cases[case_index];
+
+		// All of the filters for a device get fed the same stream
+		if (benchmark_case.device_type != stream_device_type)
+		{
+			stream_device_type = benchmark_case.device_type;
+
+			init_filter_space(stream_device_type, pose_filter_space);
+			init_filter_constants(stream_device_type, pose_filter_space, constants);
+			generate_sensor_stream(stream_device_type, pose_filter_space, duration_seconds, stream);
+		}
+
+		FilterBenchmarkResult result;
+		run_benchmark(benchmark_case, pose_filter_space, constants, stream, cache_miss_counter, result);
+
+		char cache_miss_string[32];
+		if (cache_miss_counter.getIsAvailable())
+		{
+			snprintf(cache_miss_string, sizeof(cache_miss_string), "%.2f", result.cache_misses_per_update);
+		}
+		else
+		{
+			snprintf(cache_miss_string, sizeof(cache_miss_string), "n/a");
+		}
+
+		const bool bIsCompoundFilter = benchmark_case.filter_kind == CompoundFilter;
+		const char *scalar_name = (benchmark_case.scalar_type == KalmanFilterScalarFloat) ? "PoseKalmanFloat" : "PoseKalman";
+
+		printf("%-12s %-24s %-24s %-24s %10.0f %10.0f %10.0f %12.2f %14s\n",
+			get_device_name(benchmark_case.device_type),
+			get_filter_kind_name(benchmark_case.filter_kind),
+			bIsCompoundFilter ? k_position_filter_names[benchmark_case.position_filter_type] : scalar_name,
+			bIsCompoundFilter ? k_orientation_filter_names[benchmark_case.orientation_filter_type] : scalar_name,
+			result.mean_update_ns,
+			result.p99_update_ns,
+			result.max_update_ns,
+			result.allocations_per_update,
+			cache_miss_string);
+	}
+
+	// Every controller gets fed the same PSMove stream
+	const int controller_count = k_batched_controller_count;
+	init_filter_space(CommonDeviceState::PSMove, pose_filter_space);
+	init_filter_constants(CommonDeviceState::PSMove, pose_filter_space, constants);
+	generate_sensor_stream(CommonDeviceState::PSMove, pose_filter_space, duration_seconds, stream);
+
+	printf("\nOrientation filters of %d controllers, individually vs on an OrientationFilterBatch\n", controller_count);
+	printf("%-24s %18s %18s %18s\n", "ORIENTATION", "INDIVIDUAL(ns)", "BATCHED(ns)", "MAX DIFF(deg)");
+
+	for (int type_index = 0; type_index < k_batched_orientation_filter_type_count; ++type_index)
+	{
+		const OrientationFilterType orientation_filter_type = k_batched_orientation_filter_types[type_index];
+
+		BatchComparisonResult result;
+		run_batch_comparison(orientation_filter_type, controller_count, pose_filter_space, constants, stream, result);
+
+		printf("%-24s %18.0f %18.0f %18.4f\n",
+			k_orientation_filter_names[orientation_filter_type],
+			result.individual_mean_update_ns,
+			result.batched_mean_update_ns,
+			result.max_orientation_difference_degrees);
+	}
+
+	return 0;
+}
+
+//-- private functions -----
+static void
+init_filter_space(
+	const CommonDeviceState::eDeviceType device_type,
+	PoseFilterSpace &out_pose_filter_space)
+{
+	out_pose_filter_space.setIdentityGravity(Eigen::Vector3f(0.f, 1.f, 0.f));
+	out_pose_filter_space.setIdentityMagnetometer(
+		(device_type == CommonDeviceState::PSMove)
+		? Eigen::Vector3f(0.234017432f, 0.42765367f, -0.873125494f)
+		: Eigen::Vector3f::Zero()); // Only the PSMove has a magnetometer
+	out_pose_filter_space.setCalibrationTransform(*k_eigen_identity_pose_upright);
+	out_pose_filter_space.setSensorTransform(*k_eigen_sensor_transform_identity);
+}
+
+static void
+init_filter_constants(
+	const CommonDeviceState::eDeviceType device_type,
+	const PoseFilterSpace &pose_filter_space,
+	PoseFilterConstants &out_constants)
+{
+	const Eigen::Vector3f gyro_variance = Eigen::Vector3f::Constant(k_gyroscope_noise_rad_per_sec * k_gyroscope_noise_rad_per_sec);
+	const Eigen::Vector3f accelerometer_variance = Eigen::Vector3f::Constant(k_accelerometer_noise_g_units * k_accelerometer_noise_g_units);
+	const Eigen::Vector3f magnetometer_variance = Eigen::Vector3f::Constant(k_magnetometer_noise_unit * k_magnetometer_noise_unit);
+
+	out_constants.clear();
+
+	// Tracking shape
+	switch (device_type)
+	{
+	case CommonDeviceState::PSMove:
+		out_constants.shape.shape_type = Sphere;
+		out_constants.shape.shape.sphere.center_cm.clear();
+		out_constants.shape.shape.sphere.radius_cm = 2.25f;
+		break;
+	case CommonDeviceState::PSDualShock4:
+		out_constants.shape.shape_type = LightBar;
+		break;
+	case CommonDeviceState::Morpheus:
+		// Same LED layout as MorpheusHMD::getTrackingShape()
+		out_constants.shape.shape_type = PointCloud;
+		out_constants.shape.shape.point_cloud.point[0].set(0.f, 0.f, 0.f);
+		out_constants.shape.shape.point_cloud.point[1].set(8.f, 4.5f, -2.5f);
+		out_constants.shape.shape.point_cloud.point[2].set(9.f, 0.f, -10.f);
+		out_constants.shape.shape.point_cloud.point[3].set(8.f, -4.5f, -2.5f);
+		out_constants.shape.shape.point_cloud.point[4].set(-8.f, 4.5f, -2.5f);
+		out_constants.shape.shape.point_cloud.point[5].set(-9.f, 0.f, -10.f);
+		out_constants.shape.shape.point_cloud.point[6].set(-8.f, -4.5f, -2.5f);
+		out_constants.shape.shape.point_cloud.point[7].set(6.f, -1.f, -24.f);
+		out_constants.shape.shape.point_cloud.point[8].set(-6.f, -1.f, -24.f);
+		out_constants.shape.shape.point_cloud.point_count = 9;
+		break;
+	default:
+		break;
+	}
+
+	// Orientation filter constants
+	out_constants.orientation_constants.tracking_shape = out_constants.shape;
+	out_constants.orientation_constants.gravity_calibration_direction = pose_filter_space.getGravityCalibrationDirection();
+	out_constants.orientation_constants.magnetometer_calibration_direction = pose_filter_space.getMagnetometerCalibrationDirection();
+	out_constants.orientation_constants.mean_update_time_delta = 1.f / k_imu_packets_per_second;
+	out_constants.orientation_constants.position_variance_curve.A = 0.44888f;
+	out_constants.orientation_constants.position_variance_curve.B = -0.00402f;
+	out_constants.orientation_constants.position_variance_curve.MaxValue = 1.f;
+	out_constants.orientation_constants.orientation_variance_curve.A = 0.44888f;
+	out_constants.orientation_constants.orientation_variance_curve.B = -0.00402f;
+	out_constants.orientation_constants.orientation_variance_curve.MaxValue = 1.f;
+	out_constants.orientation_constants.accelerometer_variance = accelerometer_variance;
+	out_constants.orientation_constants.accelerometer_drift = Eigen::Vector3f::Zero();
+	out_constants.orientation_constants.gyro_variance = gyro_variance;
+	out_constants.orientation_constants.gyro_drift = Eigen::Vector3f::Zero();
+	out_constants.orientation_constants.magnetometer_variance =
+		(device_type == CommonDeviceState::PSMove) ? magnetometer_variance : Eigen::Vector3f::Zero();
+	out_constants.orientation_constants.magnetometer_drift = Eigen::Vector3f::Zero();
+
+	// Position filter constants
+	out_constants.position_constants.use_linear_acceleration = true;
+	out_constants.position_constants.apply_gravity_mask = true;
+	out_constants.position_constants.gravity_calibration_direction = pose_filter_space.getGravityCalibrationDirection();
+	out_constants.position_constants.accelerometer_noise_radius = 0.0139137721f;
+	out_constants.position_constants.accelerometer_variance = accelerometer_variance;
+	out_constants.position_constants.accelerometer_drift = Eigen::Vector3f::Zero();
+	out_constants.position_constants.max_velocity = 1.f;
+	out_constants.position_constants.mean_update_time_delta = 1.f / k_optical_packets_per_second;
+	out_constants.position_constants.position_variance_curve.A = 0.44888f;
+	out_constants.position_constants.position_variance_curve.B = -0.00402f;
+	out_constants.position_constants.position_variance_curve.MaxValue = 1.f;
+}
+
+static void
+generate_sensor_stream(
+	const CommonDeviceState::eDeviceType device_type,
+	const PoseFilterSpace &pose_filter_space,
+	const float duration_seconds,
+	t_sensor_packet_stream &out_stream)
+{
+	// Fixed seed so every run (and every filter) sees the same data
+	std::mt19937 random_engine(1234);
+	std::normal_distribution<float> unit_noise(0.f, 1.f);
+
+	const bool bHasMagnetometer = device_type == CommonDeviceState::PSMove;
+	const Eigen::Vector3f gravity = pose_filter_space.getGravityCalibrationDirection();
+	const Eigen::Vector3f magnetometer = pose_filter_space.getMagnetometerCalibrationDirection();
+
+	// Swing the device back and forth around a tilted axis while moving it in a circle
+	const Eigen::Vector3f rotation_axis = Eigen::Vector3f(0.3f, 1.f, 0.2f).normalized();
+	const float rotation_amplitude_radians = 1.f;
+	const float rotation_frequency = 2.f * k_real_pi * 0.5f; // rad/s
+	const Eigen::Vector3f circle_center_cm(0.f, 0.f, -150.f);
+	const float circle_radius_cm = 20.f;
+	const float circle_frequency = 2.f * k_real_pi * 0.25f; // rad/s
+
+	const std::chrono::time_point<std::chrono::high_resolution_clock> start_timestamp = std::chrono::high_resolution_clock::now();
+	const int imu_packet_count = static_cast<int>(duration_seconds * k_imu_packets_per_second);
+	const int optical_packet_count = static_cast<int>(duration_seconds * k_optical_packets_per_second);
+
+	out_stream.clear();
+	out_stream.reserve(imu_packet_count + optical_packet_count);
+
+	// Interleave the IMU and optical packets in capture time order
+	int imu_packet_index = 0;
+	int optical_packet_index = 0;
+	while (imu_packet_index < imu_packet_count || optical_packet_index < optical_packet_count)
+	{
+		const float imu_time = static_cast<float>(imu_packet_index) / k_imu_packets_per_second;
+		const float optical_time = static_cast<float>(optical_packet_index) / k_optical_packets_per_second;
+		const bool bIsIMUPacket =
+			imu_packet_index < imu_packet_count &&
+			(optical_packet_index >= optical_packet_count || imu_time <= optical_time);
+		const float time = bIsIMUPacket ? imu_time : optical_time;
+
+		const float rotation_angle = rotation_amplitude_radians * sinf(rotation_frequency * time);
+		const float rotation_speed = rotation_amplitude_radians * rotation_frequency * cosf(rotation_frequency * time);
+		const Eigen::Quaternionf orientation(Eigen::AngleAxisf(rotation_angle, rotation_axis));
+
+		const Eigen::Vector3f position_cm =
+			circle_center_cm +
+			circle_radius_cm * Eigen::Vector3f(cosf(circle_frequency * time), sinf(circle_frequency * time), 0.f);
+		const Eigen::Vector3f linear_acceleration_cm_s2 =
+			-circle_frequency * circle_frequency * (position_cm - circle_center_cm);
+
+		PoseSensorPacket packet;
+		packet.clear();
+		packet.timestamp =
+			start_timestamp +
+			std::chrono::duration_cast<std::chrono::high_resolution_clock::duration>(std::chrono::duration<float>(time));
+
+		if (bIsIMUPacket)
+		{
+			// Sensor readings are in the device's frame
+			const Eigen::Quaternionf world_to_sensor = orientation.conjugate();
+			const Eigen::Vector3f world_accelerometer = gravity + linear_acceleration_cm_s2 / k_g_units_to_gal;
+
+			packet.imu_gyroscope_rad_per_sec =
+				rotation_axis * rotation_speed +
+				k_gyroscope_noise_rad_per_sec * Eigen::Vector3f(unit_noise(random_engine), unit_noise(random_engine), unit_noise(random_engine));
+			packet.imu_accelerometer_g_units =
+				eigen_vector3f_clockwise_rotate(world_to_sensor, world_accelerometer) +
+				k_accelerometer_noise_g_units * Eigen::Vector3f(unit_noise(random_engine), unit_noise(random_engine), unit_noise(random_engine));
+			packet.has_gyroscope_measurement = true;
+			packet.has_accelerometer_measurement = true;
+
+			if (bHasMagnetometer)
+			{
+				packet.imu_magnetometer_unit =
+					(eigen_vector3f_clockwise_rotate(world_to_sensor, magnetometer) +
+					 k_magnetometer_noise_unit * Eigen::Vector3f(unit_noise(random_engine), unit_noise(random_engine), unit_noise(random_engine))).normalized();
+				packet.has_magnetometer_measurement = true;
+			}
+
+			++imu_packet_index;
+		}
+		else
+		{
+			packet.optical_position_cm =
+				position_cm +
+				k_optical_position_noise_cm * Eigen::Vector3f(unit_noise(random_engine), unit_noise(random_engine), unit_noise(random_engine));
+			packet.optical_orientation = orientation;
+			packet.tracking_projection_area_px_sqr = 400.f;
+
+			++optical_packet_index;
+		}
+
+		out_stream.push_back(packet);
+	}
+}
+
+static IPoseFilter *
+allocate_filter(
+	const FilterBenchmarkCase &benchmark_case,
+	const PoseFilterConstants &constants)
+{
+	IPoseFilter *pose_filter = nullptr;
+
+	switch (benchmark_case.filter_kind)
+	{
+	case CompoundFilter:
+		{
+			CompoundPoseFilter *compound_filter = new CompoundPoseFilter();
+			compound_filter->init(
+				benchmark_case.device_type,
+				benchmark_case.orientation_filter_type,
+				benchmark_case.position_filter_type,
+				constants);
+			pose_filter = compound_filter;
+		} break;
+	case KalmanPoseFilterPSMoveKind:
+		{
+			KalmanPoseFilterPSMove *kalman_filter = new KalmanPoseFilterPSMove(benchmark_case.scalar_type);
+			kalman_filter->init(constants);
+			pose_filter = kalman_filter;
+		} break;
+	case KalmanPoseFilterDS4Kind:
+		{
+			KalmanPoseFilterDS4 *kalman_filter = new KalmanPoseFilterDS4(benchmark_case.scalar_type);
+			kalman_filter->init(constants);
+			pose_filter = kalman_filter;
+		} break;
+	case KalmanPoseFilterMorpheusKind:
+		{
+			KalmanPoseFilterMorpheus *kalman_filter = new KalmanPoseFilterMorpheus(benchmark_case.scalar_type);
+			kalman_filter->init(constants);
+			pose_filter = kalman_filter;
+		} break;
+	case KalmanPoseFilterPointCloudKind:
+		{
+			KalmanPoseFilterPointCloud *kalman_filter = new KalmanPoseFilterPointCloud(benchmark_case.scalar_type);
+			kalman_filter->init(constants);
+			pose_filter = kalman_filter;
+		} break;
+	default:
+		assert(0 && "unreachable");
+	}
+
+	return pose_filter;
+}
+
+static void
+run_benchmark(
+	const FilterBenchmarkCase &benchmark_case,
+	const PoseFilterSpace &pose_filter_space,
+	const PoseFilterConstants &constants,
+	const t_sensor_packet_stream &stream,
+	CacheMissCounter &cache_miss_counter,
+	FilterBenchmarkResult &out_result)
+{
+	IPoseFilter *pose_filter = allocate_filter(benchmark_case, constants);
+	PoseFilterPacket filter_packet;
+	filter_packet.clear();
+
+	float previous_time_seconds = -1.f / k_imu_packets_per_second;
+	std::vector<double> update_durations_ns;
+	update_durations_ns.reserve(stream.size());
+
+	size_t allocation_count = 0;
+	long long cache_miss_count = 0;
+	int measured_update_count = 0;
+
+	for (size_t packet_index = 0; packet_index < stream.size(); ++packet_index)
+	{
+		const PoseSensorPacket &sensor_packet = stream[packet_index];
+		const bool bMeasureUpdate = packet_index >= static_cast<size_t>(k_warmup_update_count);
+
+		const std::chrono::duration<float> packet_time = sensor_packet.timestamp - stream[0].timestamp;
+		const float delta_time = packet_time.count() - previous_time_seconds;
+		previous_time_seconds = packet_time.count();
+
+		filter_packet.clear();
+		pose_filter_space.createFilterPacket(sensor_packet, pose_filter, filter_packet);
+
+		if (bMeasureUpdate)
+		{
+			const size_t allocations_before = g_allocation_count;
+
+			cache_miss_counter.start();
+			g_bCountAllocations = true;
+			const std::chrono::time_point<std::chrono::high_resolution_clock> update_start = std::chrono::high_resolution_clock::now();
+
+			pose_filter->update(delta_time, filter_packet);
+
+			const std::chrono::time_point<std::chrono::high_resolution_clock> update_end = std::chrono::high_resolution_clock::now();
+			g_bCountAllocations = false;
+			cache_miss_count += cache_miss_counter.stop();
+
+			const std::chrono::duration<double, std::nano> update_duration = update_end - update_start;
+			update_durations_ns.push_back(update_duration.count());
+			allocation_count += g_allocation_count - allocations_before;
+			++measured_update_count;
+		}
+		else
+		{
+			pose_filter->update(delta_time, filter_packet);
+		}
+	}
+
+	delete pose_filter;
+
+	// Summarize the update timings
+	double total_update_ns = 0.0;
+	for (double update_ns : update_durations_ns)
+	{
+		total_update_ns += update_ns;
+	}
+
+	std::sort(update_durations_ns.begin(), update_durations_ns.end());
+
+	const size_t update_count = update_durations_ns.size();
+	out_result.mean_update_ns = (update_count > 0) ? total_update_ns / static_cast<double>(update_count) : 0.0;
+	out_result.p99_update_ns = (update_count > 0) ? update_durations_ns[std::min(update_count - 1, (update_count * 99) / 100)] : 0.0;
+	out_result.max_update_ns = (update_count > 0) ? update_durations_ns[update_count - 1] : 0.0;
+	out_result.allocations_per_update =
+		(measured_update_count > 0) ? static_cast<double>(allocation_count) / static_cast<double>(measured_update_count) : 0.0;
+	out_result.cache_misses_per_update =
+		(measured_update_count > 0) ? static_cast<double>(cache_miss_count) / static_cast<double>(measured_update_count) : 0.0;
+}
+
+static void
+run_batch_comparison(
+	const OrientationFilterType orientation_filter_type,
+	const int controller_count,
+	const PoseFilterSpace &pose_filter_space,
+	const PoseFilterConstants &constants,
+	const t_sensor_packet_stream &stream,
+	BatchComparisonResult &out_result)
+{
+	OrientationFilterBatch orientation_batch(controller_count);
+	std::vector<IPoseFilter *> individual_filters;
+	std::vector<IPoseFilter *> batched_filters;
+
+	for (int controller_index = 0; controller_index < controller_count; ++controller_index)
+	{
+		CompoundPoseFilter *individual_filter = new CompoundPoseFilter();
+		individual_filter->init(CommonDeviceState::PSMove, orientation_filter_type, PositionFilterTypePassThru, constants);
+		individual_filters.push_back(individual_filter);
+
+		CompoundPoseFilter *batched_filter = new CompoundPoseFilter();
+		batched_filter->init(CommonDeviceState::PSMove, orientation_filter_type, PositionFilterTypePassThru, constants, &orientation_batch);
+		batched_filters.push_back(batched_filter);
+	}
+
+	PoseFilterPacket filter_packet;
+	filter_packet.clear();
+
+	float previous_time_seconds = -1.f / k_imu_packets_per_second;
+	double individual_total_ns = 0.0;
+	double batched_total_ns = 0.0;
+	int measured_round_count = 0;
+	float max_difference_radians = 0.f;
+
+	// Each round hands the same packet to every controller, the way the controller manager does
+	orientation_batch.setDeferUpdates(true);
+
+	for (size_t packet_index = 0; packet_index < stream.size(); ++packet_index)
+	{
+		const PoseSensorPacket &sensor_packet = stream[packet_index];
+		const bool bMeasureRound = packet_index >= static_cast<size_t>(k_warmup_update_count);
+
+		const std::chrono::duration<float> packet_time = sensor_packet.timestamp - stream[0].timestamp;
+		const float delta_time = packet_time.count() - previous_time_seconds;
+		previous_time_seconds = packet_time.count();
+
+		std::chrono::duration<double, std::nano> individual_duration(0.0);
+		for (IPoseFilter *pose_filter : individual_filters)
+		{
+			filter_packet.clear();
+			pose_filter_space.createFilterPacket(sensor_packet, pose_filter, filter_packet);
+
+			const std::chrono::time_point<std::chrono::high_resolution_clock> update_start = std::chrono::high_resolution_clock::now();
+			pose_filter->update(delta_time, filter_packet);
+			individual_duration += std::chrono::high_resolution_clock::now() - update_start;
+		}
+
+		std::chrono::duration<double, std::nano> batched_duration(0.0);
+		for (IPoseFilter *pose_filter : batched_filters)
+		{
+			filter_packet.clear();
+			pose_filter_space.createFilterPacket(sensor_packet, pose_filter, filter_packet);
+
+			const std::chrono::time_point<std::chrono::high_resolution_clock> update_start = std::chrono::high_resolution_clock::now();
+			pose_filter->update(delta_time, filter_packet);
+			batched_duration += std::chrono::high_resolution_clock::now() - update_start;
+		}
+
+		const std::chrono::time_point<std::chrono::high_resolution_clock> batch_update_start = std::chrono::high_resolution_clock::now();
+		orientation_batch.update();
+		for (IPoseFilter *pose_filter : batched_filters)
+		{
+			pose_filter->completeBatchedUpdate();
+		}
+		batched_duration += std::chrono::high_resolution_clock::now() - batch_update_start;
+
+		if (bMeasureRound)
+		{
+			individual_total_ns += individual_duration.count();
+			batched_total_ns += batched_duration.count();
+			++measured_round_count;
+		}
+
+		for (int controller_index = 0; controller_index < controller_count; ++controller_index)
+		{
+			const float difference_radians =
+				individual_filters[controller_index]->getOrientation().angularDistance(
+					batched_filters[controller_index]->getOrientation());
+
+			max_difference_radians = std::max(max_difference_radians, difference_radians);
+		}
+	}
+
+	orientation_batch.setDeferUpdates(false);
+
+	// Free the batched filters before the batch they have lanes on
+	for (int controller_index = 0; controller_index < controller_count; ++controller_index)
+	{
+		delete individual_filters[controller_index];
+		delete batched_filters[controller_index];
+	}
+
+	const double measured_update_count = static_cast<double>(measured_round_count * controller_count);
+	out_result.individual_mean_update_ns = (measured_round_count > 0) ? individual_total_ns / measured_update_count : 0.0;
+	out_result.batched_mean_update_ns = (measured_round_count > 0) ? batched_total_ns / measured_update_count : 0.0;
+	out_result.max_orientation_difference_degrees = max_difference_radians * k_radians_to_degreees;
+}
+
+static const char *
+get_device_name(const CommonDeviceState::eDeviceType device_type)
+{
+	switch (device_type)
+	{
+	case CommonDeviceState::PSMove:
+		return "PSMove";
+	case CommonDeviceState::PSDualShock4:
+		return "DualShock4";
+	case CommonDeviceState::Morpheus:
+		return "Morpheus";
+	default:
+		return "Unknown";
+	}
+}
+
+static const char *
+get_filter_kind_name(const eBenchmarkFilterKind filter_kind)
+{
+	switch (filter_kind)
+	{
+	case CompoundFilter:
+		return "CompoundPoseFilter";
+	case KalmanPoseFilterPSMoveKind:
+		return "KalmanPoseFilterPSMove";
+	case KalmanPoseFilterDS4Kind:
+		return "KalmanPoseFilterDS4";
+	case KalmanPoseFilterMorpheusKind:
+		return "KalmanPoseFilterMorpheus";
+	case KalmanPoseFilterPointCloudKind:
+		return "KalmanPoseFilterPointCloud";
+	default:
+		return "Unknown";
+	}
+}